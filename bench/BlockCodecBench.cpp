@@ -0,0 +1,312 @@
+﻿/// @file BlockCodecBench.cpp
+/// @brief ブロック圧縮コーデックの検証とスループットのベンチマーク
+///
+/// 3種類のデータ（浮動小数点の点群、OBJ風のテキスト、乱数）について、圧縮方式とシャッフルの組み合わせごとに次を測ります。
+///
+/// - ratio : 圧縮前 / 圧縮後
+/// - enc, dec : 1スレッドでのBlockCodecの圧縮・展開のスループット（MB/s、圧縮前のサイズ基準）
+/// - export, import : WriteMode::kBlocks / ReadMode::kBlocksのトランスレーターでファイルへ書き出し・読み込んだときのスループット（並列）
+/// - serial : 同じ書き出しをparallelSections() == falseで行った場合のスループット
+///
+/// 最後にreadAtによるランダムアクセスの時間を測り、端のサイズでの往復、壊れたブロックの検出、
+/// 圧縮中にwriteBlocksが例外を投げた場合の後始末を確認します。
+/// 読み込んだ内容が一致しない場合は終了コード1で終了します。
+///
+/// 使い方 : BlockCodecBench [データのMiB(既定 32)] [作業ディレクトリ(既定 /tmp)]
+
+#include "base/TranslatorBase.hpp"
+#include "io/BlockStream.hpp"
+#include "util/Logger.hpp"
+#include <MockHost.hpp>
+#include <maya/MFnPlugin.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<uint8_t> * export_data = nullptr;	///< 書き出す内容
+bool fail_export = false;							///< trueの場合、writeBlocksは書き込んだ後に例外を投げる
+std::vector<uint8_t> imported;						///< 読み込んだ内容
+
+/// @brief export_dataをそのまま書き出し、importedへ読み込むトランスレーター
+template <bool Parallel>
+class BlocksTranslator : public mpb::TranslatorBase {
+public:
+	static constexpr mpb::TranslatorInfo kTranslatorInfo{ Parallel ? "mpbBenchBlocks" : "mpbBenchBlocksSerial", "mpbz", true, true };
+
+	BlocksTranslator(void) : TranslatorBase(kTranslatorInfo) {}
+	static void * create(void) { return new BlocksTranslator; }
+
+protected:
+	virtual WriteMode writeMode(void) const override { return WriteMode::kBlocks; }
+	virtual ReadMode readMode(void) const override { return ReadMode::kBlocks; }
+	virtual bool parallelSections(void) const override { return Parallel; }
+
+	virtual void writeBlocks(mpb::BlockOutputStream & out, const MString &, MPxFileTranslator::FileAccessMode) override {
+		out.writeValue<uint64_t>(export_data->size());
+		out.write(export_data->data(), export_data->size());
+		if (fail_export) throw mpb::MStatusException(MStatus::kFailure, "書き出しの途中で失敗しました");
+	}
+
+	virtual void readBlocks(mpb::BlockInputStream & in, const MString &, MPxFileTranslator::FileAccessMode) override {
+		imported.resize(static_cast<size_t>(in.readValue<uint64_t>()));
+		in.readExact(imported.data(), imported.size());
+		if (!in.eof()) throw mpb::MStatusException(MStatus::kInvalidParameter, "末尾に余分なデータがあります");
+	}
+};
+
+template <bool Parallel> constexpr mpb::TranslatorInfo BlocksTranslator<Parallel>::kTranslatorInfo;
+
+std::vector<uint8_t> floatData(const size_t size)
+{
+	// 滑らかに変形したグリッドの座標（SoA）
+	std::vector<float> values(size / sizeof(float));
+	const size_t n = values.size() / 3;
+	for (size_t i = 0; i < n; ++i) {
+		values[i] = static_cast<float>((i % 1000) * 0.01);
+		values[n + i] = static_cast<float>(std::sin(i * 0.0005) * 3.0);
+		values[2 * n + i] = static_cast<float>((i / 1000) * 0.01);
+	}
+	std::vector<uint8_t> bytes(size);
+	std::memcpy(bytes.data(), values.data(), values.size() * sizeof(float));
+	return bytes;
+}
+
+std::vector<uint8_t> textData(const size_t size)
+{
+	std::string text;
+	text.reserve(size + 64);
+	char line[96];
+	for (size_t i = 0; text.size() < size; ++i) {
+		std::snprintf(line, sizeof(line), "v %.4f %.4f %.4f\n", (i % 1000) * 0.01, std::sin(i * 0.0005) * 3.0, (i / 1000) * 0.01);
+		text += line;
+	}
+	return std::vector<uint8_t>(text.begin(), text.begin() + size);
+}
+
+std::vector<uint8_t> randomData(const size_t size)
+{
+	std::vector<uint8_t> bytes(size);
+	std::mt19937_64 rng(42);
+	for (size_t i = 0; i + 8 <= size; i += 8) {
+		const uint64_t v = rng();
+		std::memcpy(bytes.data() + i, &v, 8);
+	}
+	return bytes;
+}
+
+double seconds(const std::chrono::steady_clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+double mbPerSecond(const size_t bytes, const double s) { return bytes / (1024.0 * 1024.0) / s; }
+
+/// @brief BlockCodecを直接使い、1スレッドでの圧縮・展開を測る。往復が一致しなければfalse
+bool measureCodec(const std::vector<uint8_t> & data, const mpb::BlockCodecOptions & options, double & ratio, double & enc, double & dec)
+{
+	const size_t block_size = options.block_size;
+	std::vector<uint8_t> shuffled(block_size), packed(mpb::BlockCodec::compressBound(block_size)), restored(block_size), unshuffled(block_size);
+	std::vector<size_t> sizes;
+	std::vector<std::vector<uint8_t>> blocks;
+	size_t total = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t offset = 0; offset < data.size(); offset += block_size) {
+		const size_t n = std::min(block_size, data.size() - offset);
+		const uint8_t * src = data.data() + offset;
+		if (options.shuffle > 1) {
+			mpb::BlockCodec::shuffle(src, n, options.shuffle, shuffled.data());
+			src = shuffled.data();
+		}
+		const size_t stored = mpb::BlockCodec::compress(options.codec, src, n, packed.data());
+		blocks.emplace_back(packed.begin(), packed.begin() + stored);
+		sizes.push_back(n);
+		total += stored;
+	}
+	enc = mbPerSecond(data.size(), seconds(std::chrono::steady_clock::now() - start));
+	ratio = static_cast<double>(data.size()) / total;
+
+	bool ok = true;
+	const auto dec_start = std::chrono::steady_clock::now();
+	size_t offset = 0;
+	for (size_t i = 0; i < blocks.size(); ++i) {
+		mpb::BlockCodec::decompress(options.codec, blocks[i].data(), blocks[i].size(), restored.data(), sizes[i]);
+		const uint8_t * out = restored.data();
+		if (options.shuffle > 1) {
+			mpb::BlockCodec::unshuffle(restored.data(), sizes[i], options.shuffle, unshuffled.data());
+			out = unshuffled.data();
+		}
+		ok = ok && std::memcmp(out, data.data() + offset, sizes[i]) == 0;
+		offset += sizes[i];
+	}
+	dec = mbPerSecond(data.size(), seconds(std::chrono::steady_clock::now() - dec_start));
+	return ok;
+}
+
+double measureExport(const char * translator, const std::string & path, const MString & options, int & failures)
+{
+	const auto start = std::chrono::steady_clock::now();
+	if (mpbmock::exportFile(translator, path.c_str(), options).error()) {
+		std::printf("FAILED : export with %s (%s)\n", translator, options.asChar());
+		++failures;
+	}
+	return seconds(std::chrono::steady_clock::now() - start);
+}
+
+size_t fileSize(const std::string & path)
+{
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	return static_cast<size_t>(in.tellg());
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+	const size_t size = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32) << 20;
+	const std::string dir = (argc > 2 ? argv[2] : "/tmp");
+	const std::string path = dir + "/mpbBlockCodecBench.mpbz";
+	int failures = 0;
+
+	mpbmock::PluginScope scope;
+	{
+		MObject object;
+		MFnPlugin plugin(object);
+		plugin.registerFileTranslator(BlocksTranslator<true>::kTranslatorInfo.name, nullptr, &BlocksTranslator<true>::create);
+		plugin.registerFileTranslator(BlocksTranslator<false>::kTranslatorInfo.name, nullptr, &BlocksTranslator<false>::create);
+	}
+
+	struct Dataset { const char * name; std::vector<uint8_t> bytes; };
+	const Dataset datasets[] = { { "float", floatData(size) }, { "text", textData(size) }, { "random", randomData(size) } };
+	const char * const configs[] = { "codec=none", "codec=fast", "codec=fast;shuffle=4", "codec=high", "codec=high;shuffle=4" };
+
+	std::printf("%zu MiB per dataset, %zu threads\n", size >> 20, mpb::ThreadPool::global().concurrency());
+	std::printf("%-7s %-22s %7s %9s %9s %9s %9s %9s\n", "data", "options", "ratio", "enc_MB/s", "dec_MB/s", "export", "import", "serial");
+	for (const Dataset & dataset : datasets) {
+		export_data = &dataset.bytes;
+		for (const char * config : configs) {
+			const mpb::BlockCodecOptions options = mpb::BlockCodecOptions::parse(config);
+			double ratio = 0.0, enc = 0.0, dec = 0.0;
+			if (!measureCodec(dataset.bytes, options, ratio, enc, dec)) {
+				std::printf("FAILED : %s %s round trip\n", dataset.name, config);
+				++failures;
+			}
+
+			const double export_s = measureExport(BlocksTranslator<true>::kTranslatorInfo.name, path, config, failures);
+			const double file_ratio = static_cast<double>(dataset.bytes.size()) / fileSize(path);
+			imported.clear();
+			const auto start = std::chrono::steady_clock::now();
+			if (mpbmock::importFile(BlocksTranslator<true>::kTranslatorInfo.name, path.c_str()).error() || imported != dataset.bytes) {
+				std::printf("FAILED : %s %s import\n", dataset.name, config);
+				++failures;
+			}
+			const double import_s = seconds(std::chrono::steady_clock::now() - start);
+			const double serial_s = measureExport(BlocksTranslator<false>::kTranslatorInfo.name, path, config, failures);
+
+			std::printf("%-7s %-22s %7.2f %9.1f %9.1f %9.1f %9.1f %9.1f\n", dataset.name, config, (options.codec == mpb::BlockCodecType::kNone ? file_ratio : ratio),
+				enc, dec, mbPerSecond(dataset.bytes.size(), export_s), mbPerSecond(dataset.bytes.size(), import_s), mbPerSecond(dataset.bytes.size(), serial_s));
+		}
+	}
+
+	// ランダムアクセス。各読み込みが1～2ブロックの展開で済むこと
+	{
+		export_data = &datasets[0].bytes;
+		measureExport(BlocksTranslator<true>::kTranslatorInfo.name, path, "codec=fast;shuffle=4", failures);
+		std::ifstream in(path, std::ios::binary);
+		const std::vector<char> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		const mpb::BlockInputStream stream(mpb::ByteSpan(reinterpret_cast<const uint8_t *>(file.data()), file.size()), nullptr);
+		std::mt19937_64 rng(7);
+		std::vector<uint8_t> dest(4096);
+		const size_t reads = 2000;
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < reads; ++i) {
+			const uint64_t offset = 8 + rng() % (export_data->size() - dest.size());
+			stream.readAt(offset, dest.data(), dest.size());
+			if (std::memcmp(dest.data(), export_data->data() + (offset - 8), dest.size()) != 0) {
+				std::printf("FAILED : readAt(%llu)\n", static_cast<unsigned long long>(offset));
+				++failures;
+				break;
+			}
+		}
+		std::printf("readAt 4KiB (fast, shuffle=4) : %.1f us/read, %zu blocks of %u bytes\n", seconds(std::chrono::steady_clock::now() - start) * 1e6 / reads, stream.blockCount(), stream.blockSize());
+	}
+
+	// 端のサイズ・周期的なデータの往復
+	{
+		const size_t sizes[] = { 0, 1, 5, 12, 13, 64, 4095, 65536 + 17, 300000 };
+		std::mt19937 rng(3);
+		for (const size_t n : sizes) {
+			std::vector<uint8_t> src(n);
+			for (size_t i = 0; i < n; ++i) src[i] = static_cast<uint8_t>(i % 3 == 0 ? rng() : i / 7);
+			for (const mpb::BlockCodecType codec : { mpb::BlockCodecType::kFast, mpb::BlockCodecType::kHigh }) {
+				std::vector<uint8_t> packed(mpb::BlockCodec::compressBound(n)), out(n);
+				const size_t stored = mpb::BlockCodec::compress(codec, src.data(), n, packed.data());
+				try {
+					mpb::BlockCodec::decompress(codec, packed.data(), stored, out.data(), n);
+					if (out != src) throw mpb::MStatusException(MStatus::kFailure, "mismatch");
+				}
+				catch (const mpb::MStatusException &) {
+					std::printf("FAILED : %s round trip of %zu bytes\n", mpb::BlockCodec::name(codec), n);
+					++failures;
+				}
+			}
+		}
+	}
+
+	// 壊れたブロックは例外になること
+	{
+		export_data = &datasets[1].bytes;
+		measureExport(BlocksTranslator<true>::kTranslatorInfo.name, path, "codec=high", failures);
+		std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(1000);
+		file.put('\xff');
+		file.put('\x7f');
+		file.close();
+		std::streambuf * const cerr_buf = std::cerr.rdbuf(nullptr);
+		const bool rejected = mpbmock::importFile(BlocksTranslator<true>::kTranslatorInfo.name, path.c_str()).error();
+		mpb::Logger::flush();
+		std::cerr.rdbuf(cerr_buf);
+		if (!rejected) {
+			std::printf("FAILED : corrupted block was accepted\n");
+			++failures;
+		}
+	}
+	// 圧縮中のブロックが残ったままwriteBlocksが例外を投げても、エラーになるだけで落ちないこと
+	{
+		export_data = &datasets[2].bytes;
+		fail_export = true;
+		std::streambuf * const cerr_buf = std::cerr.rdbuf(nullptr);
+		for (int i = 0; i < 8; ++i) {
+			if (!mpbmock::exportFile(BlocksTranslator<true>::kTranslatorInfo.name, path.c_str(), "codec=high;shuffle=4").error()) {
+				std::printf("FAILED : exception from writeBlocks was not reported\n");
+				++failures;
+				break;
+			}
+		}
+		mpb::Logger::flush();
+		std::cerr.rdbuf(cerr_buf);
+		fail_export = false;
+
+		// 1コアの環境ではグローバルのプールにワーカーがなく圧縮がその場で終わるため、ワーカーを持つプールでも同じ経路を通す
+		mpb::ThreadPool pool(2);
+		for (int i = 0; i < 8; ++i) {
+			try {
+				mpb::ChunkedOutputStream out(path.c_str());
+				mpb::BlockOutputStream blocks(out, mpb::BlockCodecOptions::parse("codec=high;shuffle=4"), &pool);
+				blocks.write(export_data->data(), export_data->size());
+				throw mpb::MStatusException(MStatus::kFailure, "書き出しの途中で失敗しました");
+			}
+			catch (const mpb::MStatusException &) {}
+		}
+	}
+	std::remove(path.c_str());
+
+	if (failures) return 1;
+	std::printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,208 @@
+﻿/// @file CommandArgsBench.cpp
+/// @brief SchemaCommandの引数解析の検証とベンチマーク
+///
+/// 同じ引数（重みの配列・複数回の点・スイッチ・オブジェクト名）を受け取るコマンドを2通りに実装し、
+/// 1回の呼び出しあたりの解析時間とoperator newの回数を比較します。
+///
+/// - hand-parsed : MArgListを1つずつasString/asDoubleで読み、MDoubleArrayへappendする従来の書き方
+/// - schema : SchemaCommandのkSchemaによる解析
+///
+/// 配列はMELの形（要素数＋要素）と、APIから渡す配列の形の両方で測ります。
+/// MELの形では要素が個別の引数のため、どちらの実装も要素ごとにMArgListを読みます。差は一時配列とappendの分だけです。
+/// 結果が一致しない場合、不正な引数でdoItParsedが呼ばれた場合は終了コード1で終了します。
+///
+/// 使い方 : CommandArgsBench [配列の要素数(既定 100000)] [回数(既定 20)]
+
+#include "base/SchemaCommand.hpp"
+#include <maya/MArgList.h>
+#include <maya/MDoubleArray.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+namespace {
+
+std::atomic<size_t> g_allocations(0);
+
+/// @brief 解析結果の要約。2通りの実装で一致することを確認する
+struct Summary {
+	double weight_sum = 0.0;
+	double point_sum = 0.0;
+	size_t weights = 0;
+	size_t points = 0;
+	bool verbose = false;
+	MString name;
+	size_t bodies = 0;	///< 本体が実行された回数
+
+	bool operator==(const Summary & o) const {
+		return weight_sum == o.weight_sum && point_sum == o.point_sum && weights == o.weights && points == o.points && verbose == o.verbose && name == o.name;
+	}
+};
+Summary g_summary;
+
+/// @brief 従来の書き方
+class HandParsedCommand : public mpb::CommandBase {
+public:
+	HandParsedCommand(void) noexcept : CommandBase("mpbBenchHandParsed", false) {}
+
+	virtual MStatus doIt(const MArgList & args) override {
+		MDoubleArray weights;
+		MDoubleArray points;
+		bool verbose = false;
+		MString name;
+		try {
+			for (unsigned int i = 0; i < args.length(); ++i) {
+				MStatus stat;
+				const MString flag = args.asString(i, &stat);
+				mpb::MStatusException::throwIf(stat, "引数の取得に失敗", "HandParsedCommand::doIt");
+				if (flag == "-w" || flag == "-weights") {
+					++i;
+					MDoubleArray values = args.asDoubleArray(i, &stat);
+					mpb::MStatusException::throwIf(stat, "-weightsの値が不正", "HandParsedCommand::doIt");
+					--i;
+					for (unsigned int k = 0; k < values.length(); ++k) weights.append(values[k]);
+				}
+				else if (flag == "-p" || flag == "-point") {
+					for (int k = 0; k < 3; ++k) {
+						const double v = args.asDouble(++i, &stat);
+						mpb::MStatusException::throwIf(stat, "-pointの値が不正", "HandParsedCommand::doIt");
+						points.append(v);
+					}
+				}
+				else if (flag == "-v" || flag == "-verbose") verbose = true;
+				else if (flag.asChar()[0] == '-') mpb::MStatusException::throwError(MStatus::kInvalidParameter, "不明なフラグ : " + flag, "HandParsedCommand::doIt");
+				else name = flag;
+			}
+		}
+		catch (const mpb::MStatusException & e) {
+			return e.stat;
+		}
+
+		Summary s;
+		for (unsigned int k = 0; k < weights.length(); ++k) s.weight_sum += weights[k];
+		for (unsigned int k = 0; k < points.length(); ++k) s.point_sum += points[k];
+		s.weights = weights.length();
+		s.points = points.length() / 3;
+		s.verbose = verbose;
+		s.name = name;
+		s.bodies = g_summary.bodies + 1;
+		g_summary = s;
+		return MStatus::kSuccess;
+	}
+};
+
+/// @brief スキーマによる解析
+class SchemaParsedCommand : public mpb::SchemaCommand<SchemaParsedCommand> {
+public:
+	enum : size_t { kWeights, kPoint, kVerbose };
+	static constexpr mpb::CommandSchema<3> kSchema{
+		{ {
+			mpb::doubleArrayFlag("weights", "w"),
+			mpb::doubleFlag("point", "p", 0.0, 3, true),
+			mpb::switchFlag("verbose", "v"),
+		} },
+		0, 1
+	};
+
+	SchemaParsedCommand(void) noexcept : SchemaCommand("mpbBenchSchemaParsed", false) {}
+
+protected:
+	virtual MStatus doItParsed(const mpb::CommandArgs & args) override {
+		const mpb::ConstSpan<double> weights = this->flagValue<kWeights>();
+		const mpb::ConstSpan<double> points = args.doubles(kPoint);
+
+		Summary s;
+		for (const double w : weights) s.weight_sum += w;
+		for (const double p : points) s.point_sum += p;
+		s.weights = weights.size();
+		s.points = args.uses(kPoint);
+		s.verbose = this->flagValue<kVerbose>();
+		if (args.positionalCount() > 0) s.name = args.positional(0);
+		s.bodies = g_summary.bodies + 1;
+		g_summary = s;
+		return MStatus::kSuccess;
+	}
+};
+constexpr mpb::CommandSchema<3> SchemaParsedCommand::kSchema;
+
+/// @brief 引数を組み立てる
+MArgList makeArgs(const size_t n, const bool mel_form) {
+	MArgList args;
+	args.addArg("pCube1");
+	args.addArg("-v");
+	args.addArg("-weights");
+	if (mel_form) {
+		args.addArg(static_cast<int>(n));
+		for (size_t k = 0; k < n; ++k) args.addArg(std::sin(static_cast<double>(k)));
+	}
+	else {
+		MDoubleArray values(static_cast<unsigned int>(n));
+		for (size_t k = 0; k < n; ++k) values[static_cast<unsigned int>(k)] = std::sin(static_cast<double>(k));
+		args.addArg(values);
+	}
+	for (int p = 0; p < 8; ++p) {
+		args.addArg("-p");
+		for (int k = 0; k < 3; ++k) args.addArg(0.5 * (p * 3 + k));
+	}
+	return args;
+}
+
+template <class Command>
+Summary measure(const char * label, const MArgList & args, const size_t n, const int repeat, bool & ok) {
+	const size_t alloc_before = g_allocations.load();
+	const auto t0 = std::chrono::steady_clock::now();
+	for (int r = 0; r < repeat; ++r) {
+		Command command;
+		ok = (command.doIt(args) == MStatus::kSuccess) && ok;
+	}
+	const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / repeat;
+	const double allocs = static_cast<double>(g_allocations.load() - alloc_before) / repeat;
+	std::printf("%-28s %12.1f us/call %8.2f ns/element %10.1f allocs/call\n", label, ns / 1000.0, ns / static_cast<double>(n), allocs);
+	return g_summary;
+}
+
+}
+
+void * operator new(size_t size) {
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void * p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void * p) noexcept { std::free(p); }
+void operator delete(void * p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char ** argv) {
+	const size_t n = (argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 100000);
+	const int repeat = (argc > 2 ? std::atoi(argv[2]) : 20);
+	if (n == 0 || repeat <= 0) {
+		std::fprintf(stderr, "usage : %s [elements] [repeat]\n", argv[0]);
+		return 1;
+	}
+
+	bool ok = true;
+	for (const bool mel_form : { true, false }) {
+		const MArgList args = makeArgs(n, mel_form);
+		std::printf("%s\n", mel_form ? "MEL form (count + elements)" : "array argument");
+		const Summary hand = measure<HandParsedCommand>("  hand-parsed", args, n, repeat, ok);
+		const Summary schema = measure<SchemaParsedCommand>("  schema", args, n, repeat, ok);
+		ok = ok && (hand == schema) && schema.weights == n && schema.points == 8 && schema.verbose;
+	}
+
+	// 不正な引数は本体の前に失敗する
+	const char * const invalid[][3] = { { "-unknown", "", "" }, { "-v", "-v", "" }, { "-p", "1", "x" }, { "a", "b", "" } };
+	const size_t bodies = g_summary.bodies;
+	for (const auto & tokens : invalid) {
+		MArgList args;
+		for (const char * t : tokens) if (t[0] != '\0') args.addArg(t);
+		SchemaParsedCommand command;
+		ok = (command.doIt(args) != MStatus::kSuccess) && ok;
+	}
+	ok = ok && (g_summary.bodies == bodies);
+
+	if (!ok) std::printf("NG : parse result mismatch\n");
+	return ok ? 0 : 1;
+}
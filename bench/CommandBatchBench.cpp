@@ -0,0 +1,144 @@
+﻿/// @file CommandBatchBench.cpp
+/// @brief BatchCommandBaseの検証とベンチマーク
+///
+/// 値の表を書き換えるundo可能なコマンドを登録し、N回のコマンド呼び出し（スクリプトのループ相当）と、
+/// -batchによる1回の呼び出しとで、1件あたりの時間を比較します。
+/// ヘッドレスのホストではコマンドの呼び出しコストがMayaより小さいため、差は実際より小さく出ます。
+/// バッチのundo/redoの結果が正しくない場合は終了コード1で終了します。
+///
+/// 使い方 : CommandBatchBench [件数(既定 100000)]
+
+#include "base/BatchCommandBase.hpp"
+#include <MockHost.hpp>
+#include <maya/MArgList.h>
+#include <maya/MFnPlugin.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<double> g_table;
+
+/// @brief 「番号 値」で表の1要素を書き換えるコマンド
+class SetValueCommand : public mpb::BatchCommandBase {
+public:
+	SetValueCommand(void) noexcept : BatchCommandBase("mpbBenchSetValue", true) {}
+	static void * create(void) { return new SetValueCommand; }
+
+protected:
+	virtual void doItem(const mpb::BatchArgs & args, mpb::BatchRecord & record) override {
+		const int index = args.asInt(0);
+		const double value = args.asDouble(1);
+		if (index < 0 || static_cast<size_t>(index) >= g_table.size()) mpb::MStatusException::throwError(MStatus::kInvalidParameter, "番号が範囲外です", "SetValueCommand::doItem");
+		record.write(index);
+		record.write(g_table[index]);
+		record.write(value);
+		g_table[index] = value;
+	}
+
+	virtual void undoItem(mpb::BatchRecord::Reader & record) override {
+		const int index = record.read<int>();
+		g_table[index] = record.read<double>();
+	}
+
+	virtual void redoItem(mpb::BatchRecord::Reader & record) override {
+		const int index = record.read<int>();
+		record.read<double>();
+		g_table[index] = record.read<double>();
+	}
+};
+
+double elapsedNs(const std::chrono::steady_clock::time_point & t0) {
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count();
+}
+
+}
+
+int main(int argc, char ** argv) {
+	const size_t n = (argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 100000);
+	if (n == 0) {
+		std::fprintf(stderr, "usage : %s [count]\n", argv[0]);
+		return 1;
+	}
+
+	mpbmock::PluginScope scope;
+	{
+		MObject object;
+		MFnPlugin plugin(object);
+		plugin.registerCommand("mpbBenchSetValue", &SetValueCommand::create);
+	}
+
+	std::vector<std::string> values(n);
+	for (size_t i = 0; i < n; ++i) values[i] = std::to_string(0.5 * static_cast<double>(i));
+
+	// 1件ずつ呼び出す。undoキューの代わりにインスタンスを保持する
+	g_table.assign(n, -1.0);
+	std::vector<std::unique_ptr<MPxCommand>> history;
+	history.reserve(n);
+	auto t0 = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < n; ++i) {
+		MArgList args;
+		args.addArg(MString(std::to_string(i).c_str()));
+		args.addArg(MString(values[i].c_str()));
+		std::unique_ptr<MPxCommand> instance;
+		if (mpbmock::executeCommand("mpbBenchSetValue", args, nullptr, &instance) != MStatus::kSuccess) return 1;
+		history.push_back(std::move(instance));
+	}
+	const double loop_ns = elapsedNs(t0);
+	history.clear();
+
+	// 同じ内容を-batchで1回の呼び出しにする
+	std::string buffer;
+	for (size_t i = 0; i < n; ++i) {
+		buffer += std::to_string(i);
+		buffer += ' ';
+		buffer += values[i];
+		buffer += '\n';
+	}
+	g_table.assign(n, -1.0);
+	std::unique_ptr<MPxCommand> batch;
+	t0 = std::chrono::steady_clock::now();
+	{
+		MArgList args;
+		args.addArg(MString("-batch"));
+		args.addArg(MString(buffer.c_str()));
+		if (mpbmock::executeCommand("mpbBenchSetValue", args, nullptr, &batch) != MStatus::kSuccess) return 1;
+	}
+	const double batch_ns = elapsedNs(t0);
+
+	bool ok = (static_cast<mpb::BatchCommandBase *>(batch.get())->itemCount() == n);
+	for (size_t i = 0; i < n && ok; ++i) ok = (g_table[i] == 0.5 * static_cast<double>(i));
+
+	t0 = std::chrono::steady_clock::now();
+	ok = ok && (batch->undoIt() == MStatus::kSuccess);
+	const double undo_ns = elapsedNs(t0);
+	ok = ok && std::all_of(g_table.begin(), g_table.end(), [](const double v) { return v == -1.0; });
+
+	t0 = std::chrono::steady_clock::now();
+	ok = ok && (batch->redoIt() == MStatus::kSuccess);
+	const double redo_ns = elapsedNs(t0);
+	for (size_t i = 0; i < n && ok; ++i) ok = (g_table[i] == 0.5 * static_cast<double>(i));
+
+	// 途中で失敗したバッチは実行済みの件が取り消される
+	g_table.assign(n, -1.0);
+	{
+		MArgList args;
+		args.addArg(MString("-batch"));
+		args.addArg(MString("0 1.0; 1 2.0; 99999999999 3.0"));
+		ok = ok && (mpbmock::executeCommand("mpbBenchSetValue", args) != MStatus::kSuccess);
+		ok = ok && g_table[0] == -1.0 && g_table[1] == -1.0;
+	}
+
+	std::printf("%-22s %10s %12s\n", "mode", "items", "ns/item");
+	std::printf("%-22s %10zu %12.1f\n", "loop of calls", n, loop_ns / static_cast<double>(n));
+	std::printf("%-22s %10zu %12.1f  x%.2f\n", "single -batch call", n, batch_ns / static_cast<double>(n), loop_ns / batch_ns);
+	std::printf("%-22s %10zu %12.1f\n", "batch undo", n, undo_ns / static_cast<double>(n));
+	std::printf("%-22s %10zu %12.1f\n", "batch redo", n, redo_ns / static_cast<double>(n));
+	if (!ok) std::printf("NG : batch result mismatch\n");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+﻿/// @file ErrorAggregatorBench.cpp
+/// @brief computeProcessの例外の集計の検証とベンチマーク
+///
+/// 毎回例外を送出する壊れたノードを多数生成し、フレームごとに全ノードを評価したときの失敗1回あたりのコストを測ります。
+/// 例外の送出・捕捉のコストは共通なので、報告部分だけを次の書き方で比較します。
+///
+/// - std::cerr : 従来の std::cerr << e.toString("NODE : " + name) << std::endl（/dev/nullへの書き込み）
+/// - logger : e.toString を整形してMPB_LOG_ERRORへ渡す（流量制限なし）
+/// - aggregator : ErrorAggregator::record。ノードごとに前回の集計先をヒントとして持つ
+/// - aggregator (no hint) : ヒントなし。毎回集計表を引く
+///
+/// 集計した回数が評価回数と一致すること、mpbComputeProfiler -errorsで取得できることを確認します。
+/// 一致しない場合は終了コード1で終了します。
+///
+/// 使い方 : ErrorAggregatorBench [ノード数(既定 5000)] [フレーム数(既定 20)]
+
+#include "base/NodeBase.hpp"
+#include "util/ErrorAggregator.hpp"
+#include "util/Logger.hpp"
+#include <MockHost.hpp>
+#include <maya/MFnPlugin.h>
+#include <maya/MFnNumericAttribute.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+/// @brief 常に失敗するノード
+class BrokenNode : public mpb::NodeBase {
+public:
+	static MObject input_, output_;
+
+	BrokenNode(void) : NodeBase(0x70180, "mpbBenchBroken") {}
+	static void * create(void) { return new BrokenNode; }
+
+	static MStatus initialize(void) {
+		try {
+			addNumericAttr(input_, "input", "i", AttributeOptions(), MFnNumericData::kDouble, 0.0);
+			addNumericAttr(output_, "output", "o", AttributeOptions(true, false, true, false, false), MFnNumericData::kDouble, 0.0);
+			setMultiAttributeAffects({ &input_ }, { &output_ });
+		}
+		catch (const mpb::MStatusException & e) {
+			return e.stat;
+		}
+		return MStatus::kSuccess;
+	}
+
+protected:
+	virtual void computeProcess(const MPlug &, MDataBlock &) override {
+		throw mpb::MStatusException(MStatus::kInvalidParameter, "入力メッシュが接続されていません", MPB_EXCEPTION_PLACE);
+	}
+};
+
+MObject BrokenNode::input_;
+MObject BrokenNode::output_;
+
+double nsPerCall(const std::chrono::steady_clock::duration elapsed, const size_t calls)
+{
+	return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(calls);
+}
+
+/// @brief 報告部分だけを、ノード数×フレーム数回繰り返す
+template <class Report>
+double measureReport(const size_t num_nodes, const size_t frames, Report && report)
+{
+	const mpb::MStatusException e(MStatus::kInvalidParameter, "入力メッシュが接続されていません", MPB_EXCEPTION_PLACE);
+	const auto start = std::chrono::steady_clock::now();
+	for (size_t f = 0; f < frames; ++f) {
+		for (size_t n = 0; n < num_nodes; ++n) report(n, e);
+	}
+	return nsPerCall(std::chrono::steady_clock::now() - start, num_nodes * frames);
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+	const size_t num_nodes = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000);
+	const size_t frames = (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20);
+	int failures = 0;
+
+	mpbmock::PluginScope scope;
+	{
+		MObject object;
+		MFnPlugin plugin(object);
+		plugin.registerNode("mpbBenchBroken", 0x70180, &BrokenNode::create, &BrokenNode::initialize);
+	}
+
+	// ログは捨てる。件数はLogger::statsで見る
+	std::ofstream null_stream("/dev/null");
+	std::streambuf * const cout_buf = std::cout.rdbuf(null_stream.rdbuf());
+	std::streambuf * const cerr_buf = std::cerr.rdbuf(null_stream.rdbuf());
+	mpb::ErrorAggregator::setReportInterval(1);
+
+	std::printf("%zu nodes x %zu frames\n", num_nodes, frames);
+	std::printf("%-22s %12s\n", "report", "ns/failure");
+
+	const MString node_type("mpbBenchBroken");
+	{
+		const double ns = measureReport(num_nodes, frames, [&node_type](size_t, const mpb::MStatusException & e) {
+			std::cerr << e.toString("NODE : " + node_type) << std::endl;
+		});
+		std::printf("%-22s %12.2f\n", "std::cerr", ns);
+	}
+	{
+		mpb::Logger::setRateLimit(0);
+		const double ns = measureReport(num_nodes, frames, [&node_type](size_t, const mpb::MStatusException & e) {
+			MPB_LOG_ERROR("%s", e.toString("NODE : " + node_type).asChar());
+		});
+		mpb::Logger::setRateLimit(10);
+		std::printf("%-22s %12.2f\n", "logger", ns);
+	}
+	{
+		std::unique_ptr<std::atomic<mpb::ErrorBucket *>[]> hints(new std::atomic<mpb::ErrorBucket *>[num_nodes]);
+		for (size_t n = 0; n < num_nodes; ++n) hints[n].store(nullptr);
+		const double ns = measureReport(num_nodes, frames, [&node_type, &hints](size_t n, const mpb::MStatusException & e) {
+			mpb::ErrorAggregator::record("NODE", node_type, e, &hints[n]);
+		});
+		std::printf("%-22s %12.2f\n", "aggregator", ns);
+	}
+	{
+		const double ns = measureReport(num_nodes, frames, [&node_type](size_t, const mpb::MStatusException & e) {
+			mpb::ErrorAggregator::record("NODE", node_type, e);
+		});
+		std::printf("%-22s %12.2f\n", "aggregator (no hint)", ns);
+	}
+
+	// 実際のノードのcompute。例外の送出・捕捉を含む
+	mpb::ErrorAggregator::reset();
+	{
+		std::vector<std::unique_ptr<mpbmock::Node>> nodes;
+		nodes.reserve(num_nodes);
+		for (size_t n = 0; n < num_nodes; ++n) nodes.emplace_back(new mpbmock::Node("mpbBenchBroken"));
+
+		const auto logged_before = mpb::Logger::stats();
+		size_t failed = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t f = 0; f < frames; ++f) {
+			for (auto & node : nodes) {
+				node->dirty("input");
+				if (node->compute("output").error()) ++failed;
+			}
+		}
+		const double ns = nsPerCall(std::chrono::steady_clock::now() - start, num_nodes * frames);
+		const auto logged_after = mpb::Logger::stats();
+		std::printf("%-22s %12.2f  (log records %llu)\n", "compute (aggregated)", ns,
+			static_cast<unsigned long long>((logged_after.written + logged_after.dropped + logged_after.suppressed) - (logged_before.written + logged_before.dropped + logged_before.suppressed)));
+
+		const auto entries = mpb::ErrorAggregator::snapshot();
+		const uint64_t counted = (entries.size() == 1 ? entries[0].count : 0);
+		if (failed != num_nodes * frames || counted != failed) {
+			std::printf("FAILED : %zu failures, %llu counted in %zu entries\n", failed, static_cast<unsigned long long>(counted), entries.size());
+			++failures;
+		}
+	}
+
+	MString result;
+	MArgList args;
+	args.addArg(MString("-errors"));
+	args.addArg(MString("-json"));
+	if (mpbmock::executeCommand("mpbComputeProfiler", args, &result).error() || std::string(result.asChar()).find("\"count\":" + std::to_string(num_nodes * frames)) == std::string::npos) {
+		std::printf("FAILED : mpbComputeProfiler -errors -json returned %s\n", result.asChar());
+		++failures;
+	}
+	else {
+		std::printf("%s\n", result.asChar());
+	}
+
+	mpb::Logger::flush();
+	std::cout.rdbuf(cout_buf);
+	std::cerr.rdbuf(cerr_buf);
+
+	if (failures) return 1;
+	std::printf("OK\n");
+	return 0;
+}
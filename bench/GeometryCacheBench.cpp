@@ -0,0 +1,228 @@
+﻿/// @file GeometryCacheBench.cpp
+/// @brief ジオメトリキャッシュの検証とベンチマーク
+///
+/// 合成した変形メッシュ（点と法線）をGeometryCacheTranslatorで書き出し、次を測ります。
+///
+/// - export : 書き出しの所要時間とスループット、ファイルサイズ（float / q16）
+/// - scrub : ランダムな順にフレームを読んだときの1フレームあたりの時間とページフォルト数
+/// - playback : 先頭から順に読んだときの1フレームあたりの時間
+/// - node : mpbGeometryCacheReaderノードのtimeを変えてoutPointsを評価したときの1フレームあたりの時間
+///
+/// 各フレームのブロックがページ境界から始まり、そのフレームのページ数だけで読めること、
+/// 読み出した値が書き出した値と一致すること（q16は量子化誤差の上限以内）、壊れたファイルを拒否することを確認します。
+/// 確認に失敗した場合は終了コード1で終了します。
+///
+/// 使い方 : GeometryCacheBench [点の数(既定 100000)] [フレーム数(既定 200)] [作業ディレクトリ(既定 /tmp)]
+
+#include "translator/GeometryCacheTranslator.hpp"
+#include "node/GeometryCacheNode.hpp"
+#include <MockHost.hpp>
+#include <maya/MFnPlugin.h>
+#include <maya/MFnPointArrayData.h>
+#include <maya/MPointArray.h>
+#include <maya/MTime.h>
+#include <sys/resource.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+size_t num_points = 100000;
+
+/// @brief フレームごとに決まる合成ジオメトリ
+void synthesize(const double frame, mpb::SoaBuffer3<float> & points, mpb::SoaBuffer3<float> & normals)
+{
+	points.resize(num_points);
+	normals.resize(num_points);
+	for (size_t i = 0; i < num_points; ++i) {
+		const double a = frame * 0.1 + i * 0.001;
+		points.x[i] = static_cast<float>((i % 1000) * 0.01 + std::sin(a));
+		points.y[i] = static_cast<float>((i / 1000) * 0.01);
+		points.z[i] = static_cast<float>(std::cos(frame * 0.05 + i * 0.002) * 2.0);
+		normals.x[i] = static_cast<float>(std::cos(a));
+		normals.y[i] = static_cast<float>(std::sin(a));
+		normals.z[i] = 0.0f;
+	}
+}
+
+/// @brief 合成ジオメトリを書き出すトランスレーター
+class SyntheticCacheTranslator : public mpb::GeometryCacheTranslator {
+public:
+	static void * create(void) { return new SyntheticCacheTranslator; }
+
+protected:
+	virtual void sampleFrame(const double frame, mpb::SoaBuffer3<float> & points, mpb::SoaBuffer3<float> & normals) override {
+		synthesize(frame, points, normals);
+	}
+};
+
+long minorFaults(void)
+{
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_minflt;
+}
+
+double seconds(const std::chrono::steady_clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+/// @brief 成分ごとの最大誤差。期待値の成分ごとの範囲も返す
+float maxError(const mpb::AlignedBuffer<float> & actual, const mpb::AlignedBuffer<float> & expected, float & range)
+{
+	float err = 0.0f;
+	const auto mm = std::minmax_element(expected.data(), expected.data() + expected.size());
+	range = *mm.second - *mm.first;
+	for (size_t i = 0; i < expected.size(); ++i) err = std::max(err, std::fabs(actual[i] - expected[i]));
+	return err;
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+	num_points = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000);
+	const size_t frames = (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200);
+	const std::string dir = (argc > 3 ? argv[3] : "/tmp");
+	int failures = 0;
+
+	mpbmock::PluginScope scope;
+	{
+		MObject object;
+		MFnPlugin plugin(object);
+		plugin.registerFileTranslator(mpb::GeometryCacheTranslator::kTranslatorInfo.name, nullptr, &SyntheticCacheTranslator::create);
+		plugin.registerNode(mpb::GeometryCacheNode::kNodeInfo.name, mpb::GeometryCacheNode::kNodeInfo.id, &mpb::GeometryCacheNode::create, &mpb::GeometryCacheNode::initialize);
+	}
+
+	std::printf("%zu points x %zu frames\n", num_points, frames);
+	std::printf("%-8s %10s %10s %12s %12s %12s %12s %12s\n", "encoding", "file_MB", "export_s", "export_MB/s", "scrub_us", "faults/frame", "pages/frame", "playback_us");
+
+	const char * const encodings[] = { "float", "q16" };
+	mpb::SoaBuffer3<float> points, normals, expected_points, expected_normals;
+	for (const char * encoding : encodings) {
+		const std::string path = dir + "/mpbGeometryCacheBench_" + encoding + ".mpbgc";
+		const MString options(("start=1;end=" + std::to_string(frames) + ";step=1;encoding=" + encoding + ";normals=1").c_str());
+
+		auto start = std::chrono::steady_clock::now();
+		if (mpbmock::exportFile(mpb::GeometryCacheTranslator::kTranslatorInfo.name, path.c_str(), options).error()) {
+			std::printf("FAILED : export %s\n", path.c_str());
+			++failures;
+			continue;
+		}
+		const double export_s = seconds(std::chrono::steady_clock::now() - start);
+
+		mpb::GeometryCacheReader reader(MString(path.c_str()));
+		const double file_mb = reader.fileSize() / (1024.0 * 1024.0);
+		if (reader.frameCount() != frames || reader.pointCount() != num_points || !reader.hasNormals()) {
+			std::printf("FAILED : %s has %zu frames, %u points\n", encoding, reader.frameCount(), reader.pointCount());
+			++failures;
+		}
+
+		// 各フレームがページ境界から始まり、他のフレームとページを共有しないこと（フレーム0はヘッダーの次のページ）
+		const uint8_t * const base = reader.frameBytes(0).data();
+		const size_t frame_size = reader.frameBytes(0).size();
+		const size_t pages_per_frame = (frame_size + mpb::GeometryCacheFormat::kFrameAlignment - 1) / mpb::GeometryCacheFormat::kFrameAlignment;
+		for (size_t f = 0; f < reader.frameCount(); ++f) {
+			const size_t offset = static_cast<size_t>(reader.frameBytes(f).data() - base);
+			if (offset % mpb::GeometryCacheFormat::kFrameAlignment != 0) {
+				std::printf("FAILED : frame %zu is not page aligned\n", f);
+				++failures;
+				break;
+			}
+		}
+
+		// ランダムな順のスクラブ
+		std::vector<size_t> order(reader.frameCount());
+		for (size_t f = 0; f < order.size(); ++f) order[f] = f;
+		std::shuffle(order.begin(), order.end(), std::mt19937(12345));
+		const long faults_before = minorFaults();
+		start = std::chrono::steady_clock::now();
+		for (const size_t f : order) reader.readFrame(f, &points, &normals);
+		const double scrub_us = seconds(std::chrono::steady_clock::now() - start) * 1e6 / order.size();
+		const double faults = static_cast<double>(minorFaults() - faults_before) / order.size();
+
+		// 先読みしながらの再生
+		start = std::chrono::steady_clock::now();
+		for (size_t f = 0; f < reader.frameCount(); ++f) {
+			reader.readFrame(f, &points, &normals);
+			reader.prefetch(f + 1);
+		}
+		const double playback_us = seconds(std::chrono::steady_clock::now() - start) * 1e6 / reader.frameCount();
+
+		std::printf("%-8s %10.1f %10.3f %12.1f %12.1f %12.1f %12zu %12.1f\n", encoding, file_mb, export_s, file_mb / export_s, scrub_us, faults, pages_per_frame, playback_us);
+
+		// 値の確認。q16は範囲の1/131070（丸め）に単精度の誤差を見込む
+		const bool quantized = (reader.encoding() == mpb::GeometryCacheEncoding::kQuantized16);
+		for (const size_t f : { static_cast<size_t>(0), reader.frameCount() / 2, reader.frameCount() - 1 }) {
+			reader.readFrame(f, &points, &normals);
+			synthesize(reader.startFrame() + f * reader.frameStep(), expected_points, expected_normals);
+			const mpb::AlignedBuffer<float> * const actual[6] = { &points.x, &points.y, &points.z, &normals.x, &normals.y, &normals.z };
+			const mpb::AlignedBuffer<float> * const expected[6] = { &expected_points.x, &expected_points.y, &expected_points.z, &expected_normals.x, &expected_normals.y, &expected_normals.z };
+			for (int c = 0; c < 6; ++c) {
+				float range = 0.0f;
+				const float err = maxError(*actual[c], *expected[c], range);
+				const float bound = (quantized ? (c < 3 ? range : 2.0f) / 131070.0f * 1.01f + 1e-6f : 0.0f);
+				if (err > bound) {
+					std::printf("FAILED : %s frame %zu component %d error %g > %g\n", encoding, f, c, err, bound);
+					++failures;
+				}
+				if (quantized && f == 0 && c == 0) std::printf("%-8s max error %g (range %g, bound %g)\n", encoding, err, range, bound);
+			}
+		}
+
+		// ノード経由のスクラブ。outPointsだけを要求する
+		if (!quantized) {
+			mpbmock::Node node(mpb::GeometryCacheNode::kNodeInfo.name);
+			node.setString("cacheFile", path.c_str());
+			node.setTime("time", MTime(1.0, MTime::uiUnit()));
+			node.evaluate("outPoints");
+			start = std::chrono::steady_clock::now();
+			for (const size_t f : order) {
+				node.setTime("time", MTime(reader.startFrame() + f * reader.frameStep(), MTime::uiUnit()));
+				if (node.evaluate("outPoints").error()) {
+					std::printf("FAILED : node evaluation at frame %zu\n", f);
+					++failures;
+					break;
+				}
+			}
+			const double node_us = seconds(std::chrono::steady_clock::now() - start) * 1e6 / order.size();
+			std::printf("%-8s node scrub %.1f us/frame (outPoints only)\n", encoding, node_us);
+
+			const size_t f = order.back();
+			synthesize(reader.startFrame() + f * reader.frameStep(), expected_points, expected_normals);
+			MFnPointArrayData data(node.getData("outPoints"));
+			const MPointArray out = data.array();
+			if (out.length() != num_points || out[static_cast<unsigned int>(num_points - 1)].x != expected_points.x[num_points - 1]) {
+				std::printf("FAILED : node output does not match frame %zu\n", f);
+				++failures;
+			}
+		}
+
+		// 末尾を切り詰めたファイルは開けないこと
+		const std::string broken = dir + "/mpbGeometryCacheBench_broken.mpbgc";
+		{
+			std::ifstream in(path, std::ios::binary);
+			std::ofstream out(broken, std::ios::binary | std::ios::trunc);
+			std::vector<char> head(static_cast<size_t>(reader.fileSize() - 8));
+			in.read(head.data(), head.size());
+			out.write(head.data(), head.size());
+		}
+		try {
+			mpb::GeometryCacheReader truncated(MString(broken.c_str()));
+			std::printf("FAILED : truncated cache was accepted\n");
+			++failures;
+		}
+		catch (const mpb::MStatusException &) {}
+		std::remove(broken.c_str());
+		std::remove(path.c_str());
+	}
+
+	if (failures) return 1;
+	std::printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,323 @@
+﻿/// @file IncrementalExportBench.cpp
+/// @brief 差分エクスポート（WriteMode::kIncremental）の検証と時間のベンチマーク
+///
+/// 多数のオブジェクト（点の配列）からなるシーンについて、次を比べます。
+///
+/// - full : WriteMode::kSectionsで全体を書き出す時間
+/// - first : kIncrementalの初回（マニフェストなし）の時間
+/// - edit : 一部のオブジェクトを変更した後のkIncrementalの時間と追記されたバイト数
+///
+/// 変更を繰り返してファイルに不要なセクションが溜まった後、compact=1で書き出してサイズが生きているセクションだけに戻ることを確かめます。
+/// 毎回、SectionIndexで読んだ内容がシーンと一致することを確認し、一致しない場合は終了コード1で終了します。
+/// 最後に、別の方法で上書きされたファイル・追記の途中で中断したファイルで、全体の書き直しに戻ることを確認します。
+///
+/// 使い方 : IncrementalExportBench [オブジェクト数(既定 4000)] [1オブジェクトの点数(既定 2000)] [作業ディレクトリ(既定 /tmp)]
+
+#include "base/TranslatorBase.hpp"
+#include "io/IncrementalExporter.hpp"
+#include "util/Logger.hpp"
+#include <MockHost.hpp>
+#include <maya/MFnPlugin.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t kObjectTag = 0x4A424F50u;	///< "POBJ"
+
+/// キーの順に並んだシーン。std::mapなので書き出し順はキーの順
+std::map<std::string, std::vector<float>> scene;
+
+/// @brief オブジェクトのセクションの内容。点数と座標
+void encodeObject(const std::vector<float> & points, mpb::SectionBuffer & buffer)
+{
+	buffer.reserve(sizeof(uint32_t) + points.size() * sizeof(float));
+	buffer.writeValue<uint32_t>(static_cast<uint32_t>(points.size() / 3));
+	buffer.writeArray(points.data(), points.size());
+}
+
+mpb::Hash128 hashObject(const std::vector<float> & points)
+{
+	mpb::FastHasher hasher;
+	hasher.update(points.data(), points.size() * sizeof(float));
+	return hasher.digest();
+}
+
+/// @brief シーン全体を毎回書き出すトランスレーター
+class FullTranslator : public mpb::TranslatorBase {
+public:
+	static constexpr mpb::TranslatorInfo kTranslatorInfo{ "mpbBenchFull", "mpbs", false, true };
+	FullTranslator(void) : TranslatorBase(kTranslatorInfo) {}
+	static void * create(void) { return new FullTranslator; }
+
+protected:
+	virtual WriteMode writeMode(void) const override { return WriteMode::kSections; }
+	virtual void exportSections(mpb::SectionExporter & exporter, const MString &, MPxFileTranslator::FileAccessMode) override {
+		for (const auto & kv : scene) {
+			const std::vector<float> * points = &kv.second;
+			exporter.add(kObjectTag, [points](mpb::SectionBuffer & buffer) { encodeObject(*points, buffer); });
+		}
+	}
+};
+constexpr mpb::TranslatorInfo FullTranslator::kTranslatorInfo;
+
+/// @brief 変わったオブジェクトだけを書き出すトランスレーター
+class IncrementalTranslator : public mpb::TranslatorBase {
+public:
+	static constexpr mpb::TranslatorInfo kTranslatorInfo{ "mpbBenchIncremental", "mpbs", false, true };
+	IncrementalTranslator(void) : TranslatorBase(kTranslatorInfo) {}
+	static void * create(void) { return new IncrementalTranslator; }
+
+protected:
+	virtual WriteMode writeMode(void) const override { return WriteMode::kIncremental; }
+	virtual void exportIncremental(mpb::IncrementalExporter & exporter, const MString &, MPxFileTranslator::FileAccessMode) override {
+		for (const auto & kv : scene) {
+			const std::vector<float> * points = &kv.second;
+			exporter.add(kv.first.c_str(), kObjectTag, hashObject(kv.second), [points](mpb::SectionBuffer & buffer) { encodeObject(*points, buffer); });
+		}
+	}
+};
+constexpr mpb::TranslatorInfo IncrementalTranslator::kTranslatorInfo;
+
+double seconds(const std::chrono::steady_clock::duration d) { return std::chrono::duration<double>(d).count(); }
+
+uint64_t fileSize(const std::string & path)
+{
+	std::ifstream in(path, std::ios::binary | std::ios::ate);
+	return in ? static_cast<uint64_t>(in.tellg()) : 0;
+}
+
+double exportWith(const char * translator, const std::string & path, const MString & options, int & failures)
+{
+	const auto start = std::chrono::steady_clock::now();
+	if (mpbmock::exportFile(translator, path.c_str(), options).error()) {
+		std::printf("FAILED : export with %s (%s)\n", translator, options.asChar());
+		++failures;
+	}
+	return seconds(std::chrono::steady_clock::now() - start);
+}
+
+/// @brief ファイルをSectionIndexで読み、シーンと一致するか確かめる
+bool verify(const std::string & path, const char * label)
+{
+	try {
+		mpb::MappedFile file(path.c_str());
+		const mpb::SectionIndex index(file.bytes());
+		if (index.size() != scene.size()) {
+			std::printf("FAILED : %s : %zu sections, expected %zu\n", label, index.size(), scene.size());
+			return false;
+		}
+		size_t i = 0;
+		for (const auto & kv : scene) {
+			const mpb::ByteSpan section = index.section(i);
+			mpb::SectionBuffer expected;
+			encodeObject(kv.second, expected);
+			if (index.info(i).tag != kObjectTag || section.size() != expected.size() || std::memcmp(section.data(), expected.data(), expected.size()) != 0) {
+				std::printf("FAILED : %s : section %zu (%s) differs\n", label, i, kv.first.c_str());
+				return false;
+			}
+			++i;
+		}
+		return true;
+	}
+	catch (const mpb::MStatusException & e) {
+		std::printf("FAILED : %s : %s\n", label, e.toString("verify").asChar());
+		return false;
+	}
+}
+
+std::vector<float> makeObject(const size_t index, const size_t num_points)
+{
+	std::vector<float> points(num_points * 3);
+	for (size_t i = 0; i < num_points; ++i) {
+		points[i * 3 + 0] = static_cast<float>(index) + static_cast<float>(i % 50) * 0.02f;
+		points[i * 3 + 1] = static_cast<float>(std::sin(static_cast<double>(i) * 0.01 + index));
+		points[i * 3 + 2] = static_cast<float>(i / 50) * 0.02f;
+	}
+	return points;
+}
+
+std::string keyOf(const size_t index)
+{
+	char key[32];
+	std::snprintf(key, sizeof(key), "|obj%06zu", index);
+	return key;
+}
+
+/// @brief ランダムに選んだcount個のオブジェクトを少し動かす
+void editObjects(std::mt19937 & rng, const size_t count)
+{
+	for (size_t n = 0; n < count; ++n) {
+		auto it = scene.begin();
+		std::advance(it, rng() % scene.size());
+		for (size_t i = 1; i < it->second.size(); i += 3) it->second[i] += 0.125f;
+	}
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+	const size_t num_objects = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 4000);
+	const size_t num_points = (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 2000);
+	const std::string dir = (argc > 3 ? argv[3] : "/tmp");
+	const std::string path = dir + "/mpbIncrementalExportBench.mpbs";
+	const MString manifest = mpb::IncrementalExporter::manifestPath(path.c_str());
+	int failures = 0;
+
+	mpbmock::PluginScope scope;
+	{
+		MObject object;
+		MFnPlugin plugin(object);
+		plugin.registerFileTranslator(FullTranslator::kTranslatorInfo.name, nullptr, &FullTranslator::create);
+		plugin.registerFileTranslator(IncrementalTranslator::kTranslatorInfo.name, nullptr, &IncrementalTranslator::create);
+	}
+	// 書き出しごとの集計ログは測定に含めない
+	mpb::Logger::setLevel(mpb::LogLevel::kWarning);
+
+	for (size_t i = 0; i < num_objects; ++i) scene.emplace(keyOf(i), makeObject(i, num_points));
+	std::remove(path.c_str());
+	std::remove(manifest.asChar());
+
+	const char * const full = FullTranslator::kTranslatorInfo.name;
+	const char * const incremental = IncrementalTranslator::kTranslatorInfo.name;
+	std::printf("%zu objects x %zu points, %zu threads\n", num_objects, num_points, mpb::ThreadPool::global().concurrency());
+
+	const double full_s = exportWith(full, path, "", failures);
+	const uint64_t full_size = fileSize(path);
+	if (!verify(path, "full")) ++failures;
+	std::printf("full         : %8.1f ms, %10llu bytes\n", full_s * 1e3, static_cast<unsigned long long>(full_size));
+
+	// kSectionsのファイルにはマニフェストがないので、初回は全体を書き直す
+	const double first_s = exportWith(incremental, path, "", failures);
+	if (!verify(path, "first")) ++failures;
+	if (fileSize(path) != full_size) {
+		std::printf("FAILED : first incremental export is %llu bytes, expected %llu\n", static_cast<unsigned long long>(fileSize(path)), static_cast<unsigned long long>(full_size));
+		++failures;
+	}
+	std::printf("first        : %8.1f ms, %10llu bytes\n", first_s * 1e3, static_cast<unsigned long long>(fileSize(path)));
+
+	// 変更なし、少数の変更
+	std::mt19937 rng(11);
+	for (const size_t edits : { static_cast<size_t>(0), static_cast<size_t>(1), static_cast<size_t>(10), num_objects / 10 }) {
+		editObjects(rng, edits);
+		const uint64_t before = fileSize(path);
+		const double s = exportWith(incremental, path, "", failures);
+		if (!verify(path, "edit")) ++failures;
+		const uint64_t appended = fileSize(path) - before;
+		std::printf("edit %6zu  : %8.1f ms, %10llu bytes appended (%.1fx faster than full)\n", edits, s * 1e3, static_cast<unsigned long long>(appended), full_s / s);
+	}
+
+	// 削除と追加。消えたオブジェクトは新しい表に載らない
+	{
+		for (size_t n = 0; n < 5; ++n) {
+			auto it = scene.begin();
+			std::advance(it, rng() % scene.size());
+			scene.erase(it);
+		}
+		for (size_t n = 0; n < 3; ++n) scene.emplace(keyOf(num_objects + n), makeObject(num_objects + n, num_points));
+		const double s = exportWith(incremental, path, "", failures);
+		if (!verify(path, "remove/add")) ++failures;
+		std::printf("remove/add   : %8.1f ms\n", s * 1e3);
+	}
+
+	// 変更を繰り返して不要なセクションを溜め、圧縮する
+	{
+		for (int round = 0; round < 20; ++round) {
+			editObjects(rng, num_objects / 20);
+			exportWith(incremental, path, "", failures);
+		}
+		if (!verify(path, "rounds")) ++failures;
+		const uint64_t grown = fileSize(path);
+		const double s = exportWith(incremental, path, "compact=1", failures);
+		if (!verify(path, "compact")) ++failures;
+		const uint64_t compacted = fileSize(path);
+		uint64_t expected = 0;
+		for (const auto & kv : scene) expected += sizeof(uint32_t) + kv.second.size() * sizeof(float) + mpb::SectionExporter::kTableEntrySize;
+		expected += mpb::SectionExporter::kFooterSize;
+		if (compacted != expected) {
+			std::printf("FAILED : compacted file is %llu bytes, expected %llu\n", static_cast<unsigned long long>(compacted), static_cast<unsigned long long>(expected));
+			++failures;
+		}
+		std::printf("compact      : %8.1f ms, %10llu -> %llu bytes\n", s * 1e3, static_cast<unsigned long long>(grown), static_cast<unsigned long long>(compacted));
+
+		// 圧縮後も差分エクスポートを続けられる
+		editObjects(rng, 1);
+		const uint64_t before = fileSize(path);
+		exportWith(incremental, path, "", failures);
+		if (!verify(path, "after compact")) ++failures;
+		if (fileSize(path) - before > 2 * (num_points * 3 * sizeof(float)) + scene.size() * mpb::SectionExporter::kTableEntrySize + 64) {
+			std::printf("FAILED : export after compaction rewrote the file\n");
+			++failures;
+		}
+	}
+
+	// 別の方法で上書きされたファイルは、マニフェストと一致しないので全体を書き直す
+	{
+		editObjects(rng, 1);
+		exportWith(full, path, "", failures);
+		mpb::IncrementalExporter exporter(path.c_str(), nullptr);
+		for (const auto & kv : scene) {
+			const std::vector<float> * points = &kv.second;
+			exporter.add(kv.first.c_str(), kObjectTag, hashObject(kv.second), [points](mpb::SectionBuffer & buffer) { encodeObject(*points, buffer); });
+		}
+		exporter.finish();
+		if (!exporter.stats().rewritten || exporter.stats().reused != 0 || !verify(path, "overwritten")) {
+			std::printf("FAILED : stale manifest was used\n");
+			++failures;
+		}
+	}
+
+	// 追記の途中で中断した場合も、次回は全体を書き直す
+	{
+		editObjects(rng, 1);
+		{
+			mpb::IncrementalExporter exporter(path.c_str(), nullptr);
+			for (const auto & kv : scene) {
+				const std::vector<float> * points = &kv.second;
+				exporter.add(kv.first.c_str(), kObjectTag, hashObject(kv.second), [points](mpb::SectionBuffer & buffer) { encodeObject(*points, buffer); });
+			}
+			// finishせずに破棄する
+		}
+		mpb::IncrementalExporter exporter(path.c_str(), nullptr);
+		if (!exporter.stats().rewritten) {
+			std::printf("FAILED : interrupted append was not detected\n");
+			++failures;
+		}
+		for (const auto & kv : scene) {
+			const std::vector<float> * points = &kv.second;
+			exporter.add(kv.first.c_str(), kObjectTag, hashObject(kv.second), [points](mpb::SectionBuffer & buffer) { encodeObject(*points, buffer); });
+		}
+		exporter.finish();
+		if (!verify(path, "interrupted")) ++failures;
+
+		// 重複したキーは拒否する
+		mpb::IncrementalExporter duplicate(path.c_str(), nullptr);
+		const std::vector<float> * points = &scene.begin()->second;
+		duplicate.add("|dup", kObjectTag, hashObject(*points), [points](mpb::SectionBuffer & buffer) { encodeObject(*points, buffer); });
+		try {
+			duplicate.add("|dup", kObjectTag, hashObject(*points), [points](mpb::SectionBuffer & buffer) { encodeObject(*points, buffer); });
+			std::printf("FAILED : duplicate key was accepted\n");
+			++failures;
+		}
+		catch (const mpb::MStatusException &) {}
+	}
+
+	mpb::Logger::flush();
+	std::remove(path.c_str());
+	std::remove(manifest.asChar());
+	if (failures > 0) {
+		std::printf("%d FAILED\n", failures);
+		return 1;
+	}
+	std::printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,197 @@
+﻿/// @file LoggerBench.cpp
+/// @brief Loggerの呼び出しコストと取りこぼしの検証
+///
+/// 評価スレッドからログを書く場合の1回あたりの時間を、次の書き方で比較します。
+///
+/// - std::cerr : 従来の std::cerr << ... << std::endl（/dev/nullへの書き込み）
+/// - logger : MPB_LOG_ERROR。リングバッファへ書き込むだけで、出力はドレインスレッドが行う
+/// - logger (full) : 出力が追いつかずリングバッファが一杯の場合（待たずに破棄する）
+/// - rate-limited : 同じ呼び出し箇所で流量制限にかかった場合
+/// - disabled : 実行時にレベルを上げて無効にした場合
+/// - stripped : MPB_LOG_MIN_LEVELによりコンパイル時に除去されたMPB_LOG_DEBUG
+///
+/// 複数スレッドから同時に書き込み、出力された行数と書き込み件数・破棄件数の合計が一致すること、
+/// 書き込み側でoperator newが呼ばれないことを確認します。一致しない場合は終了コード1で終了します。
+///
+/// 使い方 : LoggerBench [回数(既定 200000)] [スレッド数(既定 4)]
+
+#include "util/Logger.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> g_allocations(0);
+
+/// @brief 行数だけを数える出力先
+class LineCounter : public std::streambuf {
+public:
+	std::atomic<uint64_t> lines{ 0 };
+
+protected:
+	virtual int_type overflow(int_type c) override {
+		if (c == '\n') lines.fetch_add(1, std::memory_order_relaxed);
+		return traits_type::not_eof(c);
+	}
+	virtual std::streamsize xsputn(const char * s, std::streamsize n) override {
+		for (std::streamsize i = 0; i < n; ++i) if (s[i] == '\n') lines.fetch_add(1, std::memory_order_relaxed);
+		return n;
+	}
+};
+
+double nsPerCall(const std::chrono::steady_clock::time_point start, const size_t calls)
+{
+	return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / static_cast<double>(calls);
+}
+
+}
+
+void * operator new(size_t size) {
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void * p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void * p) noexcept { std::free(p); }
+void operator delete(void * p, size_t) noexcept { std::free(p); }
+
+int main(int argc, char ** argv)
+{
+	const size_t calls = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000);
+	const size_t num_threads = (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4);
+	const char * const name = "pCubeShape1";
+	int failures = 0;
+
+	std::streambuf * const cout_buf = std::cout.rdbuf();
+	std::streambuf * const cerr_buf = std::cerr.rdbuf();
+
+	std::printf("%-14s %12s %12s\n", "writer", "ns/call", "allocs/call");
+
+	// 従来の書き方
+	{
+		std::ofstream null_stream("/dev/null");
+		std::cerr.rdbuf(null_stream.rdbuf());
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < calls; ++i) std::cerr << "NODE : " << name << " : 計算に失敗 " << i << std::endl;
+		std::printf("%-14s %12.2f %12s\n", "std::cerr", nsPerCall(start, calls), "-");
+		std::cerr.rdbuf(cerr_buf);
+	}
+
+	LineCounter counter;
+	std::cout.rdbuf(&counter);
+	std::cerr.rdbuf(&counter);
+
+	// ドレインスレッドを起動しておく
+	mpb::Logger::setRateLimit(0);
+	MPB_LOG_ERROR("warm up");
+	mpb::Logger::flush();
+
+	// リングバッファに空きがある場合。容量の1/4ずつ書き、間で出力を待つ（待ち時間は含めない）
+	{
+		const size_t burst = mpb::Logger::kCapacity / 4;
+		const auto before = mpb::Logger::stats();
+		const size_t allocations = g_allocations.load();
+		std::chrono::steady_clock::duration elapsed(0);
+		size_t done = 0;
+		while (done < calls) {
+			const size_t n = std::min(burst, calls - done);
+			const auto start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < n; ++i) MPB_LOG_ERROR("NODE : %s : 計算に失敗 %zu", name, done + i);
+			elapsed += std::chrono::steady_clock::now() - start;
+			done += n;
+			mpb::Logger::flush();
+		}
+		const double ns = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(calls);
+		const size_t allocs = g_allocations.load() - allocations;
+		const auto after = mpb::Logger::stats();
+		std::printf("%-14s %12.2f %12.3f  (written %llu, dropped %llu)\n", "logger", ns, static_cast<double>(allocs) / calls,
+			static_cast<unsigned long long>(after.written - before.written), static_cast<unsigned long long>(after.dropped - before.dropped));
+		if (allocs != 0) {
+			std::printf("FAILED : logger allocated %zu times\n", allocs);
+			++failures;
+		}
+	}
+
+	// 出力が追いつかずリングバッファが一杯の場合。待たずに破棄する
+	{
+		const auto before = mpb::Logger::stats();
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < calls; ++i) MPB_LOG_ERROR("NODE : %s : 計算に失敗 %zu", name, i);
+		const double ns = nsPerCall(start, calls);
+		const auto after = mpb::Logger::stats();
+		std::printf("%-14s %12.2f %12s  (written %llu, dropped %llu)\n", "logger (full)", ns, "-",
+			static_cast<unsigned long long>(after.written - before.written), static_cast<unsigned long long>(after.dropped - before.dropped));
+		mpb::Logger::flush();
+	}
+
+	{
+		mpb::Logger::setRateLimit(10);
+		const auto before = mpb::Logger::stats();
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < calls; ++i) MPB_LOG_ERROR("NODE : %s : 計算に失敗 %zu", name, i);
+		const double ns = nsPerCall(start, calls);
+		const auto after = mpb::Logger::stats();
+		std::printf("%-14s %12.2f %12s  (written %llu, suppressed %llu)\n", "rate-limited", ns, "-",
+			static_cast<unsigned long long>(after.written - before.written), static_cast<unsigned long long>(after.suppressed - before.suppressed));
+		mpb::Logger::setRateLimit(0);
+	}
+
+	{
+		mpb::Logger::setLevel(mpb::LogLevel::kError);
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < calls; ++i) MPB_LOG_INFO("NODE : %s : 計算開始 %zu", name, i);
+		std::printf("%-14s %12.2f %12s\n", "disabled", nsPerCall(start, calls), "-");
+		mpb::Logger::setLevel(mpb::LogLevel::kDebug);
+	}
+
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < calls; ++i) MPB_LOG_DEBUG("NODE : %s : 計算開始 %zu", name, i);
+		std::printf("%-14s %12.2f %12s  (MPB_LOG_MIN_LEVEL %d)\n", "stripped", nsPerCall(start, calls), "-", MPB_LOG_MIN_LEVEL);
+	}
+
+	// 複数スレッドからの同時書き込み
+	{
+		mpb::Logger::flush();
+		const uint64_t lines_before = counter.lines.load();
+		const auto before = mpb::Logger::stats();
+		const size_t per_thread = calls / num_threads;
+		std::vector<std::thread> threads;
+		const auto start = std::chrono::steady_clock::now();
+		for (size_t t = 0; t < num_threads; ++t) {
+			threads.emplace_back([t, per_thread] {
+				for (size_t i = 0; i < per_thread; ++i) MPB_LOG_WARNING("thread %zu : %zu", t, i);
+			});
+		}
+		for (auto & th : threads) th.join();
+		const double ns = nsPerCall(start, per_thread * num_threads);
+		mpb::Logger::flush();
+		const auto after = mpb::Logger::stats();
+		const uint64_t written = after.written - before.written;
+		const uint64_t dropped = after.dropped - before.dropped;
+		const uint64_t lines = counter.lines.load() - lines_before;
+		std::printf("%-14s %12.2f %12s  (%zu threads, written %llu, dropped %llu, lines %llu)\n", "concurrent", ns, "-", num_threads,
+			static_cast<unsigned long long>(written), static_cast<unsigned long long>(dropped), static_cast<unsigned long long>(lines));
+		if (written + dropped != per_thread * num_threads || lines != written) {
+			std::printf("FAILED : lost log records\n");
+			++failures;
+		}
+	}
+
+	mpb::Logger::shutdownGlobal();
+	std::cout.rdbuf(cout_buf);
+	std::cerr.rdbuf(cerr_buf);
+
+	if (failures) return 1;
+	std::printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,145 @@
+﻿/// @file SimdKernelBench.cpp
+/// @brief SIMDカーネルの検証とベンチマーク
+///
+/// 使用できる命令セットごとに、各カーネルの結果をスカラー実装と比較し、1要素あたりの時間を計測します。
+/// 比較の基準として、MPoint * MMatrixを1点ずつ計算するループも計測します。
+/// スカラー実装との誤差が許容範囲を超えた場合は終了コード1で終了します。
+///
+/// 使い方 : SimdKernelBench [要素数(既定 1000000)]
+
+#include "math/SimdKernels.hpp"
+#include <maya/MPoint.h>
+#include <maya/MPointArray.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+template <class T>
+struct Buffers {
+	std::vector<T> x, y, z, tx, ty, tz, w, ox, oy, oz, d;
+	explicit Buffers(const size_t n) : x(n), y(n), z(n), tx(n), ty(n), tz(n), w(n), ox(n), oy(n), oz(n), d(n) {
+		std::mt19937 rng(12345);
+		std::uniform_real_distribution<double> pos(-10.0, 10.0), unit(0.0, 1.0);
+		for (size_t i = 0; i < n; ++i) {
+			x[i] = T(pos(rng)); y[i] = T(pos(rng)); z[i] = T(pos(rng));
+			tx[i] = T(pos(rng)); ty[i] = T(pos(rng)); tz[i] = T(pos(rng));
+			w[i] = T(unit(rng));
+		}
+		// 長さ0のベクトルも含める
+		if (n > 0) { x[0] = y[0] = z[0] = T(0); }
+	}
+};
+
+/// @brief 1つのカーネルを実行する
+template <class T>
+void runKernel(const std::string & name, Buffers<T> & b, const MMatrix & m) {
+	const size_t n = b.x.size();
+	if (name == "transformPoints") mpb::simd::transformPoints(m, b.x.data(), b.y.data(), b.z.data(), b.ox.data(), b.oy.data(), b.oz.data(), n);
+	else if (name == "transformVectors") mpb::simd::transformVectors(m, b.x.data(), b.y.data(), b.z.data(), b.ox.data(), b.oy.data(), b.oz.data(), n);
+	else if (name == "blendPoints") mpb::simd::blendPoints(b.x.data(), b.y.data(), b.z.data(), b.tx.data(), b.ty.data(), b.tz.data(), b.w.data(), T(0.75), b.ox.data(), b.oy.data(), b.oz.data(), n);
+	else if (name == "normalize") mpb::simd::normalize(b.x.data(), b.y.data(), b.z.data(), b.ox.data(), b.oy.data(), b.oz.data(), n);
+	else if (name == "distances") mpb::simd::distances(b.x.data(), b.y.data(), b.z.data(), T(1), T(2), T(3), b.ox.data(), n);
+	else if (name == "falloff") {
+		mpb::simd::distances(b.x.data(), b.y.data(), b.z.data(), T(0), T(0), T(0), b.d.data(), n);
+		mpb::simd::falloff(b.d.data(), T(8), b.ox.data(), n);
+	}
+	else if (name == "clamp") mpb::simd::clamp(b.x.data(), T(-2), T(3), b.ox.data(), n);
+	else if (name == "lerp") mpb::simd::lerp(b.x.data(), b.tx.data(), b.w.data(), b.ox.data(), n);
+}
+
+/// @brief 1つのカーネルを実行し、出力をまとめて返す
+template <class T>
+std::vector<T> collect(const std::string & name, Buffers<T> & b, const MMatrix & m) {
+	runKernel<T>(name, b, m);
+	std::vector<T> out(b.ox);
+	if (name == "transformPoints" || name == "transformVectors" || name == "blendPoints" || name == "normalize") {
+		out.insert(out.end(), b.oy.begin(), b.oy.end());
+		out.insert(out.end(), b.oz.begin(), b.oz.end());
+	}
+	return out;
+}
+
+template <class T>
+double maxError(const std::vector<T> & a, const std::vector<T> & b) {
+	double err = 0.0;
+	for (size_t i = 0; i < a.size(); ++i) {
+		const double scale = std::max(1.0, std::fabs(static_cast<double>(a[i])));
+		err = std::max(err, std::fabs(static_cast<double>(a[i]) - static_cast<double>(b[i])) / scale);
+	}
+	return err;
+}
+
+template <class F>
+double nsPerElement(const size_t n, F && body) {
+	body();
+	double best = 1e300;
+	for (int r = 0; r < 5; ++r) {
+		const auto t0 = std::chrono::steady_clock::now();
+		body();
+		const auto t1 = std::chrono::steady_clock::now();
+		best = std::min(best, std::chrono::duration<double, std::nano>(t1 - t0).count());
+	}
+	return best / static_cast<double>(n);
+}
+
+template <class T>
+bool verifyAndTime(const char * type_name, const size_t n, const double tolerance) {
+	static const char * const kKernels[] = { "transformPoints", "transformVectors", "blendPoints", "normalize", "distances", "falloff", "clamp", "lerp" };
+	const double m[4][4] = { { 0.8, 0.1, -0.3, 0.0 }, { -0.2, 1.1, 0.4, 0.0 }, { 0.5, -0.6, 0.9, 0.0 }, { 3.0, -2.0, 1.5, 1.0 } };
+	const MMatrix matrix(m);
+	Buffers<T> buffers(n);
+
+	const mpb::simd::Isa detected = mpb::simd::detectedIsa();
+	bool ok = true;
+	for (const char * kernel : kKernels) {
+		mpb::simd::setIsa(mpb::simd::Isa::kScalar);
+		const std::vector<T> reference = collect<T>(kernel, buffers, matrix);
+		const double scalar_ns = nsPerElement(n, [&] { runKernel<T>(kernel, buffers, matrix); });
+		std::printf("%-7s %-18s %-7s %8.3f ns/elem\n", type_name, kernel, "scalar", scalar_ns);
+
+		for (int i = 1; i <= static_cast<int>(detected); ++i) {
+			const mpb::simd::Isa isa = mpb::simd::setIsa(static_cast<mpb::simd::Isa>(i));
+			if (static_cast<int>(isa) != i) continue;
+			const std::vector<T> result = collect<T>(kernel, buffers, matrix);
+			const double err = maxError(reference, result);
+			const double ns = nsPerElement(n, [&] { runKernel<T>(kernel, buffers, matrix); });
+			const bool pass = (err <= tolerance);
+			std::printf("%-7s %-18s %-7s %8.3f ns/elem  x%5.2f  max_rel_err=%.3g %s\n", type_name, kernel, mpb::simd::isaName(isa), ns, scalar_ns / ns, err, (pass ? "" : "NG"));
+			ok = ok && pass;
+		}
+	}
+	mpb::simd::setIsa(detected);
+	return ok;
+}
+
+}
+
+int main(int argc, char ** argv) {
+	const size_t n = (argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 1000000u);
+	std::printf("detected : %s, elements : %zu\n", mpb::simd::isaName(mpb::simd::detectedIsa()), n);
+
+	// 比較対象 : MPoint * MMatrixを1点ずつ
+	{
+		const double m[4][4] = { { 0.8, 0.1, -0.3, 0.0 }, { -0.2, 1.1, 0.4, 0.0 }, { 0.5, -0.6, 0.9, 0.0 }, { 3.0, -2.0, 1.5, 1.0 } };
+		const MMatrix matrix(m);
+		std::vector<MPoint> points(n, MPoint(1.0, 2.0, 3.0)), out(n);
+		const double ns = nsPerElement(n, [&] { for (size_t i = 0; i < n; ++i) out[i] = points[i] * matrix; });
+		std::printf("%-7s %-18s %-7s %8.3f ns/elem\n", "MPoint", "operator*(MMatrix)", "-", ns);
+	}
+
+	const bool ok_double = verifyAndTime<double>("double", n, 1e-12);
+	const bool ok_float = verifyAndTime<float>("float", n, 1e-5);
+	if (!ok_double || !ok_float) {
+		std::printf("NG : SIMD results differ from the scalar reference\n");
+		return 1;
+	}
+	std::printf("OK : all paths match the scalar reference\n");
+	return 0;
+}
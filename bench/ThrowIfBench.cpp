@@ -0,0 +1,108 @@
+﻿/// @file ThrowIfBench.cpp
+/// @brief MStatusException::throwIfの成功パスのマイクロベンチマーク
+///
+/// 成功時のthrowIfが「分岐1つ」で済んでいることを、以下の2点で確認します。
+///
+/// - 実行時間 : 素のif文と比べて差がないこと
+/// - メモリ確保 : 成功パスでoperator newが一度も呼ばれないこと（呼ばれた場合は終了コード1）
+///
+/// 生成コードを直接確認する場合は、probeThrowIfLiteral / probeThrowIfBuilder を逆アセンブルしてください。
+/// 例 : objdump -d --no-show-raw-insn -C <実行ファイル> | grep -A12 "probeThrowIfBuilder"
+/// 比較と条件分岐の後に、コールド側のthrowError呼び出しが続くだけになっているはずです。
+
+#include "exception/MStatusException.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> g_allocations(0);
+
+#if defined(_MSC_VER)
+#define MPB_BENCH_NOINLINE __declspec(noinline)
+#else
+#define MPB_BENCH_NOINLINE __attribute__((noinline))
+#endif
+
+}
+
+void * operator new(size_t size) {
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void * p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void * p) noexcept { std::free(p); }
+void operator delete(void * p, size_t) noexcept { std::free(p); }
+
+/// 比較対象 : 素のif文
+MPB_BENCH_NOINLINE int probePlainBranch(const MStatus & stat) {
+	if (stat.error()) std::abort();
+	return 1;
+}
+
+/// 文字列リテラルのメッセージ
+MPB_BENCH_NOINLINE int probeThrowIfLiteral(const MStatus & stat) {
+	mpb::MStatusException::throwIf(stat, "アトリビュートの追加に失敗", MPB_EXCEPTION_PLACE);
+	return 1;
+}
+
+/// 遅延生成のメッセージ
+MPB_BENCH_NOINLINE int probeThrowIfBuilder(const MStatus & stat, const MString & name) {
+	mpb::MStatusException::throwIf(stat, [&name] { return name + "アトリビュートの追加に失敗"; }, MPB_EXCEPTION_PLACE);
+	return 1;
+}
+
+/// 従来の書き方 : メッセージを先に組み立てる
+MPB_BENCH_NOINLINE int probeThrowIfEager(const MStatus & stat, const MString & name) {
+	mpb::MStatusException::throwIf(stat, name + "アトリビュートの追加に失敗", MPB_EXCEPTION_PLACE);
+	return 1;
+}
+
+template <class F>
+static void measure(const char * label, const size_t iterations, F && body) {
+	const size_t alloc_before = g_allocations.load();
+	const auto begin = std::chrono::steady_clock::now();
+	int sink = 0;
+	for (size_t i = 0; i < iterations; ++i) sink += body();
+	const auto end = std::chrono::steady_clock::now();
+	const size_t allocs = g_allocations.load() - alloc_before;
+	const double ns = std::chrono::duration<double, std::nano>(end - begin).count() / static_cast<double>(iterations);
+	std::printf("%-24s %8.3f ns/call  %10zu allocs  (sink=%d)\n", label, ns, allocs, sink);
+}
+
+int main(int argc, char ** argv) {
+	const size_t iterations = (argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 20000000u);
+	const MStatus success(MStatus::kSuccess);
+	const MString name("inputValue");
+
+	measure("plain branch", iterations, [&] { return probePlainBranch(success); });
+
+	size_t before = g_allocations.load();
+	measure("throwIf(literal)", iterations, [&] { return probeThrowIfLiteral(success); });
+	measure("throwIf(builder)", iterations, [&] { return probeThrowIfBuilder(success, name); });
+	const size_t lazy_allocations = g_allocations.load() - before;
+
+	measure("throwIf(eager MString)", iterations / 10, [&] { return probeThrowIfEager(success, name); });
+
+	// 失敗パスが正しく送出されることも確認する
+	try {
+		probeThrowIfBuilder(MStatus::kFailure, name);
+		std::printf("failure path did not throw\n");
+		return 1;
+	}
+	catch (const mpb::MStatusException & e) {
+		std::printf("failure path : %s\n", e.toString().asChar());
+	}
+
+	if (lazy_allocations != 0) {
+		std::printf("NG : success path allocated %zu times\n", lazy_allocations);
+		return 1;
+	}
+	std::printf("OK : success path performed no allocation\n");
+	return 0;
+}
@@ -0,0 +1,129 @@
+﻿/// @file UndoJournalBench.cpp
+/// @brief UndoJournalの検証とベンチマーク
+///
+/// 大きな配列の一部を少しずつ動かすundo可能なコマンド（スカルプトのストローク相当）を繰り返し実行し、
+/// ジャーナルが保持するバイト数と、変更前後の配列を丸ごと複製した場合のバイト数を比較します。
+/// すべてをundo/redoした結果が正しくない場合や、上限を超えた古いコマンドがundoできてしまう場合は終了コード1で終了します。
+///
+/// 使い方 : UndoJournalBench [要素数(既定 1000000)] [コマンド数(既定 1000)]
+
+#include "base/CommandBase.hpp"
+#include <MockHost.hpp>
+#include <maya/MArgList.h>
+#include <maya/MFnPlugin.h>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<double> g_values;
+
+/// @brief 「先頭 要素数 量」で配列の範囲を滑らかに持ち上げるコマンド
+class SculptCommand : public mpb::CommandBase {
+public:
+	SculptCommand(void) noexcept : CommandBase("mpbBenchSculpt", true) {}
+	static void * create(void) { return new SculptCommand; }
+
+	virtual MStatus doIt(const MArgList & args) override {
+		const size_t start = static_cast<size_t>(args.asInt(0));
+		const size_t count = static_cast<size_t>(args.asInt(1));
+		const double amount = args.asDouble(2);
+
+		const std::vector<double> before = g_values;
+		for (size_t i = 0; i < count && start + i < g_values.size(); ++i) {
+			const double t = static_cast<double>(i) / static_cast<double>(count);
+			g_values[start + i] += amount * std::sin(3.14159265358979 * t);
+		}
+		this->journalArray("values", before.data(), before.size(), g_values.data(), g_values.size());
+		return MStatus::kSuccess;
+	}
+
+protected:
+	virtual void applyJournal(const mpb::JournalChange & change) override {
+		g_values.resize(change.length());
+		for (size_t i = 0; i < change.size(); ++i) g_values[change.index(i)] = change.value<double>(i);
+	}
+};
+
+double elapsedMs(const std::chrono::steady_clock::time_point & t0) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+bool sculpt(const size_t start, const size_t count, const double amount, std::unique_ptr<MPxCommand> * instance) {
+	MArgList args;
+	args.addArg(MString(std::to_string(start).c_str()));
+	args.addArg(MString(std::to_string(count).c_str()));
+	args.addArg(MString(std::to_string(amount).c_str()));
+	return mpbmock::executeCommand("mpbBenchSculpt", args, nullptr, instance) == MStatus::kSuccess;
+}
+
+}
+
+int main(int argc, char ** argv) {
+	const size_t n = (argc > 1 ? static_cast<size_t>(std::strtoull(argv[1], nullptr, 10)) : 1000000);
+	const size_t commands = (argc > 2 ? static_cast<size_t>(std::strtoull(argv[2], nullptr, 10)) : 1000);
+	if (n < 1024 || commands == 0) {
+		std::fprintf(stderr, "usage : %s [elements(>=1024)] [commands]\n", argv[0]);
+		return 1;
+	}
+
+	mpbmock::PluginScope scope;
+	{
+		MObject object;
+		MFnPlugin plugin(object);
+		plugin.registerCommand("mpbBenchSculpt", &SculptCommand::create);
+	}
+
+	g_values.resize(n);
+	for (size_t i = 0; i < n; ++i) g_values[i] = std::cos(0.001 * static_cast<double>(i));
+	const std::vector<double> initial = g_values;
+
+	// 乱数の代わりに決まった順でストロークの位置と幅を変える
+	std::vector<std::unique_ptr<MPxCommand>> history(commands);
+	bool ok = true;
+	auto t0 = std::chrono::steady_clock::now();
+	for (size_t c = 0; c < commands && ok; ++c) {
+		const size_t count = 64 + (c * 37) % 960;
+		const size_t start = (c * 7919 * 131) % (n - count);
+		ok = sculpt(start, count, 0.01 * static_cast<double>(1 + c % 5), &history[c]);
+	}
+	const double do_ms = elapsedMs(t0);
+	const std::vector<double> edited = g_values;
+	const mpb::UndoJournal::Stats stats = mpb::UndoJournal::stats();
+
+	t0 = std::chrono::steady_clock::now();
+	for (size_t c = commands; c-- > 0 && ok;) ok = (history[c]->undoIt() == MStatus::kSuccess);
+	const double undo_ms = elapsedMs(t0);
+	ok = ok && (g_values == initial);
+
+	t0 = std::chrono::steady_clock::now();
+	for (size_t c = 0; c < commands && ok; ++c) ok = (history[c]->redoIt() == MStatus::kSuccess);
+	const double redo_ms = elapsedMs(t0);
+	ok = ok && (g_values == edited);
+
+	// 上限を小さくすると古いコマンドからundoできなくなる
+	mpb::UndoJournal::setBudget(2 * mpb::UndoJournal::kChunkSize);
+	const mpb::UndoJournal::Stats bounded = mpb::UndoJournal::stats();
+	ok = ok && (bounded.reserved_bytes <= bounded.budget) && (bounded.evicted_records > 0);
+	ok = ok && (history.front()->undoIt() != MStatus::kSuccess);
+	ok = ok && (history.back()->undoIt() == MStatus::kSuccess);
+	history.clear();
+	mpb::UndoJournal::setBudget(mpb::UndoJournal::kDefaultBudget);
+
+	std::printf("elements %zu, commands %zu\n", n, commands);
+	std::printf("%-22s %14s\n", "", "bytes");
+	std::printf("%-22s %14zu\n", "full snapshots", stats.raw_bytes);
+	std::printf("%-22s %14zu  x%.1f\n", "journal records", stats.record_bytes, static_cast<double>(stats.raw_bytes) / static_cast<double>(stats.record_bytes));
+	std::printf("%-22s %14zu  (%zu chunks)\n", "journal reserved", stats.reserved_bytes, stats.chunks);
+	std::printf("%-22s %14.3f ms/cmd\n", "do", do_ms / static_cast<double>(commands));
+	std::printf("%-22s %14.3f ms/cmd\n", "undo", undo_ms / static_cast<double>(commands));
+	std::printf("%-22s %14.3f ms/cmd\n", "redo", redo_ms / static_cast<double>(commands));
+	std::printf("%-22s %14zu / %llu evicted\n", "bounded (2 chunks)", bounded.records, static_cast<unsigned long long>(bounded.evicted_records));
+	if (!ok) std::printf("NG : journal result mismatch\n");
+	return ok ? 0 : 1;
+}
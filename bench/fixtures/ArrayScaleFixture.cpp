@@ -0,0 +1,74 @@
+﻿/// @file ArrayScaleFixture.cpp
+/// @brief doubleArrayを定数倍するノードのフィクスチャ
+///
+/// addNodesにノードがまだない状態でもハーネス自体を計測できるよう、ベンチマーク専用のノードを登録します。
+/// プラグインのノードのフィクスチャでは、register_nodeは不要です。
+
+#include "harness/BenchHarness.hpp"
+#include "base/NodeBase.hpp"
+#include "base/DataAccess.hpp"
+#include <maya/MFnPlugin.h>
+#include <maya/MFnNumericAttribute.h>
+#include <maya/MFnTypedAttribute.h>
+#include <maya/MFnDoubleArrayData.h>
+
+namespace {
+
+class ArrayScaleNode : public mpb::NodeBase {
+public:
+	static MObject input_, scale_, output_;
+
+	ArrayScaleNode(void) : NodeBase(0x70100, "mpbBenchArrayScale") {}
+	static void * create(void) { return new ArrayScaleNode; }
+
+	static MStatus initialize(void) {
+		try {
+			MFnTypedAttribute typed;
+			input_ = typed.create("input", "i", MFnData::kDoubleArray);
+			addAttr(input_, typed);
+			addNumericAttr(scale_, "scale", "s", AttributeOptions(), MFnNumericData::kDouble, 2.0);
+			output_ = typed.create("output", "o", MFnData::kDoubleArray);
+			AttributeOptions(true, false, true, false, false).apply(typed);
+			addAttr(output_, typed);
+			setMultiAttributeAffects({ &input_, &scale_ }, { &output_ });
+		}
+		catch (const mpb::MStatusException & e) {
+			std::cerr << e.toString("ArrayScaleNode::initialize") << std::endl;
+			return e.stat;
+		}
+		return MStatus::kSuccess;
+	}
+
+protected:
+	virtual void computeProcess(const MPlug & plug, MDataBlock & data) override {
+		if (!(plug == output_)) throw mpb::MStatusException(MStatus::kInvalidParameter, "予期しないプラグの再計算要求");
+		const double scale = data.inputValue(scale_).asDouble();
+		MDataHandle input = data.inputValue(input_);
+		const mpb::ConstSpan<double> src = mpb::readDoubleArrayData(input, this->input_buffer_);
+		double * scaled = scratchArray<double>(src.size());
+		for (size_t i = 0; i < src.size(); ++i) scaled[i] = src[i] * scale;
+		MDataHandle output = data.outputValue(output_);
+		mpb::writeDoubleArrayData(output, mpb::ConstSpan<double>(scaled, src.size()));
+	}
+
+private:
+	std::vector<double> input_buffer_;
+};
+
+MObject ArrayScaleNode::input_;
+MObject ArrayScaleNode::scale_;
+MObject ArrayScaleNode::output_;
+
+}
+
+MPB_BENCH_FIXTURE(arrayScale, "arrayScale", "mpbBenchArrayScale", "output",
+	[](mpbmock::Node & node, const size_t size) {
+		MDoubleArray values(static_cast<unsigned int>(size), 1.5);
+		MFnDoubleArrayData data;
+		node.setData("input", data.create(values));
+	},
+	[] {
+		MObject object;
+		MFnPlugin plugin(object);
+		plugin.registerNode("mpbBenchArrayScale", 0x70100, &ArrayScaleNode::create, &ArrayScaleNode::initialize);
+	});
@@ -0,0 +1,98 @@
+﻿/// @file AsyncSmoothFixture.cpp
+/// @brief doubleArrayを繰り返し平滑化するノードを非同期計算にしたフィクスチャ
+///
+/// 平滑化はAsyncComputeQueueのワーカーで行い、computeは完了済みの結果を出力へ書き込むだけになります。
+/// 計測ループでは入力が変わらないため、2回目以降のcomputeは結果の書き込みのコストを計測します。
+
+#include "harness/BenchHarness.hpp"
+#include "base/NodeBase.hpp"
+#include "base/DataAccess.hpp"
+#include <maya/MFnPlugin.h>
+#include <maya/MFnNumericAttribute.h>
+#include <maya/MFnTypedAttribute.h>
+#include <maya/MFnDoubleArrayData.h>
+
+namespace {
+
+class AsyncSmoothNode : public mpb::NodeBase {
+public:
+	static MObject input_, iterations_, output_;
+
+	AsyncSmoothNode(void) : NodeBase(0x70103, "mpbBenchAsyncSmooth") {}
+	static void * create(void) { return new AsyncSmoothNode; }
+
+	static MStatus initialize(void) {
+		try {
+			MFnTypedAttribute typed;
+			input_ = typed.create("input", "i", MFnData::kDoubleArray);
+			addAttr(input_, typed);
+			addNumericAttr(iterations_, "iterations", "it", AttributeOptions(), MFnNumericData::kInt, 16);
+			output_ = typed.create("output", "o", MFnData::kDoubleArray);
+			AttributeOptions(true, false, true, false, false).apply(typed);
+			addAttr(output_, typed);
+			setMultiAttributeAffects({ &input_, &iterations_ }, { &output_ });
+		}
+		catch (const mpb::MStatusException & e) {
+			std::cerr << e.toString("AsyncSmoothNode::initialize") << std::endl;
+			return e.stat;
+		}
+		return MStatus::kSuccess;
+	}
+
+protected:
+	class Job : public mpb::AsyncJob {
+	public:
+		std::vector<double> values;
+		int iterations;
+
+		virtual void run(const mpb::CancelToken & cancel) override {
+			std::vector<double> next(this->values.size());
+			for (int it = 0; it < this->iterations && !cancel.cancelled(); ++it) {
+				const size_t n = this->values.size();
+				for (size_t i = 0; i < n; ++i) {
+					const double l = this->values[i == 0 ? 0 : i - 1];
+					const double r = this->values[i + 1 == n ? i : i + 1];
+					next[i] = 0.25 * l + 0.5 * this->values[i] + 0.25 * r;
+				}
+				this->values.swap(next);
+			}
+		}
+
+		virtual void write(const MPlug & plug, MDataBlock & data) override {
+			MDataHandle output = data.outputValue(output_);
+			mpb::writeDoubleArrayData(output, mpb::ConstSpan<double>(this->values.data(), this->values.size()));
+		}
+	};
+
+	virtual const mpb::AsyncSpec * asyncSpec(void) const override {
+		static const mpb::AsyncSpec spec{ { &output_ }, mpb::AsyncSpec::kWaitInitial, 0 };
+		return &spec;
+	}
+
+	virtual std::unique_ptr<mpb::AsyncJob> createAsyncJob(const MPlug & plug, MDataBlock & data) override {
+		std::unique_ptr<Job> job(new Job);
+		job->iterations = data.inputValue(iterations_).asInt();
+		MDataHandle input = data.inputValue(input_);
+		mpb::readDoubleArrayData(input, job->values);
+		return job;
+	}
+};
+
+MObject AsyncSmoothNode::input_;
+MObject AsyncSmoothNode::iterations_;
+MObject AsyncSmoothNode::output_;
+
+}
+
+MPB_BENCH_FIXTURE(asyncSmooth, "asyncSmooth", "mpbBenchAsyncSmooth", "output",
+	[](mpbmock::Node & node, const size_t size) {
+		MDoubleArray values(static_cast<unsigned int>(size), 0.0);
+		for (unsigned int i = 0; i < values.length(); i += 2) values[i] = 1.0;
+		MFnDoubleArrayData data;
+		node.setData("input", data.create(values));
+	},
+	[] {
+		MObject object;
+		MFnPlugin plugin(object);
+		plugin.registerNode("mpbBenchAsyncSmooth", 0x70103, &AsyncSmoothNode::create, &AsyncSmoothNode::initialize);
+	});
@@ -0,0 +1,80 @@
+﻿/// @file MemoArrayScaleFixture.cpp
+/// @brief memoSpecでメモ化を有効にしたdoubleArray定数倍ノードのフィクスチャ
+///
+/// 計算内容はarrayScaleと同じです。計測ループでは同じ入力が繰り返し設定されるため、
+/// 2回目以降のcomputeはMemoCacheのヒットとなり、キーの計算と出力の復元のコストを計測します。
+/// 計算が入力のハッシュより軽いため、arrayScaleより遅くなります。メモ化が有効な例はmemoSmoothです。
+
+#include "harness/BenchHarness.hpp"
+#include "base/NodeBase.hpp"
+#include "base/DataAccess.hpp"
+#include <maya/MFnPlugin.h>
+#include <maya/MFnNumericAttribute.h>
+#include <maya/MFnTypedAttribute.h>
+#include <maya/MFnDoubleArrayData.h>
+
+namespace {
+
+class MemoArrayScaleNode : public mpb::NodeBase {
+public:
+	static MObject input_, scale_, output_;
+
+	MemoArrayScaleNode(void) : NodeBase(0x70102, "mpbBenchMemoArrayScale") {}
+	static void * create(void) { return new MemoArrayScaleNode; }
+
+	static MStatus initialize(void) {
+		try {
+			MFnTypedAttribute typed;
+			input_ = typed.create("input", "i", MFnData::kDoubleArray);
+			addAttr(input_, typed);
+			addNumericAttr(scale_, "scale", "s", AttributeOptions(), MFnNumericData::kDouble, 2.0);
+			output_ = typed.create("output", "o", MFnData::kDoubleArray);
+			AttributeOptions(true, false, true, false, false).apply(typed);
+			addAttr(output_, typed);
+			setMultiAttributeAffects({ &input_, &scale_ }, { &output_ });
+		}
+		catch (const mpb::MStatusException & e) {
+			std::cerr << e.toString("MemoArrayScaleNode::initialize") << std::endl;
+			return e.stat;
+		}
+		return MStatus::kSuccess;
+	}
+
+protected:
+	virtual const mpb::MemoSpec * memoSpec(void) const override {
+		static const mpb::MemoSpec spec{ { &input_, &scale_ }, { &output_ } };
+		return &spec;
+	}
+
+	virtual void computeProcess(const MPlug & plug, MDataBlock & data) override {
+		if (!(plug == output_)) throw mpb::MStatusException(MStatus::kInvalidParameter, "予期しないプラグの再計算要求");
+		const double scale = data.inputValue(scale_).asDouble();
+		MDataHandle input = data.inputValue(input_);
+		const mpb::ConstSpan<double> src = mpb::readDoubleArrayData(input, this->input_buffer_);
+		double * scaled = scratchArray<double>(src.size());
+		for (size_t i = 0; i < src.size(); ++i) scaled[i] = src[i] * scale;
+		MDataHandle output = data.outputValue(output_);
+		mpb::writeDoubleArrayData(output, mpb::ConstSpan<double>(scaled, src.size()));
+	}
+
+private:
+	std::vector<double> input_buffer_;
+};
+
+MObject MemoArrayScaleNode::input_;
+MObject MemoArrayScaleNode::scale_;
+MObject MemoArrayScaleNode::output_;
+
+}
+
+MPB_BENCH_FIXTURE(memoArrayScale, "memoArrayScale", "mpbBenchMemoArrayScale", "output",
+	[](mpbmock::Node & node, const size_t size) {
+		MDoubleArray values(static_cast<unsigned int>(size), 1.5);
+		MFnDoubleArrayData data;
+		node.setData("input", data.create(values));
+	},
+	[] {
+		MObject object;
+		MFnPlugin plugin(object);
+		plugin.registerNode("mpbBenchMemoArrayScale", 0x70102, &MemoArrayScaleNode::create, &MemoArrayScaleNode::initialize);
+	});
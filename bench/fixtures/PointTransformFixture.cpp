@@ -0,0 +1,76 @@
+﻿/// @file PointTransformFixture.cpp
+/// @brief pointArrayをSoAへ変換して平行移動するノードのフィクスチャ
+///
+/// pointArray -> SoaBuffer3<float> -> simd::transformPoints -> pointArray の往復を計測します。
+/// 変換バッファはノードのメンバに保持するため、2回目以降のcomputeでSoAバッファの確保は発生しません。
+/// 平行移動は要素あたりの演算が少ないため、時間の大半はpointArrayとSoAの変換とデータのコピーです。
+
+#include "harness/BenchHarness.hpp"
+#include "base/NodeBase.hpp"
+#include "math/SimdKernels.hpp"
+#include <maya/MFnPlugin.h>
+#include <maya/MFnNumericAttribute.h>
+#include <maya/MFnTypedAttribute.h>
+#include <maya/MFnPointArrayData.h>
+
+namespace {
+
+class PointTransformNode : public mpb::NodeBase {
+public:
+	static MObject input_, offset_, output_;
+
+	PointTransformNode(void) : NodeBase(0x70101, "mpbBenchPointTransform") {}
+	static void * create(void) { return new PointTransformNode; }
+
+	static MStatus initialize(void) {
+		try {
+			MFnTypedAttribute typed;
+			input_ = typed.create("input", "i", MFnData::kPointArray);
+			addAttr(input_, typed);
+			addNumericAttr(offset_, "offset", "of", AttributeOptions(), MFnNumericData::kDouble, 1.0);
+			output_ = typed.create("output", "o", MFnData::kPointArray);
+			AttributeOptions(true, false, true, false, false).apply(typed);
+			addAttr(output_, typed);
+			setMultiAttributeAffects({ &input_, &offset_ }, { &output_ });
+		}
+		catch (const mpb::MStatusException & e) {
+			std::cerr << e.toString("PointTransformNode::initialize") << std::endl;
+			return e.stat;
+		}
+		return MStatus::kSuccess;
+	}
+
+protected:
+	virtual void computeProcess(const MPlug & plug, MDataBlock & data) override {
+		if (!(plug == output_)) throw mpb::MStatusException(MStatus::kInvalidParameter, "予期しないプラグの再計算要求");
+		const double offset = data.inputValue(offset_).asDouble();
+		MMatrix m;
+		m.matrix[3][0] = m.matrix[3][1] = m.matrix[3][2] = offset;
+		readInputPoints(data, input_, this->points_);
+		mpb::SoaBuffer3<float> & p = this->points_;
+		mpb::simd::transformPoints(m, p.x.data(), p.y.data(), p.z.data(), p.x.data(), p.y.data(), p.z.data(), p.size());
+		writeOutputPoints(data, output_, p);
+	}
+
+private:
+	mpb::SoaBuffer3<float> points_;
+};
+
+MObject PointTransformNode::input_;
+MObject PointTransformNode::offset_;
+MObject PointTransformNode::output_;
+
+}
+
+MPB_BENCH_FIXTURE(pointTransform, "pointTransform", "mpbBenchPointTransform", "output",
+	[](mpbmock::Node & node, const size_t size) {
+		MPointArray points(static_cast<unsigned int>(size));
+		for (unsigned int i = 0; i < points.length(); ++i) points[i] = MPoint(i, 0.5 * i, -0.25 * i);
+		MFnPointArrayData data;
+		node.setData("input", data.create(points));
+	},
+	[] {
+		MObject object;
+		MFnPlugin plugin(object);
+		plugin.registerNode("mpbBenchPointTransform", 0x70101, &PointTransformNode::create, &PointTransformNode::initialize);
+	});
@@ -0,0 +1,85 @@
+﻿/// @file SmoothFixture.cpp
+/// @brief doubleArrayを繰り返し平滑化するノードのフィクスチャ
+///
+/// 計算内容はasyncSmoothと同じで、computeの中で同期的に平滑化します。memoSmoothとの比較用です。
+
+#include "harness/BenchHarness.hpp"
+#include "base/NodeBase.hpp"
+#include "base/DataAccess.hpp"
+#include <maya/MFnPlugin.h>
+#include <maya/MFnNumericAttribute.h>
+#include <maya/MFnTypedAttribute.h>
+#include <maya/MFnDoubleArrayData.h>
+#include <algorithm>
+
+namespace {
+
+class SmoothNode : public mpb::NodeBase {
+public:
+	static MObject input_, iterations_, output_;
+
+	SmoothNode(void) : NodeBase(0x70104, "mpbBenchSmooth") {}
+	static void * create(void) { return new SmoothNode; }
+
+	static MStatus initialize(void) {
+		try {
+			MFnTypedAttribute typed;
+			input_ = typed.create("input", "i", MFnData::kDoubleArray);
+			addAttr(input_, typed);
+			addNumericAttr(iterations_, "iterations", "it", AttributeOptions(), MFnNumericData::kInt, 16);
+			output_ = typed.create("output", "o", MFnData::kDoubleArray);
+			AttributeOptions(true, false, true, false, false).apply(typed);
+			addAttr(output_, typed);
+			setMultiAttributeAffects({ &input_, &iterations_ }, { &output_ });
+		}
+		catch (const mpb::MStatusException & e) {
+			std::cerr << e.toString("SmoothNode::initialize") << std::endl;
+			return e.stat;
+		}
+		return MStatus::kSuccess;
+	}
+
+protected:
+	virtual void computeProcess(const MPlug & plug, MDataBlock & data) override {
+		if (!(plug == output_)) throw mpb::MStatusException(MStatus::kInvalidParameter, "予期しないプラグの再計算要求");
+		const int iterations = data.inputValue(iterations_).asInt();
+		MDataHandle input = data.inputValue(input_);
+		const mpb::ConstSpan<double> src = mpb::readDoubleArrayData(input, this->values_);
+		const size_t n = src.size();
+		double * current = scratchArray<double>(n);
+		double * next = scratchArray<double>(n);
+		std::copy(src.begin(), src.end(), current);
+		for (int it = 0; it < iterations; ++it) {
+			for (size_t i = 0; i < n; ++i) {
+				const double l = current[i == 0 ? 0 : i - 1];
+				const double r = current[i + 1 == n ? i : i + 1];
+				next[i] = 0.25 * l + 0.5 * current[i] + 0.25 * r;
+			}
+			std::swap(current, next);
+		}
+		MDataHandle output = data.outputValue(output_);
+		mpb::writeDoubleArrayData(output, mpb::ConstSpan<double>(current, n));
+	}
+
+private:
+	std::vector<double> values_;
+};
+
+MObject SmoothNode::input_;
+MObject SmoothNode::iterations_;
+MObject SmoothNode::output_;
+
+}
+
+MPB_BENCH_FIXTURE(smooth, "smooth", "mpbBenchSmooth", "output",
+	[](mpbmock::Node & node, const size_t size) {
+		MDoubleArray values(static_cast<unsigned int>(size), 0.0);
+		for (unsigned int i = 0; i < values.length(); i += 2) values[i] = 1.0;
+		MFnDoubleArrayData data;
+		node.setData("input", data.create(values));
+	},
+	[] {
+		MObject object;
+		MFnPlugin plugin(object);
+		plugin.registerNode("mpbBenchSmooth", 0x70104, &SmoothNode::create, &SmoothNode::initialize);
+	});
@@ -0,0 +1,295 @@
+﻿/// @file BenchHarness.cpp
+/// @brief ノードのcomputeベンチマークハーネスの実装とmain関数
+///
+/// 使い方 :
+/// @code
+/// NodeBench [--list] [--filter <文字列>] [--sizes 1,1000,1000000] [--min-time <秒>] [--max-iterations <回数>]
+///           [--json <出力ファイル>] [--baseline <基準ファイル>] [--threshold <割合>]
+/// @endcode
+///
+/// --baselineを指定すると、同じフィクスチャ・サイズの結果とp50を比較し、threshold（既定0.10 = 10%）を超えて遅くなった場合、
+/// またはcomputeあたりのメモリ確保回数が増えた場合に回帰として報告し、終了コード2で終了します。
+/// computeが失敗した場合の終了コードは1です。
+
+#include "BenchHarness.hpp"
+#include <maya/MFnPlugin.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <new>
+#include <set>
+#include <sstream>
+
+namespace {
+
+std::atomic<size_t> g_allocations(0);
+
+std::vector<mpb::bench::Fixture> & fixtureList(void) {
+	static std::vector<mpb::bench::Fixture> list;
+	return list;
+}
+
+struct Options {
+	bool list = false;
+	std::string filter;
+	std::vector<size_t> sizes{ 1, 1000, 1000000 };
+	double min_time = 0.2;
+	size_t max_iterations = 1000000;
+	std::string json_path;
+	std::string baseline_path;
+	double threshold = 0.10;
+};
+
+std::vector<size_t> parseSizes(const char * str) {
+	std::vector<size_t> sizes;
+	std::stringstream ss(str);
+	std::string item;
+	while (std::getline(ss, item, ',')) {
+		if (!item.empty()) sizes.push_back(static_cast<size_t>(std::strtoull(item.c_str(), nullptr, 10)));
+	}
+	return sizes;
+}
+
+bool parseOptions(const int argc, char ** argv, Options & options) {
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg(argv[i]);
+		const bool has_value = (i + 1 < argc);
+		if (arg == "--list") options.list = true;
+		else if (arg == "--filter" && has_value) options.filter = argv[++i];
+		else if (arg == "--sizes" && has_value) options.sizes = parseSizes(argv[++i]);
+		else if (arg == "--min-time" && has_value) options.min_time = std::atof(argv[++i]);
+		else if (arg == "--max-iterations" && has_value) options.max_iterations = static_cast<size_t>(std::strtoull(argv[++i], nullptr, 10));
+		else if (arg == "--json" && has_value) options.json_path = argv[++i];
+		else if (arg == "--baseline" && has_value) options.baseline_path = argv[++i];
+		else if (arg == "--threshold" && has_value) options.threshold = std::atof(argv[++i]);
+		else {
+			std::fprintf(stderr, "unknown option : %s\n", arg.c_str());
+			return false;
+		}
+	}
+	return !options.sizes.empty() && options.max_iterations > 0;
+}
+
+double percentile(const std::vector<double> & sorted, const double p) {
+	const size_t index = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+	return sorted[std::min(index, sorted.size() - 1)];
+}
+
+/// @brief フィクスチャを1サイズ分計測する
+mpb::bench::Result run(const mpb::bench::Fixture & fixture, const size_t size, const Options & options) {
+	mpb::bench::Result result{ fixture.name, fixture.node_type, size, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, false };
+
+	mpbmock::Node node(fixture.node_type.c_str());
+	fixture.set_up(node, size);
+	const MString output(fixture.output.c_str());
+
+	// 1回目はバッファの確保等を含むため計測しない
+	if (node.compute(output) != MStatus::kSuccess) {
+		result.failed = true;
+		return result;
+	}
+
+	std::vector<double> samples;
+	samples.reserve(std::min<size_t>(options.max_iterations, 1 << 16));
+	const size_t alloc_before = g_allocations.load(std::memory_order_relaxed);
+	const auto begin = std::chrono::steady_clock::now();
+	for (;;) {
+		const auto t0 = std::chrono::steady_clock::now();
+		const MStatus stat = node.compute(output);
+		const auto t1 = std::chrono::steady_clock::now();
+		if (stat != MStatus::kSuccess) {
+			result.failed = true;
+			return result;
+		}
+		samples.push_back(std::chrono::duration<double, std::nano>(t1 - t0).count());
+		if (samples.size() >= options.max_iterations) break;
+		if (samples.size() >= 5 && std::chrono::duration<double>(t1 - begin).count() >= options.min_time) break;
+	}
+	// samplesの伸長分を差し引けないため、確保回数は計測ループ全体の回数を呼び出し回数で割った値
+	const size_t allocs = g_allocations.load(std::memory_order_relaxed) - alloc_before;
+
+	std::vector<double> sorted(samples);
+	std::sort(sorted.begin(), sorted.end());
+	double total = 0.0;
+	for (const double s : samples) total += s;
+
+	result.iterations = samples.size();
+	result.mean_ns = total / static_cast<double>(samples.size());
+	result.p50_ns = percentile(sorted, 0.50);
+	result.p99_ns = percentile(sorted, 0.99);
+	result.min_ns = sorted.front();
+	result.elements_per_sec = (result.p50_ns > 0.0 ? static_cast<double>(size) * 1e9 / result.p50_ns : 0.0);
+	result.allocs_per_call = static_cast<double>(allocs) / static_cast<double>(samples.size());
+	return result;
+}
+
+std::string readFile(const std::string & path) {
+	std::ifstream file(path, std::ios::binary);
+	std::stringstream ss;
+	ss << file.rdbuf();
+	return ss.str();
+}
+
+}
+
+void * operator new(size_t size) {
+	g_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void * p = std::malloc(size ? size : 1)) return p;
+	throw std::bad_alloc();
+}
+void operator delete(void * p) noexcept { std::free(p); }
+void operator delete(void * p, size_t) noexcept { std::free(p); }
+
+
+bool mpb::bench::registerFixture(Fixture && fixture)
+{
+	fixtureList().push_back(std::move(fixture));
+	return true;
+}
+
+const std::vector<mpb::bench::Fixture> & mpb::bench::fixtures(void) { return fixtureList(); }
+
+size_t mpb::bench::allocationCount(void) { return g_allocations.load(std::memory_order_relaxed); }
+
+std::string mpb::bench::toJson(const std::vector<Result> & results)
+{
+	std::string json = "{\n  \"schema\": 1,\n  \"results\": [";
+	char line[1024];
+	for (size_t i = 0; i < results.size(); ++i) {
+		const Result & r = results[i];
+		std::snprintf(line, sizeof(line),
+			"%s\n    {\"fixture\": \"%s\", \"node\": \"%s\", \"size\": %zu, \"iterations\": %zu, \"mean_ns\": %.1f, \"p50_ns\": %.1f, \"p99_ns\": %.1f, \"min_ns\": %.1f, \"elements_per_sec\": %.6g, \"allocs_per_call\": %.3f, \"failed\": %s}",
+			(i == 0 ? "" : ","), r.fixture.c_str(), r.node_type.c_str(), r.size, r.iterations, r.mean_ns, r.p50_ns, r.p99_ns, r.min_ns, r.elements_per_sec, r.allocs_per_call, (r.failed ? "true" : "false"));
+		json += line;
+	}
+	json += "\n  ]\n}\n";
+	return json;
+}
+
+std::vector<mpb::bench::Result> mpb::bench::parseJson(const std::string & json)
+{
+	// toJsonの出力（平坦なオブジェクトの配列）だけを読めればよい
+	std::vector<Result> results;
+	size_t pos = json.find("\"results\"");
+	if (pos == std::string::npos) return results;
+	while ((pos = json.find('{', pos)) != std::string::npos) {
+		const size_t end = json.find('}', pos);
+		if (end == std::string::npos) break;
+		std::map<std::string, std::string> fields;
+		size_t cursor = pos + 1;
+		for (;;) {
+			const size_t key_begin = json.find('"', cursor);
+			if (key_begin == std::string::npos || key_begin > end) break;
+			const size_t key_end = json.find('"', key_begin + 1);
+			const size_t colon = json.find(':', key_end);
+			if (key_end == std::string::npos || colon == std::string::npos || colon > end) break;
+			size_t value = json.find_first_not_of(" \t\r\n", colon + 1);
+			size_t value_end;
+			if (json[value] == '"') {
+				++value;
+				value_end = json.find('"', value);
+				cursor = value_end + 1;
+			}
+			else {
+				value_end = json.find_first_of(",}", value);
+				cursor = value_end;
+			}
+			fields[json.substr(key_begin + 1, key_end - key_begin - 1)] = json.substr(value, value_end - value);
+		}
+		Result r{ fields["fixture"], fields["node"], static_cast<size_t>(std::strtoull(fields["size"].c_str(), nullptr, 10)),
+			static_cast<size_t>(std::strtoull(fields["iterations"].c_str(), nullptr, 10)),
+			std::atof(fields["mean_ns"].c_str()), std::atof(fields["p50_ns"].c_str()), std::atof(fields["p99_ns"].c_str()), std::atof(fields["min_ns"].c_str()),
+			std::atof(fields["elements_per_sec"].c_str()), std::atof(fields["allocs_per_call"].c_str()), fields["failed"] == "true" };
+		if (!r.fixture.empty()) results.push_back(r);
+		pos = end + 1;
+	}
+	return results;
+}
+
+
+int main(int argc, char ** argv)
+{
+	Options options;
+	if (!parseOptions(argc, argv, options)) {
+		std::fprintf(stderr, "usage : %s [--list] [--filter <name>] [--sizes 1,1000,1000000] [--min-time <sec>] [--max-iterations <n>] [--json <file>] [--baseline <file>] [--threshold <ratio>]\n", argv[0]);
+		return 1;
+	}
+
+	mpbmock::PluginScope plugin;
+	if (plugin.status() != MStatus::kSuccess) {
+		std::fprintf(stderr, "failed to load the plug-in\n");
+		return 1;
+	}
+
+	std::set<std::string> covered;
+	for (const mpb::bench::Fixture & fixture : mpb::bench::fixtures()) {
+		if (fixture.register_node) fixture.register_node();
+		covered.insert(fixture.node_type);
+	}
+	for (const auto & node_class : mpbmock::Registry::instance().nodes) {
+		if (covered.count(node_class->name.asChar()) == 0) std::fprintf(stderr, "warning : no fixture for node %s\n", node_class->name.asChar());
+	}
+
+	if (options.list) {
+		for (const mpb::bench::Fixture & fixture : mpb::bench::fixtures()) std::printf("%s\t%s.%s\n", fixture.name.c_str(), fixture.node_type.c_str(), fixture.output.c_str());
+		return 0;
+	}
+
+	std::vector<mpb::bench::Result> results;
+	bool failed = false;
+	std::printf("%-24s %10s %10s %12s %12s %14s %12s\n", "fixture", "size", "iters", "p50_us", "p99_us", "Melem/s", "allocs/call");
+	for (const mpb::bench::Fixture & fixture : mpb::bench::fixtures()) {
+		if (!options.filter.empty() && fixture.name.find(options.filter) == std::string::npos) continue;
+		for (const size_t size : options.sizes) {
+			const mpb::bench::Result r = run(fixture, size, options);
+			results.push_back(r);
+			if (r.failed) {
+				std::printf("%-24s %10zu  FAILED\n", r.fixture.c_str(), r.size);
+				failed = true;
+				continue;
+			}
+			std::printf("%-24s %10zu %10zu %12.3f %12.3f %14.3f %12.3f\n", r.fixture.c_str(), r.size, r.iterations, r.p50_ns * 1e-3, r.p99_ns * 1e-3, r.elements_per_sec * 1e-6, r.allocs_per_call);
+		}
+	}
+
+	if (!options.json_path.empty()) {
+		std::ofstream file(options.json_path, std::ios::binary);
+		file << mpb::bench::toJson(results);
+		if (!file) {
+			std::fprintf(stderr, "failed to write %s\n", options.json_path.c_str());
+			return 1;
+		}
+	}
+
+	bool regressed = false;
+	if (!options.baseline_path.empty()) {
+		const std::vector<mpb::bench::Result> baseline = mpb::bench::parseJson(readFile(options.baseline_path));
+		if (baseline.empty()) {
+			std::fprintf(stderr, "failed to read baseline %s\n", options.baseline_path.c_str());
+			return 1;
+		}
+		std::printf("\n%-24s %10s %12s %12s %8s\n", "fixture", "size", "base_p50_us", "p50_us", "ratio");
+		for (const mpb::bench::Result & r : results) {
+			if (r.failed) continue;
+			const auto base = std::find_if(baseline.begin(), baseline.end(), [&r](const mpb::bench::Result & b) { return b.fixture == r.fixture && b.size == r.size; });
+			if (base == baseline.end() || base->failed || base->p50_ns <= 0.0) {
+				std::printf("%-24s %10zu %12s %12.3f %8s\n", r.fixture.c_str(), r.size, "-", r.p50_ns * 1e-3, "new");
+				continue;
+			}
+			const double ratio = r.p50_ns / base->p50_ns;
+			const bool slower = (ratio > 1.0 + options.threshold);
+			const bool more_allocs = (r.allocs_per_call > base->allocs_per_call + 0.5);
+			std::printf("%-24s %10zu %12.3f %12.3f %8.3f%s%s\n", r.fixture.c_str(), r.size, base->p50_ns * 1e-3, r.p50_ns * 1e-3, ratio,
+				(slower ? "  REGRESSION(time)" : ""), (more_allocs ? "  REGRESSION(allocs)" : ""));
+			regressed = regressed || slower || more_allocs;
+		}
+	}
+
+	if (failed) return 1;
+	return (regressed ? 2 : 0);
+}
@@ -0,0 +1,97 @@
+﻿/// @file BenchHarness.hpp
+/// @brief ノードのcomputeベンチマークハーネス
+///
+/// ヘッドレスビルドでプラグインをロードし、登録されたフィクスチャごとにノードを生成して、
+/// 入力サイズを変えながらcomputeのレイテンシ・スループット・1回あたりのメモリ確保回数を計測します。
+///
+/// addNodesで追加したノードは、bench/fixtures/以下にフィクスチャを1つ登録するだけで計測対象になります。
+///
+/// @code
+/// MPB_BENCH_FIXTURE(myNodeFixture, "myNode", "myNode", "output",
+///     [](mpbmock::Node & node, const size_t size) {
+///         MDoubleArray values(static_cast<unsigned int>(size), 1.0);
+///         MFnDoubleArrayData data;
+///         node.setData("input", data.create(values));
+///     });
+/// @endcode
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_BENCH_HARNESS_HPP_
+#define _MAYA_PLUGIN_BASE_BENCH_HARNESS_HPP_
+
+#include <MockHost.hpp>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace mpb {
+namespace bench {
+
+/// @brief ベンチマークのフィクスチャ
+struct Fixture {
+	std::string name;			///< フィクスチャ名（結果のキー）
+	std::string node_type;		///< addNodesで登録したノードの型名
+	std::string output;			///< 計測でcomputeする出力アトリビュート名
+
+	/// @brief 入力をsize要素分設定する（計測には含まれません）
+	std::function<void(mpbmock::Node &, size_t)> set_up;
+
+	/// @brief プラグイン外のノードを使う場合の登録関数（省略可）
+	std::function<void(void)> register_node;
+};
+
+
+/// @brief フィクスチャを登録する
+///
+/// 静的初期化から呼び出すため、MPB_BENCH_FIXTUREマクロを使用してください。
+///
+/// @return 常にtrue
+///
+bool registerFixture(Fixture && fixture);
+
+
+/// @brief 登録済みのフィクスチャ
+const std::vector<Fixture> & fixtures(void);
+
+
+/// @brief 計測結果1件
+struct Result {
+	std::string fixture;
+	std::string node_type;
+	size_t size;				///< 入力の要素数
+	size_t iterations;			///< 計測した呼び出し回数
+	double mean_ns;
+	double p50_ns;
+	double p99_ns;
+	double min_ns;
+	double elements_per_sec;	///< size / p50
+	double allocs_per_call;		///< 1回のcomputeあたりのoperator new呼び出し回数
+	bool failed;				///< computeが失敗したか
+};
+
+
+/// @brief 結果をJSONで書き出す
+std::string toJson(const std::vector<Result> & results);
+
+
+/// @brief toJsonで書き出したJSONを読み込む
+///
+/// @return 読み込めた結果。形式が不正な場合は空
+///
+std::vector<Result> parseJson(const std::string & json);
+
+
+/// @brief これまでのoperator new呼び出し回数
+size_t allocationCount(void);
+
+}; // end of bench
+}; // end of mpb
+
+/// @brief フィクスチャを静的に登録するマクロ
+///
+/// 引数はFixtureのメンバの順です（name, node_type, output, set_up[, register_node]）。
+///
+#define MPB_BENCH_FIXTURE(ident, ...) \
+	static const bool ident##_registered_ = ::mpb::bench::registerFixture(::mpb::bench::Fixture{ __VA_ARGS__ })
+
+#endif // end of _MAYA_PLUGIN_BASE_BENCH_HARNESS_HPP_
@@ -0,0 +1,226 @@
+/// @file MockHost.hpp
+/// @brief Maya スタンドインの内部データ構造とヘッドレスホスト API
+///
+/// プラグインのロード、ノードの生成、入力値の設定と出力の評価、コマンドとトランスレーターの実行を
+/// Maya なしで行うためのユーティリティです。ベンチマークやプロファイル用のホストから利用します。
+
+#pragma once
+#ifndef MAYA_PLUGIN_BASE_MOCK_HOST_HPP_
+#define MAYA_PLUGIN_BASE_MOCK_HOST_HPP_
+
+#include <maya/MockCore.h>
+#include <functional>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace mpbmock {
+
+/// @brief MObject が指す実体の基底
+struct Entity {
+	explicit Entity(MFn::Type type) : api_type(type) {}
+	virtual ~Entity(void) {}
+	MFn::Type api_type;
+};
+
+/// @brief アトリビュート定義
+struct AttributeData : public Entity {
+	enum Kind { kNumeric, kNumericCompound, kEnum, kUnit, kTyped, kCompound, kMessage };
+
+	AttributeData(MFn::Type type, Kind kind) : Entity(type), kind(kind) {}
+
+	Kind kind;
+	std::string long_name;
+	std::string short_name;
+	MFnNumericData::Type numeric_type = MFnNumericData::kInvalid;
+	MFnUnitAttribute::Type unit_type = MFnUnitAttribute::kInvalid;
+	MFnData::Type data_type = MFnData::kInvalid;
+	double defaults[4] = { 0.0, 0.0, 0.0, 0.0 };
+	MObject default_data;
+	bool readable = true, writable = true, storable = true, cached = true, keyable = false, array = false, hidden = false, uses_array_builder = false;
+	std::vector<std::pair<std::string, short>> fields;
+	std::vector<AttributeData *> children;
+	AttributeData * parent = nullptr;
+};
+
+/// @brief 型付きデータの実体
+template <class T, MFn::Type kApiType>
+struct ArrayDataEntity : public Entity {
+	ArrayDataEntity(void) : Entity(kApiType) {}
+	T array;
+};
+typedef ArrayDataEntity<MDoubleArray, MFn::kDoubleArrayData> DoubleArrayEntity;
+typedef ArrayDataEntity<MIntArray, MFn::kIntArrayData> IntArrayEntity;
+typedef ArrayDataEntity<MPointArray, MFn::kPointArrayData> PointArrayEntity;
+typedef ArrayDataEntity<MVectorArray, MFn::kVectorArrayData> VectorArrayEntity;
+typedef ArrayDataEntity<MString, MFn::kStringData> StringEntity;
+
+/// @brief プラグ一つ分の値
+struct Value {
+	bool b = false;
+	char c = 0;
+	short s = 0;
+	int i = 0;
+	float f[3] = { 0.0f, 0.0f, 0.0f };
+	double d[4] = { 0.0, 0.0, 0.0, 0.0 };
+	MMatrix matrix;
+	MString string;
+	MObject data;
+	std::map<unsigned int, Value> elements;
+	std::map<const AttributeData *, Value> children;
+	bool clean = false;
+	bool initialized = false;
+};
+
+/// @brief 登録済みノードクラス
+struct NodeClass {
+	MString name;
+	MTypeId id;
+	void * (*creator)() = nullptr;
+	MStatus (*initialize)() = nullptr;
+	MPxNode::Type type = MPxNode::kDependNode;
+	MString classification;
+	std::vector<MObject> attributes;
+	std::multimap<const AttributeData *, const AttributeData *> affects;
+};
+
+/// @brief ノードインスタンスの実体
+struct NodeEntity : public Entity {
+	NodeEntity(void) : Entity(MFn::kDependencyNode) {}
+	NodeClass * node_class = nullptr;
+	MString name;
+	MPxNode * user = nullptr;
+	std::map<const AttributeData *, Value> values;
+};
+
+/// @brief アトリビュートの値を既定値で初期化します
+void initializeValue(Value & value, const AttributeData * attribute);
+
+/// @brief 登録済みコマンド
+struct CommandClass {
+	MString name;
+	void * (*creator)() = nullptr;
+};
+
+/// @brief 登録済みトランスレーター
+struct TranslatorClass {
+	MString name;
+	void * (*creator)() = nullptr;
+	MString options_script;
+	MString default_options;
+};
+
+/// @brief 登録テーブル
+struct Registry {
+	std::vector<std::unique_ptr<NodeClass>> nodes;
+	std::vector<CommandClass> commands;
+	std::vector<TranslatorClass> translators;
+	NodeClass * initializing = nullptr;
+	std::vector<MString> idle_commands;
+	std::mutex idle_mutex;	///< executeCommandOnIdle はワーカースレッドからも呼ばれる
+	std::function<void(const MString &)> on_idle_command;
+	static Registry & instance(void);
+	NodeClass * findNode(const MString & name);
+	CommandClass * findCommand(const MString & name);
+	TranslatorClass * findTranslator(const MString & name);
+};
+
+/// @brief ヘッドレス環境のノードインスタンス
+///
+/// MPxNode の生成からデータブロックの管理、評価までを行います。
+///
+class Node {
+public:
+	explicit Node(const MString & type_name, const MString & name = "");
+	~Node(void);
+
+	Node(const Node &) = delete;
+	Node & operator=(const Node &) = delete;
+
+	MPxNode * user(void) const { return entity_->user; }
+	MObject object(void) const { return object_; }
+	MObject attribute(const MString & name) const;
+	MPlug plug(const MString & attribute_name) const;
+	MDataBlock dataBlock(void) const { return MDataBlock(entity_.get()); }
+	Value & value(const MString & attribute_name);
+
+	/// @brief 入力値を設定し、影響先を dirty にします
+	void setDouble(const MString & attribute_name, double value);
+	void setInt(const MString & attribute_name, int value);
+	void setBool(const MString & attribute_name, bool value);
+	void setTime(const MString & attribute_name, const MTime & value);
+	void setString(const MString & attribute_name, const MString & value);
+	void setData(const MString & attribute_name, const MObject & data);
+	void setArrayElementDouble(const MString & attribute_name, unsigned int index, double value);
+
+	/// @brief 出力を評価します。dirty な場合のみ compute が呼ばれます。
+	MStatus evaluate(const MString & attribute_name);
+	/// @brief dirty 状態に関わらず compute を呼び出します
+	MStatus compute(const MString & attribute_name);
+
+	double getDouble(const MString & attribute_name);
+	MObject getData(const MString & attribute_name);
+
+	/// @brief 入力を変更したものとして影響先を dirty にします
+	void dirty(const MString & attribute_name);
+
+private:
+	std::shared_ptr<NodeEntity> entity_;
+	MObject object_;
+	void propagateDirty(const AttributeData * source);
+};
+
+/// @brief 登録済みコマンドを実行します
+///
+/// @param [in] name コマンド名
+/// @param [in] args 引数
+/// @param [out] result setResult された値
+/// @param [out] instance undo/redo 用に保持するインスタンス(nullptr 可)
+///
+MStatus executeCommand(const MString & name, const MArgList & args, MString * result = nullptr, std::unique_ptr<MPxCommand> * instance = nullptr);
+
+/// @brief 最後に setResult された値
+MString lastCommandResult(void);
+
+/// @brief 登録済みトランスレーターで読み込みます
+MStatus importFile(const MString & translator_name, const MString & path, const MString & options = "");
+
+/// @brief 登録済みトランスレーターで書き出します
+MStatus exportFile(const MString & translator_name, const MString & path, const MString & options = "");
+
+/// @brief executeCommandOnIdle で積まれたコマンドを処理します
+void flushIdleQueue(void);
+
+}
+
+// プラグイン側(main.cpp)で定義されるエントリポイント
+MStatus initializePlugin(MObject obj);
+MStatus uninitializePlugin(MObject obj);
+
+namespace mpbmock {
+
+/// @brief プラグインのロード・アンロードを行うスコープ
+///
+/// コンストラクタで initializePlugin を、デストラクタで uninitializePlugin を呼び出します。
+/// ヘッドレスのホストでは main の先頭で生成してください。
+///
+class PluginScope {
+public:
+	PluginScope(void) : status_(initializePlugin(MObject())) {}
+	~PluginScope(void) { uninitializePlugin(MObject()); }
+
+	PluginScope(const PluginScope &) = delete;
+	PluginScope & operator=(const PluginScope &) = delete;
+
+	/// @brief initializePlugin の戻り値
+	MStatus status(void) const { return status_; }
+
+private:
+	MStatus status_;
+};
+
+}
+
+#endif // MAYA_PLUGIN_BASE_MOCK_HOST_HPP_
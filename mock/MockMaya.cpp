@@ -0,0 +1,1154 @@
+#include "MockHost.hpp"
+#include <maya/MockCore.h>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using namespace mpbmock;
+
+namespace {
+
+AttributeData * attr(const MObject & obj) {
+	return dynamic_cast<AttributeData *>(obj._entity());
+}
+
+std::shared_ptr<AttributeData> newAttribute(MFn::Type type, AttributeData::Kind kind, const MString & full_name, const MString & brief_name) {
+	auto data = std::make_shared<AttributeData>(type, kind);
+	data->long_name = full_name.asChar();
+	data->short_name = brief_name.asChar();
+	return data;
+}
+
+void setStatus(MStatus * status, MStatus value) { if (status) *status = value; }
+
+MString & resultBuffer(void) {
+	static MString result;
+	return result;
+}
+
+template <class EntityT>
+EntityT * dataEntity(const MObject & obj) {
+	return dynamic_cast<EntityT *>(obj._entity());
+}
+
+template <class EntityT, class ArrayT>
+MObject createArrayData(MObject & object, const ArrayT & array, MStatus * status) {
+	auto entity = std::make_shared<EntityT>();
+	entity->array = array;
+	object = MObject(entity);
+	setStatus(status, MStatus::kSuccess);
+	return object;
+}
+
+MObject createDataForType(MFnData::Type type) {
+	switch (type) {
+	case MFnData::kDoubleArray: return MObject(std::make_shared<DoubleArrayEntity>());
+	case MFnData::kIntArray: return MObject(std::make_shared<IntArrayEntity>());
+	case MFnData::kPointArray: return MObject(std::make_shared<PointArrayEntity>());
+	case MFnData::kVectorArray: return MObject(std::make_shared<VectorArrayEntity>());
+	case MFnData::kString: return MObject(std::make_shared<StringEntity>());
+	default: return MObject();
+	}
+}
+
+MObject cloneData(const MObject & obj) {
+	if (obj.isNull()) return obj;
+	if (auto e = dataEntity<DoubleArrayEntity>(obj)) { auto c = std::make_shared<DoubleArrayEntity>(); c->array = e->array; return MObject(c); }
+	if (auto e = dataEntity<IntArrayEntity>(obj)) { auto c = std::make_shared<IntArrayEntity>(); c->array = e->array; return MObject(c); }
+	if (auto e = dataEntity<PointArrayEntity>(obj)) { auto c = std::make_shared<PointArrayEntity>(); c->array = e->array; return MObject(c); }
+	if (auto e = dataEntity<VectorArrayEntity>(obj)) { auto c = std::make_shared<VectorArrayEntity>(); c->array = e->array; return MObject(c); }
+	if (auto e = dataEntity<StringEntity>(obj)) { auto c = std::make_shared<StringEntity>(); c->array = e->array; return MObject(c); }
+	return obj;
+}
+
+MObject builtinAttribute(const char * long_name, const char * short_name, AttributeData::Kind kind, MFnNumericData::Type numeric_type) {
+	auto data = newAttribute(kind == AttributeData::kEnum ? MFn::kEnumAttribute : (kind == AttributeData::kMessage ? MFn::kMessageAttribute : MFn::kNumericAttribute), kind, long_name, short_name);
+	data->numeric_type = numeric_type;
+	return MObject(data);
+}
+
+Value & valueOf(NodeEntity * node, const AttributeData * attribute) {
+	Value & v = node->values[attribute];
+	if (!v.initialized) initializeValue(v, attribute);
+	return v;
+}
+
+std::string pathName(const MString & path) {
+	return std::string(path.asChar());
+}
+
+} // namespace
+
+///////////////////////////////////////////////////////////////////////////////
+// 静的メンバ
+
+const MObject MObject::kNullObj;
+const MMatrix MMatrix::identity;
+MObject MPxNode::message = builtinAttribute("message", "msg", AttributeData::kMessage, MFnNumericData::kInvalid);
+MObject MPxNode::isHistoricallyInteresting = builtinAttribute("isHistoricallyInteresting", "ihi", AttributeData::kNumeric, MFnNumericData::kByte);
+MObject MPxNode::caching = builtinAttribute("caching", "cch", AttributeData::kNumeric, MFnNumericData::kBoolean);
+MObject MPxNode::state = builtinAttribute("nodeState", "nds", AttributeData::kEnum, MFnNumericData::kShort);
+MObject MPxNode::frozen = builtinAttribute("frozen", "fzn", AttributeData::kNumeric, MFnNumericData::kBoolean);
+
+///////////////////////////////////////////////////////////////////////////////
+// MString / MStatus / MObject
+
+bool MString::isDouble(void) const {
+	if (str_.empty()) return false;
+	char * end = nullptr;
+	std::strtod(str_.c_str(), &end);
+	return end && *end == '\0';
+}
+
+bool MString::isInt(void) const {
+	if (str_.empty()) return false;
+	char * end = nullptr;
+	std::strtol(str_.c_str(), &end, 10);
+	return end && *end == '\0';
+}
+
+void MString::split(char delimiter, std::vector<MString> & output) const {
+	output.clear();
+	std::string token;
+	std::istringstream iss(str_);
+	while (std::getline(iss, token, delimiter)) {
+		if (!token.empty()) output.push_back(MString(token));
+	}
+}
+
+MString MStatus::errorString(void) const {
+	switch (code_) {
+	case kSuccess: return "Success";
+	case kFailure: return "Failure";
+	case kInsufficientMemory: return "Insufficient memory";
+	case kInvalidParameter: return "Invalid parameter";
+	case kLicenseFailure: return "License failure";
+	case kUnknownParameter: return "Unexpected Internal Failure";
+	case kNotImplemented: return "Not implemented";
+	case kNotFound: return "Not found";
+	case kEndOfFile: return "End of file";
+	}
+	return "Unknown";
+}
+
+MFn::Type MObject::apiType(void) const { return entity_ ? entity_->api_type : MFn::kInvalid; }
+
+bool MObject::hasFn(MFn::Type type) const {
+	if (!entity_) return false;
+	if (entity_->api_type == type) return true;
+	if (type == MFn::kAttribute) return dynamic_cast<AttributeData *>(entity_.get()) != nullptr;
+	if (type == MFn::kData) return entity_->api_type >= MFn::kData;
+	return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// 数学型
+
+MMatrix MMatrix::operator*(const MMatrix & right) const {
+	MMatrix ret;
+	for (int r = 0; r < 4; ++r) {
+		for (int c = 0; c < 4; ++c) {
+			double sum = 0.0;
+			for (int k = 0; k < 4; ++k) sum += matrix[r][k] * right.matrix[k][c];
+			ret.matrix[r][c] = sum;
+		}
+	}
+	return ret;
+}
+
+bool MMatrix::operator==(const MMatrix & other) const {
+	for (int r = 0; r < 4; ++r) for (int c = 0; c < 4; ++c) if (matrix[r][c] != other.matrix[r][c]) return false;
+	return true;
+}
+
+MVector::MVector(const MPoint & p) : x(p.x), y(p.y), z(p.z) {}
+
+MPoint MPoint::operator*(const MMatrix & m) const {
+	return MPoint(
+		x * m.matrix[0][0] + y * m.matrix[1][0] + z * m.matrix[2][0] + w * m.matrix[3][0],
+		x * m.matrix[0][1] + y * m.matrix[1][1] + z * m.matrix[2][1] + w * m.matrix[3][1],
+		x * m.matrix[0][2] + y * m.matrix[1][2] + z * m.matrix[2][2] + w * m.matrix[3][2],
+		x * m.matrix[0][3] + y * m.matrix[1][3] + z * m.matrix[2][3] + w * m.matrix[3][3]);
+}
+
+double MDistance::asCentimeters(void) const {
+	switch (unit_) {
+	case kInches: return value_ * 2.54;
+	case kFeet: return value_ * 30.48;
+	case kYards: return value_ * 91.44;
+	case kMiles: return value_ * 160934.4;
+	case kMillimeters: return value_ * 0.1;
+	case kKilometers: return value_ * 100000.0;
+	case kMeters: return value_ * 100.0;
+	default: return value_;
+	}
+}
+
+double MTime::as(Unit unit) const {
+	auto per_second = [](Unit u) -> double {
+		switch (u) {
+		case kHours: return 1.0 / 3600.0;
+		case kMinutes: return 1.0 / 60.0;
+		case kMilliseconds: return 1000.0;
+		case kGames: return 15.0;
+		case kFilm: return 24.0;
+		case kPALFrame: return 25.0;
+		case kNTSCFrame: return 30.0;
+		case kShowScan: return 48.0;
+		case kPALField: return 50.0;
+		case kNTSCField: return 60.0;
+		default: return 1.0;
+		}
+	};
+	return value_ / per_second(unit_) * per_second(unit);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// アトリビュート
+
+AttributeData * MFnAttribute::_data(void) const { return attr(object_); }
+MString MFnAttribute::name(void) const { auto d = _data(); return d ? MString(d->long_name) : MString(); }
+MString MFnAttribute::shortName(void) const { auto d = _data(); return d ? MString(d->short_name) : MString(); }
+bool MFnAttribute::isReadable(void) const { return _data()->readable; }
+bool MFnAttribute::isWritable(void) const { return _data()->writable; }
+bool MFnAttribute::isStorable(void) const { return _data()->storable; }
+bool MFnAttribute::isCached(void) const { return _data()->cached; }
+bool MFnAttribute::isKeyable(void) const { return _data()->keyable; }
+bool MFnAttribute::isArray(void) const { return _data()->array; }
+MStatus MFnAttribute::setReadable(bool state) { if (!_data()) return MStatus::kFailure; _data()->readable = state; return MStatus::kSuccess; }
+MStatus MFnAttribute::setWritable(bool state) { if (!_data()) return MStatus::kFailure; _data()->writable = state; return MStatus::kSuccess; }
+MStatus MFnAttribute::setStorable(bool state) { if (!_data()) return MStatus::kFailure; _data()->storable = state; return MStatus::kSuccess; }
+MStatus MFnAttribute::setCached(bool state) { if (!_data()) return MStatus::kFailure; _data()->cached = state; return MStatus::kSuccess; }
+MStatus MFnAttribute::setKeyable(bool state) { if (!_data()) return MStatus::kFailure; _data()->keyable = state; return MStatus::kSuccess; }
+MStatus MFnAttribute::setArray(bool state) { if (!_data()) return MStatus::kFailure; _data()->array = state; return MStatus::kSuccess; }
+MStatus MFnAttribute::setHidden(bool state) { if (!_data()) return MStatus::kFailure; _data()->hidden = state; return MStatus::kSuccess; }
+MStatus MFnAttribute::setUsesArrayDataBuilder(bool state) { if (!_data()) return MStatus::kFailure; _data()->uses_array_builder = state; return MStatus::kSuccess; }
+
+MObject MFnNumericAttribute::create(const MString & full_name, const MString & brief_name, MFnNumericData::Type type, double default_value, MStatus * status) {
+	auto data = newAttribute(MFn::kNumericAttribute, AttributeData::kNumeric, full_name, brief_name);
+	data->numeric_type = type;
+	data->defaults[0] = data->defaults[1] = data->defaults[2] = default_value;
+	object_ = MObject(data);
+	setStatus(status, MStatus::kSuccess);
+	return object_;
+}
+
+MObject MFnNumericAttribute::create(const MString & full_name, const MString & brief_name, const MObject & child1, const MObject & child2, const MObject & child3, MStatus * status) {
+	auto data = newAttribute(MFn::kNumericAttribute, AttributeData::kNumericCompound, full_name, brief_name);
+	for (const MObject * child : { &child1, &child2, &child3 }) {
+		if (auto c = attr(*child)) {
+			data->children.push_back(c);
+			c->parent = data.get();
+		}
+	}
+	data->numeric_type = data->children.size() == 3 ? MFnNumericData::k3Double : MFnNumericData::k2Double;
+	object_ = MObject(data);
+	setStatus(status, MStatus::kSuccess);
+	return object_;
+}
+
+MObject MFnNumericAttribute::createPoint(const MString & full_name, const MString & brief_name, MStatus * status) {
+	MObject obj = create(full_name, brief_name, MFnNumericData::k3Double, 0.0, status);
+	return obj;
+}
+
+MFnNumericData::Type MFnNumericAttribute::unitType(MStatus * status) const { setStatus(status, MStatus::kSuccess); return _data()->numeric_type; }
+MStatus MFnNumericAttribute::setMin(double) { return MStatus::kSuccess; }
+MStatus MFnNumericAttribute::setMax(double) { return MStatus::kSuccess; }
+MStatus MFnNumericAttribute::setDefault(double value) { _data()->defaults[0] = value; return MStatus::kSuccess; }
+
+MObject MFnEnumAttribute::create(const MString & full_name, const MString & brief_name, short default_value, MStatus * status) {
+	auto data = newAttribute(MFn::kEnumAttribute, AttributeData::kEnum, full_name, brief_name);
+	data->numeric_type = MFnNumericData::kShort;
+	data->defaults[0] = default_value;
+	object_ = MObject(data);
+	setStatus(status, MStatus::kSuccess);
+	return object_;
+}
+
+MStatus MFnEnumAttribute::addField(const MString & name, short index) {
+	if (!_data()) return MStatus::kFailure;
+	_data()->fields.emplace_back(name.asChar(), index);
+	return MStatus::kSuccess;
+}
+
+MString MFnEnumAttribute::fieldName(short index, MStatus * status) const {
+	for (const auto & f : _data()->fields) {
+		if (f.second == index) { setStatus(status, MStatus::kSuccess); return MString(f.first); }
+	}
+	setStatus(status, MStatus::kInvalidParameter);
+	return MString();
+}
+
+MObject MFnUnitAttribute::create(const MString & full_name, const MString & brief_name, const MAngle & default_value, MStatus * status) {
+	auto data = newAttribute(MFn::kUnitAttribute, AttributeData::kUnit, full_name, brief_name);
+	data->unit_type = kAngle;
+	data->defaults[0] = default_value.asRadians();
+	object_ = MObject(data);
+	setStatus(status, MStatus::kSuccess);
+	return object_;
+}
+
+MObject MFnUnitAttribute::create(const MString & full_name, const MString & brief_name, const MDistance & default_value, MStatus * status) {
+	auto data = newAttribute(MFn::kUnitAttribute, AttributeData::kUnit, full_name, brief_name);
+	data->unit_type = kDistance;
+	data->defaults[0] = default_value.asCentimeters();
+	object_ = MObject(data);
+	setStatus(status, MStatus::kSuccess);
+	return object_;
+}
+
+MObject MFnUnitAttribute::create(const MString & full_name, const MString & brief_name, const MTime & default_value, MStatus * status) {
+	auto data = newAttribute(MFn::kUnitAttribute, AttributeData::kUnit, full_name, brief_name);
+	data->unit_type = kTime;
+	data->defaults[0] = default_value.as(MTime::kFilm);
+	object_ = MObject(data);
+	setStatus(status, MStatus::kSuccess);
+	return object_;
+}
+
+MFnUnitAttribute::Type MFnUnitAttribute::unitType(MStatus * status) const { setStatus(status, MStatus::kSuccess); return _data()->unit_type; }
+
+MObject MFnTypedAttribute::create(const MString & full_name, const MString & brief_name, MFnData::Type type, const MObject & default_value, MStatus * status) {
+	auto data = newAttribute(MFn::kTypedAttribute, AttributeData::kTyped, full_name, brief_name);
+	data->data_type = type;
+	data->default_data = default_value;
+	object_ = MObject(data);
+	setStatus(status, MStatus::kSuccess);
+	return object_;
+}
+
+MObject MFnTypedAttribute::create(const MString & full_name, const MString & brief_name, MFnData::Type type, MStatus * status) {
+	return create(full_name, brief_name, type, MObject::kNullObj, status);
+}
+
+MFnData::Type MFnTypedAttribute::attrType(MStatus * status) const { setStatus(status, MStatus::kSuccess); return _data()->data_type; }
+
+MObject MFnCompoundAttribute::create(const MString & full_name, const MString & brief_name, MStatus * status) {
+	auto data = newAttribute(MFn::kCompoundAttribute, AttributeData::kCompound, full_name, brief_name);
+	object_ = MObject(data);
+	setStatus(status, MStatus::kSuccess);
+	return object_;
+}
+
+MStatus MFnCompoundAttribute::addChild(const MObject & child) {
+	auto c = attr(child);
+	if (!c || !_data()) return MStatus::kInvalidParameter;
+	_data()->children.push_back(c);
+	c->parent = _data();
+	return MStatus::kSuccess;
+}
+
+unsigned int MFnCompoundAttribute::numChildren(MStatus * status) const { setStatus(status, MStatus::kSuccess); return static_cast<unsigned int>(_data()->children.size()); }
+
+MObject MFnCompoundAttribute::child(unsigned int index, MStatus * status) const {
+	// 子アトリビュートはクラス登録時のアトリビュート一覧から MObject を探す
+	AttributeData * c = _data()->children.at(index);
+	for (const auto & cls : Registry::instance().nodes) {
+		for (const auto & a : cls->attributes) {
+			if (a._entity() == c) { setStatus(status, MStatus::kSuccess); return a; }
+		}
+	}
+	setStatus(status, MStatus::kNotFound);
+	return MObject();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// 型付きデータ
+
+MFnDoubleArrayData::MFnDoubleArrayData(const MObject & obj, MStatus * status) { object_ = obj; setStatus(status, dataEntity<DoubleArrayEntity>(obj) ? MStatus::kSuccess : MStatus::kInvalidParameter); }
+MObject MFnDoubleArrayData::create(const MDoubleArray & array, MStatus * status) { return createArrayData<DoubleArrayEntity>(object_, array, status); }
+MObject MFnDoubleArrayData::create(MStatus * status) { return createArrayData<DoubleArrayEntity>(object_, MDoubleArray(), status); }
+MDoubleArray MFnDoubleArrayData::array(MStatus * status) { auto e = dataEntity<DoubleArrayEntity>(object_); setStatus(status, e ? MStatus::kSuccess : MStatus::kFailure); return e ? e->array : MDoubleArray(); }
+MStatus MFnDoubleArrayData::set(const MDoubleArray & array) { auto e = dataEntity<DoubleArrayEntity>(object_); if (!e) return MStatus::kFailure; e->array = array; return MStatus::kSuccess; }
+unsigned int MFnDoubleArrayData::length(MStatus * status) const { auto e = dataEntity<DoubleArrayEntity>(object_); setStatus(status, e ? MStatus::kSuccess : MStatus::kFailure); return e ? e->array.length() : 0; }
+MStatus MFnDoubleArrayData::copyTo(MDoubleArray & array) const { auto e = dataEntity<DoubleArrayEntity>(object_); if (!e) return MStatus::kFailure; array = e->array; return MStatus::kSuccess; }
+double MFnDoubleArrayData::operator[](unsigned int index) const { return dataEntity<DoubleArrayEntity>(object_)->array[index]; }
+double & MFnDoubleArrayData::operator[](unsigned int index) { return dataEntity<DoubleArrayEntity>(object_)->array[index]; }
+std::vector<double> * MFnDoubleArrayData::_items(void) const { auto e = dataEntity<DoubleArrayEntity>(object_); return e ? &e->array._items() : nullptr; }
+
+MFnIntArrayData::MFnIntArrayData(const MObject & obj, MStatus * status) { object_ = obj; setStatus(status, dataEntity<IntArrayEntity>(obj) ? MStatus::kSuccess : MStatus::kInvalidParameter); }
+MObject MFnIntArrayData::create(const MIntArray & array, MStatus * status) { return createArrayData<IntArrayEntity>(object_, array, status); }
+MIntArray MFnIntArrayData::array(MStatus * status) { auto e = dataEntity<IntArrayEntity>(object_); setStatus(status, e ? MStatus::kSuccess : MStatus::kFailure); return e ? e->array : MIntArray(); }
+MStatus MFnIntArrayData::set(const MIntArray & array) { auto e = dataEntity<IntArrayEntity>(object_); if (!e) return MStatus::kFailure; e->array = array; return MStatus::kSuccess; }
+unsigned int MFnIntArrayData::length(MStatus * status) const { auto e = dataEntity<IntArrayEntity>(object_); setStatus(status, e ? MStatus::kSuccess : MStatus::kFailure); return e ? e->array.length() : 0; }
+
+MFnPointArrayData::MFnPointArrayData(const MObject & obj, MStatus * status) { object_ = obj; setStatus(status, dataEntity<PointArrayEntity>(obj) ? MStatus::kSuccess : MStatus::kInvalidParameter); }
+MObject MFnPointArrayData::create(const MPointArray & array, MStatus * status) { return createArrayData<PointArrayEntity>(object_, array, status); }
+MObject MFnPointArrayData::create(MStatus * status) { return createArrayData<PointArrayEntity>(object_, MPointArray(), status); }
+MPointArray MFnPointArrayData::array(MStatus * status) { auto e = dataEntity<PointArrayEntity>(object_); setStatus(status, e ? MStatus::kSuccess : MStatus::kFailure); return e ? e->array : MPointArray(); }
+MStatus MFnPointArrayData::set(const MPointArray & array) { auto e = dataEntity<PointArrayEntity>(object_); if (!e) return MStatus::kFailure; e->array = array; return MStatus::kSuccess; }
+unsigned int MFnPointArrayData::length(MStatus * status) const { auto e = dataEntity<PointArrayEntity>(object_); setStatus(status, e ? MStatus::kSuccess : MStatus::kFailure); return e ? e->array.length() : 0; }
+MStatus MFnPointArrayData::copyTo(MPointArray & array) const { auto e = dataEntity<PointArrayEntity>(object_); if (!e) return MStatus::kFailure; array = e->array; return MStatus::kSuccess; }
+
+MFnVectorArrayData::MFnVectorArrayData(const MObject & obj, MStatus * status) { object_ = obj; setStatus(status, dataEntity<VectorArrayEntity>(obj) ? MStatus::kSuccess : MStatus::kInvalidParameter); }
+MObject MFnVectorArrayData::create(const MVectorArray & array, MStatus * status) { return createArrayData<VectorArrayEntity>(object_, array, status); }
+MObject MFnVectorArrayData::create(MStatus * status) { return createArrayData<VectorArrayEntity>(object_, MVectorArray(), status); }
+MVectorArray MFnVectorArrayData::array(MStatus * status) { auto e = dataEntity<VectorArrayEntity>(object_); setStatus(status, e ? MStatus::kSuccess : MStatus::kFailure); return e ? e->array : MVectorArray(); }
+MStatus MFnVectorArrayData::set(const MVectorArray & array) { auto e = dataEntity<VectorArrayEntity>(object_); if (!e) return MStatus::kFailure; e->array = array; return MStatus::kSuccess; }
+unsigned int MFnVectorArrayData::length(MStatus * status) const { auto e = dataEntity<VectorArrayEntity>(object_); setStatus(status, e ? MStatus::kSuccess : MStatus::kFailure); return e ? e->array.length() : 0; }
+MStatus MFnVectorArrayData::copyTo(MVectorArray & array) const { auto e = dataEntity<VectorArrayEntity>(object_); if (!e) return MStatus::kFailure; array = e->array; return MStatus::kSuccess; }
+
+MFnStringData::MFnStringData(const MObject & obj, MStatus * status) { object_ = obj; setStatus(status, dataEntity<StringEntity>(obj) ? MStatus::kSuccess : MStatus::kInvalidParameter); }
+MObject MFnStringData::create(const MString & str, MStatus * status) { return createArrayData<StringEntity>(object_, str, status); }
+MObject MFnStringData::create(MStatus * status) { return createArrayData<StringEntity>(object_, MString(), status); }
+MString MFnStringData::string(MStatus * status) const { auto e = dataEntity<StringEntity>(object_); setStatus(status, e ? MStatus::kSuccess : MStatus::kFailure); return e ? e->array : MString(); }
+MStatus MFnStringData::set(const MString & str) { auto e = dataEntity<StringEntity>(object_); if (!e) return MStatus::kFailure; e->array = str; return MStatus::kSuccess; }
+
+///////////////////////////////////////////////////////////////////////////////
+// 値の初期化
+
+void mpbmock::initializeValue(Value & value, const AttributeData * attribute) {
+	value.initialized = true;
+	if (!attribute) return;
+	value.b = attribute->defaults[0] != 0.0;
+	value.c = static_cast<char>(attribute->defaults[0]);
+	value.s = static_cast<short>(attribute->defaults[0]);
+	value.i = static_cast<int>(attribute->defaults[0]);
+	for (int i = 0; i < 3; ++i) value.f[i] = static_cast<float>(attribute->defaults[i]);
+	for (int i = 0; i < 4; ++i) value.d[i] = attribute->defaults[i];
+	if (attribute->kind == AttributeData::kTyped) {
+		value.data = attribute->default_data.isNull() ? MObject() : cloneData(attribute->default_data);
+	}
+	if (attribute->kind == AttributeData::kNumericCompound) {
+		for (size_t i = 0; i < attribute->children.size() && i < 4; ++i) {
+			value.d[i] = attribute->children[i]->defaults[0];
+			value.f[i < 3 ? i : 2] = static_cast<float>(attribute->children[i]->defaults[0]);
+		}
+	}
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MPlug
+
+MString MPlug::name(MStatus * status) const {
+	setStatus(status, MStatus::kSuccess);
+	auto node = dynamic_cast<NodeEntity *>(node_._entity());
+	MString ret = node ? node->name : MString("<null>");
+	ret += ".";
+	ret += partialName();
+	return ret;
+}
+
+MString MPlug::partialName(bool include_node_name, bool, bool, bool, bool, bool use_long_names, MStatus * status) const {
+	setStatus(status, MStatus::kSuccess);
+	auto a = attr(attribute_);
+	MString ret;
+	if (include_node_name) {
+		auto node = dynamic_cast<NodeEntity *>(node_._entity());
+		if (node) { ret += node->name; ret += "."; }
+	}
+	if (a) ret += (use_long_names ? a->long_name : a->short_name).c_str();
+	if (logical_index_ >= 0) { ret += "["; ret += logical_index_; ret += "]"; }
+	return ret;
+}
+
+bool MPlug::isArray(MStatus * status) const {
+	setStatus(status, MStatus::kSuccess);
+	auto a = attr(attribute_);
+	return a && a->array && logical_index_ < 0;
+}
+
+MPlug MPlug::elementByLogicalIndex(unsigned int index, MStatus * status) const {
+	setStatus(status, MStatus::kSuccess);
+	MPlug ret(node_, attribute_);
+	ret.logical_index_ = static_cast<int>(index);
+	return ret;
+}
+
+MPlug MPlug::array(MStatus * status) const {
+	setStatus(status, MStatus::kSuccess);
+	return MPlug(node_, attribute_);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MDataHandle
+
+bool MDataHandle::isNumeric(void) const { return attribute_ && (attribute_->kind == AttributeData::kNumeric || attribute_->kind == AttributeData::kEnum); }
+MFnNumericData::Type MDataHandle::numericType(void) const { return attribute_ ? attribute_->numeric_type : MFnNumericData::kInvalid; }
+MFnData::Type MDataHandle::type(void) const {
+	if (!attribute_) return MFnData::kInvalid;
+	if (attribute_->kind == AttributeData::kTyped) return attribute_->data_type;
+	return MFnData::kNumeric;
+}
+bool & MDataHandle::asBool(void) const { return value_->b; }
+char & MDataHandle::asChar(void) const { return value_->c; }
+short & MDataHandle::asShort(void) const { return value_->s; }
+int & MDataHandle::asInt(void) const { return value_->i; }
+float & MDataHandle::asFloat(void) const { return value_->f[0]; }
+double & MDataHandle::asDouble(void) const { return value_->d[0]; }
+double3 & MDataHandle::asDouble3(void) const { return *reinterpret_cast<double3 *>(value_->d); }
+float3 & MDataHandle::asFloat3(void) const { return value_->f; }
+MVector MDataHandle::asVector(void) const { return MVector(value_->d[0], value_->d[1], value_->d[2]); }
+MAngle MDataHandle::asAngle(void) const { return MAngle(value_->d[0], MAngle::kRadians); }
+MDistance MDataHandle::asDistance(void) const { return MDistance(value_->d[0], MDistance::kCentimeters); }
+MTime MDataHandle::asTime(void) const { return MTime(value_->d[0], MTime::kFilm); }
+MString MDataHandle::asString(void) const {
+	if (auto e = dataEntity<StringEntity>(value_->data)) return e->array;
+	return value_->string;
+}
+MMatrix & MDataHandle::asMatrix(void) const { return value_->matrix; }
+MObject MDataHandle::data(void) {
+	if (value_->data.isNull() && attribute_ && attribute_->kind == AttributeData::kTyped) {
+		value_->data = createDataForType(attribute_->data_type);
+	}
+	return value_->data;
+}
+
+void MDataHandle::set(bool value) { value_->b = value; value_->d[0] = value ? 1.0 : 0.0; }
+void MDataHandle::set(char value) { value_->c = value; value_->d[0] = value; }
+void MDataHandle::set(short value) { value_->s = value; value_->d[0] = value; }
+void MDataHandle::set(int value) { value_->i = value; value_->d[0] = value; }
+void MDataHandle::set(float value) { value_->f[0] = value; value_->d[0] = value; }
+void MDataHandle::set(double value) { value_->d[0] = value; value_->f[0] = static_cast<float>(value); }
+void MDataHandle::set(double x, double y, double z) { value_->d[0] = x; value_->d[1] = y; value_->d[2] = z; }
+void MDataHandle::set(float x, float y, float z) { value_->f[0] = x; value_->f[1] = y; value_->f[2] = z; }
+void MDataHandle::set(const MVector & value) { set(value.x, value.y, value.z); }
+void MDataHandle::set(const MMatrix & value) { value_->matrix = value; }
+void MDataHandle::set(const MAngle & value) { value_->d[0] = value.asRadians(); }
+void MDataHandle::set(const MDistance & value) { value_->d[0] = value.asCentimeters(); }
+void MDataHandle::set(const MTime & value) { value_->d[0] = value.as(MTime::kFilm); }
+void MDataHandle::set(const MString & value) {
+	if (attribute_ && attribute_->kind == AttributeData::kTyped) {
+		MFnStringData fn;
+		value_->data = fn.create(value);
+	}
+	value_->string = value;
+}
+MStatus MDataHandle::set(const MObject & value) { value_->data = value; return MStatus::kSuccess; }
+void MDataHandle::setClean(void) { value_->clean = true; }
+
+MDataHandle MDataHandle::child(const MObject & attribute) {
+	auto a = attr(attribute);
+	Value & v = value_->children[a];
+	if (!v.initialized) initializeValue(v, a);
+	return MDataHandle(&v, a);
+}
+
+MObject MDataHandle::attribute(void) {
+	for (const auto & cls : Registry::instance().nodes) {
+		for (const auto & a : cls->attributes) {
+			if (a._entity() == attribute_) return a;
+		}
+	}
+	return MObject();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// 配列データ
+
+MArrayDataBuilder::MArrayDataBuilder(const MObject & attribute, unsigned int, MStatus * status)
+	: value_(new Value), attribute_(attr(attribute)), owns_(true) { value_->initialized = true; setStatus(status, MStatus::kSuccess); }
+MArrayDataBuilder::MArrayDataBuilder(MDataBlock *, const MObject & attribute, unsigned int, MStatus * status)
+	: value_(new Value), attribute_(attr(attribute)), owns_(true) { value_->initialized = true; setStatus(status, MStatus::kSuccess); }
+MArrayDataBuilder::MArrayDataBuilder(const MArrayDataBuilder & other)
+	: value_(other.value_ ? new Value(*other.value_) : nullptr), attribute_(other.attribute_), owns_(true) {}
+MArrayDataBuilder & MArrayDataBuilder::operator=(const MArrayDataBuilder & other) {
+	if (this == &other) return *this;
+	if (owns_) delete value_;
+	value_ = other.value_ ? new Value(*other.value_) : nullptr;
+	attribute_ = other.attribute_;
+	owns_ = true;
+	return *this;
+}
+MArrayDataBuilder::~MArrayDataBuilder(void) { if (owns_) delete value_; }
+
+MDataHandle MArrayDataBuilder::addElement(unsigned int index, MStatus * status) {
+	Value & v = value_->elements[index];
+	if (!v.initialized) initializeValue(v, attribute_);
+	setStatus(status, MStatus::kSuccess);
+	return MDataHandle(&v, attribute_);
+}
+
+MArrayDataHandle MArrayDataBuilder::addElementArray(unsigned int index, MStatus * status) {
+	Value & v = value_->elements[index];
+	v.initialized = true;
+	setStatus(status, MStatus::kSuccess);
+	return MArrayDataHandle(&v, attribute_);
+}
+
+MStatus MArrayDataBuilder::removeElement(unsigned int index) { return value_->elements.erase(index) ? MStatus::kSuccess : MStatus::kInvalidParameter; }
+unsigned int MArrayDataBuilder::elementCount(MStatus * status) const { setStatus(status, MStatus::kSuccess); return static_cast<unsigned int>(value_->elements.size()); }
+
+MArrayDataHandle::MArrayDataHandle(const MDataHandle & handle, MStatus * status) : value_(handle._value()), attribute_(nullptr), cursor_(0) { setStatus(status, MStatus::kSuccess); }
+
+namespace {
+std::map<unsigned int, Value>::iterator elementAt(Value * value, unsigned int physical) {
+	auto it = value->elements.begin();
+	std::advance(it, physical);
+	return it;
+}
+}
+
+MDataHandle MArrayDataHandle::inputValue(MStatus * status) {
+	if (!value_ || cursor_ >= value_->elements.size()) { setStatus(status, MStatus::kInvalidParameter); return MDataHandle(); }
+	setStatus(status, MStatus::kSuccess);
+	return MDataHandle(&elementAt(value_, cursor_)->second, attribute_);
+}
+MDataHandle MArrayDataHandle::outputValue(MStatus * status) { return inputValue(status); }
+MArrayDataHandle MArrayDataHandle::inputArrayValue(MStatus * status) {
+	if (!value_ || cursor_ >= value_->elements.size()) { setStatus(status, MStatus::kInvalidParameter); return MArrayDataHandle(); }
+	setStatus(status, MStatus::kSuccess);
+	return MArrayDataHandle(&elementAt(value_, cursor_)->second, attribute_);
+}
+MArrayDataHandle MArrayDataHandle::outputArrayValue(MStatus * status) { return inputArrayValue(status); }
+MStatus MArrayDataHandle::next(void) {
+	if (!value_ || cursor_ + 1 >= value_->elements.size()) { cursor_ = value_ ? static_cast<unsigned int>(value_->elements.size()) : 0; return MStatus::kFailure; }
+	++cursor_;
+	return MStatus::kSuccess;
+}
+unsigned int MArrayDataHandle::elementCount(MStatus * status) { setStatus(status, MStatus::kSuccess); return value_ ? static_cast<unsigned int>(value_->elements.size()) : 0; }
+unsigned int MArrayDataHandle::elementIndex(MStatus * status) {
+	if (!value_ || cursor_ >= value_->elements.size()) { setStatus(status, MStatus::kFailure); return 0; }
+	setStatus(status, MStatus::kSuccess);
+	return elementAt(value_, cursor_)->first;
+}
+MStatus MArrayDataHandle::jumpToElement(unsigned int logical_index) {
+	if (!value_) return MStatus::kFailure;
+	auto it = value_->elements.find(logical_index);
+	if (it == value_->elements.end()) return MStatus::kInvalidParameter;
+	cursor_ = static_cast<unsigned int>(std::distance(value_->elements.begin(), it));
+	return MStatus::kSuccess;
+}
+MStatus MArrayDataHandle::jumpToArrayElement(unsigned int physical_index) {
+	if (!value_ || physical_index >= value_->elements.size()) return MStatus::kInvalidParameter;
+	cursor_ = physical_index;
+	return MStatus::kSuccess;
+}
+MStatus MArrayDataHandle::setClean(void) { if (value_) value_->clean = true; return MStatus::kSuccess; }
+MStatus MArrayDataHandle::setAllClean(void) {
+	if (!value_) return MStatus::kFailure;
+	value_->clean = true;
+	for (auto & e : value_->elements) e.second.clean = true;
+	return MStatus::kSuccess;
+}
+MArrayDataBuilder MArrayDataHandle::builder(MStatus * status) {
+	MArrayDataBuilder ret;
+	ret.value_ = new Value(*value_);
+	ret.attribute_ = attribute_;
+	ret.owns_ = true;
+	setStatus(status, MStatus::kSuccess);
+	return ret;
+}
+MStatus MArrayDataHandle::set(const MArrayDataBuilder & builder) {
+	if (!value_ || !builder.value_) return MStatus::kFailure;
+	value_->elements = builder.value_->elements;
+	return MStatus::kSuccess;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MDataBlock
+
+MDataHandle MDataBlock::inputValue(const MPlug & plug, MStatus * status) {
+	if (plug.isElement()) {
+		auto a = attr(plug.attribute());
+		Value & arr = valueOf(node_, a);
+		Value & v = arr.elements[plug.logicalIndex()];
+		if (!v.initialized) initializeValue(v, a);
+		setStatus(status, MStatus::kSuccess);
+		return MDataHandle(&v, a);
+	}
+	return inputValue(plug.attribute(), status);
+}
+MDataHandle MDataBlock::inputValue(const MObject & attribute, MStatus * status) {
+	auto a = attr(attribute);
+	if (!a || !node_) { setStatus(status, MStatus::kInvalidParameter); return MDataHandle(); }
+	setStatus(status, MStatus::kSuccess);
+	return MDataHandle(&valueOf(node_, a), a);
+}
+MDataHandle MDataBlock::outputValue(const MPlug & plug, MStatus * status) { return inputValue(plug, status); }
+MDataHandle MDataBlock::outputValue(const MObject & attribute, MStatus * status) { return inputValue(attribute, status); }
+MArrayDataHandle MDataBlock::inputArrayValue(const MPlug & plug, MStatus * status) { return inputArrayValue(plug.attribute(), status); }
+MArrayDataHandle MDataBlock::inputArrayValue(const MObject & attribute, MStatus * status) {
+	auto a = attr(attribute);
+	if (!a || !node_) { setStatus(status, MStatus::kInvalidParameter); return MArrayDataHandle(); }
+	setStatus(status, MStatus::kSuccess);
+	return MArrayDataHandle(&valueOf(node_, a), a);
+}
+MArrayDataHandle MDataBlock::outputArrayValue(const MPlug & plug, MStatus * status) { return inputArrayValue(plug, status); }
+MArrayDataHandle MDataBlock::outputArrayValue(const MObject & attribute, MStatus * status) { return inputArrayValue(attribute, status); }
+MStatus MDataBlock::setClean(const MPlug & plug) { return setClean(plug.attribute()); }
+MStatus MDataBlock::setClean(const MObject & attribute) {
+	auto a = attr(attribute);
+	if (!a || !node_) return MStatus::kInvalidParameter;
+	valueOf(node_, a).clean = true;
+	return MStatus::kSuccess;
+}
+bool MDataBlock::isClean(const MPlug & plug) { return isClean(plug.attribute()); }
+bool MDataBlock::isClean(const MObject & attribute) {
+	auto a = attr(attribute);
+	if (!a || !node_) return false;
+	return valueOf(node_, a).clean;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MPxNode
+
+MPxNode::MPxNode(void) : entity_(nullptr) {}
+MPxNode::~MPxNode(void) {}
+MStatus MPxNode::compute(const MPlug &, MDataBlock &) { return MStatus::kUnknownParameter; }
+MStatus MPxNode::setDependentsDirty(const MPlug &, MPlugArray &) { return MStatus::kSuccess; }
+MObject MPxNode::thisMObject(void) const {
+	if (!entity_) return MObject();
+	// NodeEntity は Node が shared_ptr で保持している。所有権を共有しない MObject を返す。
+	return MObject(std::shared_ptr<Entity>(std::shared_ptr<Entity>(), entity_));
+}
+MString MPxNode::name(void) const { return entity_ ? entity_->name : MString(); }
+MTypeId MPxNode::typeId(void) const { return entity_ && entity_->node_class ? entity_->node_class->id : MTypeId(); }
+MString MPxNode::typeName(void) const { return entity_ && entity_->node_class ? entity_->node_class->name : MString(); }
+
+MStatus MPxNode::addAttribute(const MObject & attribute) {
+	NodeClass * cls = Registry::instance().initializing;
+	if (!cls || !attr(attribute)) return MStatus::kFailure;
+	for (const auto & a : cls->attributes) {
+		if (a == attribute) return MStatus::kInvalidParameter;
+		auto existing = attr(a);
+		if (existing->long_name == attr(attribute)->long_name || existing->short_name == attr(attribute)->short_name) return MStatus::kInvalidParameter;
+	}
+	cls->attributes.push_back(attribute);
+	return MStatus::kSuccess;
+}
+
+MStatus MPxNode::attributeAffects(const MObject & when_changes, const MObject & is_affected) {
+	NodeClass * cls = Registry::instance().initializing;
+	auto w = attr(when_changes), i = attr(is_affected);
+	if (!cls || !w || !i) return MStatus::kFailure;
+	cls->affects.emplace(w, i);
+	return MStatus::kSuccess;
+}
+
+MStatus MPxNode::inheritAttributesFrom(const MString &) { return MStatus::kSuccess; }
+
+///////////////////////////////////////////////////////////////////////////////
+// MArgList
+
+bool MArgList::asBool(unsigned int index, MStatus * status) const {
+	if (index >= args_.size()) { setStatus(status, MStatus::kInvalidParameter); return false; }
+	setStatus(status, MStatus::kSuccess);
+	const Arg & a = args_[index];
+	if (a.kind == Arg::kString) return a.string == "true" || a.string == "on" || a.string == "1";
+	return a.number != 0.0;
+}
+
+int MArgList::asInt(unsigned int index, MStatus * status) const {
+	if (index >= args_.size()) { setStatus(status, MStatus::kInvalidParameter); return 0; }
+	const Arg & a = args_[index];
+	if (a.kind == Arg::kString) {
+		setStatus(status, a.string.isInt() ? MStatus::kSuccess : MStatus::kInvalidParameter);
+		return a.string.asInt();
+	}
+	if (a.kind > Arg::kDouble) { setStatus(status, MStatus::kInvalidParameter); return 0; }
+	setStatus(status, MStatus::kSuccess);
+	return static_cast<int>(a.number);
+}
+
+double MArgList::asDouble(unsigned int index, MStatus * status) const {
+	if (index >= args_.size()) { setStatus(status, MStatus::kInvalidParameter); return 0.0; }
+	const Arg & a = args_[index];
+	if (a.kind == Arg::kString) {
+		setStatus(status, a.string.isDouble() ? MStatus::kSuccess : MStatus::kInvalidParameter);
+		return a.string.asDouble();
+	}
+	if (a.kind > Arg::kDouble) { setStatus(status, MStatus::kInvalidParameter); return 0.0; }
+	setStatus(status, MStatus::kSuccess);
+	return a.number;
+}
+
+MString MArgList::asString(unsigned int index, MStatus * status) const {
+	if (index >= args_.size()) { setStatus(status, MStatus::kInvalidParameter); return MString(); }
+	setStatus(status, MStatus::kSuccess);
+	const Arg & a = args_[index];
+	switch (a.kind) {
+	case Arg::kString: return a.string;
+	case Arg::kBool: return a.number != 0.0 ? "true" : "false";
+	case Arg::kInt: return MString(std::to_string(static_cast<long long>(a.number)));
+	case Arg::kDouble: return MString(std::to_string(a.number));
+	default: setStatus(status, MStatus::kInvalidParameter); return MString();
+	}
+}
+
+MDoubleArray MArgList::asDoubleArray(unsigned int & index, MStatus * status) const {
+	if (index >= args_.size()) { setStatus(status, MStatus::kInvalidParameter); return MDoubleArray(); }
+	const Arg & a = args_[index];
+	if (a.kind == Arg::kDoubleArray || a.kind == Arg::kIntArray) {
+		++index;
+		setStatus(status, MStatus::kSuccess);
+		return MDoubleArray(a.doubles.data(), static_cast<unsigned int>(a.doubles.size()));
+	}
+	// MEL 形式: 要素数に続いて要素が並ぶ
+	MStatus stat;
+	int count = asInt(index, &stat);
+	if (!stat || count < 0 || index + 1 + static_cast<unsigned int>(count) > args_.size()) { setStatus(status, MStatus::kInvalidParameter); return MDoubleArray(); }
+	MDoubleArray ret(static_cast<unsigned int>(count));
+	for (int i = 0; i < count; ++i) ret[static_cast<unsigned int>(i)] = asDouble(index + 1 + static_cast<unsigned int>(i));
+	index += 1 + static_cast<unsigned int>(count);
+	setStatus(status, MStatus::kSuccess);
+	return ret;
+}
+
+MIntArray MArgList::asIntArray(unsigned int & index, MStatus * status) const {
+	MDoubleArray d = asDoubleArray(index, status);
+	MIntArray ret(d.length());
+	for (unsigned int i = 0; i < d.length(); ++i) ret[i] = static_cast<int>(d[i]);
+	return ret;
+}
+
+MStringArray MArgList::asStringArray(unsigned int & index, MStatus * status) const {
+	MStringArray ret;
+	if (index >= args_.size() || args_[index].kind != Arg::kStringArray) { setStatus(status, MStatus::kInvalidParameter); return ret; }
+	for (const auto & s : args_[index].strings) ret.append(s);
+	++index;
+	setStatus(status, MStatus::kSuccess);
+	return ret;
+}
+
+MArgList & MArgList::addArg(bool value) { Arg a; a.kind = Arg::kBool; a.number = value ? 1.0 : 0.0; args_.push_back(a); return *this; }
+MArgList & MArgList::addArg(int value) { Arg a; a.kind = Arg::kInt; a.number = value; args_.push_back(a); return *this; }
+MArgList & MArgList::addArg(double value) { Arg a; a.kind = Arg::kDouble; a.number = value; args_.push_back(a); return *this; }
+MArgList & MArgList::addArg(const MString & value) { Arg a; a.kind = Arg::kString; a.number = 0.0; a.string = value; args_.push_back(a); return *this; }
+MArgList & MArgList::addArg(const MDoubleArray & value) { Arg a; a.kind = Arg::kDoubleArray; a.number = 0.0; a.doubles = value._items(); args_.push_back(a); return *this; }
+MArgList & MArgList::addArg(const MIntArray & value) { Arg a; a.kind = Arg::kIntArray; a.number = 0.0; a.doubles.assign(value._items().begin(), value._items().end()); args_.push_back(a); return *this; }
+MArgList & MArgList::addArg(const MStringArray & value) { Arg a; a.kind = Arg::kStringArray; a.number = 0.0; for (unsigned int i = 0; i < value.length(); ++i) a.strings.push_back(value[i]); args_.push_back(a); return *this; }
+
+///////////////////////////////////////////////////////////////////////////////
+// MPxCommand
+
+void MPxCommand::setResult(const MString & result) { resultBuffer() = result; }
+void MPxCommand::setResult(bool result) { resultBuffer() = result ? "1" : "0"; }
+void MPxCommand::setResult(int result) { resultBuffer() = MString(std::to_string(result)); }
+void MPxCommand::setResult(double result) { resultBuffer() = MString(std::to_string(result)); }
+void MPxCommand::setResult(const MDoubleArray & result) {
+	MString s;
+	for (unsigned int i = 0; i < result.length(); ++i) { if (i) s += " "; s += result[i]; }
+	resultBuffer() = s;
+}
+void MPxCommand::appendToResult(const MString & result) {
+	if (resultBuffer().length()) resultBuffer() += " ";
+	resultBuffer() += result;
+}
+void MPxCommand::clearResult(void) { resultBuffer() = ""; }
+void MPxCommand::displayInfo(const MString & message) { MGlobal::displayInfo(message); }
+void MPxCommand::displayWarning(const MString & message, bool) { MGlobal::displayWarning(message); }
+void MPxCommand::displayError(const MString & message, bool) { MGlobal::displayError(message); }
+
+///////////////////////////////////////////////////////////////////////////////
+// ファイル / トランスレーター
+
+MString MFileObject::resolvedName(void) const {
+	int p = path_.rindex('/');
+	return p < 0 ? path_ : path_.substring(p + 1, static_cast<int>(path_.length()) - 1);
+}
+
+MString MFileObject::resolvedPath(void) const {
+	int p = path_.rindex('/');
+	return p < 0 ? MString() : path_.substring(0, p);
+}
+
+bool MFileObject::exists(void) const {
+	std::ifstream ifs(pathName(path_));
+	return ifs.good();
+}
+
+MStatus MPxFileTranslator::reader(const MFileObject &, const MString &, FileAccessMode) { return MStatus::kNotImplemented; }
+MStatus MPxFileTranslator::writer(const MFileObject &, const MString &, FileAccessMode) { return MStatus::kNotImplemented; }
+
+///////////////////////////////////////////////////////////////////////////////
+// MFnPlugin
+
+MFnPlugin::MFnPlugin(MObject & object, const char * vendor, const char * version, const char *, MStatus * status)
+	: vendor_(vendor), version_(version) {
+	object_ = object;
+	setStatus(status, MStatus::kSuccess);
+}
+
+MStatus MFnPlugin::registerNode(const MString & type_name, const MTypeId & type_id, void * (*creator)(), MStatus (*initialize)(), MPxNode::Type type, const MString * classification) {
+	Registry & reg = Registry::instance();
+	for (const auto & cls : reg.nodes) {
+		if (cls->name == type_name || cls->id == type_id) return MStatus::kFailure;
+	}
+	std::unique_ptr<NodeClass> cls(new NodeClass);
+	cls->name = type_name;
+	cls->id = type_id;
+	cls->creator = creator;
+	cls->initialize = initialize;
+	cls->type = type;
+	if (classification) cls->classification = *classification;
+	cls->attributes = { MPxNode::message, MPxNode::caching, MPxNode::state, MPxNode::isHistoricallyInteresting, MPxNode::frozen };
+	reg.initializing = cls.get();
+	MStatus stat = initialize ? initialize() : MStatus(MStatus::kSuccess);
+	reg.initializing = nullptr;
+	if (stat.error()) return stat;
+	reg.nodes.push_back(std::move(cls));
+	return MStatus::kSuccess;
+}
+
+MStatus MFnPlugin::deregisterNode(const MTypeId & type_id) {
+	auto & nodes = Registry::instance().nodes;
+	for (auto it = nodes.begin(); it != nodes.end(); ++it) {
+		if ((*it)->id == type_id) { nodes.erase(it); return MStatus::kSuccess; }
+	}
+	return MStatus::kFailure;
+}
+
+MStatus MFnPlugin::registerCommand(const MString & command_name, void * (*creator)(), MSyntax (*)()) {
+	Registry & reg = Registry::instance();
+	if (reg.findCommand(command_name)) return MStatus::kFailure;
+	CommandClass c;
+	c.name = command_name;
+	c.creator = creator;
+	reg.commands.push_back(c);
+	return MStatus::kSuccess;
+}
+
+MStatus MFnPlugin::deregisterCommand(const MString & command_name) {
+	auto & commands = Registry::instance().commands;
+	for (auto it = commands.begin(); it != commands.end(); ++it) {
+		if (it->name == command_name) { commands.erase(it); return MStatus::kSuccess; }
+	}
+	return MStatus::kFailure;
+}
+
+MStatus MFnPlugin::registerFileTranslator(const MString & translator_name, const char *, void * (*creator)(), const char * options_script_name, const char * default_options_string, bool) {
+	Registry & reg = Registry::instance();
+	if (reg.findTranslator(translator_name)) return MStatus::kFailure;
+	TranslatorClass t;
+	t.name = translator_name;
+	t.creator = creator;
+	t.options_script = options_script_name;
+	t.default_options = default_options_string;
+	reg.translators.push_back(t);
+	return MStatus::kSuccess;
+}
+
+MStatus MFnPlugin::deregisterFileTranslator(const MString & translator_name) {
+	auto & translators = Registry::instance().translators;
+	for (auto it = translators.begin(); it != translators.end(); ++it) {
+		if (it->name == translator_name) { translators.erase(it); return MStatus::kSuccess; }
+	}
+	return MStatus::kFailure;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MGlobal
+
+void MGlobal::displayInfo(const MString & message) { std::cout << message << std::endl; }
+void MGlobal::displayWarning(const MString & message) { std::cerr << "// Warning: " << message << std::endl; }
+void MGlobal::displayError(const MString & message) { std::cerr << "// Error: " << message << std::endl; }
+
+MStatus MGlobal::executeCommand(const MString & command, bool, bool) {
+	MString result;
+	return executeCommand(command, result);
+}
+
+MStatus MGlobal::executeCommand(const MString & command, MString & result, bool, bool) {
+	// "name arg arg ..." 形式の単純なコマンドのみ解釈する
+	std::vector<MString> tokens;
+	command.split(' ', tokens);
+	if (tokens.empty()) return MStatus::kInvalidParameter;
+	if (!Registry::instance().findCommand(tokens[0])) return MStatus::kNotFound;
+	MArgList args;
+	for (size_t i = 1; i < tokens.size(); ++i) args.addArg(tokens[i]);
+	return mpbmock::executeCommand(tokens[0], args, &result);
+}
+
+MStatus MGlobal::executeCommandOnIdle(const MString & command, bool) {
+	Registry & reg = Registry::instance();
+	std::lock_guard<std::mutex> lock(reg.idle_mutex);
+	reg.idle_commands.push_back(command);
+	return MStatus::kSuccess;
+}
+
+MGlobal::MMayaState MGlobal::mayaState(MStatus * status) {
+	if (status) *status = MStatus::kSuccess;
+	return kLibraryApp;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MFnDependencyNode
+
+namespace {
+NodeEntity * nodeEntity(const MObject & obj) { return dynamic_cast<NodeEntity *>(obj._entity()); }
+}
+
+MString MFnDependencyNode::name(MStatus * status) const { auto n = nodeEntity(object_); setStatus(status, n ? MStatus::kSuccess : MStatus::kFailure); return n ? n->name : MString(); }
+MString MFnDependencyNode::typeName(MStatus * status) const { auto n = nodeEntity(object_); setStatus(status, n ? MStatus::kSuccess : MStatus::kFailure); return n ? n->node_class->name : MString(); }
+MTypeId MFnDependencyNode::typeId(MStatus * status) const { auto n = nodeEntity(object_); setStatus(status, n ? MStatus::kSuccess : MStatus::kFailure); return n ? n->node_class->id : MTypeId(); }
+MPxNode * MFnDependencyNode::userNode(MStatus * status) const { auto n = nodeEntity(object_); setStatus(status, n ? MStatus::kSuccess : MStatus::kFailure); return n ? n->user : nullptr; }
+MObject MFnDependencyNode::attribute(const MString & attribute_name, MStatus * status) const {
+	auto n = nodeEntity(object_);
+	if (n) {
+		for (const auto & a : n->node_class->attributes) {
+			auto d = attr(a);
+			if (d->long_name == attribute_name.asChar() || d->short_name == attribute_name.asChar()) { setStatus(status, MStatus::kSuccess); return a; }
+		}
+	}
+	setStatus(status, MStatus::kNotFound);
+	return MObject();
+}
+MPlug MFnDependencyNode::findPlug(const MString & attribute_name, bool, MStatus * status) const {
+	MObject a = attribute(attribute_name, status);
+	return a.isNull() ? MPlug() : MPlug(object_, a);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// ホスト API
+
+Registry & Registry::instance(void) {
+	static Registry registry;
+	return registry;
+}
+
+NodeClass * Registry::findNode(const MString & name) {
+	for (auto & n : nodes) if (n->name == name) return n.get();
+	return nullptr;
+}
+
+CommandClass * Registry::findCommand(const MString & name) {
+	for (auto & c : commands) if (c.name == name) return &c;
+	return nullptr;
+}
+
+TranslatorClass * Registry::findTranslator(const MString & name) {
+	for (auto & t : translators) if (t.name == name) return &t;
+	return nullptr;
+}
+
+Node::Node(const MString & type_name, const MString & name) {
+	NodeClass * cls = Registry::instance().findNode(type_name);
+	if (!cls) throw std::runtime_error(std::string("unknown node type : ") + type_name.asChar());
+	entity_ = std::make_shared<NodeEntity>();
+	entity_->node_class = cls;
+	entity_->name = name.length() ? name : MString(type_name + "1");
+	object_ = MObject(entity_);
+	entity_->user = static_cast<MPxNode *>(cls->creator());
+	if (!entity_->user) throw std::runtime_error(std::string("failed to create node : ") + type_name.asChar());
+	entity_->user->_setEntity(entity_.get());
+	entity_->user->postConstructor();
+}
+
+Node::~Node(void) {
+	delete entity_->user;
+	entity_->user = nullptr;
+}
+
+MObject Node::attribute(const MString & name) const {
+	MObject ret = MFnDependencyNode(object_).attribute(name);
+	if (ret.isNull()) throw std::runtime_error(std::string("unknown attribute : ") + name.asChar());
+	return ret;
+}
+
+MPlug Node::plug(const MString & attribute_name) const { return MPlug(object_, attribute(attribute_name)); }
+
+Value & Node::value(const MString & attribute_name) { return valueOf(entity_.get(), attr(attribute(attribute_name))); }
+
+void Node::propagateDirty(const AttributeData * source) {
+	MPlugArray affected;
+	MObject source_obj;
+	for (const auto & a : entity_->node_class->attributes) if (a._entity() == source) source_obj = a;
+	// dgdirty と同様に、汚したプラグ自身も dirty にする
+	valueOf(entity_.get(), source).clean = false;
+	auto range = entity_->node_class->affects.equal_range(source);
+	for (auto it = range.first; it != range.second; ++it) {
+		valueOf(entity_.get(), it->second).clean = false;
+		for (const auto & a : entity_->node_class->attributes) {
+			if (a._entity() == it->second) affected.append(MPlug(object_, a));
+		}
+	}
+	entity_->user->setDependentsDirty(MPlug(object_, source_obj), affected);
+}
+
+void Node::dirty(const MString & attribute_name) {
+	propagateDirty(attr(attribute(attribute_name)));
+}
+
+void Node::setDouble(const MString & attribute_name, double value) {
+	Value & v = this->value(attribute_name);
+	v.d[0] = value; v.f[0] = static_cast<float>(value); v.i = static_cast<int>(value); v.s = static_cast<short>(value); v.b = value != 0.0;
+	dirty(attribute_name);
+}
+void Node::setInt(const MString & attribute_name, int value) { setDouble(attribute_name, value); }
+void Node::setBool(const MString & attribute_name, bool value) { setDouble(attribute_name, value ? 1.0 : 0.0); }
+void Node::setTime(const MString & attribute_name, const MTime & value) { setDouble(attribute_name, value.as(MTime::kFilm)); }
+void Node::setString(const MString & attribute_name, const MString & value) {
+	MFnStringData fn;
+	this->value(attribute_name).data = fn.create(value);
+	this->value(attribute_name).string = value;
+	dirty(attribute_name);
+}
+void Node::setData(const MString & attribute_name, const MObject & data) {
+	this->value(attribute_name).data = data;
+	dirty(attribute_name);
+}
+void Node::setArrayElementDouble(const MString & attribute_name, unsigned int index, double value) {
+	Value & arr = this->value(attribute_name);
+	Value & v = arr.elements[index];
+	if (!v.initialized) initializeValue(v, attr(attribute(attribute_name)));
+	v.d[0] = value; v.f[0] = static_cast<float>(value);
+	dirty(attribute_name);
+}
+
+MStatus Node::compute(const MString & attribute_name) {
+	MDataBlock block(entity_.get());
+	return entity_->user->compute(plug(attribute_name), block);
+}
+
+MStatus Node::evaluate(const MString & attribute_name) {
+	Value & v = value(attribute_name);
+	if (v.clean) return MStatus::kSuccess;
+	return compute(attribute_name);
+}
+
+double Node::getDouble(const MString & attribute_name) {
+	evaluate(attribute_name);
+	return value(attribute_name).d[0];
+}
+
+MObject Node::getData(const MString & attribute_name) {
+	evaluate(attribute_name);
+	return value(attribute_name).data;
+}
+
+MStatus mpbmock::executeCommand(const MString & name, const MArgList & args, MString * result, std::unique_ptr<MPxCommand> * instance) {
+	CommandClass * cls = Registry::instance().findCommand(name);
+	if (!cls) return MStatus::kNotFound;
+	std::unique_ptr<MPxCommand> cmd(static_cast<MPxCommand *>(cls->creator()));
+	MPxCommand::clearResult();
+	MStatus stat = cmd->doIt(args);
+	if (result) *result = resultBuffer();
+	if (instance) *instance = std::move(cmd);
+	return stat;
+}
+
+MString mpbmock::lastCommandResult(void) { return resultBuffer(); }
+
+MStatus mpbmock::importFile(const MString & translator_name, const MString & path, const MString & options) {
+	TranslatorClass * cls = Registry::instance().findTranslator(translator_name);
+	if (!cls) return MStatus::kNotFound;
+	std::unique_ptr<MPxFileTranslator> t(static_cast<MPxFileTranslator *>(cls->creator()));
+	MFileObject file;
+	file.setRawFullName(path);
+	return t->reader(file, options.length() ? options : cls->default_options, MPxFileTranslator::kImportAccessMode);
+}
+
+MStatus mpbmock::exportFile(const MString & translator_name, const MString & path, const MString & options) {
+	TranslatorClass * cls = Registry::instance().findTranslator(translator_name);
+	if (!cls) return MStatus::kNotFound;
+	std::unique_ptr<MPxFileTranslator> t(static_cast<MPxFileTranslator *>(cls->creator()));
+	MFileObject file;
+	file.setRawFullName(path);
+	return t->writer(file, options.length() ? options : cls->default_options, MPxFileTranslator::kExportAccessMode);
+}
+
+void mpbmock::flushIdleQueue(void) {
+	Registry & reg = Registry::instance();
+	std::vector<MString> queue;
+	{
+		std::lock_guard<std::mutex> lock(reg.idle_mutex);
+		queue.swap(reg.idle_commands);
+	}
+	for (const auto & cmd : queue) {
+		if (reg.on_idle_command) reg.on_idle_command(cmd);
+		else MGlobal::executeCommand(cmd);
+	}
+}
@@ -0,0 +1,913 @@
+/// @file MockCore.h
+/// @brief Maya API スタンドイン (ヘッドレスビルド用)
+///
+/// mpb フレームワークが使用する Maya 2015 API のサブセットを、Maya なしでビルド・実行できるよう再実装したものです。
+/// 実際の Maya の挙動を完全には再現しません。ノードの compute やトランスレーターの入出力を
+/// ベンチマーク・プロファイルするための最小限の実装です。
+///
+/// 各 maya/MXxx.h はこのヘッダをインクルードするだけのスタブです。
+
+#pragma once
+#ifndef MAYA_PLUGIN_BASE_MOCK_CORE_H_
+#define MAYA_PLUGIN_BASE_MOCK_CORE_H_
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+// Maya の MIOStream.h と同様に、REQUIRE_IOSTREAM 定義時は iostream の名前を取り込む
+#ifdef REQUIRE_IOSTREAM
+using std::ostream;
+using std::istream;
+using std::cout;
+using std::cerr;
+using std::endl;
+#endif
+
+#ifndef MAYA_API_VERSION
+#define MAYA_API_VERSION 201500
+#endif
+
+class MString;
+class MStatus;
+class MObject;
+class MPlug;
+class MPlugArray;
+class MDataBlock;
+class MDataHandle;
+class MArrayDataHandle;
+class MArrayDataBuilder;
+class MPxNode;
+
+typedef double double3[3];
+typedef float float3[3];
+
+namespace mpbmock {
+struct Entity;
+struct AttributeData;
+struct NodeEntity;
+struct Value;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// MFn
+
+class MFn {
+public:
+	enum Type {
+		kInvalid = 0,
+		kBase,
+		kAttribute,
+		kNumericAttribute,
+		kEnumAttribute,
+		kUnitAttribute,
+		kTypedAttribute,
+		kCompoundAttribute,
+		kMessageAttribute,
+		kDependencyNode,
+		kDagNode,
+		kMesh,
+		kData,
+		kDoubleArrayData,
+		kIntArrayData,
+		kPointArrayData,
+		kVectorArrayData,
+		kStringData,
+		kMeshData,
+	};
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MString
+
+class MString {
+public:
+	MString(void) {}
+	MString(const char * str) : str_(str ? str : "") {}
+	MString(const char * str, int length) : str_(str, static_cast<size_t>(length)) {}
+	MString(const std::string & str) : str_(str) {}
+	MString(const MString & other) = default;
+	MString & operator=(const MString & other) = default;
+	MString & operator=(const char * str) { str_ = (str ? str : ""); return *this; }
+
+	const char * asChar(void) const { return str_.c_str(); }
+	const char * asUTF8(void) const { return str_.c_str(); }
+	unsigned int length(void) const { return static_cast<unsigned int>(str_.size()); }
+	unsigned int numChars(void) const { return length(); }
+	MString & operator+=(const MString & other) { str_ += other.str_; return *this; }
+	MString & operator+=(const char * other) { str_ += other; return *this; }
+	MString & operator+=(double value) { str_ += std::to_string(value); return *this; }
+	MString & operator+=(int value) { str_ += std::to_string(value); return *this; }
+	MString & operator+=(unsigned int value) { str_ += std::to_string(value); return *this; }
+	bool operator==(const MString & other) const { return str_ == other.str_; }
+	bool operator==(const char * other) const { return str_ == other; }
+	bool operator!=(const MString & other) const { return str_ != other.str_; }
+	bool operator!=(const char * other) const { return str_ != other; }
+	bool operator<(const MString & other) const { return str_ < other.str_; }
+	int index(char c) const { auto p = str_.find(c); return p == std::string::npos ? -1 : static_cast<int>(p); }
+	int rindex(char c) const { auto p = str_.rfind(c); return p == std::string::npos ? -1 : static_cast<int>(p); }
+	MString substring(int start, int end) const { return MString(str_.substr(static_cast<size_t>(start), static_cast<size_t>(end - start + 1))); }
+	bool isDouble(void) const;
+	double asDouble(void) const { return std::atof(str_.c_str()); }
+	bool isInt(void) const;
+	int asInt(void) const { return std::atoi(str_.c_str()); }
+	void split(char delimiter, std::vector<MString> & output) const;
+
+	friend MString operator+(const MString & a, const MString & b) { return MString(a.str_ + b.str_); }
+	friend MString operator+(const MString & a, const char * b) { return MString(a.str_ + b); }
+	friend MString operator+(const char * a, const MString & b) { return MString(a + b.str_); }
+	friend MString operator+(const MString & a, double b) { return MString(a.str_ + std::to_string(b)); }
+	friend MString operator+(const MString & a, int b) { return MString(a.str_ + std::to_string(b)); }
+	friend MString operator+(const MString & a, unsigned int b) { return MString(a.str_ + std::to_string(b)); }
+	friend std::ostream & operator<<(std::ostream & os, const MString & s) { return os << s.str_; }
+
+private:
+	std::string str_;
+};
+
+class MStringArray {
+public:
+	unsigned int length(void) const { return static_cast<unsigned int>(items_.size()); }
+	void append(const MString & s) { items_.push_back(s); }
+	const MString & operator[](unsigned int i) const { return items_[i]; }
+	MString & operator[](unsigned int i) { return items_[i]; }
+	void clear(void) { items_.clear(); }
+private:
+	std::vector<MString> items_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// MStatus
+
+class MStatus {
+public:
+	enum MStatusCode {
+		kSuccess = 0,
+		kFailure,
+		kInsufficientMemory,
+		kInvalidParameter,
+		kLicenseFailure,
+		kUnknownParameter,
+		kNotImplemented,
+		kNotFound,
+		kEndOfFile,
+	};
+
+	MStatus(void) : code_(kSuccess) {}
+	MStatus(MStatusCode code) : code_(code) {}
+	MStatus(const MStatus &) = default;
+	MStatus & operator=(const MStatus &) = default;
+
+	bool operator==(const MStatus & other) const { return code_ == other.code_; }
+	bool operator==(MStatusCode other) const { return code_ == other; }
+	bool operator!=(const MStatus & other) const { return code_ != other.code_; }
+	bool operator!=(MStatusCode other) const { return code_ != other; }
+	operator bool() const { return code_ == kSuccess; }
+	bool error(void) const { return code_ != kSuccess; }
+	void clear(void) { code_ = kSuccess; }
+	MStatusCode statusCode(void) const { return code_; }
+	MString errorString(void) const;
+	void perror(const char * message) const { if (error()) std::cerr << message << ": " << errorString() << std::endl; }
+
+private:
+	MStatusCode code_;
+};
+
+#define CHECK_MSTATUS(_status) do { MStatus _s = (_status); if (_s.error()) _s.perror(#_status); } while (0)
+#define CHECK_MSTATUS_AND_RETURN_IT(_status) do { MStatus _s = (_status); if (_s.error()) { _s.perror(#_status); return _s; } } while (0)
+
+///////////////////////////////////////////////////////////////////////////////
+// MObject / MTypeId
+
+class MObject {
+public:
+	MObject(void) {}
+	explicit MObject(std::shared_ptr<mpbmock::Entity> entity) : entity_(std::move(entity)) {}
+	MObject(const MObject &) = default;
+	MObject & operator=(const MObject &) = default;
+
+	bool isNull(void) const { return !entity_; }
+	MFn::Type apiType(void) const;
+	bool hasFn(MFn::Type type) const;
+	bool operator==(const MObject & other) const { return entity_ == other.entity_; }
+	bool operator!=(const MObject & other) const { return entity_ != other.entity_; }
+
+	static const MObject kNullObj;
+
+	mpbmock::Entity * _entity(void) const { return entity_.get(); }
+	const std::shared_ptr<mpbmock::Entity> & _shared(void) const { return entity_; }
+
+private:
+	std::shared_ptr<mpbmock::Entity> entity_;
+};
+
+class MObjectHandle {
+public:
+	MObjectHandle(void) {}
+	MObjectHandle(const MObject & obj) : obj_(obj) {}
+	unsigned int hashCode(void) const { return static_cast<unsigned int>(reinterpret_cast<std::uintptr_t>(obj_._entity()) >> 4); }
+	bool isValid(void) const { return !obj_.isNull(); }
+	bool isAlive(void) const { return !obj_.isNull(); }
+	MObject object(void) const { return obj_; }
+	bool operator==(const MObjectHandle & other) const { return obj_ == other.obj_; }
+private:
+	MObject obj_;
+};
+
+class MTypeId {
+public:
+	MTypeId(void) : id_(0) {}
+	MTypeId(unsigned int id) : id_(id) {}
+	MTypeId(unsigned int prefix, unsigned int id) : id_((prefix << 8) | (id & 0xff)) {}
+	unsigned int id(void) const { return id_; }
+	bool operator==(const MTypeId & other) const { return id_ == other.id_; }
+	bool operator!=(const MTypeId & other) const { return id_ != other.id_; }
+private:
+	unsigned int id_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// 数学型
+
+class MPoint;
+class MVector;
+
+class MMatrix {
+public:
+	MMatrix(void) { setToIdentity(); }
+	MMatrix(const double m[4][4]) { for (int r = 0; r < 4; ++r) for (int c = 0; c < 4; ++c) matrix[r][c] = m[r][c]; }
+	MMatrix & setToIdentity(void) { for (int r = 0; r < 4; ++r) for (int c = 0; c < 4; ++c) matrix[r][c] = (r == c ? 1.0 : 0.0); return *this; }
+	double operator()(unsigned int row, unsigned int col) const { return matrix[row][col]; }
+	const double * operator[](unsigned int row) const { return matrix[row]; }
+	double * operator[](unsigned int row) { return matrix[row]; }
+	MStatus get(double dest[4][4]) const { for (int r = 0; r < 4; ++r) for (int c = 0; c < 4; ++c) dest[r][c] = matrix[r][c]; return MStatus::kSuccess; }
+	MMatrix operator*(const MMatrix & right) const;
+	bool operator==(const MMatrix & other) const;
+	static const MMatrix identity;
+	double matrix[4][4];
+};
+
+class MVector {
+public:
+	MVector(void) : x(0.0), y(0.0), z(0.0) {}
+	MVector(double x, double y, double z = 0.0) : x(x), y(y), z(z) {}
+	MVector(const MPoint & p);
+	double length(void) const { return std::sqrt(x * x + y * y + z * z); }
+	MVector normal(void) const { double l = length(); return l > 0.0 ? MVector(x / l, y / l, z / l) : *this; }
+	MStatus normalize(void) { *this = normal(); return MStatus::kSuccess; }
+	double operator*(const MVector & r) const { return x * r.x + y * r.y + z * r.z; }
+	MVector operator^(const MVector & r) const { return MVector(y * r.z - z * r.y, z * r.x - x * r.z, x * r.y - y * r.x); }
+	MVector operator+(const MVector & r) const { return MVector(x + r.x, y + r.y, z + r.z); }
+	MVector operator-(const MVector & r) const { return MVector(x - r.x, y - r.y, z - r.z); }
+	MVector operator*(double s) const { return MVector(x * s, y * s, z * s); }
+	MVector operator*(const MMatrix & m) const { return MVector(x * m.matrix[0][0] + y * m.matrix[1][0] + z * m.matrix[2][0], x * m.matrix[0][1] + y * m.matrix[1][1] + z * m.matrix[2][1], x * m.matrix[0][2] + y * m.matrix[1][2] + z * m.matrix[2][2]); }
+	double operator[](unsigned int i) const { return i == 0 ? x : (i == 1 ? y : z); }
+	bool operator==(const MVector & r) const { return x == r.x && y == r.y && z == r.z; }
+	double x, y, z;
+};
+
+class MPoint {
+public:
+	MPoint(void) : x(0.0), y(0.0), z(0.0), w(1.0) {}
+	MPoint(double x, double y, double z = 0.0, double w = 1.0) : x(x), y(y), z(z), w(w) {}
+	MPoint(const MVector & v) : x(v.x), y(v.y), z(v.z), w(1.0) {}
+	double distanceTo(const MPoint & o) const { double dx = x - o.x, dy = y - o.y, dz = z - o.z; return std::sqrt(dx * dx + dy * dy + dz * dz); }
+	MPoint operator*(const MMatrix & m) const;
+	MPoint operator+(const MVector & v) const { return MPoint(x + v.x, y + v.y, z + v.z, w); }
+	MVector operator-(const MPoint & o) const { return MVector(x - o.x, y - o.y, z - o.z); }
+	double operator[](unsigned int i) const { return i == 0 ? x : (i == 1 ? y : (i == 2 ? z : w)); }
+	bool operator==(const MPoint & r) const { return x == r.x && y == r.y && z == r.z && w == r.w; }
+	double x, y, z, w;
+};
+
+class MFloatVector {
+public:
+	MFloatVector(void) : x(0.0f), y(0.0f), z(0.0f) {}
+	MFloatVector(float x, float y, float z = 0.0f) : x(x), y(y), z(z) {}
+	float x, y, z;
+};
+
+template <class T, class Derived>
+class MMockArrayBase {
+public:
+	MMockArrayBase(void) {}
+	MMockArrayBase(unsigned int length, const T & init = T()) : items_(length, init) {}
+	unsigned int length(void) const { return static_cast<unsigned int>(items_.size()); }
+	MStatus setLength(unsigned int length) { items_.resize(length); return MStatus::kSuccess; }
+	MStatus append(const T & item) { items_.push_back(item); return MStatus::kSuccess; }
+	MStatus remove(unsigned int index) { items_.erase(items_.begin() + index); return MStatus::kSuccess; }
+	MStatus clear(void) { items_.clear(); return MStatus::kSuccess; }
+	MStatus set(const T & item, unsigned int index) { items_[index] = item; return MStatus::kSuccess; }
+	void setSizeIncrement(unsigned int) {}
+	const T & operator[](unsigned int i) const { return items_[i]; }
+	T & operator[](unsigned int i) { return items_[i]; }
+	const std::vector<T> & _items(void) const { return items_; }
+	std::vector<T> & _items(void) { return items_; }
+protected:
+	std::vector<T> items_;
+};
+
+class MDoubleArray : public MMockArrayBase<double, MDoubleArray> {
+public:
+	using MMockArrayBase::MMockArrayBase;
+	MDoubleArray(const double src[], unsigned int count) { items_.assign(src, src + count); }
+	MStatus get(double dest[]) const { std::copy(items_.begin(), items_.end(), dest); return MStatus::kSuccess; }
+};
+
+class MFloatArray : public MMockArrayBase<float, MFloatArray> {
+public:
+	using MMockArrayBase::MMockArrayBase;
+	MFloatArray(const float src[], unsigned int count) { items_.assign(src, src + count); }
+	MStatus get(float dest[]) const { std::copy(items_.begin(), items_.end(), dest); return MStatus::kSuccess; }
+};
+
+class MIntArray : public MMockArrayBase<int, MIntArray> {
+public:
+	using MMockArrayBase::MMockArrayBase;
+	MIntArray(const int src[], unsigned int count) { items_.assign(src, src + count); }
+	MStatus get(int dest[]) const { std::copy(items_.begin(), items_.end(), dest); return MStatus::kSuccess; }
+};
+
+class MPointArray : public MMockArrayBase<MPoint, MPointArray> {
+public:
+	using MMockArrayBase::MMockArrayBase;
+	MPointArray(const double src[][4], unsigned int count) { items_.resize(count); for (unsigned int i = 0; i < count; ++i) items_[i] = MPoint(src[i][0], src[i][1], src[i][2], src[i][3]); }
+	MStatus get(double dest[][4]) const { for (size_t i = 0; i < items_.size(); ++i) { dest[i][0] = items_[i].x; dest[i][1] = items_[i].y; dest[i][2] = items_[i].z; dest[i][3] = items_[i].w; } return MStatus::kSuccess; }
+};
+
+class MVectorArray : public MMockArrayBase<MVector, MVectorArray> {
+public:
+	using MMockArrayBase::MMockArrayBase;
+	MVectorArray(const double src[][3], unsigned int count) { items_.resize(count); for (unsigned int i = 0; i < count; ++i) items_[i] = MVector(src[i][0], src[i][1], src[i][2]); }
+	MStatus get(double dest[][3]) const { for (size_t i = 0; i < items_.size(); ++i) { dest[i][0] = items_[i].x; dest[i][1] = items_[i].y; dest[i][2] = items_[i].z; } return MStatus::kSuccess; }
+};
+
+class MFloatVectorArray : public MMockArrayBase<MFloatVector, MFloatVectorArray> {
+public:
+	using MMockArrayBase::MMockArrayBase;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// 単位付きの値
+
+class MAngle {
+public:
+	enum Unit { kInvalid, kRadians, kDegrees, kAngMinutes, kAngSeconds, kLast };
+	MAngle(void) : value_(0.0), unit_(kRadians) {}
+	MAngle(double value, Unit unit = kRadians) : value_(value), unit_(unit) {}
+	double value(void) const { return value_; }
+	Unit unit(void) const { return unit_; }
+	double asRadians(void) const { return unit_ == kDegrees ? value_ * 3.14159265358979323846 / 180.0 : value_; }
+	double asDegrees(void) const { return unit_ == kDegrees ? value_ : value_ * 180.0 / 3.14159265358979323846; }
+private:
+	double value_; Unit unit_;
+};
+
+class MDistance {
+public:
+	enum Unit { kInvalid, kInches, kFeet, kYards, kMiles, kMillimeters, kCentimeters, kKilometers, kMeters, kLast };
+	MDistance(void) : value_(0.0), unit_(kCentimeters) {}
+	MDistance(double value, Unit unit = kCentimeters) : value_(value), unit_(unit) {}
+	double value(void) const { return value_; }
+	Unit unit(void) const { return unit_; }
+	double asCentimeters(void) const;
+private:
+	double value_; Unit unit_;
+};
+
+class MTime {
+public:
+	enum Unit { kInvalid, kHours, kMinutes, kSeconds, kMilliseconds, kGames, kFilm, kPALFrame, kNTSCFrame, kShowScan, kPALField, kNTSCField, kLast };
+	MTime(void) : value_(0.0), unit_(kFilm) {}
+	MTime(double value, Unit unit = kFilm) : value_(value), unit_(unit) {}
+	double value(void) const { return value_; }
+	Unit unit(void) const { return unit_; }
+	double as(Unit unit) const;
+	bool operator==(const MTime & other) const { return as(kSeconds) == other.as(kSeconds); }
+	bool operator!=(const MTime & other) const { return !(*this == other); }
+	static Unit uiUnit(void) { return kFilm; }
+private:
+	double value_; Unit unit_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// アトリビュート関数セット
+
+class MFnData {
+public:
+	enum Type { kInvalid, kNumeric, kPlugin, kPluginGeometry, kString, kMatrix, kStringArray, kDoubleArray, kIntArray, kPointArray, kVectorArray, kComponentList, kMesh, kLattice, kNurbsCurve, kNurbsSurface, kSphere, kDynArrayAttrs, kDynSweptGeometry, kSubdSurface, kNObject, kNId, kAny, kLast };
+};
+
+class MFnNumericData {
+public:
+	enum Type {
+		kInvalid, kBoolean, kByte, kChar, kShort, k2Short, k3Short, kLong, kInt = kLong, k2Long, k2Int = k2Long, k3Long, k3Int = k3Long,
+		kFloat, k2Float, k3Float, kDouble, k2Double, k3Double, k4Double, kAddr, kLast
+	};
+};
+
+class MFnBase {
+public:
+	MFnBase(void) {}
+	virtual ~MFnBase(void) {}
+	MObject object(void) const { return object_; }
+	MStatus setObject(const MObject & obj) { object_ = obj; return MStatus::kSuccess; }
+protected:
+	MObject object_;
+};
+
+class MFnAttribute : public MFnBase {
+public:
+	MFnAttribute(void) {}
+	MFnAttribute(const MObject & obj, MStatus * status = nullptr) { object_ = obj; if (status) *status = MStatus::kSuccess; }
+	MString name(void) const;
+	MString shortName(void) const;
+	bool isReadable(void) const;
+	bool isWritable(void) const;
+	bool isStorable(void) const;
+	bool isCached(void) const;
+	bool isKeyable(void) const;
+	bool isArray(void) const;
+	MStatus setReadable(bool state);
+	MStatus setWritable(bool state);
+	MStatus setStorable(bool state);
+	MStatus setCached(bool state);
+	MStatus setKeyable(bool state);
+	MStatus setArray(bool state);
+	MStatus setHidden(bool state);
+	MStatus setUsesArrayDataBuilder(bool state);
+	MStatus setDisconnectBehavior(int) { return MStatus::kSuccess; }
+protected:
+	mpbmock::AttributeData * _data(void) const;
+};
+
+class MFnNumericAttribute : public MFnAttribute {
+public:
+	MFnNumericAttribute(void) {}
+	MFnNumericAttribute(const MObject & obj, MStatus * status = nullptr) : MFnAttribute(obj, status) {}
+	MObject create(const MString & full_name, const MString & brief_name, MFnNumericData::Type type, double default_value = 0.0, MStatus * status = nullptr);
+	MObject create(const MString & full_name, const MString & brief_name, const MObject & child1, const MObject & child2, const MObject & child3 = MObject::kNullObj, MStatus * status = nullptr);
+	MObject createPoint(const MString & full_name, const MString & brief_name, MStatus * status = nullptr);
+	MFnNumericData::Type unitType(MStatus * status = nullptr) const;
+	MStatus setMin(double value);
+	MStatus setMax(double value);
+	MStatus setDefault(double value);
+};
+
+class MFnEnumAttribute : public MFnAttribute {
+public:
+	MFnEnumAttribute(void) {}
+	MFnEnumAttribute(const MObject & obj, MStatus * status = nullptr) : MFnAttribute(obj, status) {}
+	MObject create(const MString & full_name, const MString & brief_name, short default_value = 0, MStatus * status = nullptr);
+	MStatus addField(const MString & name, short index);
+	MString fieldName(short index, MStatus * status = nullptr) const;
+};
+
+class MFnUnitAttribute : public MFnAttribute {
+public:
+	enum Type { kInvalid, kAngle, kDistance, kTime, kLast };
+	MFnUnitAttribute(void) {}
+	MFnUnitAttribute(const MObject & obj, MStatus * status = nullptr) : MFnAttribute(obj, status) {}
+	MObject create(const MString & full_name, const MString & brief_name, const MAngle & default_value, MStatus * status = nullptr);
+	MObject create(const MString & full_name, const MString & brief_name, const MDistance & default_value, MStatus * status = nullptr);
+	MObject create(const MString & full_name, const MString & brief_name, const MTime & default_value, MStatus * status = nullptr);
+	Type unitType(MStatus * status = nullptr) const;
+};
+
+class MFnTypedAttribute : public MFnAttribute {
+public:
+	MFnTypedAttribute(void) {}
+	MFnTypedAttribute(const MObject & obj, MStatus * status = nullptr) : MFnAttribute(obj, status) {}
+	MObject create(const MString & full_name, const MString & brief_name, MFnData::Type type, const MObject & default_value = MObject::kNullObj, MStatus * status = nullptr);
+	MObject create(const MString & full_name, const MString & brief_name, MFnData::Type type, MStatus * status);
+	MFnData::Type attrType(MStatus * status = nullptr) const;
+};
+
+class MFnCompoundAttribute : public MFnAttribute {
+public:
+	MFnCompoundAttribute(void) {}
+	MFnCompoundAttribute(const MObject & obj, MStatus * status = nullptr) : MFnAttribute(obj, status) {}
+	MObject create(const MString & full_name, const MString & brief_name, MStatus * status = nullptr);
+	MStatus addChild(const MObject & child);
+	unsigned int numChildren(MStatus * status = nullptr) const;
+	MObject child(unsigned int index, MStatus * status = nullptr) const;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// 型付きデータ関数セット
+
+class MFnDoubleArrayData : public MFnBase {
+public:
+	MFnDoubleArrayData(void) {}
+	MFnDoubleArrayData(const MObject & obj, MStatus * status = nullptr);
+	MObject create(const MDoubleArray & array, MStatus * status = nullptr);
+	MObject create(MStatus * status = nullptr);
+	MDoubleArray array(MStatus * status = nullptr);
+	MStatus set(const MDoubleArray & array);
+	unsigned int length(MStatus * status = nullptr) const;
+	MStatus copyTo(MDoubleArray & array) const;
+	double operator[](unsigned int index) const;
+	double & operator[](unsigned int index);
+	/// @brief (MOCK ONLY) 内部配列への直接参照
+	std::vector<double> * _items(void) const;
+};
+
+class MFnIntArrayData : public MFnBase {
+public:
+	MFnIntArrayData(void) {}
+	MFnIntArrayData(const MObject & obj, MStatus * status = nullptr);
+	MObject create(const MIntArray & array, MStatus * status = nullptr);
+	MIntArray array(MStatus * status = nullptr);
+	MStatus set(const MIntArray & array);
+	unsigned int length(MStatus * status = nullptr) const;
+};
+
+class MFnPointArrayData : public MFnBase {
+public:
+	MFnPointArrayData(void) {}
+	MFnPointArrayData(const MObject & obj, MStatus * status = nullptr);
+	MObject create(const MPointArray & array, MStatus * status = nullptr);
+	MObject create(MStatus * status = nullptr);
+	MPointArray array(MStatus * status = nullptr);
+	MStatus set(const MPointArray & array);
+	unsigned int length(MStatus * status = nullptr) const;
+	MStatus copyTo(MPointArray & array) const;
+};
+
+class MFnVectorArrayData : public MFnBase {
+public:
+	MFnVectorArrayData(void) {}
+	MFnVectorArrayData(const MObject & obj, MStatus * status = nullptr);
+	MObject create(const MVectorArray & array, MStatus * status = nullptr);
+	MObject create(MStatus * status = nullptr);
+	MVectorArray array(MStatus * status = nullptr);
+	MStatus set(const MVectorArray & array);
+	unsigned int length(MStatus * status = nullptr) const;
+	MStatus copyTo(MVectorArray & array) const;
+};
+
+class MFnStringData : public MFnBase {
+public:
+	MFnStringData(void) {}
+	MFnStringData(const MObject & obj, MStatus * status = nullptr);
+	MObject create(const MString & str, MStatus * status = nullptr);
+	MObject create(MStatus * status = nullptr);
+	MString string(MStatus * status = nullptr) const;
+	MStatus set(const MString & str);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// プラグ / データブロック
+
+class MPlug {
+public:
+	MPlug(void) : logical_index_(-1) {}
+	MPlug(const MObject & node, const MObject & attribute) : node_(node), attribute_(attribute), logical_index_(-1) {}
+	MObject node(MStatus * status = nullptr) const { if (status) *status = MStatus::kSuccess; return node_; }
+	MObject attribute(MStatus * status = nullptr) const { if (status) *status = MStatus::kSuccess; return attribute_; }
+	MString name(MStatus * status = nullptr) const;
+	MString partialName(bool include_node_name = false, bool include_non_mandatory_indices = false, bool include_instanced_indices = false, bool use_alias = false, bool use_full_attribute_path = false, bool use_long_names = false, MStatus * status = nullptr) const;
+	bool isNull(MStatus * status = nullptr) const { if (status) *status = MStatus::kSuccess; return attribute_.isNull(); }
+	bool isElement(MStatus * status = nullptr) const { if (status) *status = MStatus::kSuccess; return logical_index_ >= 0; }
+	bool isArray(MStatus * status = nullptr) const;
+	MPlug elementByLogicalIndex(unsigned int index, MStatus * status = nullptr) const;
+	unsigned int logicalIndex(MStatus * status = nullptr) const { if (status) *status = MStatus::kSuccess; return static_cast<unsigned int>(logical_index_); }
+	MPlug array(MStatus * status = nullptr) const;
+	bool isChild(MStatus * status = nullptr) const { if (status) *status = MStatus::kSuccess; return false; }
+	MPlug parent(MStatus * status = nullptr) const { if (status) *status = MStatus::kInvalidParameter; return MPlug(); }
+	bool operator==(const MPlug & other) const { return node_ == other.node_ && attribute_ == other.attribute_ && logical_index_ == other.logical_index_; }
+	bool operator==(const MObject & attribute) const { return attribute_ == attribute; }
+	bool operator!=(const MPlug & other) const { return !(*this == other); }
+	bool operator!=(const MObject & attribute) const { return !(*this == attribute); }
+private:
+	MObject node_;
+	MObject attribute_;
+	int logical_index_;
+};
+
+class MPlugArray {
+public:
+	unsigned int length(void) const { return static_cast<unsigned int>(items_.size()); }
+	MStatus append(const MPlug & plug) { items_.push_back(plug); return MStatus::kSuccess; }
+	MStatus clear(void) { items_.clear(); return MStatus::kSuccess; }
+	const MPlug & operator[](unsigned int i) const { return items_[i]; }
+	MPlug & operator[](unsigned int i) { return items_[i]; }
+private:
+	std::vector<MPlug> items_;
+};
+
+class MDataHandle {
+public:
+	MDataHandle(void) : value_(nullptr), attribute_(nullptr) {}
+	MDataHandle(mpbmock::Value * value, const mpbmock::AttributeData * attribute) : value_(value), attribute_(attribute) {}
+
+	bool isNumeric(void) const;
+	MFnNumericData::Type numericType(void) const;
+	MFnData::Type type(void) const;
+	MObject attribute(void);
+
+	bool & asBool(void) const;
+	char & asChar(void) const;
+	short & asShort(void) const;
+	int & asInt(void) const;
+	int & asLong(void) const { return asInt(); }
+	float & asFloat(void) const;
+	double & asDouble(void) const;
+	double3 & asDouble3(void) const;
+	float3 & asFloat3(void) const;
+	MVector asVector(void) const;
+	MAngle asAngle(void) const;
+	MDistance asDistance(void) const;
+	MTime asTime(void) const;
+	MString asString(void) const;
+	MMatrix & asMatrix(void) const;
+	MObject data(void);
+
+	void set(bool value);
+	void set(char value);
+	void set(short value);
+	void set(int value);
+	void set(float value);
+	void set(double value);
+	void set(double x, double y, double z);
+	void set(float x, float y, float z);
+	void set(const MVector & value);
+	void set(const MMatrix & value);
+	void set(const MAngle & value);
+	void set(const MDistance & value);
+	void set(const MTime & value);
+	void set(const MString & value);
+	MStatus set(const MObject & value);
+	MStatus setMObject(const MObject & value) { return set(value); }
+	void setBool(bool value) { set(value); }
+	void setShort(short value) { set(value); }
+	void setInt(int value) { set(value); }
+	void setFloat(float value) { set(value); }
+	void setDouble(double value) { set(value); }
+	void setClean(void);
+	MDataHandle child(const MObject & attribute);
+
+	mpbmock::Value * _value(void) const { return value_; }
+
+private:
+	mpbmock::Value * value_;
+	const mpbmock::AttributeData * attribute_;
+};
+
+class MArrayDataBuilder {
+public:
+	MArrayDataBuilder(void) : value_(nullptr), attribute_(nullptr) {}
+	MArrayDataBuilder(const MObject & attribute, unsigned int num_elements, MStatus * status = nullptr);
+	MArrayDataBuilder(MDataBlock * block, const MObject & attribute, unsigned int num_elements, MStatus * status = nullptr);
+	MArrayDataBuilder(const MArrayDataBuilder & other);
+	MArrayDataBuilder & operator=(const MArrayDataBuilder & other);
+	~MArrayDataBuilder(void);
+	MDataHandle addElement(unsigned int index, MStatus * status = nullptr);
+	MArrayDataHandle addElementArray(unsigned int index, MStatus * status = nullptr);
+	MStatus removeElement(unsigned int index);
+	unsigned int elementCount(MStatus * status = nullptr) const;
+	MStatus growArray(unsigned int amount) { (void)amount; return MStatus::kSuccess; }
+	MStatus setGrowSize(unsigned int size) { (void)size; return MStatus::kSuccess; }
+
+	mpbmock::Value * _value(void) const { return value_; }
+private:
+	friend class MArrayDataHandle;
+	mpbmock::Value * value_;
+	const mpbmock::AttributeData * attribute_;
+	bool owns_;
+};
+
+class MArrayDataHandle {
+public:
+	MArrayDataHandle(void) : value_(nullptr), attribute_(nullptr), cursor_(0) {}
+	MArrayDataHandle(const MDataHandle & handle, MStatus * status = nullptr);
+	MArrayDataHandle(mpbmock::Value * value, const mpbmock::AttributeData * attribute) : value_(value), attribute_(attribute), cursor_(0) {}
+	MDataHandle inputValue(MStatus * status = nullptr);
+	MDataHandle outputValue(MStatus * status = nullptr);
+	MArrayDataHandle inputArrayValue(MStatus * status = nullptr);
+	MArrayDataHandle outputArrayValue(MStatus * status = nullptr);
+	MStatus next(void);
+	unsigned int elementCount(MStatus * status = nullptr);
+	unsigned int elementIndex(MStatus * status = nullptr);
+	MStatus jumpToElement(unsigned int logical_index);
+	MStatus jumpToArrayElement(unsigned int physical_index);
+	MStatus setClean(void);
+	MStatus setAllClean(void);
+	MArrayDataBuilder builder(MStatus * status = nullptr);
+	MStatus set(const MArrayDataBuilder & builder);
+private:
+	mpbmock::Value * value_;
+	const mpbmock::AttributeData * attribute_;
+	unsigned int cursor_;
+};
+
+class MDataBlock {
+public:
+	MDataBlock(void) : node_(nullptr) {}
+	explicit MDataBlock(mpbmock::NodeEntity * node) : node_(node) {}
+	MDataHandle inputValue(const MPlug & plug, MStatus * status = nullptr);
+	MDataHandle inputValue(const MObject & attribute, MStatus * status = nullptr);
+	MDataHandle outputValue(const MPlug & plug, MStatus * status = nullptr);
+	MDataHandle outputValue(const MObject & attribute, MStatus * status = nullptr);
+	MArrayDataHandle inputArrayValue(const MPlug & plug, MStatus * status = nullptr);
+	MArrayDataHandle inputArrayValue(const MObject & attribute, MStatus * status = nullptr);
+	MArrayDataHandle outputArrayValue(const MPlug & plug, MStatus * status = nullptr);
+	MArrayDataHandle outputArrayValue(const MObject & attribute, MStatus * status = nullptr);
+	MStatus setClean(const MPlug & plug);
+	MStatus setClean(const MObject & attribute);
+	bool isClean(const MPlug & plug);
+	bool isClean(const MObject & attribute);
+	mpbmock::NodeEntity * _node(void) const { return node_; }
+private:
+	mpbmock::NodeEntity * node_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// プロキシクラス
+
+class MPxNode {
+public:
+	enum Type {
+		kDependNode, kLocatorNode, kDeformerNode, kManipContainer, kSurfaceShape, kFieldNode, kEmitterNode, kSpringNode,
+		kIkSolverNode, kHardwareShader, kHwShaderNode, kTransformNode, kManipulatorNode, kClientDeviceNode,
+		kThreadedDeviceNode, kAssembly, kCameraSetNode, kConstraintNode, kPluginBlendNode, kLast
+	};
+	enum SchedulingType { kParallel, kGloballySerial, kUntrusted, kDefaultScheduling };
+
+	MPxNode(void);
+	virtual ~MPxNode(void);
+	virtual void postConstructor(void) {}
+	virtual MStatus compute(const MPlug & plug, MDataBlock & data);
+	virtual MStatus setDependentsDirty(const MPlug & plug_being_dirtied, MPlugArray & affected_plugs);
+	virtual Type type(void) const { return kDependNode; }
+	MObject thisMObject(void) const;
+	MString name(void) const;
+	MTypeId typeId(void) const;
+	MString typeName(void) const;
+
+	static MStatus addAttribute(const MObject & attribute);
+	static MStatus attributeAffects(const MObject & when_changes, const MObject & is_affected);
+	static MStatus inheritAttributesFrom(const MString & parent_class_name);
+
+	static MObject message;
+	static MObject isHistoricallyInteresting;
+	static MObject caching;
+	static MObject state;
+	static MObject frozen;
+
+	mpbmock::NodeEntity * _entity(void) const { return entity_; }
+	void _setEntity(mpbmock::NodeEntity * entity) { entity_ = entity; }
+
+private:
+	mpbmock::NodeEntity * entity_;
+};
+
+class MArgList {
+public:
+	MArgList(void) {}
+	unsigned int length(MStatus * status = nullptr) const { if (status) *status = MStatus::kSuccess; return static_cast<unsigned int>(args_.size()); }
+	bool asBool(unsigned int index, MStatus * status = nullptr) const;
+	int asInt(unsigned int index, MStatus * status = nullptr) const;
+	double asDouble(unsigned int index, MStatus * status = nullptr) const;
+	MString asString(unsigned int index, MStatus * status = nullptr) const;
+	MDoubleArray asDoubleArray(unsigned int & index, MStatus * status = nullptr) const;
+	MIntArray asIntArray(unsigned int & index, MStatus * status = nullptr) const;
+	MStringArray asStringArray(unsigned int & index, MStatus * status = nullptr) const;
+	MArgList & addArg(bool value);
+	MArgList & addArg(int value);
+	MArgList & addArg(double value);
+	MArgList & addArg(const MString & value);
+	MArgList & addArg(const char * value) { return addArg(MString(value)); }
+	MArgList & addArg(const MDoubleArray & value);
+	MArgList & addArg(const MIntArray & value);
+	MArgList & addArg(const MStringArray & value);
+private:
+	struct Arg {
+		enum Kind { kBool, kInt, kDouble, kString, kDoubleArray, kIntArray, kStringArray } kind;
+		double number;
+		MString string;
+		std::vector<double> doubles;
+		std::vector<MString> strings;
+	};
+	std::vector<Arg> args_;
+};
+
+class MSyntax {
+public:
+	enum MArgType { kNoArg, kBoolean, kLong, kDouble, kString, kUnsigned, kDistance, kAngle, kTime, kSelectionItem, kLastArgType };
+	MStatus addFlag(const char *, const char *, MArgType = kNoArg, MArgType = kNoArg, MArgType = kNoArg, MArgType = kNoArg, MArgType = kNoArg, MArgType = kNoArg) { return MStatus::kSuccess; }
+	MStatus makeFlagMultiUse(const char *) { return MStatus::kSuccess; }
+	MStatus addArg(MArgType) { return MStatus::kSuccess; }
+	void enableQuery(bool) {}
+	void enableEdit(bool) {}
+};
+
+class MPxCommand {
+public:
+	MPxCommand(void) {}
+	virtual ~MPxCommand(void) {}
+	virtual MStatus doIt(const MArgList & args) = 0;
+	virtual MStatus undoIt(void) { return MStatus::kSuccess; }
+	virtual MStatus redoIt(void) { return MStatus::kSuccess; }
+	virtual bool isUndoable(void) const { return false; }
+	virtual bool hasSyntax(void) const { return true; }
+
+	static void setResult(const MString & result);
+	static void setResult(const char * result) { setResult(MString(result)); }
+	static void setResult(bool result);
+	static void setResult(int result);
+	static void setResult(double result);
+	static void setResult(const MDoubleArray & result);
+	static void appendToResult(const MString & result);
+	static void appendToResult(const char * result) { appendToResult(MString(result)); }
+	static void clearResult(void);
+	static void displayInfo(const MString & message);
+	static void displayWarning(const MString & message, bool show_line_number = false);
+	static void displayError(const MString & message, bool show_line_number = false);
+};
+
+class MFileObject {
+public:
+	MFileObject(void) {}
+	MStatus setRawFullName(const MString & name) { path_ = name; return MStatus::kSuccess; }
+	MString rawFullName(void) const { return path_; }
+	MString resolvedFullName(void) const { return path_; }
+	MString fullName(void) const { return path_; }
+	MString resolvedName(void) const;
+	MString resolvedPath(void) const;
+	bool exists(void) const;
+private:
+	MString path_;
+};
+
+class MPxFileTranslator {
+public:
+	enum MFileKind { kIsMyFileType, kCouldBeMyFileType, kNotMyFileType };
+	enum FileAccessMode { kUnknownAccessMode, kOpenAccessMode, kReferenceAccessMode, kImportAccessMode, kSaveAccessMode, kExportAccessMode, kExportActiveAccessMode };
+	MPxFileTranslator(void) {}
+	virtual ~MPxFileTranslator(void) {}
+	virtual MStatus reader(const MFileObject & file, const MString & options_string, FileAccessMode mode);
+	virtual MStatus writer(const MFileObject & file, const MString & options_string, FileAccessMode mode);
+	virtual bool haveReadMethod(void) const { return false; }
+	virtual bool haveWriteMethod(void) const { return false; }
+	virtual bool haveNamespaceSupport(void) const { return false; }
+	virtual bool haveReferenceMethod(void) const { return false; }
+	virtual MString defaultExtension(void) const { return MString(); }
+	virtual MString filter(void) const { return MString("*.*"); }
+	virtual bool canBeOpened(void) const { return true; }
+	virtual MFileKind identifyFile(const MFileObject & file, const char * buffer, short size) const { (void)file; (void)buffer; (void)size; return kNotMyFileType; }
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// プラグイン / グローバル
+
+class MFnPlugin : public MFnBase {
+public:
+	MFnPlugin(void) {}
+	MFnPlugin(MObject & object, const char * vendor = "Unknown", const char * version = "Unknown", const char * required_api_version = "Any", MStatus * status = nullptr);
+	MStatus registerNode(const MString & type_name, const MTypeId & type_id, void * (*creator)(), MStatus (*initialize)(), MPxNode::Type type = MPxNode::kDependNode, const MString * classification = nullptr);
+	MStatus deregisterNode(const MTypeId & type_id);
+	MStatus registerCommand(const MString & command_name, void * (*creator)(), MSyntax (*create_syntax)() = nullptr);
+	MStatus deregisterCommand(const MString & command_name);
+	MStatus registerFileTranslator(const MString & translator_name, const char * pixmap_name, void * (*creator)(), const char * options_script_name = nullptr, const char * default_options_string = nullptr, bool requires_full_mel = false);
+	MStatus deregisterFileTranslator(const MString & translator_name);
+	MString vendor(void) const { return vendor_; }
+	MString version(void) const { return version_; }
+private:
+	MString vendor_;
+	MString version_;
+};
+
+class MGlobal {
+public:
+	enum MSelectionMode { kSelectObjectMode, kSelectComponentMode, kSelectRootMode, kSelectLeafMode, kSelectTemplateMode };
+	enum MMayaState { kBaseUIMode, kInteractive, kBatch, kLibraryApp };
+	/// ヘッドレスのホストは kLibraryApp
+	static MMayaState mayaState(MStatus * status = nullptr);
+	static void displayInfo(const MString & message);
+	static void displayWarning(const MString & message);
+	static void displayError(const MString & message);
+	static MStatus executeCommand(const MString & command, bool display_enabled = false, bool undo_enabled = false);
+	static MStatus executeCommand(const MString & command, MString & result, bool display_enabled = false, bool undo_enabled = false);
+	static MStatus executeCommandOnIdle(const MString & command, bool display_enabled = false);
+};
+
+class MFnDependencyNode : public MFnBase {
+public:
+	MFnDependencyNode(void) {}
+	MFnDependencyNode(const MObject & obj, MStatus * status = nullptr) { object_ = obj; if (status) *status = MStatus::kSuccess; }
+	MString name(MStatus * status = nullptr) const;
+	MString typeName(MStatus * status = nullptr) const;
+	MTypeId typeId(MStatus * status = nullptr) const;
+	MPxNode * userNode(MStatus * status = nullptr) const;
+	MPlug findPlug(const MString & attribute_name, bool want_networked_plug = true, MStatus * status = nullptr) const;
+	MObject attribute(const MString & attribute_name, MStatus * status = nullptr) const;
+};
+
+#endif // MAYA_PLUGIN_BASE_MOCK_CORE_H_
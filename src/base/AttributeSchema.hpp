@@ -0,0 +1,234 @@
+﻿/// @file AttributeSchema.hpp
+/// @brief アトリビュートスキーマ定義ヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_ATTRIBUTE_SCHEMA_HPP_
+#define _MAYA_PLUGIN_BASE_ATTRIBUTE_SCHEMA_HPP_
+
+#include <maya/MFnAttribute.h>
+#include <maya/MFnNumericData.h>
+#include <maya/MDataHandle.h>
+#include <maya/MAngle.h>
+#include <maya/MDistance.h>
+#include <maya/MTime.h>
+#include <maya/MVector.h>
+#include <array>
+#include <cstddef>
+
+namespace mpb {
+
+/// @brief アトリビュートの属性
+///
+/// 以前はNodeBaseの内部クラスでしたが、スキーマの記述子から使えるよう名前空間直下に移動しました。
+/// NodeBase::AttributeOptionsとしても引き続き参照できます。
+///
+struct AttributeOptions {
+	bool is_readable, is_writable, is_cached, is_keyable, is_storable;
+	constexpr AttributeOptions(const bool is_readable = true, const bool is_writable = true, const bool is_cached = true, const bool is_keyable = true, const bool is_storable = true) noexcept
+		: is_readable(is_readable), is_writable(is_writable), is_cached(is_cached), is_keyable(is_keyable), is_storable(is_storable) {}
+	constexpr AttributeOptions(const AttributeOptions&) = default;
+	void apply(MFnAttribute & attr) const;
+};
+
+
+/// @brief スキーマで扱えるアトリビュートの種類
+enum class AttributeKind {
+	kNumeric,	///< MFnNumericAttribute
+	kEnum,		///< MFnEnumAttribute
+	kAngle,		///< MFnUnitAttribute(MAngle)
+	kDistance,	///< MFnUnitAttribute(MDistance)
+	kTime,		///< MFnUnitAttribute(MTime)
+};
+
+
+/// @brief Enumアトリビュートの項目
+struct EnumField {
+	const char * name;
+	short value;
+};
+
+
+/// @brief アトリビュート1つ分の記述子
+///
+/// 直接初期化せず、numericAttribute等のconstexpr関数で生成してください。
+///
+struct AttributeDesc {
+	AttributeKind kind;
+	const char * longname;
+	const char * shortname;
+	MFnNumericData::Type numeric_type;	///< kNumeric以外はkInvalid
+	double def_value;					///< 既定値。単位付きの場合はMAngle::kRadians, MDistance::kCentimeters, MTime::kFilmでの値
+	AttributeOptions options;
+	const EnumField * fields;			///< kEnumのみ
+	size_t num_fields;					///< kEnumのみ
+};
+
+
+/// @brief アトリビュートの影響関係
+///
+/// スキーマ内のアトリビュート番号で指定します。
+///
+struct AttributeAffects {
+	size_t when_changes;
+	size_t is_affect;
+};
+
+
+namespace schema_detail {
+
+constexpr bool equalNames(const char * a, const char * b) {
+	while (*a != '\0' && *a == *b) { ++a; ++b; }
+	return *a == *b;
+}
+
+}
+
+
+/// @brief アトリビュートスキーマ
+///
+/// ノードの全アトリビュートと影響関係をコンパイル時に列挙する型です。
+/// ノードクラスにstatic constexprメンバkSchemaとして定義し、SchemaNodeを継承するとinitialize関数が自動生成されます。
+///
+/// @tparam N アトリビュート数
+/// @tparam E 影響関係の数
+///
+template <size_t N, size_t E>
+struct AttributeSchema {
+	static constexpr size_t kNumAttributes = N;
+	static constexpr size_t kNumAffects = E;
+
+	std::array<AttributeDesc, N> attributes;
+	std::array<AttributeAffects, E> affects;
+
+	/// @brief 短い名前の重複があるか
+	constexpr bool hasDuplicateShortName(void) const {
+		for (size_t i = 0; i < N; ++i) {
+			for (size_t j = i + 1; j < N; ++j) {
+				if (schema_detail::equalNames(attributes[i].shortname, attributes[j].shortname)) return true;
+			}
+		}
+		return false;
+	}
+
+	/// @brief 長い名前の重複があるか
+	constexpr bool hasDuplicateLongName(void) const {
+		for (size_t i = 0; i < N; ++i) {
+			for (size_t j = i + 1; j < N; ++j) {
+				if (schema_detail::equalNames(attributes[i].longname, attributes[j].longname)) return true;
+			}
+		}
+		return false;
+	}
+
+	/// @brief 存在しないアトリビュートを指す影響関係があるか
+	constexpr bool hasDanglingAffects(void) const {
+		for (size_t e = 0; e < E; ++e) {
+			if (affects[e].when_changes >= N || affects[e].is_affect >= N) return true;
+		}
+		return false;
+	}
+
+	/// @brief 他のアトリビュートから影響を受けるか（＝出力か）
+	constexpr bool isAffected(const size_t index) const {
+		for (size_t e = 0; e < E; ++e) {
+			if (affects[e].is_affect == index) return true;
+		}
+		return false;
+	}
+};
+
+
+/// @brief Numericアトリビュートの記述子を生成する
+constexpr AttributeDesc numericAttribute(const char * longname, const char * shortname, const MFnNumericData::Type numeric_type = MFnNumericData::kDouble, const double def_value = 0.0, const AttributeOptions & options = AttributeOptions()) {
+	return AttributeDesc{ AttributeKind::kNumeric, longname, shortname, numeric_type, def_value, options, nullptr, 0 };
+}
+
+/// @brief Enumアトリビュートの記述子を生成する
+///
+/// fieldsは静的記憶域のconstexpr配列を指定してください。
+///
+template <size_t F>
+constexpr AttributeDesc enumAttribute(const char * longname, const char * shortname, const EnumField (&fields)[F], const short def_value = 0, const AttributeOptions & options = AttributeOptions()) {
+	return AttributeDesc{ AttributeKind::kEnum, longname, shortname, MFnNumericData::kInvalid, static_cast<double>(def_value), options, fields, F };
+}
+
+/// @brief 角度アトリビュートの記述子を生成する
+constexpr AttributeDesc angleAttribute(const char * longname, const char * shortname, const double def_radians = 0.0, const AttributeOptions & options = AttributeOptions()) {
+	return AttributeDesc{ AttributeKind::kAngle, longname, shortname, MFnNumericData::kInvalid, def_radians, options, nullptr, 0 };
+}
+
+/// @brief 距離アトリビュートの記述子を生成する
+constexpr AttributeDesc distanceAttribute(const char * longname, const char * shortname, const double def_centimeters = 0.0, const AttributeOptions & options = AttributeOptions()) {
+	return AttributeDesc{ AttributeKind::kDistance, longname, shortname, MFnNumericData::kInvalid, def_centimeters, options, nullptr, 0 };
+}
+
+/// @brief 時間アトリビュートの記述子を生成する
+constexpr AttributeDesc timeAttribute(const char * longname, const char * shortname, const double def_frames = 0.0, const AttributeOptions & options = AttributeOptions()) {
+	return AttributeDesc{ AttributeKind::kTime, longname, shortname, MFnNumericData::kInvalid, def_frames, options, nullptr, 0 };
+}
+
+/// @brief 影響関係を生成する
+constexpr AttributeAffects affects(const size_t when_changes, const size_t is_affect) {
+	return AttributeAffects{ when_changes, is_affect };
+}
+
+
+/// @brief アトリビュートの値の型
+///
+/// 記述子の種類から、MDataHandleで読み書きする型を決定します。
+///
+template <AttributeKind K, MFnNumericData::Type T> struct AttributeValue;
+
+template <> struct AttributeValue<AttributeKind::kNumeric, MFnNumericData::kDouble> {
+	typedef double type;
+	static type get(const MDataHandle & h) { return h.asDouble(); }
+	static void set(MDataHandle & h, const type v) { h.set(v); }
+};
+template <> struct AttributeValue<AttributeKind::kNumeric, MFnNumericData::kFloat> {
+	typedef float type;
+	static type get(const MDataHandle & h) { return h.asFloat(); }
+	static void set(MDataHandle & h, const type v) { h.set(v); }
+};
+template <> struct AttributeValue<AttributeKind::kNumeric, MFnNumericData::kInt> {
+	typedef int type;
+	static type get(const MDataHandle & h) { return h.asInt(); }
+	static void set(MDataHandle & h, const type v) { h.set(v); }
+};
+template <> struct AttributeValue<AttributeKind::kNumeric, MFnNumericData::kShort> {
+	typedef short type;
+	static type get(const MDataHandle & h) { return h.asShort(); }
+	static void set(MDataHandle & h, const type v) { h.set(v); }
+};
+template <> struct AttributeValue<AttributeKind::kNumeric, MFnNumericData::kBoolean> {
+	typedef bool type;
+	static type get(const MDataHandle & h) { return h.asBool(); }
+	static void set(MDataHandle & h, const type v) { h.set(v); }
+};
+template <> struct AttributeValue<AttributeKind::kNumeric, MFnNumericData::k3Double> {
+	typedef MVector type;
+	static type get(const MDataHandle & h) { return h.asVector(); }
+	static void set(MDataHandle & h, const type & v) { h.set(v); }
+};
+template <> struct AttributeValue<AttributeKind::kEnum, MFnNumericData::kInvalid> {
+	typedef short type;
+	static type get(const MDataHandle & h) { return h.asShort(); }
+	static void set(MDataHandle & h, const type v) { h.set(v); }
+};
+template <> struct AttributeValue<AttributeKind::kAngle, MFnNumericData::kInvalid> {
+	typedef MAngle type;
+	static type get(const MDataHandle & h) { return h.asAngle(); }
+	static void set(MDataHandle & h, const type & v) { h.set(v); }
+};
+template <> struct AttributeValue<AttributeKind::kDistance, MFnNumericData::kInvalid> {
+	typedef MDistance type;
+	static type get(const MDataHandle & h) { return h.asDistance(); }
+	static void set(MDataHandle & h, const type & v) { h.set(v); }
+};
+template <> struct AttributeValue<AttributeKind::kTime, MFnNumericData::kInvalid> {
+	typedef MTime type;
+	static type get(const MDataHandle & h) { return h.asTime(); }
+	static void set(MDataHandle & h, const type & v) { h.set(v); }
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_ATTRIBUTE_SCHEMA_HPP_
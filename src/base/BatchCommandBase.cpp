@@ -0,0 +1,243 @@
+﻿#include "BatchCommandBase.hpp"
+#include "util/Logger.hpp"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+/// @brief -batchのフラグか
+bool isBatchFlag(const MString & flag)
+{ return flag == "-b" || flag == "-batch"; }
+
+/// @brief 全件分の引数。区切りを'\0'にした1つのバッファと、各引数の先頭へのポインタ
+struct BatchTokens {
+	std::string storage;
+	std::vector<const char *> tokens;
+	std::vector<std::pair<size_t, size_t>> items;	///< (先頭の引数の番号, 引数の数)
+};
+
+/// @brief 「;」・改行区切りの件、空白区切りの引数に分割する
+void tokenize(const std::string & source, BatchTokens & out)
+{
+	std::vector<size_t> starts;
+	size_t item_begin = 0;
+	bool open = false;
+
+	const auto closeToken = [&] {
+		if (!open) return;
+		out.storage.push_back('\0');
+		open = false;
+	};
+	const auto openToken = [&] {
+		if (open) return;
+		starts.push_back(out.storage.size());
+		open = true;
+	};
+	const auto closeItem = [&] {
+		closeToken();
+		if (starts.size() > item_begin) out.items.emplace_back(item_begin, starts.size() - item_begin);
+		item_begin = starts.size();
+	};
+
+	out.storage.reserve(source.size() + 1);
+	for (size_t i = 0; i < source.size(); ++i) {
+		const char c = source[i];
+		if (c == ';' || c == '\n') closeItem();
+		else if (c == ' ' || c == '\t' || c == '\r') closeToken();
+		else if (c == '"') {
+			openToken();
+			const size_t end = source.find('"', i + 1);
+			if (end == std::string::npos) mpb::MStatusException::throwError(MStatus::kInvalidParameter, "「\"」が閉じられていません", "mpb::BatchCommandBase::doIt");
+			out.storage.append(source, i + 1, end - i - 1);
+			i = end;
+		}
+		else {
+			openToken();
+			out.storage.push_back(c);
+		}
+	}
+	closeItem();
+
+	// storageの伸長が終わってからポインタにする
+	out.tokens.reserve(starts.size());
+	for (const size_t s : starts) out.tokens.push_back(out.storage.data() + s);
+}
+
+/// @brief MArgListをそのまま1件として扱う
+void singleItem(const MArgList & args, BatchTokens & out)
+{
+	std::vector<size_t> starts;
+	for (unsigned int i = 0; i < args.length(); ++i) {
+		MStatus stat;
+		const MString arg = args.asString(i, &stat);
+		mpb::MStatusException::throwIf(stat, "引数の取得に失敗", "mpb::BatchCommandBase::doIt");
+		starts.push_back(out.storage.size());
+		out.storage.append(arg.asChar(), arg.length());
+		out.storage.push_back('\0');
+	}
+	out.items.emplace_back(0, starts.size());
+	for (const size_t s : starts) out.tokens.push_back(out.storage.data() + s);
+}
+
+}
+
+////////////////////////////////////////////////
+// BatchArgs
+
+const char * mpb::BatchArgs::asChar(const unsigned int index) const
+{
+	if (index >= this->count_) MStatusException::throwError(MStatus::kInvalidParameter, MString(("引数が足りません : " + std::to_string(index)).c_str()), "mpb::BatchArgs::asChar");
+	return this->tokens_[index];
+}
+
+double mpb::BatchArgs::asDouble(const unsigned int index) const
+{
+	const char * s = this->asChar(index);
+	char * end = nullptr;
+	errno = 0;
+	const double v = std::strtod(s, &end);
+	if (end == s || *end != '\0' || errno == ERANGE) MStatusException::throwError(MStatus::kInvalidParameter, MString("実数ではありません : ") + s, "mpb::BatchArgs::asDouble");
+	return v;
+}
+
+int mpb::BatchArgs::asInt(const unsigned int index) const
+{
+	const char * s = this->asChar(index);
+	char * end = nullptr;
+	errno = 0;
+	const long v = std::strtol(s, &end, 10);
+	if (end == s || *end != '\0' || errno == ERANGE || v < INT_MIN || v > INT_MAX) MStatusException::throwError(MStatus::kInvalidParameter, MString("整数ではありません : ") + s, "mpb::BatchArgs::asInt");
+	return static_cast<int>(v);
+}
+
+bool mpb::BatchArgs::asBool(const unsigned int index) const
+{
+	const MString s(this->asChar(index));
+	if (s == "1" || s == "true" || s == "on" || s == "yes") return true;
+	if (s == "0" || s == "false" || s == "off" || s == "no") return false;
+	MStatusException::throwError(MStatus::kInvalidParameter, "真偽値ではありません : " + s, "mpb::BatchArgs::asBool");
+}
+
+////////////////////////////////////////////////
+// BatchRecord
+
+void mpb::BatchRecord::writeString(const MString & value)
+{
+	const uint32_t length = value.length();
+	this->write(length);
+	this->bytes_.insert(this->bytes_.end(), value.asChar(), value.asChar() + length);
+}
+
+void mpb::BatchRecord::discardLast(void)
+{
+	if (this->offsets_.empty()) return;
+	this->bytes_.resize(this->offsets_.back());
+	this->offsets_.pop_back();
+}
+
+mpb::BatchRecord::Reader mpb::BatchRecord::item(const size_t index) const
+{
+	const size_t begin = this->offsets_[index];
+	const size_t end = (index + 1 < this->offsets_.size() ? this->offsets_[index + 1] : this->bytes_.size());
+	return Reader(this->bytes_.data() + begin, end - begin);
+}
+
+const char * mpb::BatchRecord::Reader::take(const size_t size)
+{
+	if (size > this->size_ - this->offset_) MStatusException::throwError(MStatus::kFailure, "記録の末尾を越えて読み出そうとしました", "mpb::BatchRecord::Reader::read");
+	const char * p = this->data_ + this->offset_;
+	this->offset_ += size;
+	return p;
+}
+
+MString mpb::BatchRecord::Reader::readString(void)
+{
+	const uint32_t length = this->read<uint32_t>();
+	const char * p = this->take(length);
+	return MString(p, static_cast<int>(length));
+}
+
+////////////////////////////////////////////////
+// BatchCommandBase
+
+mpb::BatchCommandBase::BatchCommandBase(const MString & command, const bool is_undoable) noexcept
+	: CommandBase(command, is_undoable) {}
+
+mpb::BatchCommandBase::~BatchCommandBase(void) {}
+
+MStatus mpb::BatchCommandBase::doIt(const MArgList & args)
+{
+	try {
+		BatchTokens batch;
+		MStatus stat;
+		if (args.length() > 0 && isBatchFlag(args.asString(0, &stat))) {
+			std::string source;
+			for (unsigned int i = 1; i < args.length(); ++i) {
+				const MString buffer = args.asString(i, &stat);
+				MStatusException::throwIf(stat, "-batchの値の取得に失敗", "mpb::BatchCommandBase::doIt");
+				source.append(buffer.asChar(), buffer.length());
+				source.push_back('\n');
+			}
+			tokenize(source, batch);
+		}
+		else {
+			singleItem(args, batch);
+		}
+
+		for (size_t k = 0; k < batch.items.size(); ++k) {
+			const auto & item = batch.items[k];
+			this->record_.begin();
+			try {
+				this->doItem(BatchArgs(batch.tokens.data() + item.first, static_cast<unsigned int>(item.second)), this->record_);
+			}
+			catch (const MStatusException & e) {
+				// 全件で1つの操作なので、実行済みの件を取り消してから失敗にする
+				this->record_.discardLast();
+				if (this->isUndoable()) this->replay(true);
+				throw MStatusException(e.stat, MString(("バッチの" + std::to_string(k + 1) + "件目で失敗 : ").c_str()) + e.message, "mpb::BatchCommandBase::doIt");
+			}
+		}
+	}
+	catch (const MStatusException & e) {
+		MPB_LOG_ERROR("%s", e.toString("COMMAND : " + this->command_).asChar());
+		displayError(e.message);
+		return e.stat;
+	}
+	return MStatus::kSuccess;
+}
+
+MStatus mpb::BatchCommandBase::redoIt(void)
+{ return this->replay(false); }
+
+MStatus mpb::BatchCommandBase::undoIt(void)
+{ return this->replay(true); }
+
+void mpb::BatchCommandBase::undoItem(BatchRecord::Reader & record)
+{
+	MStatusException::throwError(MStatus::kUnknownParameter, "undoItem関数が定義されていません", "mpb::BatchCommandBase::undoItem<default>");
+}
+
+void mpb::BatchCommandBase::redoItem(BatchRecord::Reader & record)
+{
+	MStatusException::throwError(MStatus::kUnknownParameter, "redoItem関数が定義されていません", "mpb::BatchCommandBase::redoItem<default>");
+}
+
+MStatus mpb::BatchCommandBase::replay(const bool undo)
+{
+	const size_t n = this->record_.size();
+	try {
+		for (size_t i = 0; i < n; ++i) {
+			BatchRecord::Reader reader = this->record_.item(undo ? n - 1 - i : i);
+			if (undo) this->undoItem(reader);
+			else this->redoItem(reader);
+		}
+	}
+	catch (const MStatusException & e) {
+		MPB_LOG_ERROR("%s", e.toString("COMMAND : " + this->command_).asChar());
+		displayError(e.message);
+		return e.stat;
+	}
+	return MStatus::kSuccess;
+}
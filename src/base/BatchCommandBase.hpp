@@ -0,0 +1,209 @@
+﻿/// @file BatchCommandBase.hpp
+/// @brief BatchCommandBaseクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_BATCH_COMMAND_BASE_HPP_
+#define _MAYA_PLUGIN_BASE_BATCH_COMMAND_BASE_HPP_
+
+#include "base/CommandBase.hpp"
+#include <maya/MArgList.h>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace mpb {
+
+/// @brief バッチ実行の1件分の引数
+///
+/// MArgListと同じように添字で取り出します。値はバッチ全体で共有するバッファを指しており、1件ごとの確保はありません。
+///
+class BatchArgs {
+public:
+
+	/// @brief 引数の数
+	unsigned int length(void) const noexcept { return this->count_; }
+
+	/// @brief 文字列で取得する
+	/// @throw MStatusException 範囲外の場合
+	const char * asChar(const unsigned int index) const;
+
+	/// @brief MStringで取得する
+	/// @throw MStatusException 範囲外の場合
+	MString asString(const unsigned int index) const { return MString(this->asChar(index)); }
+
+	/// @brief 実数で取得する
+	/// @throw MStatusException 範囲外、または実数として解釈できない場合
+	double asDouble(const unsigned int index) const;
+
+	/// @brief 整数で取得する
+	/// @throw MStatusException 範囲外、または整数として解釈できない場合
+	int asInt(const unsigned int index) const;
+
+	/// @brief 真偽値で取得する。true/on/yes/1を真、false/off/no/0を偽とします
+	/// @throw MStatusException 範囲外、または真偽値として解釈できない場合
+	bool asBool(const unsigned int index) const;
+
+private:
+	friend class BatchCommandBase;
+
+	BatchArgs(const char * const * tokens, const unsigned int count) noexcept : tokens_(tokens), count_(count) {}
+
+	const char * const * tokens_;
+	unsigned int count_;
+};
+
+
+/// @brief バッチ実行の取り消し・やり直し用の記録
+///
+/// 全件分を1つの連続したバッファに詰めて保持します。1件ごとにオブジェクトやundoキューの項目を作りません。
+/// 書き込んだ順にReaderで読み出します。
+///
+class BatchRecord {
+public:
+
+	/// @brief 値を追記する
+	/// @param [in] value トリビアルコピー可能な値
+	template <class T> void write(const T & value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "BatchRecord::writeにはトリビアルコピー可能な型を指定してください");
+		const size_t offset = this->bytes_.size();
+		this->bytes_.resize(offset + sizeof(T));
+		std::memcpy(this->bytes_.data() + offset, &value, sizeof(T));
+	}
+
+	/// @brief 文字列を追記する
+	void writeString(const MString & value);
+
+	/// @brief 記録した件数
+	size_t size(void) const noexcept { return this->offsets_.size(); }
+
+	/// @brief 記録のバイト数
+	size_t bytes(void) const noexcept { return this->bytes_.size(); }
+
+
+	/// @brief 1件分の記録を読み出す
+	class Reader {
+	public:
+		/// @brief 値を読み出す
+		/// @throw MStatusException 記録の末尾を越えた場合
+		template <class T> T read(void)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "BatchRecord::Reader::readにはトリビアルコピー可能な型を指定してください");
+			T value;
+			std::memcpy(&value, this->take(sizeof(T)), sizeof(T));
+			return value;
+		}
+
+		/// @brief 文字列を読み出す
+		/// @throw MStatusException 記録の末尾を越えた場合
+		MString readString(void);
+
+	private:
+		friend class BatchRecord;
+		Reader(const char * data, const size_t size) noexcept : data_(data), size_(size), offset_(0) {}
+
+		const char * take(const size_t size);
+
+		const char * data_;
+		size_t size_;
+		size_t offset_;
+	};
+
+private:
+	friend class BatchCommandBase;
+
+	std::vector<char> bytes_;
+	std::vector<size_t> offsets_;	///< 各件の記録の開始位置
+
+	void begin(void) { this->offsets_.push_back(this->bytes_.size()); }
+	void discardLast(void);
+	Reader item(const size_t index) const;
+};
+
+
+/// @brief 複数件をまとめて実行できるコマンドのベースクラス
+///
+/// スクリプトからコマンドをループで何万回も呼ぶと、1回ごとにコマンドの生成・引数の解析・undoキューへの登録が発生します。
+/// このクラスを継承したコマンドは、-batchフラグに続けて複数件分の引数を渡すと、1回の呼び出しでまとめて実行し、undoキューには1件だけ積みます。
+/// 継承先ではdoIt/undoIt/redoItではなく、1件分の処理のdoItem/undoItem/redoItemをオーバーライドします。
+///
+/// 各件の引数は空白区切り、件同士は「;」または改行区切りです。空白を含む引数は「"」で囲みます。
+/// -batchの後ろに複数の文字列を渡した場合は、それらを順に連結したものとして扱います。
+/// フラグなしで呼び出した場合は、引数全体を1件として実行します。
+///
+/// @code
+/// mySetValue "pCube1.tx" 1.0;								// 1件
+/// mySetValue -batch "pCube1.tx 1.0; pCube2.tx 2.0";		// 2件を1回のundoで
+/// @endcode
+/// @code
+/// cmds.mySetValue("-batch", "\n".join("%s %f" % (p, v) for p, v in values))
+/// @endcode
+///
+/// 途中の件でMStatusExceptionが投げられた場合、undo可能なコマンドであれば実行済みの件を逆順にundoItemで取り消してから失敗を返します。
+///
+class BatchCommandBase : public CommandBase {
+public:
+
+	/// @brief コンストラクタ
+	///
+	/// @param [in] command コマンド文字列
+	/// @param [in] is_undoable UNDOできるか
+	///
+	BatchCommandBase(const MString & command, const bool is_undoable) noexcept;
+
+	/// @brief デストラクタ
+	virtual ~BatchCommandBase(void);
+
+	/// @brief 引数を件ごとに分けてdoItemを呼び出します
+	virtual MStatus doIt(const MArgList & args) override final;
+
+	/// @brief 記録をもとに全件をredoItemでやり直します
+	virtual MStatus redoIt(void) override final;
+
+	/// @brief 記録をもとに全件を逆順にundoItemで取り消します
+	virtual MStatus undoIt(void) override final;
+
+	/// @brief 実行した件数
+	size_t itemCount(void) const noexcept { return this->record_.size(); }
+
+protected:
+
+	/// @brief 1件分を実行する
+	///
+	/// 取り消し・やり直しに必要な値（変更前後の値など）をrecordへ書き込んでください。
+	///
+	/// @param [in] args この件の引数
+	/// @param [in,out] record この件の記録の書き込み先
+	///
+	/// @throw MStatusException 実行に失敗した場合
+	///
+	virtual void doItem(const BatchArgs & args, BatchRecord & record) = 0;
+
+	/// @brief 1件分を取り消す
+	///
+	/// @param [in,out] record doItemで書き込んだ記録
+	///
+	/// @throw MStatusException 取り消しに失敗した場合
+	///
+	virtual void undoItem(BatchRecord::Reader & record);
+
+	/// @brief 1件分をやり直す
+	///
+	/// @param [in,out] record doItemで書き込んだ記録
+	///
+	/// @throw MStatusException やり直しに失敗した場合
+	///
+	virtual void redoItem(BatchRecord::Reader & record);
+
+private:
+
+	BatchRecord record_;
+
+	/// @brief 全件を順に、または逆順に適用する
+	MStatus replay(const bool undo);
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_BATCH_COMMAND_BASE_HPP_
@@ -0,0 +1,52 @@
+#include "CommandBase.hpp"
+#include "util/Logger.hpp"
+
+std::vector<MString> mpb::CommandBase::registered_;
+
+mpb::CommandBase::CommandBase(const MString & command, const bool is_undoable) noexcept
+	: command_(command), is_undoable_(is_undoable) {}
+
+mpb::CommandBase::~CommandBase(void){}
+
+MStatus mpb::CommandBase::doIt(const MArgList & args)
+{
+	MPB_LOG_INFO("Command : %s said to do It! but nothing to do...", this->command_.asChar());
+	return MStatus::kSuccess;
+}
+
+MStatus mpb::CommandBase::redoIt()
+{
+	if (!this->journal_.empty()) return this->replayJournal(false);
+	MPB_LOG_INFO("Command : %s said to redo It! but nothing to do...", this->command_.asChar());
+	return MStatus();
+}
+
+MStatus mpb::CommandBase::undoIt()
+{
+	if (!this->journal_.empty()) return this->replayJournal(true);
+	MPB_LOG_INFO("Command : %s said to undo It! but nothing to do...", this->command_.asChar());
+	return MStatus();
+}
+
+void mpb::CommandBase::applyJournal(const JournalChange & change)
+{
+	MStatusException::throwError(MStatus::kUnknownParameter, "applyJournal関数が定義されていません", "mpb::CommandBase::applyJournal<default>");
+}
+
+MStatus mpb::CommandBase::replayJournal(const bool undo)
+{
+	try {
+		if (!this->journal_.replay(undo, [this](const JournalChange & change) { this->applyJournal(change); })) {
+			MStatusException::throwError(MStatus::kFailure, "undoジャーナルの上限を超えたため、この操作の記録は破棄されています", "mpb::CommandBase::replayJournal");
+		}
+	}
+	catch (const MStatusException & e) {
+		MPB_LOG_ERROR("%s", e.toString("COMMAND : " + this->command_).asChar());
+		displayError(e.message);
+		return e.stat;
+	}
+	return MStatus::kSuccess;
+}
+
+bool mpb::CommandBase::isUndoable() const
+{ return this->is_undoable_; }
@@ -0,0 +1,231 @@
+﻿#pragma once
+#ifndef _MAYA_PLUGIN_BASE_COMMAND_BASE_HPP_
+#define _MAYA_PLUGIN_BASE_COMMAND_BASE_HPP_
+
+#include "exception/MStatusException.hpp"
+#include "util/UndoJournal.hpp"
+#include <maya/MString.h>
+#include <maya/MPxCommand.h>
+#include <vector>
+#include <memory>
+#include <type_traits>
+
+class MFnPlugin;
+
+namespace mpb {
+
+namespace registry_detail {
+
+/// @brief コマンド名の表kCommandNameを持つか
+template <class T, class = void> struct HasCommandName : std::false_type {};
+template <class T> struct HasCommandName<T, decltype(void(T::kCommandName))> : std::true_type {};
+
+}
+
+/// @brief コマンドのベースクラスです
+///
+/// 新しくコマンドを追加実装する場合は、このクラスを継承して実装してください
+///
+class CommandBase : public MPxCommand {
+public:
+
+	const MString command_;		///< コマンド文字列
+
+	const bool is_undoable_;	///< UNDOできるか
+
+	CommandBase(void) = delete;
+	
+	/// @brief コンストラクタ
+	///
+	/// @param [in] command コマンド文字列
+	/// @param [in] is_undoable UNDOできるか
+	///
+	CommandBase(const MString & command, const bool is_undoable) noexcept;
+
+	
+	/// @brief デストラクタ
+	///
+	/// 現在は何も処理をしていません
+	///
+	virtual ~CommandBase(void);
+
+
+	/// @brief 実行関数
+	///
+	/// コマンドで実行したい動作をオーバーライドして定義します。
+	///
+	/// 1コマンドに対し、一度しか呼び出されません。
+	/// そのため、Undoableなコマンドの場合は、この関数で準備を行い、redo()で実際に変更を加えるような実装が好ましいでしょう。
+	///
+	/// デフォルトでは何も処理をしません
+	///
+	/// @param [in] args コマンドライン引数
+	///
+	/// @return コマンドの実行結果
+	///
+	virtual MStatus doIt(const MArgList& args) override;
+
+	
+	/// @brief 再実行関数
+	///
+	/// コマンドで再実行したい動作をオーバーライドして定義します。
+	///
+	/// Ctrl-Yでredoされた場合に毎回呼び出されます。
+	///
+	/// デフォルトでは、journalArrayで記録した変更を古い順にapplyJournalで適用します。記録がない場合は何も処理をしません。
+	/// journalArrayを使わないUndoableなコマンドでは必ず実装します。
+	///
+	/// @return コマンドの再実行の結果
+	///
+	virtual MStatus redoIt() override;
+	
+
+	/// @brief 元に戻す関数
+	///
+	/// コマンドを取り消す際の動作をオーバーライドして定義します。
+	///
+	/// Ctrl-Zでundoされた場合に毎回呼び出されます。
+	///
+	/// デフォルトでは、journalArrayで記録した変更前の状態を新しい順にapplyJournalで適用します。記録がない場合は何も処理をしません。
+	/// journalArrayを使わないUndoableなコマンドでは必ず実装します。
+	///
+	/// @return コマンドを元に戻すの結果
+	///
+	virtual MStatus undoIt() override;
+	
+
+	/// @brief 元に戻す、が有効か調べる
+	///
+	/// デフォルトではis_undoable_の変数をそのまま返します。
+	///
+	/// また、オーバーライドして独自の定義をすることもできます。
+	///
+	/// @retval true 有効
+	/// @retval false 無効
+	///
+	virtual bool isUndoable() const override;
+
+
+	/// @brief コマンドの追加関数
+	///
+	/// ***main.cppにて、ユーザーが定義実装する必要があります。***
+	///
+	/// addCommand<T>()は、Tが静的メンバkCommandName（コマンド名の文字配列）を持てばインスタンスを生成せずに登録します。
+	///
+	/// @param [in,out] plugin MFnPluginのインスタンス
+	///
+	/// @retval MStatus::kSuccess 成功
+	/// @retval else 失敗
+	///
+	static MStatus addCommands(void);
+
+
+	/// @brief (INTERNAL FUNCTION)組み込みコマンドの追加
+	///
+	/// 内部関数。ユーザーによって呼び出さないでください。
+	/// ComputeProfilerCommand等、このプラグインベースが提供するコマンドを登録します。
+	///
+	/// @retval MStatus::kSuccess 成功
+	/// @retval else 失敗
+	///
+	static MStatus addBuiltinCommands(void);
+
+
+	/// @brief (INTERNAL FUNCTION)コマンドを削除
+	///
+	/// 内部関数。ユーザーによって呼び出さないでください。
+	///
+	/// @param [in,out] plugin MFnPluginのインスタンス
+	///
+	/// @retval MStatus::kSuccess 成功
+	/// @retval else 失敗
+	///
+	static MStatus removeCommands(MFnPlugin & plugin);
+
+
+	/// @brief (INTERNAL FUNCTION)MFnPluginのポインタを登録する
+	///
+	/// 内部関数。ユーザーによって呼び出さないでください。
+	///
+	/// @param [in,out] MFnPluginインスタンス
+	///
+	static void _setMFnPluginPtr(MFnPlugin * plugin);
+
+protected:
+
+	/// @brief 配列の変更をundoジャーナルへ記録します
+	///
+	/// 配列全体を複製して保持する代わりに、変更された要素だけを共有のUndoJournalへ記録します。
+	/// 記録したコマンドはundoIt/redoItを実装する必要はなく、記録した対象へ書き込むapplyJournalだけを実装します。
+	/// 1回のdoItで複数の対象や複数回の変更を記録できます。
+	///
+	/// @code
+	/// MPointArray before = points;
+	/// ...	// pointsを編集
+	/// this->journalArray("pCube1", &before[0], before.length(), &points[0], points.length());
+	/// @endcode
+	///
+	/// ジャーナルの上限（UndoJournal::setBudget）を超えると古い記録から破棄され、そのコマンドはundoできなくなります。
+	///
+	/// @param [in] target 対象名。applyJournalで対象を見分けるために使います
+	/// @param [in] before 変更前の配列
+	/// @param [in] before_count 変更前の要素数
+	/// @param [in] after 変更後の配列
+	/// @param [in] after_count 変更後の要素数
+	///
+	template <class T> void journalArray(const MString & target, const T * before, const size_t before_count, const T * after, const size_t after_count)
+	{ this->journal_.record(std::string(target.asChar()), before, before_count, after, after_count); }
+
+
+	/// @brief ジャーナルの変更を対象へ書き込みます
+	///
+	/// undoItでは変更前、redoItでは変更後の状態になるよう、change.target()の配列の要素数をchange.length()にし、
+	/// change.index(i)番目の要素をchange.value<T>(i)に書き換えてください。
+	///
+	/// デフォルトでは例外を送出します。journalArrayを使う場合は必ず実装します。
+	///
+	/// @param [in] change 1回分の変更
+	///
+	/// @throw MStatusException 書き込みに失敗した場合
+	///
+	virtual void applyJournal(const JournalChange & change);
+
+private:
+
+	UndoJournal::Entry journal_;	///< journalArrayの記録
+
+	/// @brief ジャーナルを適用する
+	MStatus replayJournal(const bool undo);
+
+	static MFnPlugin * plugin_;
+	static std::vector<MString> registered_;	///< 登録済みのコマンド名。removeCommandsで解除する
+
+	template <class _INHERIT_FROM_COMMANDBASE> static void addCommand(void);
+	template <class _INHERIT_FROM_COMMANDBASE, class ...Args> static void addCommand(Args... args);
+	template <class _INHERIT_FROM_COMMANDBASE> static void addCommandFromName(std::true_type);
+	template <class _INHERIT_FROM_COMMANDBASE> static void addCommandFromName(std::false_type);
+	static void _addCommand(void * (*creator)(), const MString & command);
+
+};
+template<class _INHERIT_FROM_COMMANDBASE>
+inline void CommandBase::addCommand(void) {
+	CommandBase::addCommandFromName<_INHERIT_FROM_COMMANDBASE>(registry_detail::HasCommandName<_INHERIT_FROM_COMMANDBASE>());
+}
+template<class _INHERIT_FROM_COMMANDBASE, class ...Args>
+inline void CommandBase::addCommand(Args ...args) {
+	const std::unique_ptr<CommandBase> command = std::make_unique<_INHERIT_FROM_COMMANDBASE>(args...);
+	CommandBase::_addCommand(&_INHERIT_FROM_COMMANDBASE::create, command->command_);
+}
+template<class _INHERIT_FROM_COMMANDBASE>
+inline void CommandBase::addCommandFromName(std::true_type) {
+	CommandBase::_addCommand(&_INHERIT_FROM_COMMANDBASE::create, MString(_INHERIT_FROM_COMMANDBASE::kCommandName));
+}
+template<class _INHERIT_FROM_COMMANDBASE>
+inline void CommandBase::addCommandFromName(std::false_type) {
+	// コマンド名の表がない場合は、インスタンスから読み取ってすぐに破棄する
+	const std::unique_ptr<CommandBase> command = std::make_unique<_INHERIT_FROM_COMMANDBASE>();
+	CommandBase::_addCommand(&_INHERIT_FROM_COMMANDBASE::create, command->command_);
+}
+// end of CommandBase
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_COMMAND_BASE_HPP_
\ No newline at end of file
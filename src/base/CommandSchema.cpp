@@ -0,0 +1,297 @@
+﻿#include "CommandSchema.hpp"
+#include <maya/MDoubleArray.h>
+#include <maya/MIntArray.h>
+#include <cctype>
+#include <string>
+
+namespace {
+
+unsigned int kindBit(const mpb::ArgKind kind) noexcept
+{ return 1u << static_cast<unsigned int>(kind); }
+
+/// @brief 「-」に英字が続く引数をフラグとみなす。負の数はフラグではない
+bool isFlagToken(const MString & token)
+{
+	const char * s = token.asChar();
+	return s[0] == '-' && std::isalpha(static_cast<unsigned char>(s[1])) != 0;
+}
+
+MString flagName(const mpb::FlagDesc & flag)
+{ return MString("-") + flag.longname; }
+
+/// @brief index番目がMELの形の配列（要素数に続けて要素）であれば要素数、そうでなければ-1
+int melArrayCount(const MArgList & args, const unsigned int index)
+{
+	MStatus stat;
+	const int count = args.asInt(index, &stat);
+	if (stat.error() || count < 0 || args.length() - index - 1 < static_cast<unsigned int>(count)) return -1;
+	return count;
+}
+
+}
+
+size_t mpb::CommandArgs::findFlag(const MString & token) const noexcept
+{
+	const char * name = token.asChar() + 1;
+	for (size_t i = 0; i < this->num_flags_; ++i) {
+		if (schema_detail::equalNames(name, this->flags_[i].shortname) || schema_detail::equalNames(name, this->flags_[i].longname)) return i;
+	}
+	return this->num_flags_;
+}
+
+void mpb::CommandArgs::parse(const MArgList & args)
+{
+	this->ints_.clear();
+	this->doubles_.clear();
+	this->strings_.clear();
+	this->positional_.clear();
+	this->uses_.clear();
+	// 解析中はフラグごとの指定回数として使い、sortUsesで開始位置に変換する
+	this->first_use_.assign(this->num_flags_ + 1, 0);
+
+	const unsigned int length = args.length();
+	for (unsigned int i = 0; i < length;) {
+		MStatus stat;
+		const MString token = args.asString(i, &stat);
+		MStatusException::throwIf(stat, [i] { return MString(("引数の取得に失敗 : " + std::to_string(i)).c_str()); }, "mpb::CommandArgs::parse");
+		++i;
+
+		if (!isFlagToken(token)) {
+			this->positional_.push_back(token);
+			continue;
+		}
+
+		const size_t index = this->findFlag(token);
+		if (index == this->num_flags_) MStatusException::throwError(MStatus::kInvalidParameter, "不明なフラグ : " + token, "mpb::CommandArgs::parse");
+		const FlagDesc & flag = this->flags_[index];
+		if (!flag.multi_use && this->first_use_[index] > 0) MStatusException::throwError(MStatus::kInvalidParameter, "複数回指定できないフラグです : " + flagName(flag), "mpb::CommandArgs::parse");
+		++this->first_use_[index];
+
+		if (length - i < flag.arity) MStatusException::throwError(MStatus::kInvalidParameter, flagName(flag) + "の値が足りません", "mpb::CommandArgs::parse");
+		const auto invalid = [&flag] { return flagName(flag) + "の値が不正"; };
+
+		Use use{ static_cast<uint32_t>(index), 0, flag.arity };
+		switch (flag.kind) {
+		case ArgKind::kSwitch:
+			break;
+		case ArgKind::kBool:
+			use.offset = static_cast<uint32_t>(this->ints_.size());
+			for (unsigned int k = 0; k < flag.arity; ++k, ++i) {
+				this->ints_.push_back(args.asBool(i, &stat) ? 1 : 0);
+				MStatusException::throwIf(stat, invalid, "mpb::CommandArgs::parse");
+			}
+			break;
+		case ArgKind::kInt:
+			use.offset = static_cast<uint32_t>(this->ints_.size());
+			for (unsigned int k = 0; k < flag.arity; ++k, ++i) {
+				this->ints_.push_back(args.asInt(i, &stat));
+				MStatusException::throwIf(stat, invalid, "mpb::CommandArgs::parse");
+			}
+			break;
+		case ArgKind::kDouble:
+			use.offset = static_cast<uint32_t>(this->doubles_.size());
+			for (unsigned int k = 0; k < flag.arity; ++k, ++i) {
+				this->doubles_.push_back(args.asDouble(i, &stat));
+				MStatusException::throwIf(stat, invalid, "mpb::CommandArgs::parse");
+			}
+			break;
+		case ArgKind::kString:
+			use.offset = static_cast<uint32_t>(this->strings_.size());
+			this->strings_.push_back(args.asString(i++, &stat));
+			MStatusException::throwIf(stat, invalid, "mpb::CommandArgs::parse");
+			break;
+		case ArgKind::kIntArray: {
+			use.offset = static_cast<uint32_t>(this->ints_.size());
+			const int count = melArrayCount(args, i);
+			if (count >= 0) {
+				// MELの形は要素が個別の引数なので、一時配列を介さずにバッファへ直接読み込む
+				use.count = static_cast<uint32_t>(count);
+				this->ints_.resize(this->ints_.size() + use.count);
+				int * dest = this->ints_.data() + use.offset;
+				++i;
+				for (int k = 0; k < count; ++k, ++i) {
+					dest[k] = args.asInt(i, &stat);
+					MStatusException::throwIf(stat, invalid, "mpb::CommandArgs::parse");
+				}
+				break;
+			}
+			// APIから渡された配列は、配列として一度に取り出してバッファへ書き込む
+			const MIntArray values = args.asIntArray(i, &stat);
+			MStatusException::throwIf(stat, invalid, "mpb::CommandArgs::parse");
+			use.count = values.length();
+			this->ints_.resize(this->ints_.size() + use.count);
+			if (use.count > 0) values.get(this->ints_.data() + use.offset);
+			break;
+		}
+		case ArgKind::kDoubleArray: {
+			use.offset = static_cast<uint32_t>(this->doubles_.size());
+			const int count = melArrayCount(args, i);
+			if (count >= 0) {
+				use.count = static_cast<uint32_t>(count);
+				this->doubles_.resize(this->doubles_.size() + use.count);
+				double * dest = this->doubles_.data() + use.offset;
+				++i;
+				for (int k = 0; k < count; ++k, ++i) {
+					dest[k] = args.asDouble(i, &stat);
+					MStatusException::throwIf(stat, invalid, "mpb::CommandArgs::parse");
+				}
+				break;
+			}
+			const MDoubleArray values = args.asDoubleArray(i, &stat);
+			MStatusException::throwIf(stat, invalid, "mpb::CommandArgs::parse");
+			use.count = values.length();
+			this->doubles_.resize(this->doubles_.size() + use.count);
+			if (use.count > 0) values.get(this->doubles_.data() + use.offset);
+			break;
+		}
+		}
+		this->uses_.push_back(use);
+	}
+
+	const unsigned int positional = static_cast<unsigned int>(this->positional_.size());
+	if (positional < this->min_positional_ || positional > this->max_positional_) {
+		MStatusException::throwError(MStatus::kInvalidParameter, MString(("フラグ以外の引数の数が不正です : " + std::to_string(positional)).c_str()), "mpb::CommandArgs::parse");
+	}
+
+	this->sortUses();
+}
+
+void mpb::CommandArgs::sortUses(void)
+{
+	// 指定回数から開始位置へ
+	uint32_t total = 0;
+	for (size_t f = 0; f <= this->num_flags_; ++f) {
+		const uint32_t count = this->first_use_[f];
+		this->first_use_[f] = total;
+		total += count;
+	}
+
+	bool sorted = true;
+	for (size_t u = 1; u < this->uses_.size() && sorted; ++u) sorted = (this->uses_[u - 1].flag <= this->uses_[u].flag);
+	if (sorted) return;
+
+	// フラグが入り混じって指定された場合のみ、フラグ順に並べ直して値を詰め直す
+	std::vector<Use> uses(this->uses_.size());
+	std::vector<uint32_t> next(this->first_use_.begin(), this->first_use_.end() - 1);
+	for (const Use & use : this->uses_) uses[next[use.flag]++] = use;
+
+	std::vector<int> ints;
+	std::vector<double> doubles;
+	std::vector<MString> strings;
+	ints.reserve(this->ints_.size());
+	doubles.reserve(this->doubles_.size());
+	strings.reserve(this->strings_.size());
+	for (Use & use : uses) {
+		const ArgKind kind = this->flags_[use.flag].kind;
+		if (kind == ArgKind::kBool || kind == ArgKind::kInt || kind == ArgKind::kIntArray) {
+			const uint32_t offset = static_cast<uint32_t>(ints.size());
+			ints.insert(ints.end(), this->ints_.begin() + use.offset, this->ints_.begin() + use.offset + use.count);
+			use.offset = offset;
+		}
+		else if (kind == ArgKind::kDouble || kind == ArgKind::kDoubleArray) {
+			const uint32_t offset = static_cast<uint32_t>(doubles.size());
+			doubles.insert(doubles.end(), this->doubles_.begin() + use.offset, this->doubles_.begin() + use.offset + use.count);
+			use.offset = offset;
+		}
+		else if (kind == ArgKind::kString) {
+			const uint32_t offset = static_cast<uint32_t>(strings.size());
+			strings.push_back(this->strings_[use.offset]);
+			use.offset = offset;
+		}
+	}
+	this->uses_.swap(uses);
+	this->ints_.swap(ints);
+	this->doubles_.swap(doubles);
+	this->strings_.swap(strings);
+}
+
+const mpb::FlagDesc & mpb::CommandArgs::checkKind(const size_t i, const unsigned int kinds, const char * where) const
+{
+	if (i >= this->num_flags_) MStatusException::throwError(MStatus::kInvalidParameter, "フラグ番号が範囲外です", where);
+	const FlagDesc & flag = this->flags_[i];
+	if ((kindBit(flag.kind) & kinds) == 0) MStatusException::throwError(MStatus::kInvalidParameter, "フラグの種類が異なります : " + flagName(flag), where);
+	return flag;
+}
+
+const mpb::CommandArgs::Use & mpb::CommandArgs::findUse(const size_t i, const unsigned int use, const char * where) const
+{
+	if (use >= this->uses(i)) MStatusException::throwError(MStatus::kInvalidParameter, "指定回数が範囲外です : " + flagName(this->flags_[i]), where);
+	return this->uses_[this->first_use_[i] + use];
+}
+
+bool mpb::CommandArgs::asBool(const size_t i, const unsigned int use) const
+{
+	const FlagDesc & flag = this->checkKind(i, kindBit(ArgKind::kBool) | kindBit(ArgKind::kSwitch), "mpb::CommandArgs::asBool");
+	if (flag.kind == ArgKind::kSwitch) return this->isSet(i);
+	if (!this->isSet(i)) return flag.def_value != 0.0;
+	return this->ints_[this->findUse(i, use, "mpb::CommandArgs::asBool").offset] != 0;
+}
+
+int mpb::CommandArgs::asInt(const size_t i, const unsigned int use, const unsigned int k) const
+{
+	const FlagDesc & flag = this->checkKind(i, kindBit(ArgKind::kInt), "mpb::CommandArgs::asInt");
+	if (k >= flag.arity) MStatusException::throwError(MStatus::kInvalidParameter, "値の番号が範囲外です : " + flagName(flag), "mpb::CommandArgs::asInt");
+	if (!this->isSet(i)) return static_cast<int>(flag.def_value);
+	return this->ints_[this->findUse(i, use, "mpb::CommandArgs::asInt").offset + k];
+}
+
+double mpb::CommandArgs::asDouble(const size_t i, const unsigned int use, const unsigned int k) const
+{
+	const FlagDesc & flag = this->checkKind(i, kindBit(ArgKind::kDouble), "mpb::CommandArgs::asDouble");
+	if (k >= flag.arity) MStatusException::throwError(MStatus::kInvalidParameter, "値の番号が範囲外です : " + flagName(flag), "mpb::CommandArgs::asDouble");
+	if (!this->isSet(i)) return flag.def_value;
+	return this->doubles_[this->findUse(i, use, "mpb::CommandArgs::asDouble").offset + k];
+}
+
+MString mpb::CommandArgs::asString(const size_t i, const unsigned int use) const
+{
+	const FlagDesc & flag = this->checkKind(i, kindBit(ArgKind::kString), "mpb::CommandArgs::asString");
+	if (!this->isSet(i)) return MString(flag.def_string);
+	return this->strings_[this->findUse(i, use, "mpb::CommandArgs::asString").offset];
+}
+
+mpb::ConstSpan<int> mpb::CommandArgs::ints(const size_t i) const
+{
+	this->checkKind(i, kindBit(ArgKind::kBool) | kindBit(ArgKind::kInt) | kindBit(ArgKind::kIntArray), "mpb::CommandArgs::ints");
+	if (!this->isSet(i)) return ConstSpan<int>();
+	const Use & first = this->uses_[this->first_use_[i]];
+	const Use & last = this->uses_[this->first_use_[i + 1] - 1];
+	return ConstSpan<int>(this->ints_.data() + first.offset, last.offset + last.count - first.offset);
+}
+
+mpb::ConstSpan<int> mpb::CommandArgs::ints(const size_t i, const unsigned int use) const
+{
+	this->checkKind(i, kindBit(ArgKind::kBool) | kindBit(ArgKind::kInt) | kindBit(ArgKind::kIntArray), "mpb::CommandArgs::ints");
+	const Use & u = this->findUse(i, use, "mpb::CommandArgs::ints");
+	return ConstSpan<int>(this->ints_.data() + u.offset, u.count);
+}
+
+mpb::ConstSpan<double> mpb::CommandArgs::doubles(const size_t i) const
+{
+	this->checkKind(i, kindBit(ArgKind::kDouble) | kindBit(ArgKind::kDoubleArray), "mpb::CommandArgs::doubles");
+	if (!this->isSet(i)) return ConstSpan<double>();
+	const Use & first = this->uses_[this->first_use_[i]];
+	const Use & last = this->uses_[this->first_use_[i + 1] - 1];
+	return ConstSpan<double>(this->doubles_.data() + first.offset, last.offset + last.count - first.offset);
+}
+
+mpb::ConstSpan<double> mpb::CommandArgs::doubles(const size_t i, const unsigned int use) const
+{
+	this->checkKind(i, kindBit(ArgKind::kDouble) | kindBit(ArgKind::kDoubleArray), "mpb::CommandArgs::doubles");
+	const Use & u = this->findUse(i, use, "mpb::CommandArgs::doubles");
+	return ConstSpan<double>(this->doubles_.data() + u.offset, u.count);
+}
+
+mpb::ConstSpan<MString> mpb::CommandArgs::strings(const size_t i) const
+{
+	this->checkKind(i, kindBit(ArgKind::kString), "mpb::CommandArgs::strings");
+	if (!this->isSet(i)) return ConstSpan<MString>();
+	const Use & first = this->uses_[this->first_use_[i]];
+	return ConstSpan<MString>(this->strings_.data() + first.offset, this->uses(i));
+}
+
+const MString & mpb::CommandArgs::positional(const unsigned int k) const
+{
+	if (k >= this->positional_.size()) MStatusException::throwError(MStatus::kInvalidParameter, "引数の番号が範囲外です", "mpb::CommandArgs::positional");
+	return this->positional_[k];
+}
@@ -0,0 +1,331 @@
+﻿/// @file CommandSchema.hpp
+/// @brief コマンド引数スキーマ定義ヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_COMMAND_SCHEMA_HPP_
+#define _MAYA_PLUGIN_BASE_COMMAND_SCHEMA_HPP_
+
+#include "base/AttributeSchema.hpp"
+#include "base/DataAccess.hpp"
+#include "exception/MStatusException.hpp"
+#include <maya/MArgList.h>
+#include <maya/MString.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mpb {
+
+/// @brief フラグの値の種類
+enum class ArgKind {
+	kSwitch,		///< 値なし。指定されたかどうかだけを表す
+	kBool,			///< 真偽値
+	kInt,			///< 整数
+	kDouble,		///< 実数
+	kString,		///< 文字列
+	kIntArray,		///< 整数配列
+	kDoubleArray,	///< 実数配列
+};
+
+
+/// @brief フラグ1つ分の記述子
+///
+/// 直接初期化せず、doubleFlag等のconstexpr関数で生成してください。
+///
+struct FlagDesc {
+	ArgKind kind;
+	const char * longname;		///< 「-」を除いた長い名前
+	const char * shortname;		///< 「-」を除いた短い名前
+	unsigned int arity;			///< 1回の指定で続く値の数。配列は1（配列1つ）
+	bool multi_use;				///< 複数回指定できるか
+	double def_value;			///< 指定されなかったときの値（kBool, kInt, kDouble）
+	const char * def_string;	///< 指定されなかったときの値（kString）
+};
+
+
+/// @brief コマンド引数スキーマ
+///
+/// コマンドのフラグと、フラグ以外の引数（オブジェクト名等）の数をコンパイル時に列挙する型です。
+/// コマンドクラスにstatic constexprメンバkSchemaとして定義し、SchemaCommandを継承すると引数の解析が自動化されます。
+///
+/// @tparam N フラグ数
+///
+template <size_t N>
+struct CommandSchema {
+	static constexpr size_t kNumFlags = N;
+
+	std::array<FlagDesc, N> flags;
+	unsigned int min_positional;	///< フラグ以外の引数の最小数
+	unsigned int max_positional;	///< フラグ以外の引数の最大数
+
+	/// @brief 短い名前の重複があるか
+	constexpr bool hasDuplicateShortName(void) const {
+		for (size_t i = 0; i < N; ++i) {
+			for (size_t j = i + 1; j < N; ++j) {
+				if (schema_detail::equalNames(flags[i].shortname, flags[j].shortname)) return true;
+			}
+		}
+		return false;
+	}
+
+	/// @brief 長い名前の重複があるか
+	constexpr bool hasDuplicateLongName(void) const {
+		for (size_t i = 0; i < N; ++i) {
+			for (size_t j = i + 1; j < N; ++j) {
+				if (schema_detail::equalNames(flags[i].longname, flags[j].longname)) return true;
+			}
+		}
+		return false;
+	}
+
+	/// @brief 値の数が不正なフラグがあるか
+	constexpr bool hasInvalidArity(void) const {
+		for (size_t i = 0; i < N; ++i) {
+			const FlagDesc & f = flags[i];
+			if (f.kind == ArgKind::kSwitch ? f.arity != 0 : (f.arity == 0 || f.arity > 6)) return true;
+			if ((f.kind == ArgKind::kIntArray || f.kind == ArgKind::kDoubleArray) && f.arity != 1) return true;
+		}
+		return min_positional > max_positional;
+	}
+};
+
+
+/// @brief 値なしのフラグの記述子を生成する
+constexpr FlagDesc switchFlag(const char * longname, const char * shortname) {
+	return FlagDesc{ ArgKind::kSwitch, longname, shortname, 0, false, 0.0, "" };
+}
+
+/// @brief 真偽値のフラグの記述子を生成する
+constexpr FlagDesc boolFlag(const char * longname, const char * shortname, const bool def_value = false, const bool multi_use = false) {
+	return FlagDesc{ ArgKind::kBool, longname, shortname, 1, multi_use, def_value ? 1.0 : 0.0, "" };
+}
+
+/// @brief 整数のフラグの記述子を生成する
+///
+/// @param [in] arity 1回の指定で続く値の数(1-6)
+///
+constexpr FlagDesc intFlag(const char * longname, const char * shortname, const int def_value = 0, const unsigned int arity = 1, const bool multi_use = false) {
+	return FlagDesc{ ArgKind::kInt, longname, shortname, arity, multi_use, static_cast<double>(def_value), "" };
+}
+
+/// @brief 実数のフラグの記述子を生成する
+///
+/// 例えばarity = 3, multi_use = trueとすると、「-p 0 1 2 -p 3 4 5」のような点の列を受け取れます。
+///
+/// @param [in] arity 1回の指定で続く値の数(1-6)
+///
+constexpr FlagDesc doubleFlag(const char * longname, const char * shortname, const double def_value = 0.0, const unsigned int arity = 1, const bool multi_use = false) {
+	return FlagDesc{ ArgKind::kDouble, longname, shortname, arity, multi_use, def_value, "" };
+}
+
+/// @brief 文字列のフラグの記述子を生成する
+constexpr FlagDesc stringFlag(const char * longname, const char * shortname, const char * def_value = "", const bool multi_use = false) {
+	return FlagDesc{ ArgKind::kString, longname, shortname, 1, multi_use, 0.0, def_value };
+}
+
+/// @brief 整数配列のフラグの記述子を生成する
+///
+/// 値はMArgList::asIntArrayで読み取れる形（配列、またはMELの要素数＋要素）で渡します。
+///
+constexpr FlagDesc intArrayFlag(const char * longname, const char * shortname, const bool multi_use = false) {
+	return FlagDesc{ ArgKind::kIntArray, longname, shortname, 1, multi_use, 0.0, "" };
+}
+
+/// @brief 実数配列のフラグの記述子を生成する
+///
+/// 値はMArgList::asDoubleArrayで読み取れる形（配列、またはMELの要素数＋要素）で渡します。
+///
+constexpr FlagDesc doubleArrayFlag(const char * longname, const char * shortname, const bool multi_use = false) {
+	return FlagDesc{ ArgKind::kDoubleArray, longname, shortname, 1, multi_use, 0.0, "" };
+}
+
+
+/// @brief スキーマに従って解析したコマンド引数
+///
+/// 値は種類ごとに1本の連続したバッファに、フラグ順に詰めて保持します。
+/// 同じフラグの値は複数回指定された分も含めて連続しているため、doubles(i)等で一括して参照できます。
+/// 1回の解析で確保するのは種類ごとのバッファと、指定の記録のみです。
+///
+class CommandArgs {
+public:
+
+	/// @brief コンストラクタ
+	///
+	/// @param [in] flags フラグの記述子の配列。静的記憶域のものを指定してください
+	/// @param [in] num_flags フラグ数
+	/// @param [in] min_positional フラグ以外の引数の最小数
+	/// @param [in] max_positional フラグ以外の引数の最大数
+	///
+	CommandArgs(const FlagDesc * flags, const size_t num_flags, const unsigned int min_positional, const unsigned int max_positional) noexcept
+		: flags_(flags), num_flags_(num_flags), min_positional_(min_positional), max_positional_(max_positional) {}
+
+	/// @brief スキーマから生成する
+	template <size_t N> explicit CommandArgs(const CommandSchema<N> & schema) noexcept
+		: CommandArgs(schema.flags.data(), N, schema.min_positional, schema.max_positional) {}
+
+
+	/// @brief 引数を解析する
+	///
+	/// 以前の解析結果は破棄します。
+	///
+	/// @param [in] args コマンドライン引数
+	///
+	/// @throw MStatusException 不明なフラグ、値の不足・型の不一致、複数回指定できないフラグの重複、フラグ以外の引数の数が範囲外の場合
+	///
+	void parse(const MArgList & args);
+
+
+	/// @brief フラグ数
+	size_t numFlags(void) const noexcept { return this->num_flags_; }
+
+	/// @brief i番目のフラグの記述子
+	const FlagDesc & flag(const size_t i) const noexcept { return this->flags_[i]; }
+
+	/// @brief i番目のフラグが指定されたか
+	bool isSet(const size_t i) const noexcept { return this->uses(i) > 0; }
+
+	/// @brief i番目のフラグが指定された回数
+	unsigned int uses(const size_t i) const noexcept
+	{ return this->first_use_.empty() ? 0 : this->first_use_[i + 1] - this->first_use_[i]; }
+
+
+	/// @brief 真偽値を取得する。指定されていなければ既定値。kSwitchの場合は指定されたか
+	/// @param [in] i フラグ番号
+	/// @param [in] use 何回目の指定か
+	/// @throw MStatusException 種類が異なる、または範囲外の場合
+	bool asBool(const size_t i, const unsigned int use = 0) const;
+
+	/// @brief 整数を取得する。指定されていなければ既定値
+	/// @param [in] i フラグ番号
+	/// @param [in] use 何回目の指定か
+	/// @param [in] k 何番目の値か(arity > 1の場合)
+	/// @throw MStatusException 種類が異なる、または範囲外の場合
+	int asInt(const size_t i, const unsigned int use = 0, const unsigned int k = 0) const;
+
+	/// @brief 実数を取得する。指定されていなければ既定値
+	/// @param [in] i フラグ番号
+	/// @param [in] use 何回目の指定か
+	/// @param [in] k 何番目の値か(arity > 1の場合)
+	/// @throw MStatusException 種類が異なる、または範囲外の場合
+	double asDouble(const size_t i, const unsigned int use = 0, const unsigned int k = 0) const;
+
+	/// @brief 文字列を取得する。指定されていなければ既定値
+	/// @param [in] i フラグ番号
+	/// @param [in] use 何回目の指定か
+	/// @throw MStatusException 種類が異なる、または範囲外の場合
+	MString asString(const size_t i, const unsigned int use = 0) const;
+
+
+	/// @brief i番目のフラグの全値（kBool, kInt, kIntArray）
+	///
+	/// 複数回指定された場合は、指定順に連結した連続領域を返します。
+	/// 領域はこのインスタンスが所有し、次のparseまで有効です。
+	///
+	/// @throw MStatusException 種類が異なる場合
+	///
+	ConstSpan<int> ints(const size_t i) const;
+
+	/// @brief i番目のフラグのuse回目の指定の値（kBool, kInt, kIntArray）
+	/// @throw MStatusException 種類が異なる、または範囲外の場合
+	ConstSpan<int> ints(const size_t i, const unsigned int use) const;
+
+	/// @brief i番目のフラグの全値（kDouble, kDoubleArray）
+	///
+	/// 複数回指定された場合は、指定順に連結した連続領域を返します。
+	/// 例えばarity = 3のフラグであれば、xyzの並んだ点の配列になります。
+	///
+	/// @throw MStatusException 種類が異なる場合
+	///
+	ConstSpan<double> doubles(const size_t i) const;
+
+	/// @brief i番目のフラグのuse回目の指定の値（kDouble, kDoubleArray）
+	/// @throw MStatusException 種類が異なる、または範囲外の場合
+	ConstSpan<double> doubles(const size_t i, const unsigned int use) const;
+
+	/// @brief i番目のフラグの全値（kString）
+	/// @throw MStatusException 種類が異なる場合
+	ConstSpan<MString> strings(const size_t i) const;
+
+
+	/// @brief フラグ以外の引数の数
+	unsigned int positionalCount(void) const noexcept { return static_cast<unsigned int>(this->positional_.size()); }
+
+	/// @brief k番目のフラグ以外の引数
+	/// @throw MStatusException 範囲外の場合
+	const MString & positional(const unsigned int k) const;
+
+private:
+
+	/// @brief 1回分の指定
+	struct Use {
+		uint32_t flag;
+		uint32_t offset;	///< 種類ごとのバッファ内の位置
+		uint32_t count;		///< 値の数
+	};
+
+	const FlagDesc * flags_;
+	size_t num_flags_;
+	unsigned int min_positional_;
+	unsigned int max_positional_;
+
+	std::vector<int> ints_;
+	std::vector<double> doubles_;
+	std::vector<MString> strings_;
+	std::vector<MString> positional_;
+	std::vector<Use> uses_;				///< フラグ順・指定順に整列済み
+	std::vector<uint32_t> first_use_;	///< フラグごとのuses_の開始位置(num_flags_ + 1個)
+
+	size_t findFlag(const MString & token) const noexcept;
+	void sortUses(void);
+	const FlagDesc & checkKind(const size_t i, const unsigned int kinds, const char * where) const;
+	const Use & findUse(const size_t i, const unsigned int use, const char * where) const;
+};
+
+
+/// @brief フラグの値の型
+///
+/// 記述子の種類と値の数から、SchemaCommand::flagValueで返す型を決定します。
+/// 値が複数のフラグ（arity > 1）と配列のフラグはConstSpanで返し、未指定の場合は空になります。
+///
+template <ArgKind K, bool Scalar> struct FlagValue;
+
+template <> struct FlagValue<ArgKind::kSwitch, false> {
+	typedef bool type;
+	static type get(const CommandArgs & args, const size_t i, const unsigned int) { return args.asBool(i); }
+};
+template <> struct FlagValue<ArgKind::kBool, true> {
+	typedef bool type;
+	static type get(const CommandArgs & args, const size_t i, const unsigned int use) { return args.asBool(i, use); }
+};
+template <> struct FlagValue<ArgKind::kInt, true> {
+	typedef int type;
+	static type get(const CommandArgs & args, const size_t i, const unsigned int use) { return args.asInt(i, use); }
+};
+template <> struct FlagValue<ArgKind::kInt, false> {
+	typedef ConstSpan<int> type;
+	static type get(const CommandArgs & args, const size_t i, const unsigned int use) { return args.isSet(i) ? args.ints(i, use) : type(); }
+};
+template <> struct FlagValue<ArgKind::kDouble, true> {
+	typedef double type;
+	static type get(const CommandArgs & args, const size_t i, const unsigned int use) { return args.asDouble(i, use); }
+};
+template <> struct FlagValue<ArgKind::kDouble, false> {
+	typedef ConstSpan<double> type;
+	static type get(const CommandArgs & args, const size_t i, const unsigned int use) { return args.isSet(i) ? args.doubles(i, use) : type(); }
+};
+template <> struct FlagValue<ArgKind::kString, true> {
+	typedef MString type;
+	static type get(const CommandArgs & args, const size_t i, const unsigned int use) { return args.asString(i, use); }
+};
+template <> struct FlagValue<ArgKind::kIntArray, true> {
+	typedef ConstSpan<int> type;
+	static type get(const CommandArgs & args, const size_t i, const unsigned int) { return args.ints(i); }
+};
+template <> struct FlagValue<ArgKind::kDoubleArray, true> {
+	typedef ConstSpan<double> type;
+	static type get(const CommandArgs & args, const size_t i, const unsigned int) { return args.doubles(i); }
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_COMMAND_SCHEMA_HPP_
@@ -0,0 +1,138 @@
+﻿#include "DataAccess.hpp"
+#include <maya/MDoubleArray.h>
+#include <maya/MFnDoubleArrayData.h>
+#include <maya/MFnPointArrayData.h>
+#include <maya/MFnVectorArrayData.h>
+
+mpb::ConstSpan<double> mpb::readDoubleArrayData(MDataHandle & handle, std::vector<double> & buffer)
+{
+	MStatus stat;
+	MFnDoubleArrayData fn(handle.data(), &stat);
+	MStatusException::throwIf(stat, "doubleArrayデータの取得に失敗", "mpb::readDoubleArrayData");
+	const MDoubleArray array = fn.array(&stat);
+	MStatusException::throwIf(stat, "doubleArrayデータの取得に失敗", "mpb::readDoubleArrayData");
+	buffer.resize(array.length());
+	if (!buffer.empty()) {
+		MStatusException::throwIf(array.get(buffer.data()), "doubleArrayデータのコピーに失敗", "mpb::readDoubleArrayData");
+	}
+	return ConstSpan<double>(buffer);
+}
+
+mpb::ConstSpan<MPoint> mpb::readPointArrayData(MDataHandle & handle, std::vector<MPoint> & buffer)
+{
+	static_assert(sizeof(MPoint) == 4 * sizeof(double), "MPoint must be laid out as double[4]");
+	MStatus stat;
+	MFnPointArrayData fn(handle.data(), &stat);
+	MStatusException::throwIf(stat, "pointArrayデータの取得に失敗", "mpb::readPointArrayData");
+	const MPointArray array = fn.array(&stat);
+	MStatusException::throwIf(stat, "pointArrayデータの取得に失敗", "mpb::readPointArrayData");
+	buffer.resize(array.length());
+	if (!buffer.empty()) {
+		MStatusException::throwIf(array.get(reinterpret_cast<double(*)[4]>(buffer.data())), "pointArrayデータのコピーに失敗", "mpb::readPointArrayData");
+	}
+	return ConstSpan<MPoint>(buffer);
+}
+
+mpb::ConstSpan<MVector> mpb::readVectorArrayData(MDataHandle & handle, std::vector<MVector> & buffer)
+{
+	static_assert(sizeof(MVector) == 3 * sizeof(double), "MVector must be laid out as double[3]");
+	MStatus stat;
+	MFnVectorArrayData fn(handle.data(), &stat);
+	MStatusException::throwIf(stat, "vectorArrayデータの取得に失敗", "mpb::readVectorArrayData");
+	const MVectorArray array = fn.array(&stat);
+	MStatusException::throwIf(stat, "vectorArrayデータの取得に失敗", "mpb::readVectorArrayData");
+	buffer.resize(array.length());
+	if (!buffer.empty()) {
+		MStatusException::throwIf(array.get(reinterpret_cast<double(*)[3]>(buffer.data())), "vectorArrayデータのコピーに失敗", "mpb::readVectorArrayData");
+	}
+	return ConstSpan<MVector>(buffer);
+}
+
+void mpb::writeDoubleArrayData(MDataHandle & handle, const ConstSpan<double> & values)
+{
+	MStatus stat;
+	const MDoubleArray array(values.data(), static_cast<unsigned int>(values.size()));
+	MFnDoubleArrayData fn;
+	const MObject obj = fn.create(array, &stat);
+	MStatusException::throwIf(stat, "doubleArrayデータの生成に失敗", "mpb::writeDoubleArrayData");
+	MStatusException::throwIf(handle.set(obj), "doubleArrayデータの設定に失敗", "mpb::writeDoubleArrayData");
+	handle.setClean();
+}
+
+namespace {
+
+// ArrayT / FnT : Maya側の配列型と関数セット、BufferT : SoAバッファ
+template <class ArrayT, class FnT, class BufferT>
+void readArrayData(MDataHandle & handle, BufferT & buffer, const mpb::DirtyRange & range, const char * type_name, const char * function_name)
+{
+	MStatus stat;
+	FnT fn(handle.data(), &stat);
+	mpb::MStatusException::throwIf(stat, [type_name] { return MString(type_name) + "データの取得に失敗"; }, function_name);
+	const ArrayT array = fn.array(&stat);
+	mpb::MStatusException::throwIf(stat, [type_name] { return MString(type_name) + "データの取得に失敗"; }, function_name);
+	mpb::gather(array, buffer, range);
+}
+
+template <class ArrayT, class FnT, class BufferT>
+void writeArrayData(MDataHandle & handle, const BufferT & values, const mpb::DirtyRange & range, const char * type_name, const char * function_name)
+{
+	MStatus stat;
+	FnT fn(handle.data(), &stat);
+	if (!stat.error() && fn.length() == values.size()) {
+		// 同じ要素数のデータがあれば、新たなデータを生成せずに書き換える。全体を書く場合は元の値を読まない
+		ArrayT array;
+		if (range.covers(values.size())) {
+			mpb::scatter(values, array);
+		}
+		else {
+			array = fn.array(&stat);
+			mpb::MStatusException::throwIf(stat, [type_name] { return MString(type_name) + "データの取得に失敗"; }, function_name);
+			mpb::scatter(values, array, range);
+		}
+		mpb::MStatusException::throwIf(fn.set(array), [type_name] { return MString(type_name) + "データの設定に失敗"; }, function_name);
+	}
+	else {
+		ArrayT array;
+		mpb::scatter(values, array);
+		FnT creator;
+		const MObject obj = creator.create(array, &stat);
+		mpb::MStatusException::throwIf(stat, [type_name] { return MString(type_name) + "データの生成に失敗"; }, function_name);
+		mpb::MStatusException::throwIf(handle.set(obj), [type_name] { return MString(type_name) + "データの設定に失敗"; }, function_name);
+	}
+	handle.setClean();
+}
+
+}
+
+template <class T>
+void mpb::readDoubleArrayData(MDataHandle & handle, AlignedBuffer<T> & buffer, const DirtyRange & range)
+{ readArrayData<MDoubleArray, MFnDoubleArrayData>(handle, buffer, range, "doubleArray", "mpb::readDoubleArrayData"); }
+template <class T>
+void mpb::writeDoubleArrayData(MDataHandle & handle, const AlignedBuffer<T> & values, const DirtyRange & range)
+{ writeArrayData<MDoubleArray, MFnDoubleArrayData>(handle, values, range, "doubleArray", "mpb::writeDoubleArrayData"); }
+template <class T>
+void mpb::readPointArrayData(MDataHandle & handle, SoaBuffer3<T> & buffer, const DirtyRange & range)
+{ readArrayData<MPointArray, MFnPointArrayData>(handle, buffer, range, "pointArray", "mpb::readPointArrayData"); }
+template <class T>
+void mpb::writePointArrayData(MDataHandle & handle, const SoaBuffer3<T> & values, const DirtyRange & range)
+{ writeArrayData<MPointArray, MFnPointArrayData>(handle, values, range, "pointArray", "mpb::writePointArrayData"); }
+template <class T>
+void mpb::readVectorArrayData(MDataHandle & handle, SoaBuffer3<T> & buffer, const DirtyRange & range)
+{ readArrayData<MVectorArray, MFnVectorArrayData>(handle, buffer, range, "vectorArray", "mpb::readVectorArrayData"); }
+template <class T>
+void mpb::writeVectorArrayData(MDataHandle & handle, const SoaBuffer3<T> & values, const DirtyRange & range)
+{ writeArrayData<MVectorArray, MFnVectorArrayData>(handle, values, range, "vectorArray", "mpb::writeVectorArrayData"); }
+
+// 明示的実体化
+#define MPB_ARRAY_DATA_INSTANTIATE(T) \
+	template void mpb::readDoubleArrayData<T>(MDataHandle &, AlignedBuffer<T> &, const DirtyRange &); \
+	template void mpb::writeDoubleArrayData<T>(MDataHandle &, const AlignedBuffer<T> &, const DirtyRange &); \
+	template void mpb::readPointArrayData<T>(MDataHandle &, SoaBuffer3<T> &, const DirtyRange &); \
+	template void mpb::writePointArrayData<T>(MDataHandle &, const SoaBuffer3<T> &, const DirtyRange &); \
+	template void mpb::readVectorArrayData<T>(MDataHandle &, SoaBuffer3<T> &, const DirtyRange &); \
+	template void mpb::writeVectorArrayData<T>(MDataHandle &, const SoaBuffer3<T> &, const DirtyRange &);
+
+MPB_ARRAY_DATA_INSTANTIATE(float)
+MPB_ARRAY_DATA_INSTANTIATE(double)
+
+#undef MPB_ARRAY_DATA_INSTANTIATE
@@ -0,0 +1,366 @@
+﻿/// @file DataAccess.hpp
+/// @brief 型付きデータハンドルアクセサヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_DATA_ACCESS_HPP_
+#define _MAYA_PLUGIN_BASE_DATA_ACCESS_HPP_
+
+#include "exception/MStatusException.hpp"
+#include "math/SoaBuffer.hpp"
+#include <maya/MDataBlock.h>
+#include <maya/MDataHandle.h>
+#include <maya/MArrayDataHandle.h>
+#include <maya/MArrayDataBuilder.h>
+#include <maya/MObject.h>
+#include <maya/MVector.h>
+#include <maya/MPoint.h>
+#include <maya/MMatrix.h>
+#include <maya/MAngle.h>
+#include <maya/MDistance.h>
+#include <maya/MTime.h>
+#include <array>
+#include <vector>
+#include <cstddef>
+
+namespace mpb {
+
+/// @brief 連続領域の読み取り専用ビュー
+///
+/// 領域は所有しません。元のバッファより長く保持しないでください。
+///
+template <class T>
+class ConstSpan {
+public:
+	constexpr ConstSpan(void) noexcept : data_(nullptr), size_(0) {}
+	constexpr ConstSpan(const T * data, const size_t size) noexcept : data_(data), size_(size) {}
+	ConstSpan(const std::vector<T> & v) noexcept : data_(v.data()), size_(v.size()) {}
+
+	const T * data(void) const noexcept { return this->data_; }
+	size_t size(void) const noexcept { return this->size_; }
+	bool empty(void) const noexcept { return this->size_ == 0; }
+	const T * begin(void) const noexcept { return this->data_; }
+	const T * end(void) const noexcept { return this->data_ + this->size_; }
+	const T & operator[](const size_t i) const noexcept { return this->data_[i]; }
+
+private:
+	const T * data_;
+	size_t size_;
+};
+
+
+/// @brief MDataHandleを型で読み書きする特性クラス
+///
+/// 対応する型 : bool, short, int, float, double, MVector, MMatrix, MAngle, MDistance, MTime
+///
+template <class T> struct HandleTraits;
+
+template <> struct HandleTraits<bool> {
+	static bool get(const MDataHandle & h) { return h.asBool(); }
+	static void set(MDataHandle & h, const bool v) { h.set(v); }
+};
+template <> struct HandleTraits<short> {
+	static short get(const MDataHandle & h) { return h.asShort(); }
+	static void set(MDataHandle & h, const short v) { h.set(v); }
+};
+template <> struct HandleTraits<int> {
+	static int get(const MDataHandle & h) { return h.asInt(); }
+	static void set(MDataHandle & h, const int v) { h.set(v); }
+};
+template <> struct HandleTraits<float> {
+	static float get(const MDataHandle & h) { return h.asFloat(); }
+	static void set(MDataHandle & h, const float v) { h.set(v); }
+};
+template <> struct HandleTraits<double> {
+	static double get(const MDataHandle & h) { return h.asDouble(); }
+	static void set(MDataHandle & h, const double v) { h.set(v); }
+};
+template <> struct HandleTraits<MVector> {
+	static MVector get(const MDataHandle & h) { return h.asVector(); }
+	static void set(MDataHandle & h, const MVector & v) { h.set(v); }
+};
+template <> struct HandleTraits<MMatrix> {
+	static MMatrix get(const MDataHandle & h) { return h.asMatrix(); }
+	static void set(MDataHandle & h, const MMatrix & v) { h.set(v); }
+};
+template <> struct HandleTraits<MAngle> {
+	static MAngle get(const MDataHandle & h) { return h.asAngle(); }
+	static void set(MDataHandle & h, const MAngle & v) { h.set(v); }
+};
+template <> struct HandleTraits<MDistance> {
+	static MDistance get(const MDataHandle & h) { return h.asDistance(); }
+	static void set(MDataHandle & h, const MDistance & v) { h.set(v); }
+};
+template <> struct HandleTraits<MTime> {
+	static MTime get(const MDataHandle & h) { return h.asTime(); }
+	static void set(MDataHandle & h, const MTime & v) { h.set(v); }
+};
+
+
+/// @brief 解決済み入力ハンドルの組
+///
+/// compute開始時に一度だけinputValueを呼び出し、以降は番号で参照します。スタック上に置いて使用してください。
+/// NodeBase::resolveInputsで生成します。
+///
+/// @tparam N ハンドル数
+///
+template <size_t N>
+class InputHandles {
+public:
+
+	/// @brief 入力ハンドルを解決する
+	///
+	/// @param [in,out] data 内部データ
+	/// @param [in] attrs アトリビュートの配列
+	///
+	/// @throws MStatusException いずれかのハンドルの取得に失敗した場合
+	///
+	InputHandles(MDataBlock & data, const std::array<const MObject *, N> & attrs) {
+		for (size_t i = 0; i < N; ++i) {
+			MStatus stat;
+			this->handles_[i] = data.inputValue(*attrs[i], &stat);
+			MStatusException::throwIf(stat, "入力データハンドルの取得に失敗", "mpb::InputHandles");
+		}
+	}
+
+	/// @brief 値を型付きで取得する
+	template <class T> T get(const size_t i) const { return HandleTraits<T>::get(this->handles_[i]); }
+
+	/// @brief 複合アトリビュートの子の値を型付きで取得する
+	template <class T> T child(const size_t i, const MObject & child_attr) {
+		return HandleTraits<T>::get(this->handles_[i].child(child_attr));
+	}
+
+	/// @brief ハンドルを直接取得する
+	MDataHandle & operator[](const size_t i) noexcept { return this->handles_[i]; }
+
+	static constexpr size_t size(void) noexcept { return N; }
+
+private:
+	std::array<MDataHandle, N> handles_;
+};
+
+
+/// @brief 解決済み出力ハンドルの組
+///
+/// NodeBase::resolveOutputsで生成します。値の設定後、setCleanでまとめてcleanにしてください。
+///
+/// @tparam N ハンドル数
+///
+template <size_t N>
+class OutputHandles {
+public:
+
+	/// @brief 出力ハンドルを解決する
+	///
+	/// @param [in,out] data 内部データ
+	/// @param [in] attrs アトリビュートの配列
+	///
+	/// @throws MStatusException いずれかのハンドルの取得に失敗した場合
+	///
+	OutputHandles(MDataBlock & data, const std::array<const MObject *, N> & attrs) {
+		for (size_t i = 0; i < N; ++i) {
+			MStatus stat;
+			this->handles_[i] = data.outputValue(*attrs[i], &stat);
+			MStatusException::throwIf(stat, "出力データハンドルの取得に失敗", "mpb::OutputHandles");
+		}
+	}
+
+	/// @brief 値を型付きで設定する
+	template <class T> void set(const size_t i, const T & value) { HandleTraits<T>::set(this->handles_[i], value); }
+
+	/// @brief 複合アトリビュートの子に値を型付きで設定する
+	template <class T> void setChild(const size_t i, const MObject & child_attr, const T & value) {
+		MDataHandle h = this->handles_[i].child(child_attr);
+		HandleTraits<T>::set(h, value);
+	}
+
+	/// @brief 全ハンドルをcleanにする
+	void setClean(void) {
+		for (auto & h : this->handles_) h.setClean();
+	}
+
+	/// @brief ハンドルを直接取得する
+	MDataHandle & operator[](const size_t i) noexcept { return this->handles_[i]; }
+
+	static constexpr size_t size(void) noexcept { return N; }
+
+private:
+	std::array<MDataHandle, N> handles_;
+};
+
+
+/// @brief 配列アトリビュート(multi)の全要素を連続バッファへ読み込む
+///
+/// 物理番号順に1回だけ走査し、bufferへ詰めて返します。bufferはノード側で保持して使い回すと、2回目以降は確保が発生しません。
+/// Maya APIには配列アトリビュートの要素をまとめて取り出す手段がないため、要素ごとにjumpToArrayElementとinputValueを呼び出します。
+/// 一括コピーにはなりません。要素数が多い値は、doubleArray / pointArray / vectorArray型のアトリビュートにして
+/// readDoubleArrayData / readPointArrayData / readVectorArrayDataで読み込んでください。
+///
+/// @param [in,out] handle 配列データハンドル
+/// @param [in,out] buffer 読み込み先。要素数に合わせてリサイズされます
+/// @param [out] logical_indices 論理番号の格納先。不要ならnullptr
+///
+/// @return bufferを指すビュー
+///
+/// @throws MStatusException 要素の取得に失敗した場合
+///
+template <class T>
+ConstSpan<T> readArray(MArrayDataHandle & handle, std::vector<T> & buffer, std::vector<unsigned int> * logical_indices = nullptr) {
+	const unsigned int count = handle.elementCount();
+	buffer.resize(count);
+	if (logical_indices) logical_indices->resize(count);
+	for (unsigned int i = 0; i < count; ++i) {
+		MStatusException::throwIf(handle.jumpToArrayElement(i), "配列要素への移動に失敗", "mpb::readArray");
+		MStatus stat;
+		const MDataHandle element = handle.inputValue(&stat);
+		MStatusException::throwIf(stat, "配列要素の取得に失敗", "mpb::readArray");
+		buffer[i] = HandleTraits<T>::get(element);
+		if (logical_indices) (*logical_indices)[i] = handle.elementIndex();
+	}
+	return ConstSpan<T>(buffer);
+}
+
+
+/// @brief 配列アトリビュートへ一括で書き込む
+///
+/// ビルダーに全要素を追加してから1回でハンドルへ設定し、cleanにします。論理番号は0から連番になります。
+///
+/// @param [in,out] handle 出力の配列データハンドル
+/// @param [in] values 書き込む値
+///
+/// @throws MStatusException ビルダーの操作に失敗した場合
+///
+template <class T>
+void writeArray(MArrayDataHandle & handle, const ConstSpan<T> & values) {
+	MStatus stat;
+	// 既存要素のうち書き込み範囲外のものを落とす。removeElementは論理番号を取るので、疎な配列でも実際の論理番号を集めてから落とす
+	std::vector<unsigned int> stale;
+	const unsigned int existing = handle.elementCount();
+	for (unsigned int i = 0; i < existing; ++i) {
+		MStatusException::throwIf(handle.jumpToArrayElement(i), "配列要素への移動に失敗", "mpb::writeArray");
+		const unsigned int logical = handle.elementIndex(&stat);
+		MStatusException::throwIf(stat, "配列要素の論理番号の取得に失敗", "mpb::writeArray");
+		if (logical >= values.size()) stale.push_back(logical);
+	}
+	MArrayDataBuilder builder = handle.builder(&stat);
+	MStatusException::throwIf(stat, "配列ビルダーの取得に失敗", "mpb::writeArray");
+	for (const unsigned int logical : stale) {
+		MStatusException::throwIf(builder.removeElement(logical), "配列要素の削除に失敗", "mpb::writeArray");
+	}
+	for (size_t i = 0; i < values.size(); ++i) {
+		MDataHandle element = builder.addElement(static_cast<unsigned int>(i), &stat);
+		MStatusException::throwIf(stat, "配列要素の追加に失敗", "mpb::writeArray");
+		HandleTraits<T>::set(element, values[i]);
+	}
+	MStatusException::throwIf(handle.set(builder), "配列ビルダーの設定に失敗", "mpb::writeArray");
+	MStatusException::throwIf(handle.setAllClean(), "配列要素のclean設定に失敗", "mpb::writeArray");
+}
+
+
+/// @brief doubleArray型アトリビュートを連続バッファへ一括で読み込む
+///
+/// MDoubleArray::getによる一括コピーです。
+///
+/// @param [in] handle データハンドル
+/// @param [in,out] buffer 読み込み先。要素数に合わせてリサイズされます
+///
+/// @return bufferを指すビュー
+///
+/// @throws MStatusException データの取得に失敗した場合
+///
+ConstSpan<double> readDoubleArrayData(MDataHandle & handle, std::vector<double> & buffer);
+
+
+/// @brief doubleArray型アトリビュートへ一括で書き込む
+///
+/// @param [in,out] handle 出力のデータハンドル
+/// @param [in] values 書き込む値
+///
+/// @throws MStatusException データの生成・設定に失敗した場合
+///
+void writeDoubleArrayData(MDataHandle & handle, const ConstSpan<double> & values);
+
+
+/// @brief pointArray型アトリビュートを連続バッファへ一括で読み込む
+///
+/// MPointArray::getによる一括コピーです。
+///
+/// @param [in] handle データハンドル
+/// @param [in,out] buffer 読み込み先。要素数に合わせてリサイズされます
+///
+/// @return bufferを指すビュー
+///
+/// @throws MStatusException データの取得に失敗した場合
+///
+ConstSpan<MPoint> readPointArrayData(MDataHandle & handle, std::vector<MPoint> & buffer);
+
+
+/// @brief vectorArray型アトリビュートを連続バッファへ一括で読み込む
+/// @sa readPointArrayData
+ConstSpan<MVector> readVectorArrayData(MDataHandle & handle, std::vector<MVector> & buffer);
+
+
+/// @brief doubleArray型アトリビュートをアラインされたバッファへ読み込む
+///
+/// floatのバッファを指定した場合は単精度へ丸めます。要素数が前回と同じ場合は、rangeの要素だけを変換します。
+///
+/// @param [in] handle データハンドル
+/// @param [in,out] buffer 読み込み先。要素数に合わせてリサイズされます
+/// @param [in] range 変換する要素範囲
+///
+/// @throws MStatusException データの取得に失敗した場合
+///
+template <class T> void readDoubleArrayData(MDataHandle & handle, AlignedBuffer<T> & buffer, const DirtyRange & range = DirtyRange::all());
+
+
+/// @brief アラインされたバッファをdoubleArray型アトリビュートへ書き込む
+///
+/// 出力に同じ要素数のデータが既にある場合はrangeの要素だけを書き換え、それ以外の場合は全要素で作り直します。
+///
+/// @param [in,out] handle 出力のデータハンドル
+/// @param [in] values 書き込む値
+/// @param [in] range 書き込む要素範囲
+///
+/// @throws MStatusException データの生成・設定に失敗した場合
+///
+template <class T> void writeDoubleArrayData(MDataHandle & handle, const AlignedBuffer<T> & values, const DirtyRange & range = DirtyRange::all());
+
+
+/// @brief pointArray型アトリビュートをSoAバッファへ読み込む
+///
+/// floatのバッファを指定した場合は単精度へ丸めます。w成分は読み込みません。
+/// 要素数が前回と同じ場合は、rangeの要素だけを変換します。
+///
+/// @param [in] handle データハンドル
+/// @param [in,out] buffer 読み込み先。要素数に合わせてリサイズされます
+/// @param [in] range 変換する要素範囲
+///
+/// @throws MStatusException データの取得に失敗した場合
+///
+template <class T> void readPointArrayData(MDataHandle & handle, SoaBuffer3<T> & buffer, const DirtyRange & range = DirtyRange::all());
+
+
+/// @brief SoAバッファをpointArray型アトリビュートへ書き込む
+///
+/// 出力に同じ要素数のデータが既にある場合はrangeの要素だけを書き換え、それ以外の場合は全要素で作り直します。w成分は1になります。
+///
+/// @param [in,out] handle 出力のデータハンドル
+/// @param [in] values 書き込む値
+/// @param [in] range 書き込む要素範囲
+///
+/// @throws MStatusException データの生成・設定に失敗した場合
+///
+template <class T> void writePointArrayData(MDataHandle & handle, const SoaBuffer3<T> & values, const DirtyRange & range = DirtyRange::all());
+
+
+/// @brief vectorArray型アトリビュートをSoAバッファへ読み込む
+/// @sa readPointArrayData
+template <class T> void readVectorArrayData(MDataHandle & handle, SoaBuffer3<T> & buffer, const DirtyRange & range = DirtyRange::all());
+
+
+/// @brief SoAバッファをvectorArray型アトリビュートへ書き込む
+/// @sa writePointArrayData
+template <class T> void writeVectorArrayData(MDataHandle & handle, const SoaBuffer3<T> & values, const DirtyRange & range = DirtyRange::all());
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_DATA_ACCESS_HPP_
@@ -0,0 +1,321 @@
+﻿#include "HandleCodec.hpp"
+#include <maya/MFnAttribute.h>
+#include <maya/MFnNumericAttribute.h>
+#include <maya/MFnUnitAttribute.h>
+#include <maya/MFnTypedAttribute.h>
+#include <maya/MFnDoubleArrayData.h>
+#include <maya/MFnIntArrayData.h>
+#include <maya/MFnPointArrayData.h>
+#include <maya/MFnVectorArrayData.h>
+#include <maya/MDoubleArray.h>
+#include <maya/MIntArray.h>
+#include <maya/MPointArray.h>
+#include <maya/MVectorArray.h>
+#include <maya/MMatrix.h>
+#include <maya/MAngle.h>
+#include <maya/MDistance.h>
+#include <maya/MTime.h>
+#include <maya/MString.h>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+const char kPlace[] = "mpb::encodeHandle";
+
+void append(mpb::ScratchVector<char> & out, const void * data, const size_t size)
+{
+	const char * p = static_cast<const char *>(data);
+	out.insert(out.end(), p, p + size);
+}
+
+template <class T>
+void appendValue(mpb::ScratchVector<char> & out, const T & value) { append(out, &value, sizeof(T)); }
+
+// 配列の要素が8バイト境界に来るよう、先頭からの位置を揃える
+void pad8(mpb::ScratchVector<char> & out) { out.resize((out.size() + 7) & ~size_t(7), 0); }
+size_t padded8(const size_t pos) noexcept { return (pos + 7) & ~size_t(7); }
+
+// 要素数に続けて、get(dest)で要素を直接書き込む。ElementTはdouble[4]等、get()の要素の型
+template <class ArrayT, class ElementT>
+void appendArray(mpb::ScratchVector<char> & out, const ArrayT & array)
+{
+	const uint64_t count = array.length();
+	appendValue(out, count);
+	pad8(out);
+	const size_t pos = out.size();
+	out.resize(pos + static_cast<size_t>(count) * sizeof(ElementT));
+	if (count > 0) mpb::MStatusException::throwIf(array.get(reinterpret_cast<ElementT *>(out.data() + pos)), "配列の取得に失敗", kPlace);
+}
+
+// 要素数に続けて、アリーナへget(dest)で取り出した要素をまとめて入力する
+template <class ArrayT, class ElementT>
+void hashArray(mpb::FastHasher & hasher, const ArrayT & array)
+{
+	const uint64_t count = array.length();
+	hasher.updateValue(count);
+	if (count == 0) return;
+	ElementT * elements = mpb::ScratchArena::current().allocateArray<ElementT>(static_cast<size_t>(count));
+	mpb::MStatusException::throwIf(array.get(elements), "配列の取得に失敗", "mpb::hashHandle");
+	hasher.updateBulk(elements, static_cast<size_t>(count) * sizeof(ElementT));
+}
+
+template <class FnT, class ArrayT>
+ArrayT arrayOf(MDataHandle & handle)
+{
+	MStatus stat;
+	FnT fn(handle.data(), &stat);
+	// 未設定のデータは空の配列として扱う
+	if (stat.error()) return ArrayT();
+	const ArrayT array = fn.array(&stat);
+	mpb::MStatusException::throwIf(stat, "配列データの取得に失敗", kPlace);
+	return array;
+}
+
+/// 読み込み位置を進めながら取り出す
+class Reader {
+public:
+	Reader(const char * data, const size_t size) noexcept : data_(data), size_(size), pos_(0) {}
+
+	const char * take(const size_t n) {
+		if (n > this->size_ - this->pos_) mpb::MStatusException::throwError(MStatus::kInvalidParameter, "バイト列が短すぎます", "mpb::decodeHandle");
+		const char * p = this->data_ + this->pos_;
+		this->pos_ += n;
+		return p;
+	}
+	template <class T> T value(void) {
+		T v;
+		std::memcpy(&v, this->take(sizeof(T)), sizeof(T));
+		return v;
+	}
+	void pad8(void) { this->take(padded8(this->pos_) - this->pos_); }
+
+	/// 要素数と、8バイト境界の要素の先頭を取り出す。境界が揃っていなければscratchへ写す
+	template <class ElementT> const ElementT * elements(const uint64_t count, const size_t per_element) {
+		const size_t bytes = static_cast<size_t>(count) * per_element * sizeof(ElementT);
+		if (count > 0 && bytes / per_element / sizeof(ElementT) != count) mpb::MStatusException::throwError(MStatus::kInvalidParameter, "要素数が不正です", "mpb::decodeHandle");
+		const char * p = this->take(bytes);
+		if (reinterpret_cast<uintptr_t>(p) % alignof(ElementT) == 0) return reinterpret_cast<const ElementT *>(p);
+		ElementT * copy = mpb::ScratchArena::current().allocateArray<ElementT>(static_cast<size_t>(count) * per_element);
+		std::memcpy(copy, p, bytes);
+		return copy;
+	}
+
+	size_t position(void) const noexcept { return this->pos_; }
+
+private:
+	const char * data_;
+	size_t size_;
+	size_t pos_;
+};
+
+template <class FnT, class ArrayT>
+void setArray(MDataHandle & handle, const ArrayT & array)
+{
+	MStatus stat;
+	FnT fn;
+	const MObject obj = fn.create(array, &stat);
+	mpb::MStatusException::throwIf(stat, "配列データの生成に失敗", "mpb::decodeHandle");
+	mpb::MStatusException::throwIf(handle.set(obj), "配列データの設定に失敗", "mpb::decodeHandle");
+}
+
+}
+
+mpb::HandleLayout mpb::describeAttribute(const MObject & attribute)
+{
+	HandleLayout layout{ HandleLayout::kUnsupported, MFnNumericData::kInvalid };
+	const MFnAttribute fn(attribute);
+	if (fn.isArray()) return layout;
+
+	if (attribute.hasFn(MFn::kEnumAttribute)) {
+		layout = HandleLayout{ HandleLayout::kNumeric, MFnNumericData::kShort };
+	}
+	else if (attribute.hasFn(MFn::kNumericAttribute)) {
+		const MFnNumericData::Type type = MFnNumericAttribute(attribute).unitType();
+		switch (type) {
+		case MFnNumericData::kBoolean: case MFnNumericData::kByte: case MFnNumericData::kChar:
+		case MFnNumericData::kShort: case MFnNumericData::kInt: case MFnNumericData::kFloat:
+		case MFnNumericData::kDouble: case MFnNumericData::k3Float: case MFnNumericData::k3Double:
+			layout = HandleLayout{ HandleLayout::kNumeric, type };
+			break;
+		default:
+			break;
+		}
+	}
+	else if (attribute.hasFn(MFn::kUnitAttribute)) {
+		switch (MFnUnitAttribute(attribute).unitType()) {
+		case MFnUnitAttribute::kAngle: layout.kind = HandleLayout::kAngle; break;
+		case MFnUnitAttribute::kDistance: layout.kind = HandleLayout::kDistance; break;
+		case MFnUnitAttribute::kTime: layout.kind = HandleLayout::kTime; break;
+		default: break;
+		}
+	}
+	else if (attribute.hasFn(MFn::kTypedAttribute)) {
+		switch (MFnTypedAttribute(attribute).attrType()) {
+		case MFnData::kMatrix: layout.kind = HandleLayout::kMatrix; break;
+		case MFnData::kString: layout.kind = HandleLayout::kString; break;
+		case MFnData::kDoubleArray: layout.kind = HandleLayout::kDoubleArray; break;
+		case MFnData::kIntArray: layout.kind = HandleLayout::kIntArray; break;
+		case MFnData::kPointArray: layout.kind = HandleLayout::kPointArray; break;
+		case MFnData::kVectorArray: layout.kind = HandleLayout::kVectorArray; break;
+		default: break;
+		}
+	}
+	return layout;
+}
+
+void mpb::encodeHandle(MDataHandle & handle, const HandleLayout & layout, ScratchVector<char> & out)
+{
+	switch (layout.kind) {
+	case HandleLayout::kNumeric:
+		switch (layout.numeric_type) {
+		case MFnNumericData::kBoolean: appendValue(out, static_cast<char>(handle.asBool() ? 1 : 0)); break;
+		case MFnNumericData::kByte:
+		case MFnNumericData::kChar: appendValue(out, handle.asChar()); break;
+		case MFnNumericData::kShort: appendValue(out, handle.asShort()); break;
+		case MFnNumericData::kInt: appendValue(out, handle.asInt()); break;
+		case MFnNumericData::kFloat: appendValue(out, handle.asFloat()); break;
+		case MFnNumericData::kDouble: appendValue(out, handle.asDouble()); break;
+		case MFnNumericData::k3Float: append(out, handle.asFloat3(), 3 * sizeof(float)); break;
+		case MFnNumericData::k3Double: append(out, handle.asDouble3(), 3 * sizeof(double)); break;
+		default: MStatusException::throwError(MStatus::kNotImplemented, "扱えない数値型です", kPlace);
+		}
+		break;
+	case HandleLayout::kAngle: {
+		const MAngle v = handle.asAngle();
+		appendValue(out, v.value());
+		appendValue(out, static_cast<int32_t>(v.unit()));
+		break;
+	}
+	case HandleLayout::kDistance: {
+		const MDistance v = handle.asDistance();
+		appendValue(out, v.value());
+		appendValue(out, static_cast<int32_t>(v.unit()));
+		break;
+	}
+	case HandleLayout::kTime: {
+		const MTime v = handle.asTime();
+		appendValue(out, v.value());
+		appendValue(out, static_cast<int32_t>(v.unit()));
+		break;
+	}
+	case HandleLayout::kMatrix: {
+		const MMatrix & m = handle.asMatrix();
+		append(out, m.matrix, sizeof(m.matrix));
+		break;
+	}
+	case HandleLayout::kString: {
+		const MString s = handle.asString();
+		appendValue(out, static_cast<uint64_t>(s.length()));
+		append(out, s.asChar(), s.length());
+		break;
+	}
+	case HandleLayout::kDoubleArray: appendArray<MDoubleArray, double>(out, arrayOf<MFnDoubleArrayData, MDoubleArray>(handle)); break;
+	case HandleLayout::kIntArray: appendArray<MIntArray, int>(out, arrayOf<MFnIntArrayData, MIntArray>(handle)); break;
+	case HandleLayout::kPointArray: appendArray<MPointArray, double[4]>(out, arrayOf<MFnPointArrayData, MPointArray>(handle)); break;
+	case HandleLayout::kVectorArray: appendArray<MVectorArray, double[3]>(out, arrayOf<MFnVectorArrayData, MVectorArray>(handle)); break;
+	default:
+		MStatusException::throwError(MStatus::kNotImplemented, "扱えない種類のアトリビュートです", kPlace);
+	}
+}
+
+size_t mpb::decodeHandle(MDataHandle & handle, const HandleLayout & layout, const char * data, const size_t size)
+{
+	Reader in(data, size);
+	switch (layout.kind) {
+	case HandleLayout::kNumeric:
+		switch (layout.numeric_type) {
+		case MFnNumericData::kBoolean: handle.set(in.value<char>() != 0); break;
+		case MFnNumericData::kByte:
+		case MFnNumericData::kChar: handle.set(in.value<char>()); break;
+		case MFnNumericData::kShort: handle.set(in.value<short>()); break;
+		case MFnNumericData::kInt: handle.set(in.value<int>()); break;
+		case MFnNumericData::kFloat: handle.set(in.value<float>()); break;
+		case MFnNumericData::kDouble: handle.set(in.value<double>()); break;
+		case MFnNumericData::k3Float: {
+			const float x = in.value<float>(), y = in.value<float>(), z = in.value<float>();
+			handle.set(x, y, z);
+			break;
+		}
+		case MFnNumericData::k3Double: {
+			const double x = in.value<double>(), y = in.value<double>(), z = in.value<double>();
+			handle.set(x, y, z);
+			break;
+		}
+		default: MStatusException::throwError(MStatus::kNotImplemented, "扱えない数値型です", "mpb::decodeHandle");
+		}
+		break;
+	case HandleLayout::kAngle: {
+		const double v = in.value<double>();
+		handle.set(MAngle(v, static_cast<MAngle::Unit>(in.value<int32_t>())));
+		break;
+	}
+	case HandleLayout::kDistance: {
+		const double v = in.value<double>();
+		handle.set(MDistance(v, static_cast<MDistance::Unit>(in.value<int32_t>())));
+		break;
+	}
+	case HandleLayout::kTime: {
+		const double v = in.value<double>();
+		handle.set(MTime(v, static_cast<MTime::Unit>(in.value<int32_t>())));
+		break;
+	}
+	case HandleLayout::kMatrix: {
+		double m[4][4];
+		std::memcpy(m, in.take(sizeof(m)), sizeof(m));
+		handle.set(MMatrix(m));
+		break;
+	}
+	case HandleLayout::kString: {
+		const uint64_t length = in.value<uint64_t>();
+		if (length > size) MStatusException::throwError(MStatus::kInvalidParameter, "文字列長が不正です", "mpb::decodeHandle");
+		const char * p = in.take(static_cast<size_t>(length));
+		handle.set(MString(p, static_cast<int>(length)));
+		break;
+	}
+	case HandleLayout::kDoubleArray: {
+		const uint64_t count = in.value<uint64_t>();
+		in.pad8();
+		setArray<MFnDoubleArrayData>(handle, MDoubleArray(in.elements<double>(count, 1), static_cast<unsigned int>(count)));
+		break;
+	}
+	case HandleLayout::kIntArray: {
+		const uint64_t count = in.value<uint64_t>();
+		in.pad8();
+		setArray<MFnIntArrayData>(handle, MIntArray(in.elements<int>(count, 1), static_cast<unsigned int>(count)));
+		break;
+	}
+	case HandleLayout::kPointArray: {
+		const uint64_t count = in.value<uint64_t>();
+		in.pad8();
+		setArray<MFnPointArrayData>(handle, MPointArray(reinterpret_cast<const double(*)[4]>(in.elements<double>(count, 4)), static_cast<unsigned int>(count)));
+		break;
+	}
+	case HandleLayout::kVectorArray: {
+		const uint64_t count = in.value<uint64_t>();
+		in.pad8();
+		setArray<MFnVectorArrayData>(handle, MVectorArray(reinterpret_cast<const double(*)[3]>(in.elements<double>(count, 3)), static_cast<unsigned int>(count)));
+		break;
+	}
+	default:
+		MStatusException::throwError(MStatus::kNotImplemented, "扱えない種類のアトリビュートです", "mpb::decodeHandle");
+	}
+	return in.position();
+}
+
+void mpb::hashHandle(MDataHandle & handle, const HandleLayout & layout, FastHasher & hasher)
+{
+	switch (layout.kind) {
+	case HandleLayout::kDoubleArray: hashArray<MDoubleArray, double>(hasher, arrayOf<MFnDoubleArrayData, MDoubleArray>(handle)); break;
+	case HandleLayout::kIntArray: hashArray<MIntArray, int>(hasher, arrayOf<MFnIntArrayData, MIntArray>(handle)); break;
+	case HandleLayout::kPointArray: hashArray<MPointArray, double[4]>(hasher, arrayOf<MFnPointArrayData, MPointArray>(handle)); break;
+	case HandleLayout::kVectorArray: hashArray<MVectorArray, double[3]>(hasher, arrayOf<MFnVectorArrayData, MVectorArray>(handle)); break;
+	default: {
+		ScratchVector<char> bytes(ArenaAllocator<char>(ScratchArena::current()));
+		encodeHandle(handle, layout, bytes);
+		hasher.updateValue(static_cast<uint64_t>(bytes.size()));
+		hasher.update(bytes.data(), bytes.size());
+		break;
+	}
+	}
+}
@@ -0,0 +1,100 @@
+﻿/// @file HandleCodec.hpp
+/// @brief データハンドルの値とバイト列の相互変換
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_HANDLE_CODEC_HPP_
+#define _MAYA_PLUGIN_BASE_HANDLE_CODEC_HPP_
+
+#include "exception/MStatusException.hpp"
+#include "util/ScratchArena.hpp"
+#include "util/FastHash.hpp"
+#include <maya/MDataHandle.h>
+#include <maya/MFnNumericData.h>
+#include <maya/MObject.h>
+#include <cstddef>
+
+namespace mpb {
+
+/// @brief アトリビュートの値の表現
+///
+/// describeAttributeで求め、encodeHandle / decodeHandleに渡します。
+///
+struct HandleLayout {
+
+	/// @brief 値の種類
+	enum Kind {
+		kUnsupported,	///< 扱えない（配列アトリビュート、複合アトリビュート、メッシュ等）
+		kNumeric,		///< 数値・列挙（numeric_typeで型を区別）
+		kAngle,			///< 角度
+		kDistance,		///< 距離
+		kTime,			///< 時間
+		kMatrix,		///< 行列
+		kString,		///< 文字列
+		kDoubleArray,	///< doubleArray
+		kIntArray,		///< Int32Array
+		kPointArray,	///< pointArray
+		kVectorArray,	///< vectorArray
+	};
+
+	Kind kind;
+	MFnNumericData::Type numeric_type;	///< kNumericの場合の型
+
+	bool supported(void) const noexcept { return this->kind != kUnsupported; }
+};
+
+
+/// @brief アトリビュートの値の表現を求める
+///
+/// 数値はkBoolean, kByte, kChar, kShort, kInt, kFloat, kDouble, k3Float, k3Doubleに対応します。
+/// 配列アトリビュート(multi)は扱えません。
+///
+/// @param [in] attribute アトリビュート
+/// @return 値の表現。扱えない場合のkindはkUnsupported
+///
+HandleLayout describeAttribute(const MObject & attribute);
+
+
+/// @brief データハンドルの値をバイト列へ追記する
+///
+/// 同じ値からは常に同じバイト列が得られるため、ハッシュの入力にも使えます。
+/// 配列は要素数(uint64)に続けて、MDoubleArray::get等で取り出した要素をそのまま並べます。
+///
+/// @param [in,out] handle データハンドル
+/// @param [in] layout 値の表現
+/// @param [in,out] out 追記先
+///
+/// @throws MStatusException 値の取得に失敗した場合、またはlayoutが扱えない種類の場合
+///
+void encodeHandle(MDataHandle & handle, const HandleLayout & layout, ScratchVector<char> & out);
+
+
+/// @brief バイト列からデータハンドルへ値を設定する
+///
+/// encodeHandleの逆変換です。cleanにはしません。
+///
+/// @param [in,out] handle 設定先のデータハンドル
+/// @param [in] layout 値の表現
+/// @param [in] data バイト列
+/// @param [in] size バイト数
+/// @return 読み込んだバイト数
+///
+/// @throws MStatusException バイト列が不正な場合、またはデータの生成・設定に失敗した場合
+///
+size_t decodeHandle(MDataHandle & handle, const HandleLayout & layout, const char * data, const size_t size);
+
+
+/// @brief データハンドルの値をハッシュへ入力する
+///
+/// encodeHandleのバイト列を作らずに、配列の要素をFastHasher::updateBulkでまとめて入力します。
+/// 配列以外はencodeHandleのバイト列をそのまま入力します。要素はScratchArena::current()へ取り出すため、呼び出し側でScopeを張ってください。
+///
+/// @param [in,out] handle データハンドル
+/// @param [in] layout 値の表現
+/// @param [in,out] hasher 入力先
+///
+/// @throws MStatusException 値の取得に失敗した場合、またはlayoutが扱えない種類の場合
+///
+void hashHandle(MDataHandle & handle, const HandleLayout & layout, FastHasher & hasher);
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_HANDLE_CODEC_HPP_
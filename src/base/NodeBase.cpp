@@ -0,0 +1,620 @@
+﻿#include "NodeBase.hpp"
+#include "exception/MStatusException.hpp"
+#include "util/ThreadPool.hpp"
+#include "util/ComputeProfiler.hpp"
+#include "util/Logger.hpp"
+#include <maya/MGlobal.h>
+#include <maya/MFnEnumAttribute.h>
+#include <maya/MFnNumericAttribute.h>
+#include <maya/MFnUnitAttribute.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <string>
+
+std::vector<mpb::NodeBase::Registered> mpb::NodeBase::registered_;
+std::atomic<bool> mpb::NodeBase::parallel_enabled_(true);
+std::atomic<bool> mpb::NodeBase::async_enabled_(true);
+
+/// 非同期計算1回分のジョブと結果。ノードとワーカーで共有する
+struct mpb::NodeBase::AsyncTask {
+	std::unique_ptr<AsyncJob> job;
+	uint64_t version;			///< ジョブを生成した時点の入力の版番号
+	MString plug_name;			///< 完了通知のdgdirty用
+	MString node_type;
+	std::string profile_key;	///< ComputeProfiler用の「アトリビュート名@async」
+	CancelToken cancel;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	bool done = false;
+	MStatus status;
+
+	bool isDone(void)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		return this->done;
+	}
+
+	/// @brief 完了を待つ。timeout_msが0なら完了するまで待つ
+	void wait(const unsigned int timeout_ms = 0)
+	{
+		std::unique_lock<std::mutex> lock(this->mutex);
+		if (timeout_ms == 0) this->cv.wait(lock, [this] { return this->done; });
+		else this->cv.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return this->done; });
+	}
+
+	/// @brief キャンセルする。以後、完了通知は発行されない
+	void abandon(void)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->cancel.cancel();
+	}
+
+	/// @brief ワーカースレッドでジョブを実行する
+	void run(void)
+	{
+		MStatus stat;
+		if (!this->cancel.cancelled()) {
+			ScratchArena::Scope scope(ScratchArena::threadLocal());
+			const bool profile = ComputeProfiler::isEnabled();
+			const uint64_t start = (profile ? ComputeProfiler::now() : 0);
+			try {
+				this->job->run(this->cancel);
+			}
+			catch (const MStatusException & e) {
+				ErrorAggregator::record("NODE ASYNC", this->node_type, e);
+				stat = e;
+			}
+			catch (const std::exception & e) {
+				// ワーカースレッドから例外を漏らすと終了してしまう
+				MPB_LOG_ERROR("NODE ASYNC : %s : %s", this->plug_name.asChar(), e.what());
+				stat = MStatus::kFailure;
+			}
+			if (profile) ComputeProfiler::record(this->node_type.asChar(), this->profile_key.c_str(), ComputeProfiler::now() - start, stat.error(), scope.peakBytes());
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->done = true;
+			this->status = stat;
+			// キャンセル済みのジョブの結果は使われないので通知しない
+			if (!this->cancel.cancelled()) MGlobal::executeCommandOnIdle("dgdirty " + this->plug_name);
+		}
+		this->cv.notify_all();
+	}
+
+	/// @brief キューが停止していて実行されなかったジョブを失敗として完了させる
+	void drop(void)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->cancel.cancel();
+			this->done = true;
+			this->status = MStatus::kFailure;
+		}
+		this->cv.notify_all();
+	}
+};
+
+mpb::NodeBase::NodeBase(const MTypeId id, const MString & name, const MPxNode::Type type) noexcept
+	: name_(name), id_(id), type_(type), classification_(""), own_classification_(false), dirty_version_(0), scratch_in_use_(false), error_hint_(nullptr), memo_cache_(nullptr) {}
+
+mpb::NodeBase::NodeBase(const MTypeId id, const MString & name, const MString & classification, const MPxNode::Type type) noexcept
+	: name_(name), id_(id), type_(type), classification_(classification), own_classification_(true), dirty_version_(0), scratch_in_use_(false), error_hint_(nullptr), memo_cache_(nullptr) {}
+
+mpb::NodeBase::NodeBase(const NodeInfo & info) noexcept
+	: name_(info.name), id_(info.id), type_(info.type), classification_(info.classification != nullptr ? info.classification : ""), own_classification_(info.classification != nullptr),
+	dirty_version_(0), scratch_in_use_(false), error_hint_(nullptr), memo_cache_(nullptr) {}
+
+mpb::NodeBase::~NodeBase(void)
+{
+	std::lock_guard<std::mutex> lock(this->async_mutex_);
+	for (auto & slot : this->async_slots_) {
+		if (slot.back) slot.back->abandon();
+	}
+}
+
+namespace {
+
+/// ノードのアリーナの使用権。取れなかった場合はこのスレッドのアリーナを使う
+class ScratchLease {
+public:
+	ScratchLease(mpb::ScratchArena & arena, std::atomic<bool> & in_use) noexcept
+		: owner_(in_use), scope_(owner_.owns ? arena : mpb::ScratchArena::threadLocal()) {}
+
+	/// @brief このcomputeでアリーナを同時に使用した最大バイト数
+	size_t peakBytes(void) const noexcept { return this->scope_.peakBytes(); }
+
+private:
+	// 巻き戻しが終わってから使用権を返すため、scope_より先に宣言する
+	struct Owner {
+		std::atomic<bool> & in_use;
+		const bool owns;
+		explicit Owner(std::atomic<bool> & flag) noexcept : in_use(flag), owns(!flag.exchange(true, std::memory_order_acquire)) {}
+		~Owner(void) { if (this->owns) this->in_use.store(false, std::memory_order_release); }
+	};
+	Owner owner_;
+	mpb::ScratchArena::Scope scope_;
+};
+
+}
+
+MStatus mpb::NodeBase::compute(const MPlug & plug, MDataBlock & data)
+{
+	MStatus ret;
+	ScratchLease lease(this->scratch_arena_, this->scratch_in_use_);
+	if (!ComputeProfiler::isEnabled()) {
+		ret = this->computeAsync(plug, data);
+	}
+	else {
+		const uint64_t start = ComputeProfiler::now();
+		ret = this->computeAsync(plug, data);
+		const uint64_t elapsed = ComputeProfiler::now() - start;
+		// 配列要素は配列アトリビュート単位でまとめる
+		const MFnAttribute attr(plug.attribute());
+		ComputeProfiler::record(this->name_.asChar(), attr.name().asChar(), elapsed, ret.error(), lease.peakBytes());
+	}
+	return ret;
+}
+
+MStatus mpb::NodeBase::computeAsync(const MPlug & plug, MDataBlock & data)
+{
+	const AsyncSpec * spec = this->asyncSpec();
+	if (!spec || plug.isElement() || plug.isChild()) return this->computeMemoized(plug, data);
+
+	const MObject attribute = plug.attribute();
+	if (std::none_of(spec->outputs.begin(), spec->outputs.end(), [&attribute](const MObject * o) { return *o == attribute; })) return this->computeMemoized(plug, data);
+
+	try {
+		uint64_t version;
+		{
+			std::lock_guard<std::mutex> lock(this->versions_mutex_);
+			version = this->dirty_version_;
+		}
+
+		if (!NodeBase::async_enabled_.load(std::memory_order_relaxed)) {
+			std::unique_ptr<AsyncJob> job = this->createAsyncJob(plug, data);
+			job->run(CancelToken());
+			job->write(plug, data);
+			std::lock_guard<std::mutex> lock(this->versions_mutex_);
+			setStamp(this->output_versions_, attribute, version);
+			return MStatus::kSuccess;
+		}
+
+		// バッチレンダリングやmayapyなどで古い結果を出さないよう、対話モード以外では待つ
+		// （アイドルループがないため、完了通知のdgdirtyが届かない）
+		const AsyncSpec::Staleness staleness = (MGlobal::mayaState() != MGlobal::kInteractive ? AsyncSpec::kWaitAlways : spec->staleness);
+
+		std::shared_ptr<AsyncTask> front, back;
+		{
+			std::lock_guard<std::mutex> lock(this->async_mutex_);
+			auto it = std::find_if(this->async_slots_.begin(), this->async_slots_.end(), [&attribute](const AsyncSlot & s) { return s.attribute == attribute; });
+			if (it == this->async_slots_.end()) it = this->async_slots_.insert(this->async_slots_.end(), AsyncSlot{ attribute, nullptr, nullptr, UINT64_MAX, MStatus::kSuccess });
+			AsyncSlot & slot = *it;
+			collectAsync(slot);
+
+			const bool current = (slot.front && slot.front->version == version);
+			if (!current && slot.failed_version == version) return slot.failure;
+			if (!current) {
+				// 入力が変わったので、古い入力のジョブは捨てる
+				if (slot.back && slot.back->version != version) {
+					slot.back->abandon();
+					slot.back.reset();
+				}
+				if (!slot.back) {
+					std::shared_ptr<AsyncTask> task = std::make_shared<AsyncTask>();
+					task->job = this->createAsyncJob(plug, data);
+					task->version = version;
+					task->plug_name = plug.name();
+					task->node_type = this->name_;
+					task->profile_key = std::string(MFnAttribute(attribute).name().asChar()) + "@async";
+					slot.back = task;
+					AsyncComputeQueue::global().submit([task] { task->run(); }, [task] { task->drop(); });
+				}
+			}
+			front = slot.front;
+			back = slot.back;
+		}
+
+		if (back) {
+			if (staleness == AsyncSpec::kWaitAlways || (staleness == AsyncSpec::kWaitInitial && !front)) back->wait();
+			else if (spec->wait_ms > 0) back->wait(spec->wait_ms);
+
+			if (back->isDone()) {
+				std::lock_guard<std::mutex> lock(this->async_mutex_);
+				auto it = std::find_if(this->async_slots_.begin(), this->async_slots_.end(), [&attribute](const AsyncSlot & s) { return s.attribute == attribute; });
+				collectAsync(*it);
+				if (it->failed_version == version) return it->failure;
+				front = it->front;
+			}
+		}
+
+		MStatus stat;
+		MDataHandle handle = data.outputValue(attribute, &stat);
+		MStatusException::throwIf(stat, "出力データハンドルの取得に失敗", "mpb::NodeBase::computeAsync");
+		if (front) {
+			front->job->write(plug, data);
+			std::lock_guard<std::mutex> lock(this->versions_mutex_);
+			setStamp(this->output_versions_, attribute, front->version);
+		}
+		// 結果がまだなくても、完了通知までは再計算させない
+		handle.setClean();
+	}
+	catch (const MStatusException & e) {
+		ErrorAggregator::record("NODE", this->name_, e, &this->error_hint_);
+		return e;
+	}
+	return MStatus::kSuccess;
+}
+
+void mpb::NodeBase::collectAsync(AsyncSlot & slot)
+{
+	if (!slot.back || !slot.back->isDone()) return;
+	if (slot.back->status.error()) {
+		slot.failed_version = slot.back->version;
+		slot.failure = slot.back->status;
+	}
+	else {
+		slot.front = std::move(slot.back);
+	}
+	slot.back.reset();
+}
+
+MStatus mpb::NodeBase::computeMemoized(const MPlug & plug, MDataBlock & data)
+{
+	const MemoSpec * spec = this->memoSpec();
+	if (!spec || !MemoCache::isEnabled() || plug.isElement() || plug.isChild()) return this->computeGuarded(plug, data);
+
+	std::call_once(this->memo_once_, [this, spec] { this->prepareMemo(*spec); });
+	if (!this->memo_cache_) return this->computeGuarded(plug, data);
+
+	const MObject attribute = plug.attribute();
+	size_t output = 0;
+	while (output < spec->outputs.size() && !(*spec->outputs[output] == attribute)) ++output;
+	if (output == spec->outputs.size()) return this->computeGuarded(plug, data);
+
+	Hash128 key;
+	uint64_t version;
+	try {
+		{
+			std::lock_guard<std::mutex> lock(this->versions_mutex_);
+			version = this->dirty_version_;
+		}
+		key = this->memoKey(data, *spec, output);
+
+		if (const MemoCache::Blob blob = this->memo_cache_->find(key)) {
+			MStatus stat;
+			MDataHandle handle = data.outputValue(attribute, &stat);
+			MStatusException::throwIf(stat, "出力データハンドルの取得に失敗", "mpb::NodeBase::computeMemoized");
+			decodeHandle(handle, this->memo_outputs_[output], blob->data(), blob->size());
+			handle.setClean();
+
+			std::lock_guard<std::mutex> lock(this->versions_mutex_);
+			setStamp(this->output_versions_, attribute, version);
+			return MStatus::kSuccess;
+		}
+	}
+	catch (const MStatusException & e) {
+		// メモ化は最適化なので、失敗しても通常の計算を行う
+		ErrorAggregator::record("NODE MEMO", this->name_, e, &this->error_hint_);
+		return this->computeGuarded(plug, data);
+	}
+
+	const MStatus ret = this->computeGuarded(plug, data);
+	if (ret.error()) return ret;
+	try {
+		MStatus stat;
+		MDataHandle handle = data.outputValue(attribute, &stat);
+		MStatusException::throwIf(stat, "出力データハンドルの取得に失敗", "mpb::NodeBase::computeMemoized");
+		ScratchVector<char> bytes(ArenaAllocator<char>(ScratchArena::current()));
+		encodeHandle(handle, this->memo_outputs_[output], bytes);
+		this->memo_cache_->insert(key, std::vector<char>(bytes.begin(), bytes.end()));
+	}
+	catch (const MStatusException & e) {
+		ErrorAggregator::record("NODE MEMO", this->name_, e, &this->error_hint_);
+	}
+	return ret;
+}
+
+void mpb::NodeBase::prepareMemo(const MemoSpec & spec)
+{
+	const auto describe = [this](const std::vector<const MObject *> & attributes, std::vector<HandleLayout> & layouts) {
+		layouts.clear();
+		for (const MObject * attribute : attributes) {
+			layouts.push_back(describeAttribute(*attribute));
+			if (!layouts.back().supported()) {
+				MPB_LOG_WARNING("- [WARNING] %s : メモ化できないアトリビュートのため、メモ化を無効にします : %s", this->name_.asChar(), MFnAttribute(*attribute).name().asChar());
+				return false;
+			}
+		}
+		return true;
+	};
+	if (!describe(spec.inputs, this->memo_inputs_) || !describe(spec.outputs, this->memo_outputs_)) return;
+	this->memo_cache_ = &MemoCache::forType(this->name_.asChar());
+}
+
+mpb::Hash128 mpb::NodeBase::memoKey(MDataBlock & data, const MemoSpec & spec, const size_t output) const
+{
+	FastHasher hasher;
+	hasher.updateValue(static_cast<uint64_t>(output));
+	for (size_t i = 0; i < spec.inputs.size(); ++i) {
+		MStatus stat;
+		MDataHandle handle = data.inputValue(*spec.inputs[i], &stat);
+		MStatusException::throwIf(stat, "入力データハンドルの取得に失敗", "mpb::NodeBase::memoKey");
+		// 入力ごとに一時領域を巻き戻す
+		ScratchArena::Scope scope(ScratchArena::current());
+		hashHandle(handle, this->memo_inputs_[i], hasher);
+	}
+	return hasher.digest();
+}
+
+MStatus mpb::NodeBase::computeGuarded(const MPlug & plug, MDataBlock & data)
+{
+	MStatus ret;
+	try {
+		uint64_t version;
+		{
+			std::lock_guard<std::mutex> lock(this->versions_mutex_);
+			version = this->dirty_version_;
+		}
+		this->computeProcess(plug, data);
+
+		// 成功した場合のみ、この出力が見た版番号を記録する
+		const MObject output = plug.attribute();
+		std::lock_guard<std::mutex> lock(this->versions_mutex_);
+		setStamp(this->output_versions_, output, version);
+	}
+	catch (const MStatusException & e) {
+		// 壊れたリグでは毎評価同じ例外が出るので、整形と出力は区分ごとに最初の1回だけにする
+		ErrorAggregator::record("NODE", this->name_, e, &this->error_hint_);
+		ret = e;
+	}
+	return ret;
+}
+
+MStatus mpb::NodeBase::setDependentsDirty(const MPlug & plug_being_dirtied, MPlugArray & affected_plugs)
+{
+	const MObject attribute = plug_being_dirtied.attribute();
+	const AsyncSpec * spec = this->asyncSpec();
+	if (spec && std::any_of(spec->outputs.begin(), spec->outputs.end(), [&attribute](const MObject * o) { return *o == attribute; })) return MStatus::kSuccess;
+
+	std::lock_guard<std::mutex> lock(this->versions_mutex_);
+	const uint64_t version = ++this->dirty_version_;
+	setStamp(this->input_versions_, attribute, version);
+
+	// 複合アトリビュートの子が汚された場合は親も変更扱いにする
+	if (plug_being_dirtied.isChild()) {
+		setStamp(this->input_versions_, plug_being_dirtied.parent().attribute(), version);
+	}
+	return MStatus::kSuccess;
+}
+
+bool mpb::NodeBase::inputChanged(const MPlug & plug, const MObject & input) const
+{
+	std::lock_guard<std::mutex> lock(this->versions_mutex_);
+	const AttributeStamp * output = findStamp(this->output_versions_, plug.attribute());
+	if (!output) return true;
+	const AttributeStamp * in = findStamp(this->input_versions_, input);
+	return (in && in->version > output->version);
+}
+
+bool mpb::NodeBase::anyInputChanged(const MPlug & plug, const std::vector<const MObject *> & inputs) const
+{
+	for (const MObject * input : inputs) {
+		if (this->inputChanged(plug, *input)) return true;
+	}
+	return false;
+}
+
+const mpb::NodeBase::AttributeStamp * mpb::NodeBase::findStamp(const std::vector<AttributeStamp> & stamps, const MObject & attribute) noexcept
+{
+	// アトリビュート数は少ないので線形探索で十分
+	for (const auto & s : stamps) {
+		if (s.attribute == attribute) return &s;
+	}
+	return nullptr;
+}
+
+void mpb::NodeBase::setStamp(std::vector<AttributeStamp> & stamps, const MObject & attribute, const uint64_t version)
+{
+	for (auto & s : stamps) {
+		if (s.attribute == attribute) {
+			s.version = version;
+			return;
+		}
+	}
+	stamps.push_back(AttributeStamp{ attribute, version });
+}
+
+void mpb::NodeBase::computeProcess(const MPlug & plug, MDataBlock & data)
+{
+	MStatusException::throwError(MStatus::kUnknownParameter, "computeProcess関数が定義されていません", "mpb::NodeBase::computeProcess<default>");
+}
+
+std::unique_ptr<mpb::AsyncJob> mpb::NodeBase::createAsyncJob(const MPlug & plug, MDataBlock & data)
+{
+	MStatusException::throwError(MStatus::kUnknownParameter, "createAsyncJob関数が定義されていません", "mpb::NodeBase::createAsyncJob<default>");
+}
+
+void mpb::NodeBase::setMultiAttributeAffects(const std::vector<const MObject *> & whenChanges, const std::vector<const MObject *> & isAffect)
+{
+	for (size_t widx = 0; widx < whenChanges.size(); ++widx) {
+		for (size_t iidx = 0; iidx < isAffect.size(); ++iidx) {
+			MStatusException::throwIf(attributeAffects(*whenChanges.at(widx), *isAffect.at(iidx)), [widx, iidx] { return MString(std::string("アトリビュートの影響設定に失敗 : widx = " + std::to_string(widx) + " -> iidx = " + std::to_string(iidx)).c_str()); });
+		}
+	}
+
+	for (size_t iidx = 0; iidx < isAffect.size(); ++iidx) {
+		MStatusException::throwIf(attributeAffects(state, *isAffect.at(iidx)), [iidx] { return MString(std::string("アトリビュートの影響設定に失敗 : state -> iidx = " + std::to_string(iidx)).c_str()); });
+	}
+}
+
+void mpb::NodeBase::addAttr(const MObject & obj, const MFnAttribute & attr)
+{
+	MStatusException::throwIf(MPxNode::addAttribute(obj), [&attr] { return attr.name() + "アトリビュートの追加に失敗"; });
+}
+
+void mpb::NodeBase::addEnumAttr(MObject & target, const MString & longname, const MString & shortname, const AttributeOptions & options, const std::vector<std::pair<MString, short>>& enums, const short def_value) {
+	MFnEnumAttribute attr;
+	target = attr.create(longname, shortname, def_value);
+	options.apply(attr);
+	for (const auto & p : enums) {
+		attr.addField(p.first, p.second);
+	}
+	addAttr(target, attr);
+}
+
+void mpb::NodeBase::addNumericAttr(MObject & target, const MString & longname, const MString & shortname, const AttributeOptions & options, const MFnNumericData::Type & numeric_data, const double & def_value) {
+	MFnNumericAttribute attr;
+	target = attr.create(longname, shortname, numeric_data, def_value);
+	options.apply(attr);
+	addAttr(target, attr);
+}
+
+void mpb::NodeBase::addNumericAttr(MObject & target, const MString & longname, const MString & shortname, const AttributeOptions & options, const MObject & child1, const MObject & child2, const MObject & child3) {
+	MFnNumericAttribute attr;
+	target = attr.create(longname, shortname, child1, child2, child3);
+	options.apply(attr);
+	addAttr(target, attr);
+}
+
+template<class T>
+void mpb::NodeBase::addUnitAttr(MObject & target, const MString & longname, const MString & shortname, const T & def_value, const AttributeOptions & options) {
+	MFnUnitAttribute attr;
+	target = attr.create(longname, shortname, def_value);
+	options.apply(attr);
+	addAttr(target, attr);
+}
+
+template void mpb::NodeBase::addUnitAttr(MObject &, const MString &, const MString &, const MAngle &, const AttributeOptions & options);
+template void mpb::NodeBase::addUnitAttr(MObject &, const MString &, const MString &, const MTime &, const AttributeOptions & options);
+template void mpb::NodeBase::addUnitAttr(MObject &, const MString &, const MString &, const MDistance &, const AttributeOptions & options);
+
+void mpb::NodeBase::addSchemaAttr(MObject & target, const AttributeDesc & desc) {
+	switch (desc.kind) {
+	case AttributeKind::kNumeric:
+		addNumericAttr(target, desc.longname, desc.shortname, desc.options, desc.numeric_type, desc.def_value);
+		break;
+	case AttributeKind::kEnum: {
+		std::vector<std::pair<MString, short>> enums;
+		enums.reserve(desc.num_fields);
+		for (size_t i = 0; i < desc.num_fields; ++i) enums.emplace_back(desc.fields[i].name, desc.fields[i].value);
+		addEnumAttr(target, desc.longname, desc.shortname, desc.options, enums, static_cast<short>(desc.def_value));
+		break;
+	}
+	case AttributeKind::kAngle:
+		addUnitAttr(target, desc.longname, desc.shortname, MAngle(desc.def_value, MAngle::kRadians), desc.options);
+		break;
+	case AttributeKind::kDistance:
+		addUnitAttr(target, desc.longname, desc.shortname, MDistance(desc.def_value, MDistance::kCentimeters), desc.options);
+		break;
+	case AttributeKind::kTime:
+		addUnitAttr(target, desc.longname, desc.shortname, MTime(desc.def_value, MTime::kFilm), desc.options);
+		break;
+	default:
+		MStatusException::throwError(MStatus::kInvalidParameter, "未対応のアトリビュート種類", "mpb::NodeBase::addSchemaAttr");
+	}
+}
+
+void mpb::NodeBase::parallelFor(const size_t count, const std::function<void(size_t, size_t)> & kernel, const size_t grain_size)
+{
+	if (!NodeBase::parallel_enabled_.load(std::memory_order_relaxed)) {
+		if (count > 0) kernel(0, count);
+		return;
+	}
+	// チャンクごとに、実行スレッドの一時領域を巻き戻す
+	ThreadPool::global().parallelFor(count, grain_size, [&kernel](size_t begin, size_t end) {
+		ScratchArena::Scope scope(ScratchArena::current());
+		kernel(begin, end);
+	});
+}
+
+void mpb::NodeBase::setParallelComputeEnabled(const bool enabled) noexcept
+{ NodeBase::parallel_enabled_.store(enabled); }
+
+bool mpb::NodeBase::isParallelComputeEnabled(void) noexcept
+{ return NodeBase::parallel_enabled_.load(); }
+
+void mpb::NodeBase::setAsyncComputeEnabled(const bool enabled) noexcept
+{ NodeBase::async_enabled_.store(enabled); }
+
+bool mpb::NodeBase::isAsyncComputeEnabled(void) noexcept
+{ return NodeBase::async_enabled_.load(); }
+
+
+////////////////////////////////////////////////
+
+void mpb::AttributeOptions::apply(MFnAttribute & attr) const {
+	MStatusException::throwIf(attr.setReadable(this->is_readable), [&attr] { return attr.name() + "アトリビュートのReadableを変更できません"; });
+	MStatusException::throwIf(attr.setWritable(this->is_writable), [&attr] { return attr.name() + "アトリビュートのWritableを変更できません"; });
+	MStatusException::throwIf(attr.setStorable(this->is_storable), [&attr] { return attr.name() + "アトリビュートのStorableを変更できません"; });
+	MStatusException::throwIf(attr.setCached(this->is_cached), [&attr] { return attr.name() + "アトリビュートのCachableを変更できません"; });
+	MStatusException::throwIf(attr.setKeyable(this->is_keyable), [&attr] { return attr.name() + "アトリビュートのKeyableを変更できません"; });
+}
+
+namespace {
+
+/// ノード型1つ分のprepare
+struct PrepareEntry {
+	MString name;
+	void(*prepare)() = nullptr;
+	bool submitted = false;		///< ThreadPoolへ投入したか。ワーカーがいなければ最初の生成時まで実行しない
+	mpb::ThreadPool::TaskGroup group;
+	bool done = false;
+	bool failed = false;
+};
+
+// 登録・生成・解除はすべてメインスレッドから行われる。ワーカーはgroupにしか触れない
+std::deque<PrepareEntry> prepare_entries;
+
+}
+
+size_t mpb::NodeBase::_submitPrepare(const MString & name, void(*prepare)())
+{
+	prepare_entries.emplace_back();
+	PrepareEntry & entry = prepare_entries.back();
+	entry.name = name;
+	entry.prepare = prepare;
+	ThreadPool & pool = ThreadPool::global();
+	if (pool.numWorkers() > 0) {
+		pool.submit(entry.group, [prepare] { prepare(); });
+		entry.submitted = true;
+	}
+	return prepare_entries.size() - 1;
+}
+
+bool mpb::NodeBase::_waitPrepare(const size_t index)
+{
+	PrepareEntry & entry = prepare_entries[index];
+	if (entry.done) return !entry.failed;
+	entry.done = true;
+	try {
+		if (entry.submitted) ThreadPool::global().wait(entry.group);
+		else entry.prepare();
+	}
+	catch (const MStatusException & e) {
+		MPB_LOG_ERROR("%s", e.toString("NODE : " + entry.name).asChar());
+		MGlobal::displayError("ノードの準備に失敗したため生成できません : " + entry.name);
+		entry.failed = true;
+	}
+	catch (const std::exception & e) {
+		MPB_LOG_ERROR("NODE : %s : %s", entry.name.asChar(), e.what());
+		MGlobal::displayError("ノードの準備に失敗したため生成できません : " + entry.name);
+		entry.failed = true;
+	}
+	return !entry.failed;
+}
+
+void mpb::NodeBase::_finishPrepares(void)
+{
+	// 実行中のprepareがDLLのコードを参照しているため、アンロード前に必ず終わらせる。投入していないものは実行しない
+	// waitはワーカーがgroupに触れ終わってから戻るので、直後のclearでgroupを破棄してよい
+	for (auto & entry : prepare_entries) {
+		if (!entry.submitted || entry.done) continue;
+		try { ThreadPool::global().wait(entry.group); }
+		catch (...) {}
+	}
+	prepare_entries.clear();
+}
@@ -0,0 +1,785 @@
+﻿#pragma once
+#ifndef _MAYA_PLUGIN_BASE_NODE_BASE_HPP_
+#define _MAYA_PLUGIN_BASE_NODE_BASE_HPP_
+
+#include "exception/MStatusException.hpp"
+#include "base/AttributeSchema.hpp"
+#include "base/DataAccess.hpp"
+#include "base/HandleCodec.hpp"
+#include "util/ScratchArena.hpp"
+#include "util/MemoCache.hpp"
+#include "util/AsyncComputeQueue.hpp"
+#include "util/ErrorAggregator.hpp"
+#include <maya/MString.h>
+#include <maya/MTypeId.h>
+#include <maya/MStatus.h>
+#include <maya/MPxNode.h>
+#include <maya/MFnAttribute.h>
+#include <maya/MPlug.h>
+#include <maya/MPlugArray.h>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <cstdint>
+#include <type_traits>
+
+class MFnPlugin;
+
+namespace mpb {
+
+/// @brief メモ化の対象となる入力と出力
+///
+/// NodeBase::memoSpecで返します。
+///
+struct MemoSpec {
+	std::vector<const MObject *> inputs;	///< 出力を決めるすべての入力
+	std::vector<const MObject *> outputs;	///< キャッシュする出力
+};
+
+
+/// @brief 非同期計算の1回分の処理
+///
+/// MDataBlockはcomputeの外では使えないため、computeProcessを3つに分けたものです。
+/// NodeBase::createAsyncJobでcomputeのスレッドから入力を写し取って生成し、runをAsyncComputeQueueのワーカーで、
+/// writeを結果が出た後のcomputeで呼び出します。
+///
+class AsyncJob {
+public:
+	virtual ~AsyncJob(void) {}
+
+	/// @brief ワーカースレッドで計算する
+	///
+	/// Maya APIは使わないでください。scratch()はワーカースレッドのアリーナになります。
+	///
+	/// @param [in] cancel 入力が変わって結果が不要になるとキャンセルされます。長い処理では定期的に確認して戻ってください
+	///
+	/// @throw MStatusException 計算に失敗した場合
+	///
+	virtual void run(const CancelToken & cancel) = 0;
+
+	/// @brief 計算結果を出力へ書き込む
+	///
+	/// 次の結果が出るまでは、再計算のたびに同じジョブで呼ばれます。
+	///
+	/// @param [in] plug 計算中のプラグ
+	/// @param [in,out] data 編集可能な内部データ
+	///
+	/// @throw MStatusException 書き込みに失敗した場合
+	///
+	virtual void write(const MPlug & plug, MDataBlock & data) = 0;
+};
+
+
+/// @brief 非同期計算の対象と、古い結果の扱い
+///
+/// NodeBase::asyncSpecで返します。
+///
+struct AsyncSpec {
+	/// @brief 入力が変わってから新しい結果が出るまでの出力の扱い
+	enum Staleness {
+		kReturnLast,	///< 待たずに直前の結果を返す。最初の結果が出るまでは出力を書き換えない
+		kWaitInitial,	///< 直前の結果がなければ待ち、あればそれを返す
+		kWaitAlways,	///< 常に最新の入力の結果を待つ。古いジョブのキャンセルのみ行う
+	};
+
+	std::vector<const MObject *> outputs;	///< 非同期に計算する出力
+	Staleness staleness;					///< 古い結果の扱い。対話モード以外（バッチ、mayapy等）では常にkWaitAlways
+	unsigned int wait_ms;					///< 直前の結果を返す前に、新しい結果を待つ最大時間(ms)
+};
+
+
+/// @brief ノードの登録情報
+///
+/// ノードクラスにstatic constexprメンバkNodeInfoとして定義すると、addNodeはインスタンスを生成せずにこの表から登録します。
+/// 定義しない場合は従来どおり、インスタンスを1つ生成してname_/id_等を読み取ります。
+///
+/// @code
+/// static constexpr mpb::NodeInfo kNodeInfo{ "myNode", 0x70050 };
+/// MyNode(void) : NodeBase(kNodeInfo) {}
+/// @endcode
+///
+struct NodeInfo {
+	const char * name;				///< ノード名
+	unsigned int id;				///< ノードID。他と被らないように指定してください
+	MPxNode::Type type;				///< ノードタイプ
+	const char * classification;	///< カスタムクラシフィケーション。なければnullptr
+
+	constexpr NodeInfo(const char * name, const unsigned int id, const MPxNode::Type type = MPxNode::kDependNode, const char * classification = nullptr) noexcept
+		: name(name), id(id), type(type), classification(classification) {}
+};
+
+
+namespace registry_detail {
+
+/// @brief 登録情報の表kNodeInfoを持つか
+template <class T, class = void> struct HasNodeInfo : std::false_type {};
+template <class T> struct HasNodeInfo<T, decltype(void(T::kNodeInfo))> : std::true_type {};
+
+/// @brief 型ごとの準備関数prepareを持つか
+template <class T, class = void> struct HasPrepare : std::false_type {};
+template <class T> struct HasPrepare<T, decltype(void(&T::prepare))> : std::true_type {};
+
+}
+
+
+/// @brief ノードのベースクラス
+///
+/// ノードを実装するときは、このクラスを継承して定義してください。
+///
+class NodeBase : public MPxNode {
+public:
+
+	const MString name_;			///< ノード名
+
+	const MTypeId id_;				///< ノードID
+
+	const MPxNode::Type type_;		///< ノードタイプ
+
+	const MString classification_;	///< カスタムクラシフィケーション
+	
+	NodeBase(void) = delete;
+
+	/// @brief 引数付きコンストラクタ
+	///
+	/// @param [in] id ノードID。他と被らないように指定してください。
+	/// @param [in] name ノード名
+	/// @param [in] type ノードタイプ。デフォルトのタイプはkDependNode
+	///
+	NodeBase(const MTypeId id, const MString & name, const MPxNode::Type type = MPxNode::Type::kDependNode) noexcept;
+
+
+	/// @brief 引数付きコンストラクタ
+	///
+	/// ノードクラシフィケーションについてはこちらのページを参照してください。
+	/// [http://download.autodesk.com/us/maya/2010help/API/class_m_fn_plugin.html#7df9f8e677ea8c71e33016361109506a]
+	///
+	/// @param [in] id ノードID。他と被らないように指定してください。
+	/// @param [in] name ノード名
+	/// @param [in] classification カスタムクラシフィケーション
+	/// @param [in] type ノードタイプ。デフォルトのタイプはkDependNode
+	///
+	NodeBase(const MTypeId id, const MString & name, const MString & classification, const MPxNode::Type type = MPxNode::Type::kDependNode) noexcept;
+
+
+	/// @brief 登録情報の表から初期化するコンストラクタ
+	///
+	/// @param [in] info 登録情報。継承先のkNodeInfoを指定します
+	///
+	explicit NodeBase(const NodeInfo & info) noexcept;
+
+
+	/// @brief デストラクタ
+	///
+	/// 実行中の非同期計算のジョブをキャンセルします。
+	///
+	virtual ~NodeBase(void);
+
+
+	/// @brief compute関数の独自オーバーライド
+	///
+	/// ノードの計算処理部分のオーバーライド。
+	///
+	/// もしもこの関数を使うのであれば、computeProcess関数を継承先のクラスでオーバーライドすること。
+	/// 主に例外処理に対応する。computeProcess関数にてMStatusExceptionを投げることができ、それをこのcompute関数で受け取り適宜エラー表示する。
+	/// computeProcessの間はノードのScratchArenaをscratch()として設定し、戻った後に巻き戻す。
+	/// ComputeProfilerが有効な場合は、ノードタイプ・プラグごとの処理時間とScratchArenaの最大使用量を記録する。
+	/// asyncSpecの出力の場合、バックグラウンドでの計算時間は「アトリビュート名@async」として別に記録する。
+	///
+	/// @param [in] plug 計算中のプラグ
+	/// @param [in,out] data 編集可能な内部データ
+	/// @retval MStatus::kSuccess 計算に成功した場合
+	/// @retval else 何らかのエラーで失敗した場合
+	/// @sa MPxNode::compute http://download.autodesk.com/us/maya/2011help/api/class_m_px_node.html#3dd5454e3fa92598836018ae9ab220c3
+	///
+	virtual MStatus compute(const MPlug & plug, MDataBlock & data) override;
+
+
+	/// @brief ダーティ伝播時のフック
+	///
+	/// 汚されたプラグのアトリビュートに版番号を振り、inputChangedで参照できるようにします。
+	/// 非同期計算の完了通知でasyncSpecの出力が汚された場合は、入力の変更ではないので版番号を進めません。
+	/// 継承先のクラスでオーバーライドする場合は、必ずNodeBase::setDependentsDirtyを呼び出してください。
+	///
+	/// @param [in] plug_being_dirtied 汚されたプラグ
+	/// @param [in,out] affected_plugs 影響を受けるプラグ
+	/// @return MStatus::kSuccess
+	/// @sa MPxNode::setDependentsDirty
+	///
+	virtual MStatus setDependentsDirty(const MPlug & plug_being_dirtied, MPlugArray & affected_plugs) override;
+
+
+	/// @brief ノード追加定義の関数
+	///
+	/// ***main.cppにて、ユーザーが定義実装する必要があります。***
+	///
+	/// addNode<T>()は、Tがstatic constexprなkNodeInfoを持てばインスタンスを生成せずに登録します。
+	/// Tが静的関数prepare()を持つ場合、参照テーブルの構築等の重い準備はロード中にThreadPoolでバックグラウンド実行し、
+	/// そのノードが最初に生成されるときに完了を待ちます。ワーカースレッドがない環境では、最初の生成時まで実行を遅らせます。
+	/// prepareで例外が投げられた場合、そのノードは生成できなくなります。
+	///
+	/// @retval MStatus::kSuccess すべてのノード追加に成功した場合
+	/// @retval else ノード追加に失敗した場合
+	///
+	static MStatus addNodes(void);
+
+
+	/// @brief (INTERNAL FUNCTION)ノードを削除します
+	///
+	/// 内部関数。ユーザーによって呼び出さないでください。
+	///
+	/// @param [in,out] plugin MFnPluginインスタンス
+	///
+	/// @retval MStatus::kSuccess 削除に成功した場合
+	/// @retval else 削除に失敗した場合
+	///
+	static MStatus removeNodes(MFnPlugin & plugin);
+
+	/// @brief (INTERNAL FUNCTION)MFnPluginのポインタを登録する
+	///
+	/// 内部関数。ユーザーによって呼び出さないでください。
+	///
+	/// @param [in,out] MFnPluginインスタンス
+	///
+	static void _setMFnPluginPtr(MFnPlugin * plugin);
+
+	/// @brief (INTERNAL FUNCTION)すべてのprepareの完了を待ち、記録を破棄する
+	///
+	/// 内部関数。ユーザーによって呼び出さないでください。
+	/// removeNodesと、初期化に失敗したinitializePluginから呼び出されます。
+	///
+	static void _finishPrepares(void);
+
+protected:
+
+	/// @brief 継承先のクラスでオーバーライドすべきcompute関数
+	///
+	/// このクラスで用意した例外対策済のcompute関数を使うならば、このcomputeProcess関数をオーバーライドして使用してください。
+	/// もしも継承先のクラスで、computeもcomputeProcessもオーバーライド定義されていない場合は、問答無用でkUnknowParameterがmayaへ通達されます。
+	/// また、MStatusExceptionの第3引数を省略する場合、compute関数にて自動的にリネームされ、computeProcessと表示される。
+	///
+	/// @param [in] plug 計算中のプラグ
+	/// @param [in,out] data 編集可能な内部データ
+	///
+	virtual void computeProcess(const MPlug & plug, MDataBlock & data);
+
+
+	/// @brief メモ化の対象を取得する
+	///
+	/// 出力が入力だけから決まる（時刻・乱数・シーンの状態・メンバの状態に依存しない）ノードは、この関数をオーバーライドするとメモ化が有効になります。
+	/// computeの前に入力の値をハッシュし、同じノードタイプで同じ入力から計算済みの出力があれば、computeProcessを呼ばずにそれを出力へ設定します。
+	/// ない場合は通常どおりcomputeProcessを呼び出し、成功した出力をMemoCacheへ追加します。
+	/// 数個のリグの状態を行き来する場合などに、2回目以降の再計算が入力のハッシュと出力のコピーだけになります。
+	/// ヒットでも入力の配列はすべて読むため、要素あたり数回の演算で済む計算ではメモ化しない方が速くなります（NodeBenchのmemoArrayScaleとmemoSmoothを参照）。
+	///
+	/// 入力・出力はdescribeAttributeで扱える種類に限ります。扱えないものが含まれる場合は、警告を出してメモ化せずに計算します。
+	/// 配列の要素や複合アトリビュートの子のプラグの再計算要求は、メモ化せずに計算します。
+	///
+	/// @code
+	/// virtual const mpb::MemoSpec * memoSpec(void) const override {
+	///     static const mpb::MemoSpec spec{ { &input_, &scale_ }, { &output_ } };
+	///     return &spec;
+	/// }
+	/// @endcode
+	///
+	/// @return 対象。nullptrの場合はメモ化しない（デフォルト）
+	///
+	virtual const MemoSpec * memoSpec(void) const { return nullptr; }
+
+
+	/// @brief 非同期計算の対象を取得する
+	///
+	/// 1回の計算に数十ms以上かかるノード（ソルバーやメッシュ解析など）は、この関数とcreateAsyncJobをオーバーライドすると、
+	/// 対象の出力の計算がビューポートを止めなくなります。
+	/// computeではcreateAsyncJobで入力を写し取ったジョブをバックグラウンドへ投入し、すぐに直前に完了した結果を出力へ書き込んで戻ります。
+	/// ジョブが完了すると、executeCommandOnIdleでdgdirtyを発行して出力を再評価させ、そのcomputeで新しい結果に入れ替えます。
+	/// 実行中に入力が変わった場合、古いジョブはキャンセルされます。
+	///
+	/// 対象の出力はmemoSpecに含まれていてもメモ化しません。
+	/// 配列の要素や複合アトリビュートの子のプラグの再計算要求は、通常どおり計算します。
+	///
+	/// @code
+	/// virtual const mpb::AsyncSpec * asyncSpec(void) const override {
+	///     static const mpb::AsyncSpec spec{ { &output_ }, mpb::AsyncSpec::kWaitInitial, 0 };
+	///     return &spec;
+	/// }
+	/// @endcode
+	///
+	/// @return 対象。nullptrの場合は同期的に計算する（デフォルト）
+	///
+	virtual const AsyncSpec * asyncSpec(void) const { return nullptr; }
+
+
+	/// @brief 非同期計算のジョブを生成する
+	///
+	/// asyncSpecの出力の再計算要求ごとに、computeのスレッドで呼び出されます。
+	/// runで必要な入力の値はすべてここでジョブへコピーしてください。
+	///
+	/// @param [in] plug 計算中のプラグ
+	/// @param [in,out] data 編集可能な内部データ
+	///
+	/// @return ジョブ
+	///
+	/// @throw MStatusException 何かエラーが発生した場合
+	///
+	virtual std::unique_ptr<AsyncJob> createAsyncJob(const MPlug & plug, MDataBlock & data);
+
+	/// @brief アトリビュートの属性
+	/// @sa mpb::AttributeOptions
+	typedef mpb::AttributeOptions AttributeOptions;
+	
+
+	/// @brief アトリビュートの変更の影響設定を一括で行います。
+	///
+	/// @param [in] when_changes 変更を監視するアトリビュート
+	/// @param [in] is_affect 変更を行うアトリビュート
+	///
+	/// @throws MStatusException アトリビュート属性の指定時に何らかのエラーが発生した場合
+	///
+	static void setMultiAttributeAffects(const std::vector<const MObject *> & when_changes, const std::vector<const MObject *> & is_affect);
+
+
+	/// @brief アトリビュートを追加します。
+	///
+	/// エラーが起きたときの対応を含めた、addAttribute関数のラッパー関数です。
+	///
+	/// @param [in] obj プラグオブジェクト
+	/// @param [in] attr アトリビュート 
+	///
+	/// @throws MStatusException アトリビュートの追加に失敗した場合
+	///
+	static void addAttr(const MObject & obj, const MFnAttribute & attr);
+
+
+	/// @brief Enumアトリビュートの追加のショートカット
+	static void addEnumAttr(MObject & target, const MString & longname, const MString & shortname, const AttributeOptions & options, const std::vector<std::pair<MString, short>> & enums, const short def_value);
+
+	/// @brief Typeアトリビュート追加のショートカット
+	template <class T> static void addUnitAttr(MObject & target, const MString & longname, const MString & shortname, const T & def_value, const AttributeOptions & options);
+
+	/// @brief Numericアトリビュートの追加のショートカット
+	static void addNumericAttr(MObject & target, const MString & longname, const MString & shortname, const AttributeOptions & options, const MFnNumericData::Type & numeric_data = MFnNumericData::Type::kDouble, const double & def_value = 0.0);
+	static void addNumericAttr(MObject & target, const MString & longname, const MString & shortname, const AttributeOptions & options, const MObject & child1, const MObject & child2, const MObject & child3 = MObject::kNullObj);
+
+	/// @brief スキーマの記述子からアトリビュートを追加する
+	///
+	/// SchemaNode::initializeから呼び出されます。
+	///
+	/// @param [out] target 生成したアトリビュート
+	/// @param [in] desc アトリビュートの記述子
+	///
+	/// @throws MStatusException アトリビュートの生成・追加に失敗した場合
+	///
+	static void addSchemaAttr(MObject & target, const AttributeDesc & desc);
+
+
+	/// @brief 入力ハンドルをまとめて解決します
+	///
+	/// compute開始時に一度だけ呼び出し、戻り値をスタックに置いて使用してください。
+	/// 例 : auto in = resolveInputs(data, m_a_, m_b_); double a = in.get<double>(0);
+	///
+	/// @param [in,out] data 内部データ
+	/// @param [in] attrs 入力アトリビュート
+	///
+	/// @throws MStatusException いずれかのハンドルの取得に失敗した場合
+	///
+	template <class ...Attrs> static InputHandles<sizeof...(Attrs)> resolveInputs(MDataBlock & data, const Attrs & ...attrs);
+
+	/// @brief 出力ハンドルをまとめて解決します
+	///
+	/// @param [in,out] data 内部データ
+	/// @param [in] attrs 出力アトリビュート
+	///
+	/// @throws MStatusException いずれかのハンドルの取得に失敗した場合
+	///
+	template <class ...Attrs> static OutputHandles<sizeof...(Attrs)> resolveOutputs(MDataBlock & data, const Attrs & ...attrs);
+
+	/// @brief 配列アトリビュート(multi)の入力を連続バッファへ読み込みます
+	///
+	/// 要素ごとにハンドルを取得します（readArrayを参照）。doubleArray等のデータ型のアトリビュートは、readDoubleArrayData等で一括コピーできます。
+	///
+	/// @param [in,out] data 内部データ
+	/// @param [in] attr 配列アトリビュート
+	/// @param [in,out] buffer 読み込み先。ノードのメンバとして保持し使い回してください
+	///
+	/// @return bufferを指すビュー
+	///
+	/// @throws MStatusException ハンドル・要素の取得に失敗した場合
+	///
+	template <class T> static ConstSpan<T> readInputArray(MDataBlock & data, const MObject & attr, std::vector<T> & buffer);
+
+	/// @brief 配列アトリビュートの出力へ一括で書き込み、cleanにします
+	///
+	/// @param [in,out] data 内部データ
+	/// @param [in] attr 配列アトリビュート
+	/// @param [in] values 書き込む値
+	///
+	/// @throws MStatusException ハンドルの取得・ビルダーの操作に失敗した場合
+	///
+	template <class T> static void writeOutputArray(MDataBlock & data, const MObject & attr, const ConstSpan<T> & values);
+
+
+	/// @brief pointArray型アトリビュートの入力をSoAバッファへ読み込みます
+	///
+	/// SIMDカーネルへ渡すため、成分ごとの64バイト境界の配列へ変換します。Tにfloatを指定すると単精度へ丸めます。
+	/// bufferはノードのメンバとして保持してください。要素数が変わらなければ確保は発生せず、rangeの要素だけが変換し直されます。
+	///
+	/// 変換はpointArrayの全要素を読み書きするため、メモリ帯域で律速されます。平行移動のように要素あたり数回の演算しかないカーネルでは、
+	/// 変換のコストが上回り、MPointArrayのままループするより速くはなりません（NodeBenchのpointTransform）。
+	/// SoAにする価値があるのは、複数の変形の合成や距離・減衰の計算など、要素あたりの演算が多いカーネルか、rangeで変換を一部に絞れる場合です。
+	///
+	/// @code
+	/// mpb::SoaBuffer3<float> points_;	// メンバ
+	/// ...
+	/// readInputPoints(data, input_, this->points_, range);
+	/// mpb::simd::transformPoints(m, points_.x.data(), points_.y.data(), points_.z.data(), points_.x.data(), points_.y.data(), points_.z.data(), points_.size());
+	/// writeOutputPoints(data, output_, this->points_, range);
+	/// @endcode
+	///
+	/// @param [in,out] data 内部データ
+	/// @param [in] attr pointArray型アトリビュート
+	/// @param [in,out] buffer 読み込み先
+	/// @param [in] range 変更された要素範囲
+	///
+	/// @throws MStatusException ハンドル・データの取得に失敗した場合
+	///
+	template <class T> static void readInputPoints(MDataBlock & data, const MObject & attr, SoaBuffer3<T> & buffer, const DirtyRange & range = DirtyRange::all());
+
+	/// @brief SoAバッファをpointArray型アトリビュートの出力へ書き込み、cleanにします
+	///
+	/// 出力に同じ要素数のデータが既にあれば、rangeの要素だけを書き換えます。
+	///
+	/// @param [in,out] data 内部データ
+	/// @param [in] attr pointArray型アトリビュート
+	/// @param [in] values 書き込む値
+	/// @param [in] range 書き込む要素範囲
+	///
+	/// @throws MStatusException ハンドルの取得・データの生成に失敗した場合
+	///
+	template <class T> static void writeOutputPoints(MDataBlock & data, const MObject & attr, const SoaBuffer3<T> & values, const DirtyRange & range = DirtyRange::all());
+
+	/// @brief vectorArray型アトリビュートの入力をSoAバッファへ読み込みます
+	/// @sa readInputPoints
+	template <class T> static void readInputVectors(MDataBlock & data, const MObject & attr, SoaBuffer3<T> & buffer, const DirtyRange & range = DirtyRange::all());
+
+	/// @brief SoAバッファをvectorArray型アトリビュートの出力へ書き込み、cleanにします
+	/// @sa writeOutputPoints
+	template <class T> static void writeOutputVectors(MDataBlock & data, const MObject & attr, const SoaBuffer3<T> & values, const DirtyRange & range = DirtyRange::all());
+
+	/// @brief doubleArray型アトリビュートの入力を64バイト境界のバッファへ読み込みます
+	/// @sa readInputPoints
+	template <class T> static void readInputScalars(MDataBlock & data, const MObject & attr, AlignedBuffer<T> & buffer, const DirtyRange & range = DirtyRange::all());
+
+	/// @brief 64バイト境界のバッファをdoubleArray型アトリビュートの出力へ書き込み、cleanにします
+	/// @sa writeOutputPoints
+	template <class T> static void writeOutputScalars(MDataBlock & data, const MObject & attr, const AlignedBuffer<T> & values, const DirtyRange & range = DirtyRange::all());
+
+
+	/// @brief 前回この出力を計算してから、入力が変更されたか
+	///
+	/// 入力ごとの版番号と、出力ごとに前回computeProcessが成功した時点の版番号を比べます。
+	/// 変更のない入力から導いた中間結果はメンバに保持して再利用し、変更のあった部分だけを計算し直してください。
+	/// まだ一度も計算に成功していない出力や、computeProcessが例外で終わった出力に対しては、常にtrueを返します。
+	///
+	/// @param [in] plug 再計算要求のプラグ。配列要素の場合は配列アトリビュート単位で扱います
+	/// @param [in] input 入力アトリビュート
+	/// @return 変更されていればtrue
+	///
+	bool inputChanged(const MPlug & plug, const MObject & input) const;
+
+	/// @brief 前回この出力を計算してから、いずれかの入力が変更されたか
+	///
+	/// @param [in] plug 再計算要求のプラグ
+	/// @param [in] inputs 入力アトリビュート
+	/// @return 1つでも変更されていればtrue
+	///
+	bool anyInputChanged(const MPlug & plug, const std::vector<const MObject *> & inputs) const;
+
+
+	/// @brief 範囲カーネルを並列実行します
+	///
+	/// 範囲[0, count)をチャンクに分割し、共有スレッドプールで並列に処理します。すべてのチャンクが終わるまで戻りません。
+	/// computeProcessの中で配列を処理する重いループに使用し、戻った後にdata.setCleanを呼び出してください。
+	/// 要素数がチャンクサイズの2倍に満たない場合や、並列計算が無効の場合は呼び出しスレッドでそのまま実行されます。
+	///
+	/// Maya APIはスレッドセーフではないため、カーネル内ではMDataBlockやMPlugを触らず、事前に取り出した配列のみを扱ってください。
+	///
+	/// @param [in] count 要素数
+	/// @param [in] kernel 範囲[begin, end)を処理する関数
+	/// @param [in] grain_size 1チャンクの最小要素数。0の場合は要素数とスレッド数から自動で決定
+	///
+	/// @throws MStatusException kernel内で投げられた場合は、最初の1つを再送出します
+	///
+	static void parallelFor(const size_t count, const std::function<void(size_t, size_t)> & kernel, const size_t grain_size = 0);
+
+	/// @brief 要素カーネルを並列実行します
+	///
+	/// parallelForの要素単位版です。kernelは要素番号を1つ受け取ります。
+	///
+	template <class F> static void parallelForEach(const size_t count, F && kernel, const size_t grain_size = 0);
+
+
+	/// @brief compute中の一時領域を取得します
+	///
+	/// computeProcessの中ではノードごとのアリーナを、parallelForのカーネルの中ではワーカースレッドごとのアリーナを返します。
+	/// 確保した領域はcompute（カーネルの場合はそのチャンク）が終わると自動で巻き戻されるため、解放は不要です。
+	/// 毎回同程度の量を使う定常状態では、ヒープの確保は発生しません。
+	/// 同じノードのcomputeが別スレッドで同時に、または入れ子で呼ばれた場合は、そのスレッドのアリーナが使われます。
+	///
+	/// 結果を出力へ書き込んだ後まで保持する必要があるものや、compute間で再利用するものはメンバに置いてください。
+	///
+	/// @code
+	/// double * weights = scratchArray<double>(count);
+	/// mpb::ScratchVector<unsigned int> indices = scratchVector<unsigned int>();
+	/// @endcode
+	///
+	static ScratchArena & scratch(void) noexcept { return ScratchArena::current(); }
+
+	/// @brief 一時領域から初期化されない配列を確保します
+	/// @sa scratch
+	template <class T> static T * scratchArray(const size_t count) { return ScratchArena::current().allocateArray<T>(count); }
+
+	/// @brief 一時領域から確保するvectorを生成します
+	/// @sa scratch
+	template <class T> static ScratchVector<T> scratchVector(const size_t count = 0) {
+		return ScratchVector<T>(count, T(), ArenaAllocator<T>(ScratchArena::current()));
+	}
+
+public:
+
+	/// @brief 並列計算の有効・無効を切り替えます
+	///
+	/// 無効にすると、parallelForはすべて呼び出しスレッドでシリアルに実行されます。デバッグや計測の比較用です。
+	///
+	/// @param [in] enabled 有効にするか
+	///
+	static void setParallelComputeEnabled(const bool enabled) noexcept;
+
+	/// @brief 並列計算が有効か
+	static bool isParallelComputeEnabled(void) noexcept;
+
+	/// @brief 非同期計算の有効・無効を切り替えます
+	///
+	/// 無効にすると、asyncSpecの出力もcomputeのスレッドでジョブを実行して結果を待ちます。デバッグや計測の比較用です。
+	///
+	/// @param [in] enabled 有効にするか
+	///
+	static void setAsyncComputeEnabled(const bool enabled) noexcept;
+
+	/// @brief 非同期計算が有効か
+	static bool isAsyncComputeEnabled(void) noexcept;
+
+
+private:
+	
+	const bool own_classification_;
+
+	/// @brief アトリビュートと版番号の組
+	struct AttributeStamp {
+		MObject attribute;
+		uint64_t version;
+	};
+
+	uint64_t dirty_version_;						///< ダーティ伝播ごとに進むノード内の版番号
+	std::vector<AttributeStamp> input_versions_;	///< 入力が最後に汚された版番号
+	std::vector<AttributeStamp> output_versions_;	///< 出力が最後に計算された時点の版番号
+	mutable std::mutex versions_mutex_;
+
+	ScratchArena scratch_arena_;					///< computeProcess中の一時領域
+	std::atomic<bool> scratch_in_use_;				///< scratch_arena_を使用中のスレッドがあるか
+
+	std::atomic<ErrorBucket *> error_hint_;			///< 前回の例外の集計先。同じ例外が続く場合は集計表を引かずに数える
+
+	std::once_flag memo_once_;
+	MemoCache * memo_cache_;						///< メモ化できない場合はnullptr
+	std::vector<HandleLayout> memo_inputs_;			///< memoSpec().inputsの値の表現
+	std::vector<HandleLayout> memo_outputs_;		///< memoSpec().outputsの値の表現
+
+	struct AsyncTask;
+
+	/// @brief 出力ごとの非同期計算の状態。表示中の結果と計算中のジョブの二重バッファ
+	struct AsyncSlot {
+		MObject attribute;
+		std::shared_ptr<AsyncTask> front;	///< 完了済みで出力へ書き込む結果
+		std::shared_ptr<AsyncTask> back;	///< 計算中のジョブ
+		uint64_t failed_version;			///< 最後に失敗した入力の版番号
+		MStatus failure;					///< その失敗の内容
+	};
+
+	std::vector<AsyncSlot> async_slots_;
+	std::mutex async_mutex_;
+
+	/// @brief asyncSpecの出力であればジョブを投入して直前の結果を書き込み、それ以外はcomputeMemoizedで計算する
+	MStatus computeAsync(const MPlug & plug, MDataBlock & data);
+
+	/// @brief 完了したbackをfrontへ移す。async_mutex_をロックして呼び出す
+	static void collectAsync(AsyncSlot & slot);
+
+	/// @brief computeProcessを呼び出し、例外をMStatusに変換する
+	MStatus computeGuarded(const MPlug & plug, MDataBlock & data);
+
+	/// @brief memoSpecがあればMemoCacheを引き、なければ計算してcomputeGuardedの結果を追加する
+	MStatus computeMemoized(const MPlug & plug, MDataBlock & data);
+
+	/// @brief メモ化の準備。扱えない入力・出力があればmemo_cache_をnullptrのままにする
+	void prepareMemo(const MemoSpec & spec);
+
+	/// @brief 入力の値と出力番号からキーを求める
+	Hash128 memoKey(MDataBlock & data, const MemoSpec & spec, const size_t output) const;
+
+	/// @brief 組の一覧からアトリビュートを探す。見つからなければnullptr
+	static const AttributeStamp * findStamp(const std::vector<AttributeStamp> & stamps, const MObject & attribute) noexcept;
+
+	/// @brief 組の一覧のアトリビュートの版番号を更新する。なければ追加する
+	static void setStamp(std::vector<AttributeStamp> & stamps, const MObject & attribute, const uint64_t version);
+	
+	/// @brief 登録済みのノード。removeNodesで解除する
+	struct Registered {
+		MString name;
+		MTypeId id;
+	};
+
+	/// @brief prepareの実行先。ノード型ごとに1つ
+	template <class T> struct PrepareSlot { static size_t index; };
+
+	typedef void * (*Creator)(void);
+
+	static MFnPlugin * plugin_;
+	static std::vector<Registered> registered_;
+	static std::atomic<bool> parallel_enabled_;
+	static std::atomic<bool> async_enabled_;
+
+	template <class _INHERIT_FROM_NODEBASE> static void addNode(void);
+	template <class _INHERIT_FROM_NODEBASE, class ...Args> static void addNode(Args... args);
+	template <class _INHERIT_FROM_NODEBASE> static void addNodeFromInfo(std::true_type);
+	template <class _INHERIT_FROM_NODEBASE> static void addNodeFromInfo(std::false_type);
+	template <class _INHERIT_FROM_NODEBASE> static Creator creatorOf(const MString & name, std::true_type);
+	template <class _INHERIT_FROM_NODEBASE> static Creator creatorOf(const MString & name, std::false_type);
+	template <class _INHERIT_FROM_NODEBASE> static void * createPrepared(void);
+	static void _addNode(void * (*creator)(), MStatus(*initialize)(), const MString & name, const MTypeId & id, const MPxNode::Type type, const MString * classification);
+
+	/// @brief prepareをバックグラウンドで開始し、完了待ちの番号を返す
+	static size_t _submitPrepare(const MString & name, void(*prepare)());
+
+	/// @brief prepareの完了を待つ。失敗していればfalse
+	static bool _waitPrepare(const size_t index);
+
+};
+
+
+template <class T> size_t NodeBase::PrepareSlot<T>::index = 0;
+
+template<class _INHERIT_FROM_NODEBASE>
+inline void NodeBase::addNode(void) {
+	NodeBase::addNodeFromInfo<_INHERIT_FROM_NODEBASE>(registry_detail::HasNodeInfo<_INHERIT_FROM_NODEBASE>());
+}
+template<class _INHERIT_FROM_NODEBASE, class ...Args>
+inline void NodeBase::addNode(Args ...args) {
+	const std::unique_ptr<NodeBase> node = std::make_unique<_INHERIT_FROM_NODEBASE>(args...);
+	NodeBase::_addNode(NodeBase::creatorOf<_INHERIT_FROM_NODEBASE>(node->name_, registry_detail::HasPrepare<_INHERIT_FROM_NODEBASE>()), &_INHERIT_FROM_NODEBASE::initialize,
+		node->name_, node->id_, node->type_, (node->own_classification_ ? &node->classification_ : nullptr));
+}
+template<class _INHERIT_FROM_NODEBASE>
+inline void NodeBase::addNodeFromInfo(std::true_type) {
+	const NodeInfo & info = _INHERIT_FROM_NODEBASE::kNodeInfo;
+	const MString name(info.name);
+	const MString classification(info.classification != nullptr ? info.classification : "");
+	NodeBase::_addNode(NodeBase::creatorOf<_INHERIT_FROM_NODEBASE>(name, registry_detail::HasPrepare<_INHERIT_FROM_NODEBASE>()), &_INHERIT_FROM_NODEBASE::initialize,
+		name, MTypeId(info.id), info.type, (info.classification != nullptr ? &classification : nullptr));
+}
+template<class _INHERIT_FROM_NODEBASE>
+inline void NodeBase::addNodeFromInfo(std::false_type) {
+	// 登録情報の表がない場合は、インスタンスから読み取ってすぐに破棄する
+	const std::unique_ptr<NodeBase> node = std::make_unique<_INHERIT_FROM_NODEBASE>();
+	NodeBase::_addNode(NodeBase::creatorOf<_INHERIT_FROM_NODEBASE>(node->name_, registry_detail::HasPrepare<_INHERIT_FROM_NODEBASE>()), &_INHERIT_FROM_NODEBASE::initialize,
+		node->name_, node->id_, node->type_, (node->own_classification_ ? &node->classification_ : nullptr));
+}
+template<class _INHERIT_FROM_NODEBASE>
+inline NodeBase::Creator NodeBase::creatorOf(const MString &, std::false_type) {
+	return &_INHERIT_FROM_NODEBASE::create;
+}
+template<class _INHERIT_FROM_NODEBASE>
+inline NodeBase::Creator NodeBase::creatorOf(const MString & name, std::true_type) {
+	PrepareSlot<_INHERIT_FROM_NODEBASE>::index = NodeBase::_submitPrepare(name, &_INHERIT_FROM_NODEBASE::prepare);
+	return &NodeBase::createPrepared<_INHERIT_FROM_NODEBASE>;
+}
+template<class _INHERIT_FROM_NODEBASE>
+inline void * NodeBase::createPrepared(void) {
+	if (!NodeBase::_waitPrepare(PrepareSlot<_INHERIT_FROM_NODEBASE>::index)) return nullptr;
+	return _INHERIT_FROM_NODEBASE::create();
+}
+template<class ...Attrs>
+inline InputHandles<sizeof...(Attrs)> NodeBase::resolveInputs(MDataBlock & data, const Attrs & ...attrs) {
+	return InputHandles<sizeof...(Attrs)>(data, {{ &attrs... }});
+}
+template<class ...Attrs>
+inline OutputHandles<sizeof...(Attrs)> NodeBase::resolveOutputs(MDataBlock & data, const Attrs & ...attrs) {
+	return OutputHandles<sizeof...(Attrs)>(data, {{ &attrs... }});
+}
+template<class T>
+inline ConstSpan<T> NodeBase::readInputArray(MDataBlock & data, const MObject & attr, std::vector<T> & buffer) {
+	MStatus stat;
+	MArrayDataHandle handle = data.inputArrayValue(attr, &stat);
+	MStatusException::throwIf(stat, "入力配列データハンドルの取得に失敗", "mpb::NodeBase::readInputArray");
+	return readArray(handle, buffer);
+}
+template<class T>
+inline void NodeBase::writeOutputArray(MDataBlock & data, const MObject & attr, const ConstSpan<T> & values) {
+	MStatus stat;
+	MArrayDataHandle handle = data.outputArrayValue(attr, &stat);
+	MStatusException::throwIf(stat, "出力配列データハンドルの取得に失敗", "mpb::NodeBase::writeOutputArray");
+	writeArray(handle, values);
+}
+template<class T>
+inline void NodeBase::readInputPoints(MDataBlock & data, const MObject & attr, SoaBuffer3<T> & buffer, const DirtyRange & range) {
+	MStatus stat;
+	MDataHandle handle = data.inputValue(attr, &stat);
+	MStatusException::throwIf(stat, "入力データハンドルの取得に失敗", "mpb::NodeBase::readInputPoints");
+	readPointArrayData(handle, buffer, range);
+}
+template<class T>
+inline void NodeBase::writeOutputPoints(MDataBlock & data, const MObject & attr, const SoaBuffer3<T> & values, const DirtyRange & range) {
+	MStatus stat;
+	MDataHandle handle = data.outputValue(attr, &stat);
+	MStatusException::throwIf(stat, "出力データハンドルの取得に失敗", "mpb::NodeBase::writeOutputPoints");
+	writePointArrayData(handle, values, range);
+}
+template<class T>
+inline void NodeBase::readInputVectors(MDataBlock & data, const MObject & attr, SoaBuffer3<T> & buffer, const DirtyRange & range) {
+	MStatus stat;
+	MDataHandle handle = data.inputValue(attr, &stat);
+	MStatusException::throwIf(stat, "入力データハンドルの取得に失敗", "mpb::NodeBase::readInputVectors");
+	readVectorArrayData(handle, buffer, range);
+}
+template<class T>
+inline void NodeBase::writeOutputVectors(MDataBlock & data, const MObject & attr, const SoaBuffer3<T> & values, const DirtyRange & range) {
+	MStatus stat;
+	MDataHandle handle = data.outputValue(attr, &stat);
+	MStatusException::throwIf(stat, "出力データハンドルの取得に失敗", "mpb::NodeBase::writeOutputVectors");
+	writeVectorArrayData(handle, values, range);
+}
+template<class T>
+inline void NodeBase::readInputScalars(MDataBlock & data, const MObject & attr, AlignedBuffer<T> & buffer, const DirtyRange & range) {
+	MStatus stat;
+	MDataHandle handle = data.inputValue(attr, &stat);
+	MStatusException::throwIf(stat, "入力データハンドルの取得に失敗", "mpb::NodeBase::readInputScalars");
+	readDoubleArrayData(handle, buffer, range);
+}
+template<class T>
+inline void NodeBase::writeOutputScalars(MDataBlock & data, const MObject & attr, const AlignedBuffer<T> & values, const DirtyRange & range) {
+	MStatus stat;
+	MDataHandle handle = data.outputValue(attr, &stat);
+	MStatusException::throwIf(stat, "出力データハンドルの取得に失敗", "mpb::NodeBase::writeOutputScalars");
+	writeDoubleArrayData(handle, values, range);
+}
+template<class F>
+inline void NodeBase::parallelForEach(const size_t count, F && kernel, const size_t grain_size) {
+	NodeBase::parallelFor(count, [&kernel](size_t begin, size_t end) {
+		for (size_t i = begin; i < end; ++i) kernel(i);
+	}, grain_size);
+}
+
+// end of CommandBase
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_COMMAND_BASE_HPP_
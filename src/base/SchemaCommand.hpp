@@ -0,0 +1,135 @@
+﻿/// @file SchemaCommand.hpp
+/// @brief SchemaCommandクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_SCHEMA_COMMAND_HPP_
+#define _MAYA_PLUGIN_BASE_SCHEMA_COMMAND_HPP_
+
+#include "base/CommandBase.hpp"
+#include "base/CommandSchema.hpp"
+#include "util/Logger.hpp"
+#include <maya/MArgList.h>
+#include <type_traits>
+
+namespace mpb {
+
+/// @brief スキーマのI番目のフラグの値の型
+///
+/// SchemaCommand<Derived>の継承時点ではDerivedが不完全型のため、フラグ番号が決まってから参照されるこのクラスから引きます。
+///
+template <class Derived, size_t I>
+struct SchemaFlagValue : FlagValue<Derived::kSchema.flags[I].kind, Derived::kSchema.flags[I].arity == 1> {
+	static_assert(I < std::remove_const<decltype(Derived::kSchema)>::type::kNumFlags, "flag index out of range");
+};
+
+
+/// @brief 引数スキーマ宣言型コマンドのベースクラス
+///
+/// 継承先のクラスで、以下のように引数スキーマkSchemaを定義すると、doItで引数を解析してからdoItParsedを呼び出します。
+/// 不明なフラグ・値の不足や型の不一致はdoItParsedの前にMStatusExceptionとして検出され、エラー表示の上で失敗を返します。
+/// 配列のフラグの値は、一時的なMDoubleArrayへのappendを介さずにフラグごとのバッファへ直接読み込みます。
+/// APIから渡された配列は一度に取り出せますが、MELの形（要素数に続けて要素）は要素が個別の引数のため、
+/// MArgListを要素ごとに読む必要があり、解析時間は手書きの解析と大きくは変わりません。
+///
+/// @code
+/// class MyCommand : public mpb::SchemaCommand<MyCommand> {
+/// public:
+///     enum : size_t { kWeights, kPoint, kVerbose };
+///     static constexpr mpb::CommandSchema<3> kSchema{
+///         { {
+///             mpb::doubleArrayFlag("weights", "w"),
+///             mpb::doubleFlag("point", "p", 0.0, 3, true),	// -p x y z を複数回
+///             mpb::switchFlag("verbose", "v"),
+///         } },
+///         1, 1	// オブジェクト名を1つ
+///     };
+///     ...
+///     virtual MStatus doItParsed(const mpb::CommandArgs & args) override {
+///         mpb::ConstSpan<double> weights = flagValue<kWeights>();	// 連続領域
+///         mpb::ConstSpan<double> points = args.doubles(kPoint);	// xyzxyz...
+///         if (flagValue<kVerbose>()) ...
+///     }
+/// };
+/// // C++14ではODR使用のため、cpp側に定義が必要です
+/// constexpr mpb::CommandSchema<3> MyCommand::kSchema;
+/// @endcode
+///
+/// 短い名前・長い名前の重複と、値の数の不正はコンパイルエラーになります。
+/// 解析結果はredoIt等からもparsedArgs()で参照できます。
+///
+/// @tparam Derived 継承先のクラス(CRTP)
+///
+template <class Derived>
+class SchemaCommand : public CommandBase {
+public:
+
+	/// @brief コンストラクタ
+	///
+	/// @param [in] command コマンド文字列
+	/// @param [in] is_undoable UNDOできるか
+	///
+	SchemaCommand(const MString & command, const bool is_undoable) noexcept
+		: CommandBase(command, is_undoable), args_(Derived::kSchema) {}
+
+	/// @brief デストラクタ
+	virtual ~SchemaCommand(void) {}
+
+
+	/// @brief 引数をkSchemaに従って解析し、doItParsedを呼び出します
+	virtual MStatus doIt(const MArgList & args) override final;
+
+protected:
+
+	/// @brief 実行関数
+	///
+	/// doItの代わりにオーバーライドして定義します。
+	///
+	/// @param [in] args 解析済みの引数
+	///
+	/// @return コマンドの実行結果
+	///
+	virtual MStatus doItParsed(const CommandArgs & args) = 0;
+
+
+	/// @brief 解析済みの引数
+	const CommandArgs & parsedArgs(void) const noexcept { return this->args_; }
+
+
+	/// @brief I番目のフラグの値を型付きで取得する
+	///
+	/// 型はFlagValueで決まります。指定されていない場合は既定値（配列等は空）を返します。
+	///
+	/// @param [in] use 何回目の指定か
+	///
+	/// @throws MStatusException 指定回数が範囲外の場合
+	///
+	template <size_t I> typename SchemaFlagValue<Derived, I>::type flagValue(const unsigned int use = 0) const {
+		return SchemaFlagValue<Derived, I>::get(this->args_, I, use);
+	}
+
+private:
+
+	CommandArgs args_;
+
+};
+
+
+template <class Derived>
+MStatus SchemaCommand<Derived>::doIt(const MArgList & args) {
+	static_assert(!Derived::kSchema.hasDuplicateShortName(), "command schema has duplicate short names");
+	static_assert(!Derived::kSchema.hasDuplicateLongName(), "command schema has duplicate long names");
+	static_assert(!Derived::kSchema.hasInvalidArity(), "command schema has a flag with an invalid number of values");
+
+	try {
+		this->args_.parse(args);
+	}
+	catch (const MStatusException & e) {
+		MPB_LOG_ERROR("%s", e.toString("COMMAND : " + this->command_).asChar());
+		displayError(e.message);
+		return e.stat;
+	}
+	return this->doItParsed(this->args_);
+}
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_SCHEMA_COMMAND_HPP_
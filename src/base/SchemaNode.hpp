@@ -0,0 +1,180 @@
+﻿/// @file SchemaNode.hpp
+/// @brief SchemaNodeクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_SCHEMA_NODE_HPP_
+#define _MAYA_PLUGIN_BASE_SCHEMA_NODE_HPP_
+
+#include "base/NodeBase.hpp"
+#include "base/AttributeSchema.hpp"
+#include "util/Logger.hpp"
+#include <maya/MDataBlock.h>
+#include <maya/MPlug.h>
+#include <array>
+#include <vector>
+#include <type_traits>
+
+namespace mpb {
+
+/// @brief スキーマから生成したアトリビュートのMObjectの格納先
+///
+/// SchemaNode<Derived>の継承時点ではDerivedが不完全型のため、スキーマの型は関数内で初めて参照されるこのクラスから引きます。
+///
+template <class Derived>
+struct SchemaStorage {
+	typedef typename std::remove_const<decltype(Derived::kSchema)>::type Schema;
+	static std::array<MObject, Schema::kNumAttributes> objects;
+};
+
+template <class Derived>
+std::array<MObject, SchemaStorage<Derived>::Schema::kNumAttributes> SchemaStorage<Derived>::objects;
+
+
+/// @brief スキーマのI番目のアトリビュートの値の型
+template <class Derived, size_t I>
+struct SchemaValue : AttributeValue<Derived::kSchema.attributes[I].kind, Derived::kSchema.attributes[I].numeric_type> {
+	static_assert(I < SchemaStorage<Derived>::Schema::kNumAttributes, "attribute index out of range");
+};
+
+
+/// @brief スキーマ宣言型ノードのベースクラス
+///
+/// 継承先のクラスで、以下のようにアトリビュートスキーマkSchemaを定義すると、initialize関数が自動で生成されます。
+/// アトリビュートは番号でアクセスし、MObjectは静的配列に格納されるため、compute中の参照は定数オフセットの読み込みになります。
+///
+/// @code
+/// class MyNode : public mpb::SchemaNode<MyNode> {
+/// public:
+///     enum : size_t { kInput, kOutput };
+///     static constexpr mpb::AttributeSchema<2, 1> kSchema{
+///         { { mpb::numericAttribute("input", "i"), mpb::numericAttribute("output", "o", MFnNumericData::kDouble, 0.0, mpb::AttributeOptions(true, false, true, false, false)) } },
+///         { { mpb::affects(kInput, kOutput) } }
+///     };
+///     ...
+///     virtual void computeProcess(const MPlug & plug, MDataBlock & data) override {
+///         if (!isPlug<kOutput>(plug)) throw mpb::MStatusException(MStatus::kInvalidParameter, "予期しないプラグの再計算要求");
+///         setOutputValue<kOutput>(data, inputValue<kInput>(data) * 2.0);
+///     }
+/// };
+/// // C++14ではODR使用のため、cpp側に定義が必要です
+/// constexpr mpb::AttributeSchema<2, 1> MyNode::kSchema;
+/// @endcode
+///
+/// 短い名前・長い名前の重複と、存在しないアトリビュートを指す影響関係はコンパイルエラーになります。
+/// 影響先となるアトリビュートには、setMultiAttributeAffectsと同様にstateからの影響も自動で設定されます。
+///
+/// @tparam Derived 継承先のクラス(CRTP)
+///
+template <class Derived>
+class SchemaNode : public NodeBase {
+public:
+
+	using NodeBase::NodeBase;
+
+
+	/// @brief 初期化関数
+	///
+	/// Derived::kSchemaから、アトリビュートの生成・追加と影響関係の設定を行います。
+	/// addNodeに渡すinitialize関数として使用されます。
+	///
+	/// @retval MStatus::kSuccess 成功
+	/// @retval else 失敗
+	///
+	static MStatus initialize(void);
+
+protected:
+
+	/// @brief アトリビュートのMObjectを取得する
+	///
+	/// @tparam I スキーマ内のアトリビュート番号
+	///
+	template <size_t I> static const MObject & attribute(void) noexcept {
+		static_assert(I < SchemaStorage<Derived>::Schema::kNumAttributes, "attribute index out of range");
+		return SchemaStorage<Derived>::objects[I];
+	}
+
+
+	/// @brief 再計算要求のプラグが指定のアトリビュートか
+	template <size_t I> static bool isPlug(const MPlug & plug) {
+		return (plug == attribute<I>());
+	}
+
+
+	using NodeBase::inputChanged;
+
+	/// @brief 前回この出力を計算してから、I番目の入力が変更されたか
+	/// @sa NodeBase::inputChanged
+	template <size_t I> bool inputChanged(const MPlug & plug) const {
+		return NodeBase::inputChanged(plug, attribute<I>());
+	}
+
+
+	/// @brief 入力値を型付きで取得する
+	///
+	/// @param [in,out] data 内部データ
+	///
+	/// @throws MStatusException データハンドルの取得に失敗した場合
+	///
+	template <size_t I> static typename SchemaValue<Derived, I>::type inputValue(MDataBlock & data) {
+		MStatus stat;
+		MDataHandle handle = data.inputValue(attribute<I>(), &stat);
+		MStatusException::throwIf(stat, "入力データハンドルの取得に失敗", Derived::kSchema.attributes[I].longname);
+		return SchemaValue<Derived, I>::get(handle);
+	}
+
+
+	/// @brief 出力値を型付きで設定し、cleanにする
+	///
+	/// @param [in,out] data 内部データ
+	/// @param [in] value 設定する値
+	///
+	/// @throws MStatusException データハンドルの取得に失敗した場合
+	///
+	template <size_t I> static void setOutputValue(MDataBlock & data, const typename SchemaValue<Derived, I>::type & value) {
+		MStatus stat;
+		MDataHandle handle = data.outputValue(attribute<I>(), &stat);
+		MStatusException::throwIf(stat, "出力データハンドルの取得に失敗", Derived::kSchema.attributes[I].longname);
+		SchemaValue<Derived, I>::set(handle, value);
+		handle.setClean();
+	}
+
+};
+
+
+template <class Derived>
+MStatus SchemaNode<Derived>::initialize(void) {
+	static_assert(!Derived::kSchema.hasDuplicateShortName(), "attribute schema has duplicate short names");
+	static_assert(!Derived::kSchema.hasDuplicateLongName(), "attribute schema has duplicate long names");
+	static_assert(!Derived::kSchema.hasDanglingAffects(), "attribute schema has affects referring to an unknown attribute");
+
+	typedef typename SchemaStorage<Derived>::Schema Schema;
+	const Schema & schema = Derived::kSchema;
+	auto & objects = SchemaStorage<Derived>::objects;
+	try {
+		for (size_t i = 0; i < Schema::kNumAttributes; ++i) {
+			NodeBase::addSchemaAttr(objects[i], schema.attributes[i]);
+		}
+
+		for (size_t e = 0; e < Schema::kNumAffects; ++e) {
+			const AttributeAffects & edge = schema.affects[e];
+			MStatusException::throwIf(attributeAffects(objects[edge.when_changes], objects[edge.is_affect]), [&schema, &edge] {
+				return MString("アトリビュートの影響設定に失敗 : ") + schema.attributes[edge.when_changes].longname + " -> " + schema.attributes[edge.is_affect].longname;
+			});
+		}
+
+		for (size_t i = 0; i < Schema::kNumAttributes; ++i) {
+			if (!schema.isAffected(i)) continue;
+			MStatusException::throwIf(attributeAffects(state, objects[i]), [&schema, i] {
+				return MString("アトリビュートの影響設定に失敗 : state -> ") + schema.attributes[i].longname;
+			});
+		}
+	}
+	catch (const MStatusException & e) {
+		MPB_LOG_ERROR("%s", e.toString("SchemaNode::initialize").asChar());
+		return e.stat;
+	}
+	return MStatus::kSuccess;
+}
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_SCHEMA_NODE_HPP_
@@ -1,17 +1,94 @@
 ﻿#include "TranslatorBase.hpp"
+#include "util/Logger.hpp"
 
-std::vector<std::unique_ptr<mpb::TranslatorBase>> mpb::TranslatorBase::instances_;
+std::vector<MString> mpb::TranslatorBase::registered_;
 
 
 mpb::TranslatorBase::TranslatorBase(const MString & name, const MString & file_extension, const bool can_import, const bool can_export, const MString & options_script_name, const MString & default_options_string, const MString & pixmap_name) noexcept
-	: name_(name), file_extension_(file_extension), can_import_(can_import), can_export_(can_export_),
+	: name_(name), can_import_(can_import), can_export_(can_export), file_extension_(file_extension),
 	pixmap_name_(pixmap_name), options_script_name_(options_script_name), default_options_string_(default_options_string)
 {}
+mpb::TranslatorBase::TranslatorBase(const TranslatorInfo & info) noexcept
+	: TranslatorBase(info.name, info.file_extension, info.can_import, info.can_export, info.options_script_name, info.default_options_string, info.pixmap_name)
+{}
 mpb::TranslatorBase::~TranslatorBase(void){}
 MStatus mpb::TranslatorBase::writer(const MFileObject & file, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
-{ return MStatus::kNotImplemented; }
+{
+	MStatus ret;
+	try {
+		if (this->writeMode() == WriteMode::kIncremental) {
+			// 既存のファイルに追記するため、上書きで開くChunkedOutputStreamは使わない
+			const IncrementalOptions options = this->incrementalOptions(options_string);
+			IncrementalExporter exporter(file.resolvedFullName(), this->parallelSections() ? &ThreadPool::global() : nullptr, options.incremental);
+			this->exportIncremental(exporter, options_string, mode);
+			exporter.finish();
+			const IncrementalExporter::Stats & stats = exporter.stats();
+			MPB_LOG_INFO("TRANSLATOR : %s : %u written, %u reused, %u removed, %llu bytes appended", this->name_.asChar(),
+				static_cast<unsigned>(stats.written), static_cast<unsigned>(stats.reused), static_cast<unsigned>(stats.removed), static_cast<unsigned long long>(stats.written_bytes));
+			if (options.compact) IncrementalExporter::compact(file.resolvedFullName());
+			return ret;
+		}
+
+		ChunkedOutputStream out(file.resolvedFullName(), this->streamChunkSize(), this->streamQueueDepth());
+		if (this->writeMode() == WriteMode::kSections) {
+			SectionExporter exporter(out, this->parallelSections() ? &ThreadPool::global() : nullptr);
+			this->exportSections(exporter, options_string, mode);
+			exporter.finish();
+		}
+		else if (this->writeMode() == WriteMode::kBlocks) {
+			BlockOutputStream blocks(out, this->blockCodecOptions(options_string), this->parallelSections() ? &ThreadPool::global() : nullptr);
+			this->writeBlocks(blocks, options_string, mode);
+			blocks.finish();
+		}
+		else {
+			this->writerProcess(out, options_string, mode);
+		}
+		out.close();
+	}
+	catch (const MStatusException & e) {
+		MPB_LOG_ERROR("%s", e.toString("TRANSLATOR : " + this->name_).asChar());
+		ret = e;
+	}
+	return ret;
+}
 MStatus mpb::TranslatorBase::reader(const MFileObject & file, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
-{ return MStatus::kNotImplemented; }
+{
+	MStatus ret;
+	try {
+		if (this->readMode() == ReadMode::kMapped) {
+			MappedFile mapped(file.resolvedFullName(), this->mappedAccess());
+			this->mappedReaderProcess(mapped, options_string, mode);
+		}
+		else if (this->readMode() == ReadMode::kBlocks) {
+			MappedFile mapped(file.resolvedFullName(), this->mappedAccess());
+			BlockInputStream blocks(mapped.bytes(), this->parallelSections() ? &ThreadPool::global() : nullptr);
+			this->readBlocks(blocks, options_string, mode);
+		}
+		else {
+			ChunkedInputStream in(file.resolvedFullName(), this->streamChunkSize(), this->streamQueueDepth());
+			this->readerProcess(in, options_string, mode);
+		}
+	}
+	catch (const MStatusException & e) {
+		MPB_LOG_ERROR("%s", e.toString("TRANSLATOR : " + this->name_).asChar());
+		ret = e;
+	}
+	return ret;
+}
+void mpb::TranslatorBase::writerProcess(ChunkedOutputStream & out, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
+{ MStatusException::throwError(MStatus::kNotImplemented, "writerProcess関数が定義されていません", "mpb::TranslatorBase::writerProcess<default>"); }
+void mpb::TranslatorBase::exportSections(SectionExporter & exporter, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
+{ MStatusException::throwError(MStatus::kNotImplemented, "exportSections関数が定義されていません", "mpb::TranslatorBase::exportSections<default>"); }
+void mpb::TranslatorBase::readerProcess(ChunkedInputStream & in, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
+{ MStatusException::throwError(MStatus::kNotImplemented, "readerProcess関数が定義されていません", "mpb::TranslatorBase::readerProcess<default>"); }
+void mpb::TranslatorBase::mappedReaderProcess(MappedFile & file, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
+{ MStatusException::throwError(MStatus::kNotImplemented, "mappedReaderProcess関数が定義されていません", "mpb::TranslatorBase::mappedReaderProcess<default>"); }
+void mpb::TranslatorBase::writeBlocks(BlockOutputStream & out, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
+{ MStatusException::throwError(MStatus::kNotImplemented, "writeBlocks関数が定義されていません", "mpb::TranslatorBase::writeBlocks<default>"); }
+void mpb::TranslatorBase::exportIncremental(IncrementalExporter & exporter, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
+{ MStatusException::throwError(MStatus::kNotImplemented, "exportIncremental関数が定義されていません", "mpb::TranslatorBase::exportIncremental<default>"); }
+void mpb::TranslatorBase::readBlocks(BlockInputStream & in, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
+{ MStatusException::throwError(MStatus::kNotImplemented, "readBlocks関数が定義されていません", "mpb::TranslatorBase::readBlocks<default>"); }
 bool mpb::TranslatorBase::haveWriteMethod() const { return this->can_export_;}
 bool mpb::TranslatorBase::haveReadMethod() const { return this->can_import_; }
 MString mpb::TranslatorBase::defaultExtension() const { return this->file_extension_; }
@@ -9,15 +9,55 @@
 */
 
 #include "exception/MStatusException.hpp"
+#include "io/BlockStream.hpp"
+#include "io/ChunkedStream.hpp"
+#include "io/IncrementalExporter.hpp"
+#include "io/MappedFile.hpp"
+#include "io/SectionExporter.hpp"
 #include <maya/MPxFileTranslator.h>
 #include <maya/MString.h>
 #include <vector>
 #include <memory>
+#include <type_traits>
 
 class MFnPlugin;
 
 namespace mpb {
 
+/// @brief トランスレーターの登録情報
+///
+/// トランスレータークラスにstatic constexprメンバkTranslatorInfoとして定義すると、addTranslatorはインスタンスを生成せずにこの表から登録します。
+///
+/// @code
+/// static constexpr mpb::TranslatorInfo kTranslatorInfo{ "myFormat", "myf", true, true };
+/// MyTranslator(void) : TranslatorBase(kTranslatorInfo) {}
+/// @endcode
+///
+struct TranslatorInfo {
+	const char * name;						///< トランスレーター名
+	const char * file_extension;			///< 扱うファイルの拡張子
+	bool can_import;						///< インポート可能か
+	bool can_export;						///< エクスポート可能か
+	const char * options_script_name;		///< オプションのMELスクリプト名。なければ""
+	const char * default_options_string;	///< 既定のオプション文字列。なければ""
+	const char * pixmap_name;				///< アイコン名。なければ""
+
+	constexpr TranslatorInfo(const char * name, const char * file_extension, const bool can_import, const bool can_export,
+		const char * options_script_name = "", const char * default_options_string = "", const char * pixmap_name = "") noexcept
+		: name(name), file_extension(file_extension), can_import(can_import), can_export(can_export),
+		options_script_name(options_script_name), default_options_string(default_options_string), pixmap_name(pixmap_name) {}
+};
+
+
+namespace registry_detail {
+
+/// @brief 登録情報の表kTranslatorInfoを持つか
+template <class T, class = void> struct HasTranslatorInfo : std::false_type {};
+template <class T> struct HasTranslatorInfo<T, decltype(void(T::kTranslatorInfo))> : std::true_type {};
+
+}
+
+
 /// @brief ノードのベースクラス
 ///
 /// ノードを実装するときは、このクラスを継承して定義してください。
@@ -48,6 +88,13 @@ public:
 		const MString & pixmap_name = "") noexcept;
 
 
+	/// @brief 登録情報の表から初期化するコンストラクタ
+	///
+	/// @param [in] info 登録情報。継承先のkTranslatorInfoを指定します
+	///
+	explicit TranslatorBase(const TranslatorInfo & info) noexcept;
+
+
 
 	/// @brief デストラクタ
 	///
@@ -58,6 +105,11 @@ public:
 
 	/// @brief 書き込み処理関数
 	///
+	/// ファイルをChunkedOutputStreamで開き、writeModeがkStreamの場合はwriterProcessを、kSectionsの場合はSectionExporterを作成してexportSectionsを、
+	/// kBlocksの場合はBlockOutputStreamを作成してwriteBlocksを、kIncrementalの場合はIncrementalExporterを作成してexportIncrementalを呼び出します。
+	/// それらで投げられたMStatusExceptionはここで受け取り、エラー表示します。
+	/// ストリームを使わない場合は、この関数を直接オーバーライドしてください。
+	///
 	/// @param [in] file ファイルに関する情報
 	/// @param [in] options_string オプション指定文字列
 	/// @param [in] mode アクセスモード
@@ -65,7 +117,12 @@ public:
 	virtual MStatus writer(const MFileObject & file, const MString & options_string, MPxFileTranslator::FileAccessMode mode) override;
 	
 
-	/// @brief 書き込み処理関数
+	/// @brief 読み込み処理関数
+	///
+	/// readModeがkStreamの場合はファイルをChunkedInputStreamで開いてreaderProcessを、kMappedの場合はMappedFileで割り当ててmappedReaderProcessを、
+	/// kBlocksの場合は割り当てたファイルからBlockInputStreamを作成してreadBlocksを呼び出します。
+	/// それらで投げられたMStatusExceptionはここで受け取り、エラー表示します。
+	/// ストリームを使わない場合は、この関数を直接オーバーライドしてください。
 	///
 	/// @param [in] file ファイルに関する情報
 	/// @param [in] options_string オプション指定文字列
@@ -103,10 +160,12 @@ public:
 	///
 	/// ***main.cppにて、ユーザーが定義実装する必要があります。***
 	///
+	/// addTranslator<T>()は、Tがstatic constexprなkTranslatorInfoを持てばインスタンスを生成せずに登録します。
+	///
 	/// @retval MStatus::kSuccess すべてのトランスレーター追加に成功した場合
 	/// @retval else トランスレーター追加に失敗した場合
 	///
-	static MStatus addTranslators(void) throw(mpb::MStatusException);
+	static MStatus addTranslators(void);
 
 
 	/// @brief (INTERNAL FUNCTION)トランスレーターを削除します
@@ -130,6 +189,215 @@ public:
 
 protected:
 
+	/// @brief 継承先のクラスでオーバーライドすべき書き込み処理関数
+	///
+	/// データはoutへ書き込んでください。バッファが一杯になると、バックグラウンドスレッドで書き込まれます。
+	/// 戻った後にストリームは閉じられ、書き込みエラーがあればreaderと同様に報告されます。
+	/// デフォルトではkNotImplementedを投げます。
+	///
+	/// @param [in,out] out 出力ストリーム
+	/// @param [in] options_string オプション指定文字列
+	/// @param [in] mode アクセスモード
+	///
+	/// @throws MStatusException 何かエラーが発生した場合
+	///
+	virtual void writerProcess(ChunkedOutputStream & out, const MString & options_string, MPxFileTranslator::FileAccessMode mode);
+
+
+	/// @brief 継承先のクラスでオーバーライドすべき読み込み処理関数
+	///
+	/// inはバックグラウンドスレッドで先読みされます。レコード単位で読む場合は、RecordStreamを使うとパースも別スレッドで行えます。
+	/// デフォルトではkNotImplementedを投げます。
+	///
+	/// @param [in,out] in 入力ストリーム
+	/// @param [in] options_string オプション指定文字列
+	/// @param [in] mode アクセスモード
+	///
+	/// @throws MStatusException 何かエラーが発生した場合
+	///
+	virtual void readerProcess(ChunkedInputStream & in, const MString & options_string, MPxFileTranslator::FileAccessMode mode);
+
+
+	/// @brief 継承先のクラスでオーバーライドすべき、メモリマップによる読み込み処理関数
+	///
+	/// readModeでkMappedを返す場合に呼び出されます。file.bytes()はファイル全体を指し、コピーは作られません。
+	/// 値の読み出しはByteSpan::readAsやByteReaderを使うと、範囲チェック・バイト順の変換・アラインメントの考慮が行われます。
+	/// デフォルトではkNotImplementedを投げます。
+	///
+	/// @param [in,out] file 割り当て済みのファイル
+	/// @param [in] options_string オプション指定文字列
+	/// @param [in] mode アクセスモード
+	///
+	/// @throws MStatusException 何かエラーが発生した場合
+	///
+	virtual void mappedReaderProcess(MappedFile & file, const MString & options_string, MPxFileTranslator::FileAccessMode mode);
+
+
+	/// @brief 継承先のクラスでオーバーライドすべき、セクション単位の書き込み処理関数
+	///
+	/// writeModeでkSectionsを返す場合に呼び出されます。
+	/// オブジェクトやフレームなど、互いに独立した単位ごとに、メインスレッドでデータを取り出してからexporter.addでエンコード関数を渡してください。
+	/// エンコードはワーカースレッドで並列に行われ、addした順にファイルへ書き込まれます。戻った後にセクション表とフッターが書き込まれます。
+	/// デフォルトではkNotImplementedを投げます。
+	///
+	/// @code
+	/// virtual void exportSections(mpb::SectionExporter & exporter, const MString & options_string, MPxFileTranslator::FileAccessMode mode) override {
+	///     for (MItDag it(MItDag::kDepthFirst, MFn::kMesh); !it.isDone(); it.next()) {
+	///         MFloatPointArray points;
+	///         MFnMesh(it.currentItem()).getPoints(points);		// Maya APIはメインスレッドで呼ぶ
+	///         std::vector<float> xyz = ...;
+	///         exporter.add(kMeshTag, [xyz = std::move(xyz)](mpb::SectionBuffer & buf) {
+	///             buf.writeValue<uint32_t>(static_cast<uint32_t>(xyz.size()));
+	///             buf.writeArray(xyz.data(), xyz.size());
+	///         });
+	///     }
+	/// }
+	/// @endcode
+	///
+	/// @param [in,out] exporter セクションの出力先
+	/// @param [in] options_string オプション指定文字列
+	/// @param [in] mode アクセスモード
+	///
+	/// @throws MStatusException 何かエラーが発生した場合
+	///
+	virtual void exportSections(SectionExporter & exporter, const MString & options_string, MPxFileTranslator::FileAccessMode mode);
+
+
+	/// @brief 継承先のクラスでオーバーライドすべき、ブロック圧縮による書き込み処理関数
+	///
+	/// writeModeでkBlocksを返す場合に呼び出されます。outへの書き込みは固定サイズのブロックに区切られ、ワーカースレッドで並列に圧縮されます。
+	/// 圧縮方式はblockCodecOptionsで決まります。戻った後に残りのブロックとセクション表が書き込まれます。
+	/// デフォルトではkNotImplementedを投げます。
+	///
+	/// @param [in,out] out 出力ストリーム
+	/// @param [in] options_string オプション指定文字列
+	/// @param [in] mode アクセスモード
+	///
+	/// @throws MStatusException 何かエラーが発生した場合
+	///
+	virtual void writeBlocks(BlockOutputStream & out, const MString & options_string, MPxFileTranslator::FileAccessMode mode);
+
+
+	/// @brief 継承先のクラスでオーバーライドすべき、差分エクスポートによる書き込み処理関数
+	///
+	/// writeModeでkIncrementalを返す場合に呼び出されます。オブジェクトごとに、キーと内容のハッシュを付けてセクションを追加してください。
+	/// 前回から変わっていないオブジェクトはエンコードも書き込みもされず、変わったものだけがファイルの末尾に追記されます。
+	/// 出力はSectionExporterの形式なので、読み込み側はkSectionsと同じくSectionIndexで読めます。
+	/// デフォルトではkNotImplementedを投げます。
+	///
+	/// @code
+	/// virtual void exportIncremental(mpb::IncrementalExporter & exporter, const MString & options_string, MPxFileTranslator::FileAccessMode mode) override {
+	///     for (MItDag it(MItDag::kDepthFirst, MFn::kMesh); !it.isDone(); it.next()) {
+	///         MDagPath path;
+	///         it.getPath(path);
+	///         MFloatPointArray points;
+	///         MFnMesh(path).getPoints(points);
+	///         std::vector<float> xyz = ...;
+	///         mpb::FastHasher hasher;
+	///         hasher.update(xyz.data(), xyz.size() * sizeof(float));
+	///         exporter.add(path.fullPathName(), kMeshTag, hasher.digest(), [xyz = std::move(xyz)](mpb::SectionBuffer & buf) {
+	///             buf.writeArray(xyz.data(), xyz.size());
+	///         });
+	///     }
+	/// }
+	/// @endcode
+	///
+	/// @param [in,out] exporter セクションの出力先
+	/// @param [in] options_string オプション指定文字列
+	/// @param [in] mode アクセスモード
+	///
+	/// @throws MStatusException 何かエラーが発生した場合
+	///
+	virtual void exportIncremental(IncrementalExporter & exporter, const MString & options_string, MPxFileTranslator::FileAccessMode mode);
+
+
+	/// @brief 継承先のクラスでオーバーライドすべき、ブロック圧縮されたファイルの読み込み処理関数
+	///
+	/// readModeでkBlocksを返す場合に呼び出されます。圧縮方式はブロックごとにファイルに記録されているので、オプションは不要です。
+	/// 順次読み込みでは先のブロックがワーカースレッドで並列に展開されます。in.readAtで任意の位置も読めます。
+	/// デフォルトではkNotImplementedを投げます。
+	///
+	/// @param [in,out] in 入力ストリーム
+	/// @param [in] options_string オプション指定文字列
+	/// @param [in] mode アクセスモード
+	///
+	/// @throws MStatusException 何かエラーが発生した場合
+	///
+	virtual void readBlocks(BlockInputStream & in, const MString & options_string, MPxFileTranslator::FileAccessMode mode);
+
+
+	/// @brief 書き込みの方式
+	enum class WriteMode {
+		kStream,	///< ChunkedOutputStreamへ直接書き込む(writerProcess)
+		kSections,	///< セクション単位で並列にエンコードする(exportSections)
+		kBlocks,	///< 固定サイズのブロックごとに並列に圧縮する(writeBlocks)
+		kIncremental,	///< 変わったセクションだけを追記する(exportIncremental)
+	};
+
+	/// @brief 書き込みの方式を取得する
+	///
+	/// デフォルトではkStreamです。
+	///
+	virtual WriteMode writeMode(void) const { return WriteMode::kStream; }
+
+	/// @brief セクションを並列にエンコードするか
+	///
+	/// falseの場合は呼び出しスレッドで直列にエンコードします。どちらでも出力は同一です。
+	/// kBlocksのブロックの圧縮・展開にも適用されます。
+	///
+	virtual bool parallelSections(void) const { return true; }
+
+	/// @brief ブロック圧縮の設定を取得する
+	///
+	/// デフォルトではオプション文字列の "codec=none|fast|high;shuffle=要素サイズ;blockSize=バイト数" を読みます（BlockCodecOptions::parse）。
+	/// 浮動小数点の配列が主な形式では、既定値にshuffle=4を指定するとよく縮みます。
+	///
+	/// @code
+	/// virtual mpb::BlockCodecOptions blockCodecOptions(const MString & options_string) const override {
+	///     return mpb::BlockCodecOptions::parse(options_string, mpb::BlockCodecOptions(mpb::BlockCodecType::kFast, 4));
+	/// }
+	/// @endcode
+	///
+	/// @throws MStatusException オプションの値が不正な場合
+	///
+	virtual BlockCodecOptions blockCodecOptions(const MString & options_string) const { return BlockCodecOptions::parse(options_string); }
+
+	/// @brief 差分エクスポートの設定を取得する
+	///
+	/// デフォルトではオプション文字列の "incremental=0|1;compact=0|1" を読みます（IncrementalOptions::parse）。
+	/// incremental=0で全体を書き直し、compact=1で書き出した後に不要になったセクションを取り除きます。
+	///
+	/// @throws MStatusException オプションの値が不正な場合
+	///
+	virtual IncrementalOptions incrementalOptions(const MString & options_string) const { return IncrementalOptions::parse(options_string); }
+
+
+	/// @brief 読み込みの方式
+	enum class ReadMode {
+		kStream,	///< ChunkedInputStreamで読み込む(readerProcess)
+		kMapped,	///< メモリマップで読み込む(mappedReaderProcess)
+		kBlocks,	///< ブロック圧縮されたファイルをメモリマップで読み込む(readBlocks)
+	};
+
+	/// @brief 読み込みの方式を取得する
+	///
+	/// デフォルトではkStreamです。大きなバイナリ形式を扱う場合はkMappedを返すようオーバーライドしてください。
+	///
+	virtual ReadMode readMode(void) const { return ReadMode::kStream; }
+
+	/// @brief メモリマップで読み込む場合のアクセスパターンのヒント
+	virtual MappedFile::Access mappedAccess(void) const { return MappedFile::Access::kSequential; }
+
+
+	/// @brief ストリームのチャンクサイズ
+	///
+	/// 読み書きのメモリ使用量は、おおよそ streamChunkSize() * (streamQueueDepth() + 1) です。
+	///
+	virtual size_t streamChunkSize(void) const { return ChunkedInputStream::kDefaultChunkSize; }
+
+	/// @brief ストリームの先読み・書き込み待ちチャンク数
+	virtual size_t streamQueueDepth(void) const { return ChunkedInputStream::kDefaultQueueDepth; }
+
 
 private:
 	const bool can_import_;			///< インポート可能か
@@ -141,22 +409,36 @@ private:
 	
 		
 	static MFnPlugin * plugin_;
-	static std::vector<std::unique_ptr<TranslatorBase>> instances_;
+	static std::vector<MString> registered_;	///< 登録済みのトランスレーター名。removeTranslatorsで解除する
 
 	template <class _INHERIT_FROM_TRANSLATORBASE> static void addTranslator(void);
 	template <class _INHERIT_FROM_TRANSLATORBASE, class ...Args> static void addTranslator(Args... args);
-	static void _addTranslator(void * (*creator)(), std::unique_ptr<TranslatorBase> && translator);
+	template <class _INHERIT_FROM_TRANSLATORBASE> static void addTranslatorFromInfo(std::true_type);
+	template <class _INHERIT_FROM_TRANSLATORBASE> static void addTranslatorFromInfo(std::false_type);
+	static void _addTranslator(void * (*creator)(), const MString & name, const MString & pixmap_name, const MString & options_script_name, const MString & default_options_string);
 
 };
 
 
 template<class _INHERIT_FROM_TRANSLATORBASE>
 inline void TranslatorBase::addTranslator(void) {
-	TranslatorBase::_addTranslator(&_INHERIT_FROM_TRANSLATORBASE::create, std::make_unique<_INHERIT_FROM_TRANSLATORBASE>());
+	TranslatorBase::addTranslatorFromInfo<_INHERIT_FROM_TRANSLATORBASE>(registry_detail::HasTranslatorInfo<_INHERIT_FROM_TRANSLATORBASE>());
 }
 template<class _INHERIT_FROM_TRANSLATORBASE, class ...Args>
 inline void TranslatorBase::addTranslator(Args ...args) {
-	TranslatorBase::_addTranslator(&_INHERIT_FROM_TRANSLATORBASE::create, std::make_unique<_INHERIT_FROM_TRANSLATORBASE>(args));
+	const std::unique_ptr<TranslatorBase> translator = std::make_unique<_INHERIT_FROM_TRANSLATORBASE>(args...);
+	TranslatorBase::_addTranslator(&_INHERIT_FROM_TRANSLATORBASE::create, translator->name_, translator->pixmap_name_, translator->options_script_name_, translator->default_options_string_);
+}
+template<class _INHERIT_FROM_TRANSLATORBASE>
+inline void TranslatorBase::addTranslatorFromInfo(std::true_type) {
+	const TranslatorInfo & info = _INHERIT_FROM_TRANSLATORBASE::kTranslatorInfo;
+	TranslatorBase::_addTranslator(&_INHERIT_FROM_TRANSLATORBASE::create, MString(info.name), MString(info.pixmap_name), MString(info.options_script_name), MString(info.default_options_string));
+}
+template<class _INHERIT_FROM_TRANSLATORBASE>
+inline void TranslatorBase::addTranslatorFromInfo(std::false_type) {
+	// 登録情報の表がない場合は、インスタンスから読み取ってすぐに破棄する
+	const std::unique_ptr<TranslatorBase> translator = std::make_unique<_INHERIT_FROM_TRANSLATORBASE>();
+	TranslatorBase::_addTranslator(&_INHERIT_FROM_TRANSLATORBASE::create, translator->name_, translator->pixmap_name_, translator->options_script_name_, translator->default_options_string_);
 }
 
 // end of CommandBase
@@ -0,0 +1,52 @@
+﻿#include "ComputeProfilerCommand.hpp"
+#include "util/ComputeProfiler.hpp"
+#include "util/ErrorAggregator.hpp"
+#include "util/MemoCache.hpp"
+
+const char mpb::ComputeProfilerCommand::kCommandName[] = "mpbComputeProfiler";
+
+constexpr mpb::CommandSchema<5> mpb::ComputeProfilerCommand::kSchema;
+
+mpb::ComputeProfilerCommand::ComputeProfilerCommand(void) noexcept
+	: SchemaCommand(kCommandName, false) {}
+
+mpb::ComputeProfilerCommand::~ComputeProfilerCommand(void) {}
+
+void * mpb::ComputeProfilerCommand::create(void) { return new ComputeProfilerCommand; }
+
+MStatus mpb::ComputeProfilerCommand::doItParsed(const CommandArgs & args)
+{
+	const bool json = this->flagValue<kJson>();
+	const bool reset = this->flagValue<kReset>();
+
+	if (args.isSet(kEnable)) ComputeProfiler::setEnabled(this->flagValue<kEnable>());
+
+	if (this->flagValue<kMemo>()) {
+		if (!reset || json) {
+			const auto stats = MemoCache::snapshot();
+			const std::string result = (json ? MemoCache::toJson(stats) : MemoCache::toText(stats));
+			setResult(MString(result.c_str()));
+		}
+		if (reset) MemoCache::clearAll();
+		return MStatus::kSuccess;
+	}
+
+	if (this->flagValue<kErrors>()) {
+		if (!reset || json) {
+			const auto entries = ErrorAggregator::snapshot();
+			const std::string result = (json ? ErrorAggregator::toJson(entries) : ErrorAggregator::toText(entries));
+			setResult(MString(result.c_str()));
+		}
+		if (reset) ErrorAggregator::reset();
+		return MStatus::kSuccess;
+	}
+
+	// フラグなし、または-json指定時に集計を返す
+	if ((!args.isSet(kEnable) && !reset) || json) {
+		const auto entries = ComputeProfiler::snapshot();
+		const std::string result = (json ? ComputeProfiler::toJson(entries) : ComputeProfiler::toText(entries));
+		setResult(MString(result.c_str()));
+	}
+	if (reset) ComputeProfiler::reset();
+	return MStatus::kSuccess;
+}
@@ -0,0 +1,81 @@
+﻿/// @file ComputeProfilerCommand.hpp
+/// @brief ComputeProfilerCommandクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_COMPUTE_PROFILER_COMMAND_HPP_
+#define _MAYA_PLUGIN_BASE_COMPUTE_PROFILER_COMMAND_HPP_
+
+#include "base/SchemaCommand.hpp"
+
+namespace mpb {
+
+/// @brief compute計測器の操作コマンド
+///
+/// プラグインに組み込みで登録されます。
+///
+/// @code
+/// mpbComputeProfiler -enable 1;	// 計測開始
+/// mpbComputeProfiler;				// 表形式で取得
+/// mpbComputeProfiler -json;		// JSONで取得
+/// mpbComputeProfiler -reset;		// 集計をリセット
+/// mpbComputeProfiler -enable 0;	// 計測停止
+/// mpbComputeProfiler -memo;		// メモ化キャッシュの統計を取得
+/// mpbComputeProfiler -memo -reset;	// メモ化キャッシュを破棄
+/// mpbComputeProfiler -errors;		// computeの例外の集計を取得
+/// mpbComputeProfiler -errors -reset;	// 例外の集計をリセット
+/// @endcode
+///
+/// -json/-resetを同時に指定した場合は、取得してからリセットします。-memoを指定した場合は、計測結果の代わりにMemoCacheが対象になります。
+/// -errorsを指定した場合はErrorAggregatorが対象になり、計測の有効・無効にかかわらず集計されています。
+///
+class ComputeProfilerCommand : public SchemaCommand<ComputeProfilerCommand> {
+public:
+
+	static const char kCommandName[];	///< コマンド名
+
+	/// @brief フラグ番号
+	enum : size_t {
+		kEnable,
+		kJson,
+		kReset,
+		kMemo,
+		kErrors,
+	};
+
+	/// @brief 引数スキーマ
+	static constexpr CommandSchema<5> kSchema{
+		{ {
+			boolFlag("enable", "e"),
+			switchFlag("json", "j"),
+			switchFlag("reset", "r"),
+			switchFlag("memo", "m"),
+			switchFlag("errors", "er"),
+		} },
+		0, 0
+	};
+
+	/// @brief コンストラクタ
+	ComputeProfilerCommand(void) noexcept;
+
+	/// @brief デストラクタ
+	virtual ~ComputeProfilerCommand(void);
+
+	/// @brief インスタンス生成関数
+	static void * create(void);
+
+protected:
+
+	/// @brief 実行関数
+	///
+	/// 不明なフラグが指定された場合は、呼び出される前にMStatus::kInvalidParameterで失敗します。
+	///
+	/// @param [in] args 解析済みの引数
+	///
+	/// @retval MStatus::kSuccess 成功
+	///
+	virtual MStatus doItParsed(const CommandArgs & args) override;
+
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_COMPUTE_PROFILER_COMMAND_HPP_
@@ -1,20 +1,26 @@
 ﻿#include "MStatusException.hpp"
 #include <string.h>
 
+const char mpb::MStatusException::kUnlogged[] = "<unlogged>";
+
 mpb::MStatusException::MStatusException(const MStatus & stat, const MString & message, const MString & place)
 	: stat(stat), message(message), place(place)
 {}
 
 mpb::MStatusException::~MStatusException() {}
 
+bool mpb::MStatusException::isLogged(void) const noexcept {
+	return strcmp(this->place.asChar(), kUnlogged) != 0;
+}
+
 MString mpb::MStatusException::toString(void) const {
-	return this->toString(place);
+	return this->toString(this->place);
 }
 
 MString mpb::MStatusException::toString(const MString & place_override) const
 {
 	//FORMAT | [STAT] PLACE : MESSAGE
-	MString stat_str("UNKNOWN");
+	const char * stat_str = "UNKNOWN";
 	switch (stat.statusCode()) {
 	case MStatus::MStatusCode::kEndOfFile: stat_str = "EndOfFile"; break;
 	case MStatus::MStatusCode::kFailure: stat_str = "Failure"; break;
@@ -27,7 +33,7 @@ MString mpb::MStatusException::toString(const MString & place_override) const
 	case MStatus::MStatusCode::kUnknownParameter: stat_str = "UnknownParameter"; break;
 	}
 
-	return MString("[" + stat_str + "] " + (place == "<unlogged>" ? place_override : place) + " : " + message + "(" + stat.errorString() + ")");
+	return MString("[") + stat_str + "] " + (this->isLogged() ? this->place : place_override) + " : " + this->message + "(" + stat.errorString() + ")";
 }
 
 mpb::MStatusException::operator MStatus() const
@@ -45,11 +51,15 @@ bool mpb::MStatusException::operator==(const MStatus & comp) const
 	return (this->stat == comp);
 }
 
-void mpb::MStatusException::throwIf(const MStatus & stat, const MString & message, const MString & place) {
-	if (stat.error()) throw MStatusException(stat, message, place);
+void mpb::MStatusException::throwError(const MStatus & stat, const char * message, const char * place) {
+	throw MStatusException(stat, MString(message ? message : ""), MString(place ? place : kUnlogged));
+}
+
+void mpb::MStatusException::throwError(const MStatus & stat, const MString & message, const char * place) {
+	throw MStatusException(stat, message, MString(place ? place : kUnlogged));
 }
 
-std::ostream & mpb::operator<<(ostream & os, const MStatusException & e)
+std::ostream & mpb::operator<<(std::ostream & os, const MStatusException & e)
 {
 	os << e.toString();
 	return os;
@@ -8,9 +8,19 @@
 #define MAYA_PLUGIN_BASE_MSTATUSEXCEPTION_HPP_
 
 #include <iostream>
+#include <type_traits>
+#include <utility>
 #include <maya/MString.h>
 #include <maya/MStatus.h>
 
+/// @brief 発生箇所を「ファイル名(行番号)」のコンパイル時文字列にするマクロ
+#define MPB_EXCEPTION_STRINGIFY_(x) #x
+#define MPB_EXCEPTION_STRINGIFY(x) MPB_EXCEPTION_STRINGIFY_(x)
+#define MPB_EXCEPTION_PLACE __FILE__ "(" MPB_EXCEPTION_STRINGIFY(__LINE__) ")"
+
+/// @brief 発生箇所を自動で埋めるthrowIfのショートカット
+#define MPB_THROW_IF(stat, message) ::mpb::MStatusException::throwIf((stat), (message), MPB_EXCEPTION_PLACE)
+
 namespace mpb {
 
 /// @brief MStatusを例外処理として処理しやすくするクラス
@@ -19,27 +29,37 @@ namespace mpb {
 ///
 /// OpenMaya C++ APIのMStatus型に、例外処理を加えたもの。MStatus型のエラーを例外として処理し、煩雑なif文を書かなくて済む。
 /// また、この関数を使用し例外を発生させる場合は、必ずキャッチし、そのエラー結果をエラー出力へ表示すること。
+///
+/// 成功時のコストを無くすため、throwIfは文字列のポインタを受け取るだけで、MStringの生成は失敗して例外を送出するときまで行わない。
+/// 例外はメッセージと発生箇所をMStringへコピーして保持するため、一時的な文字列（MString::asChar等）を渡しても構わない。
+/// 実行時に組み立てるメッセージは、文字列を返す関数オブジェクトとしてthrowIfに渡すと、失敗した場合にのみ呼び出される。
+///
 class MStatusException{
 public:
 
 	const MStatus stat;		///< MStatus本体
 	const MString message;	///< エラーメッセージ
-	const MString place;	///< エラーの発生場所。書き方に決まりはないが、推奨はエラーが発生した時に実行中の関数名。
-	
+	const MString place;	///< エラーの発生場所。書き方に決まりはないが、推奨はエラーが発生した時に実行中の関数名かMPB_EXCEPTION_PLACE。
+
+	static const char kUnlogged[];	///< 発生箇所が指定されていないことを表す文字列
+
 	/// @brief コンストラクタ
-	/// 
+	///
 	/// エラーのステータスとメッセージを登録できる。また、placeは任意に指定でき、（必ず指定することが好ましいが）指定しない場合はunloggedと表示される。
 	/// また、unloggedの場合、toString関数において上書きが可能である。
 	/// @param stat エラーのステータス
 	/// @param message メッセージ
 	/// @param place 発生個所を特定できる文字列
-	MStatusException(const MStatus & stat, const MString & message, const MString & place = "<unlogged>");
+	MStatusException(const MStatus & stat, const MString & message, const MString & place = kUnlogged);
 
 	/// デストラクタ
 	virtual ~MStatusException();
 
+	/// @brief 発生場所が指定されているか
+	bool isLogged(void) const noexcept;
+
 	/// @brief 指定フォーマットに成形されたエラーメッセージを取得する。
-	/// 
+	///
 	/// @return エラーメッセージ
 	MString toString(void) const;
 
@@ -69,16 +89,53 @@ public:
 	/// @param os ストリーム
 	/// @param e 例外
 	/// @return 出力後のストリーム
-	friend std::ostream & operator<<(ostream & os, const MStatusException & e);
+	friend std::ostream & operator<<(std::ostream & os, const MStatusException & e);
 
 	/// @brief if内包例外スローユーティリティー関数
 	///
 	/// もしもステータスがkSuccess以外の時に、MStatusExceptionをスローするユーティリティー関数
+	/// 成功時は分岐1つのみで、文字列は一切生成されない。messageとplaceは失敗時にコピーされる。
+	/// @param stat エラーのステータス
+	/// @param message メッセージ
+	/// @param place 発生個所を特定できる文字列
+	/// @throws MStatusException ステータスがkSuccess以外だった場合
+	static void throwIf(const MStatus & stat, const char * message, const char * place = kUnlogged) {
+		if (stat.error()) throwError(stat, message, place);
+	}
+
+	/// @brief if内包例外スローユーティリティー関数
+	///
+	/// 組み立て済みのメッセージを渡す版。メッセージの生成コストが成功時にもかかるため、可能であれば関数オブジェクト版を使うこと。
 	/// @param stat エラーのステータス
 	/// @param message メッセージ
 	/// @param place 発生個所を特定できる文字列
 	/// @throws MStatusException ステータスがkSuccess以外だった場合
-	static void throwIf(const MStatus & stat, const MString & message, const MString & place = "<unlogged>");
+	static void throwIf(const MStatus & stat, const MString & message, const char * place = kUnlogged) {
+		if (stat.error()) throwError(stat, message, place);
+	}
+
+	/// @brief if内包例外スローユーティリティー関数
+	///
+	/// メッセージを遅延生成する版。message_builderはMStringに変換できる値を返す関数オブジェクトで、失敗時にのみ呼び出される。
+	/// 例 : throwIf(stat, [&]{ return attr.name() + "の追加に失敗"; });
+	/// @param stat エラーのステータス
+	/// @param message_builder メッセージを生成する関数オブジェクト
+	/// @param place 発生個所を特定できる文字列
+	/// @throws MStatusException ステータスがkSuccess以外だった場合
+	template <class MessageBuilder, class = decltype(MString(std::declval<MessageBuilder &>()()))>
+	static void throwIf(const MStatus & stat, MessageBuilder && message_builder, const char * place = kUnlogged) {
+		if (stat.error()) throwError(stat, MString(message_builder()), place);
+	}
+
+	/// @brief 例外を送出する
+	///
+	/// throwIfの失敗側の処理。インライン展開されないよう、実体は翻訳単位側にある。
+	/// @throws MStatusException 必ず送出する
+	[[noreturn]] static void throwError(const MStatus & stat, const char * message, const char * place = kUnlogged);
+
+	/// @brief 例外を送出する
+	/// @throws MStatusException 必ず送出する
+	[[noreturn]] static void throwError(const MStatus & stat, const MString & message, const char * place = kUnlogged);
 
 protected:
 
@@ -87,6 +144,8 @@ private:
 
 };
 
+std::ostream & operator<<(std::ostream & os, const MStatusException & e);
+
 };
 
 #endif //end of include guard
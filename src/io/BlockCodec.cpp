@@ -0,0 +1,407 @@
+﻿#include "BlockCodec.hpp"
+#include "exception/MStatusException.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+constexpr uint32_t mpb::BlockCodecOptions::kDefaultBlockSize;
+constexpr uint32_t mpb::BlockCodecOptions::kMinBlockSize;
+constexpr uint32_t mpb::BlockCodecOptions::kMaxBlockSize;
+
+namespace {
+
+constexpr size_t kMinMatch = 4;				///< 一致の最小長
+constexpr size_t kLastLiterals = 5;			///< 末尾のこのバイト数は必ずリテラルにする
+constexpr size_t kMatchFindLimit = 12;		///< 末尾からこのバイト数の範囲では一致を探し始めない
+constexpr size_t kMaxDistance = 65535;		///< 一致の距離の上限
+constexpr int kFastHashLog = 14;
+constexpr int kHighHashLog = 16;
+constexpr size_t kHighMaxAttempts = 64;		///< kHighで1か所あたりに調べる候補の数
+constexpr size_t kFastSkipShift = 6;		///< kFastで一致しない状態が2^この回数続くごとに探す間隔を広げる
+
+uint32_t read32(const uint8_t * p) noexcept { uint32_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+uint64_t read64(const uint8_t * p) noexcept { uint64_t v; std::memcpy(&v, p, sizeof(v)); return v; }
+
+uint32_t hashOf(const uint32_t v, const int log) noexcept { return (v * 2654435761u) >> (32 - log); }
+
+/// aとbが一致するバイト数。a_limitを越えない
+size_t countMatch(const uint8_t * a, const uint8_t * b, const uint8_t * a_limit) noexcept
+{
+	const uint8_t * const start = a;
+	while (a + 8 <= a_limit) {
+		if (read64(a) != read64(b)) {
+			while (*a == *b) { ++a; ++b; }
+			return static_cast<size_t>(a - start);
+		}
+		a += 8;
+		b += 8;
+	}
+	while (a < a_limit && *a == *b) { ++a; ++b; }
+	return static_cast<size_t>(a - start);
+}
+
+uint8_t * writeLength(uint8_t * op, size_t length) noexcept
+{
+	while (length >= 255) {
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = static_cast<uint8_t>(length);
+	return op;
+}
+
+/// シーケンスを1つ書き込む。match_lengthが0の場合はリテラルのみ
+uint8_t * writeSequence(uint8_t * op, const uint8_t * literals, const size_t literal_length, const size_t distance, const size_t match_length) noexcept
+{
+	uint8_t * const token = op++;
+	uint8_t t = static_cast<uint8_t>(std::min<size_t>(literal_length, 15) << 4);
+	if (literal_length >= 15) op = writeLength(op, literal_length - 15);
+	std::memcpy(op, literals, literal_length);
+	op += literal_length;
+	if (match_length > 0) {
+		*op++ = static_cast<uint8_t>(distance & 0xFF);
+		*op++ = static_cast<uint8_t>(distance >> 8);
+		const size_t extra = match_length - kMinMatch;
+		t |= static_cast<uint8_t>(std::min<size_t>(extra, 15));
+		if (extra >= 15) op = writeLength(op, extra - 15);
+	}
+	*token = t;
+	return op;
+}
+
+size_t compressFast(const uint8_t * src, const size_t size, uint8_t * dest)
+{
+	uint8_t * op = dest;
+	size_t anchor = 0;
+	if (size > kMatchFindLimit) {
+		// 位置+1を入れる。0は空
+		thread_local std::vector<uint32_t> table;
+		table.assign(size_t(1) << kFastHashLog, 0);
+		const size_t find_limit = size - kMatchFindLimit;
+		const uint8_t * const match_limit = src + size - kLastLiterals;
+
+		size_t ip = 0;
+		size_t misses = size_t(1) << kFastSkipShift;
+		while (ip < find_limit) {
+			const uint32_t sequence = read32(src + ip);
+			uint32_t & slot = table[hashOf(sequence, kFastHashLog)];
+			const uint32_t entry = slot;
+			slot = static_cast<uint32_t>(ip + 1);
+			if (entry == 0 || ip - (entry - 1) > kMaxDistance || read32(src + entry - 1) != sequence) {
+				ip += misses++ >> kFastSkipShift;
+				continue;
+			}
+
+			// 一致の前方にも同じバイトが続いていれば含める
+			size_t start = ip;
+			size_t candidate = entry - 1;
+			while (start > anchor && candidate > 0 && src[start - 1] == src[candidate - 1]) {
+				--start;
+				--candidate;
+			}
+			const size_t length = (ip - start) + kMinMatch + countMatch(src + ip + kMinMatch, src + candidate + (ip - start) + kMinMatch, match_limit);
+			op = writeSequence(op, src + anchor, start - anchor, start - candidate, length);
+			ip = start + length;
+			anchor = ip;
+			misses = size_t(1) << kFastSkipShift;
+			if (ip < find_limit) table[hashOf(read32(src + ip - 2), kFastHashLog)] = static_cast<uint32_t>(ip - 2 + 1);
+		}
+	}
+	op = writeSequence(op, src + anchor, size - anchor, 0, 0);
+	return static_cast<size_t>(op - dest);
+}
+
+/// kHigh用のハッシュチェーン
+class MatchFinder {
+public:
+	MatchFinder(const uint8_t * src, const size_t size)
+		: src_(src), match_limit_(src + size - kLastLiterals), next_(0)
+	{
+		thread_local std::vector<uint32_t> head;
+		thread_local std::vector<uint16_t> chain;
+		head.assign(size_t(1) << kHighHashLog, 0);
+		chain.assign(kMaxDistance + 1, 0);
+		this->head_ = head.data();
+		this->chain_ = chain.data();
+	}
+
+	/// ipから始まる最長の一致を探す。見つからなければ0
+	size_t find(const size_t ip, size_t & distance) noexcept
+	{
+		while (this->next_ < ip) this->insert(this->next_++);
+
+		const uint8_t * const p = this->src_ + ip;
+		const uint32_t sequence = read32(p);
+		const size_t max_length = static_cast<size_t>(this->match_limit_ - p);
+		size_t best = 0;
+		const uint32_t entry = this->head_[hashOf(sequence, kHighHashLog)];
+		if (entry == 0) return 0;
+		size_t candidate = entry - 1;
+		for (size_t attempts = kHighMaxAttempts; attempts > 0 && ip - candidate <= kMaxDistance; --attempts) {
+			const uint8_t * const c = this->src_ + candidate;
+			// 最長を更新できない候補は末尾の1バイトで弾く
+			if (c[best] == p[best] && read32(c) == sequence) {
+				const size_t length = kMinMatch + countMatch(p + kMinMatch, c + kMinMatch, this->match_limit_);
+				if (length > best) {
+					best = length;
+					distance = ip - candidate;
+					if (best >= max_length) break;
+				}
+			}
+			const uint16_t delta = this->chain_[candidate & kMaxDistance];
+			if (delta == 0 || delta > candidate) break;
+			candidate -= delta;
+		}
+		return best;
+	}
+
+private:
+	const uint8_t * src_;
+	const uint8_t * match_limit_;
+	size_t next_;		///< 次にチェーンへ追加する位置
+	uint32_t * head_;	///< ハッシュごとの最新の位置+1
+	uint16_t * chain_;	///< 位置ごとの、同じハッシュの1つ前の位置までの距離。0は終端
+
+	void insert(const size_t pos) noexcept
+	{
+		uint32_t & slot = this->head_[hashOf(read32(this->src_ + pos), kHighHashLog)];
+		const size_t delta = (slot != 0 ? pos - (slot - 1) : 0);
+		this->chain_[pos & kMaxDistance] = static_cast<uint16_t>(delta <= kMaxDistance ? delta : 0);
+		slot = static_cast<uint32_t>(pos + 1);
+	}
+};
+
+size_t compressHigh(const uint8_t * src, const size_t size, uint8_t * dest)
+{
+	uint8_t * op = dest;
+	size_t anchor = 0;
+	if (size > kMatchFindLimit) {
+		const size_t find_limit = size - kMatchFindLimit;
+		MatchFinder finder(src, size);
+		size_t ip = 0;
+		while (ip < find_limit) {
+			size_t distance = 0;
+			size_t length = finder.find(ip, distance);
+			if (length < kMinMatch) {
+				++ip;
+				continue;
+			}
+			// 1バイト後ろから始めた方が長ければ、そちらを使う
+			while (ip + 1 < find_limit) {
+				size_t next_distance = 0;
+				const size_t next_length = finder.find(ip + 1, next_distance);
+				if (next_length <= length) break;
+				++ip;
+				length = next_length;
+				distance = next_distance;
+			}
+			op = writeSequence(op, src + anchor, ip - anchor, distance, length);
+			ip += length;
+			anchor = ip;
+		}
+	}
+	op = writeSequence(op, src + anchor, size - anchor, 0, 0);
+	return static_cast<size_t>(op - dest);
+}
+
+[[noreturn]] void corrupted(void)
+{ mpb::MStatusException::throwError(MStatus::kInvalidParameter, "圧縮ブロックが壊れています", "mpb::BlockCodec::decompress"); }
+
+size_t readLength(const uint8_t *& ip, const uint8_t * end)
+{
+	size_t length = 0;
+	uint8_t b;
+	do {
+		if (ip >= end) corrupted();
+		b = *ip++;
+		length += b;
+	} while (b == 255);
+	return length;
+}
+
+void decompressLz(const uint8_t * src, const size_t size, uint8_t * dest, const size_t raw_size)
+{
+	const uint8_t * ip = src;
+	const uint8_t * const in_end = src + size;
+	uint8_t * op = dest;
+	uint8_t * const out_end = dest + raw_size;
+	for (;;) {
+		if (ip >= in_end) corrupted();
+		const uint8_t token = *ip++;
+
+		size_t literal_length = token >> 4;
+		if (literal_length == 15) literal_length += readLength(ip, in_end);
+		if (literal_length > static_cast<size_t>(in_end - ip) || literal_length > static_cast<size_t>(out_end - op)) corrupted();
+		std::memcpy(op, ip, literal_length);
+		op += literal_length;
+		ip += literal_length;
+		if (ip == in_end) break;
+
+		if (in_end - ip < 2) corrupted();
+		const size_t distance = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+		ip += 2;
+		if (distance == 0 || distance > static_cast<size_t>(op - dest)) corrupted();
+		size_t match_length = token & 15;
+		if (match_length == 15) match_length += readLength(ip, in_end);
+		match_length += kMinMatch;
+		if (match_length > static_cast<size_t>(out_end - op)) corrupted();
+
+		// 距離が一致長より短い場合は周期的なので、コピー済みの範囲を倍々に広げてコピーする
+		const uint8_t * const match = op - distance;
+		while (match_length > 0) {
+			const size_t n = std::min(match_length, static_cast<size_t>(op - match));
+			std::memcpy(op, match, n);
+			op += n;
+			match_length -= n;
+		}
+	}
+	if (op != out_end) corrupted();
+}
+
+// 書き込みを連続させる方が速いので、シャッフルは出力の桁ごと、逆変換は要素ごとに回す
+template <size_t N>
+void shuffleFixed(const uint8_t * src, const size_t count, uint8_t * dest) noexcept
+{
+	for (size_t j = 0; j < N; ++j) {
+		uint8_t * const out = dest + j * count;
+		for (size_t i = 0; i < count; ++i) out[i] = src[i * N + j];
+	}
+}
+
+template <size_t N>
+void unshuffleFixed(const uint8_t * src, const size_t count, uint8_t * dest) noexcept
+{
+	for (size_t i = 0; i < count; ++i) {
+		for (size_t j = 0; j < N; ++j) dest[i * N + j] = src[j * count + i];
+	}
+}
+
+/// オプション文字列の"key=value"を1つずつ取り出す
+bool nextOption(const std::string & s, size_t & begin, std::string & key, std::string & value)
+{
+	while (begin <= s.size()) {
+		const size_t sep = std::min(s.find(';', begin), s.size());
+		const std::string item = s.substr(begin, sep - begin);
+		begin = sep + 1;
+		const size_t eq = item.find('=');
+		if (eq == std::string::npos) continue;
+		key = item.substr(0, eq);
+		value = item.substr(eq + 1);
+		return true;
+	}
+	return false;
+}
+
+unsigned long parseUnsigned(const std::string & key, const std::string & value)
+{
+	char * end = nullptr;
+	const unsigned long v = std::strtoul(value.c_str(), &end, 10);
+	if (value.empty() || *end != '\0') {
+		mpb::MStatusException::throwError(MStatus::kInvalidParameter, MString(("オプションの値が不正です : " + key + "=" + value).c_str()), "mpb::BlockCodecOptions::parse");
+	}
+	return v;
+}
+
+}
+
+mpb::BlockCodecOptions mpb::BlockCodecOptions::parse(const MString & options_string, const BlockCodecOptions & defaults)
+{
+	BlockCodecOptions ret = defaults;
+	const std::string s(options_string.asChar());
+	std::string key, value;
+	size_t begin = 0;
+	while (nextOption(s, begin, key, value)) {
+		if (key == "codec") {
+			if (value == "none") ret.codec = BlockCodecType::kNone;
+			else if (value == "fast") ret.codec = BlockCodecType::kFast;
+			else if (value == "high") ret.codec = BlockCodecType::kHigh;
+			else MStatusException::throwError(MStatus::kInvalidParameter, MString(("不明な圧縮方式です : " + value).c_str()), "mpb::BlockCodecOptions::parse");
+		}
+		else if (key == "shuffle") {
+			const unsigned long v = parseUnsigned(key, value);
+			if (v > 16) MStatusException::throwError(MStatus::kInvalidParameter, "シャッフルの要素サイズは16以下にしてください", "mpb::BlockCodecOptions::parse");
+			ret.shuffle = static_cast<uint8_t>(v);
+		}
+		else if (key == "blockSize") {
+			const unsigned long v = parseUnsigned(key, value);
+			if (v < kMinBlockSize || v > kMaxBlockSize) MStatusException::throwError(MStatus::kInvalidParameter, "ブロックサイズが範囲外です", "mpb::BlockCodecOptions::parse");
+			ret.block_size = static_cast<uint32_t>(v);
+		}
+	}
+	return ret;
+}
+
+size_t mpb::BlockCodec::compress(const BlockCodecType codec, const uint8_t * src, const size_t size, uint8_t * dest) noexcept
+{
+	switch (codec) {
+	case BlockCodecType::kFast: return compressFast(src, size, dest);
+	case BlockCodecType::kHigh: return compressHigh(src, size, dest);
+	default:
+		if (size > 0) std::memcpy(dest, src, size);
+		return size;
+	}
+}
+
+void mpb::BlockCodec::decompress(const BlockCodecType codec, const uint8_t * src, const size_t size, uint8_t * dest, const size_t raw_size)
+{
+	switch (codec) {
+	case BlockCodecType::kNone:
+		if (size != raw_size) corrupted();
+		if (size > 0) std::memcpy(dest, src, size);
+		return;
+	case BlockCodecType::kFast:
+	case BlockCodecType::kHigh:
+		decompressLz(src, size, dest, raw_size);
+		return;
+	default:
+		MStatusException::throwError(MStatus::kInvalidParameter, "不明な圧縮方式です", "mpb::BlockCodec::decompress");
+	}
+}
+
+void mpb::BlockCodec::shuffle(const uint8_t * src, const size_t size, const size_t element_size, uint8_t * dest) noexcept
+{
+	const size_t count = (element_size > 1 ? size / element_size : 0);
+	switch (element_size) {
+	case 0: case 1: break;
+	case 2: shuffleFixed<2>(src, count, dest); break;
+	case 4: shuffleFixed<4>(src, count, dest); break;
+	case 8: shuffleFixed<8>(src, count, dest); break;
+	default:
+		for (size_t i = 0; i < count; ++i) {
+			for (size_t j = 0; j < element_size; ++j) dest[j * count + i] = src[i * element_size + j];
+		}
+		break;
+	}
+	const size_t done = count * element_size;
+	if (size > done) std::memcpy(dest + done, src + done, size - done);
+}
+
+void mpb::BlockCodec::unshuffle(const uint8_t * src, const size_t size, const size_t element_size, uint8_t * dest) noexcept
+{
+	const size_t count = (element_size > 1 ? size / element_size : 0);
+	switch (element_size) {
+	case 0: case 1: break;
+	case 2: unshuffleFixed<2>(src, count, dest); break;
+	case 4: unshuffleFixed<4>(src, count, dest); break;
+	case 8: unshuffleFixed<8>(src, count, dest); break;
+	default:
+		for (size_t i = 0; i < count; ++i) {
+			for (size_t j = 0; j < element_size; ++j) dest[i * element_size + j] = src[j * count + i];
+		}
+		break;
+	}
+	const size_t done = count * element_size;
+	if (size > done) std::memcpy(dest + done, src + done, size - done);
+}
+
+const char * mpb::BlockCodec::name(const BlockCodecType codec) noexcept
+{
+	switch (codec) {
+	case BlockCodecType::kNone: return "none";
+	case BlockCodecType::kFast: return "fast";
+	case BlockCodecType::kHigh: return "high";
+	default: return "unknown";
+	}
+}
@@ -0,0 +1,106 @@
+﻿/// @file BlockCodec.hpp
+/// @brief ブロック単位の圧縮コーデック
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_BLOCK_CODEC_HPP_
+#define _MAYA_PLUGIN_BASE_BLOCK_CODEC_HPP_
+
+#include <maya/MString.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace mpb {
+
+/// @brief 圧縮方式
+enum class BlockCodecType : uint8_t {
+	kNone = 0,		///< 無圧縮
+	kFast = 1,		///< LZ系。1回のハッシュ参照で一致を探す。エンコードが速い
+	kHigh = 2,		///< LZ系。ハッシュチェーンと遅延一致で長い一致を探す。エンコードは遅いが圧縮率が高く、デコードはkFastと同じ
+};
+
+
+/// @brief ブロック圧縮の設定
+struct BlockCodecOptions {
+	static constexpr uint32_t kDefaultBlockSize = 256 << 10;	///< 既定のブロックサイズ(256KiB)
+	static constexpr uint32_t kMinBlockSize = 4 << 10;			///< ブロックサイズの下限
+	static constexpr uint32_t kMaxBlockSize = 64 << 20;			///< ブロックサイズの上限
+
+	BlockCodecType codec;	///< 圧縮方式
+	uint8_t shuffle;		///< バイトシャッフルの要素サイズ。0か1でシャッフルしない
+	uint32_t block_size;	///< 圧縮前のブロックのバイト数
+
+	constexpr BlockCodecOptions(const BlockCodecType codec = BlockCodecType::kFast, const uint8_t shuffle = 0, const uint32_t block_size = kDefaultBlockSize) noexcept
+		: codec(codec), shuffle(shuffle), block_size(block_size) {}
+
+	/// @brief トランスレーターのオプション文字列から読み取る
+	///
+	/// "codec=none|fast|high;shuffle=0|2|4|8;blockSize=バイト数" のキーを読み、他のキーは無視します。
+	/// 指定のないキーはdefaultsの値になります。
+	///
+	/// @param [in] options_string オプション文字列
+	/// @param [in] defaults 既定値
+	///
+	/// @throws MStatusException 値が不正な場合
+	///
+	static BlockCodecOptions parse(const MString & options_string, const BlockCodecOptions & defaults = BlockCodecOptions());
+};
+
+
+/// @brief ブロック単位の圧縮・展開
+///
+/// ブロックは互いに独立しているので、別々のスレッドで同時に圧縮・展開できます。
+///
+/// 圧縮データはLZ4のブロック形式と同じ並びのシーケンス列です。
+/// @code
+/// トークン(u8: 上位4bit リテラル長, 下位4bit 一致長-4) [リテラル長の続き(255の列)] リテラル [u16 距離] [一致長の続き(255の列)]
+/// @endcode
+/// 最後のシーケンスはリテラルのみです。一致の距離は64KiB未満です。
+/// 展開はすべての読み書きの範囲を検査するので、壊れたデータで範囲外にアクセスすることはありません。
+///
+/// 浮動小数点の配列は、同じ桁のバイトがばらばらに並ぶためLZ系ではほとんど縮みません。
+/// shuffleで要素のバイトを桁ごとに並べ替えると、指数部や上位の仮数部が連続して一致しやすくなります。
+///
+class BlockCodec {
+public:
+
+	/// @brief 圧縮後のサイズの上限
+	static size_t compressBound(const size_t size) noexcept { return size + size / 255 + 16; }
+
+	/// @brief 圧縮する
+	///
+	/// @param [in] codec 圧縮方式。kNoneの場合はコピーします
+	/// @param [in] src 圧縮前のデータ
+	/// @param [in] size srcのバイト数
+	/// @param [out] dest 出力先。compressBound(size)バイト以上
+	///
+	/// @return 圧縮後のバイト数
+	///
+	static size_t compress(const BlockCodecType codec, const uint8_t * src, const size_t size, uint8_t * dest) noexcept;
+
+	/// @brief 展開する
+	///
+	/// @param [in] codec 圧縮方式
+	/// @param [in] src 圧縮データ
+	/// @param [in] size srcのバイト数
+	/// @param [out] dest 出力先
+	/// @param [in] raw_size 展開後のバイト数
+	///
+	/// @throws MStatusException データが壊れている場合(kInvalidParameter)
+	///
+	static void decompress(const BlockCodecType codec, const uint8_t * src, const size_t size, uint8_t * dest, const size_t raw_size);
+
+	/// @brief 要素のバイトを桁ごとに並べ替える
+	///
+	/// element_sizeで割り切れない末尾のバイトはそのままコピーします。
+	///
+	static void shuffle(const uint8_t * src, const size_t size, const size_t element_size, uint8_t * dest) noexcept;
+
+	/// @brief shuffleの逆変換
+	static void unshuffle(const uint8_t * src, const size_t size, const size_t element_size, uint8_t * dest) noexcept;
+
+	/// @brief 圧縮方式の名前
+	static const char * name(const BlockCodecType codec) noexcept;
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_BLOCK_CODEC_HPP_
@@ -0,0 +1,275 @@
+﻿#include "BlockStream.hpp"
+#include "exception/MStatusException.hpp"
+#include "util/FastHash.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+uint64_t checksumOf(const uint8_t * data, const size_t size) noexcept
+{
+	mpb::FastHasher hasher;
+	hasher.update(data, size);
+	return hasher.digest().lo;
+}
+
+}
+
+constexpr uint32_t mpb::BlockOutputStream::kBlockTag;
+constexpr uint32_t mpb::BlockOutputStream::kInfoTag;
+constexpr uint32_t mpb::BlockOutputStream::kFormatVersion;
+constexpr size_t mpb::BlockOutputStream::kBlockHeaderSize;
+constexpr size_t mpb::BlockOutputStream::kInfoSize;
+
+
+////////////////////////////////////////////////
+// BlockOutputStream
+
+mpb::BlockOutputStream::BlockOutputStream(ChunkedOutputStream & out, const BlockCodecOptions & options, ThreadPool * pool)
+	: options_(options), exporter_(out, pool), position_(0), block_count_(0), finished_(false)
+{
+	if (options.block_size < BlockCodecOptions::kMinBlockSize || options.block_size > BlockCodecOptions::kMaxBlockSize) {
+		MStatusException::throwError(MStatus::kInvalidParameter, "ブロックサイズが範囲外です", "mpb::BlockOutputStream");
+	}
+	this->block_.reserve(options.block_size);
+}
+
+void mpb::BlockOutputStream::encodeBlock(const BlockCodecOptions & options, const std::vector<uint8_t> & raw, SectionBuffer & buffer)
+{
+	const size_t size = raw.size();
+	BlockCodecType codec = options.codec;
+	uint8_t shuffle = (codec != BlockCodecType::kNone && options.shuffle > 1 ? options.shuffle : 0);
+
+	const uint8_t * src = raw.data();
+	thread_local std::vector<uint8_t> shuffled;
+	if (shuffle) {
+		shuffled.resize(size);
+		BlockCodec::shuffle(raw.data(), size, shuffle, shuffled.data());
+		src = shuffled.data();
+	}
+
+	std::vector<uint8_t> & bytes = buffer.bytes();
+	bytes.resize(kBlockHeaderSize + BlockCodec::compressBound(size));
+	size_t stored = BlockCodec::compress(codec, src, size, bytes.data() + kBlockHeaderSize);
+	if (stored >= size) {
+		// 縮まないブロックは展開の手間も省けるよう、そのまま格納する
+		codec = BlockCodecType::kNone;
+		shuffle = 0;
+		stored = size;
+		if (size > 0) std::memcpy(bytes.data() + kBlockHeaderSize, raw.data(), size);
+	}
+	bytes.resize(kBlockHeaderSize + stored);
+	bytes[0] = static_cast<uint8_t>(codec);
+	bytes[1] = shuffle;
+	storeUnaligned<uint16_t>(bytes.data() + 2, 0, Endian::kLittle);
+	storeUnaligned<uint32_t>(bytes.data() + 4, static_cast<uint32_t>(size), Endian::kLittle);
+	storeUnaligned<uint64_t>(bytes.data() + 8, checksumOf(raw.data(), size), Endian::kLittle);
+}
+
+void mpb::BlockOutputStream::flushBlock(void)
+{
+	std::vector<uint8_t> raw;
+	{
+		std::lock_guard<std::mutex> lock(this->free_mutex_);
+		if (!this->free_blocks_.empty()) {
+			raw = std::move(this->free_blocks_.back());
+			this->free_blocks_.pop_back();
+		}
+	}
+	raw.clear();
+	raw.reserve(this->options_.block_size);
+	raw.swap(this->block_);
+	++this->block_count_;
+
+	this->exporter_.add(kBlockTag, [this, raw = std::move(raw)](SectionBuffer & buffer) mutable {
+		encodeBlock(this->options_, raw, buffer);
+		std::lock_guard<std::mutex> lock(this->free_mutex_);
+		this->free_blocks_.push_back(std::move(raw));
+	});
+}
+
+void mpb::BlockOutputStream::write(const void * src, const size_t size)
+{
+	if (this->finished_) MStatusException::throwError(MStatus::kFailure, "finish後に書き込みました", "mpb::BlockOutputStream::write");
+	const uint8_t * p = static_cast<const uint8_t *>(src);
+	size_t remaining = size;
+	while (remaining > 0) {
+		const size_t n = std::min(remaining, this->options_.block_size - this->block_.size());
+		this->block_.insert(this->block_.end(), p, p + n);
+		p += n;
+		remaining -= n;
+		if (this->block_.size() == this->options_.block_size) this->flushBlock();
+	}
+	this->position_ += size;
+}
+
+void mpb::BlockOutputStream::finish(void)
+{
+	if (this->finished_) MStatusException::throwError(MStatus::kFailure, "finishが2回呼び出されました", "mpb::BlockOutputStream::finish");
+	this->finished_ = true;
+	if (!this->block_.empty()) this->flushBlock();
+
+	const uint64_t size = this->position_;
+	const uint32_t block_size = this->options_.block_size;
+	const uint32_t block_count = this->block_count_;
+	this->exporter_.add(kInfoTag, [size, block_size, block_count](SectionBuffer & buffer) {
+		buffer.writeValue<uint64_t>(size);
+		buffer.writeValue<uint32_t>(block_size);
+		buffer.writeValue<uint32_t>(block_count);
+		buffer.writeValue<uint32_t>(kFormatVersion);
+		buffer.writeValue<uint32_t>(0);
+	});
+	this->exporter_.finish();
+}
+
+
+////////////////////////////////////////////////
+// BlockInputStream
+
+mpb::BlockInputStream::BlockInputStream(const ByteSpan & file, ThreadPool * pool)
+	: pool_(pool), size_(0), block_size_(0), position_(0), window_first_(0), window_count_(0)
+{
+	const SectionIndex index(file);
+	if (index.size() == 0 || index.info(index.size() - 1).tag != BlockOutputStream::kInfoTag) {
+		MStatusException::throwError(MStatus::kInvalidParameter, "ブロック圧縮ファイルの情報がありません", "mpb::BlockInputStream");
+	}
+
+	ByteReader info(index.section(index.size() - 1));
+	this->size_ = info.read<uint64_t>();
+	this->block_size_ = info.read<uint32_t>();
+	const uint32_t block_count = info.read<uint32_t>();
+	if (info.read<uint32_t>() != BlockOutputStream::kFormatVersion) MStatusException::throwError(MStatus::kInvalidParameter, "未対応のブロック圧縮ファイルのバージョン", "mpb::BlockInputStream");
+	if (block_count != index.size() - 1 || this->block_size_ < BlockCodecOptions::kMinBlockSize || this->block_size_ > BlockCodecOptions::kMaxBlockSize) {
+		MStatusException::throwError(MStatus::kInvalidParameter, "ブロック圧縮ファイルの情報が不正", "mpb::BlockInputStream");
+	}
+
+	// 最後以外のブロックはブロックサイズちょうどであること。位置からブロックを直接引くため
+	this->blocks_.reserve(block_count);
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < block_count; ++i) {
+		if (index.info(i).tag != BlockOutputStream::kBlockTag) MStatusException::throwError(MStatus::kInvalidParameter, "不明なセクション", "mpb::BlockInputStream");
+		const ByteSpan section = index.section(i);
+		if (section.size() < BlockOutputStream::kBlockHeaderSize) MStatusException::throwError(MStatus::kInvalidParameter, "ブロックが短すぎます", "mpb::BlockInputStream");
+		Block block;
+		block.codec = static_cast<BlockCodecType>(section.readAs<uint8_t>(0));
+		block.shuffle = section.readAs<uint8_t>(1);
+		block.raw_size = section.readAs<uint32_t>(4);
+		block.checksum = section.readAs<uint64_t>(8);
+		block.payload = section.subspan(BlockOutputStream::kBlockHeaderSize);
+		const bool last = (i + 1 == block_count);
+		if (block.codec > BlockCodecType::kHigh || block.raw_size == 0 || block.raw_size > this->block_size_ || (!last && block.raw_size != this->block_size_)) {
+			MStatusException::throwError(MStatus::kInvalidParameter, "ブロックの情報が不正", "mpb::BlockInputStream");
+		}
+		total += block.raw_size;
+		this->blocks_.push_back(block);
+	}
+	if (total != this->size_) MStatusException::throwError(MStatus::kInvalidParameter, "ブロックの合計サイズが一致しません", "mpb::BlockInputStream");
+}
+
+void mpb::BlockInputStream::decodeBlock(const size_t index, uint8_t * dest) const
+{
+	const Block & block = this->blocks_[index];
+	if (block.shuffle <= 1) {
+		BlockCodec::decompress(block.codec, block.payload.data(), block.payload.size(), dest, block.raw_size);
+	}
+	else {
+		thread_local std::vector<uint8_t> shuffled;
+		shuffled.resize(block.raw_size);
+		BlockCodec::decompress(block.codec, block.payload.data(), block.payload.size(), shuffled.data(), block.raw_size);
+		BlockCodec::unshuffle(shuffled.data(), block.raw_size, block.shuffle, dest);
+	}
+	if (checksumOf(dest, block.raw_size) != block.checksum) MStatusException::throwError(MStatus::kInvalidParameter, "ブロックのハッシュが一致しません", "mpb::BlockInputStream");
+}
+
+const std::vector<uint8_t> & mpb::BlockInputStream::fetchBlock(const size_t index)
+{
+	if (index >= this->window_first_ && index < this->window_first_ + this->window_count_) return this->window_[index - this->window_first_];
+
+	// 以降のブロックもまとめて並列に展開しておく
+	const size_t depth = (this->pool_ ? this->pool_->concurrency() * 2 : 1);
+	const size_t count = std::min(depth, this->blocks_.size() - index);
+	if (this->window_.size() < count) this->window_.resize(count);
+	for (size_t i = 0; i < count; ++i) this->window_[i].resize(this->blocks_[index + i].raw_size);
+	this->window_first_ = index;
+	this->window_count_ = 0;
+
+	const auto kernel = [this, index](const size_t begin, const size_t end) {
+		for (size_t i = begin; i < end; ++i) this->decodeBlock(index + i, this->window_[i].data());
+	};
+	if (this->pool_ && count > 1) this->pool_->parallelFor(count, 1, kernel);
+	else kernel(0, count);
+	this->window_count_ = count;
+	return this->window_[0];
+}
+
+size_t mpb::BlockInputStream::read(void * dest, const size_t size)
+{
+	const size_t n = static_cast<size_t>(std::min<uint64_t>(size, this->size_ - std::min(this->position_, this->size_)));
+	if (n == 0) return 0;
+
+	// ブロックより大きな読み込みは、窓を経由せずに直接展開する
+	if (n >= this->block_size_) {
+		this->readAt(this->position_, dest, n);
+		this->position_ += n;
+		return n;
+	}
+
+	uint8_t * out = static_cast<uint8_t *>(dest);
+	size_t copied = 0;
+	while (copied < n) {
+		const size_t index = static_cast<size_t>(this->position_ / this->block_size_);
+		const std::vector<uint8_t> & block = this->fetchBlock(index);
+		const size_t in_block = static_cast<size_t>(this->position_ - static_cast<uint64_t>(index) * this->block_size_);
+		const size_t chunk = std::min(n - copied, block.size() - in_block);
+		std::memcpy(out + copied, block.data() + in_block, chunk);
+		copied += chunk;
+		this->position_ += chunk;
+	}
+	return n;
+}
+
+void mpb::BlockInputStream::readExact(void * dest, const size_t size)
+{
+	if (size > this->size_ - std::min(this->position_, this->size_)) MStatusException::throwError(MStatus::kEndOfFile, "ブロック圧縮ファイルの終端を越えて読み込みました", "mpb::BlockInputStream::readExact");
+	this->read(dest, size);
+}
+
+void mpb::BlockInputStream::seek(const uint64_t position)
+{
+	if (position > this->size_) MStatusException::throwError(MStatus::kEndOfFile, "ブロック圧縮ファイルの終端を越えて移動しました", "mpb::BlockInputStream::seek");
+	this->position_ = position;
+}
+
+void mpb::BlockInputStream::readAt(const uint64_t offset, void * dest, const size_t size) const
+{
+	if (offset > this->size_ || size > this->size_ - offset) MStatusException::throwError(MStatus::kEndOfFile, "ブロック圧縮ファイルの終端を越えて読み込みました", "mpb::BlockInputStream::readAt");
+	if (size == 0) return;
+
+	const uint64_t block_size = this->block_size_;
+	const size_t first = static_cast<size_t>(offset / block_size);
+	const size_t last = static_cast<size_t>((offset + size - 1) / block_size);
+	uint8_t * const out = static_cast<uint8_t *>(dest);
+
+	const auto kernel = [this, offset, size, block_size, first, out](const size_t begin, const size_t end) {
+		thread_local std::vector<uint8_t> partial;
+		for (size_t i = first + begin; i < first + end; ++i) {
+			const uint64_t block_begin = i * block_size;
+			const uint64_t block_end = block_begin + this->blocks_[i].raw_size;
+			const uint64_t copy_begin = std::max(block_begin, offset);
+			const uint64_t copy_end = std::min(block_end, offset + size);
+			uint8_t * const target = out + (copy_begin - offset);
+			if (copy_begin == block_begin && copy_end == block_end) {
+				// ブロック全体を使う場合は出力先へ直接展開する
+				this->decodeBlock(i, target);
+			}
+			else {
+				partial.resize(this->blocks_[i].raw_size);
+				this->decodeBlock(i, partial.data());
+				std::memcpy(target, partial.data() + (copy_begin - block_begin), static_cast<size_t>(copy_end - copy_begin));
+			}
+		}
+	};
+	const size_t count = last - first + 1;
+	if (this->pool_ && count > 1) this->pool_->parallelFor(count, 1, kernel);
+	else kernel(0, count);
+}
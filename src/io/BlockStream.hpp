@@ -0,0 +1,211 @@
+﻿/// @file BlockStream.hpp
+/// @brief BlockOutputStream, BlockInputStreamクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_BLOCK_STREAM_HPP_
+#define _MAYA_PLUGIN_BASE_BLOCK_STREAM_HPP_
+
+#include "io/BlockCodec.hpp"
+#include "io/ByteSpan.hpp"
+#include "io/SectionExporter.hpp"
+#include "util/ThreadPool.hpp"
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace mpb {
+
+/// @brief ブロック単位で圧縮する出力ストリーム
+///
+/// 書き込んだデータを固定サイズのブロックに区切り、ブロックごとに独立して圧縮します。
+/// 圧縮はSectionExporterでスレッドプールに分散され、書き込み順にファイルへ出力されます。
+/// 圧縮しても縮まないブロックは無圧縮で格納します。
+///
+/// ファイルはSectionExporterの形式で、各ブロックが1セクションです（すべてリトルエンディアン）。
+/// @code
+/// ブロック(tag kBlockTag): u8 codec, u8 shuffle, u16 reserved, u32 圧縮前のバイト数, u64 圧縮前のデータのFastHasher, 圧縮データ
+/// 情報(tag kInfoTag, 最後のセクション): u64 圧縮前の全体のバイト数, u32 ブロックサイズ, u32 ブロック数, u32 kFormatVersion, u32 reserved
+/// @endcode
+/// 展開時にハッシュを照合するので、リテラル部分が壊れた場合も検出できます。
+/// 最後のブロック以外はすべてブロックサイズちょうどなので、読み込み側はセクション表から任意の位置のブロックを直接引けます。
+///
+class BlockOutputStream {
+public:
+
+	static constexpr uint32_t kBlockTag = 0x4B4C4250u;	///< "PBLK"
+	static constexpr uint32_t kInfoTag = 0x464E4950u;	///< "PINF"
+	static constexpr uint32_t kFormatVersion = 1;		///< 形式のバージョン
+	static constexpr size_t kBlockHeaderSize = 16;		///< ブロックの先頭の情報のバイト数
+	static constexpr size_t kInfoSize = 24;				///< 情報セクションのバイト数
+
+	/// @brief コンストラクタ
+	///
+	/// @param [in,out] out 出力ストリーム。現在の位置から書き込みます
+	/// @param [in] options 圧縮の設定
+	/// @param [in] pool 圧縮に使うスレッドプール。nullptrの場合は書き込みの中で直列に圧縮します
+	///
+	BlockOutputStream(ChunkedOutputStream & out, const BlockCodecOptions & options, ThreadPool * pool);
+
+	BlockOutputStream(const BlockOutputStream &) = delete;
+	BlockOutputStream & operator=(const BlockOutputStream &) = delete;
+
+	/// @brief バイト列を書き込む
+	///
+	/// @throws MStatusException 以前のブロックの圧縮で例外が発生していた場合
+	///
+	void write(const void * src, const size_t size);
+
+	/// @brief 値をリトルエンディアンで書き込む
+	template <class T> void writeValue(const T value) {
+		uint8_t bytes[sizeof(T)];
+		storeUnaligned<T>(bytes, value, Endian::kLittle);
+		this->write(bytes, sizeof(T));
+	}
+
+	/// @brief 連続した値をリトルエンディアンで書き込む
+	template <class T> void writeArray(const T * values, const size_t count) {
+		if (kNativeEndian == Endian::kLittle) {
+			this->write(values, count * sizeof(T));
+			return;
+		}
+		for (size_t i = 0; i < count; ++i) this->writeValue<T>(values[i]);
+	}
+
+	/// @brief 残りのブロックと情報セクション、セクション表を書き込む
+	///
+	/// @throws MStatusException 圧縮で例外が発生していた場合
+	///
+	void finish(void);
+
+	/// @brief 書き込んだ圧縮前のバイト数
+	uint64_t position(void) const noexcept { return this->position_; }
+
+	/// @brief 圧縮の設定
+	const BlockCodecOptions & options(void) const noexcept { return this->options_; }
+
+private:
+	// 圧縮中のタスクはoptions_とfree_blocks_を使うため、これらはexporter_より先に宣言する。
+	// finishせずに破棄された場合も、exporter_のデストラクタがタスクを待ってから破棄される
+	const BlockCodecOptions options_;
+	std::mutex free_mutex_;
+	std::vector<std::vector<uint8_t>> free_blocks_;	///< 圧縮し終えたブロックのバッファ。使い回す
+	SectionExporter exporter_;
+	std::vector<uint8_t> block_;					///< 書き込み中のブロック
+	uint64_t position_;
+	uint32_t block_count_;
+	bool finished_;
+
+	/// @brief 書き込み中のブロックを圧縮に回す
+	void flushBlock(void);
+
+	/// @brief ブロックを圧縮してbufferへ書き込む。ワーカースレッドで実行される
+	static void encodeBlock(const BlockCodecOptions & options, const std::vector<uint8_t> & raw, SectionBuffer & buffer);
+};
+
+
+/// @brief BlockOutputStreamで書き出したファイルの入力ストリーム
+///
+/// 順次読み込みでは、次に必要になるブロックをまとめてスレッドプールで並列に展開します。
+/// readAtは任意の位置を、その範囲のブロックだけを展開して読みます。
+///
+class BlockInputStream {
+public:
+
+	/// @brief コンストラクタ
+	///
+	/// @param [in] file ファイル全体。ストリームより長く有効であること
+	/// @param [in] pool 展開に使うスレッドプール。nullptrの場合は呼び出しスレッドで展開します
+	///
+	/// @throws MStatusException 形式が不正な場合(kInvalidParameter)
+	///
+	BlockInputStream(const ByteSpan & file, ThreadPool * pool);
+
+	BlockInputStream(const BlockInputStream &) = delete;
+	BlockInputStream & operator=(const BlockInputStream &) = delete;
+
+	/// @brief 最大sizeバイト読み込む
+	///
+	/// @return 読み込んだバイト数。終端では0
+	///
+	/// @throws MStatusException ブロックが壊れている場合
+	///
+	size_t read(void * dest, const size_t size);
+
+	/// @brief ちょうどsizeバイト読み込む
+	///
+	/// @throws MStatusException 足りない場合(kEndOfFile)、ブロックが壊れている場合
+	///
+	void readExact(void * dest, const size_t size);
+
+	/// @brief リトルエンディアンの値を読み込む
+	template <class T> T readValue(void) {
+		uint8_t bytes[sizeof(T)];
+		this->readExact(bytes, sizeof(T));
+		return loadUnaligned<T>(bytes, Endian::kLittle);
+	}
+
+	/// @brief リトルエンディアンの連続した値を読み込む
+	template <class T> void readArray(T * values, const size_t count) {
+		static_assert(std::is_arithmetic<T>::value, "readArray requires an arithmetic type");
+		this->readExact(values, count * sizeof(T));
+		if (kNativeEndian == Endian::kLittle) return;
+		for (size_t i = 0; i < count; ++i) values[i] = loadUnaligned<T>(&values[i], Endian::kLittle);
+	}
+
+	/// @brief 読み込み位置を移動する
+	/// @throws MStatusException 終端を越える場合(kEndOfFile)
+	void seek(const uint64_t position);
+
+	/// @brief 任意の位置を読み込む
+	///
+	/// ストリームの位置は変わりません。constなので、複数のスレッドから同時に呼び出せます。
+	///
+	/// @throws MStatusException 終端を越える場合(kEndOfFile)、ブロックが壊れている場合
+	///
+	void readAt(const uint64_t offset, void * dest, const size_t size) const;
+
+	/// @brief 圧縮前の位置
+	uint64_t position(void) const noexcept { return this->position_; }
+
+	/// @brief 圧縮前の全体のバイト数
+	uint64_t size(void) const noexcept { return this->size_; }
+
+	bool eof(void) const noexcept { return this->position_ >= this->size_; }
+
+	/// @brief ブロック数
+	size_t blockCount(void) const noexcept { return this->blocks_.size(); }
+
+	/// @brief ブロックサイズ
+	uint32_t blockSize(void) const noexcept { return this->block_size_; }
+
+	/// @brief ブロックの圧縮方式
+	BlockCodecType blockCodec(const size_t index) const { return this->blocks_.at(index).codec; }
+
+private:
+	struct Block {
+		ByteSpan payload;		///< 圧縮データ
+		BlockCodecType codec;
+		uint8_t shuffle;
+		uint32_t raw_size;
+		uint64_t checksum;		///< 圧縮前のデータのハッシュ
+	};
+
+	ThreadPool * pool_;
+	std::vector<Block> blocks_;
+	uint64_t size_;
+	uint32_t block_size_;
+	uint64_t position_;
+	std::vector<std::vector<uint8_t>> window_;	///< 順次読み込み用に展開済みのブロック
+	size_t window_first_;						///< window_[0]のブロック番号
+	size_t window_count_;
+
+	/// @brief ブロックを展開する。destはraw_sizeバイト以上
+	void decodeBlock(const size_t index, uint8_t * dest) const;
+
+	/// @brief 順次読み込み用に、indexのブロックを展開済みにする
+	const std::vector<uint8_t> & fetchBlock(const size_t index);
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_BLOCK_STREAM_HPP_
@@ -0,0 +1,88 @@
+﻿/// @file BoundedQueue.hpp
+/// @brief BoundedQueueクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_BOUNDED_QUEUE_HPP_
+#define _MAYA_PLUGIN_BASE_BOUNDED_QUEUE_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace mpb {
+
+/// @brief 容量制限付きのスレッド間キュー
+///
+/// 満杯のときpushが、空のときpopがブロックします。生産側が消費側より速い場合に、生産側を待たせる（背圧をかける）ために使います。
+/// closeすると待機中のスレッドはすべて起こされ、以降のpushは失敗し、popは残りを取り出し終えると失敗します。
+///
+/// @tparam T 要素の型。ムーブ可能であること
+///
+template <class T>
+class BoundedQueue {
+public:
+
+	/// @brief コンストラクタ
+	/// @param [in] capacity 最大要素数。0の場合は1として扱う
+	explicit BoundedQueue(const size_t capacity)
+		: capacity_(capacity > 0 ? capacity : 1), closed_(false) {}
+
+	BoundedQueue(const BoundedQueue &) = delete;
+	BoundedQueue & operator=(const BoundedQueue &) = delete;
+
+	/// @brief 要素を追加する。満杯の間はブロックする
+	/// @return closeされていた場合はfalse（要素は破棄されない）
+	bool push(T && value) {
+		std::unique_lock<std::mutex> lock(this->mutex_);
+		this->not_full_.wait(lock, [this] { return this->closed_ || this->items_.size() < this->capacity_; });
+		if (this->closed_) return false;
+		this->items_.push_back(std::move(value));
+		lock.unlock();
+		this->not_empty_.notify_one();
+		return true;
+	}
+
+	/// @brief 要素を取り出す。空の間はブロックする
+	/// @return closeされていて、かつ空の場合はfalse
+	bool pop(T & value) {
+		std::unique_lock<std::mutex> lock(this->mutex_);
+		this->not_empty_.wait(lock, [this] { return this->closed_ || !this->items_.empty(); });
+		if (this->items_.empty()) return false;
+		value = std::move(this->items_.front());
+		this->items_.pop_front();
+		lock.unlock();
+		this->not_full_.notify_one();
+		return true;
+	}
+
+	/// @brief キューを閉じ、待機中のスレッドを起こす
+	void close(void) {
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			this->closed_ = true;
+		}
+		this->not_full_.notify_all();
+		this->not_empty_.notify_all();
+	}
+
+	/// @brief 残っている要素を破棄する
+	void clear(void) {
+		std::deque<T> items;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			items.swap(this->items_);
+		}
+		this->not_full_.notify_all();
+	}
+
+private:
+	const size_t capacity_;
+	bool closed_;
+	std::deque<T> items_;
+	std::mutex mutex_;
+	std::condition_variable not_full_;
+	std::condition_variable not_empty_;
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_BOUNDED_QUEUE_HPP_
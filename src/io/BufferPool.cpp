@@ -0,0 +1,47 @@
+﻿#include "BufferPool.hpp"
+
+mpb::BufferPool::BufferPool(const size_t chunk_size, const size_t num_chunks)
+	: chunk_size_(chunk_size > 0 ? chunk_size : 1), closed_(false)
+{
+	const size_t n = (num_chunks > 0 ? num_chunks : 1);
+	// 全バッファを1回の確保でまとめて取る
+	this->storage_.reset(new char[this->chunk_size_ * n]);
+	this->chunks_.resize(n);
+	this->free_.reserve(n);
+	for (size_t i = 0; i < n; ++i) {
+		this->chunks_[i] = Chunk{ this->storage_.get() + i * this->chunk_size_, 0, this->chunk_size_ };
+		this->free_.push_back(&this->chunks_[i]);
+	}
+}
+
+mpb::BufferPool::~BufferPool(void)
+{}
+
+mpb::BufferPool::ChunkPtr mpb::BufferPool::acquire(void)
+{
+	std::unique_lock<std::mutex> lock(this->mutex_);
+	this->cv_.wait(lock, [this] { return this->closed_ || !this->free_.empty(); });
+	if (this->closed_) return ChunkPtr(nullptr, Releaser{ this });
+	Chunk * chunk = this->free_.back();
+	this->free_.pop_back();
+	chunk->size = 0;
+	return ChunkPtr(chunk, Releaser{ this });
+}
+
+void mpb::BufferPool::close(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		this->closed_ = true;
+	}
+	this->cv_.notify_all();
+}
+
+void mpb::BufferPool::release(Chunk * chunk)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		this->free_.push_back(chunk);
+	}
+	this->cv_.notify_one();
+}
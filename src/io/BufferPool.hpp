@@ -0,0 +1,78 @@
+﻿/// @file BufferPool.hpp
+/// @brief BufferPoolクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_BUFFER_POOL_HPP_
+#define _MAYA_PLUGIN_BASE_BUFFER_POOL_HPP_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mpb {
+
+/// @brief 固定サイズバッファの再利用プール
+///
+/// 生成時に全バッファを確保し、以降は貸し出しと返却のみを行います。ストリーミングI/Oのメモリ使用量は chunk_size * num_chunks で頭打ちになります。
+/// 空きがないときacquireはブロックするため、消費が追いつかない場合は生産側が自然に待たされます。
+///
+class BufferPool {
+public:
+
+	/// @brief 貸し出し単位のバッファ
+	struct Chunk {
+		char * data;		///< 先頭
+		size_t size;		///< 有効なバイト数
+		size_t capacity;	///< 容量（= chunkSize）
+	};
+
+	/// @brief 返却を自動で行うデリーター
+	struct Releaser {
+		BufferPool * pool;
+		void operator()(Chunk * chunk) const { if (chunk) pool->release(chunk); }
+	};
+
+	/// @brief 貸し出し中のバッファ。破棄されるとプールへ返却される
+	typedef std::unique_ptr<Chunk, Releaser> ChunkPtr;
+
+	/// @brief コンストラクタ
+	///
+	/// @param [in] chunk_size 1バッファのバイト数
+	/// @param [in] num_chunks バッファ数
+	///
+	BufferPool(const size_t chunk_size, const size_t num_chunks);
+
+	/// @brief デストラクタ
+	///
+	/// 貸し出し中のバッファがすべて返却されてから破棄してください。
+	///
+	~BufferPool(void);
+
+	BufferPool(const BufferPool &) = delete;
+	BufferPool & operator=(const BufferPool &) = delete;
+
+	/// @brief バッファを借りる。空きがない間はブロックする
+	/// @return 借りたバッファ。closeされていた場合は空
+	ChunkPtr acquire(void);
+
+	/// @brief プールを閉じ、acquireで待機中のスレッドを起こす
+	void close(void);
+
+	size_t chunkSize(void) const noexcept { return this->chunk_size_; }
+	size_t numChunks(void) const noexcept { return this->chunks_.size(); }
+
+private:
+	const size_t chunk_size_;
+	std::unique_ptr<char[]> storage_;
+	std::vector<Chunk> chunks_;
+	std::vector<Chunk *> free_;
+	bool closed_;
+	std::mutex mutex_;
+	std::condition_variable cv_;
+
+	void release(Chunk * chunk);
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_BUFFER_POOL_HPP_
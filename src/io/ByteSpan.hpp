@@ -0,0 +1,270 @@
+﻿/// @file ByteSpan.hpp
+/// @brief ByteSpan, ByteReaderクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_BYTE_SPAN_HPP_
+#define _MAYA_PLUGIN_BASE_BYTE_SPAN_HPP_
+
+#include "exception/MStatusException.hpp"
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace mpb {
+
+/// @brief バイト順
+enum class Endian {
+	kLittle,	///< リトルエンディアン
+	kBig,		///< ビッグエンディアン
+};
+
+/// @brief 実行環境のバイト順
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+constexpr Endian kNativeEndian = Endian::kBig;
+#else
+constexpr Endian kNativeEndian = Endian::kLittle;
+#endif
+
+
+namespace endian_detail {
+
+template <size_t N> struct UInt;
+template <> struct UInt<1> { typedef uint8_t type; };
+template <> struct UInt<2> { typedef uint16_t type; };
+template <> struct UInt<4> { typedef uint32_t type; };
+template <> struct UInt<8> { typedef uint64_t type; };
+
+inline uint8_t byteSwap(const uint8_t v) noexcept { return v; }
+inline uint16_t byteSwap(const uint16_t v) noexcept { return static_cast<uint16_t>((v >> 8) | (v << 8)); }
+inline uint32_t byteSwap(const uint32_t v) noexcept {
+	return ((v >> 24) & 0x000000FFu) | ((v >> 8) & 0x0000FF00u) | ((v << 8) & 0x00FF0000u) | ((v << 24) & 0xFF000000u);
+}
+inline uint64_t byteSwap(const uint64_t v) noexcept {
+	return (static_cast<uint64_t>(byteSwap(static_cast<uint32_t>(v))) << 32) | byteSwap(static_cast<uint32_t>(v >> 32));
+}
+
+}
+
+
+/// @brief 境界の揃っていない位置から値を読む
+///
+/// memcpyで読み出すため、アラインメントを問わず未定義動作になりません（最適化で単一のロード命令になります）。
+///
+/// @tparam T 算術型または列挙型
+/// @param [in] src 読み出し位置
+/// @param [in] endian データのバイト順
+///
+template <class T>
+inline T loadUnaligned(const void * src, const Endian endian) noexcept {
+	static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "loadUnaligned requires an arithmetic or enum type");
+	typedef typename endian_detail::UInt<sizeof(T)>::type Bits;
+	Bits bits;
+	std::memcpy(&bits, src, sizeof(T));
+	if (endian != kNativeEndian) bits = endian_detail::byteSwap(bits);
+	T value;
+	std::memcpy(&value, &bits, sizeof(T));
+	return value;
+}
+
+
+/// @brief 境界の揃っていない位置へ値を書く
+///
+/// loadUnalignedの逆です。
+///
+/// @tparam T 算術型または列挙型
+/// @param [out] dest 書き込み位置
+/// @param [in] value 値
+/// @param [in] endian 書き込むバイト順
+///
+template <class T>
+inline void storeUnaligned(void * dest, const T value, const Endian endian) noexcept {
+	static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "storeUnaligned requires an arithmetic or enum type");
+	typedef typename endian_detail::UInt<sizeof(T)>::type Bits;
+	Bits bits;
+	std::memcpy(&bits, &value, sizeof(T));
+	if (endian != kNativeEndian) bits = endian_detail::byteSwap(bits);
+	std::memcpy(dest, &bits, sizeof(T));
+}
+
+
+/// @brief 連続した値の、境界・バイト順を問わない読み取り専用ビュー
+///
+/// 元データをコピーせず、要素アクセスのたびにloadUnalignedで読み出します。
+///
+template <class T>
+class UnalignedArrayView {
+public:
+	UnalignedArrayView(void) noexcept : data_(nullptr), size_(0), endian_(kNativeEndian) {}
+	UnalignedArrayView(const uint8_t * data, const size_t size, const Endian endian) noexcept : data_(data), size_(size), endian_(endian) {}
+
+	/// @brief 要素数
+	size_t size(void) const noexcept { return this->size_; }
+	bool empty(void) const noexcept { return this->size_ == 0; }
+
+	/// @brief 要素を読み出す（範囲チェックなし）
+	T operator[](const size_t i) const noexcept { return loadUnaligned<T>(this->data_ + i * sizeof(T), this->endian_); }
+
+	/// @brief 要素を読み出す
+	/// @throws MStatusException 範囲外の場合
+	T at(const size_t i) const {
+		if (i >= this->size_) MStatusException::throwError(MStatus::kInvalidParameter, "配列ビューの範囲外アクセス", "mpb::UnalignedArrayView::at");
+		return (*this)[i];
+	}
+
+	/// @brief 連続領域へ一括で書き出す
+	///
+	/// バイト順が実行環境と同じ場合は単一のmemcpyになります。
+	///
+	void copyTo(T * dest) const noexcept {
+		if (this->endian_ == kNativeEndian) {
+			if (this->size_ > 0) std::memcpy(dest, this->data_, this->size_ * sizeof(T));
+			return;
+		}
+		for (size_t i = 0; i < this->size_; ++i) dest[i] = (*this)[i];
+	}
+
+private:
+	const uint8_t * data_;
+	size_t size_;
+	Endian endian_;
+};
+
+
+/// @brief 範囲チェック付きの読み取り専用バイト列
+///
+/// 領域は所有しません。MappedFile等、元のメモリより長く保持しないでください。
+/// 範囲外へのアクセスはすべてMStatusException(kEndOfFile)になるため、壊れたファイルでも領域外を読みません。
+///
+class ByteSpan {
+public:
+	ByteSpan(void) noexcept : data_(nullptr), size_(0) {}
+	ByteSpan(const void * data, const size_t size) noexcept : data_(static_cast<const uint8_t *>(data)), size_(size) {}
+
+	const uint8_t * data(void) const noexcept { return this->data_; }
+	size_t size(void) const noexcept { return this->size_; }
+	bool empty(void) const noexcept { return this->size_ == 0; }
+
+	/// @brief 部分列を取り出す
+	///
+	/// @param [in] offset 先頭からのバイト数
+	/// @param [in] length バイト数
+	///
+	/// @throws MStatusException 範囲外の場合
+	///
+	ByteSpan subspan(const size_t offset, const size_t length) const {
+		this->check(offset, length);
+		return ByteSpan(this->data_ + offset, length);
+	}
+
+	/// @brief offset以降すべてを取り出す
+	/// @throws MStatusException 範囲外の場合
+	ByteSpan subspan(const size_t offset) const {
+		this->check(offset, 0);
+		return ByteSpan(this->data_ + offset, this->size_ - offset);
+	}
+
+	/// @brief 値を読む
+	///
+	/// @param [in] offset 先頭からのバイト数
+	/// @param [in] endian データのバイト順
+	///
+	/// @throws MStatusException 範囲外の場合
+	///
+	template <class T> T readAs(const size_t offset, const Endian endian = Endian::kLittle) const {
+		this->check(offset, sizeof(T));
+		return loadUnaligned<T>(this->data_ + offset, endian);
+	}
+
+	/// @brief 連続した値のビューを取り出す
+	///
+	/// @param [in] offset 先頭からのバイト数
+	/// @param [in] count 要素数
+	/// @param [in] endian データのバイト順
+	///
+	/// @throws MStatusException 範囲外の場合
+	///
+	template <class T> UnalignedArrayView<T> arrayAs(const size_t offset, const size_t count, const Endian endian = Endian::kLittle) const {
+		if (count > (SIZE_MAX / sizeof(T))) MStatusException::throwError(MStatus::kEndOfFile, "バイト列の範囲外アクセス", "mpb::ByteSpan");
+		this->check(offset, count * sizeof(T));
+		return UnalignedArrayView<T>(this->data_ + offset, count, endian);
+	}
+
+	/// @brief 先頭が指定のバイト列と一致するか
+	bool startsWith(const void * magic, const size_t length) const noexcept {
+		return (length <= this->size_ && std::memcmp(this->data_, magic, length) == 0);
+	}
+
+private:
+	const uint8_t * data_;
+	size_t size_;
+
+	void check(const size_t offset, const size_t length) const {
+		// offset + lengthのオーバーフローを避けて比較する
+		if (offset > this->size_ || length > this->size_ - offset) {
+			MStatusException::throwError(MStatus::kEndOfFile, "バイト列の範囲外アクセス", "mpb::ByteSpan");
+		}
+	}
+};
+
+
+/// @brief ByteSpanを先頭から順に読むカーソル
+///
+class ByteReader {
+public:
+
+	/// @brief コンストラクタ
+	///
+	/// @param [in] span 読み込むバイト列
+	/// @param [in] endian 既定のバイト順
+	///
+	explicit ByteReader(const ByteSpan & span, const Endian endian = Endian::kLittle) noexcept
+		: span_(span), offset_(0), endian_(endian) {}
+
+	/// @brief 値を読み、位置を進める
+	/// @throws MStatusException 終端を越える場合
+	template <class T> T read(void) {
+		const T v = this->span_.readAs<T>(this->offset_, this->endian_);
+		this->offset_ += sizeof(T);
+		return v;
+	}
+
+	/// @brief 連続した値のビューを取り出し、位置を進める
+	/// @throws MStatusException 終端を越える場合
+	template <class T> UnalignedArrayView<T> readArray(const size_t count) {
+		const UnalignedArrayView<T> v = this->span_.arrayAs<T>(this->offset_, count, this->endian_);
+		this->offset_ += count * sizeof(T);
+		return v;
+	}
+
+	/// @brief バイト列を取り出し、位置を進める
+	/// @throws MStatusException 終端を越える場合
+	ByteSpan readBytes(const size_t length) {
+		const ByteSpan v = this->span_.subspan(this->offset_, length);
+		this->offset_ += length;
+		return v;
+	}
+
+	/// @brief 読み飛ばす
+	/// @throws MStatusException 終端を越える場合
+	void skip(const size_t length) { this->readBytes(length); }
+
+	/// @brief 位置を移動する
+	/// @throws MStatusException 終端を越える場合
+	void seek(const size_t offset) {
+		this->span_.subspan(offset);
+		this->offset_ = offset;
+	}
+
+	size_t offset(void) const noexcept { return this->offset_; }
+	size_t remaining(void) const noexcept { return this->span_.size() - this->offset_; }
+	bool atEnd(void) const noexcept { return this->offset_ >= this->span_.size(); }
+	void setEndian(const Endian endian) noexcept { this->endian_ = endian; }
+
+private:
+	ByteSpan span_;
+	size_t offset_;
+	Endian endian_;
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_BYTE_SPAN_HPP_
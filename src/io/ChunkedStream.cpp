@@ -0,0 +1,260 @@
+﻿#include "ChunkedStream.hpp"
+#include "util/Logger.hpp"
+#include <algorithm>
+#include <cstring>
+
+constexpr size_t mpb::ChunkedInputStream::kDefaultChunkSize;
+constexpr size_t mpb::ChunkedInputStream::kDefaultQueueDepth;
+constexpr size_t mpb::ChunkedOutputStream::kDefaultChunkSize;
+constexpr size_t mpb::ChunkedOutputStream::kDefaultQueueDepth;
+
+namespace {
+
+// 2GiBを超えるファイルに対応した64bit版のシーク
+int seek64(std::FILE * file, const int64_t offset, const int origin)
+{
+#ifdef _WIN32
+	return _fseeki64(file, offset, origin);
+#else
+	return fseeko(file, static_cast<off_t>(offset), origin);
+#endif
+}
+
+int64_t tell64(std::FILE * file)
+{
+#ifdef _WIN32
+	return _ftelli64(file);
+#else
+	return static_cast<int64_t>(ftello(file));
+#endif
+}
+
+}
+
+////////////////////////////////////////////////
+// ChunkedInputStream
+
+mpb::ChunkedInputStream::ChunkedInputStream(const MString & path, const size_t chunk_size, const size_t queue_depth)
+	: pool_(chunk_size, queue_depth + 1), queue_(queue_depth), current_(nullptr, BufferPool::Releaser{ &pool_ }),
+	cursor_(0), position_(0), file_size_(0), finished_(false), file_(nullptr), failed_(false), stopping_(false)
+{
+	this->file_ = std::fopen(path.asChar(), "rb");
+	MStatusException::throwIf(MStatus(this->file_ ? MStatus::kSuccess : MStatus::kNotFound), [&path] { return "ファイルを開けません : " + path; }, "mpb::ChunkedInputStream");
+
+	if (seek64(this->file_, 0, SEEK_END) == 0) {
+		const int64_t size = tell64(this->file_);
+		this->file_size_ = (size > 0 ? static_cast<uint64_t>(size) : 0);
+	}
+	seek64(this->file_, 0, SEEK_SET);
+
+	// 大きなチャンクを自前で管理するので、stdioのバッファは不要
+	std::setvbuf(this->file_, nullptr, _IONBF, 0);
+
+	this->thread_ = std::thread(&ChunkedInputStream::ioLoop, this);
+}
+
+mpb::ChunkedInputStream::~ChunkedInputStream(void)
+{
+	this->stopping_.store(true);
+	this->pool_.close();
+	this->queue_.close();
+	if (this->thread_.joinable()) this->thread_.join();
+	this->queue_.clear();
+	this->current_.reset();
+	if (this->file_) std::fclose(this->file_);
+}
+
+size_t mpb::ChunkedInputStream::read(void * dest, const size_t size)
+{
+	char * out = static_cast<char *>(dest);
+	size_t done = 0;
+	while (done < size) {
+		if (!this->current_ || this->cursor_ >= this->current_->size) {
+			if (!this->fetch()) break;
+		}
+		const size_t n = std::min(size - done, this->current_->size - this->cursor_);
+		std::memcpy(out + done, this->current_->data + this->cursor_, n);
+		this->cursor_ += n;
+		done += n;
+	}
+	this->position_ += done;
+	return done;
+}
+
+void mpb::ChunkedInputStream::readExact(void * dest, const size_t size)
+{
+	if (this->read(dest, size) != size) {
+		MStatusException::throwError(MStatus::kEndOfFile, "ファイルの終端に達しました", "mpb::ChunkedInputStream::readExact");
+	}
+}
+
+bool mpb::ChunkedInputStream::readLine(std::string & line)
+{
+	line.clear();
+	bool any = false;
+	while (true) {
+		if (!this->current_ || this->cursor_ >= this->current_->size) {
+			if (!this->fetch()) break;
+		}
+		any = true;
+		const char * begin = this->current_->data + this->cursor_;
+		const size_t rest = this->current_->size - this->cursor_;
+		const char * nl = static_cast<const char *>(std::memchr(begin, '\n', rest));
+		if (nl) {
+			const size_t n = static_cast<size_t>(nl - begin);
+			line.append(begin, n);
+			this->cursor_ += n + 1;
+			this->position_ += n + 1;
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			return true;
+		}
+		line.append(begin, rest);
+		this->cursor_ += rest;
+		this->position_ += rest;
+	}
+	if (!line.empty() && line.back() == '\r') line.pop_back();
+	return any;
+}
+
+int mpb::ChunkedInputStream::peek(void)
+{
+	if (!this->current_ || this->cursor_ >= this->current_->size) {
+		if (!this->fetch()) return -1;
+	}
+	return static_cast<unsigned char>(this->current_->data[this->cursor_]);
+}
+
+size_t mpb::ChunkedInputStream::skip(const size_t size)
+{
+	size_t done = 0;
+	while (done < size) {
+		if (!this->current_ || this->cursor_ >= this->current_->size) {
+			if (!this->fetch()) break;
+		}
+		const size_t n = std::min(size - done, this->current_->size - this->cursor_);
+		this->cursor_ += n;
+		done += n;
+	}
+	this->position_ += done;
+	return done;
+}
+
+bool mpb::ChunkedInputStream::eof(void)
+{
+	return (this->peek() < 0);
+}
+
+bool mpb::ChunkedInputStream::fetch(void)
+{
+	if (this->finished_) return false;
+	// 使い終わったチャンクを先に返却し、読み込みスレッドが次を読めるようにする
+	this->current_.reset();
+	this->cursor_ = 0;
+	if (!this->queue_.pop(this->current_)) {
+		this->finished_ = true;
+		if (this->failed_.load()) {
+			MStatusException::throwError(MStatus::kFailure, "ファイルの読み込みに失敗しました", "mpb::ChunkedInputStream");
+		}
+		return false;
+	}
+	return true;
+}
+
+void mpb::ChunkedInputStream::ioLoop(void)
+{
+	while (!this->stopping_.load(std::memory_order_relaxed)) {
+		BufferPool::ChunkPtr chunk = this->pool_.acquire();
+		if (!chunk) break;
+		chunk->size = std::fread(chunk->data, 1, chunk->capacity, this->file_);
+		const bool last = (chunk->size < chunk->capacity);
+		if (chunk->size > 0 && !this->queue_.push(std::move(chunk))) break;
+		if (last) {
+			if (std::ferror(this->file_)) this->failed_.store(true);
+			break;
+		}
+	}
+	this->queue_.close();
+}
+
+////////////////////////////////////////////////
+// ChunkedOutputStream
+
+mpb::ChunkedOutputStream::ChunkedOutputStream(const MString & path, const size_t chunk_size, const size_t queue_depth, const bool append)
+	: pool_(chunk_size, queue_depth + 1), queue_(queue_depth), current_(nullptr, BufferPool::Releaser{ &pool_ }),
+	position_(0), closed_(false), file_(nullptr), failed_(false)
+{
+	this->file_ = std::fopen(path.asChar(), append ? "ab" : "wb");
+	MStatusException::throwIf(MStatus(this->file_ ? MStatus::kSuccess : MStatus::kFailure), [&path] { return "ファイルを作成できません : " + path; }, "mpb::ChunkedOutputStream");
+	if (append && seek64(this->file_, 0, SEEK_END) == 0) {
+		const int64_t size = tell64(this->file_);
+		this->position_ = (size > 0 ? static_cast<uint64_t>(size) : 0);
+	}
+	std::setvbuf(this->file_, nullptr, _IONBF, 0);
+
+	this->current_ = this->pool_.acquire();
+	this->thread_ = std::thread(&ChunkedOutputStream::ioLoop, this);
+}
+
+mpb::ChunkedOutputStream::~ChunkedOutputStream(void)
+{
+	if (!this->closed_) {
+		try {
+			this->close();
+		}
+		catch (const MStatusException & e) {
+			MPB_LOG_ERROR("%s", e.toString("mpb::ChunkedOutputStream::~ChunkedOutputStream").asChar());
+		}
+	}
+}
+
+void mpb::ChunkedOutputStream::write(const void * src, const size_t size)
+{
+	if (this->closed_) MStatusException::throwError(MStatus::kFailure, "閉じたストリームへの書き込み", "mpb::ChunkedOutputStream::write");
+	if (this->failed_.load(std::memory_order_relaxed)) MStatusException::throwError(MStatus::kFailure, "ファイルの書き込みに失敗しました", "mpb::ChunkedOutputStream::write");
+
+	const char * in = static_cast<const char *>(src);
+	size_t done = 0;
+	while (done < size) {
+		const size_t n = std::min(size - done, this->current_->capacity - this->current_->size);
+		std::memcpy(this->current_->data + this->current_->size, in + done, n);
+		this->current_->size += n;
+		done += n;
+		if (this->current_->size == this->current_->capacity) this->flush();
+	}
+	this->position_ += size;
+}
+
+void mpb::ChunkedOutputStream::flush(void)
+{
+	if (this->closed_ || !this->current_ || this->current_->size == 0) return;
+	this->queue_.push(std::move(this->current_));
+	// 書き込みスレッドが遅れている場合は、ここで空きを待つ
+	this->current_ = this->pool_.acquire();
+}
+
+void mpb::ChunkedOutputStream::close(void)
+{
+	if (this->closed_) return;
+	if (this->current_ && this->current_->size > 0) this->queue_.push(std::move(this->current_));
+	this->current_.reset();
+	this->closed_ = true;
+	this->queue_.close();
+	if (this->thread_.joinable()) this->thread_.join();
+	if (std::fclose(this->file_) != 0) this->failed_.store(true);
+	this->file_ = nullptr;
+	if (this->failed_.load()) {
+		MStatusException::throwError(MStatus::kFailure, "ファイルの書き込みに失敗しました", "mpb::ChunkedOutputStream::close");
+	}
+}
+
+void mpb::ChunkedOutputStream::ioLoop(void)
+{
+	BufferPool::ChunkPtr chunk(nullptr, BufferPool::Releaser{ &this->pool_ });
+	while (this->queue_.pop(chunk)) {
+		// 失敗後も取り出しは続け、書き込み側がバッファ待ちで止まらないようにする
+		if (!this->failed_.load(std::memory_order_relaxed) && std::fwrite(chunk->data, 1, chunk->size, this->file_) != chunk->size) {
+			this->failed_.store(true);
+		}
+		chunk.reset();
+	}
+}
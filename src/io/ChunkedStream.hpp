@@ -0,0 +1,214 @@
+﻿/// @file ChunkedStream.hpp
+/// @brief ChunkedInputStream, ChunkedOutputStreamクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_CHUNKED_STREAM_HPP_
+#define _MAYA_PLUGIN_BASE_CHUNKED_STREAM_HPP_
+
+#include "io/BufferPool.hpp"
+#include "io/BoundedQueue.hpp"
+#include "exception/MStatusException.hpp"
+#include <maya/MString.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+namespace mpb {
+
+/// @brief チャンク単位の先読み入力ストリーム
+///
+/// バックグラウンドスレッドがファイルを固定サイズのチャンクで読み込み、容量制限付きキューへ送ります。
+/// 呼び出し側はread系の関数で必要な分だけ取り出します。メモリ使用量はchunk_size * (queue_depth + 1)で頭打ちになり、
+/// 取り出しが遅い場合は読み込みスレッドが待たされます。
+///
+/// 読み込みエラーは、そのチャンクに到達した時点でread系の関数からMStatusExceptionとして送出されます。
+///
+class ChunkedInputStream {
+public:
+
+	static constexpr size_t kDefaultChunkSize = 1 << 20;	///< 既定のチャンクサイズ(1MiB)
+	static constexpr size_t kDefaultQueueDepth = 4;			///< 既定の先読みチャンク数
+
+	/// @brief コンストラクタ
+	///
+	/// ファイルを開き、読み込みスレッドを開始します。
+	///
+	/// @param [in] path ファイルパス
+	/// @param [in] chunk_size チャンクのバイト数
+	/// @param [in] queue_depth 先読みするチャンク数
+	///
+	/// @throws MStatusException ファイルを開けなかった場合(kNotFound)
+	///
+	ChunkedInputStream(const MString & path, const size_t chunk_size = kDefaultChunkSize, const size_t queue_depth = kDefaultQueueDepth);
+
+	/// @brief デストラクタ
+	///
+	/// 読み込みスレッドを停止し、ファイルを閉じます。
+	///
+	~ChunkedInputStream(void);
+
+	ChunkedInputStream(const ChunkedInputStream &) = delete;
+	ChunkedInputStream & operator=(const ChunkedInputStream &) = delete;
+
+
+	/// @brief 最大sizeバイトを読み込む
+	///
+	/// @param [out] dest 読み込み先
+	/// @param [in] size 読み込むバイト数
+	/// @return 読み込んだバイト数。終端に達した場合はsize未満
+	///
+	/// @throws MStatusException 読み込みエラーが発生していた場合
+	///
+	size_t read(void * dest, const size_t size);
+
+	/// @brief ちょうどsizeバイトを読み込む
+	///
+	/// @throws MStatusException 途中で終端に達した場合(kEndOfFile)、読み込みエラーの場合
+	///
+	void readExact(void * dest, const size_t size);
+
+	/// @brief 値をバイト列のまま読み込む
+	///
+	/// @throws MStatusException 途中で終端に達した場合(kEndOfFile)、読み込みエラーの場合
+	///
+	template <class T> void readValue(T & value) {
+		static_assert(std::is_trivially_copyable<T>::value, "readValue requires a trivially copyable type");
+		this->readExact(&value, sizeof(T));
+	}
+
+	/// @brief 1行読み込む
+	///
+	/// 改行文字(\n, \r\n)は取り除かれます。
+	///
+	/// @param [out] line 読み込んだ行
+	/// @return 終端に達していて1文字も読めなかった場合はfalse
+	///
+	/// @throws MStatusException 読み込みエラーの場合
+	///
+	bool readLine(std::string & line);
+
+	/// @brief 読み込みを進めずに次の1バイトを取得する
+	/// @return 次のバイト。終端の場合は-1
+	int peek(void);
+
+	/// @brief バイト列を読み飛ばす
+	/// @return 読み飛ばしたバイト数
+	size_t skip(const size_t size);
+
+	/// @brief 終端に達したか
+	bool eof(void);
+
+	/// @brief 現在の読み込み位置
+	uint64_t position(void) const noexcept { return this->position_; }
+
+	/// @brief ファイルサイズ
+	uint64_t fileSize(void) const noexcept { return this->file_size_; }
+
+private:
+	BufferPool pool_;
+	BoundedQueue<BufferPool::ChunkPtr> queue_;
+	BufferPool::ChunkPtr current_;
+	size_t cursor_;
+	uint64_t position_;
+	uint64_t file_size_;
+	bool finished_;
+	std::FILE * file_;
+	std::atomic<bool> failed_;
+	std::atomic<bool> stopping_;
+	std::thread thread_;
+
+	/// @brief 次のチャンクを取り出す
+	/// @return 終端の場合はfalse
+	bool fetch(void);
+
+	/// @brief 読み込みスレッド本体
+	void ioLoop(void);
+};
+
+
+/// @brief チャンク単位の書き込み出力ストリーム
+///
+/// write系の関数で溜めたデータをチャンク単位でバックグラウンドスレッドへ渡し、書き込みと呼び出し側の処理を重ねます。
+/// 書き込みが追いつかない場合は、バッファの空きを待ってwriteがブロックします。
+///
+/// 最後に必ずcloseを呼び出し、書き込みエラーを受け取ってください。デストラクタでのcloseはエラーを出力するだけです。
+///
+class ChunkedOutputStream {
+public:
+
+	static constexpr size_t kDefaultChunkSize = 1 << 20;	///< 既定のチャンクサイズ(1MiB)
+	static constexpr size_t kDefaultQueueDepth = 4;			///< 既定の書き込み待ちチャンク数
+
+	/// @brief コンストラクタ
+	///
+	/// ファイルを作成（上書き）し、書き込みスレッドを開始します。
+	/// appendがtrueの場合は既存のファイルの末尾に追記し、position()はファイルサイズから始まります。
+	///
+	/// @param [in] path ファイルパス
+	/// @param [in] chunk_size チャンクのバイト数
+	/// @param [in] queue_depth 書き込み待ちにできるチャンク数
+	/// @param [in] append 追記するか
+	///
+	/// @throws MStatusException ファイルを開けなかった場合
+	///
+	ChunkedOutputStream(const MString & path, const size_t chunk_size = kDefaultChunkSize, const size_t queue_depth = kDefaultQueueDepth, const bool append = false);
+
+	/// @brief デストラクタ
+	///
+	/// closeされていなければcloseします。
+	///
+	~ChunkedOutputStream(void);
+
+	ChunkedOutputStream(const ChunkedOutputStream &) = delete;
+	ChunkedOutputStream & operator=(const ChunkedOutputStream &) = delete;
+
+
+	/// @brief バイト列を書き込む
+	///
+	/// @throws MStatusException 書き込みエラーが発生していた場合、close後に呼び出した場合
+	///
+	void write(const void * src, const size_t size);
+
+	/// @brief 値をバイト列のまま書き込む
+	template <class T> void writeValue(const T & value) {
+		static_assert(std::is_trivially_copyable<T>::value, "writeValue requires a trivially copyable type");
+		this->write(&value, sizeof(T));
+	}
+
+	/// @brief 文字列を書き込む（終端文字は書き込まない）
+	void writeString(const std::string & str) { this->write(str.data(), str.size()); }
+
+	/// @brief 溜まっているデータを書き込みスレッドへ渡す
+	///
+	/// ディスクへの書き込み完了は待ちません。
+	///
+	void flush(void);
+
+	/// @brief すべて書き込み、ファイルを閉じる
+	///
+	/// @throws MStatusException 書き込みエラーが発生していた場合
+	///
+	void close(void);
+
+	/// @brief 現在の書き込み位置（書き込んだ総バイト数）
+	uint64_t position(void) const noexcept { return this->position_; }
+
+private:
+	BufferPool pool_;
+	BoundedQueue<BufferPool::ChunkPtr> queue_;
+	BufferPool::ChunkPtr current_;
+	uint64_t position_;
+	bool closed_;
+	std::FILE * file_;
+	std::atomic<bool> failed_;
+	std::thread thread_;
+
+	/// @brief 書き込みスレッド本体
+	void ioLoop(void);
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_CHUNKED_STREAM_HPP_
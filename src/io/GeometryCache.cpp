@@ -0,0 +1,287 @@
+﻿#include "GeometryCache.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+constexpr uint32_t mpb::GeometryCacheFormat::kHeaderMagic;
+constexpr uint32_t mpb::GeometryCacheFormat::kFooterMagic;
+constexpr uint32_t mpb::GeometryCacheFormat::kFormatVersion;
+constexpr size_t mpb::GeometryCacheFormat::kHeaderSize;
+constexpr size_t mpb::GeometryCacheFormat::kFooterSize;
+constexpr size_t mpb::GeometryCacheFormat::kIndexEntrySize;
+constexpr size_t mpb::GeometryCacheFormat::kFrameAlignment;
+constexpr size_t mpb::GeometryCacheFormat::kArrayAlignment;
+
+namespace {
+
+typedef mpb::GeometryCacheFormat Format;
+
+constexpr uint32_t kFlagNormals = 1u;
+constexpr size_t kPreludeSize = 64;		///< kQuantized16の min[3], step[3] を置く領域
+constexpr float kNormalStep = 2.0f / 65535.0f;
+
+size_t alignUp(const size_t v, const size_t a) noexcept { return (v + a - 1) / a * a; }
+
+/// @brief フレーム内の配列の配置
+struct Layout {
+	size_t array;		///< 1配列のバイト数（境界まで詰めたもの）
+	size_t points;		///< xの位置
+	size_t normals;		///< nxの位置
+	size_t total;
+
+	Layout(const uint32_t n, const mpb::GeometryCacheEncoding encoding, const bool has_normals) noexcept {
+		const bool quantized = (encoding == mpb::GeometryCacheEncoding::kQuantized16);
+		this->array = alignUp(static_cast<size_t>(n) * (quantized ? sizeof(uint16_t) : sizeof(float)), Format::kArrayAlignment);
+		this->points = (quantized ? kPreludeSize : 0);
+		this->normals = this->points + 3 * this->array;
+		this->total = this->normals + (has_normals ? 3 * this->array : 0);
+	}
+};
+
+template <class T>
+void storeArray(uint8_t * dest, const T * src, const size_t n) noexcept
+{
+	if (mpb::kNativeEndian == mpb::Endian::kLittle) {
+		if (n > 0) std::memcpy(dest, src, n * sizeof(T));
+		return;
+	}
+	for (size_t i = 0; i < n; ++i) mpb::storeUnaligned<T>(dest + i * sizeof(T), src[i], mpb::Endian::kLittle);
+}
+
+uint16_t quantize(const float v, const float min, const float inv_step) noexcept
+{
+	const float q = std::floor((v - min) * inv_step + 0.5f);
+	return static_cast<uint16_t>(std::min(std::max(q, 0.0f), 65535.0f));
+}
+
+/// バイト順を固定して読むことで、ループをベクトル化できるようにする
+void dequantize(const uint8_t * src, const uint32_t n, const float min, const float step, float * dest) noexcept
+{
+	for (uint32_t i = 0; i < n; ++i) dest[i] = min + mpb::loadUnaligned<uint16_t>(src + i * sizeof(uint16_t), mpb::Endian::kLittle) * step;
+}
+
+void checkSize(const mpb::SoaBuffer3<float> & values, const uint32_t n, const char * message)
+{
+	if (values.x.size() != n || values.y.size() != n || values.z.size() != n) mpb::MStatusException::throwError(MStatus::kInvalidParameter, message, "mpb::GeometryCacheWriter::addFrame");
+}
+
+}
+
+size_t mpb::GeometryCacheFormat::frameSize(const uint32_t point_count, const GeometryCacheEncoding encoding, const bool has_normals) noexcept
+{ return Layout(point_count, encoding, has_normals).total; }
+
+
+////////////////////////////////////////////////
+// GeometryCacheWriter
+
+mpb::GeometryCacheWriter::GeometryCacheWriter(ChunkedOutputStream & out, const double start_frame, const double frame_step, const GeometryCacheEncoding encoding, const bool has_normals)
+	: out_(out), start_frame_(start_frame), frame_step_(frame_step), encoding_(encoding), has_normals_(has_normals), point_count_(0), finished_(false)
+{
+	if (out.position() != 0) MStatusException::throwError(MStatus::kInvalidParameter, "キャッシュはファイルの先頭から書き込む必要があります", "mpb::GeometryCacheWriter");
+	if (!(frame_step > 0.0)) MStatusException::throwError(MStatus::kInvalidParameter, "フレームの間隔は正の値である必要があります", "mpb::GeometryCacheWriter");
+}
+
+void mpb::GeometryCacheWriter::writeHeader(void)
+{
+	uint8_t header[Format::kHeaderSize] = {};
+	storeUnaligned<uint32_t>(header + 0, Format::kHeaderMagic, Endian::kLittle);
+	storeUnaligned<uint32_t>(header + 4, Format::kFormatVersion, Endian::kLittle);
+	storeUnaligned<uint32_t>(header + 8, static_cast<uint32_t>(this->encoding_), Endian::kLittle);
+	storeUnaligned<uint32_t>(header + 12, this->has_normals_ ? kFlagNormals : 0u, Endian::kLittle);
+	storeUnaligned<uint32_t>(header + 16, this->point_count_, Endian::kLittle);
+	storeUnaligned<double>(header + 24, this->start_frame_, Endian::kLittle);
+	storeUnaligned<double>(header + 32, this->frame_step_, Endian::kLittle);
+	this->out_.write(header, sizeof(header));
+}
+
+void mpb::GeometryCacheWriter::padTo(const size_t alignment)
+{
+	static const uint8_t zeros[Format::kFrameAlignment] = {};
+	const size_t pad = static_cast<size_t>(alignUp(static_cast<size_t>(this->out_.position()), alignment) - this->out_.position());
+	if (pad > 0) this->out_.write(zeros, pad);
+}
+
+void mpb::GeometryCacheWriter::addFrame(const SoaBuffer3<float> & points, const SoaBuffer3<float> * normals)
+{
+	if (this->finished_) MStatusException::throwError(MStatus::kFailure, "finish後にフレームを追加しました", "mpb::GeometryCacheWriter::addFrame");
+	if (this->index_.empty()) {
+		if (points.size() > UINT32_MAX) MStatusException::throwError(MStatus::kInvalidParameter, "点の数が多すぎます", "mpb::GeometryCacheWriter::addFrame");
+		this->point_count_ = static_cast<uint32_t>(points.size());
+		this->writeHeader();
+	}
+	const uint32_t n = this->point_count_;
+	checkSize(points, n, "点の数が最初のフレームと異なります");
+	if (this->has_normals_) {
+		if (!normals) MStatusException::throwError(MStatus::kInvalidParameter, "法線が指定されていません", "mpb::GeometryCacheWriter::addFrame");
+		checkSize(*normals, n, "法線の数が点の数と異なります");
+	}
+
+	const Layout layout(n, this->encoding_, this->has_normals_);
+	this->block_.assign(layout.total, 0);
+	uint8_t * const block = this->block_.data();
+	const AlignedBuffer<float> * const p[3] = { &points.x, &points.y, &points.z };
+
+	if (this->encoding_ == GeometryCacheEncoding::kFloat32) {
+		for (int c = 0; c < 3; ++c) storeArray(block + layout.points + c * layout.array, p[c]->data(), n);
+		if (this->has_normals_) {
+			const AlignedBuffer<float> * const nrm[3] = { &normals->x, &normals->y, &normals->z };
+			for (int c = 0; c < 3; ++c) storeArray(block + layout.normals + c * layout.array, nrm[c]->data(), n);
+		}
+	}
+	else {
+		for (int c = 0; c < 3; ++c) {
+			const float * src = p[c]->data();
+			const auto range = std::minmax_element(src, src + n);
+			const float min = (n > 0 ? *range.first : 0.0f);
+			const float step = (n > 0 ? (*range.second - min) / 65535.0f : 0.0f);
+			const float inv_step = (step > 0.0f ? 1.0f / step : 0.0f);
+			storeUnaligned<float>(block + c * sizeof(float), min, Endian::kLittle);
+			storeUnaligned<float>(block + (3 + c) * sizeof(float), step, Endian::kLittle);
+			uint8_t * dest = block + layout.points + c * layout.array;
+			for (uint32_t i = 0; i < n; ++i) storeUnaligned<uint16_t>(dest + i * sizeof(uint16_t), quantize(src[i], min, inv_step), Endian::kLittle);
+		}
+		if (this->has_normals_) {
+			const AlignedBuffer<float> * const nrm[3] = { &normals->x, &normals->y, &normals->z };
+			for (int c = 0; c < 3; ++c) {
+				const float * src = nrm[c]->data();
+				uint8_t * dest = block + layout.normals + c * layout.array;
+				for (uint32_t i = 0; i < n; ++i) storeUnaligned<uint16_t>(dest + i * sizeof(uint16_t), quantize(src[i], -1.0f, 1.0f / kNormalStep), Endian::kLittle);
+			}
+		}
+	}
+
+	// フレームは他のフレームとページを共有しないようにする
+	this->padTo(Format::kFrameAlignment);
+	this->index_.push_back(IndexEntry{ this->out_.position(), static_cast<uint32_t>(layout.total) });
+	this->out_.write(block, layout.total);
+}
+
+void mpb::GeometryCacheWriter::finish(void)
+{
+	if (this->finished_) return;
+	if (this->index_.empty()) MStatusException::throwError(MStatus::kInvalidParameter, "フレームがありません", "mpb::GeometryCacheWriter::finish");
+	this->finished_ = true;
+
+	const uint64_t index_offset = this->out_.position();
+	std::vector<uint8_t> table(this->index_.size() * Format::kIndexEntrySize + Format::kFooterSize, 0);
+	uint8_t * entry = table.data();
+	for (const IndexEntry & e : this->index_) {
+		storeUnaligned<uint64_t>(entry, e.offset, Endian::kLittle);
+		storeUnaligned<uint32_t>(entry + 8, e.size, Endian::kLittle);
+		entry += Format::kIndexEntrySize;
+	}
+	storeUnaligned<uint64_t>(entry, index_offset, Endian::kLittle);
+	storeUnaligned<uint32_t>(entry + 8, static_cast<uint32_t>(this->index_.size()), Endian::kLittle);
+	storeUnaligned<uint32_t>(entry + 12, Format::kFooterMagic, Endian::kLittle);
+	this->out_.write(table.data(), table.size());
+}
+
+
+////////////////////////////////////////////////
+// GeometryCacheReader
+
+mpb::GeometryCacheReader::GeometryCacheReader(const MString & path)
+	: owned_(new MappedFile(path, MappedFile::Access::kRandom, false)), file_(owned_.get())
+{ this->open(); }
+
+mpb::GeometryCacheReader::GeometryCacheReader(MappedFile & file)
+	: file_(&file)
+{ this->open(); }
+
+void mpb::GeometryCacheReader::open(void)
+{
+	// スクラブでは前後のフレームを読まないので、先読みを抑える
+	this->file_->advise(MappedFile::Access::kRandom);
+
+	const ByteSpan bytes = this->file_->bytes();
+	if (bytes.size() < Format::kHeaderSize + Format::kFooterSize) MStatusException::throwError(MStatus::kEndOfFile, "ジオメトリキャッシュが短すぎます", "mpb::GeometryCacheReader");
+
+	if (bytes.readAs<uint32_t>(0) != Format::kHeaderMagic) MStatusException::throwError(MStatus::kInvalidParameter, "ジオメトリキャッシュではありません", "mpb::GeometryCacheReader");
+	if (bytes.readAs<uint32_t>(4) != Format::kFormatVersion) MStatusException::throwError(MStatus::kInvalidParameter, "対応していないジオメトリキャッシュのバージョンです", "mpb::GeometryCacheReader");
+	const uint32_t encoding = bytes.readAs<uint32_t>(8);
+	if (encoding > static_cast<uint32_t>(GeometryCacheEncoding::kQuantized16)) MStatusException::throwError(MStatus::kInvalidParameter, "不明な符号化方式です", "mpb::GeometryCacheReader");
+	this->encoding_ = static_cast<GeometryCacheEncoding>(encoding);
+	this->has_normals_ = (bytes.readAs<uint32_t>(12) & kFlagNormals) != 0;
+	this->point_count_ = bytes.readAs<uint32_t>(16);
+	this->start_frame_ = bytes.readAs<double>(24);
+	this->frame_step_ = bytes.readAs<double>(32);
+	if (!(this->frame_step_ > 0.0)) MStatusException::throwError(MStatus::kInvalidParameter, "フレームの間隔が不正です", "mpb::GeometryCacheReader");
+
+	const size_t footer = bytes.size() - Format::kFooterSize;
+	if (bytes.readAs<uint32_t>(footer + 12) != Format::kFooterMagic) MStatusException::throwError(MStatus::kInvalidParameter, "ジオメトリキャッシュの末尾が壊れています", "mpb::GeometryCacheReader");
+	const uint64_t index_offset = bytes.readAs<uint64_t>(footer);
+	const uint32_t frame_count = bytes.readAs<uint32_t>(footer + 8);
+	if (frame_count == 0 || index_offset > footer || (footer - index_offset) != static_cast<uint64_t>(frame_count) * Format::kIndexEntrySize) {
+		MStatusException::throwError(MStatus::kInvalidParameter, "ジオメトリキャッシュの索引が壊れています", "mpb::GeometryCacheReader");
+	}
+
+	const size_t expected = Format::frameSize(this->point_count_, this->encoding_, this->has_normals_);
+	this->index_.resize(frame_count);
+	for (uint32_t i = 0; i < frame_count; ++i) {
+		const size_t entry = static_cast<size_t>(index_offset) + i * Format::kIndexEntrySize;
+		IndexEntry & e = this->index_[i];
+		e.offset = bytes.readAs<uint64_t>(entry);
+		e.size = bytes.readAs<uint32_t>(entry + 8);
+		if (e.size != expected || e.offset < Format::kHeaderSize || e.offset > index_offset || e.size > index_offset - e.offset) {
+			MStatusException::throwError(MStatus::kInvalidParameter, "ジオメトリキャッシュの索引が壊れています", "mpb::GeometryCacheReader");
+		}
+	}
+}
+
+size_t mpb::GeometryCacheReader::frameIndex(const double frame) const noexcept
+{
+	const double i = std::floor((frame - this->start_frame_) / this->frame_step_ + 0.5);
+	if (!(i > 0.0)) return 0;
+	return static_cast<size_t>(std::min(i, static_cast<double>(this->index_.size() - 1)));
+}
+
+mpb::ByteSpan mpb::GeometryCacheReader::frameBytes(const size_t index) const
+{
+	if (index >= this->index_.size()) MStatusException::throwError(MStatus::kInvalidParameter, "フレームの番号が範囲外です", "mpb::GeometryCacheReader::frameBytes");
+	const IndexEntry & e = this->index_[index];
+	return this->file_->bytes().subspan(static_cast<size_t>(e.offset), e.size);
+}
+
+void mpb::GeometryCacheReader::readFrame(const size_t index, SoaBuffer3<float> * points, SoaBuffer3<float> * normals) const
+{
+	const ByteSpan block = this->frameBytes(index);
+	const uint32_t n = this->point_count_;
+	const Layout layout(n, this->encoding_, this->has_normals_);
+
+	if (normals && !this->has_normals_) normals->resize(0);
+	if (normals && this->has_normals_) {
+		normals->resize(n);
+		AlignedBuffer<float> * const dest[3] = { &normals->x, &normals->y, &normals->z };
+		for (int c = 0; c < 3; ++c) {
+			const size_t offset = layout.normals + c * layout.array;
+			if (this->encoding_ == GeometryCacheEncoding::kFloat32) {
+				block.arrayAs<float>(offset, n).copyTo(dest[c]->data());
+			}
+			else {
+				dequantize(block.subspan(offset, n * sizeof(uint16_t)).data(), n, -1.0f, kNormalStep, dest[c]->data());
+			}
+		}
+	}
+
+	if (!points) return;
+	points->resize(n);
+	AlignedBuffer<float> * const dest[3] = { &points->x, &points->y, &points->z };
+	for (int c = 0; c < 3; ++c) {
+		const size_t offset = layout.points + c * layout.array;
+		if (this->encoding_ == GeometryCacheEncoding::kFloat32) {
+			block.arrayAs<float>(offset, n).copyTo(dest[c]->data());
+		}
+		else {
+			const float min = block.readAs<float>(c * sizeof(float));
+			const float step = block.readAs<float>((3 + c) * sizeof(float));
+			dequantize(block.subspan(offset, n * sizeof(uint16_t)).data(), n, min, step, dest[c]->data());
+		}
+	}
+}
+
+void mpb::GeometryCacheReader::prefetch(const size_t index) const noexcept
+{
+	if (index >= this->index_.size()) return;
+	const IndexEntry & e = this->index_[index];
+	this->file_->willNeed(e.offset, e.size);
+}
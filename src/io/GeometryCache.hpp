@@ -0,0 +1,206 @@
+﻿/// @file GeometryCache.hpp
+/// @brief GeometryCacheWriter, GeometryCacheReaderクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_GEOMETRY_CACHE_HPP_
+#define _MAYA_PLUGIN_BASE_GEOMETRY_CACHE_HPP_
+
+#include "io/ByteSpan.hpp"
+#include "io/ChunkedStream.hpp"
+#include "io/MappedFile.hpp"
+#include "math/SoaBuffer.hpp"
+#include <maya/MString.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace mpb {
+
+/// @brief ジオメトリキャッシュの点の符号化方式
+enum class GeometryCacheEncoding : uint32_t {
+	kFloat32 = 0,		///< 単精度のまま
+	kQuantized16 = 1,	///< フレームごとの範囲で16bitに量子化する。誤差は各成分の範囲の1/131070以下、法線は約1.5e-5以下
+};
+
+
+/// @brief フレーム単位のジオメトリキャッシュの形式
+///
+/// 点の数が一定のジオメトリの位置（と法線）を、フレームごとに独立したブロックとして保持します。
+/// 末尾の索引でフレーム番号からブロックの位置を直接引けるため、任意のフレームを他のフレームを読まずに復元できます。
+/// 前フレームとの差分による符号化は、ランダムアクセスで複数のフレームを読むことになるため採用していません。
+///
+/// ファイルの形式（すべてリトルエンディアン）:
+/// @code
+/// [ヘッダー kHeaderSize][フレーム0][フレーム1]...[索引: {u64 offset, u32 size, u32 reserved} * frame_count][フッター kFooterSize]
+/// ヘッダー: u32 kHeaderMagic, u32 kFormatVersion, u32 encoding, u32 flags(bit0: 法線あり), u32 point_count, u32 reserved, f64 start_frame, f64 frame_step, 以降0
+/// フッター: u64 索引の位置, u32 frame_count, u32 kFooterMagic
+/// @endcode
+///
+/// フレームはkFrameAlignment境界から始まり、ページを他のフレームと共有しません。1フレームの復元で触れるのは連続した1範囲のページのみです。
+/// フレーム内の配列はkArrayAlignment境界に揃えています。
+/// - kFloat32 : f32 x[n], y[n], z[n]（法線ありの場合は続けて nx[n], ny[n], nz[n]）
+/// - kQuantized16 : f32 min[3], f32 step[3]、u16 x[n], y[n], z[n]（値は min + q * step）。法線は[-1, 1]を16bitに量子化した u16 nx[n], ny[n], nz[n]
+///
+struct GeometryCacheFormat {
+	static constexpr uint32_t kHeaderMagic = 0x43475042u;	///< "BPGC"
+	static constexpr uint32_t kFooterMagic = 0x45475042u;	///< "BPGE"
+	static constexpr uint32_t kFormatVersion = 1;			///< 形式のバージョン
+	static constexpr size_t kHeaderSize = 64;				///< ヘッダーのバイト数
+	static constexpr size_t kFooterSize = 16;				///< フッターのバイト数
+	static constexpr size_t kIndexEntrySize = 16;			///< 索引1件のバイト数
+	static constexpr size_t kFrameAlignment = 4096;			///< フレームの先頭の境界（ページサイズ）
+	static constexpr size_t kArrayAlignment = 64;			///< フレーム内の配列の境界
+
+	/// @brief 1フレームのバイト数
+	static size_t frameSize(const uint32_t point_count, const GeometryCacheEncoding encoding, const bool has_normals) noexcept;
+};
+
+
+/// @brief ジオメトリキャッシュの書き込み
+///
+/// フレームを順にaddFrameで追加し、finishで索引とフッターを書き込みます。
+/// ヘッダーは最初のフレームの点の数で書き込まれ、以後のフレームは同じ点の数である必要があります。
+///
+class GeometryCacheWriter {
+public:
+
+	/// @brief コンストラクタ
+	///
+	/// @param [in,out] out 出力ストリーム。ファイルの先頭である必要があります
+	/// @param [in] start_frame 最初のフレーム番号
+	/// @param [in] frame_step フレーム番号の間隔
+	/// @param [in] encoding 点の符号化方式
+	/// @param [in] has_normals 法線を保持するか
+	///
+	/// @throws MStatusException ストリームが先頭でない場合、frame_stepが正でない場合
+	///
+	GeometryCacheWriter(ChunkedOutputStream & out, const double start_frame, const double frame_step, const GeometryCacheEncoding encoding, const bool has_normals);
+
+	GeometryCacheWriter(const GeometryCacheWriter &) = delete;
+	GeometryCacheWriter & operator=(const GeometryCacheWriter &) = delete;
+
+	/// @brief 次のフレームを追加する
+	///
+	/// @param [in] points 点の位置
+	/// @param [in] normals 法線。has_normalsの場合は点と同じ数が必要です
+	///
+	/// @throws MStatusException 点の数が最初のフレームと異なる場合、法線の数が点の数と異なる場合、書き込みエラー
+	///
+	void addFrame(const SoaBuffer3<float> & points, const SoaBuffer3<float> * normals = nullptr);
+
+	/// @brief 索引とフッターを書き込む
+	///
+	/// ストリームは閉じません。
+	///
+	/// @throws MStatusException フレームが1つもない場合、書き込みエラー
+	///
+	void finish(void);
+
+	/// @brief 追加したフレーム数
+	size_t frameCount(void) const noexcept { return this->index_.size(); }
+
+private:
+	struct IndexEntry {
+		uint64_t offset;
+		uint32_t size;
+	};
+
+	ChunkedOutputStream & out_;
+	const double start_frame_;
+	const double frame_step_;
+	const GeometryCacheEncoding encoding_;
+	const bool has_normals_;
+	uint32_t point_count_;
+	bool finished_;
+	std::vector<IndexEntry> index_;
+	std::vector<uint8_t> block_;		///< フレームの符号化先。使い回す
+
+	void writeHeader(void);
+	void padTo(const size_t alignment);
+};
+
+
+/// @brief ジオメトリキャッシュの読み込み
+///
+/// ファイルをメモリマップで開き、ヘッダーと索引だけを読み込みます。フレームのデータはreadFrameで要求されたものだけを読みます。
+/// 索引はコピーして保持するため、フレームの復元で触れるページはそのフレームのブロックのみです。
+///
+/// readFrameは状態を変えないため、複数スレッドから同時に呼び出せます。
+///
+class GeometryCacheReader {
+public:
+
+	/// @brief ファイルを開く
+	///
+	/// @param [in] path ファイルパス
+	///
+	/// @throws MStatusException ファイルを開けない場合(kNotFound)、形式が不正な場合(kInvalidParameter, kEndOfFile)
+	///
+	explicit GeometryCacheReader(const MString & path);
+
+	/// @brief 割り当て済みのファイルから開く
+	///
+	/// fileはこのインスタンスより長く保持してください。
+	///
+	/// @param [in] file 割り当て済みのファイル
+	///
+	/// @throws MStatusException 形式が不正な場合(kInvalidParameter, kEndOfFile)
+	///
+	explicit GeometryCacheReader(MappedFile & file);
+
+	GeometryCacheReader(const GeometryCacheReader &) = delete;
+	GeometryCacheReader & operator=(const GeometryCacheReader &) = delete;
+
+	uint32_t pointCount(void) const noexcept { return this->point_count_; }
+	size_t frameCount(void) const noexcept { return this->index_.size(); }
+	double startFrame(void) const noexcept { return this->start_frame_; }
+	double frameStep(void) const noexcept { return this->frame_step_; }
+	GeometryCacheEncoding encoding(void) const noexcept { return this->encoding_; }
+	bool hasNormals(void) const noexcept { return this->has_normals_; }
+
+	/// @brief フレーム番号に最も近いフレームの番号（0始まり）。範囲外は端のフレーム
+	size_t frameIndex(const double frame) const noexcept;
+
+	/// @brief フレームのブロック
+	/// @throws MStatusException 範囲外の場合
+	ByteSpan frameBytes(const size_t index) const;
+
+	/// @brief フレームを復元する
+	///
+	/// @param [in] index フレームの番号（0始まり）
+	/// @param [out] points 点の位置。nullptrの場合は復元しない
+	/// @param [out] normals 法線。nullptrの場合、または法線がないキャッシュの場合は復元しない（法線がない場合は空にする）
+	///
+	/// @throws MStatusException 範囲外の場合、ブロックが壊れている場合
+	///
+	void readFrame(const size_t index, SoaBuffer3<float> * points, SoaBuffer3<float> * normals = nullptr) const;
+
+	/// @brief フレームをすぐに読むことを通知する
+	///
+	/// 再生中に次のフレームを先読みさせるために使います。範囲外は無視されます。
+	///
+	void prefetch(const size_t index) const noexcept;
+
+	/// @brief ファイル全体のバイト数
+	uint64_t fileSize(void) const noexcept { return this->file_->size(); }
+
+private:
+	struct IndexEntry {
+		uint64_t offset;
+		uint32_t size;
+	};
+
+	std::unique_ptr<MappedFile> owned_;
+	MappedFile * file_;
+	uint32_t point_count_;
+	double start_frame_;
+	double frame_step_;
+	GeometryCacheEncoding encoding_;
+	bool has_normals_;
+	std::vector<IndexEntry> index_;
+
+	void open(void);
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_GEOMETRY_CACHE_HPP_
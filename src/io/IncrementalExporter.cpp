@@ -0,0 +1,290 @@
+﻿#include "IncrementalExporter.hpp"
+#include "exception/MStatusException.hpp"
+#include "io/MappedFile.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+constexpr uint32_t mpb::IncrementalExporter::kManifestMagic;
+constexpr uint32_t mpb::IncrementalExporter::kManifestVersion;
+
+namespace {
+
+constexpr size_t kManifestHeaderSize = 32;		///< マニフェストのヘッダーのバイト数
+constexpr size_t kManifestEntrySize = 40;		///< マニフェスト1件のキーを除いたバイト数
+
+/// オプション文字列の"key=value"を1つずつ取り出す
+bool nextOption(const std::string & s, size_t & begin, std::string & key, std::string & value)
+{
+	while (begin <= s.size()) {
+		const size_t sep = std::min(s.find(';', begin), s.size());
+		const std::string item = s.substr(begin, sep - begin);
+		begin = sep + 1;
+		const size_t eq = item.find('=');
+		if (eq == std::string::npos) continue;
+		key = item.substr(0, eq);
+		value = item.substr(eq + 1);
+		return true;
+	}
+	return false;
+}
+
+bool parseFlag(const std::string & key, const std::string & value)
+{
+	if (value == "1") return true;
+	if (value == "0") return false;
+	mpb::MStatusException::throwError(MStatus::kInvalidParameter, MString(("オプションの値が不正です : " + key + "=" + value).c_str()), "mpb::IncrementalOptions::parse");
+}
+
+bool fileExists(const MString & path)
+{
+	std::FILE * file = std::fopen(path.asChar(), "rb");
+	if (!file) return false;
+	std::fclose(file);
+	return true;
+}
+
+/// fromでtoを置き換える。Windowsのrenameは既存のファイルを上書きしない
+bool replaceFile(const MString & from, const MString & to)
+{
+#ifdef _WIN32
+	std::remove(to.asChar());
+#endif
+	return std::rename(from.asChar(), to.asChar()) == 0;
+}
+
+}
+
+////////////////////////////////////////////////
+// IncrementalOptions
+
+mpb::IncrementalOptions mpb::IncrementalOptions::parse(const MString & options_string, const IncrementalOptions & defaults)
+{
+	IncrementalOptions ret = defaults;
+	const std::string s(options_string.asChar());
+	std::string key, value;
+	size_t begin = 0;
+	while (nextOption(s, begin, key, value)) {
+		if (key == "incremental") ret.incremental = parseFlag(key, value);
+		else if (key == "compact") ret.compact = parseFlag(key, value);
+	}
+	return ret;
+}
+
+////////////////////////////////////////////////
+// IncrementalExporter
+
+mpb::IncrementalExporter::IncrementalExporter(const MString & path, ThreadPool * pool, const bool incremental)
+	: path_(path), start_position_(0), stats_{ 0, 0, 0, 0, 0, 0, true }, finished_(false)
+{
+	Manifest manifest;
+	const bool append = incremental && loadManifest(path, manifest);
+	if (append) {
+		this->previous_.reserve(manifest.entries.size());
+		for (auto & e : manifest.entries) this->previous_.emplace(e.key, e);
+	}
+	else {
+		// 書き直しの途中で中断した場合に、古いマニフェストが残らないようにする
+		std::remove(manifestPath(path).asChar());
+	}
+	this->stats_.rewritten = !append;
+
+	this->out_.reset(new ChunkedOutputStream(path, ChunkedOutputStream::kDefaultChunkSize, ChunkedOutputStream::kDefaultQueueDepth, append));
+	this->start_position_ = this->out_->position();
+	this->exporter_.reset(new SectionExporter(*this->out_, pool));
+}
+
+mpb::IncrementalExporter::~IncrementalExporter(void) {}
+
+void mpb::IncrementalExporter::add(const MString & key, const uint32_t tag, const Hash128 & hash, Encoder && encoder)
+{
+	if (this->finished_) MStatusException::throwError(MStatus::kFailure, "finish後にセクションを追加しました", "mpb::IncrementalExporter::add");
+
+	std::string k(key.asChar());
+	if (!this->seen_.insert(k).second) {
+		MStatusException::throwError(MStatus::kInvalidParameter, MString(("キーが重複しています : " + k).c_str()), "mpb::IncrementalExporter::add");
+	}
+
+	const auto it = this->previous_.find(k);
+	if (it != this->previous_.end() && it->second.tag == tag && it->second.hash == hash) {
+		this->exporter_->reuse(SectionInfo{ tag, it->second.offset, it->second.size });
+		++this->stats_.reused;
+	}
+	else {
+		this->exporter_->add(tag, std::move(encoder));
+		++this->stats_.written;
+	}
+	this->entries_.push_back(Entry{ std::move(k), tag, hash, 0, 0 });
+}
+
+void mpb::IncrementalExporter::finish(void)
+{
+	if (this->finished_) return;
+
+	this->exporter_->finish();
+	const std::vector<SectionInfo> & sections = this->exporter_->sections();
+	uint64_t live_bytes = 0;
+	for (size_t i = 0; i < this->entries_.size(); ++i) {
+		this->entries_[i].offset = sections[i].offset;
+		this->entries_[i].size = sections[i].size;
+		live_bytes += sections[i].size;
+	}
+	this->out_->close();
+
+	Manifest manifest;
+	manifest.file_size = this->out_->position();
+	manifest.table_offset = manifest.file_size - SectionExporter::kFooterSize - this->entries_.size() * SectionExporter::kTableEntrySize;
+	manifest.entries = std::move(this->entries_);
+	writeManifest(this->path_, manifest);
+
+	size_t removed = 0;
+	for (const auto & kv : this->previous_) {
+		if (this->seen_.find(kv.first) == this->seen_.end()) ++removed;
+	}
+	this->stats_.removed = removed;
+	this->stats_.written_bytes = manifest.file_size - this->start_position_;
+	this->stats_.live_bytes = live_bytes;
+	this->stats_.file_bytes = manifest.file_size;
+	this->finished_ = true;
+}
+
+double mpb::IncrementalExporter::garbageRatio(void) const noexcept
+{
+	if (this->stats_.file_bytes == 0) return 0.0;
+	const uint64_t table_bytes = this->seen_.size() * SectionExporter::kTableEntrySize + SectionExporter::kFooterSize;
+	const uint64_t used = std::min(this->stats_.live_bytes + table_bytes, this->stats_.file_bytes);
+	return static_cast<double>(this->stats_.file_bytes - used) / static_cast<double>(this->stats_.file_bytes);
+}
+
+mpb::IncrementalExporter::Stats mpb::IncrementalExporter::compact(const MString & path)
+{
+	Manifest manifest;
+	if (!loadManifest(path, manifest)) {
+		MStatusException::throwError(MStatus::kFailure, "マニフェストがないか、ファイルと一致しないため圧縮できません", "mpb::IncrementalExporter::compact");
+	}
+
+	const MString temp = path + ".tmp";
+	Stats stats{ manifest.entries.size(), 0, 0, 0, 0, 0, true };
+	try {
+		MappedFile data(path, MappedFile::Access::kSequential);
+		const ByteSpan bytes = data.bytes();
+		ChunkedOutputStream out(temp);
+		// コピーだけなので直列で十分
+		SectionExporter exporter(out, nullptr);
+		for (const Entry & e : manifest.entries) {
+			const ByteSpan section = bytes.subspan(static_cast<size_t>(e.offset), static_cast<size_t>(e.size));
+			exporter.add(e.tag, [section](SectionBuffer & buffer) { buffer.write(section.data(), section.size()); });
+		}
+		exporter.finish();
+		out.close();
+
+		const std::vector<SectionInfo> & sections = exporter.sections();
+		for (size_t i = 0; i < manifest.entries.size(); ++i) {
+			manifest.entries[i].offset = sections[i].offset;
+			manifest.entries[i].size = sections[i].size;
+			stats.live_bytes += sections[i].size;
+		}
+		manifest.file_size = out.position();
+		manifest.table_offset = manifest.file_size - SectionExporter::kFooterSize - manifest.entries.size() * SectionExporter::kTableEntrySize;
+	}
+	catch (...) {
+		std::remove(temp.asChar());
+		throw;
+	}
+
+	// 置き換えの途中で中断した場合は、次回のエクスポートが全体を書き直す
+	std::remove(manifestPath(path).asChar());
+	if (!replaceFile(temp, path)) {
+		std::remove(temp.asChar());
+		MStatusException::throwError(MStatus::kFailure, MString("ファイルを置き換えられません : ") + path, "mpb::IncrementalExporter::compact");
+	}
+	writeManifest(path, manifest);
+
+	stats.written_bytes = manifest.file_size;
+	stats.file_bytes = manifest.file_size;
+	return stats;
+}
+
+bool mpb::IncrementalExporter::loadManifest(const MString & path, Manifest & manifest)
+{
+	const MString manifest_path = manifestPath(path);
+	if (!fileExists(manifest_path) || !fileExists(path)) return false;
+
+	try {
+		MappedFile file(manifest_path, MappedFile::Access::kSequential);
+		ByteReader reader(file.bytes());
+		if (reader.read<uint32_t>() != kManifestMagic) return false;
+		if (reader.read<uint32_t>() != kManifestVersion) return false;
+		manifest.file_size = reader.read<uint64_t>();
+		manifest.table_offset = reader.read<uint64_t>();
+		const uint32_t count = reader.read<uint32_t>();
+		reader.skip(4);
+		if (reader.remaining() / kManifestEntrySize < count) return false;
+
+		manifest.entries.clear();
+		manifest.entries.reserve(count);
+		for (uint32_t i = 0; i < count; ++i) {
+			Entry e;
+			e.tag = reader.read<uint32_t>();
+			const uint32_t key_size = reader.read<uint32_t>();
+			e.offset = reader.read<uint64_t>();
+			e.size = reader.read<uint64_t>();
+			e.hash.lo = reader.read<uint64_t>();
+			e.hash.hi = reader.read<uint64_t>();
+			const ByteSpan key = reader.readBytes(key_size);
+			e.key.assign(reinterpret_cast<const char *>(key.data()), key.size());
+			manifest.entries.push_back(std::move(e));
+		}
+
+		// データファイルの末尾の表が、マニフェストを書いたときのものであること
+		MappedFile data(path, MappedFile::Access::kRandom, false);
+		if (data.size() != manifest.file_size) return false;
+		const SectionIndex index(data.bytes());
+		if (index.tableOffset() != manifest.table_offset || index.size() != count) return false;
+		for (uint32_t i = 0; i < count; ++i) {
+			const SectionInfo & info = index.info(i);
+			const Entry & e = manifest.entries[i];
+			if (info.tag != e.tag || info.offset != e.offset || info.size != e.size) return false;
+		}
+		return true;
+	}
+	catch (const MStatusException &) {
+		return false;
+	}
+}
+
+void mpb::IncrementalExporter::writeManifest(const MString & path, const Manifest & manifest)
+{
+	size_t size = kManifestHeaderSize;
+	for (const Entry & e : manifest.entries) size += kManifestEntrySize + e.key.size();
+
+	SectionBuffer buffer;
+	buffer.reserve(size);
+	buffer.writeValue<uint32_t>(kManifestMagic);
+	buffer.writeValue<uint32_t>(kManifestVersion);
+	buffer.writeValue<uint64_t>(manifest.file_size);
+	buffer.writeValue<uint64_t>(manifest.table_offset);
+	buffer.writeValue<uint32_t>(static_cast<uint32_t>(manifest.entries.size()));
+	buffer.writeValue<uint32_t>(0);
+	for (const Entry & e : manifest.entries) {
+		buffer.writeValue<uint32_t>(e.tag);
+		buffer.writeValue<uint32_t>(static_cast<uint32_t>(e.key.size()));
+		buffer.writeValue<uint64_t>(e.offset);
+		buffer.writeValue<uint64_t>(e.size);
+		buffer.writeValue<uint64_t>(e.hash.lo);
+		buffer.writeValue<uint64_t>(e.hash.hi);
+		buffer.write(e.key.data(), e.key.size());
+	}
+
+	const MString manifest_path = manifestPath(path);
+	const MString temp = manifest_path + ".tmp";
+	{
+		ChunkedOutputStream out(temp, 64 * 1024, 2);
+		out.write(buffer.data(), buffer.size());
+		out.close();
+	}
+	if (!replaceFile(temp, manifest_path)) {
+		std::remove(temp.asChar());
+		MStatusException::throwError(MStatus::kFailure, MString("マニフェストを置き換えられません : ") + manifest_path, "mpb::IncrementalExporter::writeManifest");
+	}
+}
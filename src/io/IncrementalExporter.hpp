@@ -0,0 +1,177 @@
+﻿/// @file IncrementalExporter.hpp
+/// @brief 変更されたセクションだけを追記する差分エクスポーター
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_INCREMENTAL_EXPORTER_HPP_
+#define _MAYA_PLUGIN_BASE_INCREMENTAL_EXPORTER_HPP_
+
+#include "io/ChunkedStream.hpp"
+#include "io/SectionExporter.hpp"
+#include "util/FastHash.hpp"
+#include "util/ThreadPool.hpp"
+#include <maya/MString.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace mpb {
+
+/// @brief 差分エクスポートの設定
+struct IncrementalOptions {
+	bool incremental;	///< 前回の出力を再利用するか。falseの場合は全体を書き直す
+	bool compact;		///< 書き出した後に圧縮（不要になったセクションの除去）を行うか
+
+	constexpr IncrementalOptions(const bool incremental = true, const bool compact = false) noexcept
+		: incremental(incremental), compact(compact) {}
+
+	/// @brief トランスレーターのオプション文字列から読み取る
+	///
+	/// "incremental=0|1;compact=0|1" のキーを読み、他のキーは無視します。
+	///
+	/// @throws MStatusException 値が不正な場合
+	///
+	static IncrementalOptions parse(const MString & options_string, const IncrementalOptions & defaults = IncrementalOptions());
+};
+
+
+/// @brief 差分エクスポーター
+///
+/// オブジェクトごとにキーと内容のハッシュを付けてセクションを追加すると、前回の出力から変わっていないセクションは書き直さずに再利用します。
+/// 変わったセクションだけをファイルの末尾に追記し、最後に全セクションの新しいセクション表とフッターを追記します。
+/// ファイルはSectionExporterの形式のままで、SectionIndexは末尾のフッターから最新の表を引くので、読み込み側の変更は不要です。
+///
+/// キー・ハッシュ・位置はファイルの横のマニフェスト（manifestPath）に保存します。
+/// マニフェストがない、またはファイルの末尾の表と一致しない場合（別の方法で上書きされた、追記の途中で中断した等）は、全体を書き直します。
+///
+/// 追記を繰り返すと、置き換えられたセクションと古い表がファイルに残ります。
+/// compactで生きているセクションだけのファイルに書き直します。
+///
+/// マニフェストの形式（すべてリトルエンディアン）:
+/// @code
+/// u32 kManifestMagic, u32 kManifestVersion, u64 データファイルのサイズ, u64 セクション表の位置, u32 count, u32 reserved
+/// {u32 tag, u32 キーのバイト数, u64 offset, u64 size, u64 hash.lo, u64 hash.hi, キー} * count（セクション表の順）
+/// @endcode
+///
+class IncrementalExporter {
+public:
+
+	/// @brief セクションのエンコード関数
+	typedef SectionExporter::Encoder Encoder;
+
+	static constexpr uint32_t kManifestMagic = 0x4D42504Du;	///< "MPBM"
+	static constexpr uint32_t kManifestVersion = 1;			///< マニフェストの形式のバージョン
+
+	/// @brief 書き出しの結果
+	struct Stats {
+		size_t written;				///< 書き込んだセクション数
+		size_t reused;				///< 再利用したセクション数
+		size_t removed;				///< 前回あって今回なかったセクション数
+		uint64_t written_bytes;		///< 今回書き込んだバイト数（表とフッターを含む）
+		uint64_t live_bytes;		///< 最新の表から参照されているセクションのバイト数
+		uint64_t file_bytes;		///< ファイルサイズ
+		bool rewritten;				///< 全体を書き直したか
+	};
+
+	/// @brief コンストラクタ
+	///
+	/// マニフェストが有効であれば追記モードで、そうでなければ上書きでファイルを開きます。
+	///
+	/// @param [in] path 出力ファイル
+	/// @param [in] pool エンコードに使うスレッドプール。nullptrの場合は直列に実行します
+	/// @param [in] incremental falseの場合はマニフェストによらず全体を書き直す
+	///
+	/// @throws MStatusException ファイルを開けなかった場合
+	///
+	IncrementalExporter(const MString & path, ThreadPool * pool, const bool incremental = true);
+
+	/// @brief デストラクタ
+	///
+	/// finishされていない場合、マニフェストは更新されません。次回は全体を書き直します。
+	///
+	~IncrementalExporter(void);
+
+	IncrementalExporter(const IncrementalExporter &) = delete;
+	IncrementalExporter & operator=(const IncrementalExporter &) = delete;
+
+	/// @brief セクションを追加する
+	///
+	/// 前回の出力に同じキー・タグ・ハッシュのセクションがあれば、encoderを呼ばずにそれを再利用します。
+	/// ハッシュはエンコードの入力（Mayaから取り出したデータ）からFastHasher等で求めてください。エンコード結果のハッシュである必要はありません。
+	///
+	/// @param [in] key オブジェクトを識別するキー（DAGパス等）。1回の書き出しの中で一意であること
+	/// @param [in] tag セクションの種類
+	/// @param [in] hash 内容のハッシュ
+	/// @param [in] encoder エンコード関数
+	///
+	/// @throws MStatusException キーが重複した場合、以前のセクションのエンコードで例外が発生していた場合
+	///
+	void add(const MString & key, const uint32_t tag, const Hash128 & hash, Encoder && encoder);
+
+	/// @brief セクション表とフッターを追記し、マニフェストを更新する
+	///
+	/// @throws MStatusException エンコード、書き込みで例外が発生した場合
+	///
+	void finish(void);
+
+	/// @brief 書き出しの結果。finish後に有効
+	const Stats & stats(void) const noexcept { return this->stats_; }
+
+	/// @brief ファイルのうち、最新の表から参照されていないバイトの割合
+	double garbageRatio(void) const noexcept;
+
+	/// @brief 生きているセクションだけのファイルに書き直す
+	///
+	/// 一時ファイルに書き出してから置き換えるので、途中で失敗しても元のファイルは残ります。
+	///
+	/// @param [in] path 出力ファイル
+	///
+	/// @return 書き直した後の状態（writtenは書き直したセクション数）
+	///
+	/// @throws MStatusException マニフェストがない、ファイルと一致しない、書き込めない場合
+	///
+	static Stats compact(const MString & path);
+
+	/// @brief マニフェストのパス
+	static MString manifestPath(const MString & path) { return path + ".manifest"; }
+
+private:
+	struct Entry {
+		std::string key;
+		uint32_t tag;
+		Hash128 hash;
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	struct Manifest {
+		uint64_t file_size;
+		uint64_t table_offset;
+		std::vector<Entry> entries;		///< セクション表の順
+	};
+
+	const MString path_;
+	std::unordered_map<std::string, Entry> previous_;	///< 前回のセクション
+	std::vector<Entry> entries_;						///< 今回のセクション。offset, sizeはfinishで埋める
+	std::unordered_set<std::string> seen_;				///< 今回のキー
+	std::unique_ptr<ChunkedOutputStream> out_;
+	std::unique_ptr<SectionExporter> exporter_;
+	uint64_t start_position_;
+	Stats stats_;
+	bool finished_;
+
+	/// @brief マニフェストを読み込み、データファイルの末尾の表と一致するか確かめる
+	///
+	/// @retval true 有効
+	/// @retval false マニフェストがない、壊れている、データファイルと一致しない
+	///
+	static bool loadManifest(const MString & path, Manifest & manifest);
+
+	/// @brief マニフェストを書き込む。一時ファイルに書いてから置き換える
+	static void writeManifest(const MString & path, const Manifest & manifest);
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_INCREMENTAL_EXPORTER_HPP_
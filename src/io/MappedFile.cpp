@@ -0,0 +1,140 @@
+﻿#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+mpb::MappedFile::MappedFile(const MString & path, const Access access, const bool will_need)
+	: data_(nullptr), size_(0), path_(path), file_handle_(INVALID_HANDLE_VALUE), mapping_handle_(nullptr)
+{
+	const DWORD flags = FILE_ATTRIBUTE_NORMAL | (access == Access::kSequential ? FILE_FLAG_SEQUENTIAL_SCAN : access == Access::kRandom ? FILE_FLAG_RANDOM_ACCESS : 0);
+	HANDLE file = CreateFileW(path.asWChar(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+	MStatusException::throwIf(MStatus(file != INVALID_HANDLE_VALUE ? MStatus::kSuccess : MStatus::kNotFound), [&path] { return "ファイルを開けません : " + path; }, "mpb::MappedFile");
+	this->file_handle_ = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size)) {
+		CloseHandle(file);
+		MStatusException::throwError(MStatus::kFailure, "ファイルサイズを取得できません", "mpb::MappedFile");
+	}
+	this->size_ = static_cast<uint64_t>(size.QuadPart);
+	// 空ファイルは割り当てられないので、空のバイト列として扱う
+	if (this->size_ == 0) return;
+	if (this->size_ > static_cast<uint64_t>(SIZE_MAX)) {
+		CloseHandle(file);
+		MStatusException::throwError(MStatus::kInsufficientMemory, "ファイルがアドレス空間に収まりません", "mpb::MappedFile");
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) {
+		CloseHandle(file);
+		MStatusException::throwError(MStatus::kFailure, "ファイルマッピングを作成できません", "mpb::MappedFile");
+	}
+	this->mapping_handle_ = mapping;
+
+	this->data_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!this->data_) {
+		CloseHandle(mapping);
+		CloseHandle(file);
+		MStatusException::throwError(MStatus::kInsufficientMemory, "ファイルを割り当てられません", "mpb::MappedFile");
+	}
+
+	if (will_need) this->willNeed(0, this->size_);
+}
+
+mpb::MappedFile::~MappedFile(void)
+{
+	if (this->data_) UnmapViewOfFile(this->data_);
+	if (this->mapping_handle_) CloseHandle(this->mapping_handle_);
+	if (this->file_handle_ != INVALID_HANDLE_VALUE) CloseHandle(this->file_handle_);
+}
+
+void mpb::MappedFile::advise(const Access access) noexcept
+{
+	// Windowsではファイルを開くときのフラグでのみ指定できる
+	(void)access;
+}
+
+void mpb::MappedFile::willNeed(const uint64_t offset, const uint64_t length) noexcept
+{
+#if defined(_WIN32_WINNT) && (_WIN32_WINNT >= 0x0602)
+	if (!this->data_ || offset >= this->size_) return;
+	WIN32_MEMORY_RANGE_ENTRY range;
+	range.VirtualAddress = const_cast<uint8_t *>(static_cast<const uint8_t *>(this->data_) + offset);
+	range.NumberOfBytes = static_cast<SIZE_T>(length < this->size_ - offset ? length : this->size_ - offset);
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#else
+	// Windows 8より前にはPrefetchVirtualMemoryがない
+	(void)offset;
+	(void)length;
+#endif
+}
+
+#else
+
+mpb::MappedFile::MappedFile(const MString & path, const Access access, const bool will_need)
+	: data_(nullptr), size_(0), path_(path), fd_(-1)
+{
+	this->fd_ = ::open(path.asChar(), O_RDONLY);
+	MStatusException::throwIf(MStatus(this->fd_ >= 0 ? MStatus::kSuccess : MStatus::kNotFound), [&path] { return "ファイルを開けません : " + path; }, "mpb::MappedFile");
+
+	struct stat st;
+	if (::fstat(this->fd_, &st) != 0) {
+		::close(this->fd_);
+		MStatusException::throwError(MStatus::kFailure, "ファイルサイズを取得できません", "mpb::MappedFile");
+	}
+	this->size_ = static_cast<uint64_t>(st.st_size);
+	// 空ファイルは割り当てられないので、空のバイト列として扱う
+	if (this->size_ == 0) return;
+	if (this->size_ > static_cast<uint64_t>(SIZE_MAX)) {
+		::close(this->fd_);
+		MStatusException::throwError(MStatus::kInsufficientMemory, "ファイルがアドレス空間に収まりません", "mpb::MappedFile");
+	}
+
+	void * p = ::mmap(nullptr, static_cast<size_t>(this->size_), PROT_READ, MAP_PRIVATE, this->fd_, 0);
+	if (p == MAP_FAILED) {
+		::close(this->fd_);
+		MStatusException::throwError(MStatus::kInsufficientMemory, "ファイルを割り当てられません", "mpb::MappedFile");
+	}
+	this->data_ = p;
+
+	this->advise(access);
+	if (will_need) this->willNeed(0, this->size_);
+}
+
+mpb::MappedFile::~MappedFile(void)
+{
+	if (this->data_) ::munmap(const_cast<void *>(this->data_), static_cast<size_t>(this->size_));
+	if (this->fd_ >= 0) ::close(this->fd_);
+}
+
+void mpb::MappedFile::advise(const Access access) noexcept
+{
+	if (!this->data_) return;
+	int advice = MADV_NORMAL;
+	if (access == Access::kSequential) advice = MADV_SEQUENTIAL;
+	else if (access == Access::kRandom) advice = MADV_RANDOM;
+	::madvise(const_cast<void *>(this->data_), static_cast<size_t>(this->size_), advice);
+}
+
+void mpb::MappedFile::willNeed(const uint64_t offset, const uint64_t length) noexcept
+{
+	if (!this->data_ || offset >= this->size_) return;
+	// madviseの先頭はページ境界に揃える必要がある
+	const uint64_t page = static_cast<uint64_t>(::sysconf(_SC_PAGESIZE));
+	const uint64_t begin = offset - (offset % page);
+	const uint64_t end = (length < this->size_ - offset ? offset + length : this->size_);
+	::madvise(const_cast<uint8_t *>(static_cast<const uint8_t *>(this->data_) + begin), static_cast<size_t>(end - begin), MADV_WILLNEED);
+}
+
+#endif
@@ -0,0 +1,84 @@
+﻿/// @file MappedFile.hpp
+/// @brief MappedFileクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_MAPPED_FILE_HPP_
+#define _MAYA_PLUGIN_BASE_MAPPED_FILE_HPP_
+
+#include "io/ByteSpan.hpp"
+#include <maya/MString.h>
+#include <cstdint>
+
+namespace mpb {
+
+/// @brief 読み取り専用のメモリマップトファイル
+///
+/// ファイル全体をアドレス空間へ割り当て、ByteSpanとして公開します。データはページキャッシュから直接参照され、プロセス側にコピーは作られません。
+/// POSIXではmmap/madvise、WindowsではCreateFileMapping/MapViewOfFileを使用します。
+/// 32bitビルドではアドレス空間が足りず、大きなファイルは割り当てに失敗することがあります。
+///
+class MappedFile {
+public:
+
+	/// @brief アクセスパターンのヒント
+	enum class Access {
+		kNormal,		///< 指定なし
+		kSequential,	///< 先頭から順に読む。先読みを強め、読み終えたページは早めに解放される
+		kRandom,		///< ランダムに読む。先読みを抑える
+	};
+
+	/// @brief コンストラクタ
+	///
+	/// @param [in] path ファイルパス
+	/// @param [in] access アクセスパターンのヒント
+	/// @param [in] will_need 全体をすぐに読むことを通知し、バックグラウンドで読み込みを始めさせるか
+	///
+	/// @throws MStatusException ファイルを開けない・割り当てられない場合
+	///
+	explicit MappedFile(const MString & path, const Access access = Access::kSequential, const bool will_need = true);
+
+	/// @brief デストラクタ
+	///
+	/// 割り当てを解除します。取得したByteSpanはこれ以降使用できません。
+	///
+	~MappedFile(void);
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile & operator=(const MappedFile &) = delete;
+
+	/// @brief ファイル全体のバイト列
+	ByteSpan bytes(void) const noexcept { return ByteSpan(this->data_, this->size_); }
+
+	/// @brief ファイルサイズ
+	uint64_t size(void) const noexcept { return this->size_; }
+
+	/// @brief 開いたファイルのパス
+	const MString & path(void) const noexcept { return this->path_; }
+
+	/// @brief アクセスパターンのヒントを変更する
+	///
+	/// ヒントは最適化のためのもので、失敗しても動作に影響しないため、エラーは無視されます。
+	///
+	void advise(const Access access) noexcept;
+
+	/// @brief 範囲をすぐに読むことを通知する
+	///
+	/// @param [in] offset 先頭からのバイト数
+	/// @param [in] length バイト数
+	///
+	void willNeed(const uint64_t offset, const uint64_t length) noexcept;
+
+private:
+	const void * data_;
+	uint64_t size_;
+	const MString path_;
+#ifdef _WIN32
+	void * file_handle_;
+	void * mapping_handle_;
+#else
+	int fd_;
+#endif
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_MAPPED_FILE_HPP_
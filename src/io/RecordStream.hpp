@@ -0,0 +1,132 @@
+﻿/// @file RecordStream.hpp
+/// @brief RecordParser, RecordStreamクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_RECORD_STREAM_HPP_
+#define _MAYA_PLUGIN_BASE_RECORD_STREAM_HPP_
+
+#include "io/BoundedQueue.hpp"
+#include "io/ChunkedStream.hpp"
+#include <atomic>
+#include <exception>
+#include <thread>
+
+namespace mpb {
+
+/// @brief レコード単位のパーサーのインターフェース
+///
+/// 入力ストリームから1レコード分を読み込んでデコードします。RecordStreamのパーススレッドから呼び出されるため、Maya APIを使用しないでください。
+///
+/// @tparam Record レコードの型。ムーブ可能であること
+///
+template <class Record>
+class RecordParser {
+public:
+	virtual ~RecordParser(void) {}
+
+	/// @brief 1レコードを読み込む
+	///
+	/// @param [in,out] in 入力ストリーム
+	/// @param [out] record 読み込んだレコード
+	/// @return 読み込めた場合はtrue、終端の場合はfalse
+	///
+	/// @throws MStatusException 形式が不正な場合など
+	///
+	virtual bool parse(ChunkedInputStream & in, Record & record) = 0;
+};
+
+
+/// @brief プル型のレコードストリーム
+///
+/// パーススレッドでparserを回し、デコード済みのレコードを容量制限付きキューへ溜めます。
+/// 呼び出し側（メインスレッド）はnextでレコードを1つずつ取り出し、シーンへの反映など Maya APIが必要な処理だけを行います。
+/// ファイル読み込み・パース・シーンへの反映の3段が重なって動き、各段の間のキューが満杯になると前段が待たされます。
+///
+/// @code
+/// mpb::ChunkedInputStream in(path);
+/// MyParser parser;
+/// mpb::RecordStream<MyRecord> records(in, parser);
+/// MyRecord r;
+/// while (records.next(r)) { apply(r); }
+/// @endcode
+///
+/// @tparam Record レコードの型
+///
+template <class Record>
+class RecordStream {
+public:
+
+	static constexpr size_t kDefaultQueueDepth = 256;	///< 既定の先読みレコード数
+
+	/// @brief コンストラクタ
+	///
+	/// パーススレッドを開始します。in, parserはこのインスタンスより長く生存させてください。
+	///
+	/// @param [in,out] in 入力ストリーム
+	/// @param [in,out] parser パーサー
+	/// @param [in] queue_depth 先読みするレコード数
+	///
+	RecordStream(ChunkedInputStream & in, RecordParser<Record> & parser, const size_t queue_depth = kDefaultQueueDepth)
+		: in_(in), parser_(parser), queue_(queue_depth), stopping_(false)
+	{
+		this->thread_ = std::thread(&RecordStream::parseLoop, this);
+	}
+
+	/// @brief デストラクタ
+	///
+	/// 途中で破棄した場合は、パーススレッドを停止します。
+	///
+	~RecordStream(void) {
+		this->stopping_.store(true);
+		this->queue_.close();
+		if (this->thread_.joinable()) this->thread_.join();
+	}
+
+	RecordStream(const RecordStream &) = delete;
+	RecordStream & operator=(const RecordStream &) = delete;
+
+	/// @brief 次のレコードを取り出す
+	///
+	/// @param [out] record 取り出したレコード
+	/// @return 取り出せた場合はtrue、すべて取り出し終えた場合はfalse
+	///
+	/// @throws MStatusException パースまたは読み込みでエラーが発生した場合、そのエラーを再送出する
+	///
+	bool next(Record & record) {
+		if (this->queue_.pop(record)) return true;
+		if (this->thread_.joinable()) this->thread_.join();
+		if (this->error_) {
+			std::exception_ptr e = this->error_;
+			this->error_ = nullptr;
+			std::rethrow_exception(e);
+		}
+		return false;
+	}
+
+private:
+	ChunkedInputStream & in_;
+	RecordParser<Record> & parser_;
+	BoundedQueue<Record> queue_;
+	std::atomic<bool> stopping_;
+	std::exception_ptr error_;	///< queue_のclose前に書き込まれ、close後に読まれる
+	std::thread thread_;
+
+	void parseLoop(void) {
+		try {
+			while (!this->stopping_.load(std::memory_order_relaxed)) {
+				Record record;
+				if (!this->parser_.parse(this->in_, record)) break;
+				if (!this->queue_.push(std::move(record))) break;
+			}
+		}
+		catch (...) {
+			this->error_ = std::current_exception();
+		}
+		this->queue_.close();
+	}
+};
+
+template <class Record> constexpr size_t RecordStream<Record>::kDefaultQueueDepth;
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_RECORD_STREAM_HPP_
@@ -0,0 +1,156 @@
+﻿#include "io/SectionExporter.hpp"
+#include "exception/MStatusException.hpp"
+#include <algorithm>
+
+constexpr uint32_t mpb::SectionExporter::kFooterMagic;
+constexpr uint32_t mpb::SectionExporter::kFormatVersion;
+constexpr size_t mpb::SectionExporter::kFooterSize;
+constexpr size_t mpb::SectionExporter::kTableEntrySize;
+
+mpb::SectionExporter::SectionExporter(ChunkedOutputStream & out, ThreadPool * pool, const size_t max_in_flight)
+	: out_(out), pool_(pool), max_in_flight_(max_in_flight != 0 ? max_in_flight : (pool ? pool->concurrency() * 4 : 1)), finished_(false)
+{}
+
+mpb::SectionExporter::~SectionExporter(void)
+{
+	if (this->pool_) {
+		try { this->pool_->wait(this->group_); }
+		catch (...) {}
+	}
+}
+
+std::unique_ptr<mpb::SectionBuffer> mpb::SectionExporter::acquireBuffer(void)
+{
+	if (this->free_buffers_.empty()) return std::unique_ptr<SectionBuffer>(new SectionBuffer());
+	std::unique_ptr<SectionBuffer> buffer = std::move(this->free_buffers_.back());
+	this->free_buffers_.pop_back();
+	buffer->clear();
+	return buffer;
+}
+
+void mpb::SectionExporter::add(const uint32_t tag, Encoder && encoder)
+{
+	if (this->finished_) MStatusException::throwError(MStatus::kFailure, "finish後にセクションが追加されました", "mpb::SectionExporter::add");
+	while (this->in_flight_.size() >= this->max_in_flight_) this->writeOldest();
+
+	std::unique_ptr<Pending> pending(new Pending{ tag, this->acquireBuffer(), nullptr, false, SectionInfo{ 0, 0, 0 } });
+	Pending * p = pending.get();
+	this->in_flight_.push_back(std::move(pending));
+
+	auto task = [this, p, encoder = std::move(encoder)]() {
+		std::exception_ptr error;
+		try { encoder(*p->buffer); }
+		catch (...) { error = std::current_exception(); }
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			p->error = error;
+			p->done = true;
+		}
+		this->done_cv_.notify_all();
+	};
+
+	if (this->pool_) this->pool_->submit(this->group_, std::move(task));
+	else task();
+}
+
+void mpb::SectionExporter::reuse(const SectionInfo & info)
+{
+	if (this->finished_) MStatusException::throwError(MStatus::kFailure, "finish後にセクションが追加されました", "mpb::SectionExporter::reuse");
+	while (this->in_flight_.size() >= this->max_in_flight_) this->writeOldest();
+	// エンコード済みとして並べ、書き込み順を保つ
+	this->in_flight_.push_back(std::unique_ptr<Pending>(new Pending{ info.tag, nullptr, nullptr, true, info }));
+}
+
+void mpb::SectionExporter::writeOldest(void)
+{
+	Pending & p = *this->in_flight_.front();
+	{
+		std::unique_lock<std::mutex> lock(this->mutex_);
+		this->done_cv_.wait(lock, [&p] { return p.done; });
+	}
+	if (p.error) {
+		// 残りのエンコードの終了を待ち、結果を破棄してから再送出する
+		const std::exception_ptr error = p.error;
+		if (this->pool_) this->pool_->wait(this->group_);
+		this->in_flight_.clear();
+		this->finished_ = true;
+		std::rethrow_exception(error);
+	}
+
+	if (!p.buffer) {
+		this->sections_.push_back(p.reused);
+		this->in_flight_.pop_front();
+		return;
+	}
+
+	const SectionInfo info{ p.tag, this->out_.position(), static_cast<uint64_t>(p.buffer->size()) };
+	this->out_.write(p.buffer->data(), p.buffer->size());
+	this->sections_.push_back(info);
+
+	this->free_buffers_.push_back(std::move(p.buffer));
+	this->in_flight_.pop_front();
+}
+
+void mpb::SectionExporter::finish(void)
+{
+	if (this->finished_) MStatusException::throwError(MStatus::kFailure, "finishが2回呼び出されました", "mpb::SectionExporter::finish");
+	while (!this->in_flight_.empty()) this->writeOldest();
+	if (this->pool_) this->pool_->wait(this->group_);
+	this->finished_ = true;
+
+	SectionBuffer table;
+	table.reserve(this->sections_.size() * kTableEntrySize + kFooterSize);
+	const uint64_t table_offset = this->out_.position();
+	for (const SectionInfo & info : this->sections_) {
+		table.writeValue<uint32_t>(info.tag);
+		table.writeValue<uint32_t>(0);
+		table.writeValue<uint64_t>(info.offset);
+		table.writeValue<uint64_t>(info.size);
+	}
+	table.writeValue<uint64_t>(table_offset);
+	table.writeValue<uint32_t>(static_cast<uint32_t>(this->sections_.size()));
+	table.writeValue<uint32_t>(kFormatVersion);
+	table.writeValue<uint32_t>(0);
+	table.writeValue<uint32_t>(kFooterMagic);
+	this->out_.write(table.data(), table.size());
+	this->free_buffers_.clear();
+}
+
+
+mpb::SectionIndex::SectionIndex(const ByteSpan & file)
+	: file_(file), table_offset_(0)
+{
+	const size_t footer_size = SectionExporter::kFooterSize;
+	if (file.size() < footer_size) MStatusException::throwError(MStatus::kInvalidParameter, "セクションファイルのフッターがありません", "mpb::SectionIndex");
+
+	const ByteSpan footer = file.subspan(file.size() - footer_size);
+	if (footer.readAs<uint32_t>(20) != SectionExporter::kFooterMagic) MStatusException::throwError(MStatus::kInvalidParameter, "セクションファイルのマジックナンバーが不正", "mpb::SectionIndex");
+	if (footer.readAs<uint32_t>(12) != SectionExporter::kFormatVersion) MStatusException::throwError(MStatus::kInvalidParameter, "未対応のセクションファイルのバージョン", "mpb::SectionIndex");
+
+	this->table_offset_ = footer.readAs<uint64_t>(0);
+	const uint32_t count = footer.readAs<uint32_t>(8);
+	const uint64_t table_end = file.size() - footer_size;
+	if (this->table_offset_ > table_end || (table_end - this->table_offset_) / SectionExporter::kTableEntrySize < count) {
+		MStatusException::throwError(MStatus::kInvalidParameter, "セクション表の位置が不正", "mpb::SectionIndex");
+	}
+
+	ByteReader reader(file.subspan(static_cast<size_t>(this->table_offset_), static_cast<size_t>(count) * SectionExporter::kTableEntrySize));
+	this->sections_.reserve(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		SectionInfo info;
+		info.tag = reader.read<uint32_t>();
+		reader.skip(4);
+		info.offset = reader.read<uint64_t>();
+		info.size = reader.read<uint64_t>();
+		if (info.offset > this->table_offset_ || info.size > this->table_offset_ - info.offset) {
+			MStatusException::throwError(MStatus::kInvalidParameter, "セクションの範囲が不正", "mpb::SectionIndex");
+		}
+		this->sections_.push_back(info);
+	}
+}
+
+mpb::ByteSpan mpb::SectionIndex::section(const size_t i) const
+{
+	const SectionInfo & info = this->sections_.at(i);
+	return this->file_.subspan(static_cast<size_t>(info.offset), static_cast<size_t>(info.size));
+}
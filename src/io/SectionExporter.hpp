@@ -0,0 +1,220 @@
+﻿/// @file SectionExporter.hpp
+/// @brief SectionBuffer, SectionExporter, SectionIndexクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_SECTION_EXPORTER_HPP_
+#define _MAYA_PLUGIN_BASE_SECTION_EXPORTER_HPP_
+
+#include "io/ByteSpan.hpp"
+#include "io/ChunkedStream.hpp"
+#include "util/ThreadPool.hpp"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace mpb {
+
+/// @brief セクションのエンコード先バッファ
+///
+/// 値はすべてリトルエンディアンで書き込まれるため、出力は実行環境に依存しません。
+/// バッファはSectionExporterが使い回すため、2回目以降のエクスポートでは確保がほとんど発生しません。
+///
+class SectionBuffer {
+public:
+	SectionBuffer(void) {}
+
+	/// @brief バイト列を追加する
+	void write(const void * src, const size_t size) {
+		const uint8_t * p = static_cast<const uint8_t *>(src);
+		this->bytes_.insert(this->bytes_.end(), p, p + size);
+	}
+
+	/// @brief 値をリトルエンディアンで追加する
+	template <class T> void writeValue(const T value) {
+		const size_t at = this->bytes_.size();
+		this->bytes_.resize(at + sizeof(T));
+		storeUnaligned<T>(this->bytes_.data() + at, value, Endian::kLittle);
+	}
+
+	/// @brief 連続した値をリトルエンディアンで追加する
+	///
+	/// 実行環境がリトルエンディアンの場合は単一のコピーになります。
+	///
+	template <class T> void writeArray(const T * values, const size_t count) {
+		if (kNativeEndian == Endian::kLittle) {
+			this->write(values, count * sizeof(T));
+			return;
+		}
+		const size_t at = this->bytes_.size();
+		this->bytes_.resize(at + count * sizeof(T));
+		for (size_t i = 0; i < count; ++i) storeUnaligned<T>(this->bytes_.data() + at + i * sizeof(T), values[i], Endian::kLittle);
+	}
+
+	/// @brief 領域を予約する
+	void reserve(const size_t size) { this->bytes_.reserve(size); }
+
+	const uint8_t * data(void) const noexcept { return this->bytes_.data(); }
+	size_t size(void) const noexcept { return this->bytes_.size(); }
+	void clear(void) noexcept { this->bytes_.clear(); }
+
+	/// @brief 書き込み済みの内容を直接編集する
+	std::vector<uint8_t> & bytes(void) noexcept { return this->bytes_; }
+
+private:
+	std::vector<uint8_t> bytes_;
+};
+
+
+/// @brief セクションの位置情報
+struct SectionInfo {
+	uint32_t tag;		///< 利用者が付けた種類
+	uint64_t offset;	///< ファイル先頭からのバイト数
+	uint64_t size;		///< バイト数
+};
+
+
+/// @brief セクション単位の並列エクスポーター
+///
+/// addで渡したエンコード関数をスレッドプールで並列に実行し、各セクションの結果をaddした順にストリームへ書き込みます。
+/// 書き込み順は実行順に依存しないため、並列・直列のどちらで実行しても出力はバイト単位で一致します。
+/// finishで末尾にオフセット表とフッターを書き込みます。
+///
+/// ファイルの形式（すべてリトルエンディアン）:
+/// @code
+/// [セクション0][セクション1]...[セクション表: {u32 tag, u32 reserved, u64 offset, u64 size} * count][フッター]
+/// フッター: u64 表の位置, u32 count, u32 kFormatVersion, u32 reserved, u32 kFooterMagic
+/// @endcode
+/// フッターがファイル末尾にあるため、SectionIndexで末尾から表を引けます。
+///
+/// エンコード関数はワーカースレッドで実行されるため、Maya APIを使用しないでください。必要なデータはaddの前にメインスレッドで取り出し、関数にムーブして渡します。
+///
+class SectionExporter {
+public:
+
+	/// @brief セクションのエンコード関数
+	typedef std::function<void(SectionBuffer &)> Encoder;
+
+	static constexpr uint32_t kFooterMagic = 0x5342504Du;	///< "MPBS"
+	static constexpr uint32_t kFormatVersion = 1;			///< 形式のバージョン
+	static constexpr size_t kFooterSize = 24;				///< フッターのバイト数
+	static constexpr size_t kTableEntrySize = 24;			///< セクション表1件のバイト数
+
+	/// @brief コンストラクタ
+	///
+	/// @param [in,out] out 出力ストリーム。現在の位置から書き込みます
+	/// @param [in] pool エンコードに使うスレッドプール。nullptrの場合はaddの中で直列に実行します
+	/// @param [in] max_in_flight 書き込み待ちにできるセクション数。0の場合はプールの並列度の4倍
+	///
+	SectionExporter(ChunkedOutputStream & out, ThreadPool * pool, const size_t max_in_flight = 0);
+
+	/// @brief デストラクタ
+	///
+	/// finishされていない場合は、実行中のエンコードの終了を待ちます（書き込みは行いません）。
+	///
+	~SectionExporter(void);
+
+	SectionExporter(const SectionExporter &) = delete;
+	SectionExporter & operator=(const SectionExporter &) = delete;
+
+	/// @brief セクションを追加する
+	///
+	/// 書き込み待ちがmax_in_flightに達している場合は、最も古いセクションを書き込んでから追加します。
+	///
+	/// @param [in] tag セクションの種類
+	/// @param [in] encoder エンコード関数
+	///
+	/// @throws MStatusException 以前のセクションのエンコードで例外が発生していた場合、その例外
+	///
+	void add(const uint32_t tag, Encoder && encoder);
+
+	/// @brief 出力先に書き込み済みのセクションを、そのまま表に載せる
+	///
+	/// 追記モードのストリームで、前回書き出したセクションを書き直さずに再利用する場合に使います。
+	/// 表での順序はaddと同じく呼び出し順です。範囲が出力先に存在するかは検査しません。
+	///
+	/// @param [in] info 書き込み済みのセクション
+	///
+	/// @throws MStatusException 以前のセクションのエンコードで例外が発生していた場合、その例外
+	///
+	void reuse(const SectionInfo & info);
+
+	/// @brief 全セクションを書き込み、セクション表とフッターを書き込む
+	///
+	/// @throws MStatusException エンコードで例外が発生していた場合、その例外
+	///
+	void finish(void);
+
+	/// @brief 書き込み済みのセクション
+	const std::vector<SectionInfo> & sections(void) const noexcept { return this->sections_; }
+
+private:
+	struct Pending {
+		uint32_t tag;
+		std::unique_ptr<SectionBuffer> buffer;	///< reuseの場合はnullptr
+		std::exception_ptr error;
+		bool done;
+		SectionInfo reused;						///< reuseしたセクション
+	};
+
+	ChunkedOutputStream & out_;
+	ThreadPool * pool_;
+	const size_t max_in_flight_;
+	bool finished_;
+	std::vector<SectionInfo> sections_;
+	std::deque<std::unique_ptr<Pending>> in_flight_;
+	std::vector<std::unique_ptr<SectionBuffer>> free_buffers_;
+	std::mutex mutex_;
+	std::condition_variable done_cv_;
+	ThreadPool::TaskGroup group_;
+
+	/// @brief 最も古いセクションの完了を待って書き込む
+	void writeOldest(void);
+
+	/// @brief バッファを借りる
+	std::unique_ptr<SectionBuffer> acquireBuffer(void);
+};
+
+
+/// @brief セクション形式のファイルの索引
+///
+/// SectionExporterで書き出したファイルを、末尾のフッターからセクション表を引いて開きます。
+///
+class SectionIndex {
+public:
+
+	/// @brief ファイル全体から索引を読み込む
+	///
+	/// @param [in] file ファイル全体
+	///
+	/// @throws MStatusException 形式が不正な場合(kInvalidParameter, kEndOfFile)
+	///
+	explicit SectionIndex(const ByteSpan & file);
+
+	/// @brief セクション数
+	size_t size(void) const noexcept { return this->sections_.size(); }
+
+	/// @brief セクションの位置情報
+	const SectionInfo & info(const size_t i) const { return this->sections_.at(i); }
+
+	/// @brief セクションの中身
+	/// @throws MStatusException 範囲外の場合
+	ByteSpan section(const size_t i) const;
+
+	/// @brief セクション表の位置（＝セクション領域の終端）
+	uint64_t tableOffset(void) const noexcept { return this->table_offset_; }
+
+	const std::vector<SectionInfo> & sections(void) const noexcept { return this->sections_; }
+
+private:
+	ByteSpan file_;
+	uint64_t table_offset_;
+	std::vector<SectionInfo> sections_;
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_SECTION_EXPORTER_HPP_
@@ -2,29 +2,69 @@
 #include "base/CommandBase.hpp"
 #include "base/TranslatorBase.hpp"
 #include "exception/MStatusException.hpp"
+#include "util/ThreadPool.hpp"
+#include "util/Logger.hpp"
+#include "util/ErrorAggregator.hpp"
+#include "util/AsyncComputeQueue.hpp"
+#include "command/ComputeProfilerCommand.hpp"
 #include <maya/MFnPlugin.h>
+#include <chrono>
 
 //*** INCLUDE HEADERS ***
+//#include "node/GeometryCacheNode.hpp"
+//#include "translator/GeometryCacheTranslator.hpp"
 
 //***********************
 
 namespace {
 constexpr char kProjectName[] = __PROJECT_NAME;
 constexpr char kVersion[] = "0.1";
+
+/// ロードの各段階の所要時間を計測する
+class PhaseTimer {
+public:
+	PhaseTimer(void) : start_(std::chrono::steady_clock::now()), phase_start_(start_) {}
+
+	/// 前回からの経過時間を表示し、次の段階を始める
+	void lap(const char * phase) {
+		const auto now = std::chrono::steady_clock::now();
+		MPB_LOG_INFO("-- %s : %g ms", phase, milliseconds(now - this->phase_start_));
+		this->phase_start_ = now;
+	}
+
+	/// 全体の経過時間(ms)
+	double total(void) const { return milliseconds(std::chrono::steady_clock::now() - this->start_); }
+
+private:
+	std::chrono::steady_clock::time_point start_;
+	std::chrono::steady_clock::time_point phase_start_;
+
+	static double milliseconds(const std::chrono::steady_clock::duration d) { return std::chrono::duration<double, std::milli>(d).count(); }
+};
 }
 
-MStatus mpb::NodeBase::addNodes(void) throw(mpb::MStatusException)
+MStatus mpb::NodeBase::addNodes(void)
 {
 	MStatus ret = MStatus::kSuccess;
 
 	//ADD NODES
 
+	// memoSpecを定義したノードの計算結果キャッシュ（ノードタイプごとの上限）
+	//MemoCache::setDefaultBudget(64 << 20);
+	//MemoCache::setBudget("HOGEHOGE", 256 << 20);
+
+	// computeの例外の要約をログへ出力する間隔（秒）。0で要約を出さない
+	//ErrorAggregator::setReportInterval(10);
+
 	//addNode<HOGEHOGE>();
 
+	// ジオメトリキャッシュの読み込みノード（node/GeometryCacheNode.hpp）
+	//addNode<GeometryCacheNode>();
+
 	return ret;
 }
 
-MStatus mpb::CommandBase::addCommands(void) throw(mpb::MStatusException)
+MStatus mpb::CommandBase::addCommands(void)
 {
 	MStatus ret = MStatus::kSuccess;
 
@@ -35,7 +75,7 @@ MStatus mpb::CommandBase::addCommands(void) throw(mpb::MStatusException)
 	return ret;
 }
 
-MStatus mpb::TranslatorBase::addTranslators(void) throw(mpb::MStatusException)
+MStatus mpb::TranslatorBase::addTranslators(void)
 {
 	MStatus ret = MStatus::kSuccess;
 
@@ -43,6 +83,9 @@ MStatus mpb::TranslatorBase::addTranslators(void) throw(mpb::MStatusException)
 
 	//addTranslator<HOGEHOGE>();
 
+	// ジオメトリキャッシュ（translator/GeometryCacheTranslator.hpp）。書き出すにはsampleFrameを定義した継承クラスを登録する
+	//addTranslator<GeometryCacheTranslator>();
+
 	return ret;
 }
 
@@ -66,35 +109,47 @@ MStatus initializePlugin(MObject obj) {
 
 	MStatus stat = MStatus::kSuccess;
 
-	std::cerr << "* " << kProjectName << " plug-in version " << kVersion << std::endl;
+	MPB_LOG_INFO("* %s plug-in version %s", kProjectName, kVersion);
 
 #ifdef _DEBUG
 	std::cout.rdbuf(std::cerr.rdbuf());
-	std::cout << "- [NOTICE] This plug-in is builded in development mode." << kVersion << std::endl;
+	MPB_LOG_INFO("- [NOTICE] This plug-in is builded in development mode.%s", kVersion);
 #endif
 
 	mpb::NodeBase::_setMFnPluginPtr(plugin.get());
 	mpb::CommandBase::_setMFnPluginPtr(plugin.get());
 	mpb::TranslatorBase::_setMFnPluginPtr(plugin.get());
 
+	PhaseTimer timer;
 	try {
-		std::cout << "- add Nodes." << std::endl;
+		MPB_LOG_INFO("- add Nodes.");
 		mpb::NodeBase::addNodes();
+		timer.lap("nodes");
 
-		std::cout << "- add Commands." << std::endl;
+		MPB_LOG_INFO("- add Commands.");
+		mpb::CommandBase::addBuiltinCommands();
 		mpb::CommandBase::addCommands();
+		timer.lap("commands");
 		
-		std::cout << "- add Translator." << std::endl;
+		MPB_LOG_INFO("- add Translator.");
 		mpb::TranslatorBase::addTranslators();
+		timer.lap("translators");
 
 
 		// ALL Succeed!!
-		std::cout << "- Completed initializing successfully." << std::endl;
+		MPB_LOG_INFO("- Completed initializing successfully. (%g ms)", timer.total());
 	}
-	catch (mpb::MStatusException e) {
-		std::cerr << e << std::endl;
-		std::cerr << "Failed to load " << kProjectName << " plug-in." << std::endl;
+	catch (const mpb::MStatusException & e) {
+		MPB_LOG_ERROR("%s", e.toString().asChar());
+		MPB_LOG_ERROR("Failed to load %s plug-in.", kProjectName);
 		stat = e;
+
+		// 初期化に失敗するとuninitializePluginは呼ばれずにDLLがアンロードされるので、ここでワーカースレッドを止める
+		mpb::NodeBase::_finishPrepares();
+		mpb::AsyncComputeQueue::shutdownGlobal();
+		mpb::ThreadPool::shutdownGlobal();
+		mpb::ErrorAggregator::report();
+		mpb::Logger::shutdownGlobal();
 	}
 
 	return stat;
@@ -105,21 +160,28 @@ MStatus uninitializePlugin(MObject obj) {
 	MFnPlugin plugin(obj);
 	MStatus stat = MStatus::kSuccess;
 
-	std::cout << "* [NOTICE] Start to uninitialize " << kProjectName << " plug-in." << std::endl;
+	MPB_LOG_INFO("* [NOTICE] Start to uninitialize %s plug-in.", kProjectName);
 
 	do {
 
-		std::cout << "- remove Nodes." << std::endl;
+		MPB_LOG_INFO("- remove Nodes.");
 		if ((stat = mpb::NodeBase::removeNodes(plugin)) != MStatus::kSuccess) break;
 
-		std::cout << "- remove Commands." << std::endl;
+		MPB_LOG_INFO("- remove Commands.");
 		if ((stat = mpb::CommandBase::removeCommands(plugin)) != MStatus::kSuccess) break;
 
-		std::cout << "- remove Translators." << std::endl;
+		MPB_LOG_INFO("- remove Translators.");
 		if ((stat = mpb::TranslatorBase::removeTranslators(plugin)) != MStatus::kSuccess) break;
 
 	} while (false);
 
+	// DLLがアンロードされる前にワーカースレッドを停止させる。非同期計算のジョブはThreadPoolを使う場合があるので先に止める
+	mpb::AsyncComputeQueue::shutdownGlobal();
+	mpb::ThreadPool::shutdownGlobal();
+	// 前回の要約以降の例外の件数と、ワーカーが最後に書いたログも出力してからドレインスレッドを止める
+	mpb::ErrorAggregator::report();
+	mpb::Logger::shutdownGlobal();
+
 	return stat;
 }
 
@@ -128,59 +190,85 @@ MStatus uninitializePlugin(MObject obj) {
 MStatus mpb::NodeBase::removeNodes(MFnPlugin & plugin)
 {
 	MStatus ret = MStatus::kSuccess;
-	for (auto ptr = NodeBase::instances_.begin(); ptr != NodeBase::instances_.end(); ++ptr) {
-		if ((ret = plugin.deregisterNode((*ptr)->id_)) == MStatus::kSuccess) {
-			std::cout << "-- deregistered " << (*ptr)->name_ << std::endl;
+	NodeBase::_finishPrepares();
+	for (auto ptr = NodeBase::registered_.begin(); ptr != NodeBase::registered_.end(); ++ptr) {
+		if ((ret = plugin.deregisterNode(ptr->id)) == MStatus::kSuccess) {
+			MPB_LOG_INFO("-- deregistered %s", ptr->name.asChar());
 		}
 		else {
-			std::cerr << "-- Failed to deregister node. NODE : " << (*ptr)->name_ << std::endl;
+			MPB_LOG_ERROR("-- Failed to deregister node. NODE : %s", ptr->name.asChar());
 			break;
 		}
 	}
+	if (ret == MStatus::kSuccess) NodeBase::registered_.clear();
 	return ret;
 }
 
 void mpb::NodeBase::_setMFnPluginPtr(MFnPlugin * plugin) { NodeBase::plugin_ = plugin; }
-void mpb::NodeBase::_addNode(void *(*creator)(), MStatus(*initialize)(), std::unique_ptr<NodeBase> && node)
-{ NodeBase::plugin_->registerNode(node->name_, node->id_, creator, initialize, node->type_, (node->own_classification_ ? &node->classification_ : nullptr)); }
+void mpb::NodeBase::_addNode(void *(*creator)(), MStatus(*initialize)(), const MString & name, const MTypeId & id, const MPxNode::Type type, const MString * classification)
+{
+	MStatusException::throwIf(NodeBase::plugin_->registerNode(name, id, creator, initialize, type, classification),
+		[&name] { return "ノードの登録に失敗 : " + name; }, "mpb::NodeBase::_addNode");
+	// 登録したものだけを記録し、removeNodesで解除する
+	NodeBase::registered_.push_back(Registered{ name, id });
+}
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // COMMAND
 MStatus mpb::CommandBase::removeCommands(MFnPlugin & plugin)
 {
 	MStatus ret = MStatus::kSuccess;
-	for (auto ptr = CommandBase::instances_.begin(); ptr != CommandBase::instances_.end(); ++ptr) {
-		if ((ret = plugin.deregisterCommand((*ptr)->command_)) == MStatus::kSuccess) {
-			std::cout << "-- deregistered " << (*ptr)->command_ << std::endl;
+	for (auto ptr = CommandBase::registered_.begin(); ptr != CommandBase::registered_.end(); ++ptr) {
+		if ((ret = plugin.deregisterCommand(*ptr)) == MStatus::kSuccess) {
+			MPB_LOG_INFO("-- deregistered %s", ptr->asChar());
 		}else{
-			std::cerr << "Failed to deregister command. COMMAND : " << (*ptr)->command_ << std::endl;
+			MPB_LOG_ERROR("Failed to deregister command. COMMAND : %s", ptr->asChar());
 			break;
 		}
 	}
+	if (ret == MStatus::kSuccess) CommandBase::registered_.clear();
 	return ret;
 }
 
+MStatus mpb::CommandBase::addBuiltinCommands(void)
+{
+	addCommand<ComputeProfilerCommand>();
+	return MStatus::kSuccess;
+}
+
 void mpb::CommandBase::_setMFnPluginPtr(MFnPlugin * plugin) { CommandBase::plugin_ = plugin; }
-void mpb::CommandBase::_addCommand(void *(*creator)(), std::unique_ptr<CommandBase>&& command)
-{ CommandBase::plugin_->registerCommand(command->command_, creator); }
+void mpb::CommandBase::_addCommand(void *(*creator)(), const MString & command)
+{
+	MStatusException::throwIf(CommandBase::plugin_->registerCommand(command, creator), [&command] { return "コマンドの登録に失敗 : " + command; }, "mpb::CommandBase::_addCommand");
+	// 登録したものだけを記録し、removeCommandsで解除する
+	CommandBase::registered_.push_back(command);
+}
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // TRANSLATOR
 MStatus mpb::TranslatorBase::removeTranslators(MFnPlugin & plugin)
 {
 	MStatus ret = MStatus::kSuccess;
-	for (auto ptr = TranslatorBase::instances_.begin(); ptr != TranslatorBase::instances_.end(); ++ptr) {
-		if ((ret = plugin.deregisterFileTranslator((*ptr)->name_)) == MStatus::kSuccess) {
-			std::cout << "-- deregistered " << (*ptr)->name_ << std::endl;
+	for (auto ptr = TranslatorBase::registered_.begin(); ptr != TranslatorBase::registered_.end(); ++ptr) {
+		if ((ret = plugin.deregisterFileTranslator(*ptr)) == MStatus::kSuccess) {
+			MPB_LOG_INFO("-- deregistered %s", ptr->asChar());
 		}
 		else {
-			std::cerr << "Failed to deregister command. COMMAND : " << (*ptr)->name_ << std::endl;
+			MPB_LOG_ERROR("Failed to deregister translator. TRANSLATOR : %s", ptr->asChar());
 			break;
 		}
 	}
+	if (ret == MStatus::kSuccess) TranslatorBase::registered_.clear();
 	return ret;
 }
 
 void mpb::TranslatorBase::_setMFnPluginPtr(MFnPlugin * plugin) { TranslatorBase::plugin_ = plugin; }
-void mpb::TranslatorBase::_addTranslator(void * (*creator)(), std::unique_ptr<TranslatorBase> && translator)
-{ TranslatorBase::plugin_->registerFileTranslator(translator->name_, nullptr, creator); }
+void mpb::TranslatorBase::_addTranslator(void * (*creator)(), const MString & name, const MString & pixmap_name, const MString & options_script_name, const MString & default_options_string)
+{
+	const auto optional = [](const MString & str) { return (str.length() > 0 ? str.asChar() : nullptr); };
+	MStatusException::throwIf(TranslatorBase::plugin_->registerFileTranslator(name, optional(pixmap_name), creator,
+		optional(options_script_name), optional(default_options_string)),
+		[&name] { return "トランスレーターの登録に失敗 : " + name; }, "mpb::TranslatorBase::_addTranslator");
+	// 登録したものだけを記録し、removeTranslatorsで解除する
+	TranslatorBase::registered_.push_back(name);
+}
@@ -0,0 +1,220 @@
+﻿/// @file SimdKernelImpl.hpp
+/// @brief SIMDカーネルの命令セット共通の実装（内部用）
+///
+/// 各命令セットの翻訳単位(SimdKernelsXXX.cpp)が、レジスタ操作をまとめたTraitsを定義してこのヘッダをインクルードし、
+/// KernelImpl<Traits>からKernelTableを作ります。端数の要素は同じ式をScalarTraitsで計算します。
+///
+/// 翻訳単位ごとにコンパイルオプション(-mavx2等)が異なるため、Traitsは必ず無名名前空間で定義してください。
+/// KernelImplとScalarTraitsはTraitsごとに別の型になり、上位の命令セットでコンパイルされた実体を
+/// リンカが他の翻訳単位と共有してしまうこと（非対応CPUでの不正命令）を防ぎます。
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_SIMD_KERNEL_IMPL_HPP_
+#define _MAYA_PLUGIN_BASE_SIMD_KERNEL_IMPL_HPP_
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+namespace mpb {
+namespace simd {
+namespace detail {
+
+/// @brief 型ごとのカーネルの関数ポインタ
+template <class T>
+struct TypedKernels {
+	void (*transform_points)(const double * m, const T * x, const T * y, const T * z, T * ox, T * oy, T * oz, size_t n);
+	void (*transform_vectors)(const double * m, const T * x, const T * y, const T * z, T * ox, T * oy, T * oz, size_t n);
+	void (*blend_points)(const T * bx, const T * by, const T * bz, const T * tx, const T * ty, const T * tz, const T * w, T envelope, T * ox, T * oy, T * oz, size_t n);
+	void (*normalize)(const T * x, const T * y, const T * z, T * ox, T * oy, T * oz, size_t n);
+	void (*distances)(const T * x, const T * y, const T * z, T cx, T cy, T cz, T * out, size_t n);
+	void (*falloff)(const T * d, T radius, T * out, size_t n);
+	void (*clamp)(const T * v, T lo, T hi, T * out, size_t n);
+	void (*lerp)(const T * a, const T * b, const T * t, T * out, size_t n);
+};
+
+/// @brief 命令セット1つ分のカーネル
+struct KernelTable {
+	TypedKernels<double> f64;
+	TypedKernels<float> f32;
+};
+
+/// @brief 各命令セットのカーネル。コンパイル対象外の環境ではnullptr
+const KernelTable * scalarKernels(void) noexcept;
+const KernelTable * sse2Kernels(void) noexcept;
+const KernelTable * avx2Kernels(void) noexcept;
+const KernelTable * avx512Kernels(void) noexcept;
+
+
+/// @brief スカラーのTraits（基準実装、端数処理用）
+///
+/// @tparam Tag 翻訳単位ごとに実体を分けるための型
+///
+template <class T, class Tag>
+struct ScalarTraits {
+	typedef T value_type;
+	typedef T reg;
+	static constexpr size_t kWidth = 1;
+	static reg load(const T * p) { return *p; }
+	static void store(T * p, const reg v) { *p = v; }
+	static reg set1(const T v) { return v; }
+	static reg add(const reg a, const reg b) { return a + b; }
+	static reg sub(const reg a, const reg b) { return a - b; }
+	static reg mul(const reg a, const reg b) { return a * b; }
+	static reg div(const reg a, const reg b) { return a / b; }
+	static reg madd(const reg a, const reg b, const reg c) { return a * b + c; }
+	static reg min(const reg a, const reg b) { return (b < a ? b : a); }
+	static reg max(const reg a, const reg b) { return (a < b ? b : a); }
+	static reg sqrt(const reg a) { return std::sqrt(a); }
+};
+
+
+/// @brief カーネルの本体
+///
+/// 各関数は、まずVの幅で処理し、残りをScalarTraitsで処理します。
+/// 1反復の中ではすべてロードしてからストアするため、入力と出力が同じ配列でも正しく動作します。
+///
+template <class V>
+struct KernelImpl {
+	typedef typename V::value_type T;
+	typedef typename V::reg R;
+	typedef ScalarTraits<T, V> S;
+
+	template <class W, bool kTranslate>
+	static size_t transformBlock(const double * m, const T * x, const T * y, const T * z, T * ox, T * oy, T * oz, size_t i, const size_t n) {
+		typedef typename W::reg WR;
+		const WR m00 = W::set1(T(m[0])), m01 = W::set1(T(m[1])), m02 = W::set1(T(m[2]));
+		const WR m10 = W::set1(T(m[4])), m11 = W::set1(T(m[5])), m12 = W::set1(T(m[6]));
+		const WR m20 = W::set1(T(m[8])), m21 = W::set1(T(m[9])), m22 = W::set1(T(m[10]));
+		const WR m30 = W::set1(kTranslate ? T(m[12]) : T(0)), m31 = W::set1(kTranslate ? T(m[13]) : T(0)), m32 = W::set1(kTranslate ? T(m[14]) : T(0));
+		for (; i + W::kWidth <= n; i += W::kWidth) {
+			const WR px = W::load(x + i), py = W::load(y + i), pz = W::load(z + i);
+			const WR rx = W::madd(px, m00, W::madd(py, m10, W::madd(pz, m20, m30)));
+			const WR ry = W::madd(px, m01, W::madd(py, m11, W::madd(pz, m21, m31)));
+			const WR rz = W::madd(px, m02, W::madd(py, m12, W::madd(pz, m22, m32)));
+			W::store(ox + i, rx); W::store(oy + i, ry); W::store(oz + i, rz);
+		}
+		return i;
+	}
+
+	static void transformPoints(const double * m, const T * x, const T * y, const T * z, T * ox, T * oy, T * oz, const size_t n) {
+		const size_t i = transformBlock<V, true>(m, x, y, z, ox, oy, oz, 0, n);
+		transformBlock<S, true>(m, x, y, z, ox, oy, oz, i, n);
+	}
+
+	static void transformVectors(const double * m, const T * x, const T * y, const T * z, T * ox, T * oy, T * oz, const size_t n) {
+		const size_t i = transformBlock<V, false>(m, x, y, z, ox, oy, oz, 0, n);
+		transformBlock<S, false>(m, x, y, z, ox, oy, oz, i, n);
+	}
+
+	template <class W>
+	static size_t blendBlock(const T * bx, const T * by, const T * bz, const T * tx, const T * ty, const T * tz, const T * w, const T envelope, T * ox, T * oy, T * oz, size_t i, const size_t n) {
+		typedef typename W::reg WR;
+		const WR env = W::set1(envelope);
+		for (; i + W::kWidth <= n; i += W::kWidth) {
+			const WR k = (w ? W::mul(W::load(w + i), env) : env);
+			const WR x0 = W::load(bx + i), y0 = W::load(by + i), z0 = W::load(bz + i);
+			const WR rx = W::madd(W::sub(W::load(tx + i), x0), k, x0);
+			const WR ry = W::madd(W::sub(W::load(ty + i), y0), k, y0);
+			const WR rz = W::madd(W::sub(W::load(tz + i), z0), k, z0);
+			W::store(ox + i, rx); W::store(oy + i, ry); W::store(oz + i, rz);
+		}
+		return i;
+	}
+
+	static void blendPoints(const T * bx, const T * by, const T * bz, const T * tx, const T * ty, const T * tz, const T * w, const T envelope, T * ox, T * oy, T * oz, const size_t n) {
+		const size_t i = blendBlock<V>(bx, by, bz, tx, ty, tz, w, envelope, ox, oy, oz, 0, n);
+		blendBlock<S>(bx, by, bz, tx, ty, tz, w, envelope, ox, oy, oz, i, n);
+	}
+
+	template <class W>
+	static size_t normalizeBlock(const T * x, const T * y, const T * z, T * ox, T * oy, T * oz, size_t i, const size_t n) {
+		typedef typename W::reg WR;
+		// 長さ0のベクトルは 0 * (1 / 最小正規化数) = 0 のまま残る
+		const WR tiny = W::set1(std::numeric_limits<T>::min());
+		const WR one = W::set1(T(1));
+		for (; i + W::kWidth <= n; i += W::kWidth) {
+			const WR px = W::load(x + i), py = W::load(y + i), pz = W::load(z + i);
+			const WR len = W::sqrt(W::madd(px, px, W::madd(py, py, W::mul(pz, pz))));
+			const WR inv = W::div(one, W::max(len, tiny));
+			W::store(ox + i, W::mul(px, inv)); W::store(oy + i, W::mul(py, inv)); W::store(oz + i, W::mul(pz, inv));
+		}
+		return i;
+	}
+
+	static void normalize(const T * x, const T * y, const T * z, T * ox, T * oy, T * oz, const size_t n) {
+		const size_t i = normalizeBlock<V>(x, y, z, ox, oy, oz, 0, n);
+		normalizeBlock<S>(x, y, z, ox, oy, oz, i, n);
+	}
+
+	template <class W>
+	static size_t distanceBlock(const T * x, const T * y, const T * z, const T cx, const T cy, const T cz, T * out, size_t i, const size_t n) {
+		typedef typename W::reg WR;
+		const WR vcx = W::set1(cx), vcy = W::set1(cy), vcz = W::set1(cz);
+		for (; i + W::kWidth <= n; i += W::kWidth) {
+			const WR dx = W::sub(W::load(x + i), vcx), dy = W::sub(W::load(y + i), vcy), dz = W::sub(W::load(z + i), vcz);
+			W::store(out + i, W::sqrt(W::madd(dx, dx, W::madd(dy, dy, W::mul(dz, dz)))));
+		}
+		return i;
+	}
+
+	static void distances(const T * x, const T * y, const T * z, const T cx, const T cy, const T cz, T * out, const size_t n) {
+		const size_t i = distanceBlock<V>(x, y, z, cx, cy, cz, out, 0, n);
+		distanceBlock<S>(x, y, z, cx, cy, cz, out, i, n);
+	}
+
+	template <class W>
+	static size_t falloffBlock(const T * d, const T radius, T * out, size_t i, const size_t n) {
+		typedef typename W::reg WR;
+		const WR inv_r = W::set1(T(1) / radius);
+		const WR zero = W::set1(T(0)), one = W::set1(T(1)), two = W::set1(T(2)), three = W::set1(T(3));
+		for (; i + W::kWidth <= n; i += W::kWidth) {
+			const WR s = W::min(W::max(W::mul(W::load(d + i), inv_r), zero), one);
+			// 1 - s*s*(3 - 2s)
+			W::store(out + i, W::sub(one, W::mul(W::mul(s, s), W::sub(three, W::mul(two, s)))));
+		}
+		return i;
+	}
+
+	static void falloff(const T * d, const T radius, T * out, const size_t n) {
+		const size_t i = falloffBlock<V>(d, radius, out, 0, n);
+		falloffBlock<S>(d, radius, out, i, n);
+	}
+
+	template <class W>
+	static size_t clampBlock(const T * v, const T lo, const T hi, T * out, size_t i, const size_t n) {
+		typedef typename W::reg WR;
+		const WR vlo = W::set1(lo), vhi = W::set1(hi);
+		for (; i + W::kWidth <= n; i += W::kWidth) W::store(out + i, W::min(W::max(W::load(v + i), vlo), vhi));
+		return i;
+	}
+
+	static void clamp(const T * v, const T lo, const T hi, T * out, const size_t n) {
+		const size_t i = clampBlock<V>(v, lo, hi, out, 0, n);
+		clampBlock<S>(v, lo, hi, out, i, n);
+	}
+
+	template <class W>
+	static size_t lerpBlock(const T * a, const T * b, const T * t, T * out, size_t i, const size_t n) {
+		typedef typename W::reg WR;
+		for (; i + W::kWidth <= n; i += W::kWidth) {
+			const WR va = W::load(a + i);
+			W::store(out + i, W::madd(W::sub(W::load(b + i), va), W::load(t + i), va));
+		}
+		return i;
+	}
+
+	static void lerp(const T * a, const T * b, const T * t, T * out, const size_t n) {
+		const size_t i = lerpBlock<V>(a, b, t, out, 0, n);
+		lerpBlock<S>(a, b, t, out, i, n);
+	}
+
+	static TypedKernels<T> table(void) {
+		return TypedKernels<T>{ &transformPoints, &transformVectors, &blendPoints, &normalize, &distances, &falloff, &clamp, &lerp };
+	}
+};
+
+}; // end of detail
+}; // end of simd
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_SIMD_KERNEL_IMPL_HPP_
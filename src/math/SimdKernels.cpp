@@ -0,0 +1,189 @@
+﻿#include "math/SimdKernels.hpp"
+#include "math/SimdKernelImpl.hpp"
+#include "exception/MStatusException.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#define MPB_SIMD_X86
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#define MPB_SIMD_X86
+#endif
+
+namespace {
+
+struct ScalarTag {};
+
+#ifdef MPB_SIMD_X86
+void cpuid(const unsigned int leaf, const unsigned int subleaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+	int r[4];
+	__cpuidex(r, static_cast<int>(leaf), static_cast<int>(subleaf));
+	for (int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned int>(r[i]);
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+unsigned long long xgetbv0(void) {
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	unsigned int eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+	return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+mpb::simd::Isa detect(void) noexcept {
+	using mpb::simd::Isa;
+#ifdef MPB_SIMD_X86
+	unsigned int r[4];
+	cpuid(0, 0, r);
+	const unsigned int max_leaf = r[0];
+	cpuid(1, 0, r);
+	const bool sse2 = (r[3] & (1u << 26)) != 0;
+	const bool fma = (r[2] & (1u << 12)) != 0;
+	const bool osxsave = (r[2] & (1u << 27)) != 0;
+	if (!sse2) return Isa::kScalar;
+	if (!osxsave || max_leaf < 7) return Isa::kSSE2;
+
+	// OSがYMM/ZMMレジスタを保存するか
+	const unsigned long long xcr0 = xgetbv0();
+	const bool os_avx = (xcr0 & 0x6) == 0x6;
+	const bool os_avx512 = (xcr0 & 0xE6) == 0xE6;
+	cpuid(7, 0, r);
+	const bool avx2 = (r[1] & (1u << 5)) != 0;
+	const bool avx512f = (r[1] & (1u << 16)) != 0;
+
+	if (avx512f && os_avx512 && mpb::simd::detail::avx512Kernels()) return Isa::kAVX512;
+	if (avx2 && fma && os_avx && mpb::simd::detail::avx2Kernels()) return Isa::kAVX2;
+	return (mpb::simd::detail::sse2Kernels() ? Isa::kSSE2 : Isa::kScalar);
+#else
+	return Isa::kScalar;
+#endif
+}
+
+const mpb::simd::detail::KernelTable * tableOf(const mpb::simd::Isa isa) noexcept {
+	using mpb::simd::Isa;
+	switch (isa) {
+	case Isa::kAVX512: return mpb::simd::detail::avx512Kernels();
+	case Isa::kAVX2: return mpb::simd::detail::avx2Kernels();
+	case Isa::kSSE2: return mpb::simd::detail::sse2Kernels();
+	default: return mpb::simd::detail::scalarKernels();
+	}
+}
+
+std::atomic<const mpb::simd::detail::KernelTable *> g_table(nullptr);
+std::atomic<int> g_isa(-1);
+
+/// @brief 初回呼び出し時に、検出結果と環境変数MPB_SIMDから使用する命令セットを決める
+const mpb::simd::detail::KernelTable & kernels(void) noexcept {
+	const mpb::simd::detail::KernelTable * table = g_table.load(std::memory_order_acquire);
+	if (table) return *table;
+
+	mpb::simd::Isa isa = mpb::simd::detectedIsa();
+	if (const char * env = std::getenv("MPB_SIMD")) {
+		if (std::strcmp(env, "scalar") == 0) isa = mpb::simd::Isa::kScalar;
+		else if (std::strcmp(env, "sse2") == 0) isa = mpb::simd::Isa::kSSE2;
+		else if (std::strcmp(env, "avx2") == 0) isa = mpb::simd::Isa::kAVX2;
+		else if (std::strcmp(env, "avx512") == 0) isa = mpb::simd::Isa::kAVX512;
+	}
+	mpb::simd::setIsa(isa);
+	return *g_table.load(std::memory_order_acquire);
+}
+
+}
+
+const mpb::simd::detail::KernelTable * mpb::simd::detail::scalarKernels(void) noexcept
+{
+	static const KernelTable table{ KernelImpl<ScalarTraits<double, ScalarTag>>::table(), KernelImpl<ScalarTraits<float, ScalarTag>>::table() };
+	return &table;
+}
+
+mpb::simd::Isa mpb::simd::detectedIsa(void) noexcept
+{
+	// 上位の命令セットのカーネル表は、対応を確認してからでないと参照できない
+	static const Isa detected = detect();
+	return detected;
+}
+
+mpb::simd::Isa mpb::simd::activeIsa(void) noexcept
+{
+	kernels();
+	return static_cast<Isa>(g_isa.load(std::memory_order_acquire));
+}
+
+mpb::simd::Isa mpb::simd::setIsa(const Isa isa) noexcept
+{
+	Isa target = (static_cast<int>(isa) > static_cast<int>(detectedIsa()) ? detectedIsa() : isa);
+	// 中間の命令セットがコンパイルされていない場合は下位へ
+	while (target != Isa::kScalar && !tableOf(target)) target = static_cast<Isa>(static_cast<int>(target) - 1);
+	g_isa.store(static_cast<int>(target), std::memory_order_release);
+	g_table.store(tableOf(target), std::memory_order_release);
+	return target;
+}
+
+const char * mpb::simd::isaName(const Isa isa) noexcept
+{
+	switch (isa) {
+	case Isa::kSSE2: return "sse2";
+	case Isa::kAVX2: return "avx2";
+	case Isa::kAVX512: return "avx512";
+	default: return "scalar";
+	}
+}
+
+
+void mpb::simd::transformPoints(const MMatrix & m, const double * x, const double * y, const double * z, double * out_x, double * out_y, double * out_z, const size_t count)
+{ kernels().f64.transform_points(&m.matrix[0][0], x, y, z, out_x, out_y, out_z, count); }
+void mpb::simd::transformPoints(const MMatrix & m, const float * x, const float * y, const float * z, float * out_x, float * out_y, float * out_z, const size_t count)
+{ kernels().f32.transform_points(&m.matrix[0][0], x, y, z, out_x, out_y, out_z, count); }
+
+void mpb::simd::transformVectors(const MMatrix & m, const double * x, const double * y, const double * z, double * out_x, double * out_y, double * out_z, const size_t count)
+{ kernels().f64.transform_vectors(&m.matrix[0][0], x, y, z, out_x, out_y, out_z, count); }
+void mpb::simd::transformVectors(const MMatrix & m, const float * x, const float * y, const float * z, float * out_x, float * out_y, float * out_z, const size_t count)
+{ kernels().f32.transform_vectors(&m.matrix[0][0], x, y, z, out_x, out_y, out_z, count); }
+
+void mpb::simd::blendPoints(const double * base_x, const double * base_y, const double * base_z, const double * target_x, const double * target_y, const double * target_z,
+	const double * weights, const double envelope, double * out_x, double * out_y, double * out_z, const size_t count)
+{ kernels().f64.blend_points(base_x, base_y, base_z, target_x, target_y, target_z, weights, envelope, out_x, out_y, out_z, count); }
+void mpb::simd::blendPoints(const float * base_x, const float * base_y, const float * base_z, const float * target_x, const float * target_y, const float * target_z,
+	const float * weights, const float envelope, float * out_x, float * out_y, float * out_z, const size_t count)
+{ kernels().f32.blend_points(base_x, base_y, base_z, target_x, target_y, target_z, weights, envelope, out_x, out_y, out_z, count); }
+
+void mpb::simd::normalize(const double * x, const double * y, const double * z, double * out_x, double * out_y, double * out_z, const size_t count)
+{ kernels().f64.normalize(x, y, z, out_x, out_y, out_z, count); }
+void mpb::simd::normalize(const float * x, const float * y, const float * z, float * out_x, float * out_y, float * out_z, const size_t count)
+{ kernels().f32.normalize(x, y, z, out_x, out_y, out_z, count); }
+
+void mpb::simd::distances(const double * x, const double * y, const double * z, const double center_x, const double center_y, const double center_z, double * out, const size_t count)
+{ kernels().f64.distances(x, y, z, center_x, center_y, center_z, out, count); }
+void mpb::simd::distances(const float * x, const float * y, const float * z, const float center_x, const float center_y, const float center_z, float * out, const size_t count)
+{ kernels().f32.distances(x, y, z, center_x, center_y, center_z, out, count); }
+
+void mpb::simd::falloff(const double * distance, const double radius, double * out, const size_t count)
+{
+	if (!(radius > 0.0)) MStatusException::throwError(MStatus::kInvalidParameter, "falloffの半径が正ではありません", "mpb::simd::falloff");
+	kernels().f64.falloff(distance, radius, out, count);
+}
+void mpb::simd::falloff(const float * distance, const float radius, float * out, const size_t count)
+{
+	if (!(radius > 0.0f)) MStatusException::throwError(MStatus::kInvalidParameter, "falloffの半径が正ではありません", "mpb::simd::falloff");
+	kernels().f32.falloff(distance, radius, out, count);
+}
+
+void mpb::simd::clamp(const double * values, const double lo, const double hi, double * out, const size_t count)
+{ kernels().f64.clamp(values, lo, hi, out, count); }
+void mpb::simd::clamp(const float * values, const float lo, const float hi, float * out, const size_t count)
+{ kernels().f32.clamp(values, lo, hi, out, count); }
+
+void mpb::simd::lerp(const double * a, const double * b, const double * t, double * out, const size_t count)
+{ kernels().f64.lerp(a, b, t, out, count); }
+void mpb::simd::lerp(const float * a, const float * b, const float * t, float * out, const size_t count)
+{ kernels().f32.lerp(a, b, t, out, count); }
@@ -0,0 +1,121 @@
+﻿/// @file SimdKernels.hpp
+/// @brief SoAバッファ向けSIMD演算カーネル
+///
+/// computeProcess内でMPoint/MVector/MMatrixを1点ずつ計算する代わりに、
+/// 成分ごとに分けた配列(SoA: x[], y[], z[])へまとめて適用する関数群です。
+///
+/// 実行時にCPUを判定し、AVX-512 / AVX2(+FMA) / SSE2 / スカラーのうち使える最速の実装を選択します。
+/// スカラー実装は検証用の基準で、setIsa(Isa::kScalar)または環境変数 MPB_SIMD=scalar で強制できます。
+/// FMAの有無によって、実装間で最下位ビット程度の差が出ることがあります。
+///
+/// 入出力には同じ配列を指定できます（その場で更新）。それ以外の重なりは未定義です。
+/// 配列の境界は揃っていなくても構いません。
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_SIMD_KERNELS_HPP_
+#define _MAYA_PLUGIN_BASE_SIMD_KERNELS_HPP_
+
+#include <maya/MMatrix.h>
+#include <cstddef>
+
+namespace mpb {
+namespace simd {
+
+/// @brief 命令セット
+enum class Isa {
+	kScalar,	///< スカラー（検証用の基準）
+	kSSE2,		///< SSE2
+	kAVX2,		///< AVX2 + FMA
+	kAVX512,	///< AVX-512F
+};
+
+
+/// @brief CPUとOSが対応している最上位の命令セット
+Isa detectedIsa(void) noexcept;
+
+/// @brief 現在使用している命令セット
+Isa activeIsa(void) noexcept;
+
+/// @brief 使用する命令セットを変更する
+///
+/// detectedIsaより上位を指定した場合は、detectedIsaになります。
+///
+/// @return 実際に設定された命令セット
+///
+Isa setIsa(const Isa isa) noexcept;
+
+/// @brief 命令セットの名前
+const char * isaName(const Isa isa) noexcept;
+
+
+/// @brief 点群にアフィン変換を適用する
+///
+/// MPoint * MMatrixと同じく行ベクトル規約で、p' = (x, y, z, 1) * m を計算します（wによる除算は行いません）。
+///
+/// @param [in] m 変換行列
+/// @param [in] x,y,z 入力の各成分
+/// @param [out] out_x,out_y,out_z 出力の各成分
+/// @param [in] count 点の数
+///
+void transformPoints(const MMatrix & m, const double * x, const double * y, const double * z, double * out_x, double * out_y, double * out_z, const size_t count);
+void transformPoints(const MMatrix & m, const float * x, const float * y, const float * z, float * out_x, float * out_y, float * out_z, const size_t count);
+
+
+/// @brief ベクトル群に変換行列の回転・スケール部分を適用する
+///
+/// MVector * MMatrixと同じく、平行移動成分は無視します。
+///
+void transformVectors(const MMatrix & m, const double * x, const double * y, const double * z, double * out_x, double * out_y, double * out_z, const size_t count);
+void transformVectors(const MMatrix & m, const float * x, const float * y, const float * z, float * out_x, float * out_y, float * out_z, const size_t count);
+
+
+/// @brief 点群を重み付きでターゲットへ近づける
+///
+/// out = base + (target - base) * weight[i] * envelope を計算します。
+///
+/// @param [in] weights 点ごとの重み。nullptrの場合はすべて1
+/// @param [in] envelope 全体の重み
+///
+void blendPoints(const double * base_x, const double * base_y, const double * base_z,
+	const double * target_x, const double * target_y, const double * target_z,
+	const double * weights, const double envelope, double * out_x, double * out_y, double * out_z, const size_t count);
+void blendPoints(const float * base_x, const float * base_y, const float * base_z,
+	const float * target_x, const float * target_y, const float * target_z,
+	const float * weights, const float envelope, float * out_x, float * out_y, float * out_z, const size_t count);
+
+
+/// @brief ベクトル群を正規化する
+///
+/// 長さ0のベクトルは0のままです。
+///
+void normalize(const double * x, const double * y, const double * z, double * out_x, double * out_y, double * out_z, const size_t count);
+void normalize(const float * x, const float * y, const float * z, float * out_x, float * out_y, float * out_z, const size_t count);
+
+
+/// @brief 各点と中心との距離を求める
+void distances(const double * x, const double * y, const double * z, const double center_x, const double center_y, const double center_z, double * out, const size_t count);
+void distances(const float * x, const float * y, const float * z, const float center_x, const float center_y, const float center_z, float * out, const size_t count);
+
+
+/// @brief 距離から滑らかな減衰の重みを求める
+///
+/// s = clamp(distance / radius, 0, 1) として、1 - smoothstep(s) = 1 - s*s*(3 - 2s) を計算します。
+///
+/// @throws MStatusException radiusが正でない場合(kInvalidParameter)
+///
+void falloff(const double * distance, const double radius, double * out, const size_t count);
+void falloff(const float * distance, const float radius, float * out, const size_t count);
+
+
+/// @brief 値を範囲[lo, hi]に制限する
+void clamp(const double * values, const double lo, const double hi, double * out, const size_t count);
+void clamp(const float * values, const float lo, const float hi, float * out, const size_t count);
+
+
+/// @brief 要素ごとの線形補間 out = a + (b - a) * t[i]
+void lerp(const double * a, const double * b, const double * t, double * out, const size_t count);
+void lerp(const float * a, const float * b, const float * t, float * out, const size_t count);
+
+}; // end of simd
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_SIMD_KERNELS_HPP_
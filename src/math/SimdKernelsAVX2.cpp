@@ -0,0 +1,55 @@
+﻿#include "math/SimdKernelImpl.hpp"
+
+// この翻訳単位だけ -mavx2 -mfma (MSVCでは /arch:AVX2) でコンパイルされる
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define MPB_SIMD_HAS_AVX2
+#include <immintrin.h>
+
+namespace {
+
+struct Avx2Double {
+	typedef double value_type;
+	typedef __m256d reg;
+	static constexpr size_t kWidth = 4;
+	static reg load(const double * p) { return _mm256_loadu_pd(p); }
+	static void store(double * p, const reg v) { _mm256_storeu_pd(p, v); }
+	static reg set1(const double v) { return _mm256_set1_pd(v); }
+	static reg add(const reg a, const reg b) { return _mm256_add_pd(a, b); }
+	static reg sub(const reg a, const reg b) { return _mm256_sub_pd(a, b); }
+	static reg mul(const reg a, const reg b) { return _mm256_mul_pd(a, b); }
+	static reg div(const reg a, const reg b) { return _mm256_div_pd(a, b); }
+	static reg madd(const reg a, const reg b, const reg c) { return _mm256_fmadd_pd(a, b, c); }
+	static reg min(const reg a, const reg b) { return _mm256_min_pd(b, a); }
+	static reg max(const reg a, const reg b) { return _mm256_max_pd(b, a); }
+	static reg sqrt(const reg a) { return _mm256_sqrt_pd(a); }
+};
+
+struct Avx2Float {
+	typedef float value_type;
+	typedef __m256 reg;
+	static constexpr size_t kWidth = 8;
+	static reg load(const float * p) { return _mm256_loadu_ps(p); }
+	static void store(float * p, const reg v) { _mm256_storeu_ps(p, v); }
+	static reg set1(const float v) { return _mm256_set1_ps(v); }
+	static reg add(const reg a, const reg b) { return _mm256_add_ps(a, b); }
+	static reg sub(const reg a, const reg b) { return _mm256_sub_ps(a, b); }
+	static reg mul(const reg a, const reg b) { return _mm256_mul_ps(a, b); }
+	static reg div(const reg a, const reg b) { return _mm256_div_ps(a, b); }
+	static reg madd(const reg a, const reg b, const reg c) { return _mm256_fmadd_ps(a, b, c); }
+	static reg min(const reg a, const reg b) { return _mm256_min_ps(b, a); }
+	static reg max(const reg a, const reg b) { return _mm256_max_ps(b, a); }
+	static reg sqrt(const reg a) { return _mm256_sqrt_ps(a); }
+};
+
+}
+#endif
+
+const mpb::simd::detail::KernelTable * mpb::simd::detail::avx2Kernels(void) noexcept
+{
+#ifdef MPB_SIMD_HAS_AVX2
+	static const KernelTable table{ KernelImpl<Avx2Double>::table(), KernelImpl<Avx2Float>::table() };
+	return &table;
+#else
+	return nullptr;
+#endif
+}
@@ -0,0 +1,59 @@
+﻿#include "math/SimdKernelImpl.hpp"
+
+// この翻訳単位だけ -mavx512f -mfma (MSVCでは /arch:AVX512) でコンパイルされる
+#if defined(__AVX512F__)
+#define MPB_SIMD_HAS_AVX512
+// GCC 12のavx512fintrin.hは_mm512_min_pd等で未初期化の誤検知を出す（GCC 13で修正済み）
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+#include <immintrin.h>
+
+namespace {
+
+struct Avx512Double {
+	typedef double value_type;
+	typedef __m512d reg;
+	static constexpr size_t kWidth = 8;
+	static reg load(const double * p) { return _mm512_loadu_pd(p); }
+	static void store(double * p, const reg v) { _mm512_storeu_pd(p, v); }
+	static reg set1(const double v) { return _mm512_set1_pd(v); }
+	static reg add(const reg a, const reg b) { return _mm512_add_pd(a, b); }
+	static reg sub(const reg a, const reg b) { return _mm512_sub_pd(a, b); }
+	static reg mul(const reg a, const reg b) { return _mm512_mul_pd(a, b); }
+	static reg div(const reg a, const reg b) { return _mm512_div_pd(a, b); }
+	static reg madd(const reg a, const reg b, const reg c) { return _mm512_fmadd_pd(a, b, c); }
+	static reg min(const reg a, const reg b) { return _mm512_min_pd(b, a); }
+	static reg max(const reg a, const reg b) { return _mm512_max_pd(b, a); }
+	static reg sqrt(const reg a) { return _mm512_sqrt_pd(a); }
+};
+
+struct Avx512Float {
+	typedef float value_type;
+	typedef __m512 reg;
+	static constexpr size_t kWidth = 16;
+	static reg load(const float * p) { return _mm512_loadu_ps(p); }
+	static void store(float * p, const reg v) { _mm512_storeu_ps(p, v); }
+	static reg set1(const float v) { return _mm512_set1_ps(v); }
+	static reg add(const reg a, const reg b) { return _mm512_add_ps(a, b); }
+	static reg sub(const reg a, const reg b) { return _mm512_sub_ps(a, b); }
+	static reg mul(const reg a, const reg b) { return _mm512_mul_ps(a, b); }
+	static reg div(const reg a, const reg b) { return _mm512_div_ps(a, b); }
+	static reg madd(const reg a, const reg b, const reg c) { return _mm512_fmadd_ps(a, b, c); }
+	static reg min(const reg a, const reg b) { return _mm512_min_ps(b, a); }
+	static reg max(const reg a, const reg b) { return _mm512_max_ps(b, a); }
+	static reg sqrt(const reg a) { return _mm512_sqrt_ps(a); }
+};
+
+}
+#endif
+
+const mpb::simd::detail::KernelTable * mpb::simd::detail::avx512Kernels(void) noexcept
+{
+#ifdef MPB_SIMD_HAS_AVX512
+	static const KernelTable table{ KernelImpl<Avx512Double>::table(), KernelImpl<Avx512Float>::table() };
+	return &table;
+#else
+	return nullptr;
+#endif
+}
@@ -0,0 +1,54 @@
+﻿#include "math/SimdKernelImpl.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MPB_SIMD_HAS_SSE2
+#include <emmintrin.h>
+
+namespace {
+
+struct Sse2Double {
+	typedef double value_type;
+	typedef __m128d reg;
+	static constexpr size_t kWidth = 2;
+	static reg load(const double * p) { return _mm_loadu_pd(p); }
+	static void store(double * p, const reg v) { _mm_storeu_pd(p, v); }
+	static reg set1(const double v) { return _mm_set1_pd(v); }
+	static reg add(const reg a, const reg b) { return _mm_add_pd(a, b); }
+	static reg sub(const reg a, const reg b) { return _mm_sub_pd(a, b); }
+	static reg mul(const reg a, const reg b) { return _mm_mul_pd(a, b); }
+	static reg div(const reg a, const reg b) { return _mm_div_pd(a, b); }
+	static reg madd(const reg a, const reg b, const reg c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+	static reg min(const reg a, const reg b) { return _mm_min_pd(b, a); }
+	static reg max(const reg a, const reg b) { return _mm_max_pd(b, a); }
+	static reg sqrt(const reg a) { return _mm_sqrt_pd(a); }
+};
+
+struct Sse2Float {
+	typedef float value_type;
+	typedef __m128 reg;
+	static constexpr size_t kWidth = 4;
+	static reg load(const float * p) { return _mm_loadu_ps(p); }
+	static void store(float * p, const reg v) { _mm_storeu_ps(p, v); }
+	static reg set1(const float v) { return _mm_set1_ps(v); }
+	static reg add(const reg a, const reg b) { return _mm_add_ps(a, b); }
+	static reg sub(const reg a, const reg b) { return _mm_sub_ps(a, b); }
+	static reg mul(const reg a, const reg b) { return _mm_mul_ps(a, b); }
+	static reg div(const reg a, const reg b) { return _mm_div_ps(a, b); }
+	static reg madd(const reg a, const reg b, const reg c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	static reg min(const reg a, const reg b) { return _mm_min_ps(b, a); }
+	static reg max(const reg a, const reg b) { return _mm_max_ps(b, a); }
+	static reg sqrt(const reg a) { return _mm_sqrt_ps(a); }
+};
+
+}
+#endif
+
+const mpb::simd::detail::KernelTable * mpb::simd::detail::sse2Kernels(void) noexcept
+{
+#ifdef MPB_SIMD_HAS_SSE2
+	static const KernelTable table{ KernelImpl<Sse2Double>::table(), KernelImpl<Sse2Float>::table() };
+	return &table;
+#else
+	return nullptr;
+#endif
+}
@@ -0,0 +1,249 @@
+﻿#include "SoaBuffer.hpp"
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+
+// サイズクラス k のブロックは kAlignment << k バイト
+size_t sizeClass(const size_t bytes) noexcept {
+	size_t k = 0;
+	while ((mpb::SoaBufferPool::kAlignment << k) < bytes) ++k;
+	return k;
+}
+
+void * alignedAlloc(const size_t bytes) {
+#ifdef _WIN32
+	void * p = _aligned_malloc(bytes, mpb::SoaBufferPool::kAlignment);
+#else
+	void * p = nullptr;
+	if (posix_memalign(&p, mpb::SoaBufferPool::kAlignment, bytes) != 0) p = nullptr;
+#endif
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void alignedFree(void * p) noexcept {
+#ifdef _WIN32
+	_aligned_free(p);
+#else
+	std::free(p);
+#endif
+}
+
+// 要素数が変わった場合は全要素、そうでなければrangeを要素数で切り詰めた範囲
+mpb::DirtyRange effectiveRange(const mpb::DirtyRange & range, const size_t count, const bool resized) noexcept {
+	return resized ? mpb::DirtyRange{ 0, count } : range.clamp(count);
+}
+
+}
+
+const size_t mpb::SoaBufferPool::kAlignment;
+const size_t mpb::SoaBufferPool::kDefaultMaxCachedBytes;
+const size_t mpb::SoaBufferPool::kNumClasses;
+
+mpb::SoaBufferPool & mpb::SoaBufferPool::global(void)
+{
+	static SoaBufferPool pool;
+	return pool;
+}
+
+mpb::SoaBufferPool::SoaBufferPool(const size_t max_cached_bytes)
+	: max_cached_bytes_(max_cached_bytes), cached_bytes_(0), allocations_(0)
+{}
+
+mpb::SoaBufferPool::~SoaBufferPool(void)
+{
+	this->trim();
+}
+
+void * mpb::SoaBufferPool::acquire(const size_t bytes, size_t & capacity)
+{
+	if (bytes == 0) {
+		capacity = 0;
+		return nullptr;
+	}
+	const size_t k = sizeClass(bytes);
+	if (k >= kNumClasses) throw std::bad_alloc();
+	capacity = kAlignment << k;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		if (!this->free_[k].empty()) {
+			void * block = this->free_[k].back();
+			this->free_[k].pop_back();
+			this->cached_bytes_ -= capacity;
+			return block;
+		}
+		++this->allocations_;
+	}
+	return alignedAlloc(capacity);
+}
+
+void mpb::SoaBufferPool::release(void * block, const size_t capacity) noexcept
+{
+	if (!block) return;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		if (this->cached_bytes_ + capacity <= this->max_cached_bytes_) {
+			try {
+				this->free_[sizeClass(capacity)].push_back(block);
+				this->cached_bytes_ += capacity;
+				return;
+			}
+			catch (const std::bad_alloc &) {
+				// 空きリストを伸ばせない場合は解放する
+			}
+		}
+	}
+	alignedFree(block);
+}
+
+void mpb::SoaBufferPool::trim(void) noexcept
+{
+	std::lock_guard<std::mutex> lock(this->mutex_);
+	for (auto & list : this->free_) {
+		for (void * block : list) alignedFree(block);
+		list.clear();
+	}
+	this->cached_bytes_ = 0;
+}
+
+size_t mpb::SoaBufferPool::cachedBytes(void) const
+{
+	std::lock_guard<std::mutex> lock(this->mutex_);
+	return this->cached_bytes_;
+}
+
+size_t mpb::SoaBufferPool::allocations(void) const
+{
+	std::lock_guard<std::mutex> lock(this->mutex_);
+	return this->allocations_;
+}
+
+
+template <class T>
+void mpb::gather(const MPointArray & src, SoaBuffer3<T> & dst, const DirtyRange & range)
+{
+	const size_t count = src.length();
+	const bool resized = (dst.size() != count);
+	dst.resize(count);
+	const DirtyRange r = effectiveRange(range, count, resized);
+	T * x = dst.x.data(); T * y = dst.y.data(); T * z = dst.z.data();
+	for (size_t i = r.begin; i < r.end; ++i) {
+		const MPoint & p = src[static_cast<unsigned int>(i)];
+		x[i] = static_cast<T>(p.x);
+		y[i] = static_cast<T>(p.y);
+		z[i] = static_cast<T>(p.z);
+	}
+}
+
+template <class T>
+void mpb::gather(const MVectorArray & src, SoaBuffer3<T> & dst, const DirtyRange & range)
+{
+	const size_t count = src.length();
+	const bool resized = (dst.size() != count);
+	dst.resize(count);
+	const DirtyRange r = effectiveRange(range, count, resized);
+	T * x = dst.x.data(); T * y = dst.y.data(); T * z = dst.z.data();
+	for (size_t i = r.begin; i < r.end; ++i) {
+		const MVector & v = src[static_cast<unsigned int>(i)];
+		x[i] = static_cast<T>(v.x);
+		y[i] = static_cast<T>(v.y);
+		z[i] = static_cast<T>(v.z);
+	}
+}
+
+template <class T>
+void mpb::gather(const MFloatArray & src, AlignedBuffer<T> & dst, const DirtyRange & range)
+{
+	const size_t count = src.length();
+	const bool resized = (dst.size() != count);
+	dst.resize(count);
+	const DirtyRange r = effectiveRange(range, count, resized);
+	T * out = dst.data();
+	for (size_t i = r.begin; i < r.end; ++i) out[i] = static_cast<T>(src[static_cast<unsigned int>(i)]);
+}
+
+template <class T>
+void mpb::gather(const MDoubleArray & src, AlignedBuffer<T> & dst, const DirtyRange & range)
+{
+	const size_t count = src.length();
+	const bool resized = (dst.size() != count);
+	dst.resize(count);
+	const DirtyRange r = effectiveRange(range, count, resized);
+	T * out = dst.data();
+	for (size_t i = r.begin; i < r.end; ++i) out[i] = static_cast<T>(src[static_cast<unsigned int>(i)]);
+}
+
+template <class T>
+void mpb::scatter(const SoaBuffer3<T> & src, MPointArray & dst, const DirtyRange & range)
+{
+	const size_t count = src.size();
+	const bool resized = (dst.length() != count);
+	if (resized) dst.setLength(static_cast<unsigned int>(count));
+	const DirtyRange r = effectiveRange(range, count, resized);
+	const T * x = src.x.data(); const T * y = src.y.data(); const T * z = src.z.data();
+	for (size_t i = r.begin; i < r.end; ++i) {
+		MPoint & p = dst[static_cast<unsigned int>(i)];
+		p.x = x[i];
+		p.y = y[i];
+		p.z = z[i];
+		p.w = 1.0;
+	}
+}
+
+template <class T>
+void mpb::scatter(const SoaBuffer3<T> & src, MVectorArray & dst, const DirtyRange & range)
+{
+	const size_t count = src.size();
+	const bool resized = (dst.length() != count);
+	if (resized) dst.setLength(static_cast<unsigned int>(count));
+	const DirtyRange r = effectiveRange(range, count, resized);
+	const T * x = src.x.data(); const T * y = src.y.data(); const T * z = src.z.data();
+	for (size_t i = r.begin; i < r.end; ++i) {
+		MVector & v = dst[static_cast<unsigned int>(i)];
+		v.x = x[i];
+		v.y = y[i];
+		v.z = z[i];
+	}
+}
+
+template <class T>
+void mpb::scatter(const AlignedBuffer<T> & src, MFloatArray & dst, const DirtyRange & range)
+{
+	const size_t count = src.size();
+	const bool resized = (dst.length() != count);
+	if (resized) dst.setLength(static_cast<unsigned int>(count));
+	const DirtyRange r = effectiveRange(range, count, resized);
+	const T * in = src.data();
+	for (size_t i = r.begin; i < r.end; ++i) dst[static_cast<unsigned int>(i)] = static_cast<float>(in[i]);
+}
+
+template <class T>
+void mpb::scatter(const AlignedBuffer<T> & src, MDoubleArray & dst, const DirtyRange & range)
+{
+	const size_t count = src.size();
+	const bool resized = (dst.length() != count);
+	if (resized) dst.setLength(static_cast<unsigned int>(count));
+	const DirtyRange r = effectiveRange(range, count, resized);
+	const T * in = src.data();
+	for (size_t i = r.begin; i < r.end; ++i) dst[static_cast<unsigned int>(i)] = static_cast<double>(in[i]);
+}
+
+// 明示的実体化
+#define MPB_SOA_INSTANTIATE(T) \
+	template void mpb::gather<T>(const MPointArray &, SoaBuffer3<T> &, const DirtyRange &); \
+	template void mpb::gather<T>(const MVectorArray &, SoaBuffer3<T> &, const DirtyRange &); \
+	template void mpb::gather<T>(const MFloatArray &, AlignedBuffer<T> &, const DirtyRange &); \
+	template void mpb::gather<T>(const MDoubleArray &, AlignedBuffer<T> &, const DirtyRange &); \
+	template void mpb::scatter<T>(const SoaBuffer3<T> &, MPointArray &, const DirtyRange &); \
+	template void mpb::scatter<T>(const SoaBuffer3<T> &, MVectorArray &, const DirtyRange &); \
+	template void mpb::scatter<T>(const AlignedBuffer<T> &, MFloatArray &, const DirtyRange &); \
+	template void mpb::scatter<T>(const AlignedBuffer<T> &, MDoubleArray &, const DirtyRange &);
+
+MPB_SOA_INSTANTIATE(float)
+MPB_SOA_INSTANTIATE(double)
+
+#undef MPB_SOA_INSTANTIATE
@@ -0,0 +1,275 @@
+﻿/// @file SoaBuffer.hpp
+/// @brief SoAスクラッチバッファと、Mayaの配列型との相互変換
+///
+/// MPointArray / MVectorArray はdoubleの構造体配列(AoS)のため、そのままではSIMDカーネルに渡せません。
+/// ここでは成分ごとに分けた64バイト境界の配列(SoA)へ変換し、計算後に書き戻すための型と関数を定義します。
+///
+/// バッファの確保はSoaBufferPoolから行い、破棄時にはプールへ返却されます。
+/// ノードのメンバとして保持すれば2回目以降のcomputeでは確保も解放も発生せず、
+/// computeProcess内の一時バッファとして使った場合でも、同じサイズであればプールから再利用されます。
+///
+/// gather / scatterはメモリ帯域で律速されるため、要素あたりの演算が少ないカーネルでは変換のコストが計算の削減を上回ります。
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_SOA_BUFFER_HPP_
+#define _MAYA_PLUGIN_BASE_SOA_BUFFER_HPP_
+
+#include <maya/MPointArray.h>
+#include <maya/MVectorArray.h>
+#include <maya/MFloatArray.h>
+#include <maya/MDoubleArray.h>
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace mpb {
+
+/// @brief 64バイト境界のメモリブロックの再利用プール
+///
+/// 2のべき乗のサイズクラスごとに空きブロックを保持します。空きがなければ新たに確保し、返却されたブロックは解放せずに保持します。
+/// 保持する総量がmaxCachedBytesを超える返却は、その場で解放されます。
+///
+class SoaBufferPool {
+public:
+
+	/// @brief ブロックの境界
+	static const size_t kAlignment = 64;
+
+	/// @brief デフォルトの保持上限（バイト）
+	static const size_t kDefaultMaxCachedBytes = size_t(256) << 20;
+
+	/// @brief プラグイン全体で共有するプール
+	static SoaBufferPool & global(void);
+
+	explicit SoaBufferPool(const size_t max_cached_bytes = kDefaultMaxCachedBytes);
+
+	/// @brief デストラクタ
+	///
+	/// 保持しているブロックを解放します。貸し出し中のブロックがすべて返却されてから破棄してください。
+	///
+	~SoaBufferPool(void);
+
+	SoaBufferPool(const SoaBufferPool &) = delete;
+	SoaBufferPool & operator=(const SoaBufferPool &) = delete;
+
+	/// @brief ブロックを借りる
+	///
+	/// @param [in] bytes 必要なバイト数
+	/// @param [out] capacity 実際のブロックのバイト数（サイズクラス）
+	/// @return 64バイト境界のブロック。bytesが0ならnullptr
+	///
+	/// @throws std::bad_alloc 確保に失敗した場合
+	///
+	void * acquire(const size_t bytes, size_t & capacity);
+
+	/// @brief ブロックを返却する
+	///
+	/// @param [in] block acquireで借りたブロック。nullptrは無視されます
+	/// @param [in] capacity acquireで得たバイト数
+	///
+	void release(void * block, const size_t capacity) noexcept;
+
+	/// @brief 保持しているブロックをすべて解放する
+	void trim(void) noexcept;
+
+	/// @brief 保持しているバイト数
+	size_t cachedBytes(void) const;
+
+	/// @brief ブロックを新たに確保した回数
+	size_t allocations(void) const;
+
+private:
+	static const size_t kNumClasses = 48;
+
+	const size_t max_cached_bytes_;
+	std::vector<void *> free_[kNumClasses];
+	size_t cached_bytes_;
+	size_t allocations_;
+	mutable std::mutex mutex_;
+};
+
+
+/// @brief 64バイト境界の要素配列
+///
+/// SoaBufferPoolからブロックを借りて保持する、ムーブのみ可能な配列です。
+/// resizeは容量内であれば確保を行わず、拡張時には既存の要素を引き継ぎます。新たに増えた要素の値は不定です。
+///
+/// @tparam T 要素の型（float, double）
+///
+template <class T>
+class AlignedBuffer {
+public:
+
+	AlignedBuffer(void) noexcept : data_(nullptr), size_(0), capacity_bytes_(0), pool_(&SoaBufferPool::global()) {}
+	explicit AlignedBuffer(SoaBufferPool & pool) noexcept : data_(nullptr), size_(0), capacity_bytes_(0), pool_(&pool) {}
+	~AlignedBuffer(void) { this->pool_->release(this->data_, this->capacity_bytes_); }
+
+	AlignedBuffer(AlignedBuffer && other) noexcept
+		: data_(other.data_), size_(other.size_), capacity_bytes_(other.capacity_bytes_), pool_(other.pool_) {
+		other.data_ = nullptr;
+		other.size_ = other.capacity_bytes_ = 0;
+	}
+	AlignedBuffer & operator=(AlignedBuffer && other) noexcept {
+		if (this != &other) {
+			this->pool_->release(this->data_, this->capacity_bytes_);
+			this->data_ = other.data_;
+			this->size_ = other.size_;
+			this->capacity_bytes_ = other.capacity_bytes_;
+			this->pool_ = other.pool_;
+			other.data_ = nullptr;
+			other.size_ = other.capacity_bytes_ = 0;
+		}
+		return *this;
+	}
+	AlignedBuffer(const AlignedBuffer &) = delete;
+	AlignedBuffer & operator=(const AlignedBuffer &) = delete;
+
+	/// @brief 要素数を変更する
+	///
+	/// @throws std::bad_alloc 確保に失敗した場合
+	///
+	void resize(const size_t size) {
+		if (size * sizeof(T) > this->capacity_bytes_) {
+			size_t capacity_bytes = 0;
+			T * data = static_cast<T *>(this->pool_->acquire(size * sizeof(T), capacity_bytes));
+			if (this->size_ > 0) std::copy(this->data_, this->data_ + this->size_, data);
+			this->pool_->release(this->data_, this->capacity_bytes_);
+			this->data_ = data;
+			this->capacity_bytes_ = capacity_bytes;
+		}
+		this->size_ = size;
+	}
+
+	/// @brief ブロックをプールへ返却し、空にする
+	void release(void) noexcept {
+		this->pool_->release(this->data_, this->capacity_bytes_);
+		this->data_ = nullptr;
+		this->size_ = this->capacity_bytes_ = 0;
+	}
+
+	T * data(void) noexcept { return this->data_; }
+	const T * data(void) const noexcept { return this->data_; }
+	size_t size(void) const noexcept { return this->size_; }
+	size_t capacity(void) const noexcept { return this->capacity_bytes_ / sizeof(T); }
+	bool empty(void) const noexcept { return this->size_ == 0; }
+	T & operator[](const size_t i) noexcept { return this->data_[i]; }
+	const T & operator[](const size_t i) const noexcept { return this->data_[i]; }
+	T * begin(void) noexcept { return this->data_; }
+	T * end(void) noexcept { return this->data_ + this->size_; }
+	const T * begin(void) const noexcept { return this->data_; }
+	const T * end(void) const noexcept { return this->data_ + this->size_; }
+
+private:
+	T * data_;
+	size_t size_;
+	size_t capacity_bytes_;
+	SoaBufferPool * pool_;
+};
+
+
+/// @brief 3成分のSoAバッファ
+///
+/// x[], y[], z[]をそれぞれ64バイト境界の配列で保持します。simd::transformPoints等へそのまま渡せます。
+/// MPointのw成分は保持しません（書き戻し時は1になります）。
+///
+/// @tparam T 成分の型（float, double）
+///
+template <class T>
+class SoaBuffer3 {
+public:
+
+	AlignedBuffer<T> x, y, z;
+
+	SoaBuffer3(void) noexcept {}
+	explicit SoaBuffer3(SoaBufferPool & pool) noexcept : x(pool), y(pool), z(pool) {}
+
+	/// @brief 要素数を変更する
+	void resize(const size_t size) {
+		this->x.resize(size);
+		this->y.resize(size);
+		this->z.resize(size);
+	}
+
+	/// @brief ブロックをプールへ返却し、空にする
+	void release(void) noexcept {
+		this->x.release();
+		this->y.release();
+		this->z.release();
+	}
+
+	size_t size(void) const noexcept { return this->x.size(); }
+	bool empty(void) const noexcept { return this->x.empty(); }
+};
+
+
+/// @brief 変換対象の要素範囲[begin, end)
+///
+/// 入力のうち変更された要素だけを変換し直す場合に指定します。endは要素数で切り詰められます。
+/// 要素数が前回の変換から変わった場合は、範囲にかかわらず全要素が変換されます。
+///
+struct DirtyRange {
+	size_t begin;
+	size_t end;
+
+	/// @brief 全要素
+	static DirtyRange all(void) noexcept { return DirtyRange{ 0, std::numeric_limits<size_t>::max() }; }
+
+	/// @brief 変換しない
+	static DirtyRange none(void) noexcept { return DirtyRange{ 0, 0 }; }
+
+	/// @brief 1要素
+	static DirtyRange single(const size_t index) noexcept { return DirtyRange{ index, index + 1 }; }
+
+	bool empty(void) const noexcept { return this->begin >= this->end; }
+
+	/// @brief 要素数countで切り詰めた範囲
+	DirtyRange clamp(const size_t count) const noexcept {
+		const size_t e = std::min(this->end, count);
+		return DirtyRange{ std::min(this->begin, e), e };
+	}
+
+	/// @brief 両方を含む最小の範囲
+	DirtyRange merge(const DirtyRange & other) const noexcept {
+		if (this->empty()) return other;
+		if (other.empty()) return *this;
+		return DirtyRange{ std::min(this->begin, other.begin), std::max(this->end, other.end) };
+	}
+
+	/// @brief 要素数countのすべてを覆うか
+	bool covers(const size_t count) const noexcept { return this->begin == 0 && this->end >= count; }
+};
+
+
+/// @brief AoSの配列をSoAバッファへ変換する
+///
+/// dstは要素数に合わせてリサイズされます。要素数が変わらない場合は、rangeの要素だけを変換します。
+/// floatのバッファを指定した場合は、変換時に単精度へ丸められます。
+///
+/// @param [in] src 変換元
+/// @param [in,out] dst 変換先
+/// @param [in] range 変換する要素範囲
+///
+template <class T> void gather(const MPointArray & src, SoaBuffer3<T> & dst, const DirtyRange & range = DirtyRange::all());
+template <class T> void gather(const MVectorArray & src, SoaBuffer3<T> & dst, const DirtyRange & range = DirtyRange::all());
+template <class T> void gather(const MFloatArray & src, AlignedBuffer<T> & dst, const DirtyRange & range = DirtyRange::all());
+template <class T> void gather(const MDoubleArray & src, AlignedBuffer<T> & dst, const DirtyRange & range = DirtyRange::all());
+
+
+/// @brief SoAバッファをAoSの配列へ書き戻す
+///
+/// dstは要素数に合わせてリサイズされます。要素数が変わらない場合は、rangeの要素だけを書き戻します。
+/// MPointのw成分は1になります。
+///
+/// @param [in] src 変換元
+/// @param [in,out] dst 変換先
+/// @param [in] range 書き戻す要素範囲
+///
+template <class T> void scatter(const SoaBuffer3<T> & src, MPointArray & dst, const DirtyRange & range = DirtyRange::all());
+template <class T> void scatter(const SoaBuffer3<T> & src, MVectorArray & dst, const DirtyRange & range = DirtyRange::all());
+template <class T> void scatter(const AlignedBuffer<T> & src, MFloatArray & dst, const DirtyRange & range = DirtyRange::all());
+template <class T> void scatter(const AlignedBuffer<T> & src, MDoubleArray & dst, const DirtyRange & range = DirtyRange::all());
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_SOA_BUFFER_HPP_
@@ -0,0 +1,80 @@
+﻿#include "GeometryCacheNode.hpp"
+#include "exception/MStatusException.hpp"
+#include "util/Logger.hpp"
+#include <maya/MFnTypedAttribute.h>
+#include <maya/MTime.h>
+
+constexpr mpb::NodeInfo mpb::GeometryCacheNode::kNodeInfo;
+
+MObject mpb::GeometryCacheNode::cache_file_;
+MObject mpb::GeometryCacheNode::time_;
+MObject mpb::GeometryCacheNode::out_points_;
+MObject mpb::GeometryCacheNode::out_normals_;
+
+mpb::GeometryCacheNode::GeometryCacheNode(void) : NodeBase(kNodeInfo) {}
+
+mpb::GeometryCacheNode::~GeometryCacheNode(void) {}
+
+void * mpb::GeometryCacheNode::create(void) { return new GeometryCacheNode; }
+
+MStatus mpb::GeometryCacheNode::initialize(void)
+{
+	try {
+		MFnTypedAttribute typed;
+		cache_file_ = typed.create("cacheFile", "cf", MFnData::kString);
+		AttributeOptions(true, true, true, false, true).apply(typed);
+		addAttr(cache_file_, typed);
+
+		addUnitAttr(time_, "time", "tm", MTime(0.0), AttributeOptions(true, true, true, true, true));
+
+		out_points_ = typed.create("outPoints", "op", MFnData::kPointArray);
+		AttributeOptions(true, false, true, false, false).apply(typed);
+		addAttr(out_points_, typed);
+
+		out_normals_ = typed.create("outNormals", "on", MFnData::kVectorArray);
+		AttributeOptions(true, false, true, false, false).apply(typed);
+		addAttr(out_normals_, typed);
+
+		setMultiAttributeAffects({ &cache_file_, &time_ }, { &out_points_, &out_normals_ });
+	}
+	catch (const MStatusException & e) {
+		MPB_LOG_ERROR("%s", e.toString("mpb::GeometryCacheNode::initialize").asChar());
+		return e.stat;
+	}
+	return MStatus::kSuccess;
+}
+
+std::shared_ptr<const mpb::GeometryCacheReader> mpb::GeometryCacheNode::acquireReader(const MString & path)
+{
+	std::lock_guard<std::mutex> lock(this->reader_mutex_);
+	if (this->reader_ && this->path_ == path) return this->reader_;
+	// 開けなかった場合は前のキャッシュも使わない
+	this->reader_.reset();
+	this->path_ = path;
+	if (path.length() > 0) this->reader_ = std::make_shared<const GeometryCacheReader>(path);
+	return this->reader_;
+}
+
+void mpb::GeometryCacheNode::computeProcess(const MPlug & plug, MDataBlock & data)
+{
+	const bool want_points = (plug == out_points_);
+	if (!want_points && !(plug == out_normals_)) throw MStatusException(MStatus::kInvalidParameter, "予期しないプラグの再計算要求 : " + plug.name());
+
+	const MString path = data.inputValue(cache_file_).asString();
+	const MTime time = data.inputValue(time_).asTime();
+	const std::shared_ptr<const GeometryCacheReader> reader = this->acquireReader(path);
+
+	SoaBuffer3<float> & buffer = this->buffer_;
+	if (reader) {
+		const size_t index = reader->frameIndex(time.as(MTime::uiUnit()));
+		if (want_points) reader->readFrame(index, &buffer, nullptr);
+		else reader->readFrame(index, nullptr, &buffer);
+		reader->prefetch(index + 1);
+	}
+	else {
+		buffer.resize(0);
+	}
+
+	if (want_points) writeOutputPoints(data, out_points_, buffer);
+	else writeOutputVectors(data, out_normals_, buffer);
+}
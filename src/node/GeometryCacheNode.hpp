@@ -0,0 +1,85 @@
+﻿/// @file GeometryCacheNode.hpp
+/// @brief ジオメトリキャッシュから要求されたフレームだけを読み出すノード
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_GEOMETRY_CACHE_NODE_HPP_
+#define _MAYA_PLUGIN_BASE_GEOMETRY_CACHE_NODE_HPP_
+
+#include "base/NodeBase.hpp"
+#include "io/GeometryCache.hpp"
+#include <memory>
+#include <mutex>
+
+namespace mpb {
+
+/// @brief ジオメトリキャッシュの読み込みノード
+///
+/// cacheFileのキャッシュを開き、timeに最も近いフレームをoutPoints / outNormalsへ出力します。
+/// ファイルはメモリマップで開いたままにし、computeでは要求されたフレームのブロックだけを読みます。
+/// フレームはページ境界から始まるため、スクラブ中の1回の評価で触れるのはそのフレームのページだけです。
+/// 出力後に次のフレームの先読みを要求するので、再生中はディスク待ちが隠れます。
+///
+/// 登録は任意です。main.cppのaddNodesでaddNode<mpb::GeometryCacheNode>()を呼んでください。
+///
+/// @code
+/// createNode mpbGeometryCacheReader -n cache1;
+/// setAttr -type "string" cache1.cacheFile "C:/cache/shot010.mpbgc";
+/// connectAttr time1.outTime cache1.time;
+/// @endcode
+///
+class GeometryCacheNode : public NodeBase {
+public:
+
+	/// @brief 登録情報
+	static constexpr NodeInfo kNodeInfo{ "mpbGeometryCacheReader", 0x70060 };
+
+	/// @brief コンストラクタ
+	explicit GeometryCacheNode(void);
+
+	/// @brief デストラクタ
+	virtual ~GeometryCacheNode(void);
+
+	///
+	/// @brief 初期化関数
+	///
+	/// @retval MStatus::kSuccess 成功
+	/// @retval else 失敗
+	///
+	static MStatus initialize(void);
+
+	///
+	/// @brief インスタンス生成関数
+	///
+	/// @return インスタンスのアドレス
+	///
+	static void * create(void);
+
+protected:
+
+	///
+	/// @brief 計算処理関数
+	///
+	/// 要求されたプラグの配列だけを復号します。cacheFileが空の場合は空の配列を出力します。
+	///
+	/// @throw MStatusException キャッシュを開けない場合、壊れている場合
+	///
+	virtual void computeProcess(const MPlug & plug, MDataBlock & data) override;
+
+private:
+
+	static MObject cache_file_;		///< キャッシュファイルのパス
+	static MObject time_;			///< 時刻
+	static MObject out_points_;		///< 点の位置(pointArray)
+	static MObject out_normals_;	///< 法線(vectorArray)。キャッシュに法線がなければ空
+
+	std::mutex reader_mutex_;		///< reader_とpath_の差し替えを保護する
+	MString path_;					///< reader_が開いているパス
+	std::shared_ptr<const GeometryCacheReader> reader_;
+	SoaBuffer3<float> buffer_;		///< 復号先。使い回す
+
+	/// @brief pathのキャッシュを取得する。パスが変わった場合のみ開き直す
+	std::shared_ptr<const GeometryCacheReader> acquireReader(const MString & path);
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_GEOMETRY_CACHE_NODE_HPP_
@@ -1,14 +1,17 @@
 ﻿#include "NodeTemplate.hpp"
 #include "exception/MStatusException.hpp"
+#include "util/Logger.hpp"
 
 //#include <maya/MFnUnitAttribute.h>
 #include <maya/MFnNumericAttribute.h>
 //#include <maya/MFnCompoundAttribute.h>
 //#include <maya/MTime.h>
 
+constexpr mpb::NodeInfo ___namespace___::___replace___::kNodeInfo;
+
 MObject ___namespace___::___replace___::m_in_dummy_;
 
-___namespace___::___replace___::___replace___(void) : NodeBase(0x70050, "___replace___") {}
+___namespace___::___replace___::___replace___(void) : NodeBase(kNodeInfo) {}
 
 ___namespace___::___replace___::~___replace___(void) {}
 
@@ -23,7 +26,7 @@ MStatus ___namespace___::___replace___::initialize(void){
 		{
 			MFnNumericAttribute attr;
 			m_in_dummy_ = attr.create("fullname", "shortname", MFnNumericData::kDouble, 0.0);
-			setAttributeOption(attr, true, true, true, true);
+			AttributeOptions(true, true, true, true).apply(attr);
 			addAttr(m_in_dummy_, attr);
 		}
 
@@ -31,8 +34,8 @@ MStatus ___namespace___::___replace___::initialize(void){
 		//////////////END OF TEMPORARY
 
 	}
-	catch (mpb::MStatusException e) {
-		std::cerr << e.toString("___replace___") << std::endl;
+	catch (const mpb::MStatusException & e) {
+		MPB_LOG_ERROR("%s", e.toString("___replace___").asChar());
 		return e.stat;
 	}
 	return MStatus::kSuccess;
@@ -12,6 +12,9 @@ namespace ___namespace___ {
 class ___replace___ : public mpb::NodeBase{
 public:
 
+	/// @brief 登録情報
+	static constexpr mpb::NodeInfo kNodeInfo{ "___replace___", 0x70050 };
+
 	/// @brief コンストラクタ
 	explicit ___replace___(void);
 
@@ -26,7 +29,7 @@ public:
 	/// @retval MStatus::kSuccess 成功
 	/// @retval else 失敗
 	///
-	static MStatus initialize(void) throw (mpb::MStatusException);
+	static MStatus initialize(void);
 
 	///
 	/// @brief インスタンス生成関数
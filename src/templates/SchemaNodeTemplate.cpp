@@ -0,0 +1,18 @@
+﻿#include "SchemaNodeTemplate.hpp"
+#include "exception/MStatusException.hpp"
+
+constexpr mpb::NodeInfo ___namespace___::___replaceS___::kNodeInfo;
+constexpr mpb::AttributeSchema<2, 1> ___namespace___::___replaceS___::kSchema;
+
+___namespace___::___replaceS___::___replaceS___(void) : SchemaNode(kNodeInfo) {}
+
+___namespace___::___replaceS___::~___replaceS___(void) {}
+
+void * ___namespace___::___replaceS___::create(void) { return new ___replaceS___; }
+
+void ___namespace___::___replaceS___::computeProcess(const MPlug & plug, MDataBlock & data){
+	if (isPlug<kOutDummy>(plug)) {
+		setOutputValue<kOutDummy>(data, inputValue<kInDummy>(data));
+	}
+	else throw mpb::MStatusException(MStatus::kInvalidParameter, "予期しないプラグの再計算要求 : " + plug.name());
+}
@@ -0,0 +1,62 @@
+﻿// ___replaceS___ : Node Name
+// ___namespace___ : namespace
+
+#pragma once
+#ifndef ___replaceS____HPP
+#define ___replaceS____HPP
+
+#include "base/SchemaNode.hpp"
+
+namespace ___namespace___ {
+
+class ___replaceS___ : public mpb::SchemaNode<___replaceS___>{
+public:
+
+	/// @brief アトリビュート番号
+	enum : size_t {
+		kInDummy,
+		kOutDummy,
+	};
+
+	/// @brief 登録情報
+	static constexpr mpb::NodeInfo kNodeInfo{ "___replaceS___", 0x70051 };
+
+	/// @brief アトリビュートスキーマ
+	static constexpr mpb::AttributeSchema<2, 1> kSchema{
+		{ {
+			mpb::numericAttribute("inDummy", "ind", MFnNumericData::kDouble, 0.0),
+			mpb::numericAttribute("outDummy", "outd", MFnNumericData::kDouble, 0.0, mpb::AttributeOptions(true, false, true, false, false)),
+		} },
+		{ {
+			mpb::affects(kInDummy, kOutDummy),
+		} }
+	};
+
+	/// @brief コンストラクタ
+	explicit ___replaceS___(void);
+
+	/// @brief デストラクタ
+	virtual ~___replaceS___(void);
+
+	///
+	/// @brief インスタンス生成関数
+	///
+	/// @return インスタンスのアドレス
+	///
+	static void * create(void);
+
+	///
+	/// @brief 計算処理関数
+	///
+	/// @param [in] plug 再計算要求のプラグ
+	/// @param [in,out] data データセット
+	///
+	/// @throw MStatusException 何かエラーが発生した場合
+	///
+	virtual void computeProcess(const MPlug & plug, MDataBlock & data);
+
+};
+
+}
+
+#endif
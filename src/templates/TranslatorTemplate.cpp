@@ -1,7 +1,10 @@
 ﻿#include "TranslatorTemplate.hpp"
+#include "util/Logger.hpp"
+
+constexpr mpb::TranslatorInfo ___namespace___::___replaceT___::kTranslatorInfo;
 
 ___namespace___::___replaceT___::___replaceT___(void) noexcept
-	: mpb::TranslatorBase("___replaceT___", ".extension", true, true)
+	: mpb::TranslatorBase(kTranslatorInfo)
 {}
 
 ___namespace___::___replaceT___::~___replaceT___(void)
@@ -12,14 +15,17 @@ void * ___namespace___::___replaceT___::create(void)
 	return new ___replaceT___;
 }
 
-MStatus ___namespace___::___replaceT___::writer(const MFileObject & file, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
+void ___namespace___::___replaceT___::writerProcess(mpb::ChunkedOutputStream & out, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
 {
-	std::cout << "writting... dummy ;-)" << std::endl;
-	return MStatus::kSuccess;
+	MPB_LOG_INFO("writting... dummy ;-)");
+	out.writeString("dummy\n");
 }
 
-MStatus ___namespace___::___replaceT___::reader(const MFileObject & file, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
+void ___namespace___::___replaceT___::readerProcess(mpb::ChunkedInputStream & in, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
 {
-	std::cout << "reading... dummy ;-)" << std::endl;
-	return MStatus();
-}
+	MPB_LOG_INFO("reading... dummy ;-)");
+	std::string line;
+	while (in.readLine(line)) {
+		// 1行ずつ処理する
+	}
+}
\ No newline at end of file
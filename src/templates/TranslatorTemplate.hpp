@@ -12,6 +12,9 @@ namespace ___namespace___ {
 class ___replaceT___ : public mpb::TranslatorBase{
 public:
 
+	/// @brief 登録情報
+	static constexpr mpb::TranslatorInfo kTranslatorInfo{ "___replaceT___", ".extension", true, true };
+
 	/// @brief コンストラクタ
 	explicit ___replaceT___(void) noexcept;
 
@@ -25,9 +28,29 @@ public:
 	///
 	static void * create(void);
 
-	virtual MStatus writer(const MFileObject & file, const MString & options_string, MPxFileTranslator::FileAccessMode mode) override;
+protected:
+
+	///
+	/// @brief 書き込み処理関数
+	///
+	/// @param [in,out] out 出力ストリーム
+	/// @param [in] options_string オプション指定文字列
+	/// @param [in] mode アクセスモード
+	///
+	/// @throw MStatusException 何かエラーが発生した場合
+	///
+	virtual void writerProcess(mpb::ChunkedOutputStream & out, const MString & options_string, MPxFileTranslator::FileAccessMode mode) override;
 
-	virtual MStatus reader(const MFileObject & file, const MString & options_string, MPxFileTranslator::FileAccessMode mode) override;
+	///
+	/// @brief 読み込み処理関数
+	///
+	/// @param [in,out] in 入力ストリーム
+	/// @param [in] options_string オプション指定文字列
+	/// @param [in] mode アクセスモード
+	///
+	/// @throw MStatusException 何かエラーが発生した場合
+	///
+	virtual void readerProcess(mpb::ChunkedInputStream & in, const MString & options_string, MPxFileTranslator::FileAccessMode mode) override;
 	
 private:
 	
@@ -0,0 +1,106 @@
+﻿#include "GeometryCacheTranslator.hpp"
+#include "node/GeometryCacheNode.hpp"
+#include "util/Logger.hpp"
+#include <maya/MGlobal.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+constexpr mpb::TranslatorInfo mpb::GeometryCacheTranslator::kTranslatorInfo;
+
+namespace {
+
+double parseNumber(const std::string & key, const std::string & value)
+{
+	char * end = nullptr;
+	const double v = std::strtod(value.c_str(), &end);
+	if (value.empty() || *end != '\0' || !std::isfinite(v)) {
+		mpb::MStatusException::throwError(MStatus::kInvalidParameter, MString(("オプションの値が不正です : " + key + "=" + value).c_str()), "mpb::GeometryCacheTranslator::Options::parse");
+	}
+	return v;
+}
+
+/// MELの文字列リテラルとして埋め込めるようにする
+MString quoteMel(const MString & s)
+{
+	std::string ret = "\"";
+	for (const char * p = s.asChar(); *p; ++p) {
+		if (*p == '"' || *p == '\\') ret.push_back('\\');
+		ret.push_back(*p);
+	}
+	ret.push_back('"');
+	return MString(ret.c_str());
+}
+
+}
+
+mpb::GeometryCacheTranslator::Options mpb::GeometryCacheTranslator::Options::parse(const MString & options_string)
+{
+	Options ret{ 1.0, 1.0, 1.0, GeometryCacheEncoding::kFloat32, true };
+	const std::string s(options_string.asChar());
+	size_t begin = 0;
+	while (begin <= s.size()) {
+		const size_t sep = std::min(s.find(';', begin), s.size());
+		const std::string item = s.substr(begin, sep - begin);
+		begin = sep + 1;
+		const size_t eq = item.find('=');
+		if (eq == std::string::npos) continue;
+		const std::string key = item.substr(0, eq);
+		const std::string value = item.substr(eq + 1);
+		if (key == "start") ret.start = parseNumber(key, value);
+		else if (key == "end") ret.end = parseNumber(key, value);
+		else if (key == "step") ret.step = parseNumber(key, value);
+		else if (key == "normals") ret.normals = (parseNumber(key, value) != 0.0);
+		else if (key == "encoding") {
+			if (value == "float") ret.encoding = GeometryCacheEncoding::kFloat32;
+			else if (value == "q16") ret.encoding = GeometryCacheEncoding::kQuantized16;
+			else MStatusException::throwError(MStatus::kInvalidParameter, MString(("不明な符号化方式です : " + value).c_str()), "mpb::GeometryCacheTranslator::Options::parse");
+		}
+	}
+	if (!(ret.step > 0.0) || ret.end < ret.start) MStatusException::throwError(MStatus::kInvalidParameter, "フレーム範囲が不正です", "mpb::GeometryCacheTranslator::Options::parse");
+	return ret;
+}
+
+mpb::GeometryCacheTranslator::GeometryCacheTranslator(void) noexcept
+	: TranslatorBase(kTranslatorInfo)
+{}
+
+mpb::GeometryCacheTranslator::~GeometryCacheTranslator(void) {}
+
+void * mpb::GeometryCacheTranslator::create(void) { return new GeometryCacheTranslator; }
+
+void mpb::GeometryCacheTranslator::sampleFrame(const double frame, SoaBuffer3<float> & points, SoaBuffer3<float> & normals)
+{ MStatusException::throwError(MStatus::kNotImplemented, "sampleFrame関数が定義されていません", "mpb::GeometryCacheTranslator::sampleFrame<default>"); }
+
+void mpb::GeometryCacheTranslator::writerProcess(ChunkedOutputStream & out, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
+{
+	const Options options = Options::parse(options_string);
+	// 刻みの累積誤差で最後のフレームが落ちないよう、フレーム数を先に決める
+	const size_t count = static_cast<size_t>(std::floor((options.end - options.start) / options.step + 1e-6)) + 1;
+
+	GeometryCacheWriter writer(out, options.start, options.step, options.encoding, options.normals);
+	SoaBuffer3<float> points, normals;
+	for (size_t i = 0; i < count; ++i) {
+		this->sampleFrame(options.start + options.step * i, points, normals);
+		writer.addFrame(points, options.normals ? &normals : nullptr);
+	}
+	writer.finish();
+	MPB_LOG_INFO("%s : %u frames, %u points", this->name_.asChar(), static_cast<unsigned int>(writer.frameCount()), static_cast<unsigned int>(points.size()));
+}
+
+void mpb::GeometryCacheTranslator::mappedReaderProcess(MappedFile & file, const MString & options_string, MPxFileTranslator::FileAccessMode mode)
+{
+	{
+		// 壊れたファイルはノードを作る前に弾く
+		const GeometryCacheReader reader(file);
+		MPB_LOG_INFO("%s : %u frames, %u points", this->name_.asChar(), static_cast<unsigned int>(reader.frameCount()), reader.pointCount());
+	}
+
+	MString node;
+	MStatusException::throwIf(MGlobal::executeCommand(MString("createNode ") + GeometryCacheNode::kNodeInfo.name, node),
+		"キャッシュ読み込みノードを作成できません", "mpb::GeometryCacheTranslator::mappedReaderProcess");
+	MStatusException::throwIf(MGlobal::executeCommand("setAttr -type \"string\" " + node + ".cacheFile " + quoteMel(file.path())),
+		"キャッシュファイルを設定できません", "mpb::GeometryCacheTranslator::mappedReaderProcess");
+	MStatusException::throwIf(MGlobal::executeCommand("connectAttr time1.outTime " + node + ".time"),
+		"時刻を接続できません", "mpb::GeometryCacheTranslator::mappedReaderProcess");
+}
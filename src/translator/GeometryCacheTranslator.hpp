@@ -0,0 +1,99 @@
+﻿/// @file GeometryCacheTranslator.hpp
+/// @brief ジオメトリキャッシュ(.mpbgc)の書き出しと読み込み
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_GEOMETRY_CACHE_TRANSLATOR_HPP_
+#define _MAYA_PLUGIN_BASE_GEOMETRY_CACHE_TRANSLATOR_HPP_
+
+#include "base/TranslatorBase.hpp"
+#include "io/GeometryCache.hpp"
+
+namespace mpb {
+
+/// @brief ジオメトリキャッシュのトランスレーター
+///
+/// 書き出しは、オプションのstartからendまでstep刻みでsampleFrameを呼び、GeometryCacheWriterで1フレームずつ書き込みます。
+/// フレームは順に書かれるので、メモリ使用量はフレーム数によらず1フレーム分とストリームのバッファだけです。
+/// 読み込みはファイルを検証したうえでmpbGeometryCacheReaderノードを作成し、time1.outTimeを接続します。
+/// ノードはフレームを必要になるまで読まないので、読み込み自体はフレーム数によらずヘッダーと索引の分だけで済みます。
+///
+/// オプション文字列は "start=1;end=120;step=1;encoding=float;normals=1" の形式です。
+/// encodingはfloat（単精度）かq16（16bit量子化）です。
+///
+/// メッシュの取得方法はシーンによって異なるので、書き出す場合は継承してsampleFrameを定義してください。
+///
+/// @code
+/// class MeshCacheTranslator : public mpb::GeometryCacheTranslator {
+///     virtual void sampleFrame(const double frame, mpb::SoaBuffer3<float> & points, mpb::SoaBuffer3<float> & normals) override {
+///         MAnimControl::setCurrentTime(MTime(frame, MTime::uiUnit()));
+///         MFloatPointArray p;
+///         MFnMesh(mesh_).getPoints(p, MSpace::kWorld);
+///         points.resize(p.length());
+///         for (unsigned int i = 0; i < p.length(); ++i) { points.x[i] = p[i].x; points.y[i] = p[i].y; points.z[i] = p[i].z; }
+///         ...
+///     }
+/// };
+/// @endcode
+///
+class GeometryCacheTranslator : public TranslatorBase {
+public:
+
+	/// @brief 登録情報
+	static constexpr TranslatorInfo kTranslatorInfo{ "mpbGeometryCache", "mpbgc", true, true, "", "start=1;end=1;step=1;encoding=float;normals=1" };
+
+	/// @brief 書き出しのオプション
+	struct Options {
+		double start;					///< 最初のフレーム
+		double end;						///< 最後のフレーム（含む）
+		double step;					///< フレームの間隔
+		GeometryCacheEncoding encoding;	///< 符号化方式
+		bool normals;					///< 法線を含めるか
+
+		/// @brief オプション文字列を解析する。知らないキーは無視します
+		///
+		/// @throw MStatusException 値が不正な場合
+		///
+		static Options parse(const MString & options_string);
+	};
+
+	/// @brief コンストラクタ
+	GeometryCacheTranslator(void) noexcept;
+
+	/// @brief デストラクタ
+	virtual ~GeometryCacheTranslator(void);
+
+	///
+	/// @brief インスタンス生成関数
+	///
+	/// @return インスタンスのアドレス
+	///
+	static void * create(void);
+
+protected:
+
+	/// @brief 継承先のクラスでオーバーライドすべき、1フレーム分のジオメトリの取得関数
+	///
+	/// pointsとnormalsは前のフレームのものが入ったまま渡されます。サイズを合わせて上書きしてください。
+	/// 点の数はすべてのフレームで同じである必要があります。法線を含めない場合、normalsは無視されます。
+	/// デフォルトではkNotImplementedを投げます。
+	///
+	/// @param [in] frame フレーム
+	/// @param [out] points 点の位置
+	/// @param [out] normals 法線
+	///
+	/// @throws MStatusException 何かエラーが発生した場合
+	///
+	virtual void sampleFrame(const double frame, SoaBuffer3<float> & points, SoaBuffer3<float> & normals);
+
+	virtual void writerProcess(ChunkedOutputStream & out, const MString & options_string, MPxFileTranslator::FileAccessMode mode) override;
+
+	virtual void mappedReaderProcess(MappedFile & file, const MString & options_string, MPxFileTranslator::FileAccessMode mode) override;
+
+	virtual ReadMode readMode(void) const override { return ReadMode::kMapped; }
+
+	/// 検証ではヘッダー・索引・フッターしか読まない
+	virtual MappedFile::Access mappedAccess(void) const override { return MappedFile::Access::kRandom; }
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_GEOMETRY_CACHE_TRANSLATOR_HPP_
@@ -0,0 +1,79 @@
+﻿#include "AsyncComputeQueue.hpp"
+#include <algorithm>
+
+std::unique_ptr<mpb::AsyncComputeQueue> mpb::AsyncComputeQueue::global_;
+std::mutex mpb::AsyncComputeQueue::global_mutex_;
+
+mpb::AsyncComputeQueue::AsyncComputeQueue(const size_t num_workers)
+	: stopping_(false)
+{
+	size_t n = num_workers;
+	if (n == 0) n = std::max<size_t>(1, std::thread::hardware_concurrency() / 4);
+	for (size_t i = 0; i < n; ++i) this->workers_.emplace_back(&AsyncComputeQueue::workerLoop, this);
+}
+
+mpb::AsyncComputeQueue::~AsyncComputeQueue(void)
+{
+	std::deque<Entry> dropped;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		this->stopping_ = true;
+		dropped.swap(this->tasks_);
+	}
+	this->cv_.notify_all();
+	for (auto & t : this->workers_) t.join();
+	// 完了を待っている側が止まったままにならないよう、実行しなかったことを知らせる
+	for (auto & entry : dropped) {
+		if (entry.on_drop) entry.on_drop();
+	}
+}
+
+size_t mpb::AsyncComputeQueue::pending(void) const
+{
+	std::lock_guard<std::mutex> lock(this->mutex_);
+	return this->tasks_.size();
+}
+
+void mpb::AsyncComputeQueue::submit(Task && task, Task && on_drop)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		if (!this->stopping_) {
+			this->tasks_.push_back(Entry{ std::move(task), std::move(on_drop) });
+			on_drop = nullptr;
+		}
+	}
+	if (on_drop) {
+		on_drop();
+		return;
+	}
+	this->cv_.notify_one();
+}
+
+mpb::AsyncComputeQueue & mpb::AsyncComputeQueue::global(void)
+{
+	std::lock_guard<std::mutex> lock(global_mutex_);
+	if (!global_) global_.reset(new AsyncComputeQueue());
+	return *global_;
+}
+
+void mpb::AsyncComputeQueue::shutdownGlobal(void)
+{
+	std::lock_guard<std::mutex> lock(global_mutex_);
+	global_.reset();
+}
+
+void mpb::AsyncComputeQueue::workerLoop(void)
+{
+	while (true) {
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex_);
+			this->cv_.wait(lock, [this] { return this->stopping_ || !this->tasks_.empty(); });
+			if (this->stopping_) return;
+			task = std::move(this->tasks_.front().task);
+			this->tasks_.pop_front();
+		}
+		task();
+	}
+}
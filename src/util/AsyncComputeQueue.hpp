@@ -0,0 +1,116 @@
+﻿/// @file AsyncComputeQueue.hpp
+/// @brief AsyncComputeQueueクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_ASYNC_COMPUTE_QUEUE_HPP_
+#define _MAYA_PLUGIN_BASE_ASYNC_COMPUTE_QUEUE_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mpb {
+
+/// @brief 非同期タスクのキャンセル状態
+///
+/// コピーしたトークンは同じ状態を共有します。
+///
+class CancelToken {
+public:
+	CancelToken(void) : flag_(std::make_shared<std::atomic<bool>>(false)) {}
+
+	/// @brief キャンセルを要求する
+	void cancel(void) const noexcept { this->flag_->store(true, std::memory_order_release); }
+
+	/// @brief キャンセルが要求されたか
+	bool cancelled(void) const noexcept { return this->flag_->load(std::memory_order_acquire); }
+
+private:
+	std::shared_ptr<std::atomic<bool>> flag_;
+};
+
+
+/// @brief 時間のかかる計算をバックグラウンドで実行するキュー
+///
+/// ThreadPoolはcomputeの中で分割して合流する短いタスク向けで、数百msかかる計算を入れるとparallelForを止めてしまいます。
+/// こちらはcomputeから切り離して実行する長いタスク向けの、投入順に処理する少数のワーカーです。
+///
+/// Maya APIはスレッドセーフではないため、タスク内でMDataBlockやMPlug等を触らないでください。
+///
+class AsyncComputeQueue {
+public:
+
+	typedef std::function<void(void)> Task;
+
+	/// @brief コンストラクタ
+	///
+	/// @param [in] num_workers ワーカースレッド数。0の場合はハードウェアスレッド数の1/4（最低1）
+	///
+	explicit AsyncComputeQueue(const size_t num_workers = 0);
+
+	/// @brief デストラクタ
+	///
+	/// 実行中のタスクの終了を待ってからすべてのワーカーをjoinし、未実行のタスクは実行せずにそれぞれのon_dropを呼び出します。
+	///
+	~AsyncComputeQueue(void);
+
+	AsyncComputeQueue(const AsyncComputeQueue &) = delete;
+	AsyncComputeQueue & operator=(const AsyncComputeQueue &) = delete;
+
+
+	/// @brief ワーカースレッド数を取得する
+	size_t numWorkers(void) const noexcept { return this->workers_.size(); }
+
+	/// @brief 未実行のタスク数を取得する
+	size_t pending(void) const;
+
+
+	/// @brief タスクを投入する
+	///
+	/// 停止中のキューに投入した場合や、実行前にキューが破棄された場合はtaskの代わりにon_dropを呼び出します。
+	/// taskの完了を待つ側がいる場合は、on_dropで完了（失敗）を知らせてください。
+	///
+	/// @param [in] task 実行するタスク。例外を投げないでください
+	/// @param [in] on_drop taskを実行しない場合に呼び出す関数。例外を投げないでください
+	///
+	void submit(Task && task, Task && on_drop = Task());
+
+
+	/// @brief プラグイン全体で共有するキューを取得する
+	///
+	/// 初回呼び出し時に生成されます。
+	///
+	static AsyncComputeQueue & global(void);
+
+	/// @brief 共有キューを停止する
+	///
+	/// DLLのアンロード前にスレッドを停止させるため、uninitializePluginから呼び出します。
+	///
+	static void shutdownGlobal(void);
+
+private:
+
+	struct Entry {
+		Task task;
+		Task on_drop;
+	};
+
+	std::vector<std::thread> workers_;
+	std::deque<Entry> tasks_;
+	mutable std::mutex mutex_;
+	std::condition_variable cv_;
+	bool stopping_;
+
+	void workerLoop(void);
+
+	static std::unique_ptr<AsyncComputeQueue> global_;
+	static std::mutex global_mutex_;
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_ASYNC_COMPUTE_QUEUE_HPP_
@@ -0,0 +1,221 @@
+﻿#include "ComputeProfiler.hpp"
+#include "util/Json.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+std::atomic<bool> mpb::ComputeProfiler::enabled_(false);
+std::atomic<uint64_t> mpb::ComputeProfiler::epoch_(0);
+
+namespace {
+
+// 2のべき乗ごとに4分割した対数バケット。0-3nsは1ns刻み
+constexpr size_t kNumBuckets = 256;
+
+int log2Floor(const uint64_t v) noexcept
+{
+	int r = 0;
+	uint64_t x = v;
+	while (x >>= 1) ++r;
+	return r;
+}
+
+size_t bucketOf(const uint64_t ns) noexcept
+{
+	if (ns < 4) return static_cast<size_t>(ns);
+	const int e = log2Floor(ns);
+	const size_t sub = static_cast<size_t>((ns >> (e - 2)) & 3);
+	return static_cast<size_t>(4 * (e - 1)) + sub;
+}
+
+uint64_t bucketUpperBound(const size_t bucket) noexcept
+{
+	const size_t next = bucket + 1;
+	if (next < 4) return next - 1;
+	const int e = static_cast<int>(next / 4) + 1;
+	if (e >= 64) return UINT64_MAX;
+	return ((4 + static_cast<uint64_t>(next % 4)) << (e - 2)) - 1;
+}
+
+/// 1スレッド・1プラグ分のカウンタ。所有スレッドのみが書き込む
+struct Counters {
+	std::atomic<uint64_t> count{ 0 };
+	std::atomic<uint64_t> errors{ 0 };
+	std::atomic<uint64_t> total_ns{ 0 };
+	std::atomic<uint64_t> min_ns{ UINT64_MAX };
+	std::atomic<uint64_t> max_ns{ 0 };
+	std::atomic<uint64_t> scratch_peak{ 0 };
+	std::array<std::atomic<uint64_t>, kNumBuckets> histogram;
+
+	Counters(void) { for (auto & h : histogram) h.store(0, std::memory_order_relaxed); }
+
+	// 単一書き込みなのでread-modify-writeは不要
+	static void add(std::atomic<uint64_t> & a, const uint64_t v) noexcept
+	{ a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed); }
+};
+
+/// スレッドごとのカウンタ表
+struct ThreadStats {
+	std::mutex mutex;	///< countersの構造の変更・走査のみを保護する
+	std::unordered_map<std::string, std::unique_ptr<Counters>> counters;
+	uint64_t epoch = 0;
+	std::string key;	///< キー組み立て用の使い回しバッファ
+};
+
+std::mutex registry_mutex;
+std::vector<std::shared_ptr<ThreadStats>> registry;
+
+ThreadStats & localStats(void)
+{
+	// スレッド終了後も集計が残るよう、実体はレジストリと共有する
+	thread_local std::shared_ptr<ThreadStats> stats;
+	if (!stats) {
+		stats = std::make_shared<ThreadStats>();
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		registry.push_back(stats);
+	}
+	return *stats;
+}
+
+}
+
+void mpb::ComputeProfiler::setEnabled(const bool enabled) noexcept
+{ enabled_.store(enabled, std::memory_order_relaxed); }
+
+uint64_t mpb::ComputeProfiler::now(void) noexcept
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void mpb::ComputeProfiler::record(const char * node_type, const char * plug, const uint64_t elapsed_ns, const bool failed, const uint64_t scratch_bytes)
+{
+	ThreadStats & stats = localStats();
+
+	const uint64_t epoch = epoch_.load(std::memory_order_acquire);
+	if (stats.epoch != epoch) {
+		std::lock_guard<std::mutex> lock(stats.mutex);
+		stats.counters.clear();
+		stats.epoch = epoch;
+	}
+
+	stats.key.assign(node_type);
+	stats.key.push_back('.');
+	stats.key.append(plug);
+
+	auto it = stats.counters.find(stats.key);
+	if (it == stats.counters.end()) {
+		std::lock_guard<std::mutex> lock(stats.mutex);
+		it = stats.counters.emplace(stats.key, std::unique_ptr<Counters>(new Counters)).first;
+	}
+	Counters & c = *it->second;
+
+	Counters::add(c.count, 1);
+	if (failed) Counters::add(c.errors, 1);
+	Counters::add(c.total_ns, elapsed_ns);
+	if (elapsed_ns < c.min_ns.load(std::memory_order_relaxed)) c.min_ns.store(elapsed_ns, std::memory_order_relaxed);
+	if (elapsed_ns > c.max_ns.load(std::memory_order_relaxed)) c.max_ns.store(elapsed_ns, std::memory_order_relaxed);
+	if (scratch_bytes > c.scratch_peak.load(std::memory_order_relaxed)) c.scratch_peak.store(scratch_bytes, std::memory_order_relaxed);
+	Counters::add(c.histogram[bucketOf(elapsed_ns)], 1);
+}
+
+void mpb::ComputeProfiler::reset(void) noexcept
+{ epoch_.fetch_add(1, std::memory_order_acq_rel); }
+
+std::vector<mpb::ComputeProfiler::Entry> mpb::ComputeProfiler::snapshot(void)
+{
+	struct Merged {
+		Entry entry;
+		std::array<uint64_t, kNumBuckets> histogram;
+	};
+	std::map<std::string, Merged> merged;
+
+	std::vector<std::shared_ptr<ThreadStats>> threads;
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		threads = registry;
+	}
+
+	const uint64_t epoch = epoch_.load(std::memory_order_acquire);
+	for (const auto & stats : threads) {
+		std::lock_guard<std::mutex> lock(stats->mutex);
+		// リセット後にまだ記録していないスレッドの値は古い
+		if (stats->epoch != epoch) continue;
+		for (const auto & kv : stats->counters) {
+			const Counters & c = *kv.second;
+			auto it = merged.find(kv.first);
+			if (it == merged.end()) {
+				Merged m;
+				const size_t dot = kv.first.find('.');
+				m.entry = Entry{ kv.first.substr(0, dot), kv.first.substr(dot + 1), 0, 0, 0, UINT64_MAX, 0, 0, 0, 0 };
+				m.histogram.fill(0);
+				it = merged.emplace(kv.first, m).first;
+			}
+			Merged & m = it->second;
+			m.entry.count += c.count.load(std::memory_order_relaxed);
+			m.entry.errors += c.errors.load(std::memory_order_relaxed);
+			m.entry.total_ns += c.total_ns.load(std::memory_order_relaxed);
+			m.entry.min_ns = std::min(m.entry.min_ns, c.min_ns.load(std::memory_order_relaxed));
+			m.entry.max_ns = std::max(m.entry.max_ns, c.max_ns.load(std::memory_order_relaxed));
+			m.entry.scratch_peak_bytes = std::max(m.entry.scratch_peak_bytes, c.scratch_peak.load(std::memory_order_relaxed));
+			for (size_t b = 0; b < kNumBuckets; ++b) m.histogram[b] += c.histogram[b].load(std::memory_order_relaxed);
+		}
+	}
+
+	std::vector<Entry> ret;
+	ret.reserve(merged.size());
+	for (auto & kv : merged) {
+		Merged & m = kv.second;
+		if (m.entry.count == 0) continue;
+		const uint64_t p50_rank = (m.entry.count * 50 + 99) / 100;
+		const uint64_t p99_rank = (m.entry.count * 99 + 99) / 100;
+		uint64_t seen = 0;
+		for (size_t b = 0; b < kNumBuckets; ++b) {
+			if (m.histogram[b] == 0) continue;
+			const uint64_t before = seen;
+			seen += m.histogram[b];
+			const uint64_t bound = std::min(std::max(bucketUpperBound(b), m.entry.min_ns), m.entry.max_ns);
+			if (before < p50_rank && p50_rank <= seen) m.entry.p50_ns = bound;
+			if (before < p99_rank && p99_rank <= seen) m.entry.p99_ns = bound;
+		}
+		ret.push_back(m.entry);
+	}
+	return ret;
+}
+
+std::string mpb::ComputeProfiler::toText(const std::vector<Entry> & entries)
+{
+	std::ostringstream os;
+	os << "node.plug\tcount\terrors\ttotal_us\tmin_us\tmax_us\tp50_us\tp99_us\tscratch_bytes\n";
+	os.setf(std::ios::fixed);
+	os.precision(3);
+	for (const auto & e : entries) {
+		os << e.node_type << '.' << e.plug << '\t' << e.count << '\t' << e.errors << '\t'
+			<< e.total_ns / 1000.0 << '\t' << e.min_ns / 1000.0 << '\t' << e.max_ns / 1000.0 << '\t'
+			<< e.p50_ns / 1000.0 << '\t' << e.p99_ns / 1000.0 << '\t' << e.scratch_peak_bytes << '\n';
+	}
+	return os.str();
+}
+
+std::string mpb::ComputeProfiler::toJson(const std::vector<Entry> & entries)
+{
+	std::ostringstream os;
+	os << '[';
+	for (size_t i = 0; i < entries.size(); ++i) {
+		const Entry & e = entries[i];
+		if (i != 0) os << ',';
+		os << "{\"node\":";
+		appendJsonString(os, e.node_type);
+		os << ",\"plug\":";
+		appendJsonString(os, e.plug);
+		os << ",\"count\":" << e.count << ",\"errors\":" << e.errors
+			<< ",\"total_ns\":" << e.total_ns << ",\"min_ns\":" << e.min_ns << ",\"max_ns\":" << e.max_ns
+			<< ",\"p50_ns\":" << e.p50_ns << ",\"p99_ns\":" << e.p99_ns << ",\"scratch_peak_bytes\":" << e.scratch_peak_bytes << '}';
+	}
+	os << ']';
+	return os.str();
+}
@@ -0,0 +1,89 @@
+﻿/// @file ComputeProfiler.hpp
+/// @brief ComputeProfilerクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_COMPUTE_PROFILER_HPP_
+#define _MAYA_PLUGIN_BASE_COMPUTE_PROFILER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mpb {
+
+/// @brief ノードのcompute計測器
+///
+/// NodeBase::computeから呼び出され、ノードタイプ・プラグごとに呼び出し回数、合計・最小・最大・p50・p99の処理時間、失敗回数、
+/// ScratchArenaの最大使用量を集計します。
+///
+/// カウンタはスレッドごとに持ち、計測中は所有スレッドしか書き込まないため、ロックも共有キャッシュラインの取り合いも発生しません。
+/// 新しいノードタイプ・プラグが初めて計測されたときのみ、そのスレッドのマップに登録するためのロックを取ります。
+/// パーセンタイルは2のべき乗を4分割した対数ヒストグラムから求めるため、誤差は最大で約19%です。
+///
+/// 既定では無効で、無効時のNodeBase::computeのコストはisEnabledの分岐1つのみです。
+///
+class ComputeProfiler {
+public:
+
+	/// @brief 集計結果の1行分
+	struct Entry {
+		std::string node_type;	///< ノードタイプ名
+		std::string plug;		///< アトリビュート名
+		uint64_t count;			///< 呼び出し回数
+		uint64_t errors;		///< 失敗（例外）回数
+		uint64_t total_ns;		///< 合計処理時間
+		uint64_t min_ns;		///< 最小処理時間
+		uint64_t max_ns;		///< 最大処理時間
+		uint64_t p50_ns;		///< 処理時間の中央値（近似）
+		uint64_t p99_ns;		///< 処理時間の99パーセンタイル（近似）
+		uint64_t scratch_peak_bytes;	///< 1回のcomputeでScratchArenaを同時に使用した最大バイト数
+	};
+
+	ComputeProfiler(void) = delete;
+
+	/// @brief 計測が有効か
+	static bool isEnabled(void) noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+	/// @brief 計測の有効・無効を切り替える
+	static void setEnabled(const bool enabled) noexcept;
+
+	/// @brief 計測用の現在時刻を取得する
+	/// @return 単調増加時計のナノ秒
+	static uint64_t now(void) noexcept;
+
+	/// @brief 1回分の計測結果を記録する
+	///
+	/// @param [in] node_type ノードタイプ名
+	/// @param [in] plug アトリビュート名
+	/// @param [in] elapsed_ns 処理時間
+	/// @param [in] failed 失敗したか
+	/// @param [in] scratch_bytes このcomputeでScratchArenaを同時に使用した最大バイト数
+	///
+	static void record(const char * node_type, const char * plug, const uint64_t elapsed_ns, const bool failed, const uint64_t scratch_bytes = 0);
+
+	/// @brief 全スレッドの集計をリセットする
+	///
+	/// 各スレッドは次に記録するときに自分のカウンタを破棄します。
+	///
+	static void reset(void) noexcept;
+
+	/// @brief 全スレッドの集計を合算して取得する
+	/// @return ノードタイプ・プラグ名順の集計結果
+	static std::vector<Entry> snapshot(void);
+
+	/// @brief 集計結果を表形式の文字列にする
+	static std::string toText(const std::vector<Entry> & entries);
+
+	/// @brief 集計結果をJSON文字列にする
+	static std::string toJson(const std::vector<Entry> & entries);
+
+private:
+
+	static std::atomic<bool> enabled_;
+	static std::atomic<uint64_t> epoch_;
+
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_COMPUTE_PROFILER_HPP_
@@ -0,0 +1,220 @@
+﻿#include "ErrorAggregator.hpp"
+#include "util/FastHash.hpp"
+#include "util/Json.hpp"
+#include "util/Logger.hpp"
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <tuple>
+
+std::atomic<uint64_t> mpb::ErrorAggregator::report_interval_ns_(10ull * 1000000000ull);
+std::atomic<uint64_t> mpb::ErrorAggregator::next_report_ns_(0);
+
+constexpr size_t mpb::ErrorAggregator::kCapacity;
+
+/// 区分1つ分。一度登録したら解放しないので、呼び出し側はヒントとしてポインタを保持し続けられる
+struct mpb::ErrorBucket {
+	const uint64_t hash;
+	const std::string node_type;
+	const std::string place;
+	const int code;
+	const std::string status_text;
+	const std::string sample;
+
+	std::atomic<uint64_t> count{ 0 };
+	std::atomic<uint64_t> reported{ 0 };	///< 前回の要約の時点のcount
+	std::atomic<uint64_t> first_ns{ 0 };
+	std::atomic<uint64_t> last_ns{ 0 };
+
+	ErrorBucket(const uint64_t hash, const MString & node_type, const MString & place, const int code, const MString & status_text, const MString & sample)
+		: hash(hash), node_type(node_type.asChar()), place(place.asChar()), code(code), status_text(status_text.asChar()), sample(sample.asChar()) {}
+
+	static bool equals(const std::string & a, const MString & b) noexcept {
+		return a.size() == b.length() && std::memcmp(a.data(), b.asChar(), a.size()) == 0;
+	}
+
+	bool matches(const uint64_t h, const MString & type, const MString & p, const int c) const noexcept {
+		return this->hash == h && this->code == c && equals(this->place, p) && equals(this->node_type, type);
+	}
+};
+
+namespace {
+
+static_assert((mpb::ErrorAggregator::kCapacity & (mpb::ErrorAggregator::kCapacity - 1)) == 0, "kCapacity must be a power of two");
+
+constexpr size_t kMask = mpb::ErrorAggregator::kCapacity - 1;
+
+/// 開番地法のハッシュ表。スロットは一度埋まったら変わらない
+std::atomic<mpb::ErrorBucket *> table[mpb::ErrorAggregator::kCapacity];
+
+uint64_t now(void) noexcept
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint64_t hashOf(const MString & node_type, const MString & place, const int code) noexcept
+{
+	mpb::FastHasher hasher;
+	hasher.update(node_type.asChar(), node_type.length());
+	hasher.update(place.asChar(), place.length());
+	hasher.updateValue(code);
+	return hasher.digest().lo;
+}
+
+/// @brief 区分を探し、なければ登録する。表が一杯の場合はnullptr
+mpb::ErrorBucket * findOrCreate(const char * context, const MString & node_type, const mpb::MStatusException & e, const int code)
+{
+	const MString & place = e.place;
+	const uint64_t hash = hashOf(node_type, place, code);
+	std::unique_ptr<mpb::ErrorBucket> created;
+	for (size_t i = 0; i < mpb::ErrorAggregator::kCapacity; ++i) {
+		std::atomic<mpb::ErrorBucket *> & slot = table[(hash + i) & kMask];
+		mpb::ErrorBucket * bucket = slot.load(std::memory_order_acquire);
+		if (!bucket) {
+			// メッセージの整形は区分ごとに1回だけ
+			if (!created) created.reset(new mpb::ErrorBucket(hash, node_type, place, code, e.stat.errorString(), e.toString(MString(context) + " : " + node_type)));
+			if (slot.compare_exchange_strong(bucket, created.get(), std::memory_order_acq_rel, std::memory_order_acquire)) return created.release();
+		}
+		if (bucket->matches(hash, node_type, place, code)) return bucket;
+	}
+	return nullptr;
+}
+
+double secondsAgo(const uint64_t t, const uint64_t current) noexcept
+{
+	return (current > t ? (current - t) / 1e9 : 0.0);
+}
+
+}
+
+void mpb::ErrorAggregator::record(const char * context, const MString & node_type, const MStatusException & e, std::atomic<ErrorBucket *> * hint)
+{
+	const int code = static_cast<int>(e.stat.statusCode());
+	ErrorBucket * bucket = (hint ? hint->load(std::memory_order_acquire) : nullptr);
+	if (!bucket || !mpb::ErrorBucket::equals(bucket->place, e.place) || bucket->code != code) {
+		bucket = findOrCreate(context, node_type, e, code);
+		if (!bucket) {
+			MPB_LOG_ERROR("%s", e.toString(MString(context) + " : " + node_type).asChar());
+			return;
+		}
+		if (hint) hint->store(bucket, std::memory_order_release);
+	}
+
+	const uint64_t t = now();
+	bucket->last_ns.store(t, std::memory_order_relaxed);
+	if (bucket->count.fetch_add(1, std::memory_order_relaxed) == 0) {
+		bucket->first_ns.store(t, std::memory_order_relaxed);
+		MPB_LOG_ERROR("%s", bucket->sample.c_str());
+	}
+
+	const uint64_t interval = report_interval_ns_.load(std::memory_order_relaxed);
+	if (interval == 0) return;
+	uint64_t next = next_report_ns_.load(std::memory_order_relaxed);
+	if (t < next) return;
+	// 間隔ごとに1スレッドだけが要約を出力する。初回は最初のメッセージを出したばかりなので期限の設定のみ
+	if (!next_report_ns_.compare_exchange_strong(next, t + interval, std::memory_order_relaxed)) return;
+	if (next != 0) ErrorAggregator::report();
+}
+
+void mpb::ErrorAggregator::setReportInterval(const uint32_t seconds) noexcept
+{
+	report_interval_ns_.store(static_cast<uint64_t>(seconds) * 1000000000ull, std::memory_order_relaxed);
+	next_report_ns_.store(0, std::memory_order_relaxed);
+}
+
+void mpb::ErrorAggregator::report(void)
+{
+	// 要約は間隔で間引かれているので、呼び出し箇所ごとの流量制限はかけない
+	static LogSite site;
+	if (!Logger::isEnabled(LogLevel::kError)) return;
+	for (auto & slot : table) {
+		ErrorBucket * bucket = slot.load(std::memory_order_acquire);
+		if (!bucket) continue;
+		const uint64_t count = bucket->count.load(std::memory_order_relaxed);
+		const uint64_t reported = bucket->reported.exchange(count, std::memory_order_relaxed);
+		if (count <= reported) continue;
+		Logger::write(LogLevel::kError, site, "NODE ERRORS : %s : %s (%s) : +%llu (計 %llu)", bucket->node_type.c_str(), bucket->place.c_str(), bucket->status_text.c_str(),
+			static_cast<unsigned long long>(count - reported), static_cast<unsigned long long>(count));
+	}
+}
+
+void mpb::ErrorAggregator::reset(void) noexcept
+{
+	for (auto & slot : table) {
+		ErrorBucket * bucket = slot.load(std::memory_order_acquire);
+		if (!bucket) continue;
+		bucket->count.store(0, std::memory_order_relaxed);
+		bucket->reported.store(0, std::memory_order_relaxed);
+		bucket->first_ns.store(0, std::memory_order_relaxed);
+		bucket->last_ns.store(0, std::memory_order_relaxed);
+	}
+}
+
+std::vector<mpb::ErrorAggregator::Entry> mpb::ErrorAggregator::snapshot(void)
+{
+	// 出力をノードの種類と発生箇所の順に並べる
+	std::map<std::tuple<std::string, std::string, int>, Entry> merged;
+	for (auto & slot : table) {
+		const ErrorBucket * bucket = slot.load(std::memory_order_acquire);
+		if (!bucket) continue;
+		const uint64_t count = bucket->count.load(std::memory_order_relaxed);
+		if (count == 0) continue;
+		const uint64_t first = bucket->first_ns.load(std::memory_order_relaxed);
+		const uint64_t last = bucket->last_ns.load(std::memory_order_relaxed);
+		const auto key = std::make_tuple(bucket->node_type, bucket->place, bucket->code);
+		auto it = merged.find(key);
+		if (it == merged.end()) {
+			merged.emplace(key, Entry{ bucket->node_type, bucket->place, bucket->code, count, first, last, bucket->sample });
+			continue;
+		}
+		Entry & entry = it->second;
+		entry.count += count;
+		if (first < entry.first_ns) {
+			entry.first_ns = first;
+			entry.sample = bucket->sample;
+		}
+		if (last > entry.last_ns) entry.last_ns = last;
+	}
+
+	std::vector<Entry> ret;
+	ret.reserve(merged.size());
+	for (auto & kv : merged) ret.push_back(kv.second);
+	return ret;
+}
+
+std::string mpb::ErrorAggregator::toText(const std::vector<Entry> & entries)
+{
+	const uint64_t current = now();
+	std::ostringstream os;
+	os << "node\tplace\tstatus\tcount\tfirst_s_ago\tlast_s_ago\tsample\n";
+	os.setf(std::ios::fixed);
+	os.precision(3);
+	for (const auto & e : entries) {
+		os << e.node_type << '\t' << e.place << '\t' << e.status_code << '\t' << e.count << '\t'
+			<< secondsAgo(e.first_ns, current) << '\t' << secondsAgo(e.last_ns, current) << '\t' << e.sample << '\n';
+	}
+	return os.str();
+}
+
+std::string mpb::ErrorAggregator::toJson(const std::vector<Entry> & entries)
+{
+	const uint64_t current = now();
+	std::ostringstream os;
+	os << '[';
+	for (size_t i = 0; i < entries.size(); ++i) {
+		const Entry & e = entries[i];
+		if (i != 0) os << ',';
+		os << "{\"node\":";
+		appendJsonString(os, e.node_type);
+		os << ",\"place\":";
+		appendJsonString(os, e.place);
+		os << ",\"status\":" << e.status_code << ",\"count\":" << e.count
+			<< ",\"first_s_ago\":" << secondsAgo(e.first_ns, current) << ",\"last_s_ago\":" << secondsAgo(e.last_ns, current) << ",\"sample\":";
+		appendJsonString(os, e.sample);
+		os << '}';
+	}
+	os << ']';
+	return os.str();
+}
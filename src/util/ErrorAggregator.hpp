@@ -0,0 +1,85 @@
+﻿/// @file ErrorAggregator.hpp
+/// @brief ErrorAggregatorクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_ERROR_AGGREGATOR_HPP_
+#define _MAYA_PLUGIN_BASE_ERROR_AGGREGATOR_HPP_
+
+#include "exception/MStatusException.hpp"
+#include <maya/MString.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mpb {
+
+/// @brief ErrorAggregatorの集計先1つ分。中身はErrorAggregator.cppにある
+struct ErrorBucket;
+
+/// @brief computeで発生した例外の集計器
+///
+/// 例外を(ノードタイプ, 発生箇所, ステータスコード)ごとにまとめ、回数・最初と最後の発生時刻・最初のメッセージを保持します。
+/// メッセージの整形と出力は区分ごとに最初の1回だけ行い、以後は回数を数えるだけです。
+/// 回数はsetReportIntervalの間隔で、前回からの増分を要約としてログへ出力します。
+///
+/// 集計先はロックなしで引ける固定長のハッシュ表にあり、新しい区分を登録する場合のみ割り当てが発生します。
+/// 呼び出し側が前回の集計先をヒントとして保持していれば、2回目以降はハッシュ値の計算も省かれ、アトミック加算と時刻の記録のみになります。
+///
+class ErrorAggregator {
+public:
+
+	static constexpr size_t kCapacity = 4096;	///< 区分の最大数。超えた例外は集計せずにログへ出力する
+
+	/// @brief 集計結果の1行分
+	struct Entry {
+		std::string node_type;	///< ノードタイプ名
+		std::string place;		///< 発生箇所
+		int status_code;		///< MStatus::MStatusCode
+		uint64_t count;			///< 発生回数
+		uint64_t first_ns;		///< 最初の発生時刻（単調増加時計のナノ秒）
+		uint64_t last_ns;		///< 最後の発生時刻（単調増加時計のナノ秒）
+		std::string sample;		///< 最初に発生した例外のメッセージ
+	};
+
+	ErrorAggregator(void) = delete;
+
+	/// @brief 例外を記録する
+	///
+	/// 区分の最初の1回のみ、e.toString(context + " : " + node_type)をログへ出力します。
+	///
+	/// @param [in] context ログに表示する呼び出し元の種類（"NODE"等）。文字列リテラルを渡すこと
+	/// @param [in] node_type ノードタイプ名
+	/// @param [in] e 例外
+	/// @param [in,out] hint 前回の集計先。同じノードタイプの呼び出し元ごとに1つ持つ。nullptrの場合は毎回ハッシュ表を引く
+	///
+	static void record(const char * context, const MString & node_type, const MStatusException & e, std::atomic<ErrorBucket *> * hint = nullptr);
+
+	/// @brief 要約を出力する間隔を設定する。0で要約を出力しない
+	static void setReportInterval(const uint32_t seconds) noexcept;
+
+	/// @brief 前回の要約以降に増えた区分をログへ出力する
+	static void report(void);
+
+	/// @brief 集計をリセットする。以後、各区分の最初の1回は再びメッセージを出力する
+	static void reset(void) noexcept;
+
+	/// @brief 集計結果を取得する
+	/// @return ノードタイプ・発生箇所・ステータスコード順の集計結果
+	static std::vector<Entry> snapshot(void);
+
+	/// @brief 集計結果を表形式の文字列にする
+	static std::string toText(const std::vector<Entry> & entries);
+
+	/// @brief 集計結果をJSON文字列にする
+	static std::string toJson(const std::vector<Entry> & entries);
+
+private:
+
+	static std::atomic<uint64_t> report_interval_ns_;
+	static std::atomic<uint64_t> next_report_ns_;
+
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_ERROR_AGGREGATOR_HPP_
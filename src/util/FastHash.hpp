@@ -0,0 +1,117 @@
+﻿/// @file FastHash.hpp
+/// @brief 非暗号学的な高速ハッシュ
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_FAST_HASH_HPP_
+#define _MAYA_PLUGIN_BASE_FAST_HASH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace mpb {
+
+/// @brief 128ビットのハッシュ値
+struct Hash128 {
+	uint64_t lo;
+	uint64_t hi;
+
+	bool operator==(const Hash128 & other) const noexcept { return this->lo == other.lo && this->hi == other.hi; }
+	bool operator!=(const Hash128 & other) const noexcept { return !(*this == other); }
+};
+
+
+/// @brief バイト列を逐次入力するハッシュ
+///
+/// 8バイト単位で2系統の乗算・シフトを行う、暗号学的でない高速なハッシュです。内容の同一性の判定（キャッシュのキー）に使います。
+/// 同じバイト列を同じ区切りで入力した場合に同じ値になります。区切りが異なると値も異なることがあります。
+///
+class FastHasher {
+public:
+
+	explicit FastHasher(const uint64_t seed = 0) noexcept
+		: a_(seed ^ 0x9E3779B97F4A7C15ull), b_(~seed ^ 0xC2B2AE3D27D4EB4Full), length_(0) {}
+
+	/// @brief バイト列を入力する
+	void update(const void * data, const size_t size) noexcept {
+		const unsigned char * p = static_cast<const unsigned char *>(data);
+		size_t n = size;
+		while (n >= 8) {
+			uint64_t w;
+			std::memcpy(&w, p, 8);
+			this->mix(w);
+			p += 8;
+			n -= 8;
+		}
+		if (n > 0) {
+			uint64_t w = 0;
+			std::memcpy(&w, p, n);
+			this->mix(w ^ (static_cast<uint64_t>(n) << 56));
+		}
+		this->length_ += size;
+	}
+
+	/// @brief 大きなバイト列を入力する
+	///
+	/// 64バイトごとに8系統へ分けて独立に混ぜ、最後に各系統をこのハッシュへ入力します。
+	/// 系統間に依存がないため、数KB以上の配列ではupdateより数倍速くなります。
+	/// 同じバイト列でもupdateとは異なる値になるため、同じ用途ではどちらか一方に揃えてください。
+	void updateBulk(const void * data, const size_t size) noexcept {
+		const unsigned char * p = static_cast<const unsigned char *>(data);
+		size_t n = size;
+		if (n >= kStripe) {
+			uint64_t lanes[kLanes];
+			for (size_t i = 0; i < kLanes; ++i) lanes[i] = this->a_ + (i + 1) * 0x9E3779B97F4A7C15ull;
+			do {
+				for (size_t i = 0; i < kLanes; ++i) {
+					uint64_t w;
+					std::memcpy(&w, p + i * 8, 8);
+					lanes[i] = (lanes[i] ^ w) * 0x9FB21C651E98DF25ull;
+					lanes[i] ^= lanes[i] >> 29;
+				}
+				p += kStripe;
+				n -= kStripe;
+			} while (n >= kStripe);
+			for (size_t i = 0; i < kLanes; ++i) this->mix(lanes[i]);
+			this->length_ += size - n;
+		}
+		this->update(p, n);
+	}
+
+	/// @brief 値をそのままのバイト表現で入力する
+	template <class T> void updateValue(const T & value) noexcept { this->update(&value, sizeof(T)); }
+
+	/// @brief ハッシュ値を取得する
+	Hash128 digest(void) const noexcept {
+		const uint64_t a = fmix(this->a_ ^ this->length_);
+		const uint64_t b = fmix(this->b_ + this->length_);
+		return Hash128{ a ^ b, fmix(a + b) };
+	}
+
+private:
+	static constexpr size_t kLanes = 8;
+	static constexpr size_t kStripe = kLanes * 8;
+
+	uint64_t a_;
+	uint64_t b_;
+	uint64_t length_;
+
+	void mix(const uint64_t w) noexcept {
+		this->a_ = (this->a_ ^ w) * 0x9FB21C651E98DF25ull;
+		this->a_ ^= this->a_ >> 29;
+		this->b_ = (this->b_ + w) * 0xFF51AFD7ED558CCDull;
+		this->b_ ^= this->b_ >> 32;
+	}
+
+	static uint64_t fmix(uint64_t k) noexcept {
+		k ^= k >> 33;
+		k *= 0xFF51AFD7ED558CCDull;
+		k ^= k >> 33;
+		k *= 0xC4CEB9FE1A85EC53ull;
+		k ^= k >> 33;
+		return k;
+	}
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_FAST_HASH_HPP_
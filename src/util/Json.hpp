@@ -0,0 +1,31 @@
+﻿/// @file Json.hpp
+/// @brief 統計のJSON出力で共有する小さな補助関数
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_JSON_HPP_
+#define _MAYA_PLUGIN_BASE_JSON_HPP_
+
+#include <ostream>
+#include <string>
+
+namespace mpb {
+
+/// @brief 文字列をJSONの文字列リテラルとして出力する
+///
+/// 引用符とバックスラッシュはエスケープし、制御文字は空白に置き換える。
+/// @param [out] os 出力先
+/// @param [in] s 出力する文字列
+inline void appendJsonString(std::ostream & os, const std::string & s)
+{
+	os << '"';
+	for (const char c : s) {
+		if (c == '"' || c == '\\') os << '\\' << c;
+		else if (static_cast<unsigned char>(c) < 0x20) os << ' ';
+		else os << c;
+	}
+	os << '"';
+}
+
+}; // end of mpb
+
+#endif // end of _MAYA_PLUGIN_BASE_JSON_HPP_
@@ -0,0 +1,244 @@
+﻿#include "Logger.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+std::atomic<int> mpb::Logger::level_(MPB_LOG_MIN_LEVEL);
+std::atomic<uint32_t> mpb::Logger::rate_limit_(10);
+
+constexpr size_t mpb::Logger::kCapacity;
+constexpr size_t mpb::Logger::kMessageSize;
+
+namespace {
+
+static_assert((mpb::Logger::kCapacity & (mpb::Logger::kCapacity - 1)) == 0, "kCapacity must be a power of two");
+
+constexpr size_t kMask = mpb::Logger::kCapacity - 1;
+
+/// リングバッファの1件。seqがpos+1になったら読み出し可能、pos+kCapacityになったら次の周回で書き込み可能
+struct Slot {
+	std::atomic<size_t> seq;
+	mpb::LogLevel level;
+	uint32_t suppressed;
+	char text[mpb::Logger::kMessageSize];
+};
+
+enum DrainMode : int {
+	kIdle,		///< ドレインスレッド未起動
+	kRunning,	///< ドレインスレッドが出力する
+	kStopped,	///< 停止後。書き込んだスレッドがそのまま出力する
+};
+
+struct State {
+	Slot slots[mpb::Logger::kCapacity];
+	std::atomic<size_t> enqueue_pos{ 0 };
+	std::atomic<size_t> dequeue_pos{ 0 };	///< 書き込み側が滞留量を見るためだけに公開する
+	std::atomic<uint64_t> written{ 0 };
+	std::atomic<uint64_t> dropped{ 0 };
+	std::atomic<uint64_t> suppressed{ 0 };
+	std::atomic<uint64_t> reported{ 0 };		///< suppressedのうち、メッセージに添えて出力した件数
+	std::atomic<uint64_t> coarse_seconds{ 0 };	///< ドレインスレッドが更新する現在時刻(秒)。流量制限で時計を読まずに済ませる
+
+	std::mutex drain_mutex;		///< 読み出し側を常に1つにする
+	std::atomic<int> mode{ kIdle };
+	std::mutex thread_mutex;
+	std::condition_variable cv;
+	bool stopping = false;
+	std::thread thread;
+
+	State(void) { for (size_t i = 0; i < mpb::Logger::kCapacity; ++i) this->slots[i].seq.store(i, std::memory_order_relaxed); }
+};
+
+uint64_t nowSeconds(void) noexcept
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+State & state(void)
+{
+	// ドレインスレッドが静的オブジェクトの破棄後も触れるよう、解放しない
+	static State * const s = new State;
+	return *s;
+}
+
+/// 読み出し可能なものをすべて出力する。drain_mutexを保持して呼び出すこと
+void drainLocked(State & s)
+{
+	size_t pos = s.dequeue_pos.load(std::memory_order_relaxed);
+	bool out = false, err = false;
+	for (;;) {
+		Slot & slot = s.slots[pos & kMask];
+		if (slot.seq.load(std::memory_order_acquire) != pos + 1) break;
+		const bool to_err = (slot.level >= mpb::LogLevel::kWarning);
+		std::ostream & os = (to_err ? std::cerr : std::cout);
+		os << slot.text;
+		if (slot.suppressed != 0) os << " (同じ箇所のログを" << slot.suppressed << "件省略)";
+		os << '\n';
+		(to_err ? err : out) = true;
+		slot.seq.store(pos + mpb::Logger::kCapacity, std::memory_order_release);
+		s.dequeue_pos.store(++pos, std::memory_order_release);
+	}
+	if (out) std::cout.flush();
+	if (err) std::cerr.flush();
+}
+
+void flushUpTo(State & s, const size_t target)
+{
+	std::lock_guard<std::mutex> lock(s.drain_mutex);
+	for (;;) {
+		drainLocked(s);
+		// スロットを確保した書き込み側が整形を終えるまで待つ
+		if (s.dequeue_pos.load(std::memory_order_relaxed) >= target) break;
+		std::this_thread::yield();
+	}
+}
+
+void drainLoop(State & s)
+{
+	std::unique_lock<std::mutex> lock(s.thread_mutex);
+	while (!s.stopping) {
+		s.coarse_seconds.store(nowSeconds(), std::memory_order_relaxed);
+		lock.unlock();
+		{
+			std::lock_guard<std::mutex> drain(s.drain_mutex);
+			drainLocked(s);
+		}
+		lock.lock();
+		s.cv.wait_for(lock, std::chrono::milliseconds(10), [&s] { return s.stopping; });
+	}
+}
+
+void stopDrain(void)
+{
+	State & s = state();
+	{
+		std::lock_guard<std::mutex> lock(s.thread_mutex);
+		if (s.mode.load(std::memory_order_relaxed) != kRunning) {
+			s.mode.store(kStopped, std::memory_order_release);
+			return;
+		}
+		s.stopping = true;
+	}
+	s.cv.notify_all();
+	s.thread.join();
+	s.mode.store(kStopped, std::memory_order_release);
+}
+
+/// 最初の書き込みでドレインスレッドを起動する
+void startDrain(State & s) noexcept
+{
+	std::lock_guard<std::mutex> lock(s.thread_mutex);
+	if (s.mode.load(std::memory_order_relaxed) != kIdle) return;
+	try {
+		s.stopping = false;
+		s.coarse_seconds.store(nowSeconds(), std::memory_order_relaxed);
+		s.thread = std::thread(drainLoop, std::ref(s));
+		s.mode.store(kRunning, std::memory_order_release);
+		// atexitでjoinすると、WindowsではDLLのアンロード中にローダーロックを持ったまま待つことになりデッドロックする。
+		// 停止は必ずshutdownGlobalで行う
+	}
+	catch (...) {
+		s.mode.store(kStopped, std::memory_order_release);
+	}
+}
+
+}
+
+bool mpb::LogSite::admit(void) noexcept
+{
+	const uint32_t limit = Logger::rateLimit();
+	if (limit == 0) return true;
+
+	// ドレインスレッドの動作中は、10ms間隔で更新される時刻で足りる
+	const State & s = state();
+	const uint64_t now = (s.mode.load(std::memory_order_relaxed) == kRunning ? s.coarse_seconds.load(std::memory_order_relaxed) : nowSeconds());
+	uint64_t current = this->window.load(std::memory_order_relaxed);
+	if (current != now && this->window.compare_exchange_strong(current, now, std::memory_order_relaxed)) {
+		this->count.store(0, std::memory_order_relaxed);
+	}
+	if (this->count.fetch_add(1, std::memory_order_relaxed) < limit) return true;
+
+	this->suppressed.fetch_add(1, std::memory_order_relaxed);
+	state().suppressed.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+void mpb::Logger::setLevel(const LogLevel level) noexcept
+{ level_.store(static_cast<int>(level), std::memory_order_relaxed); }
+
+void mpb::Logger::setRateLimit(const uint32_t per_second) noexcept
+{ rate_limit_.store(per_second, std::memory_order_relaxed); }
+
+void mpb::Logger::write(const LogLevel level, LogSite & site, const char * format, ...) noexcept
+{
+	State & s = state();
+
+	size_t pos = s.enqueue_pos.load(std::memory_order_relaxed);
+	Slot * slot;
+	for (;;) {
+		slot = &s.slots[pos & kMask];
+		const intptr_t diff = static_cast<intptr_t>(slot->seq.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos);
+		if (diff == 0) {
+			if (s.enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+		}
+		else if (diff < 0) {
+			// 一杯のときは待たずに捨てる
+			s.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		else {
+			pos = s.enqueue_pos.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->level = level;
+	slot->suppressed = site.suppressed.exchange(0, std::memory_order_relaxed);
+	if (slot->suppressed != 0) s.reported.fetch_add(slot->suppressed, std::memory_order_relaxed);
+	va_list args;
+	va_start(args, format);
+	const int n = std::vsnprintf(slot->text, kMessageSize, format, args);
+	va_end(args);
+	if (n < 0) slot->text[0] = '\0';
+	slot->seq.store(pos + 1, std::memory_order_release);
+	s.written.fetch_add(1, std::memory_order_relaxed);
+
+	const int mode = s.mode.load(std::memory_order_acquire);
+	if (mode == kRunning) {
+		// 半分まで溜まったら待機を切り上げさせる
+		if (pos - s.dequeue_pos.load(std::memory_order_relaxed) == kCapacity / 2) s.cv.notify_one();
+	}
+	else if (mode == kIdle) {
+		startDrain(s);
+	}
+	else {
+		try { flushUpTo(s, pos + 1); }
+		catch (...) {}
+	}
+}
+
+void mpb::Logger::flush(void)
+{
+	State & s = state();
+	flushUpTo(s, s.enqueue_pos.load(std::memory_order_acquire));
+}
+
+mpb::Logger::Stats mpb::Logger::stats(void) noexcept
+{
+	const State & s = state();
+	return Stats{ s.written.load(std::memory_order_relaxed), s.dropped.load(std::memory_order_relaxed), s.suppressed.load(std::memory_order_relaxed) };
+}
+
+void mpb::Logger::shutdownGlobal(void)
+{
+	stopDrain();
+	State & s = state();
+	const uint64_t suppressed = s.suppressed.load(std::memory_order_relaxed);
+	const uint64_t reported = s.reported.exchange(suppressed, std::memory_order_relaxed);
+	const uint64_t unreported = (suppressed > reported ? suppressed - reported : 0);
+	if (unreported != 0) MPB_LOG_WARNING("LOGGER : 流量制限で省略したログが%llu件あります", static_cast<unsigned long long>(unreported));
+	Logger::flush();
+}
@@ -0,0 +1,145 @@
+﻿/// @file Logger.hpp
+/// @brief Loggerクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_LOGGER_HPP_
+#define _MAYA_PLUGIN_BASE_LOGGER_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// @brief コンパイル時に残すログの最低レベル（0:Debug 1:Info 2:Warning 3:Error）
+///
+/// これより低いレベルのMPB_LOG_XXXは空文に置き換わり、引数も評価されません。
+#ifndef MPB_LOG_MIN_LEVEL
+#ifdef _DEBUG
+#define MPB_LOG_MIN_LEVEL 0
+#else
+#define MPB_LOG_MIN_LEVEL 1
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MPB_LOG_PRINTF_FORMAT(fmt, args) __attribute__((format(printf, fmt, args)))
+#else
+#define MPB_LOG_PRINTF_FORMAT(fmt, args)
+#endif
+
+/// @brief ログを書き込む。Warning/Errorは呼び出し箇所ごとに流量を制限する
+///
+/// 引数はprintf形式。レベルが無効な場合と流量制限にかかった場合は、引数は評価されません。
+/// Debug/Infoは登録・解除の一覧のように短時間に続けて出すものがあるため、制限しません（不要ならsetLevelで止めます）。
+#define MPB_LOG(level, ...) \
+	do { \
+		if (::mpb::Logger::isEnabled(level)) { \
+			static ::mpb::LogSite mpb_log_site_; \
+			if (static_cast<int>(level) < static_cast<int>(::mpb::LogLevel::kWarning) || mpb_log_site_.admit()) ::mpb::Logger::write((level), mpb_log_site_, __VA_ARGS__); \
+		} \
+	} while (false)
+
+#if MPB_LOG_MIN_LEVEL <= 0
+#define MPB_LOG_DEBUG(...) MPB_LOG(::mpb::LogLevel::kDebug, __VA_ARGS__)
+#else
+#define MPB_LOG_DEBUG(...) do {} while (false)
+#endif
+#if MPB_LOG_MIN_LEVEL <= 1
+#define MPB_LOG_INFO(...) MPB_LOG(::mpb::LogLevel::kInfo, __VA_ARGS__)
+#else
+#define MPB_LOG_INFO(...) do {} while (false)
+#endif
+#if MPB_LOG_MIN_LEVEL <= 2
+#define MPB_LOG_WARNING(...) MPB_LOG(::mpb::LogLevel::kWarning, __VA_ARGS__)
+#else
+#define MPB_LOG_WARNING(...) do {} while (false)
+#endif
+#define MPB_LOG_ERROR(...) MPB_LOG(::mpb::LogLevel::kError, __VA_ARGS__)
+
+namespace mpb {
+
+/// @brief ログの重要度
+enum class LogLevel : int {
+	kDebug = 0,
+	kInfo = 1,
+	kWarning = 2,
+	kError = 3,
+};
+
+/// @brief ログの呼び出し箇所ごとの流量制限の状態
+///
+/// MPB_LOGがstatic変数として呼び出し箇所ごとに1つ持ちます。
+/// 1秒ごとの窓でLogger::rateLimit()件まで通し、超えた分は数だけ数えて次に通った1件に件数を添えます。
+/// 次の1件が来ないまま終わった分は、Logger::shutdownGlobalが合計を出力します。
+///
+struct LogSite {
+	std::atomic<uint64_t> window{ 0 };		///< 現在の窓の番号(秒)
+	std::atomic<uint32_t> count{ 0 };		///< 現在の窓で通した件数
+	std::atomic<uint32_t> suppressed{ 0 };	///< 前回通してから捨てた件数
+
+	/// @brief 書き込んでよいか判定する
+	bool admit(void) noexcept;
+};
+
+/// @brief 非同期でログを出力するロガー
+///
+/// 書き込み側はリングバッファのスロットを1つ確保してメッセージを整形するだけで、ロックもI/Oも行いません。
+/// 出力は常駐するドレインスレッドがまとめて行い、Debug/Infoは標準出力、Warning/Errorは標準エラーへ書き出します。
+/// リングバッファが一杯の場合は待たずに破棄し、件数をstats().droppedに数えます。
+///
+/// ドレインスレッドは最初の書き込み時に起動し、shutdownGlobal()で残りを出力して停止します。
+/// 停止後の書き込みは呼び出しスレッドでそのまま出力します。
+///
+class Logger {
+public:
+
+	static constexpr size_t kCapacity = 1024;		///< リングバッファのスロット数（2のべき乗）
+	static constexpr size_t kMessageSize = 480;	///< 1件の最大バイト数（超えた分は切り捨て）
+
+	/// @brief 累計の件数
+	struct Stats {
+		uint64_t written;		///< リングバッファへ書き込んだ件数
+		uint64_t dropped;		///< リングバッファが一杯で破棄した件数
+		uint64_t suppressed;	///< 流量制限で捨てた件数
+	};
+
+	/// @brief 指定レベルが出力対象か
+	static bool isEnabled(const LogLevel level) noexcept
+	{ return static_cast<int>(level) >= MPB_LOG_MIN_LEVEL && static_cast<int>(level) >= level_.load(std::memory_order_relaxed); }
+
+	/// @brief 実行時の最低レベルを設定する（コンパイル時に除去されたレベルは戻せない）
+	static void setLevel(const LogLevel level) noexcept;
+
+	/// @brief Warning/Errorの呼び出し箇所ごとの1秒あたりの上限件数を設定する。0で無制限
+	static void setRateLimit(const uint32_t per_second) noexcept;
+
+	/// @brief 呼び出し箇所ごとの1秒あたりの上限件数
+	static uint32_t rateLimit(void) noexcept { return rate_limit_.load(std::memory_order_relaxed); }
+
+	/// @brief ログを書き込む。MPB_LOG_XXXマクロから呼び出す
+	/// @param level 重要度
+	/// @param site 呼び出し箇所。流量制限で捨てた件数をメッセージに添える
+	/// @param format printf形式の書式
+	static void write(const LogLevel level, LogSite & site, const char * format, ...) noexcept MPB_LOG_PRINTF_FORMAT(3, 4);
+
+	/// @brief 呼び出し時点までに書き込まれたログをすべて出力する
+	static void flush(void);
+
+	/// @brief 累計の件数を取得する
+	static Stats stats(void) noexcept;
+
+	/// @brief ドレインスレッドを停止する
+	///
+	/// 残っているログと、流量制限で省略したまま報告されていない件数を出力してから停止します。DLLのアンロード前（uninitializePlugin、初期化に失敗したinitializePlugin）に必ず呼び出してください。
+	/// 終了時に自動では停止しません。
+	static void shutdownGlobal(void);
+
+private:
+	Logger(void) = delete;
+
+	static std::atomic<int> level_;
+	static std::atomic<uint32_t> rate_limit_;
+};
+
+}; // end of mpb
+
+#endif // end of _MAYA_PLUGIN_BASE_LOGGER_HPP_
@@ -0,0 +1,178 @@
+﻿#include "MemoCache.hpp"
+#include "util/Json.hpp"
+#include <iterator>
+#include <map>
+#include <sstream>
+
+const size_t mpb::MemoCache::kDefaultBudget;
+const size_t mpb::MemoCache::kEntryOverhead;
+std::atomic<bool> mpb::MemoCache::enabled_(true);
+std::atomic<size_t> mpb::MemoCache::default_budget_(mpb::MemoCache::kDefaultBudget);
+
+namespace {
+
+std::mutex registry_mutex;
+
+std::map<std::string, std::unique_ptr<mpb::MemoCache>> & registry(void)
+{
+	static std::map<std::string, std::unique_ptr<mpb::MemoCache>> caches;
+	return caches;
+}
+
+}
+
+void mpb::MemoCache::setEnabled(const bool enabled) noexcept
+{ enabled_.store(enabled, std::memory_order_relaxed); }
+
+void mpb::MemoCache::setDefaultBudget(const size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	default_budget_.store(bytes, std::memory_order_relaxed);
+	for (auto & kv : registry()) {
+		MemoCache & cache = *kv.second;
+		std::list<Entry> evicted;
+		std::lock_guard<std::mutex> cache_lock(cache.mutex_);
+		if (!cache.own_budget_) cache.setBudgetLocked(bytes, false, evicted);
+	}
+}
+
+void mpb::MemoCache::setBudget(const std::string & node_type, const size_t bytes)
+{
+	MemoCache & cache = MemoCache::forType(node_type);
+	std::list<Entry> evicted;
+	std::lock_guard<std::mutex> lock(cache.mutex_);
+	cache.setBudgetLocked(bytes, true, evicted);
+}
+
+mpb::MemoCache & mpb::MemoCache::forType(const std::string & node_type)
+{
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	auto & caches = registry();
+	auto it = caches.find(node_type);
+	if (it == caches.end()) {
+		it = caches.emplace(node_type, std::unique_ptr<MemoCache>(new MemoCache(node_type, MemoCache::defaultBudget()))).first;
+	}
+	return *it->second;
+}
+
+std::vector<mpb::MemoCache::Stats> mpb::MemoCache::snapshot(void)
+{
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	std::vector<Stats> ret;
+	ret.reserve(registry().size());
+	for (const auto & kv : registry()) ret.push_back(kv.second->stats());
+	return ret;
+}
+
+void mpb::MemoCache::clearAll(void)
+{
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	for (auto & kv : registry()) kv.second->clear();
+}
+
+std::string mpb::MemoCache::toText(const std::vector<Stats> & stats)
+{
+	std::ostringstream os;
+	os << "node\thits\tmisses\tinsertions\tevictions\tentries\tbytes\tbudget\n";
+	for (const auto & s : stats) {
+		os << s.node_type << '\t' << s.hits << '\t' << s.misses << '\t' << s.insertions << '\t' << s.evictions << '\t'
+			<< s.entries << '\t' << s.bytes << '\t' << s.budget << '\n';
+	}
+	return os.str();
+}
+
+std::string mpb::MemoCache::toJson(const std::vector<Stats> & stats)
+{
+	std::ostringstream os;
+	os << '[';
+	for (size_t i = 0; i < stats.size(); ++i) {
+		const Stats & s = stats[i];
+		if (i != 0) os << ',';
+		os << "{\"node\":";
+		appendJsonString(os, s.node_type);
+		os << ",\"hits\":" << s.hits << ",\"misses\":" << s.misses << ",\"insertions\":" << s.insertions
+			<< ",\"evictions\":" << s.evictions << ",\"entries\":" << s.entries << ",\"bytes\":" << s.bytes
+			<< ",\"budget\":" << s.budget << '}';
+	}
+	os << ']';
+	return os.str();
+}
+
+
+mpb::MemoCache::MemoCache(const std::string & node_type, const size_t budget)
+	: node_type_(node_type), budget_(budget), own_budget_(false), bytes_(0), hits_(0), misses_(0), insertions_(0), evictions_(0)
+{}
+
+mpb::MemoCache::Blob mpb::MemoCache::find(const Hash128 & key)
+{
+	std::lock_guard<std::mutex> lock(this->mutex_);
+	const auto it = this->index_.find(key.lo);
+	if (it == this->index_.end() || it->second->key != key) {
+		++this->misses_;
+		return Blob();
+	}
+	// 先頭へ移す
+	this->lru_.splice(this->lru_.begin(), this->lru_, it->second);
+	++this->hits_;
+	return it->second->blob;
+}
+
+void mpb::MemoCache::insert(const Hash128 & key, std::vector<char> && bytes)
+{
+	const size_t cost = bytes.size() + kEntryOverhead;
+	Blob blob = std::make_shared<const std::vector<char>>(std::move(bytes));
+
+	// 古いものの破棄はロックの外で行う
+	std::list<Entry> evicted;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		if (cost > this->budget_) return;
+
+		const auto it = this->index_.find(key.lo);
+		if (it != this->index_.end()) {
+			this->bytes_ -= it->second->cost;
+			evicted.splice(evicted.end(), this->lru_, it->second);
+			this->index_.erase(it);
+		}
+		this->lru_.push_front(Entry{ key, std::move(blob), cost });
+		this->index_[key.lo] = this->lru_.begin();
+		this->bytes_ += cost;
+		++this->insertions_;
+
+		this->evictLocked(evicted);
+	}
+}
+
+void mpb::MemoCache::clear(void)
+{
+	std::list<Entry> evicted;
+	std::lock_guard<std::mutex> lock(this->mutex_);
+	evicted.swap(this->lru_);
+	this->index_.clear();
+	this->bytes_ = 0;
+	this->hits_ = this->misses_ = this->insertions_ = this->evictions_ = 0;
+}
+
+mpb::MemoCache::Stats mpb::MemoCache::stats(void) const
+{
+	std::lock_guard<std::mutex> lock(this->mutex_);
+	return Stats{ this->node_type_, this->hits_, this->misses_, this->insertions_, this->evictions_, this->lru_.size(), this->bytes_, this->budget_ };
+}
+
+void mpb::MemoCache::evictLocked(std::list<Entry> & evicted)
+{
+	while (this->bytes_ > this->budget_ && !this->lru_.empty()) {
+		const auto last = std::prev(this->lru_.end());
+		this->index_.erase(last->key.lo);
+		this->bytes_ -= last->cost;
+		evicted.splice(evicted.end(), this->lru_, last);
+		++this->evictions_;
+	}
+}
+
+void mpb::MemoCache::setBudgetLocked(const size_t bytes, const bool own, std::list<Entry> & evicted)
+{
+	this->budget_ = bytes;
+	this->own_budget_ = own;
+	this->evictLocked(evicted);
+}
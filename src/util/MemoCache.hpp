@@ -0,0 +1,149 @@
+﻿/// @file MemoCache.hpp
+/// @brief MemoCacheクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_MEMO_CACHE_HPP_
+#define _MAYA_PLUGIN_BASE_MEMO_CACHE_HPP_
+
+#include "util/FastHash.hpp"
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mpb {
+
+/// @brief ノードタイプごとの計算結果のLRUキャッシュ
+///
+/// 入力のハッシュ値をキーとして、出力をエンコードしたバイト列を保持します。
+/// NodeBase::memoSpecで対象を宣言したノードのcomputeから使われ、同じノードタイプのインスタンス間で共有されます。
+///
+/// 保持量がノードタイプごとの上限を超えると、最も長く参照されていないものから破棄します。
+/// 上限と有効・無効はプラグインのロード時（addNodes等）に設定してください。実行中の変更も可能で、縮めた場合はその場で破棄されます。
+///
+class MemoCache {
+public:
+
+	/// @brief 保持しているバイト列。参照中は破棄されない
+	typedef std::shared_ptr<const std::vector<char>> Blob;
+
+	/// @brief 統計
+	struct Stats {
+		std::string node_type;	///< ノードタイプ名
+		uint64_t hits;			///< キャッシュから出力を復元した回数
+		uint64_t misses;		///< 見つからず計算した回数
+		uint64_t insertions;	///< 追加した回数
+		uint64_t evictions;		///< 上限により破棄した回数
+		size_t entries;			///< 保持している件数
+		size_t bytes;			///< 保持しているバイト数（管理領域の概算を含む）
+		size_t budget;			///< 上限のバイト数
+	};
+
+	/// @brief ノードタイプごとの既定の上限
+	static const size_t kDefaultBudget = size_t(64) << 20;
+
+	/// @brief 1件あたりの管理領域の概算
+	static const size_t kEntryOverhead = 96;
+
+
+	/// @brief メモ化が有効か（既定では有効）
+	static bool isEnabled(void) noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+	/// @brief メモ化の有効・無効を切り替える
+	///
+	/// 無効にしても保持しているものは破棄しません。破棄する場合はclearAllを呼び出してください。
+	///
+	static void setEnabled(const bool enabled) noexcept;
+
+	/// @brief すべてのノードタイプの上限を設定する
+	///
+	/// setBudget(node_type, bytes)で個別に設定したノードタイプには影響しません。0の場合は保持しません。
+	///
+	static void setDefaultBudget(const size_t bytes);
+
+	/// @brief 既定の上限
+	static size_t defaultBudget(void) noexcept { return default_budget_.load(std::memory_order_relaxed); }
+
+	/// @brief ノードタイプの上限を個別に設定する
+	static void setBudget(const std::string & node_type, const size_t bytes);
+
+	/// @brief ノードタイプのキャッシュを取得する。なければ作る
+	///
+	/// 返したキャッシュはプラグインのアンロードまで破棄されないため、ポインタを保持して構いません。
+	///
+	static MemoCache & forType(const std::string & node_type);
+
+	/// @brief 全ノードタイプの統計
+	/// @return ノードタイプ名順の統計
+	static std::vector<Stats> snapshot(void);
+
+	/// @brief 全ノードタイプの保持しているものを破棄し、統計をリセットする
+	static void clearAll(void);
+
+	/// @brief 統計を表形式の文字列にする
+	static std::string toText(const std::vector<Stats> & stats);
+
+	/// @brief 統計をJSON文字列にする
+	static std::string toJson(const std::vector<Stats> & stats);
+
+
+	MemoCache(const MemoCache &) = delete;
+	MemoCache & operator=(const MemoCache &) = delete;
+
+	/// @brief キーに対応するバイト列を探す
+	///
+	/// 見つかった場合は最近参照したものとして扱い、ヒットとして数えます。見つからなければミスとして数えます。
+	///
+	/// @return 見つからなければ空
+	///
+	Blob find(const Hash128 & key);
+
+	/// @brief バイト列を追加する
+	///
+	/// 同じキーがあれば置き換えます。上限を超える分は古いものから破棄します。
+	///
+	void insert(const Hash128 & key, std::vector<char> && bytes);
+
+	/// @brief 保持しているものを破棄し、統計をリセットする
+	void clear(void);
+
+	/// @brief 統計
+	Stats stats(void) const;
+
+	const std::string & nodeType(void) const noexcept { return this->node_type_; }
+
+private:
+	struct Entry {
+		Hash128 key;
+		Blob blob;
+		size_t cost;
+	};
+
+	const std::string node_type_;
+	size_t budget_;
+	bool own_budget_;		///< setBudgetで個別に設定されたか
+	std::list<Entry> lru_;	///< 先頭ほど最近参照された
+	std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+	size_t bytes_;
+	uint64_t hits_;
+	uint64_t misses_;
+	uint64_t insertions_;
+	uint64_t evictions_;
+	mutable std::mutex mutex_;
+
+	static std::atomic<bool> enabled_;
+	static std::atomic<size_t> default_budget_;
+
+	MemoCache(const std::string & node_type, const size_t budget);
+
+	/// @brief 上限に収まるまで古いものをevictedへ移す。mutex_を取得済みであること
+	void evictLocked(std::list<Entry> & evicted);
+	void setBudgetLocked(const size_t bytes, const bool own, std::list<Entry> & evicted);
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_MEMO_CACHE_HPP_
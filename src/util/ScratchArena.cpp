@@ -0,0 +1,138 @@
+﻿#include "ScratchArena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+const size_t mpb::ScratchArena::kDefaultBlockSize;
+
+namespace {
+
+// Scopeの中で使用中のアリーナ
+thread_local mpb::ScratchArena * current_arena = nullptr;
+
+size_t padding(const char * p, const size_t alignment) noexcept
+{
+	return static_cast<size_t>(-reinterpret_cast<uintptr_t>(p)) & (alignment - 1);
+}
+
+}
+
+mpb::ScratchArena::Scope::Scope(ScratchArena & arena) noexcept
+	: arena_(arena), marker_(arena.mark()), saved_peak_(arena.peak_), saved_current_(current_arena)
+{
+	arena.peak_ = arena.used_;
+	current_arena = &arena;
+}
+
+mpb::ScratchArena::Scope::~Scope(void)
+{
+	this->arena_.peak_ = std::max(this->saved_peak_, this->arena_.peak_);
+	this->arena_.rewind(this->marker_);
+	current_arena = this->saved_current_;
+}
+
+size_t mpb::ScratchArena::Scope::peakBytes(void) const noexcept
+{ return this->arena_.peak_ - this->marker_.used; }
+
+
+mpb::ScratchArena::ScratchArena(const size_t block_size) noexcept
+	: block_(0), offset_(0), used_(0), used_before_(0), peak_(0), high_water_(0), block_allocations_(0),
+	block_size_(block_size > 0 ? block_size : kDefaultBlockSize)
+{}
+
+mpb::ScratchArena::~ScratchArena(void)
+{
+	for (const Block & b : this->blocks_) ::operator delete(b.data);
+}
+
+void * mpb::ScratchArena::allocate(const size_t bytes, const size_t alignment)
+{
+	if (this->block_ < this->blocks_.size()) {
+		Block & b = this->blocks_[this->block_];
+		const size_t start = this->offset_ + padding(b.data + this->offset_, alignment);
+		if (start + bytes <= b.size) {
+			this->offset_ = start + bytes;
+			this->used_ = this->used_before_ + this->offset_;
+			if (this->used_ > this->peak_) this->peak_ = this->used_;
+			if (this->used_ > this->high_water_) this->high_water_ = this->used_;
+			return b.data + start;
+		}
+	}
+	return this->allocateSlow(bytes, alignment);
+}
+
+void * mpb::ScratchArena::allocateSlow(const size_t bytes, const size_t alignment)
+{
+	const size_t needed = bytes + alignment;
+	if (this->blocks_.empty()) {
+		this->blocks_.push_back(this->newBlock(std::max(this->block_size_, needed)));
+		this->block_ = 0;
+		this->offset_ = 0;
+		this->used_before_ = 0;
+	}
+	else {
+		// 次のブロックへ移る。残りは使わない
+		const size_t next = this->block_ + 1;
+		if (next >= this->blocks_.size() || this->blocks_[next].size < needed) {
+			const size_t size = std::max(this->blocks_[this->block_].size * 2, needed);
+			this->blocks_.insert(this->blocks_.begin() + next, this->newBlock(size));
+		}
+		this->used_before_ += this->offset_;
+		this->block_ = next;
+		this->offset_ = 0;
+	}
+	return this->allocate(bytes, alignment);
+}
+
+mpb::ScratchArena::Block mpb::ScratchArena::newBlock(const size_t size)
+{
+	Block b{ static_cast<char *>(::operator new(size)), size };
+	++this->block_allocations_;
+	return b;
+}
+
+void mpb::ScratchArena::deallocate(void * p, const size_t bytes) noexcept
+{
+	if (this->block_ >= this->blocks_.size()) return;
+	char * const top = this->blocks_[this->block_].data + this->offset_;
+	if (static_cast<char *>(p) + bytes == top) {
+		this->offset_ -= bytes;
+		this->used_ = this->used_before_ + this->offset_;
+	}
+}
+
+void mpb::ScratchArena::rewind(const Marker & marker) noexcept
+{
+	this->block_ = marker.block;
+	this->offset_ = marker.offset;
+	this->used_ = marker.used;
+	this->used_before_ = marker.used - marker.offset;
+
+	// 先頭まで戻ったら、次回は1ブロックで足りるようにまとめる
+	if (marker.used == 0 && this->blocks_.size() > 1) {
+		const size_t total = this->capacity();
+		for (const Block & b : this->blocks_) ::operator delete(b.data);
+		this->blocks_.clear();
+		try {
+			this->blocks_.push_back(this->newBlock(total));
+		}
+		catch (const std::bad_alloc &) {
+			// 次のallocateで改めて確保する
+		}
+	}
+}
+
+size_t mpb::ScratchArena::capacity(void) const noexcept
+{
+	size_t total = 0;
+	for (const Block & b : this->blocks_) total += b.size;
+	return total;
+}
+
+mpb::ScratchArena & mpb::ScratchArena::current(void) noexcept
+{ return current_arena ? *current_arena : threadLocal(); }
+
+mpb::ScratchArena & mpb::ScratchArena::threadLocal(void) noexcept
+{
+	thread_local ScratchArena arena;
+	return arena;
+}
@@ -0,0 +1,184 @@
+﻿/// @file ScratchArena.hpp
+/// @brief ScratchArenaクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_SCRATCH_ARENA_HPP_
+#define _MAYA_PLUGIN_BASE_SCRATCH_ARENA_HPP_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace mpb {
+
+/// @brief compute内の一時領域向けのバンプアロケーター
+///
+/// 確保はポインタを進めるだけで、個別の解放は行いません。Scopeを抜けると、その開始時点まで一括で巻き戻されます。
+/// ブロックが足りなくなると倍々で追加し、最も外側のScopeを抜けたときに複数のブロックを1つにまとめます。
+/// そのため、毎回同程度の量を使う定常状態では、ヒープの確保も解放も発生しません。
+///
+/// スレッドセーフではありません。1つのアリーナは同時に1つのスレッドからのみ使用してください。
+/// NodeBaseはノードごとにアリーナを持ち、computeの間だけcurrent()として設定します。
+///
+class ScratchArena {
+public:
+
+	/// @brief 最初のブロックのバイト数
+	static const size_t kDefaultBlockSize = 4096;
+
+	/// @brief 巻き戻し位置
+	struct Marker {
+		size_t block;		///< ブロック番号
+		size_t offset;		///< ブロック内の位置
+		size_t used;		///< 全体の使用バイト数
+	};
+
+	/// @brief 巻き戻しを自動で行う区間
+	///
+	/// 生成時点の位置を記録し、破棄時にそこまで巻き戻します。区間中はアリーナをこのスレッドのcurrent()に設定します。
+	/// 区間は入れ子にでき、内側の区間で確保した領域は内側の区間を抜けた時点で無効になります。
+	///
+	class Scope {
+	public:
+		explicit Scope(ScratchArena & arena) noexcept;
+		~Scope(void);
+		Scope(const Scope &) = delete;
+		Scope & operator=(const Scope &) = delete;
+
+		/// @brief この区間で同時に使用した最大バイト数
+		size_t peakBytes(void) const noexcept;
+
+	private:
+		ScratchArena & arena_;
+		const Marker marker_;
+		const size_t saved_peak_;
+		ScratchArena * const saved_current_;
+	};
+
+	/// @brief コンストラクタ
+	///
+	/// 最初に確保するまでメモリは確保しません。
+	///
+	/// @param [in] block_size 最初のブロックのバイト数
+	///
+	explicit ScratchArena(const size_t block_size = kDefaultBlockSize) noexcept;
+
+	~ScratchArena(void);
+
+	ScratchArena(const ScratchArena &) = delete;
+	ScratchArena & operator=(const ScratchArena &) = delete;
+
+	/// @brief 領域を確保する
+	///
+	/// @param [in] bytes バイト数
+	/// @param [in] alignment 境界。2のべき乗
+	/// @return 確保した領域。内容は不定です
+	///
+	/// @throws std::bad_alloc ブロックの追加に失敗した場合
+	///
+	void * allocate(const size_t bytes, const size_t alignment = alignof(std::max_align_t));
+
+	/// @brief 要素配列を確保する
+	///
+	/// 要素は初期化されず、デストラクタも呼ばれないため、トリビアルな型のみ扱えます。
+	///
+	template <class T> T * allocateArray(const size_t count) {
+		static_assert(std::is_trivially_destructible<T>::value, "ScratchArena can only hold trivially destructible types");
+		return static_cast<T *>(this->allocate(count * sizeof(T), alignof(T)));
+	}
+
+	/// @brief 直前に確保した領域を返却する
+	///
+	/// 最後に確保した領域の場合のみ、その分だけ巻き戻します。それ以外は何もしません。
+	/// ScratchVectorの拡張時に、古い領域を再利用するために使われます。
+	///
+	void deallocate(void * p, const size_t bytes) noexcept;
+
+	/// @brief 現在の位置を取得する
+	Marker mark(void) const noexcept { return Marker{ this->block_, this->offset_, this->used_ }; }
+
+	/// @brief 指定の位置まで巻き戻す
+	///
+	/// 先頭まで巻き戻した場合は、複数のブロックを合計サイズの1ブロックにまとめます。
+	///
+	void rewind(const Marker & marker) noexcept;
+
+	/// @brief 先頭まで巻き戻す
+	void reset(void) noexcept { this->rewind(Marker{ 0, 0, 0 }); }
+
+	/// @brief 使用中のバイト数
+	size_t used(void) const noexcept { return this->used_; }
+
+	/// @brief 確保済みのブロックの合計バイト数
+	size_t capacity(void) const noexcept;
+
+	/// @brief これまでに同時に使用した最大バイト数
+	size_t highWater(void) const noexcept { return this->high_water_; }
+
+	/// @brief ブロックを確保した回数
+	size_t blockAllocations(void) const noexcept { return this->block_allocations_; }
+
+	/// @brief このスレッドで現在使用中のアリーナ
+	///
+	/// Scopeの中ではそのアリーナを、外ではこのスレッド専用のアリーナを返します。
+	///
+	static ScratchArena & current(void) noexcept;
+
+	/// @brief このスレッド専用のアリーナ
+	static ScratchArena & threadLocal(void) noexcept;
+
+private:
+	struct Block {
+		char * data;
+		size_t size;
+	};
+
+	std::vector<Block> blocks_;
+	size_t block_;				///< 使用中のブロック番号
+	size_t offset_;				///< 使用中のブロック内の位置
+	size_t used_;				///< 使用中のバイト数（前のブロックの使用分を含む）
+	size_t used_before_;		///< 使用中のブロックより前のブロックの使用分
+	size_t peak_;				///< Scopeの計測用の最大使用量
+	size_t high_water_;
+	size_t block_allocations_;
+	const size_t block_size_;
+
+	void * allocateSlow(const size_t bytes, const size_t alignment);
+	Block newBlock(const size_t size);
+};
+
+
+/// @brief ScratchArenaから確保するSTLアロケーター
+///
+/// Scopeを抜けると領域が無効になるため、コンテナはcomputeProcessの中だけで使用してください。
+///
+template <class T>
+class ArenaAllocator {
+public:
+	typedef T value_type;
+
+	static const size_t kAlignment = (alignof(T) > alignof(std::max_align_t) ? alignof(T) : alignof(std::max_align_t));
+
+	explicit ArenaAllocator(ScratchArena & arena) noexcept : arena_(&arena) {}
+	template <class U> ArenaAllocator(const ArenaAllocator<U> & other) noexcept : arena_(other.arena()) {}
+
+	// 要素の型によらず先頭をmax_align_tの境界に揃え、バイト列のコンテナにも任意の型を書き込めるようにする
+	T * allocate(const size_t n) { return static_cast<T *>(this->arena_->allocate(n * sizeof(T), kAlignment)); }
+	void deallocate(T * p, const size_t n) noexcept { this->arena_->deallocate(p, n * sizeof(T)); }
+
+	ScratchArena * arena(void) const noexcept { return this->arena_; }
+
+	template <class U> bool operator==(const ArenaAllocator<U> & other) const noexcept { return this->arena_ == other.arena(); }
+	template <class U> bool operator!=(const ArenaAllocator<U> & other) const noexcept { return this->arena_ != other.arena(); }
+
+private:
+	ScratchArena * arena_;
+};
+
+
+/// @brief ScratchArenaから確保するvector
+template <class T> using ScratchVector = std::vector<T, ArenaAllocator<T>>;
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_SCRATCH_ARENA_HPP_
@@ -0,0 +1,227 @@
+﻿#include "ThreadPool.hpp"
+#include <algorithm>
+
+std::unique_ptr<mpb::ThreadPool> mpb::ThreadPool::global_;
+std::mutex mpb::ThreadPool::global_mutex_;
+
+namespace {
+thread_local int tls_worker_index = -1;
+thread_local const mpb::ThreadPool * tls_worker_pool = nullptr;
+}
+
+////////////////////////////////////////////////
+// TaskGroup
+
+mpb::ThreadPool::TaskGroup::TaskGroup(void) noexcept
+	: pending_(0) {}
+
+mpb::ThreadPool::TaskGroup::~TaskGroup(void)
+{}
+
+void mpb::ThreadPool::TaskGroup::finish(std::exception_ptr e)
+{
+	// 減算と通知をロックの中で行う。waitはロックの中で0を確認してから戻るので、
+	// 待っている側がgroupを破棄するのは、このロックを手放した後になる
+	std::lock_guard<std::mutex> lock(this->mutex_);
+	if (e && !this->exception_) this->exception_ = e;
+	if (this->pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) this->cv_.notify_all();
+}
+
+////////////////////////////////////////////////
+// ThreadPool
+
+mpb::ThreadPool::ThreadPool(const size_t num_workers)
+	: next_queue_(0), queued_(0), stopping_(false)
+{
+	size_t n = num_workers;
+	if (n == 0) {
+		const size_t hw = std::thread::hardware_concurrency();
+		n = (hw > 1 ? hw - 1 : 0);
+	}
+	for (size_t i = 0; i < n; ++i) this->queues_.emplace_back(new WorkerQueue);
+	for (size_t i = 0; i < n; ++i) this->workers_.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+mpb::ThreadPool::~ThreadPool(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(this->sleep_mutex_);
+		this->stopping_.store(true);
+	}
+	this->sleep_cv_.notify_all();
+	for (auto & t : this->workers_) t.join();
+}
+
+void mpb::ThreadPool::submit(TaskGroup & group, Task && task)
+{
+	group.pending_.fetch_add(1, std::memory_order_relaxed);
+	if (this->queues_.empty()) {
+		Job job{ &group, std::move(task) };
+		run(job);
+		return;
+	}
+
+	// ワーカーから投入された場合は自分のキューへ、それ以外はラウンドロビン
+	size_t index;
+	if (tls_worker_pool == this) index = static_cast<size_t>(tls_worker_index);
+	else index = this->next_queue_.fetch_add(1, std::memory_order_relaxed) % this->queues_.size();
+
+	{
+		std::lock_guard<std::mutex> lock(this->queues_[index]->mutex);
+		this->queues_[index]->jobs.push_back(Job{ &group, std::move(task) });
+		// popと同じロックの中で数え、queued_がキューの中身より少なく見えないようにする
+		this->queued_.fetch_add(1, std::memory_order_release);
+	}
+	{
+		std::lock_guard<std::mutex> lock(this->sleep_mutex_);
+	}
+	this->sleep_cv_.notify_one();
+}
+
+void mpb::ThreadPool::wait(TaskGroup & group)
+{
+	const size_t self = (tls_worker_pool == this ? static_cast<size_t>(tls_worker_index) : this->queues_.size());
+	std::exception_ptr e;
+	while (true) {
+		{
+			// 完了の確認は必ずロックの中で行う（finishがgroupに触れ終わっていることの保証）
+			std::lock_guard<std::mutex> lock(group.mutex_);
+			if (group.pending_.load(std::memory_order_acquire) == 0) {
+				e = group.exception_;
+				group.exception_ = nullptr;
+				break;
+			}
+		}
+		Job job;
+		if ((self < this->queues_.size() && this->popOwn(self, job)) || this->steal(self, job, false)) {
+			run(job);
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(group.mutex_);
+		group.cv_.wait_for(lock, std::chrono::microseconds(100), [&group] { return group.pending_.load(std::memory_order_acquire) == 0; });
+	}
+	if (e) std::rethrow_exception(e);
+}
+
+void mpb::ThreadPool::parallelFor(const size_t count, const size_t grain_size, const std::function<void(size_t, size_t)> & kernel)
+{
+	if (count == 0) return;
+	const size_t grain = (grain_size == 0 ? this->grainSize(count) : grain_size);
+
+	// 小さい入力は分割のオーバーヘッドの方が大きいのでシリアル実行
+	if (this->queues_.empty() || count < grain * 2) {
+		kernel(0, count);
+		return;
+	}
+
+	TaskGroup group;
+	const size_t num_chunks = (count + grain - 1) / grain;
+	// 最後のチャンクは呼び出しスレッドで直接処理する
+	for (size_t c = 0; c + 1 < num_chunks; ++c) {
+		const size_t begin = c * grain;
+		const size_t end = begin + grain;
+		this->submit(group, [&kernel, begin, end] { kernel(begin, end); });
+	}
+	std::exception_ptr local;
+	try {
+		kernel((num_chunks - 1) * grain, count);
+	}
+	catch (...) {
+		local = std::current_exception();
+	}
+	this->wait(group);
+	if (local) std::rethrow_exception(local);
+}
+
+size_t mpb::ThreadPool::grainSize(const size_t count, const size_t min_grain) const noexcept
+{
+	const size_t target_chunks = this->concurrency() * kChunksPerWorker;
+	const size_t grain = (count + target_chunks - 1) / target_chunks;
+	return std::max<size_t>(grain, std::max<size_t>(min_grain, 1));
+}
+
+mpb::ThreadPool & mpb::ThreadPool::global(void)
+{
+	std::lock_guard<std::mutex> lock(global_mutex_);
+	if (!global_) global_.reset(new ThreadPool());
+	return *global_;
+}
+
+void mpb::ThreadPool::shutdownGlobal(void)
+{
+	std::lock_guard<std::mutex> lock(global_mutex_);
+	global_.reset();
+}
+
+int mpb::ThreadPool::currentWorkerIndex(void) noexcept
+{ return tls_worker_index; }
+
+void mpb::ThreadPool::workerLoop(const size_t index)
+{
+	tls_worker_index = static_cast<int>(index);
+	tls_worker_pool = this;
+
+	while (true) {
+		Job job;
+		if (this->popOwn(index, job) || this->steal(index, job, false)) {
+			run(job);
+			continue;
+		}
+		// 競合でtry_lockに負けただけでタスクは残っている。ロックを待って盗み直し、それでも取れなければ譲る
+		if (this->queued_.load(std::memory_order_acquire) != 0) {
+			if (this->steal(index, job, true)) {
+				run(job);
+				continue;
+			}
+			std::this_thread::yield();
+		}
+		std::unique_lock<std::mutex> lock(this->sleep_mutex_);
+		this->sleep_cv_.wait(lock, [this] { return this->stopping_.load() || this->queued_.load(std::memory_order_acquire) != 0; });
+		if (this->stopping_.load()) break;
+	}
+
+	tls_worker_index = -1;
+	tls_worker_pool = nullptr;
+}
+
+bool mpb::ThreadPool::popOwn(const size_t index, Job & job)
+{
+	WorkerQueue & q = *this->queues_[index];
+	std::lock_guard<std::mutex> lock(q.mutex);
+	if (q.jobs.empty()) return false;
+	// 自分のキューはLIFO（キャッシュが温かい順）
+	job = std::move(q.jobs.back());
+	q.jobs.pop_back();
+	this->queued_.fetch_sub(1, std::memory_order_relaxed);
+	return true;
+}
+
+bool mpb::ThreadPool::steal(const size_t thief, Job & job, const bool blocking)
+{
+	const size_t n = this->queues_.size();
+	for (size_t i = 1; i <= n; ++i) {
+		WorkerQueue & q = *this->queues_[(thief + i) % n];
+		std::unique_lock<std::mutex> lock(q.mutex, std::defer_lock);
+		if (blocking) lock.lock();
+		else if (!lock.try_lock()) continue;
+		if (q.jobs.empty()) continue;
+		// 他人のキューはFIFO（大きな塊が残っている側）から盗む
+		job = std::move(q.jobs.front());
+		q.jobs.pop_front();
+		this->queued_.fetch_sub(1, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
+
+void mpb::ThreadPool::run(Job & job)
+{
+	std::exception_ptr e;
+	try {
+		job.task();
+	}
+	catch (...) {
+		e = std::current_exception();
+	}
+	job.group->finish(e);
+}
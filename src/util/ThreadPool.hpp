@@ -0,0 +1,175 @@
+﻿/// @file ThreadPool.hpp
+/// @brief ThreadPoolクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_THREAD_POOL_HPP_
+#define _MAYA_PLUGIN_BASE_THREAD_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mpb {
+
+/// @brief ワークスティーリング型の常駐スレッドプール
+///
+/// ワーカーごとにタスクキューを持ち、自分のキューが空になったワーカーは他のワーカーのキューの末尾からタスクを盗みます。
+/// プール自体はプラグインのロード中ずっと常駐し、compute毎にスレッドを生成するコストを避けます。
+///
+/// Maya APIはスレッドセーフではないため、タスク内でMDataBlockやMPlug等を触らないでください。
+/// データはcomputeスレッドで生配列に取り出してから渡します。
+///
+class ThreadPool {
+public:
+
+	typedef std::function<void(void)> Task;
+
+	/// @brief タスクの完了待ちを行うグループ
+	///
+	/// 投入したタスクがすべて終わるまでwait()でブロックします。
+	/// タスク内で投げられた例外は最初の1つだけ保持され、wait()で再送出されます。
+	///
+	class TaskGroup {
+	public:
+		TaskGroup(void) noexcept;
+		TaskGroup(const TaskGroup &) = delete;
+		TaskGroup & operator=(const TaskGroup &) = delete;
+		~TaskGroup(void);
+
+	private:
+		friend class ThreadPool;
+		std::atomic<size_t> pending_;
+		std::mutex mutex_;
+		std::condition_variable cv_;
+		std::exception_ptr exception_;
+
+		void finish(std::exception_ptr e);
+	};
+
+	/// @brief コンストラクタ
+	///
+	/// @param [in] num_workers ワーカースレッド数。0の場合はハードウェアスレッド数-1（呼び出しスレッドも処理に参加するため）
+	///
+	explicit ThreadPool(const size_t num_workers = 0);
+
+	/// @brief デストラクタ
+	///
+	/// 残っているタスクを破棄し、すべてのワーカーを停止・joinします。
+	///
+	~ThreadPool(void);
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool & operator=(const ThreadPool &) = delete;
+
+
+	/// @brief ワーカースレッド数を取得する
+	size_t numWorkers(void) const noexcept { return this->workers_.size(); }
+
+	/// @brief 呼び出しスレッドを含めた並列度を取得する
+	size_t concurrency(void) const noexcept { return this->workers_.size() + 1; }
+
+
+	/// @brief タスクを投入する
+	///
+	/// @param [in,out] group 完了待ちのグループ
+	/// @param [in] task 実行するタスク
+	///
+	void submit(TaskGroup & group, Task && task);
+
+
+	/// @brief グループのタスクがすべて終わるまで待つ
+	///
+	/// 待っている間、呼び出しスレッドも未処理のタスクを盗んで実行します。
+	/// 戻った時点でワーカーはgroupに触れ終わっているので、直後にgroupを破棄できます。
+	///
+	/// @param [in,out] group 完了待ちのグループ
+	///
+	/// @throws any タスク内で例外が発生した場合、最初の例外を再送出します
+	///
+	void wait(TaskGroup & group);
+
+
+	/// @brief 範囲[0, count)をチャンクに分割して並列実行する
+	///
+	/// countがgrain_sizeの2倍に満たない場合や、ワーカーがいない場合は呼び出しスレッドでそのまま実行します。
+	///
+	/// @param [in] count 要素数
+	/// @param [in] grain_size 1チャンクの最小要素数。0の場合はgrainSize()で自動決定
+	/// @param [in] kernel 範囲[begin, end)を処理する関数
+	///
+	/// @throws any kernelで例外が発生した場合、最初の例外を再送出します
+	///
+	void parallelFor(const size_t count, const size_t grain_size, const std::function<void(size_t, size_t)> & kernel);
+
+
+	/// @brief チャンクサイズの自動決定
+	///
+	/// ワーカー1つあたり数チャンクになるように分割しつつ、小さすぎるチャンクにならないよう下限を設けます。
+	///
+	/// @param [in] count 要素数
+	/// @param [in] min_grain チャンクの最小要素数
+	///
+	/// @return チャンクの要素数
+	///
+	size_t grainSize(const size_t count, const size_t min_grain = kDefaultMinGrain) const noexcept;
+
+
+	/// @brief プラグイン全体で共有するプールを取得する
+	///
+	/// 初回呼び出し時に生成されます。
+	///
+	static ThreadPool & global(void);
+
+	/// @brief 共有プールを停止する
+	///
+	/// DLLのアンロード前にスレッドを停止させるため、uninitializePluginから呼び出します。
+	///
+	static void shutdownGlobal(void);
+
+	/// @brief 現在のスレッドがこのプールのワーカーか
+	///
+	/// @return ワーカー番号。ワーカー以外のスレッドの場合は-1
+	///
+	static int currentWorkerIndex(void) noexcept;
+
+
+	static const size_t kDefaultMinGrain = 1024;	///< チャンクの既定最小要素数
+	static const size_t kChunksPerWorker = 4;		///< ワーカー1つあたりの目安チャンク数
+
+private:
+
+	struct Job {
+		TaskGroup * group;
+		Task task;
+	};
+
+	struct WorkerQueue {
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	std::vector<std::unique_ptr<WorkerQueue>> queues_;
+	std::vector<std::thread> workers_;
+	std::atomic<size_t> next_queue_;
+	std::atomic<size_t> queued_;
+	std::atomic<bool> stopping_;
+	std::mutex sleep_mutex_;
+	std::condition_variable sleep_cv_;
+
+	void workerLoop(const size_t index);
+	bool popOwn(const size_t index, Job & job);
+	bool steal(const size_t thief, Job & job, const bool blocking);
+	static void run(Job & job);
+
+	static std::unique_ptr<ThreadPool> global_;
+	static std::mutex global_mutex_;
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_THREAD_POOL_HPP_
@@ -0,0 +1,364 @@
+﻿#include "UndoJournal.hpp"
+#include "exception/MStatusException.hpp"
+#include <algorithm>
+#include <deque>
+#include <memory>
+
+const size_t mpb::UndoJournal::kDefaultBudget;
+const size_t mpb::UndoJournal::kChunkSize;
+
+/// 記録を詰める領域
+struct mpb::UndoJournal::Chunk {
+	std::unique_ptr<char[]> data;
+	size_t capacity;
+	size_t used;
+	uint64_t first_id;		///< この領域の最初の記録の通し番号
+	size_t live;			///< 解放されていない記録数
+	size_t record_bytes;
+	size_t raw_bytes;
+};
+
+/// ジャーナル全体の状態
+struct mpb::UndoJournal::State {
+	std::mutex mutex;
+	std::deque<std::unique_ptr<Chunk>> chunks;	///< 古い順
+	size_t budget = kDefaultBudget;
+	size_t reserved = 0;
+	size_t record_bytes = 0;
+	size_t raw_bytes = 0;
+	size_t records = 0;
+	uint64_t next_id = 0;
+	uint64_t valid_from = 0;	///< これより小さい通し番号の記録は破棄済み
+	uint64_t evicted = 0;
+	bool delta = true;
+
+	/// @brief 最も古い領域を破棄する
+	void evictFront(void)
+	{
+		Chunk & c = *this->chunks.front();
+		this->evicted += c.live;
+		this->records -= c.live;
+		this->record_bytes -= c.record_bytes;
+		this->raw_bytes -= c.raw_bytes;
+		this->reserved -= c.capacity;
+		this->chunks.pop_front();
+		this->valid_from = (this->chunks.empty() ? this->next_id : this->chunks.front()->first_id);
+	}
+
+	/// @brief sizeバイトを置く領域を用意する
+	Chunk & reserve(const size_t size)
+	{
+		if (!this->chunks.empty()) {
+			Chunk & back = *this->chunks.back();
+			if (back.capacity == kChunkSize && back.capacity - back.used >= size) return back;
+		}
+		const size_t capacity = std::max(kChunkSize, size);
+		// 上限より大きい記録は、他をすべて破棄してでも保持する
+		while (!this->chunks.empty() && this->reserved + capacity > this->budget) this->evictFront();
+
+		std::unique_ptr<Chunk> chunk(new Chunk{ std::unique_ptr<char[]>(new char[capacity]), capacity, 0, this->next_id, 0, 0, 0 });
+		this->reserved += capacity;
+		this->chunks.push_back(std::move(chunk));
+		return *this->chunks.back();
+	}
+};
+
+mpb::UndoJournal::State & mpb::UndoJournal::state(void)
+{
+	static State s;
+	return s;
+}
+
+namespace {
+
+void putVarint(std::vector<char> & out, uint64_t v)
+{
+	while (v >= 0x80) {
+		out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+		v >>= 7;
+	}
+	out.push_back(static_cast<char>(v));
+}
+
+/// 記録の読み出し。記録は自分で書いたものなので、壊れていれば例外にする
+class Cursor {
+public:
+	Cursor(const char * data, const size_t size) noexcept : p_(data), end_(data + size) {}
+
+	uint64_t varint(void)
+	{
+		uint64_t v = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			const uint8_t b = static_cast<uint8_t>(*this->take(1));
+			v |= static_cast<uint64_t>(b & 0x7f) << shift;
+			if (!(b & 0x80)) return v;
+		}
+		mpb::MStatusException::throwError(MStatus::kFailure, "undoジャーナルの記録が壊れています", "mpb::UndoJournal::Entry::replay");
+	}
+
+	const char * take(const size_t size)
+	{
+		if (size > static_cast<size_t>(this->end_ - this->p_)) mpb::MStatusException::throwError(MStatus::kFailure, "undoジャーナルの記録が壊れています", "mpb::UndoJournal::Entry::replay");
+		const char * p = this->p_;
+		this->p_ += size;
+		return p;
+	}
+
+private:
+	const char * p_;
+	const char * end_;
+};
+
+/// 変更前とのXORを8バイトごとに「0でないバイトのマスク + 0でないバイト」で書く
+void putDelta(std::vector<char> & out, const char * before, const char * after, const size_t size)
+{
+	for (size_t w = 0; w < size; w += 8) {
+		const size_t n = std::min<size_t>(8, size - w);
+		char x[8];
+		uint8_t mask = 0;
+		for (size_t k = 0; k < n; ++k) {
+			x[k] = static_cast<char>(before[w + k] ^ after[w + k]);
+			if (x[k] != 0) mask |= static_cast<uint8_t>(1u << k);
+		}
+		out.push_back(static_cast<char>(mask));
+		for (size_t k = 0; k < n; ++k) {
+			if (mask & (1u << k)) out.push_back(x[k]);
+		}
+	}
+}
+
+void takeDelta(Cursor & in, const char * before, char * after, const size_t size)
+{
+	for (size_t w = 0; w < size; w += 8) {
+		const size_t n = std::min<size_t>(8, size - w);
+		const uint8_t mask = static_cast<uint8_t>(*in.take(1));
+		for (size_t k = 0; k < n; ++k) {
+			after[w + k] = before[w + k];
+			if (mask & (1u << k)) after[w + k] = static_cast<char>(after[w + k] ^ *in.take(1));
+		}
+	}
+}
+
+enum : uint8_t { kFlagDelta = 1 };
+
+}
+
+void mpb::UndoJournal::Entry::recordBytes(const std::string & target, const size_t element_size, const void * before, const size_t before_count, const void * after, const size_t after_count)
+{
+	const char * b = static_cast<const char *>(before);
+	const char * a = static_cast<const char *>(after);
+	const size_t common = std::min(before_count, after_count);
+	const size_t total = std::max(before_count, after_count);
+	if (total > UINT32_MAX) MStatusException::throwError(MStatus::kInvalidParameter, "undoジャーナルに記録できる要素数を超えています", "mpb::UndoJournal::Entry::record");
+
+	// 変更された要素の番号。昇順なので、変更前・変更後にある要素はそれぞれ先頭からの連続になる
+	thread_local std::vector<uint32_t> indices;
+	indices.clear();
+	for (size_t i = 0; i < common; ++i) {
+		if (std::memcmp(b + i * element_size, a + i * element_size, element_size) != 0) indices.push_back(static_cast<uint32_t>(i));
+	}
+	for (size_t i = common; i < total; ++i) indices.push_back(static_cast<uint32_t>(i));
+	if (indices.empty() && before_count == after_count) return;
+
+	State & s = state();
+	bool delta;
+	{
+		std::lock_guard<std::mutex> lock(s.mutex);
+		delta = s.delta;
+	}
+
+	thread_local std::vector<char> out;
+	out.clear();
+	out.push_back(static_cast<char>(delta ? kFlagDelta : 0));
+	putVarint(out, target.size());
+	out.insert(out.end(), target.begin(), target.end());
+	putVarint(out, element_size);
+	putVarint(out, before_count);
+	putVarint(out, after_count);
+	putVarint(out, indices.size());
+	// 連続区間ごとに（前の区間の終わりからの間隔, 長さ）
+	uint32_t prev_end = 0;
+	for (size_t i = 0; i < indices.size();) {
+		size_t j = i + 1;
+		while (j < indices.size() && indices[j] == indices[j - 1] + 1) ++j;
+		putVarint(out, indices[i] - prev_end);
+		putVarint(out, j - i);
+		prev_end = indices[j - 1] + 1;
+		i = j;
+	}
+	for (const uint32_t i : indices) {
+		if (i >= before_count) break;
+		out.insert(out.end(), b + i * element_size, b + (i + 1) * element_size);
+	}
+	for (const uint32_t i : indices) {
+		if (i >= after_count) break;
+		if (delta && i < before_count) putDelta(out, b + i * element_size, a + i * element_size, element_size);
+		else out.insert(out.end(), a + i * element_size, a + (i + 1) * element_size);
+	}
+
+	const size_t raw = (before_count + after_count) * element_size;
+	std::lock_guard<std::mutex> lock(s.mutex);
+	Chunk & chunk = s.reserve(out.size());
+	std::memcpy(chunk.data.get() + chunk.used, out.data(), out.size());
+	this->records_.push_back(Record{ &chunk, s.next_id++, chunk.used, out.size(), raw });
+	chunk.used += out.size();
+	chunk.live += 1;
+	chunk.record_bytes += out.size();
+	chunk.raw_bytes += raw;
+	s.records += 1;
+	s.record_bytes += out.size();
+	s.raw_bytes += raw;
+}
+
+bool mpb::UndoJournal::Entry::replay(const bool undo, const std::function<void(const JournalChange &)> & apply) const
+{
+	// applyの中で別のコマンドが記録する場合があるため、ロック中に複製してから適用する
+	std::vector<char> bytes;
+	{
+		State & s = state();
+		std::lock_guard<std::mutex> lock(s.mutex);
+		size_t total = 0;
+		for (const Record & r : this->records_) {
+			if (r.id < s.valid_from) return false;
+			total += r.size;
+		}
+		bytes.reserve(total);
+		for (const Record & r : this->records_) bytes.insert(bytes.end(), r.chunk->data.get() + r.offset, r.chunk->data.get() + r.offset + r.size);
+	}
+
+	std::vector<size_t> offsets;
+	offsets.reserve(this->records_.size());
+	size_t offset = 0;
+	for (const Record & r : this->records_) {
+		offsets.push_back(offset);
+		offset += r.size;
+	}
+
+	std::string target;
+	std::vector<uint32_t> indices;
+	std::vector<char> values;
+	for (size_t k = 0; k < offsets.size(); ++k) {
+		const size_t n = (undo ? offsets.size() - 1 - k : k);
+		Cursor in(bytes.data() + offsets[n], this->records_[n].size);
+
+		const uint8_t flags = static_cast<uint8_t>(*in.take(1));
+		const size_t target_size = static_cast<size_t>(in.varint());
+		target.assign(in.take(target_size), target_size);
+		const size_t element_size = static_cast<size_t>(in.varint());
+		const size_t before_count = static_cast<size_t>(in.varint());
+		const size_t after_count = static_cast<size_t>(in.varint());
+		const size_t count = static_cast<size_t>(in.varint());
+
+		indices.clear();
+		uint32_t prev_end = 0;
+		while (indices.size() < count) {
+			const uint32_t begin = prev_end + static_cast<uint32_t>(in.varint());
+			const uint32_t length = static_cast<uint32_t>(in.varint());
+			for (uint32_t i = 0; i < length; ++i) indices.push_back(begin + i);
+			prev_end = begin + length;
+		}
+		const size_t num_before = static_cast<size_t>(std::lower_bound(indices.begin(), indices.end(), static_cast<uint32_t>(std::min<size_t>(before_count, UINT32_MAX))) - indices.begin());
+		const size_t num_after = static_cast<size_t>(std::lower_bound(indices.begin(), indices.end(), static_cast<uint32_t>(std::min<size_t>(after_count, UINT32_MAX))) - indices.begin());
+		const char * before_values = in.take(num_before * element_size);
+
+		JournalChange change;
+		change.target_ = &target;
+		change.element_size_ = element_size;
+		change.indices_ = indices.data();
+		if (undo) {
+			change.length_ = before_count;
+			change.count_ = num_before;
+			change.values_ = before_values;
+		}
+		else {
+			values.resize(num_after * element_size);
+			for (size_t i = 0; i < num_after; ++i) {
+				char * dst = values.data() + i * element_size;
+				if ((flags & kFlagDelta) && i < num_before) takeDelta(in, before_values + i * element_size, dst, element_size);
+				else std::memcpy(dst, in.take(element_size), element_size);
+			}
+			change.length_ = after_count;
+			change.count_ = num_after;
+			change.values_ = values.data();
+		}
+		apply(change);
+	}
+	return true;
+}
+
+bool mpb::UndoJournal::Entry::valid(void) const
+{
+	State & s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	for (const Record & r : this->records_) {
+		if (r.id < s.valid_from) return false;
+	}
+	return true;
+}
+
+size_t mpb::UndoJournal::Entry::bytes(void) const noexcept
+{
+	size_t total = 0;
+	for (const Record & r : this->records_) total += r.size;
+	return total;
+}
+
+void mpb::UndoJournal::Entry::clear(void)
+{
+	if (this->records_.empty()) return;
+	State & s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	for (const Record & r : this->records_) {
+		// 破棄済みの領域はもうない
+		if (r.id < s.valid_from) continue;
+		Chunk & c = *r.chunk;
+		c.live -= 1;
+		c.record_bytes -= r.size;
+		c.raw_bytes -= r.raw_size;
+		s.records -= 1;
+		s.record_bytes -= r.size;
+		s.raw_bytes -= r.raw_size;
+		if (c.live > 0) continue;
+		if (&c == s.chunks.back().get() && c.capacity == kChunkSize) {
+			// 書き込み中の領域は使い回す
+			c.used = 0;
+			c.first_id = s.next_id;
+			continue;
+		}
+		const auto it = std::find_if(s.chunks.begin(), s.chunks.end(), [&c](const std::unique_ptr<Chunk> & p) { return p.get() == &c; });
+		s.reserved -= c.capacity;
+		const bool front = (it == s.chunks.begin());
+		s.chunks.erase(it);
+		if (front) s.valid_from = (s.chunks.empty() ? s.next_id : s.chunks.front()->first_id);
+	}
+	this->records_.clear();
+}
+
+void mpb::UndoJournal::setBudget(const size_t bytes)
+{
+	State & s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	s.budget = bytes;
+	while (!s.chunks.empty() && s.reserved > s.budget) s.evictFront();
+}
+
+size_t mpb::UndoJournal::budget(void)
+{
+	State & s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	return s.budget;
+}
+
+void mpb::UndoJournal::setDeltaEncoding(const bool enabled)
+{
+	State & s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	s.delta = enabled;
+}
+
+mpb::UndoJournal::Stats mpb::UndoJournal::stats(void)
+{
+	State & s = state();
+	std::lock_guard<std::mutex> lock(s.mutex);
+	return Stats{ s.budget, s.reserved, s.record_bytes, s.raw_bytes, s.records, s.chunks.size(), s.evicted };
+}
@@ -0,0 +1,191 @@
+﻿/// @file UndoJournal.hpp
+/// @brief UndoJournalクラスヘッダファイル
+
+#pragma once
+#ifndef _MAYA_PLUGIN_BASE_UNDO_JOURNAL_HPP_
+#define _MAYA_PLUGIN_BASE_UNDO_JOURNAL_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace mpb {
+
+/// @brief undoジャーナルから取り出した1回分の変更
+///
+/// 対象の配列をlength()の長さにし、index(i)番目の要素をvalue<T>(i)に書き換えると、記録時の状態（undoなら変更前、redoなら変更後）に戻ります。
+///
+class JournalChange {
+public:
+
+	/// @brief 記録時に指定した対象名
+	const std::string & target(void) const noexcept { return *this->target_; }
+
+	/// @brief 適用後の配列の要素数
+	size_t length(void) const noexcept { return this->length_; }
+
+	/// @brief 書き換える要素の数
+	size_t size(void) const noexcept { return this->count_; }
+
+	/// @brief 1要素のバイト数
+	size_t elementSize(void) const noexcept { return this->element_size_; }
+
+	/// @brief i番目に書き換える要素の番号
+	uint32_t index(const size_t i) const noexcept { return this->indices_[i]; }
+
+	/// @brief i番目に書き換える要素の値
+	template <class T> T value(const size_t i) const noexcept
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "JournalChange::valueにはトリビアルコピー可能な型を指定してください");
+		T v;
+		std::memcpy(&v, this->values_ + i * this->element_size_, sizeof(T));
+		return v;
+	}
+
+private:
+	friend class UndoJournal;
+
+	const std::string * target_;
+	size_t length_;
+	size_t element_size_;
+	size_t count_;
+	const uint32_t * indices_;
+	const char * values_;
+};
+
+
+/// @brief メモリ上限つきのundoジャーナル
+///
+/// コマンドが配列を書き換えるたびに配列全体を複製してundoに備えると、長いセッションでメモリが膨らみます。
+/// ジャーナルには変更された要素の番号と値の差分だけを記録します。
+///
+/// - 要素番号は連続区間ごとに可変長整数で符号化します
+/// - 変更後の値は変更前とのXORのうち0でないバイトだけを保持します（setDeltaEncodingで無効化できます）
+/// - 記録はプラグイン全体で共有する固定サイズのチャンクに詰めて保持し、合計が上限を超えると最も古いチャンクから破棄します
+///
+/// 破棄された記録を持つコマンドはundo/redoできなくなります（Entry::validがfalseになります）。
+/// Mayaのメインスレッドから使うことを想定していますが、内部の状態はロックで保護しています。
+///
+class UndoJournal {
+	struct Chunk;
+	struct State;
+
+public:
+
+	/// @brief 統計
+	struct Stats {
+		size_t budget;				///< 上限のバイト数
+		size_t reserved_bytes;		///< 確保しているチャンクの合計
+		size_t record_bytes;		///< 記録の合計（符号化後）
+		size_t raw_bytes;			///< 変更前後の配列を丸ごと複製した場合の合計
+		size_t records;				///< 保持している記録数
+		size_t chunks;				///< チャンク数
+		uint64_t evicted_records;	///< 上限により破棄した記録数の累計
+	};
+
+	/// @brief 既定の上限
+	static const size_t kDefaultBudget = size_t(64) << 20;
+
+	/// @brief チャンクのバイト数。これより大きい記録は専用のチャンクに置きます
+	static const size_t kChunkSize = size_t(1) << 20;
+
+
+	/// @brief コマンド1回分の記録
+	///
+	/// 破棄するとジャーナルから記録を解放します。
+	///
+	class Entry {
+	public:
+		Entry(void) noexcept {}
+		~Entry(void) { this->clear(); }
+
+		Entry(const Entry &) = delete;
+		Entry & operator=(const Entry &) = delete;
+
+
+		/// @brief 配列の変更を記録する
+		///
+		/// 共通する長さの範囲は異なる要素だけを、長さが変わった部分は全要素を記録します。
+		///
+		/// @param [in] target 対象名。applyで対象を見分けるために使います
+		/// @param [in] before 変更前の配列
+		/// @param [in] before_count 変更前の要素数
+		/// @param [in] after 変更後の配列
+		/// @param [in] after_count 変更後の要素数
+		///
+		template <class T> void record(const std::string & target, const T * before, const size_t before_count, const T * after, const size_t after_count)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "UndoJournal::Entry::recordにはトリビアルコピー可能な型を指定してください");
+			this->recordBytes(target, sizeof(T), before, before_count, after, after_count);
+		}
+
+		/// @brief 長さの変わらない配列の変更を記録する
+		template <class T> void record(const std::string & target, const T * before, const T * after, const size_t count)
+		{ this->record(target, before, count, after, count); }
+
+		/// @brief 要素のバイト数を指定して配列の変更を記録する
+		void recordBytes(const std::string & target, const size_t element_size, const void * before, const size_t before_count, const void * after, const size_t after_count);
+
+
+		/// @brief 記録を順に適用する
+		///
+		/// @param [in] undo trueなら新しい記録から順に変更前の状態を、falseなら古い記録から順に変更後の状態を適用します
+		/// @param [in] apply 1回分の変更を対象へ書き込む関数
+		///
+		/// @retval true 適用した
+		/// @retval false 記録が破棄されていたため、何もしなかった
+		///
+		bool replay(const bool undo, const std::function<void(const JournalChange &)> & apply) const;
+
+		/// @brief 記録がないか
+		bool empty(void) const noexcept { return this->records_.empty(); }
+
+		/// @brief 記録がすべて残っているか
+		bool valid(void) const;
+
+		/// @brief 記録の合計バイト数
+		size_t bytes(void) const noexcept;
+
+		/// @brief 記録を解放する
+		void clear(void);
+
+	private:
+		struct Record {
+			Chunk * chunk;
+			uint64_t id;		///< 割り当て順の通し番号。破棄済みかの判定に使う
+			size_t offset;
+			size_t size;
+			size_t raw_size;	///< 変更前後の配列を丸ごと複製した場合のバイト数
+		};
+		std::vector<Record> records_;
+	};
+
+
+	/// @brief 上限を設定する
+	///
+	/// 現在の合計が上限を超える場合は、その場で古いものから破棄します。
+	///
+	static void setBudget(const size_t bytes);
+
+	/// @brief 上限
+	static size_t budget(void);
+
+	/// @brief 変更後の値を変更前とのXORで符号化するか（既定では有効）
+	static void setDeltaEncoding(const bool enabled);
+
+	/// @brief 統計
+	static Stats stats(void);
+
+private:
+
+	UndoJournal(void) = delete;
+
+	static State & state(void);
+};
+
+}; // end of mpb
+#endif // end of _MAYA_PLUGIN_BASE_UNDO_JOURNAL_HPP_